@@ -7,6 +7,7 @@
 #include "framework/font.h"
 #include "framework/framework.h"
 #include "framework/image.h"
+#include "framework/metrics.h"
 #include "framework/renderer.h"
 #include "framework/sound.h"
 #include "framework/trace.h"
@@ -15,6 +16,12 @@
 namespace OpenApoc
 {
 
+namespace
+{
+MetricCounter controlsDrawnDirectly("Forms", "controls drawn directly");
+MetricCounter controlsRendered("Forms", "controls rendered");
+} // anonymous namespace
+
 Control::Control(bool takesFocus)
     : mouseInside(false), mouseDepressed(false), resolvedLocation(0, 0), Visible(true),
       Name("Control"), Location(0, 0), Size(0, 0), SelectionSize(0, 0),
@@ -281,6 +288,25 @@ void Control::render()
 		return;
 	}
 
+	if (Enabled && Controls.empty() && canRenderDirect())
+	{
+		sp<Palette> previousPalette;
+		if (this->palette)
+		{
+			previousPalette = fw().renderer->getPalette();
+			fw().renderer->setPalette(this->palette);
+		}
+		renderDirect(Location);
+		controlsDrawnDirectly.add();
+		if (this->palette)
+		{
+			fw().renderer->setPalette(previousPalette);
+		}
+		controlArea.reset();
+		this->dirty = false;
+		return;
+	}
+
 	if (controlArea == nullptr || controlArea->size != Vec2<unsigned int>(Size))
 	{
 		this->dirty = true;
@@ -295,6 +321,7 @@ void Control::render()
 			fw().renderer->setPalette(this->palette);
 		}
 
+		controlsRendered.add();
 		RendererSurfaceBinding b(*fw().renderer, controlArea);
 		onRender();
 		postRender();
@@ -339,12 +366,16 @@ void Control::preRender()
 
 void Control::onRender() { fw().renderer->clear(BackgroundColour); }
 
+bool Control::canRenderDirect() const { return false; }
+
+void Control::renderDirect(Vec2<int>) {}
+
 void Control::postRender()
 {
 	for (auto ctrlidx = Controls.begin(); ctrlidx != Controls.end(); ctrlidx++)
 	{
 		auto c = *ctrlidx;
-		if (c->Visible)
+		if (c->Visible && (!cullChildren || isChildWithinBounds(*c)))
 		{
 			c->render();
 		}
@@ -355,6 +386,12 @@ void Control::postRender()
 	}
 }
 
+bool Control::isChildWithinBounds(const Control &child) const
+{
+	return child.Location.x < Size.x && child.Location.y < Size.y &&
+	       child.Location.x + child.Size.x > 0 && child.Location.y + child.Size.y > 0;
+}
+
 void Control::update()
 {
 	for (auto ctrlidx = Controls.begin(); ctrlidx != Controls.end(); ctrlidx++)
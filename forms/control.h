@@ -50,6 +50,12 @@ class Control : public std::enable_shared_from_this<Control>
 
 	virtual void postRender();
 	virtual void onRender();
+	// True if renderDirect() can draw the control straight onto the surface its parent is drawn
+	// onto instead of onto a surface of its own, which it cannot if what it draws has to be
+	// clipped to it. Only asked of enabled controls without children
+	virtual bool canRenderDirect() const;
+	// Draws the control at offset on the surface bound, with its palette set
+	virtual void renderDirect(Vec2<int> offset);
 
 	virtual bool isFocused() const;
 
@@ -68,6 +74,12 @@ class Control : public std::enable_shared_from_this<Control>
 	void triggerEventCallbacks(FormsEvent *e);
 
 	bool isDirty() const { return dirty; }
+	// True if any part of child is within this control, taking where it is as already laid out
+	bool isChildWithinBounds(const Control &child) const;
+
+	// Leaves out of postRender() children entirely outside of this control, such as the items of
+	// a list scrolled out of view, so they never make or draw their surfaces
+	bool cullChildren = false;
 
 	bool Visible;
 
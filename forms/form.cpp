@@ -59,6 +59,16 @@ sp<Control> Form::copyTo(sp<Control> CopyParent)
 }
 
 sp<Form> Form::loadForm(const UString &path)
+{
+	auto doc = readFormXml(path);
+	if (!doc)
+	{
+		return nullptr;
+	}
+	return loadForm(*doc, path);
+}
+
+sp<pugi::xml_document> Form::readFormXml(const UString &path)
 {
 	auto file = fw().data->fs.open(path);
 	if (!file)
@@ -72,15 +82,19 @@ sp<Form> Form::loadForm(const UString &path)
 		LogWarning("Failed to read form data from \"%s\"", path);
 		return nullptr;
 	}
-	pugi::xml_document doc;
-	auto result = doc.load_buffer(data.get(), file.size());
+	auto doc = mksp<pugi::xml_document>();
+	auto result = doc->load_buffer(data.get(), file.size());
 	if (!result)
 	{
 		LogWarning("Failed to parse form file at \"%s\" - \"%s\" at \"%llu\"", path,
 		           result.description(), (unsigned long long)result.offset);
 		return nullptr;
 	}
+	return doc;
+}
 
+sp<Form> Form::loadForm(const pugi::xml_document &doc, const UString &path)
+{
 	auto node = doc.child("openapoc");
 	if (!node)
 	{
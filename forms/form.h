@@ -2,6 +2,11 @@
 
 #include "control.h"
 
+namespace pugi
+{
+class xml_document;
+} // namespace pugi
+
 namespace OpenApoc
 {
 
@@ -25,6 +30,10 @@ class Form : public Control
 	sp<Control> copyTo(sp<Control> CopyParent) override;
 
 	static sp<Form> loadForm(const UString &path);
+	// Reads and parses the form file at path, which is all loadForm() does that is safe to do off
+	// the main thread, or returns nullptr if it is not a form file
+	static sp<pugi::xml_document> readFormXml(const UString &path);
+	static sp<Form> loadForm(const pugi::xml_document &doc, const UString &path);
 };
 
 }; // namespace OpenApoc
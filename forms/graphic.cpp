@@ -23,7 +23,27 @@ void Graphic::eventOccured(Event *e) { Control::eventOccured(e); }
 void Graphic::onRender()
 {
 	Control::onRender();
+	drawImage({0, 0});
+}
+
+bool Graphic::canRenderDirect() const
+{
+	if (!image || BackgroundColour.a != 0)
+	{
+		return false;
+	}
+	if (Vec2<unsigned int>(Size) == image->size || ImagePosition == FillMethod::Stretch)
+	{
+		return true;
+	}
+	return ImagePosition == FillMethod::Fit && image->size.x <= static_cast<unsigned int>(Size.x) &&
+	       image->size.y <= static_cast<unsigned int>(Size.y);
+}
 
+void Graphic::renderDirect(Vec2<int> offset) { drawImage(offset); }
+
+void Graphic::drawImage(Vec2<int> offset)
+{
 	if (!image)
 	{
 		return;
@@ -32,14 +52,14 @@ void Graphic::onRender()
 	Vec2<float> pos = {0, 0};
 	if (Vec2<unsigned int>(Size) == image->size)
 	{
-		fw().renderer->draw(image, pos);
+		fw().renderer->draw(image, pos + Vec2<float>(offset));
 	}
 	else
 	{
 		switch (ImagePosition)
 		{
 			case FillMethod::Stretch:
-				fw().renderer->drawScaled(image, pos, Size);
+				fw().renderer->drawScaled(image, pos + Vec2<float>(offset), Size);
 				break;
 
 			case FillMethod::Fit:
@@ -75,7 +95,7 @@ void Graphic::onRender()
 						return;
 				}
 
-				fw().renderer->draw(image, pos);
+				fw().renderer->draw(image, pos + Vec2<float>(offset));
 				break;
 
 			case FillMethod::Tile:
@@ -83,7 +103,7 @@ void Graphic::onRender()
 				{
 					for (pos.y = 0; pos.y < Size.y; pos.y += image->size.y)
 					{
-						fw().renderer->draw(image, pos);
+						fw().renderer->draw(image, pos + Vec2<float>(offset));
 					}
 				}
 				break;
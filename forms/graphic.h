@@ -15,8 +15,13 @@ class Graphic : public Control
   private:
 	sp<Image> image;
 
+	void drawImage(Vec2<int> offset);
+
   protected:
 	void onRender() override;
+	// Only if the image is not clipped to the graphic and there is no background to fill
+	bool canRenderDirect() const override;
+	void renderDirect(Vec2<int> offset) override;
 
   public:
 	HorizontalAlignment ImageHAlign;
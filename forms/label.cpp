@@ -28,21 +28,45 @@ void Label::eventOccured(Event *e) { Control::eventOccured(e); }
 void Label::onRender()
 {
 	Control::onRender();
+	drawText({0, 0});
+}
+
+bool Label::canRenderDirect() const
+{
+	if (!font || BackgroundColour.a != 0)
+	{
+		return false;
+	}
+	if (font->getFontHeight(text, Size.x) > Size.y)
+	{
+		return false;
+	}
+	for (auto &line : font->getWrappedText(text, Size.x))
+	{
+		if (font->getFontWidth(line) > Size.x)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Label::renderDirect(Vec2<int> offset) { drawText(offset); }
 
+void Label::drawText(Vec2<int> offset)
+{
 	int xpos;
 	int ypos;
-	std::list<UString> lines = font->wordWrapText(text, Size.x);
+	auto &lines = font->getWrappedText(text, Size.x);
 
-	ypos = align(TextVAlign, Size.y, font->getFontHeight(text, Size.x));
+	ypos = align(TextVAlign, Size.y, (int)lines.size() * font->getFontHeight());
 
-	while (lines.size() > 0)
+	for (auto &line : lines)
 	{
-		xpos = align(TextHAlign, Size.x, font->getFontWidth(lines.front()));
+		xpos = align(TextHAlign, Size.x, font->getFontWidth(line));
 
-		auto textImage = font->getString(lines.front());
-		fw().renderer->draw(textImage, Vec2<float>{xpos, ypos});
+		font->drawString(line, Vec2<float>{offset.x + xpos, offset.y + ypos});
 
-		lines.pop_front();
 		ypos += font->getFontHeight();
 	}
 }
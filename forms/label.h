@@ -17,8 +17,13 @@ class Label : public Control
 	UString text;
 	sp<BitmapFont> font;
 
+	void drawText(Vec2<int> offset);
+
   protected:
 	void onRender() override;
+	// Only if the text fits within the label and there is no background to fill
+	bool canRenderDirect() const override;
+	void renderDirect(Vec2<int> offset) override;
 
   public:
 	HorizontalAlignment TextHAlign;
@@ -16,6 +16,7 @@ ListBox::ListBox(sp<ScrollBar> ExternalScrollBar)
       ScrollOrientation(ListOrientation), HoverColour(0, 0, 0, 0), SelectedColour(0, 0, 0, 0),
       AlwaysEmitSelectionEvents(false)
 {
+	cullChildren = true;
 }
 
 ListBox::~ListBox() = default;
@@ -115,7 +116,7 @@ void ListBox::postRender()
 	for (auto c = Controls.begin(); c != Controls.end(); c++)
 	{
 		auto ctrl = *c;
-		if (ctrl != scroller && ctrl->isVisible())
+		if (ctrl != scroller && ctrl->isVisible() && isChildWithinBounds(*ctrl))
 		{
 			if (ctrl == hovered)
 			{
@@ -15,6 +15,8 @@ MultilistBox::MultilistBox(sp<ScrollBar> ExternalScrollBar)
       ListOrientation(Orientation::Vertical), ScrollOrientation(ListOrientation),
       HoverColour(0, 0, 0, 0), SelectedColour(0, 0, 0, 0)
 {
+	cullChildren = true;
+
 	// default strategies
 	isVisibleItem = [](sp<Control> c) { return c->isVisible(); };
 
@@ -149,7 +151,7 @@ void MultilistBox::postRender()
 	for (auto c = Controls.begin(); c != Controls.end(); c++)
 	{
 		auto ctrl = *c;
-		if (ctrl != scroller && isVisibleItem(ctrl))
+		if (ctrl != scroller && isVisibleItem(ctrl) && isChildWithinBounds(*ctrl))
 		{
 			if (ctrl == hoveredItem)
 			{
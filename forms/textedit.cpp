@@ -187,13 +187,11 @@ void TextEdit::onRender()
 
 		if (caretDraw)
 		{
-			auto textImage = font->getString(cursor);
-			fw().renderer->draw(textImage, Vec2<float>{cxpos, ypos});
+			font->drawString(cursor, Vec2<float>{cxpos, ypos});
 		}
 	}
 
-	auto textImage = font->getString(text);
-	fw().renderer->draw(textImage, Vec2<float>{xpos, ypos});
+	font->drawString(text, Vec2<float>{xpos, ypos});
 }
 
 void TextEdit::update()
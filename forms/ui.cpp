@@ -7,6 +7,7 @@
 #include "framework/framework.h"
 #include "framework/trace.h"
 #include "library/sp.h"
+#include <atomic>
 #include <stdexcept>
 
 namespace OpenApoc
@@ -37,8 +38,26 @@ sp<Form> UI::getForm(UString ID)
 	{
 		auto formPath = UString("forms/") + ID + ".form";
 
-		LogInfo("Trying to load form \"%s\" from \"%s\"", ID, formPath);
-		auto form = Form::loadForm(formPath);
+		sp<pugi::xml_document> doc;
+		{
+			std::lock_guard<std::mutex> l(formsXmlLock);
+			auto preloaded = formsXml.find(ID);
+			if (preloaded != formsXml.end())
+			{
+				doc = preloaded->second;
+				formsXml.erase(preloaded);
+			}
+		}
+		sp<Form> form;
+		if (doc)
+		{
+			form = Form::loadForm(*doc, formPath);
+		}
+		else
+		{
+			LogInfo("Trying to load form \"%s\" from \"%s\"", ID, formPath);
+			form = Form::loadForm(formPath);
+		}
 		if (!form)
 		{
 			LogError("Failed to find form \"%s\" at \"%s\"", ID, formPath);
@@ -66,7 +85,31 @@ sp<BitmapFont> UI::getFont(UString FontData)
 	return fonts[FontData];
 }
 
-void UI::reloadFormsXml() { forms.clear(); }
+void UI::reloadFormsXml()
+{
+	forms.clear();
+	std::lock_guard<std::mutex> l(formsXmlLock);
+	formsXml.clear();
+}
+
+void UI::preloadFormsXml()
+{
+	TRACE_FN;
+	auto IDs = getFormIDs();
+	std::atomic<unsigned int> count{0};
+	auto readForm = [this, &IDs, &count](unsigned int index, unsigned int) {
+		auto doc = Form::readFormXml(UString("forms/") + IDs[index] + ".form");
+		if (doc)
+		{
+			std::lock_guard<std::mutex> l(formsXmlLock);
+			formsXml.emplace(IDs[index], doc);
+			count++;
+		}
+	};
+	// Every file is read and parsed on its own, so they are spread over the thread pool
+	fw().threadPoolParallelFor(static_cast<unsigned int>(IDs.size()), readForm);
+	LogInfo("Preloaded %u form files", count.load());
+}
 
 std::vector<UString> UI::getFormIDs()
 {
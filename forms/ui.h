@@ -3,6 +3,12 @@
 #include "library/sp.h"
 #include "library/strings.h"
 #include <map>
+#include <mutex>
+
+namespace pugi
+{
+class xml_document;
+} // namespace pugi
 
 namespace OpenApoc
 {
@@ -17,6 +23,9 @@ class UI
 	std::map<UString, sp<BitmapFont>> fonts;
 	std::map<UString, sp<Form>> forms;
 	std::map<UString, UString> aliases;
+	// Files read by preloadFormsXml() that getForm() has not made into forms yet
+	std::map<UString, sp<pugi::xml_document>> formsXml;
+	std::mutex formsXmlLock;
 
   public:
 	UI();
@@ -31,6 +40,9 @@ class UI
 	static UI &getInstance();
 
 	void reloadFormsXml();
+	// Reads and parses every form file ahead of getForm() needing it, such as on a thread of the
+	// pool while booting, leaving only making the controls to the first getForm() of each form
+	void preloadFormsXml();
 };
 
 UI &ui();
@@ -1,97 +0,0 @@
-#ifndef THREAD_POOL_H
-#define THREAD_POOL_H
-
-#include <condition_variable>
-#include <functional>
-#include <future>
-#include <memory>
-#include <mutex>
-#include <queue>
-#include <stdexcept>
-#include <thread>
-#include <vector>
-
-#include "framework/trace.h"
-
-class ThreadPool
-{
-  public:
-	ThreadPool(size_t);
-	void enqueue(std::function<void()> task);
-	~ThreadPool();
-
-  private:
-	// need to keep track of threads so we can join them
-	std::vector<std::thread> workers;
-	// the task queue
-	std::queue<std::function<void()>> tasks;
-
-	// synchronization
-	std::mutex queue_mutex;
-	std::condition_variable condition;
-	bool stop;
-};
-
-// the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads) : stop(false)
-{
-	// Having a zero-sized threadpool really doesn't make sense
-	LogAssert(threads > 0);
-	for (size_t i = 0; i < threads; ++i)
-		workers.emplace_back([this, i] {
-			OpenApoc::Trace::setThreadName("ThreadPool " +
-			                               OpenApoc::Strings::fromInteger(static_cast<int>(i)));
-			for (;;)
-			{
-				std::function<void()> task;
-
-				{
-					std::unique_lock<std::mutex> lock(this->queue_mutex);
-					this->condition.wait(lock,
-					                     [this] { return this->stop || !this->tasks.empty(); });
-					if (this->stop && this->tasks.empty())
-						return;
-					task = std::move(this->tasks.front());
-					this->tasks.pop();
-				}
-
-				try
-				{
-					task();
-				}
-				catch (std::exception &e)
-				{
-					LogError("Exception occurred in threadpool: %s", e.what());
-				}
-			}
-		});
-}
-
-// add new work item to the pool
-void ThreadPool::enqueue(std::function<void()> task)
-{
-	{
-		std::unique_lock<std::mutex> lock(queue_mutex);
-
-		// don't allow enqueueing after stopping the pool
-		if (stop)
-			throw std::runtime_error("enqueue on stopped ThreadPool");
-
-		tasks.emplace(task);
-	}
-	condition.notify_one();
-}
-
-// the destructor joins all threads
-inline ThreadPool::~ThreadPool()
-{
-	{
-		std::unique_lock<std::mutex> lock(queue_mutex);
-		stop = true;
-	}
-	condition.notify_all();
-	for (std::thread &worker : workers)
-		worker.join();
-}
-
-#endif
@@ -93,4 +93,17 @@ sp<VoxelSlice> LOFTemps::getSlice(unsigned int idx)
 	return this->slices[idx];
 }
 
+size_t LOFTemps::getBytes() const
+{
+	size_t bytes = 0;
+	for (auto &slice : this->slices)
+	{
+		if (slice)
+		{
+			bytes += (slice->size.x * slice->size.y + 7) / 8;
+		}
+	}
+	return bytes;
+}
+
 }; // namespace OpenApoc
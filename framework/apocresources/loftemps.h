@@ -17,5 +17,7 @@ class LOFTemps
   public:
 	LOFTemps(IFile &datFile, IFile &tabFile);
 	sp<VoxelSlice> getSlice(unsigned int idx);
+	// Memory taken by the slices
+	size_t getBytes() const;
 };
 }; // namespace OpenApoc
@@ -1,10 +1,17 @@
 #include "framework/apocresources/pck.h"
+#include "framework/configfile.h"
 #include "framework/data.h"
+#include "framework/filesystem.h"
 #include "framework/framework.h"
 #include "framework/image.h"
 #include "framework/logger.h"
 #include "framework/trace.h"
 #include "library/sp.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
 #include <istream>
 #include <vector>
 
@@ -201,7 +208,7 @@ static unsigned int guessTabMultiplier(IFile &pckFile, IFile &tabFile)
 	}
 }
 
-sp<ImageSet> PCKLoader::load(Data &d, UString PckFilename, UString TabFilename)
+static sp<ImageSet> decodePck(Data &d, const UString &PckFilename, const UString &TabFilename)
 {
 	auto imageSet = mksp<ImageSet>();
 	auto pck = d.fs.open(PckFilename);
@@ -331,7 +338,8 @@ static sp<PaletteImage> loadStrategy(IFile &file)
 	return img;
 }
 
-sp<ImageSet> PCKLoader::loadStrat(Data &data, UString PckFilename, UString TabFilename)
+static sp<ImageSet> decodeStrat(Data &data, const UString &PckFilename,
+                                const UString &TabFilename)
 {
 	auto imageSet = mksp<ImageSet>();
 	auto tabFile = data.fs.open(TabFilename);
@@ -408,6 +416,7 @@ static sp<PaletteImage> loadShadowImage(IFile &file, uint8_t shadedIdx)
 	}
 	auto img = mksp<PaletteImage>(Vec2<int>{header.width, header.height});
 	PaletteImageLock region(img);
+	auto *indices = reinterpret_cast<uint8_t *>(region.getData());
 
 	uint8_t b = 0;
 	file.read(reinterpret_cast<char *>(&b), 1);
@@ -429,22 +438,24 @@ static sp<PaletteImage> loadShadowImage(IFile &file, uint8_t shadedIdx)
 		{
 			LogAssert(idx < 7);
 
-			while (count--)
+			uint8_t pattern[4];
+			for (int i = 0; i < 4; i++)
+				pattern[i] = ditherLut[idx][i] ? shadedIdx : 0;
+			// Runs start on a multiple of 4, as does the stride, so the part of a run on every row
+			// starts at the beginning of the pattern
+			const int STRIDE = 640;
+			int end = pos + count * 4;
+			while (pos < end)
 			{
-				for (int i = 0; i < 4; i++)
+				int x = pos % STRIDE;
+				int y = pos / STRIDE;
+				int rowEnd = std::min(end, pos + STRIDE - x);
+				if (x < header.width && y < header.height)
 				{
-					const int STRIDE = 640;
-					int x = pos % STRIDE;
-					int y = pos / STRIDE;
-					if (x < header.width && y < header.height)
-					{
-						if (ditherLut[idx][i])
-							region.set({x, y}, shadedIdx);
-						else
-							region.set({x, y}, 0);
-					}
-					pos++;
+					fillRepeating(indices + y * header.width + x,
+					              std::min(rowEnd - pos, header.width - x), pattern);
 				}
+				pos = rowEnd;
 			}
 		}
 		file.read(reinterpret_cast<char *>(&b), 1);
@@ -457,8 +468,8 @@ static sp<PaletteImage> loadShadowImage(IFile &file, uint8_t shadedIdx)
 	return img;
 }
 
-sp<ImageSet> PCKLoader::loadShadow(Data &data, UString PckFilename, UString TabFilename,
-                                   unsigned shadedIdx)
+static sp<ImageSet> decodeShadow(Data &data, const UString &PckFilename,
+                                 const UString &TabFilename, unsigned shadedIdx)
 {
 	TRACE_FN;
 	auto imageSet = mksp<ImageSet>();
@@ -508,4 +519,267 @@ sp<ImageSet> PCKLoader::loadShadow(Data &data, UString PckFilename, UString TabF
 	return imageSet;
 }
 
+// Decoded sets are kept in files holding a PckCacheHeader, the name of what was decoded, a
+// PckCacheEntry for every image and then the palette indices of every image one after the other.
+// A file is only used while the PCK and TAB files it came from keep the same size
+static ConfigOptionString
+    cacheDirOption("Framework.Data", "PCKCache",
+                   "Directory to keep decoded PCK image sets in so they load without decoding "
+                   "again, none if empty");
+
+static const uint32_t PCK_CACHE_MAGIC = 0x4350414f; // "OAPC"
+static const uint32_t PCK_CACHE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct PckCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t pckSize;
+	uint64_t tabSize;
+	uint32_t nameLength;
+	uint32_t imageCount;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+};
+#pragma pack(pop)
+static_assert(sizeof(struct PckCacheHeader) == 40, "PckCacheHeader not 40 bytes");
+
+#pragma pack(push, 1)
+struct PckCacheEntry
+{
+	// A width of 0 is a missing image
+	uint32_t width;
+	uint32_t height;
+	uint32_t bounds[4];
+	uint32_t indexInSet;
+	uint64_t offset;
+};
+#pragma pack(pop)
+static_assert(sizeof(struct PckCacheEntry) == 36, "PckCacheEntry not 36 bytes");
+
+static fs::path getCachePath(const UString &name)
+{
+	auto fileName = name.str();
+	for (auto &c : fileName)
+	{
+		if (!isalnum(static_cast<unsigned char>(c)))
+		{
+			c = '_';
+		}
+	}
+	return fs::path(cacheDirOption.get().str()) / (fileName + ".oapck");
+}
+
+static sp<ImageSet> readCachedSet(const UString &name, uint64_t pckSize, uint64_t tabSize)
+{
+	std::ifstream file(getCachePath(name).string(), std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return nullptr;
+	}
+	size_t fileSize = file.tellg();
+	file.seekg(0);
+	std::vector<char> contents(fileSize);
+	if (!file.read(contents.data(), fileSize))
+	{
+		LogWarning("Failed to read cached \"%s\"", name);
+		return nullptr;
+	}
+
+	PckCacheHeader header;
+	if (fileSize < sizeof(header))
+	{
+		return nullptr;
+	}
+	memcpy(&header, contents.data(), sizeof(header));
+	size_t position = sizeof(header);
+	if (header.magic != PCK_CACHE_MAGIC || header.version != PCK_CACHE_VERSION ||
+	    header.pckSize != pckSize || header.tabSize != tabSize ||
+	    header.nameLength != name.str().size() || header.nameLength > fileSize - position ||
+	    (fileSize - position - header.nameLength) / sizeof(PckCacheEntry) < header.imageCount ||
+	    name.str().compare(0, std::string::npos, contents.data() + position, header.nameLength))
+	{
+		LogInfo("Cached \"%s\" is out of date", name);
+		return nullptr;
+	}
+	position += header.nameLength;
+
+	auto imageSet = mksp<ImageSet>();
+	imageSet->maxSize = {header.maxWidth, header.maxHeight};
+	imageSet->images.resize(header.imageCount);
+	for (unsigned int i = 0; i < header.imageCount; i++)
+	{
+		PckCacheEntry entry;
+		memcpy(&entry, contents.data() + position, sizeof(entry));
+		position += sizeof(entry);
+		if (entry.width == 0)
+		{
+			continue;
+		}
+		uint64_t pixels = static_cast<uint64_t>(entry.width) * entry.height;
+		if (entry.offset > fileSize || pixels > fileSize - entry.offset)
+		{
+			LogWarning("Cached \"%s\" is truncated", name);
+			return nullptr;
+		}
+		auto img = mksp<PaletteImage>(Vec2<unsigned int>{entry.width, entry.height});
+		{
+			PaletteImageLock l(img, ImageLockUse::Write);
+			memcpy(l.getData(), contents.data() + entry.offset, pixels);
+		}
+		img->bounds = {entry.bounds[0], entry.bounds[1], entry.bounds[2], entry.bounds[3]};
+		img->indexInSet = entry.indexInSet;
+		img->owningSet = imageSet;
+		imageSet->images[i] = img;
+	}
+	LogInfo("Loaded %u images from cached \"%s\"", header.imageCount, name);
+	return imageSet;
+}
+
+static void writeCachedSet(const UString &name, uint64_t pckSize, uint64_t tabSize,
+                           const ImageSet &imageSet)
+{
+	PckCacheHeader header;
+	header.magic = PCK_CACHE_MAGIC;
+	header.version = PCK_CACHE_VERSION;
+	header.pckSize = pckSize;
+	header.tabSize = tabSize;
+	header.nameLength = name.str().size();
+	header.imageCount = imageSet.images.size();
+	header.maxWidth = imageSet.maxSize.x;
+	header.maxHeight = imageSet.maxSize.y;
+
+	std::vector<PckCacheEntry> entries(imageSet.images.size());
+	uint64_t offset = sizeof(header) + header.nameLength + entries.size() * sizeof(PckCacheEntry);
+	for (unsigned int i = 0; i < imageSet.images.size(); i++)
+	{
+		auto &entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		auto img = std::dynamic_pointer_cast<PaletteImage>(imageSet.images[i]);
+		if (!img)
+		{
+			continue;
+		}
+		entry.width = img->size.x;
+		entry.height = img->size.y;
+		entry.bounds[0] = img->bounds.p0.x;
+		entry.bounds[1] = img->bounds.p0.y;
+		entry.bounds[2] = img->bounds.p1.x;
+		entry.bounds[3] = img->bounds.p1.y;
+		entry.indexInSet = img->indexInSet;
+		entry.offset = offset;
+		offset += static_cast<uint64_t>(entry.width) * entry.height;
+	}
+
+	auto path = getCachePath(name);
+	// Written under another name first, so a file cut short never looks like a whole one
+	auto partPath = path;
+	partPath += ".part";
+	try
+	{
+		fs::create_directories(path.parent_path());
+		{
+			std::ofstream file(partPath.string(), std::ios::binary);
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			file.write(name.cStr(), header.nameLength);
+			file.write(reinterpret_cast<const char *>(entries.data()),
+			           entries.size() * sizeof(PckCacheEntry));
+			for (auto &image : imageSet.images)
+			{
+				auto img = std::dynamic_pointer_cast<PaletteImage>(image);
+				if (img)
+				{
+					PaletteImageLock l(img, ImageLockUse::Read);
+					file.write(static_cast<const char *>(l.getData()), img->size.x * img->size.y);
+				}
+			}
+			if (!file)
+			{
+				LogWarning("Failed to write cached \"%s\" to \"%s\"", name, partPath.string());
+				return;
+			}
+		}
+		fs::remove(path);
+		fs::rename(partPath, path);
+	}
+	catch (fs::filesystem_error &e)
+	{
+		LogWarning("Failed to write cached \"%s\": \"%s\"", name, e.what());
+		return;
+	}
+	LogInfo("Cached \"%s\" in \"%s\"", name, path.string());
+}
+
+// Returns the set cached as name if there is one for the PCK and TAB files as they are now, else
+// the one decode() returns, which is then cached
+template <typename Decode>
+static sp<ImageSet> loadThroughCache(Data &data, const UString &name, const UString &PckFilename,
+                                     const UString &TabFilename, Decode decode)
+{
+	if (cacheDirOption.get().empty())
+	{
+		return decode();
+	}
+	uint64_t pckSize = 0, tabSize = 0;
+	{
+		auto pckFile = data.fs.open(PckFilename);
+		auto tabFile = data.fs.open(TabFilename);
+		if (!pckFile || !tabFile)
+		{
+			return decode();
+		}
+		pckSize = pckFile.size();
+		tabSize = tabFile.size();
+	}
+	if (auto imageSet = readCachedSet(name, pckSize, tabSize))
+	{
+		return imageSet;
+	}
+	auto imageSet = decode();
+	if (imageSet)
+	{
+		writeCachedSet(name, pckSize, tabSize, *imageSet);
+	}
+	return imageSet;
+}
+
+// Sprites of packs are only drawn, so they can be packed once the renderer has them
+static sp<ImageSet> packOnUpload(sp<ImageSet> imageSet)
+{
+	if (imageSet)
+	{
+		for (auto &image : imageSet->images)
+		{
+			if (auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(image))
+			{
+				paletteImage->packOnUpload = true;
+			}
+		}
+	}
+	return imageSet;
+}
+
+sp<ImageSet> PCKLoader::load(Data &data, UString PckFilename, UString TabFilename)
+{
+	return packOnUpload(
+	    loadThroughCache(data, format("PCK:%s:%s", PckFilename, TabFilename), PckFilename,
+	                     TabFilename, [&] { return decodePck(data, PckFilename, TabFilename); }));
+}
+
+sp<ImageSet> PCKLoader::loadStrat(Data &data, UString PckFilename, UString TabFilename)
+{
+	return packOnUpload(
+	    loadThroughCache(data, format("PCKSTRAT:%s:%s", PckFilename, TabFilename), PckFilename,
+	                     TabFilename, [&] { return decodeStrat(data, PckFilename, TabFilename); }));
+}
+
+sp<ImageSet> PCKLoader::loadShadow(Data &data, UString PckFilename, UString TabFilename,
+                                   unsigned shadedIdx)
+{
+	return packOnUpload(loadThroughCache(
+	    data, format("PCKSHADOW:%s:%s:%u", PckFilename, TabFilename, shadedIdx), PckFilename,
+	    TabFilename, [&] { return decodeShadow(data, PckFilename, TabFilename, shadedIdx); }));
+}
+
 }; // namespace OpenApoc
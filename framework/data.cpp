@@ -6,17 +6,21 @@
 #include "framework/apocresources/rawimage.h"
 #include "framework/configfile.h"
 #include "framework/filesystem.h"
+#include "framework/framework.h"
 #include "framework/image.h"
 #include "framework/imageloader_interface.h"
 #include "framework/logger.h"
+#include "framework/metrics.h"
 #include "framework/musicloader_interface.h"
 #include "framework/palette.h"
 #include "framework/sampleloader_interface.h"
 #include "framework/trace.h"
 #include "framework/video.h"
+#include "library/resourcecache.h"
 #include "library/sp.h"
 #include "library/strings.h"
 #include "library/voxel.h"
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <mutex>
@@ -27,54 +31,168 @@ using namespace OpenApoc;
 namespace OpenApoc
 {
 
-ConfigOptionInt imageCacheSize("Framework.Data", "ImageCacheSize",
-                               "Number of Images to keep in data cache", 100);
-ConfigOptionInt imageSetCacheSize("Framework.Data", "ImageSetCacheSize",
-                                  "Number of ImageSets to keep in data cache", 10);
-ConfigOptionInt voxelCacheSize("Framework.Data", "VoxelCacheSize",
-                               "Number of VoxelMaps to keep in data cache", 1);
-ConfigOptionInt fontStringCacheSize("Framework.Data", "FontStringCacheSize",
-                                    "Number of rendered font stings to keep in data cache", 100);
-ConfigOptionInt paletteCacheSize("Framework.Data", "PaletteCacheSize",
-                                 "Number of Palettes to keep in data cache", 10);
+ConfigOptionInt cacheBudget(
+    "Framework.Data", "CacheBudget",
+    "MiB of images, image sets, voxels and palettes to keep in data cache once unused", 64);
+
+namespace
+{
+
+MetricGauge imagesKept("Data cache KiB", "images");
+MetricGauge imageSetsKept("Data cache KiB", "imagesets");
+MetricGauge lofTempsKept("Data cache KiB", "loftemps");
+MetricGauge palettesKept("Data cache KiB", "palettes");
+MetricGauge imageHitRate("Data cache hit %", "images");
+MetricGauge imageSetHitRate("Data cache hit %", "imagesets");
+MetricGauge lofTempsHitRate("Data cache hit %", "loftemps");
+MetricGauge paletteHitRate("Data cache hit %", "palettes");
+MetricGauge sampleHitRate("Data cache hit %", "samples");
+
+long long hitPercent(unsigned long long hits, unsigned long long misses)
+{
+	auto uses = hits + misses;
+	return uses ? static_cast<long long>(100 * hits / uses) : 0;
+}
+
+size_t getImageBytes(const Image &image)
+{
+	size_t pixels = image.size.x * image.size.y;
+	if (dynamic_cast<const PaletteImage *>(&image))
+	{
+		return pixels;
+	}
+	return pixels * sizeof(Colour);
+}
+
+size_t getImageSetBytes(const ImageSet &imageSet)
+{
+	size_t bytes = 0;
+	for (auto &image : imageSet.images)
+	{
+		if (image)
+		{
+			bytes += getImageBytes(*image);
+		}
+	}
+	return bytes;
+}
+
+size_t getLOFTempsBytes(const LOFTemps &lofTemps) { return lofTemps.getBytes(); }
+
+size_t getPaletteBytes(const Palette &palette) { return palette.colours.size() * sizeof(Colour); }
+
+class DataPrefetchImpl final : public DataPrefetch
+{
+  private:
+	Data &data;
+	std::vector<UString> paths;
+	std::vector<sp<Image>> images;
+	std::vector<bool> loaded;
+	size_t loadedCount = 0;
+	mutable std::mutex mutex;
+
+  public:
+	DataPrefetchImpl(Data &data, const std::vector<UString> &paths)
+	    : data(data), paths(paths), images(paths.size()), loaded(paths.size(), false)
+	{
+	}
+
+	// Loads the image at index unless that has been done already, from any thread
+	void load(size_t index)
+	{
+		{
+			std::lock_guard<std::mutex> l(this->mutex);
+			if (this->loaded[index])
+			{
+				return;
+			}
+		}
+		auto image = this->data.loadImage(this->paths[index]);
+		{
+			std::lock_guard<std::mutex> l(this->mutex);
+			if (this->loaded[index])
+			{
+				return;
+			}
+			this->images[index] = image;
+			this->loaded[index] = true;
+			this->loadedCount++;
+		}
+		// Prefetched images are about to be drawn, so get them ready for that as well
+		if (auto framework = Framework::tryGetInstance())
+		{
+			framework->frameQueueUpload(image);
+		}
+	}
+
+	bool isDone() const override
+	{
+		std::lock_guard<std::mutex> l(this->mutex);
+		return this->loadedCount == this->paths.size();
+	}
+
+	void wait() override
+	{
+		for (size_t index = 0; index < this->paths.size(); index++)
+		{
+			this->load(index);
+		}
+	}
+};
+
+class PrefetchRequest
+{
+  public:
+	PrefetchPriority priority;
+	// Earlier requests of the same priority go first
+	unsigned long long order;
+	wp<DataPrefetchImpl> prefetch;
+	size_t index;
+
+	bool operator<(const PrefetchRequest &other) const
+	{
+		if (this->priority != other.priority)
+		{
+			return this->priority < other.priority;
+		}
+		return this->order > other.order;
+	}
+};
+
+} // anonymous namespace
 
 class DataImpl final : public Data
 {
 
   private:
-	std::map<UString, std::weak_ptr<Image>> imageCache;
-	std::map<UString, std::weak_ptr<Image>> imageCacheLazy;
+	// The caches are used by the loading threads and the render thread at once. Whatever was used
+	// last from them is kept open, up to 'cacheBudget' MiB between them
+	ResourceCacheBudget budget;
+	ResourceCache<Image> imageCache;
 	std::map<UString, UString> imageAliases;
-	std::recursive_mutex imageCacheLock;
-	std::map<UString, std::weak_ptr<ImageSet>> imageSetCache;
+	ResourceCache<ImageSet> imageSetCache;
 	std::map<UString, UString> imageSetAliases;
-	std::recursive_mutex imageSetCacheLock;
 
-	std::map<UString, std::weak_ptr<Sample>> sampleCache;
+	ResourceCache<Sample> sampleCache;
 	std::map<UString, UString> sampleAliases;
-	std::recursive_mutex sampleCacheLock;
-	std::map<UString, std::weak_ptr<MusicTrack>> musicCache;
 	std::map<UString, UString> musicAliases;
 	std::recursive_mutex musicCacheLock;
-	std::map<UString, std::weak_ptr<LOFTemps>> LOFVoxelCache;
+	ResourceCache<LOFTemps> LOFVoxelCache;
 	std::map<UString, UString> voxelAliases;
-	std::recursive_mutex voxelCacheLock;
+	// Slices with the same contents are only kept once, whichever file they came from
+	VoxelPool voxelPool;
+	std::mutex voxelPoolLock;
 
-	std::map<UString, std::weak_ptr<Palette>> paletteCache;
+	ResourceCache<Palette> paletteCache;
 	std::map<UString, UString> paletteAliases;
-	std::recursive_mutex paletteCacheLock;
-
-	// The cache is organised in <font name , <text, image>>
-	std::map<UString, std::map<UString, std::weak_ptr<PaletteImage>>> fontStringCache;
-	std::recursive_mutex fontStringCacheLock;
-
-	// Pin open 'imageCacheSize' images
-	std::queue<sp<Image>> pinnedImages;
-	// Pin open 'imageSetCacheSize' image sets
-	std::queue<sp<ImageSet>> pinnedImageSets;
-	std::queue<sp<LOFTemps>> pinnedLOFVoxels;
-	std::queue<sp<PaletteImage>> pinnedFontStrings;
-	std::queue<sp<Palette>> pinnedPalettes;
+	// Guards the alias maps, other than the music ones which musicCacheLock does
+	std::mutex aliasLock;
+
+	// Every image of a live prefetch not started on yet, the next to load on top
+	std::priority_queue<PrefetchRequest> prefetchQueue;
+	unsigned long long prefetchOrder = 0;
+	std::mutex prefetchLock;
+
 	std::list<std::unique_ptr<ImageLoader>> imageLoaders;
 	std::list<std::unique_ptr<SampleLoader>> sampleLoaders;
 	std::list<std::unique_ptr<MusicLoader>> musicLoaders;
@@ -87,10 +205,23 @@ class DataImpl final : public Data
 
 	void readAliases();
 	void readAliasFile(const UString &path);
+	// Returns what path is an alias for, or an empty string if it is not one
+	UString getAlias(const std::map<UString, UString> &aliases, const UString &path);
+
+	// Load the resource at path, without looking in or adding to the caches
+	sp<Image> readImage(const UString &path);
+	sp<ImageSet> readImageSet(const UString &path);
+	sp<Sample> readSample(const UString &path);
+	sp<Palette> readPalette(const UString &path);
+	// Sets the metrics of what every cache keeps and how often it had what was asked for, which
+	// is done whenever something is loaded, as that is when they change the most
+	void recordCacheUse();
+	// Loads the image on top of prefetchQueue, run once for every image queued
+	void prefetchNext();
 
   public:
 	DataImpl(std::vector<UString> paths);
-	~DataImpl() override = default;
+	~DataImpl() override;
 
 	sp<Sample> loadSample(UString path) override;
 	sp<MusicTrack> loadMusic(const UString &path) override;
@@ -99,6 +230,8 @@ class DataImpl final : public Data
 	sp<Palette> loadPalette(const UString &path) override;
 	sp<VoxelSlice> loadVoxelSlice(const UString &path) override;
 	sp<Video> loadVideo(const UString &path) override;
+	sp<DataPrefetch> prefetch(const std::vector<UString> &paths,
+	                          PrefetchPriority priority = PrefetchPriority::Normal) override;
 
 	void addSampleAlias(const UString &name, const UString &value) override;
 	void addMusicAlias(const UString &name, const UString &value) override;
@@ -107,17 +240,15 @@ class DataImpl final : public Data
 	void addPaletteAlias(const UString &name, const UString &value) override;
 	void addVoxelSliceAlias(const UString &name, const UString &value) override;
 
-	sp<PaletteImage> getFontStringCacheEntry(const UString &font_name,
-	                                         const UString &text) override;
-	void putFontStringCacheEntry(const UString &font_name, const UString &text,
-	                             sp<PaletteImage> &img) override;
-
 	bool writeImage(UString systemPath, sp<Image> image, sp<Palette> palette = nullptr) override;
 };
 
 Data *Data::createData(std::vector<UString> paths) { return new DataImpl(paths); }
 
-DataImpl::DataImpl(std::vector<UString> paths) : Data(paths)
+DataImpl::DataImpl(std::vector<UString> paths)
+    : Data(paths), budget(static_cast<size_t>(std::max(0, cacheBudget.get())) * 1024 * 1024),
+      imageCache(&budget, getImageBytes), imageSetCache(&budget, getImageSetBytes),
+      LOFVoxelCache(&budget, getLOFTempsBytes), paletteCache(&budget, getPaletteBytes)
 {
 	registeredImageBackends["lodepng"].reset(getLodePNGImageLoaderFactory());
 	registeredImageBackends["pcx"].reset(getPCXImageLoaderFactory());
@@ -176,31 +307,54 @@ DataImpl::DataImpl(std::vector<UString> paths) : Data(paths)
 		else
 			LogWarning("Failed to load music loader %s", t);
 	}
-	for (int i = 0; i < imageCacheSize.get(); i++)
-		pinnedImages.push(nullptr);
-	for (int i = 0; i < imageSetCacheSize.get(); i++)
-		pinnedImageSets.push(nullptr);
-	for (int i = 0; i < voxelCacheSize.get(); i++)
-		pinnedLOFVoxels.push(nullptr);
-	for (int i = 0; i < fontStringCacheSize.get(); i++)
-		pinnedFontStrings.push(nullptr);
-	for (int i = 0; i < paletteCacheSize.get(); i++)
-		pinnedPalettes.push(nullptr);
-
 	this->readAliases();
 }
 
+DataImpl::~DataImpl()
+{
+	auto logCache = [](const char *name, unsigned long long hits, unsigned long long misses,
+	                   size_t keptBytes) {
+		auto uses = hits + misses;
+		LogInfo("%s cache: %llu hits, %llu misses (%.1f%% hit rate), %zu KiB kept", name, hits,
+		        misses, uses ? 100.0 * hits / uses : 0.0, keptBytes / 1024);
+	};
+	logCache("Image", imageCache.getHits(), imageCache.getMisses(), imageCache.getKeptBytes());
+	logCache("ImageSet", imageSetCache.getHits(), imageSetCache.getMisses(),
+	         imageSetCache.getKeptBytes());
+	logCache("LOFTemps", LOFVoxelCache.getHits(), LOFVoxelCache.getMisses(),
+	         LOFVoxelCache.getKeptBytes());
+	logCache("Palette", paletteCache.getHits(), paletteCache.getMisses(),
+	         paletteCache.getKeptBytes());
+	logCache("Sample", sampleCache.getHits(), sampleCache.getMisses(), 0);
+}
+
+void DataImpl::recordCacheUse()
+{
+	if (!Metrics::enabled)
+	{
+		return;
+	}
+	imagesKept.set(imageCache.getKeptBytes() / 1024);
+	imageSetsKept.set(imageSetCache.getKeptBytes() / 1024);
+	lofTempsKept.set(LOFVoxelCache.getKeptBytes() / 1024);
+	palettesKept.set(paletteCache.getKeptBytes() / 1024);
+	imageHitRate.set(hitPercent(imageCache.getHits(), imageCache.getMisses()));
+	imageSetHitRate.set(hitPercent(imageSetCache.getHits(), imageSetCache.getMisses()));
+	lofTempsHitRate.set(hitPercent(LOFVoxelCache.getHits(), LOFVoxelCache.getMisses()));
+	paletteHitRate.set(hitPercent(paletteCache.getHits(), paletteCache.getMisses()));
+	sampleHitRate.set(hitPercent(sampleCache.getHits(), sampleCache.getMisses()));
+}
+
 sp<VoxelSlice> DataImpl::loadVoxelSlice(const UString &path)
 {
-	std::lock_guard<std::recursive_mutex> l(this->voxelCacheLock);
 	if (path == "")
 		return nullptr;
 
-	auto alias = this->voxelAliases.find(path);
-	if (alias != this->voxelAliases.end())
+	auto alias = this->getAlias(this->voxelAliases, path);
+	if (!alias.empty())
 	{
-		LogInfo("Using alias \"%s\" for \"%s\"", path, alias->second);
-		return this->loadVoxelSlice(alias->second);
+		LogInfo("Using alias \"%s\" for \"%s\"", path, alias);
+		return this->loadVoxelSlice(alias);
 	}
 
 	sp<VoxelSlice> slice;
@@ -218,9 +372,7 @@ sp<VoxelSlice> DataImpl::loadVoxelSlice(const UString &path)
 		// Cut off the index to get the LOFTemps file
 		UString cacheKey = splitString[0] + splitString[1] + splitString[2];
 		cacheKey = cacheKey.toUpper();
-		sp<LOFTemps> lofTemps = this->LOFVoxelCache[cacheKey].lock();
-		if (!lofTemps)
-		{
+		sp<LOFTemps> lofTemps = this->LOFVoxelCache.get(cacheKey, [&]() -> sp<LOFTemps> {
 			TRACE_FN_ARGS1("path", path);
 			auto datFile = this->fs.open(splitString[1]);
 			if (!datFile)
@@ -234,10 +386,12 @@ sp<VoxelSlice> DataImpl::loadVoxelSlice(const UString &path)
 				LogError("Failed to open LOFTemps tab file \"%s\"", splitString[2]);
 				return nullptr;
 			}
-			lofTemps = mksp<LOFTemps>(datFile, tabFile);
-			this->LOFVoxelCache[cacheKey] = lofTemps;
-			this->pinnedLOFVoxels.push(lofTemps);
-			this->pinnedLOFVoxels.pop();
+			return mksp<LOFTemps>(datFile, tabFile);
+		});
+		this->recordCacheUse();
+		if (!lofTemps)
+		{
+			return nullptr;
 		}
 		int idx = Strings::toInteger(splitString[3]);
 		slice = lofTemps->getSlice(idx);
@@ -274,28 +428,33 @@ sp<VoxelSlice> DataImpl::loadVoxelSlice(const UString &path)
 		LogError("Failed to load VoxelSlice \"%s\"", path);
 		return nullptr;
 	}
-	slice->path = path;
+	{
+		std::lock_guard<std::mutex> l(this->voxelPoolLock);
+		slice = this->voxelPool.intern(slice);
+		slice->path = path;
+	}
 	return slice;
 }
 
 sp<ImageSet> DataImpl::loadImageSet(const UString &path)
 {
-	std::lock_guard<std::recursive_mutex> l(this->imageSetCacheLock);
-
-	auto alias = this->imageSetAliases.find(path);
-	if (alias != this->imageSetAliases.end())
+	auto alias = this->getAlias(this->imageSetAliases, path);
+	if (!alias.empty())
 	{
-		LogInfo("Using alias \"%s\" for \"%s\"", path, alias->second);
-		return this->loadImageSet(alias->second);
+		LogInfo("Using alias \"%s\" for \"%s\"", path, alias);
+		return this->loadImageSet(alias);
 	}
 
-	UString cacheKey = path.toUpper();
-	sp<ImageSet> imgSet = this->imageSetCache[cacheKey].lock();
-	if (imgSet)
-	{
-		return imgSet;
-	}
+	auto imgSet =
+	    this->imageSetCache.get(path.toUpper(), [this, &path] { return readImageSet(path); });
+	this->recordCacheUse();
+	return imgSet;
+}
+
+sp<ImageSet> DataImpl::readImageSet(const UString &path)
+{
 	TRACE_FN_ARGS1("path", path);
+	sp<ImageSet> imgSet;
 	// Raw resources come in the format:
 	//"RAW:PATH:WIDTH:HEIGHT[:optional/ignored]"
 	if (path.substr(0, 4) == "RAW:")
@@ -328,31 +487,26 @@ sp<ImageSet> DataImpl::loadImageSet(const UString &path)
 		return nullptr;
 	}
 
-	this->pinnedImageSets.push(imgSet);
-	this->pinnedImageSets.pop();
-
-	this->imageSetCache[cacheKey] = imgSet;
 	imgSet->path = path;
 	return imgSet;
 }
 
 sp<Sample> DataImpl::loadSample(UString path)
 {
-	std::lock_guard<std::recursive_mutex> l(this->sampleCacheLock);
-
-	auto alias = this->sampleAliases.find(path);
-	if (alias != this->sampleAliases.end())
+	auto alias = this->getAlias(this->sampleAliases, path);
+	if (!alias.empty())
 	{
-		LogInfo("Using alias \"%s\" for \"%s\"", path, alias->second);
-		return this->loadSample(alias->second);
+		LogInfo("Using alias \"%s\" for \"%s\"", path, alias);
+		return this->loadSample(alias);
 	}
 
-	UString cacheKey = path.toUpper();
-	sp<Sample> sample = this->sampleCache[cacheKey].lock();
-	if (sample)
-		return sample;
+	return this->sampleCache.get(path.toUpper(), [this, &path] { return readSample(path); });
+}
 
+sp<Sample> DataImpl::readSample(const UString &path)
+{
 	TRACE_FN_ARGS1("path", path);
+	sp<Sample> sample;
 	for (auto &loader : this->sampleLoaders)
 	{
 		sample = loader->loadSample(path);
@@ -364,7 +518,6 @@ sp<Sample> DataImpl::loadSample(UString path)
 		LogInfo("Failed to load sample \"%s\"", path);
 		return nullptr;
 	}
-	this->sampleCache[cacheKey] = sample;
 	sample->path = path;
 	return sample;
 }
@@ -396,42 +549,42 @@ sp<MusicTrack> DataImpl::loadMusic(const UString &path)
 
 sp<Image> DataImpl::loadImage(const UString &path, bool lazy)
 {
-	std::lock_guard<std::recursive_mutex> l(this->imageCacheLock);
 	if (path == "")
 	{
 		return nullptr;
 	}
 
-	auto alias = this->imageAliases.find(path);
-	if (alias != this->imageAliases.end())
+	auto alias = this->getAlias(this->imageAliases, path);
+	if (!alias.empty())
 	{
-		LogInfo("Using alias \"%s\" for \"%s\"", path, alias->second);
-		return this->loadImage(alias->second, lazy);
+		LogInfo("Using alias \"%s\" for \"%s\"", path, alias);
+		return this->loadImage(alias, lazy);
 	}
 
-	// Use an uppercase version of the path for the cache key
-	UString cacheKey = path.toUpper();
-	sp<Image> img;
 	// Don't cache lazy loading image wrappers, the image data when really loaded will go through
 	// the cache as normal, but we don't want to think we've loaded an image when it's just a lazy
 	// wrapper
-	if (!lazy)
-	{
-		img = this->imageCache[cacheKey].lock();
-	}
-	if (img)
+	if (lazy)
 	{
+		TRACE_FN_ARGS1("path", path);
+		sp<Image> img = mksp<LazyImage>();
+		img->path = path;
 		return img;
 	}
 
+	// Use an uppercase version of the path for the cache key
+	auto img = this->imageCache.get(path.toUpper(), [this, &path] { return readImage(path); });
+	this->recordCacheUse();
+	return img;
+}
+
+sp<Image> DataImpl::readImage(const UString &path)
+{
 	// Only trace stuff that misses the cache
 	TRACE_FN_ARGS1("path", path);
 
-	if (lazy)
-	{
-		img = mksp<LazyImage>();
-	}
-	else if (path.substr(0, 4) == "RAW:")
+	sp<Image> img;
+	if (path.substr(0, 4) == "RAW:")
 	{
 		auto splitString = path.split(':');
 		// Raw resources come in the format:
@@ -660,58 +813,43 @@ sp<Image> DataImpl::loadImage(const UString &path, bool lazy)
 		return nullptr;
 	}
 
-	this->pinnedImages.push(img);
-	this->pinnedImages.pop();
-
-	if (!lazy)
-	{
-		this->imageCache[cacheKey] = img;
-	}
 	img->path = path;
 	return img;
 }
 
 sp<Palette> DataImpl::loadPalette(const UString &path)
 {
-	std::lock_guard<std::recursive_mutex> l(this->paletteCacheLock);
 	if (path == "")
 	{
 		LogWarning("Invalid palette path");
 		return nullptr;
 	}
 
-	auto alias = this->paletteAliases.find(path);
-	if (alias != this->paletteAliases.end())
+	auto alias = this->getAlias(this->paletteAliases, path);
+	if (!alias.empty())
 	{
-		LogInfo("Using alias \"%s\" for \"%s\"", path, alias->second);
-		return this->loadPalette(alias->second);
+		LogInfo("Using alias \"%s\" for \"%s\"", path, alias);
+		return this->loadPalette(alias);
 	}
 
 	// Use an uppercase version of the path for the cache key
-	UString cacheKey = path.toUpper();
-
-	auto pal = this->paletteCache[cacheKey].lock();
-	if (pal)
-	{
-		return pal;
-	}
+	auto pal = this->paletteCache.get(path.toUpper(), [this, &path] { return readPalette(path); });
+	this->recordCacheUse();
+	return pal;
+}
 
-	pal = loadPCXPalette(*this, path);
+sp<Palette> DataImpl::readPalette(const UString &path)
+{
+	auto pal = loadPCXPalette(*this, path);
 	if (pal)
 	{
 		LogInfo("Read \"%s\" as PCX palette", path);
-		this->paletteCache[cacheKey] = pal;
-		this->pinnedPalettes.push(pal);
-		this->pinnedPalettes.pop();
 		return pal;
 	}
 	pal = loadPNGPalette(*this, path);
 	if (pal)
 	{
 		LogInfo("Read \"%s\" as PNG palette", path);
-		this->paletteCache[cacheKey] = pal;
-		this->pinnedPalettes.push(pal);
-		this->pinnedPalettes.pop();
 		return pal;
 	}
 
@@ -731,9 +869,6 @@ sp<Palette> DataImpl::loadPalette(const UString &path)
 			}
 		}
 		LogInfo("Read \"%s\" as Image palette", path);
-		this->paletteCache[cacheKey] = pal;
-		this->pinnedPalettes.push(pal);
-		this->pinnedPalettes.pop();
 		return p;
 	}
 
@@ -741,15 +876,53 @@ sp<Palette> DataImpl::loadPalette(const UString &path)
 	if (pal)
 	{
 		LogInfo("Read \"%s\" as RAW palette", path);
-		this->paletteCache[cacheKey] = pal;
-		this->pinnedPalettes.push(pal);
-		this->pinnedPalettes.pop();
 		return pal;
 	}
 	LogError("Failed to open palette \"%s\"", path);
 	return nullptr;
 }
 
+sp<DataPrefetch> DataImpl::prefetch(const std::vector<UString> &paths, PrefetchPriority priority)
+{
+	auto prefetch = mksp<DataPrefetchImpl>(*this, paths);
+	auto framework = Framework::tryGetInstance();
+	if (!framework)
+	{
+		prefetch->wait();
+		return prefetch;
+	}
+	{
+		std::lock_guard<std::mutex> l(this->prefetchLock);
+		for (size_t index = 0; index < paths.size(); index++)
+		{
+			this->prefetchQueue.push({priority, this->prefetchOrder++, prefetch, index});
+		}
+	}
+	for (size_t index = 0; index < paths.size(); index++)
+	{
+		framework->threadPoolTaskEnqueue([this] { this->prefetchNext(); });
+	}
+	return prefetch;
+}
+
+void DataImpl::prefetchNext()
+{
+	PrefetchRequest request;
+	{
+		std::lock_guard<std::mutex> l(this->prefetchLock);
+		if (this->prefetchQueue.empty())
+		{
+			return;
+		}
+		request = this->prefetchQueue.top();
+		this->prefetchQueue.pop();
+	}
+	if (auto prefetch = request.prefetch.lock())
+	{
+		prefetch->load(request.index);
+	}
+}
+
 sp<Video> DataImpl::loadVideo(const UString &path)
 {
 
@@ -850,45 +1023,9 @@ bool DataImpl::writeImage(UString systemPath, sp<Image> image, sp<Palette> palet
 	return false;
 }
 
-sp<PaletteImage> DataImpl::getFontStringCacheEntry(const UString &font_name, const UString &string)
-{
-	std::lock_guard<std::recursive_mutex> l(this->fontStringCacheLock);
-	if (font_name == "")
-	{
-		LogError("invalid font_name");
-		return nullptr;
-	}
-	if (string == "")
-	{
-		// LogWarning("Empty string");
-		return nullptr;
-	}
-	auto img = this->fontStringCache[font_name][string].lock();
-	return img;
-}
-
-void DataImpl::putFontStringCacheEntry(const UString &font_name, const UString &string,
-                                       sp<PaletteImage> &img)
-{
-	std::lock_guard<std::recursive_mutex> l(this->fontStringCacheLock);
-	if (font_name == "")
-	{
-		LogError("invalid font_name");
-		return;
-	}
-	if (string == "")
-	{
-		// LogWarning("Empty string");
-		return;
-	}
-	this->fontStringCache[font_name][string] = img;
-	this->pinnedFontStrings.push(img);
-	this->pinnedFontStrings.pop();
-}
-
 void DataImpl::addSampleAlias(const UString &name, const UString &value)
 {
-	std::lock_guard<std::recursive_mutex> l(this->sampleCacheLock);
+	std::lock_guard<std::mutex> l(this->aliasLock);
 	LogAssert(name != value);
 	auto current = this->sampleAliases.find(name);
 	if (current != this->sampleAliases.end() && current->second != value)
@@ -910,7 +1047,7 @@ void DataImpl::addMusicAlias(const UString &name, const UString &value)
 }
 void DataImpl::addImageAlias(const UString &name, const UString &value)
 {
-	std::lock_guard<std::recursive_mutex> l(this->imageCacheLock);
+	std::lock_guard<std::mutex> l(this->aliasLock);
 	LogAssert(name != value);
 	auto current = this->imageAliases.find(name);
 	if (current != this->imageAliases.end() && current->second != value)
@@ -921,7 +1058,7 @@ void DataImpl::addImageAlias(const UString &name, const UString &value)
 }
 void DataImpl::addImageSetAlias(const UString &name, const UString &value)
 {
-	std::lock_guard<std::recursive_mutex> l(this->imageSetCacheLock);
+	std::lock_guard<std::mutex> l(this->aliasLock);
 	LogAssert(name != value);
 	auto current = this->imageSetAliases.find(name);
 	if (current != this->imageSetAliases.end() && current->second != value)
@@ -932,7 +1069,7 @@ void DataImpl::addImageSetAlias(const UString &name, const UString &value)
 }
 void DataImpl::addPaletteAlias(const UString &name, const UString &value)
 {
-	std::lock_guard<std::recursive_mutex> l(this->paletteCacheLock);
+	std::lock_guard<std::mutex> l(this->aliasLock);
 	LogAssert(name != value);
 	auto current = this->paletteAliases.find(name);
 	if (current != this->paletteAliases.end() && current->second != value)
@@ -943,7 +1080,7 @@ void DataImpl::addPaletteAlias(const UString &name, const UString &value)
 }
 void DataImpl::addVoxelSliceAlias(const UString &name, const UString &value)
 {
-	std::lock_guard<std::recursive_mutex> l(this->voxelCacheLock);
+	std::lock_guard<std::mutex> l(this->aliasLock);
 	LogAssert(name != value);
 	auto current = this->voxelAliases.find(name);
 	if (current != this->voxelAliases.end() && current->second != value)
@@ -953,6 +1090,17 @@ void DataImpl::addVoxelSliceAlias(const UString &name, const UString &value)
 	this->voxelAliases[name] = value;
 }
 
+UString DataImpl::getAlias(const std::map<UString, UString> &aliases, const UString &path)
+{
+	std::lock_guard<std::mutex> l(this->aliasLock);
+	auto alias = aliases.find(path);
+	if (alias == aliases.end())
+	{
+		return "";
+	}
+	return alias->second;
+}
+
 void DataImpl::readAliases()
 {
 	auto aliasFiles = this->fs.enumerateDirectoryRecursive("aliases", ".alias");
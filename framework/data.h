@@ -18,6 +18,26 @@ class Video;
 class PaletteImage;
 class UString;
 
+enum class PrefetchPriority
+{
+	Low,
+	Normal,
+	High,
+};
+
+// Returned by Data::prefetch(). The images asked for stay loaded for as long as it is held, and
+// dropping it drops whichever of them have not been started on yet
+class DataPrefetch
+{
+  public:
+	virtual ~DataPrefetch() = default;
+	// True once every image has been loaded, or failed to
+	virtual bool isDone() const = 0;
+	// Loads whatever images are still to be loaded on the calling thread, and waits for the ones
+	// being loaded elsewhere
+	virtual void wait() = 0;
+};
+
 class Data
 {
   public:
@@ -34,6 +54,11 @@ class Data
 	virtual sp<Palette> loadPalette(const UString &path) = 0;
 	virtual sp<VoxelSlice> loadVoxelSlice(const UString &path) = 0;
 	virtual sp<Video> loadVideo(const UString &path) = 0;
+	// Starts loading the images at paths in the background, those of higher priority prefetches
+	// first. Loading one of them meanwhile waits for the load already going instead of starting
+	// another, so a LazyImage only waits if its image is not ready yet
+	virtual sp<DataPrefetch> prefetch(const std::vector<UString> &paths,
+	                                  PrefetchPriority priority = PrefetchPriority::Normal) = 0;
 
 	virtual void addSampleAlias(const UString &name, const UString &value) = 0;
 	virtual void addMusicAlias(const UString &name, const UString &value) = 0;
@@ -42,11 +67,6 @@ class Data
 	virtual void addPaletteAlias(const UString &name, const UString &value) = 0;
 	virtual void addVoxelSliceAlias(const UString &name, const UString &value) = 0;
 
-	virtual sp<PaletteImage> getFontStringCacheEntry(const UString &font_name,
-	                                                 const UString &text) = 0;
-	virtual void putFontStringCacheEntry(const UString &font_name, const UString &text,
-	                                     sp<PaletteImage> &img) = 0;
-
 	virtual bool writeImage(UString systemPath, sp<Image> image, sp<Palette> palette = nullptr) = 0;
 };
 
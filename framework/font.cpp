@@ -2,7 +2,9 @@
 #include "framework/data.h"
 #include "framework/framework.h"
 #include "framework/image.h"
+#include "framework/renderer.h"
 #include "library/sp.h"
+#include <vector>
 
 namespace OpenApoc
 {
@@ -15,11 +17,7 @@ sp<PaletteImage> BitmapFont::getString(const UString &Text)
 	int width = this->getFontWidth(Text);
 	int pos = 0;
 
-	auto img = fw().data->getFontStringCacheEntry(this->name, Text);
-	if (img)
-		return img;
-
-	img = mksp<PaletteImage>(Vec2<int>{width, height});
+	auto img = mksp<PaletteImage>(Vec2<int>{width, height});
 
 	for (const auto &c : Text)
 	{
@@ -28,19 +26,57 @@ sp<PaletteImage> BitmapFont::getString(const UString &Text)
 		pos += glyph->size.x;
 	}
 
-	fw().data->putFontStringCacheEntry(this->name, Text, img);
-
+	auto framework = Framework::tryGetInstance();
+	if (framework && framework->renderer)
+	{
+		framework->renderer->frameStats.fontStrings++;
+	}
 	return img;
 }
 
+void BitmapFont::drawString(const UString &Text, Vec2<float> position)
+{
+	// The glyphs are looked up in place rather than copied out with getGlyph(), and all drawn with
+	// one call, as a lot of text is drawn every frame
+	std::vector<RendererSprite> sprites;
+	sprites.reserve(Text.length());
+	for (const auto &c : Text)
+	{
+		auto glyph = fontbitmaps.find(c);
+		if (glyph == fontbitmaps.end())
+		{
+			this->getGlyph(c);
+			glyph = fontbitmaps.find(c);
+		}
+		auto &image = *glyph->second;
+		sprites.push_back({&image, position, {255, 255, 255, 255}});
+		position.x += image.size.x;
+	}
+	fw().renderer->frameStats.fontStrings++;
+	fw().renderer->drawSprites(sprites);
+}
+
+int BitmapFont::getGlyphWidth(UniChar codepoint)
+{
+	if (codepoint >= 128)
+	{
+		return this->getGlyph(codepoint)->size.x;
+	}
+	auto &width = asciiWidths[codepoint];
+	if (width == 0)
+	{
+		width = this->getGlyph(codepoint)->size.x;
+	}
+	return width;
+}
+
 int BitmapFont::getFontWidth(const UString &Text)
 {
 	int textlen = 0;
 
 	for (const auto &c : Text)
 	{
-		auto glyph = this->getGlyph(c);
-		textlen += glyph->size.x;
+		textlen += getGlyphWidth(c);
 	}
 	return textlen;
 }
@@ -49,8 +85,7 @@ int BitmapFont::getFontHeight() const { return fontheight; }
 
 int BitmapFont::getFontHeight(const UString &Text, int MaxWidth)
 {
-	std::list<UString> lines = wordWrapText(Text, MaxWidth);
-	return lines.size() * fontheight;
+	return getWrappedText(Text, MaxWidth).size() * fontheight;
 }
 
 UString BitmapFont::getName() const { return this->name; }
@@ -141,6 +176,22 @@ sp<BitmapFont> BitmapFont::loadFont(const std::map<UniChar, UString> &glyphMap,
 
 std::list<UString> BitmapFont::wordWrapText(const UString &Text, int MaxWidth)
 {
+	return getWrappedText(Text, MaxWidth);
+}
+
+const std::list<UString> &BitmapFont::getWrappedText(const UString &Text, int MaxWidth)
+{
+	WrapKey key{Text.str(), MaxWidth};
+	auto cached = wrappedTexts.find(key);
+	if (cached != wrappedTexts.end())
+	{
+		return cached->second;
+	}
+	if (wrappedTexts.size() >= MAX_WRAPPED_TEXTS)
+	{
+		wrappedTexts.clear();
+	}
+
 	int txtwidth;
 	std::list<UString> lines = Text.splitlist("\n");
 	std::list<UString> wrappedLines;
@@ -196,7 +247,9 @@ std::list<UString> BitmapFont::wordWrapText(const UString &Text, int MaxWidth)
 		}
 	}
 
-	return wrappedLines;
+	auto &entry = wrappedTexts[std::move(key)];
+	entry = std::move(wrappedLines);
+	return entry;
 }
 
 }; // namespace OpenApoc
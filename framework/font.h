@@ -2,7 +2,14 @@
 
 #include "library/sp.h"
 #include "library/strings.h"
+#include "library/vec.h"
+#include <cstddef>
+#include <functional>
+#include <list>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace OpenApoc
 {
@@ -16,14 +23,36 @@ class BitmapFont
 	int spacewidth;
 	int fontheight;
 	int averagecharacterwidth;
-	std::map<UniChar, sp<PaletteImage>> fontbitmaps;
+	std::unordered_map<UniChar, sp<PaletteImage>> fontbitmaps;
 	UString name;
 	sp<Palette> palette;
 
+	// Width of every ASCII glyph looked up so far, 0 where not looked up yet
+	int asciiWidths[128] = {};
+	int getGlyphWidth(UniChar codepoint);
+
+	// Text wrapped by wordWrapText, by text and width, as labels wrap theirs every time they are
+	// drawn. Thrown away whole once MAX_WRAPPED_TEXTS are kept
+	static const size_t MAX_WRAPPED_TEXTS = 512;
+	using WrapKey = std::pair<std::string, int>;
+	class WrapKeyHash
+	{
+	  public:
+		size_t operator()(const WrapKey &key) const
+		{
+			return std::hash<std::string>()(key.first) ^ ((size_t)key.second * 0x9e3779b9u);
+		}
+	};
+	std::unordered_map<WrapKey, std::list<UString>, WrapKeyHash> wrappedTexts;
+
   public:
 	virtual ~BitmapFont();
 	virtual sp<PaletteImage> getGlyph(UniChar codepoint);
+	// Makes a new image of Text, worth keeping when the same text is drawn over and over
 	virtual sp<PaletteImage> getString(const UString &Text);
+	// Draws Text with its top left corner at position, a glyph at a time, so no image is made
+	// and any text shares the glyphs already in the renderer's sprite sheet
+	virtual void drawString(const UString &Text, Vec2<float> position);
 	virtual int getFontWidth(const UString &Text);
 	virtual int getFontHeight() const;
 	virtual int getFontHeight(const UString &Text, int MaxWidth);
@@ -31,6 +60,8 @@ class BitmapFont
 	virtual int getEstimateCharacters(int FitInWidth) const;
 	virtual sp<Palette> getPalette() const;
 	std::list<UString> wordWrapText(const UString &Text, int MaxWidth);
+	// Same lines as wordWrapText, without copying them out, only good until text is next wrapped
+	const std::list<UString> &getWrappedText(const UString &Text, int MaxWidth);
 
 	/* Reads in set of "Character":"glyph description string" pairs */
 	static sp<BitmapFont> loadFont(const std::map<UniChar, UString> &charMap, int spaceWidth,
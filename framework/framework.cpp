@@ -1,19 +1,26 @@
 #include "framework/framework.h"
-#include "framework/ThreadPool/ThreadPool.h"
 #include "framework/apocresources/cursor.h"
 #include "framework/configfile.h"
 #include "framework/data.h"
 #include "framework/event.h"
 #include "framework/image.h"
+#include "framework/jobsystem.h"
+#include "framework/metrics.h"
 #include "framework/renderer.h"
 #include "framework/renderer_interface.h"
 #include "framework/sound_interface.h"
 #include "framework/stagestack.h"
+#include "framework/statsoverlay.h"
+#include "framework/threadedrenderer.h"
 #include "framework/trace.h"
 #include "library/sp.h"
 #include <SDL.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <map>
 #include <vector>
 
@@ -60,6 +67,12 @@ ConfigOptionString cdPathOption("Framework", "CD", "The path to the XCom:Apocaly
 ConfigOptionInt threadPoolSizeOption(
     "Framework", "ThreadPoolSize",
     "The number of threads to spawn for the threadpool (0 = queried num_cores)", 0);
+ConfigOptionInt uploadsPerFrameOption(
+    "Framework", "UploadsPerFrame",
+    "The most images loaded in the background to get ready for drawing each frame", 64);
+ConfigOptionBool renderThreadOption(
+    "Framework", "RenderThread",
+    "Draw and flip each frame on a thread of its own while the next one is updated", false);
 ConfigOptionString renderersOption("Framework", "Renderers",
                                    "':' separated list of renderer backends (in preference order)",
                                    RENDERERS);
@@ -244,6 +257,12 @@ ConfigOptionBool optionFuelCrashingVehicles("OpenApoc.NewFeature", "CrashingOutO
                                             "Vehicles crash when out of fuel", true);
 ConfigOptionBool optionSkipTurbo("OpenApoc.NewFeature", "SkipTurboMovement",
                                  "Skip turbo movement calculations", false);
+ConfigOptionBool optionShadowcastVision("OpenApoc.NewFeature", "ShadowcastVision",
+                                        "Units reveal exactly the tiles they see", false);
+ConfigOptionBool optionFixedUpdateRate("OpenApoc.NewFeature", "FixedUpdateRate",
+                                       "Game speed does not depend on frame rate", false);
+ConfigOptionBool optionCoarseTurbo("OpenApoc.NewFeature", "CoarseTurbo",
+                                   "Turbo moves vehicles far from yours coarsely", false);
 
 ConfigOptionBool optionStunHostileAction("OpenApoc.Mod", "StunHostileAction",
                                          "Stunning hurts relationships", false);
@@ -343,7 +362,13 @@ class FrameworkPrivate
 	Vec2<int> windowSize;
 
 	sp<Surface> scaleSurface;
-	up<ThreadPool> threadPool;
+	// The renderer, if it draws on a thread of its own
+	ThreadedRenderer *renderThread = nullptr;
+	up<JobSystem> jobSystem;
+	// Jobs queued by frameQueueJob() that the next frame waits for
+	JobCounter frameJobs;
+	std::mutex uploadsLock;
+	std::vector<sp<Image>> uploads;
 
 	FrameworkPrivate()
 	    : quitProgram(false), window(nullptr), context(0), displaySize(0, 0), windowSize(0, 0)
@@ -364,7 +389,7 @@ class FrameworkPrivate
 			LogInfo("Failed to get HW concurrency, falling back to pool size %d", threadPoolSize);
 		}
 
-		this->threadPool.reset(new ThreadPool(threadPoolSize));
+		this->jobSystem.reset(new JobSystem(threadPoolSize));
 	}
 };
 
@@ -492,7 +517,7 @@ Framework::~Framework()
 	// framework
 	audioShutdown();
 	LogInfo("Stopping threadpool");
-	p->threadPool.reset();
+	p->jobSystem.reset();
 	LogInfo("Clearing stages");
 	p->ProgramStages.clear();
 	LogInfo("Saving config");
@@ -536,17 +561,37 @@ void Framework::run(sp<Stage> initialStage)
 
 	this->renderer->setPalette(this->data->loadPalette("xcom3/ufodata/pal_06.dat"));
 
+	using Clock = std::chrono::steady_clock;
+	auto millisecondsSince = [](Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	};
+
 	while (!p->quitProgram)
 	{
 		frame++;
+		Trace::frame(frame);
+		Metrics::frame(frame);
 		TraceObj obj{"Frame", {{"frame", Strings::fromInteger(frame)}}};
+		FrameTimes frameTimes;
+
+		// The last frame's jobs ran alongside drawing and flipping it, and have to be done before
+		// anything that may depend on them, events included
+		auto partStart = Clock::now();
+		{
+			TraceObj jobsObj("Frame jobs");
+			p->jobSystem->wait(p->frameJobs);
+		}
+		frameTimes.jobs = millisecondsSince(partStart);
 
+		partStart = Clock::now();
 		processEvents();
+		frameTimes.events = millisecondsSince(partStart);
 
 		if (p->ProgramStages.isEmpty())
 		{
 			break;
 		}
+		partStart = Clock::now();
 		{
 			TraceObj updateObj("Update");
 			p->ProgramStages.current()->update();
@@ -583,6 +628,11 @@ void Framework::run(sp<Stage> initialStage)
 			}
 		}
 		stageCommands.clear();
+		frameTimes.update = millisecondsSince(partStart);
+
+		partStart = Clock::now();
+		uploadImages();
+		frameTimes.upload = millisecondsSince(partStart);
 
 		auto surface = p->scaleSurface ? p->scaleSurface : p->defaultSurface;
 		RendererSurfaceBinding b(*this->renderer, surface);
@@ -592,8 +642,10 @@ void Framework::run(sp<Stage> initialStage)
 		}
 		if (!p->ProgramStages.isEmpty())
 		{
+			partStart = Clock::now();
 			TraceObj updateObj("Render");
 			p->ProgramStages.current()->render();
+			this->statsOverlay->render(*this->renderer);
 			this->cursor->render();
 			if (p->scaleSurface)
 			{
@@ -602,12 +654,25 @@ void Framework::run(sp<Stage> initialStage)
 				this->renderer->clear();
 				this->renderer->drawScaled(p->scaleSurface, {0, 0}, p->windowSize);
 			}
+			frameTimes.render = millisecondsSince(partStart);
 			{
+				partStart = Clock::now();
 				TraceObj flipObj("Flip");
 				this->renderer->flush();
 				this->renderer->newFrame();
-				SDL_GL_SwapWindow(p->window);
+				if (p->renderThread)
+				{
+					// Only waits for the last frame, this one is flipped while the next updates
+					p->renderThread->submitFrame();
+				}
+				else
+				{
+					this->renderer->endFrameStats();
+					SDL_GL_SwapWindow(p->window);
+				}
+				frameTimes.flip = millisecondsSince(partStart);
 			}
+			this->statsOverlay->frameDone(frameTimes, this->renderer->lastFrameStats);
 		}
 		if (frameCount && frame == frameCount)
 		{
@@ -615,6 +680,37 @@ void Framework::run(sp<Stage> initialStage)
 			p->quitProgram = true;
 		}
 	}
+	p->jobSystem->wait(p->frameJobs);
+	if (p->renderThread)
+	{
+		p->renderThread->wait();
+	}
+	Metrics::finish();
+	std::lock_guard<std::mutex> l(p->uploadsLock);
+	p->uploads.clear();
+}
+
+void Framework::uploadImages()
+{
+	std::vector<sp<Image>> images;
+	{
+		std::lock_guard<std::mutex> l(p->uploadsLock);
+		if (p->uploads.empty())
+		{
+			return;
+		}
+		// The oldest first, the rest waiting for the next frames
+		size_t count = std::min(p->uploads.size(),
+		                        static_cast<size_t>(std::max(uploadsPerFrameOption.get(), 0)));
+		images.assign(p->uploads.begin(), p->uploads.begin() + count);
+		p->uploads.erase(p->uploads.begin(), p->uploads.begin() + count);
+	}
+	if (images.empty())
+	{
+		return;
+	}
+	TraceObj obj("Upload", {{"images", Strings::fromInteger(static_cast<int>(images.size()))}});
+	this->renderer->preload(images);
 }
 
 void Framework::processEvents()
@@ -645,17 +741,38 @@ void Framework::processEvents()
 		this->cursor->eventOccured(e.get());
 		if (e->type() == EVENT_KEY_DOWN)
 		{
+			if (e->keyboard().KeyCode == SDLK_SCROLLLOCK && this->statsOverlay)
+			{
+				this->statsOverlay->toggle();
+			}
 			if (e->keyboard().KeyCode == SDLK_PRINTSCREEN)
 			{
 				UString screenshotName = "screenshot.png";
 				LogWarning("Writing screenshot to \"%s\"", screenshotName);
-				if (!p->defaultSurface->rendererPrivateData)
+				bool drawn = false;
+				sp<Image> img;
+				// Renderer data is only for the thread that draws to use
+				auto readBack = [this, &drawn, &img](Renderer &) {
+					drawn = p->defaultSurface->rendererPrivateData != nullptr;
+					if (drawn)
+					{
+						img = p->defaultSurface->rendererPrivateData->readBack();
+					}
+				};
+				if (p->renderThread)
+				{
+					p->renderThread->run(readBack);
+				}
+				else
+				{
+					readBack(*this->renderer);
+				}
+				if (!drawn)
 				{
 					LogWarning("No renderer data on surface - nothing drawn yet?");
 				}
 				else
 				{
-					auto img = p->defaultSurface->rendererPrivateData->readBack();
 					if (!img)
 					{
 						LogWarning("No image returned");
@@ -701,6 +818,35 @@ void Framework::pushEvent(up<Event> e)
 
 void Framework::pushEvent(Event *e) { this->pushEvent(up<Event>(e)); }
 
+void Framework::dispatchEvents()
+{
+	while (!p->ProgramStages.isEmpty())
+	{
+		up<Event> e;
+		{
+			std::lock_guard<std::mutex> l(p->eventQueueLock);
+			if (p->eventQueue.empty())
+			{
+				break;
+			}
+			e = std::move(p->eventQueue.front());
+			p->eventQueue.pop_front();
+		}
+		if (!e)
+		{
+			LogError("Invalid event on queue");
+			continue;
+		}
+		if (this->cursor)
+		{
+			this->cursor->eventOccured(e.get());
+		}
+		p->ProgramStages.current()->eventOccurred(e.get());
+	}
+	// Only run() goes to other stages
+	stageCommands.clear();
+}
+
 void Framework::translateSdlEvents()
 {
 	SDL_Event e;
@@ -752,6 +898,31 @@ void Framework::translateSdlEvents()
 				// FIXME: Do nothing?
 				break;
 			case SDL_MOUSEMOTION:
+			{
+				// A mouse polled fast moves many times a frame, so a move right after another yet to
+				// be handled is folded into it rather than going through the stage again
+				bool merged = false;
+				{
+					std::lock_guard<std::mutex> l(p->eventQueueLock);
+					if (!p->eventQueue.empty() && p->eventQueue.back() &&
+					    p->eventQueue.back()->type() == EVENT_MOUSE_MOVE)
+					{
+						auto &last = p->eventQueue.back()->mouse();
+						if (last.WheelVertical == 0 && last.WheelHorizontal == 0 &&
+						    last.Button == (int)e.motion.state)
+						{
+							last.X = e.motion.x;
+							last.Y = e.motion.y;
+							last.DeltaX += e.motion.xrel;
+							last.DeltaY += e.motion.yrel;
+							merged = true;
+						}
+					}
+				}
+				if (merged)
+				{
+					break;
+				}
 				fwE = new MouseEvent(EVENT_MOUSE_MOVE);
 				fwE->mouse().X = e.motion.x;
 				fwE->mouse().Y = e.motion.y;
@@ -762,6 +933,7 @@ void Framework::translateSdlEvents()
 				fwE->mouse().Button = e.motion.state;
 				pushEvent(up<Event>(fwE));
 				break;
+			}
 			case SDL_MOUSEWHEEL:
 				// FIXME: Check these values for sanity
 				fwE = new MouseEvent(EVENT_MOUSE_MOVE);
@@ -1033,6 +1205,18 @@ void Framework::displayInitialise()
 		abort();
 	}
 	this->p->defaultSurface = this->renderer->getDefaultSurface();
+	if (renderThreadOption.get())
+	{
+		auto window = p->window;
+		auto context = p->context;
+		p->renderThread = new ThreadedRenderer(
+		    std::move(this->renderer), [window]() { SDL_GL_SwapWindow(window); },
+		    [window, context](bool current) {
+			    SDL_GL_MakeCurrent(window, current ? context : nullptr);
+		    });
+		this->renderer.reset(p->renderThread);
+		LogInfo("Drawing on a render thread");
+	}
 
 	int width, height;
 	SDL_GetWindowSize(p->window, &width, &height);
@@ -1064,10 +1248,12 @@ void Framework::displayInitialise()
 		p->displaySize = p->windowSize;
 	}
 	this->cursor.reset(new ApocCursor(this->data->loadPalette("xcom3/tacdata/tactical.pal")));
+	this->statsOverlay.reset(new StatsOverlay());
 }
 
 void Framework::displayShutdown()
 {
+	this->statsOverlay.reset();
 	this->cursor.reset();
 	if (!p->window)
 	{
@@ -1076,12 +1262,25 @@ void Framework::displayShutdown()
 	TRACE_FN;
 	LogInfo("Shutdown Display");
 	p->defaultSurface.reset();
+	p->renderThread = nullptr;
 	renderer.reset();
 
 	SDL_GL_DeleteContext(p->context);
 	SDL_DestroyWindow(p->window);
 }
 
+void Framework::displayInitialiseHeadless(Vec2<int> size)
+{
+	if (p->window)
+	{
+		LogError("Display already has a window");
+		return;
+	}
+	p->windowSize = size;
+	p->displaySize = size;
+	this->cursor.reset(new ApocCursor(this->data->loadPalette("xcom3/tacdata/tactical.pal")));
+}
+
 int Framework::displayGetWidth() { return p->displaySize.x; }
 
 int Framework::displayGetHeight() { return p->displaySize.y; }
@@ -1186,6 +1385,10 @@ sp<Stage> Framework::stageGetPrevious(sp<Stage> From) { return p->ProgramStages.
 
 void Framework::stageQueueCommand(const StageCmd &cmd) { stageCommands.emplace_back(cmd); }
 
+void Framework::stagePush(sp<Stage> stage) { p->ProgramStages.push(stage); }
+
+void Framework::stagePop() { p->ProgramStages.pop(); }
+
 ApocCursor &Framework::getCursor() { return *this->cursor; }
 
 void Framework::textStartInput() { SDL_StartTextInput(); }
@@ -1204,6 +1407,35 @@ UString Framework::textGetClipboard()
 	return str;
 }
 
-void Framework::threadPoolTaskEnqueue(std::function<void()> task) { p->threadPool->enqueue(task); }
+void Framework::threadPoolTaskEnqueue(std::function<void()> task)
+{
+	p->jobSystem->run(std::move(task));
+}
+
+unsigned int Framework::threadPoolGetSize() const { return p->jobSystem->getSize(); }
+
+void Framework::threadPoolParallelFor(unsigned int count,
+                                      std::function<void(unsigned int, unsigned int)> work)
+{
+	p->jobSystem->parallelFor(count, work);
+}
+
+JobSystem &Framework::getJobSystem() { return *p->jobSystem; }
+
+void Framework::frameQueueJob(std::function<void()> job)
+{
+	p->jobSystem->run(std::move(job), &p->frameJobs);
+}
+
+void Framework::frameQueueUpload(sp<Image> image)
+{
+	// Only a window's frames ever get to uploading them
+	if (!image || !createWindow)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> l(p->uploadsLock);
+	p->uploads.push_back(std::move(image));
+}
 
 }; // namespace OpenApoc
\ No newline at end of file
@@ -13,6 +13,7 @@ class Shader;
 class GameCore;
 class FrameworkPrivate;
 class ApocCursor;
+class StatsOverlay;
 class Event;
 class Data;
 class Renderer;
@@ -21,6 +22,8 @@ class JukeBox;
 class StageCmd;
 class Stage;
 class RGBImage;
+class JobSystem;
+class Image;
 
 #define FRAMES_PER_SECOND 100
 
@@ -32,10 +35,14 @@ class Framework
 	bool createWindow;
 	void audioInitialise();
 	void audioShutdown();
+	// Gets a few of the images queued by frameQueueUpload() ready to be drawn
+	void uploadImages();
 
 	static Framework *instance;
 
 	up<ApocCursor> cursor;
+	// Toggled with scroll lock
+	up<StatsOverlay> statsOverlay;
 
 	std::list<StageCmd> stageCommands;
 
@@ -56,6 +63,9 @@ class Framework
 	/* PushEvent() take ownership of the Event, and will delete it after use*/
 	void pushEvent(up<Event> e);
 	void pushEvent(Event *e);
+	// Hands every queued event, and any queued while handling them, to the current stage, for
+	// running stages without run() (as benchmarks do). Stage commands queued meanwhile are dropped
+	void dispatchEvents();
 
 	void translateSdlEvents();
 	void shutdownFramework();
@@ -63,6 +73,9 @@ class Framework
 
 	void displayInitialise();
 	void displayShutdown();
+	// Gives a framework made without a window a display of size for stages to lay out on, and a
+	// cursor following the mouse events pushed, though nothing to draw either to
+	void displayInitialiseHeadless(Vec2<int> size);
 	int displayGetWidth();
 	int displayGetHeight();
 	Vec2<int> displayGetSize();
@@ -78,6 +91,10 @@ class Framework
 	sp<Stage> stageGetPrevious(sp<Stage> From);
 
 	void stageQueueCommand(const StageCmd &cmd);
+	// Push or pop right away rather than once the frame is updated, for running stages without
+	// run()
+	void stagePush(sp<Stage> stage);
+	void stagePop();
 
 	ApocCursor &getCursor();
 
@@ -86,6 +103,25 @@ class Framework
 	UString textGetClipboard();
 
 	void threadPoolTaskEnqueue(std::function<void()> task);
+	// Returns the number of worker threads in the pool
+	unsigned int threadPoolGetSize() const;
+	// Calls work(index, slot) for every index in [0, count), spread over the pool and the calling
+	// thread, and returns once all of them are done. Calls running at the same time always get
+	// different slots, and slot is always below threadPoolGetSize() + 1, so it can be used to pick
+	// per-thread scratch data. Safe to call from within a pool task
+	void threadPoolParallelFor(unsigned int count,
+	                           std::function<void(unsigned int index, unsigned int slot)> work);
+	// The jobs the thread pool runs, for work split finely enough that the futures
+	// threadPoolEnqueue makes would cost more than the work itself
+	JobSystem &getJobSystem();
+	// Runs job on the thread pool while the frame is drawn and flipped. The next frame waits for
+	// every such job before handling events or updating, so a stage can hand off work in update()
+	// that its next update() relies on, as long as nothing drawing touches the same data
+	void frameQueueJob(std::function<void()> job);
+	// Queues an image loaded in the background to be put where the renderer draws from, a few of
+	// them each frame between update and render, so frames that first draw it do not stall on it.
+	// Safe to call from any thread
+	void frameQueueUpload(sp<Image> image);
 	// add new work item to the pool
 	template <class F, class... Args>
 	auto threadPoolEnqueue(F &&f, Args &&... args)
@@ -43,6 +43,8 @@ class FileSystem
   public:
 	FileSystem(std::vector<UString> paths);
 	~FileSystem();
+	// The directory of the user that anything the game keeps between runs is written to
+	const UString &getWriteDir() const { return writeDir; }
 	IFile open(const UString &path);
 	UString getCorrectCaseFilename(const UString &path);
 	std::list<UString> enumerateDirectory(const UString &path, const UString &extension) const;
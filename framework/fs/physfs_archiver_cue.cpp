@@ -7,18 +7,23 @@
 #include <inttypes.h>
 #endif
 
+#include "framework/configfile.h"
 #include "framework/filesystem.h"
 #include "framework/fs/physfs_archiver_cue.h"
 #include "framework/logger.h"
 #include "library/sp.h"
 #include "library/strings.h"
 #include <SDL_endian.h> // endianness check
+#include <algorithm>
 #include <cstddef>
 #include <cstring> // for std::memcmp
 #include <fstream>
 #include <inttypes.h>
+#include <list>
 #include <map>
+#include <mutex>
 #include <physfs.h>
+#include <vector>
 
 using namespace OpenApoc;
 
@@ -445,6 +450,64 @@ static_assert(sizeof(Sint32LsbMsb) == 8, "Unexpedted int16_lsb_msb_size!");
 static_assert(sizeof(DecDatetime) == 17, "Unexpected dec_datetime size!");
 static_assert(sizeof(DirDatetime) == 7, "Unexpected dir_datetime size!");
 
+ConfigOptionInt sectorCacheSizeOption("Framework", "CDCacheSize",
+                                      "Size in KiB of the cache of sectors read from a CD image",
+                                      4096);
+ConfigOptionInt readAheadOption(
+    "Framework", "CDReadAhead",
+    "Most sectors read at once from a CD image when a file in it is read sequentially", 256);
+
+// User data of the sectors read from a CD image, kept for every file in it, CHUNK_SECTORS
+// consecutive sectors at a time. The chunks used longest ago are dropped once more than
+// maxChunks are kept
+class CueSectorCache
+{
+  public:
+	static const int32_t CHUNK_SECTORS = 16;
+
+	using Chunk = std::vector<char>;
+
+	CueSectorCache(size_t maxChunks) : maxChunks(maxChunks) {}
+
+	sp<const Chunk> find(int32_t chunkIndex)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = chunks.find(chunkIndex);
+		if (found == chunks.end())
+		{
+			return nullptr;
+		}
+		lru.splice(lru.begin(), lru, found->second.second);
+		return found->second.first;
+	}
+
+	void insert(int32_t chunkIndex, sp<const Chunk> chunk)
+	{
+		std::vector<sp<const Chunk>> dropped;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (maxChunks == 0 || chunks.find(chunkIndex) != chunks.end())
+		{
+			return;
+		}
+		lru.push_front(chunkIndex);
+		chunks[chunkIndex] = {chunk, lru.begin()};
+		while (chunks.size() > maxChunks)
+		{
+			auto oldest = chunks.find(lru.back());
+			dropped.push_back(std::move(oldest->second.first));
+			chunks.erase(oldest);
+			lru.pop_back();
+		}
+	}
+
+  private:
+	size_t maxChunks;
+	std::mutex mutex;
+	// Most recently used first
+	std::list<int32_t> lru;
+	std::map<int32_t, std::pair<sp<const Chunk>, std::list<int32_t>::iterator>> chunks;
+};
+
 class CueIO
 {
   private:
@@ -458,12 +521,15 @@ class CueIO
 	CueFileType fileType;
 	CueTrackMode trackMode;
 	std::ifstream fileStream;
+	sp<CueSectorCache> sectorCache; // Shared with every stream of the same image
+	int32_t nextChunk = -1;         // Chunk after the last ones read ahead by this stream
+	int32_t readAheadChunks = 1;    // Chunks read ahead last time
 
-	CueIO(const UString &fileName, uint32_t lbaStart, int64_t length,
+	CueIO(const UString &fileName, uint32_t lbaStart, int64_t length, sp<CueSectorCache> cache,
 	      CueFileType fileType = CueFileType::FT_BINARY,
 	      CueTrackMode trackMode = CueTrackMode::MODE1_2048)
 	    : imageFile(fileName), lbaStart(lbaStart), lbaCurrent(lbaStart), posInLba(0),
-	      length(length), fileType(fileType), trackMode(trackMode)
+	      length(length), fileType(fileType), trackMode(trackMode), sectorCache(cache)
 	{
 		fileStream.open(fileName.str(), std::ios::in | std::ios::binary);
 		fileStream.seekg(lbaToByteOffset(lbaStart));
@@ -491,7 +557,7 @@ class CueIO
 			case CueTrackMode::MODE2_2336:
 				return lba * 2336 + 8;
 			case CueTrackMode::MODE2_2352:
-				return lba * 2048 + 12 + 4 + 8;
+				return lba * 2352 + 12 + 4 + 8;
 			default:
 				LogError("Unknown track mode set!");
 				// Return negative offset to indicate error
@@ -605,27 +671,78 @@ class CueIO
 		int64_t totalRead = 0;
 		do
 		{
-			int64_t readSize = std::min(len - totalRead, int64_t(blockSize() - posInLba));
-			fileStream.read(bufWrite + totalRead, readSize);
-			totalRead += fileStream.gcount();
-			if (fileStream.gcount() != readSize)
+			auto chunkIndex = lbaCurrent / CueSectorCache::CHUNK_SECTORS;
+			auto chunk = getChunk(chunkIndex);
+			int64_t offsetInChunk =
+			    int64_t(lbaCurrent - chunkIndex * CueSectorCache::CHUNK_SECTORS) * blockSize() +
+			    posInLba;
+			int64_t readSize =
+			    std::min(len - totalRead, int64_t(chunk->size()) - offsetInChunk);
+			if (readSize <= 0)
 			{
-				LogWarning("Read buffer underrun! Wanted %" PRId64 " bytes, got %" PRId64, readSize,
-				           fileStream.gcount());
+				LogWarning("Read buffer underrun! Wanted %" PRId64 " bytes, got %" PRId64,
+				           len - totalRead, int64_t(0));
 				return totalRead;
 			}
-			posInLba += readSize;
-			if (posInLba >= blockSize())
-			{
-				posInLba = 0;
-				lbaCurrent += 1;
-				// fileStream.seekg(lbaToByteOffset(lbaCurrent), std::ios::beg);
-				seek((lbaCurrent - lbaStart) * blockSize());
-			}
+			std::memcpy(bufWrite + totalRead, chunk->data() + offsetInChunk, readSize);
+			totalRead += readSize;
+			seek(tell() + readSize);
 		} while (len > totalRead);
 		return totalRead;
 	}
 
+	// Returns the user data of the sectors in chunkIndex, from the cache if it is there. Else it
+	// is read from the image, along with as many of the chunks after it as this stream is likely
+	// to want next: reading the chunk right after the last ones read doubles how many are read at
+	// once, up to the read ahead option
+	sp<const CueSectorCache::Chunk> getChunk(int32_t chunkIndex)
+	{
+		if (auto chunk = sectorCache->find(chunkIndex))
+		{
+			return chunk;
+		}
+		int32_t maxChunks = std::max(1, readAheadOption.get() / CueSectorCache::CHUNK_SECTORS);
+		readAheadChunks =
+		    chunkIndex == nextChunk ? std::min(readAheadChunks * 2, maxChunks) : 1;
+		nextChunk = chunkIndex + readAheadChunks;
+
+		// Read whole raw sectors in one go, then pick the user data out of each of them
+		int64_t firstLba = int64_t(chunkIndex) * CueSectorCache::CHUNK_SECTORS;
+		std::vector<char> raw(
+		    size_t(readAheadChunks) * CueSectorCache::CHUNK_SECTORS * binBlockSize());
+		fileStream.clear();
+		fileStream.seekg(lbaToByteOffset(firstLba) - binDataOffset(), std::ios::beg);
+		fileStream.read(raw.data(), raw.size());
+		int64_t sectorsRead = fileStream.gcount() / binBlockSize();
+
+		sp<const CueSectorCache::Chunk> first;
+		for (int32_t i = 0; i < readAheadChunks; i++)
+		{
+			auto chunk = mksp<CueSectorCache::Chunk>();
+			int64_t sectors = std::min<int64_t>(
+			    CueSectorCache::CHUNK_SECTORS,
+			    std::max<int64_t>(0, sectorsRead - i * CueSectorCache::CHUNK_SECTORS));
+			chunk->resize(sectors * blockSize());
+			for (int64_t sector = 0; sector < sectors; sector++)
+			{
+				std::memcpy(chunk->data() + sector * blockSize(),
+				            raw.data() +
+				                (i * CueSectorCache::CHUNK_SECTORS + sector) * binBlockSize() +
+				                binDataOffset(),
+				            blockSize());
+			}
+			if (i == 0)
+			{
+				first = chunk;
+			}
+			if (sectors == CueSectorCache::CHUNK_SECTORS)
+			{
+				sectorCache->insert(chunkIndex + i, chunk);
+			}
+		}
+		return first;
+	}
+
 	int seek(int64_t offset)
 	{
 		if (offset > length)
@@ -638,9 +755,7 @@ class CueIO
 
 		lbaCurrent = lbaStart + blockOffset;
 		posInLba = posInBlock;
-		uint64_t binOffset = lbaToByteOffset(lbaCurrent) + posInLba;
-		fileStream.seekg(binOffset, std::ios::beg);
-		return fileStream.good();
+		return 1;
 	}
 
 	PHYSFS_sint64 tell()
@@ -652,10 +767,9 @@ class CueIO
 	CueIO(const CueIO &other)
 	    : imageFile(other.imageFile), lbaStart(other.lbaStart), lbaCurrent(other.lbaCurrent),
 	      posInLba(other.posInLba), length(other.length), fileType(other.fileType),
-	      trackMode(other.trackMode)
+	      trackMode(other.trackMode), sectorCache(other.sectorCache)
 	{
 		fileStream.open(imageFile.str(), std::ios::in | std::ios::binary);
-		fileStream.seekg(lbaToByteOffset(lbaStart) + posInLba);
 	}
 
 	~CueIO() { fileStream.close(); }
@@ -712,7 +826,7 @@ class CueIO
 		// Just go ahead and construct a new file stream
 		PHYSFS_Io *retval = createIo();
 		// Set the appropriate fields
-		io->opaque = new CueIO(*cio);
+		retval->opaque = new CueIO(*cio);
 		return retval;
 	}
 
@@ -729,10 +843,10 @@ class CueIO
 		delete io;
 	}
 
-	static PHYSFS_Io *getIo(UString fileName, uint32_t lba, int64_t length, CueFileType ftype,
-	                        CueTrackMode tmode)
+	static PHYSFS_Io *getIo(UString fileName, uint32_t lba, int64_t length,
+	                        sp<CueSectorCache> cache, CueFileType ftype, CueTrackMode tmode)
 	{
-		auto cio = new CueIO(fileName, lba, length, ftype, tmode);
+		auto cio = new CueIO(fileName, lba, length, cache, ftype, tmode);
 		if (!cio->fileStream)
 		{
 			delete cio;
@@ -752,6 +866,7 @@ class CueArchiver
 	CueFileType fileType;
 	CueTrackMode trackMode;
 
+	sp<CueSectorCache> sectorCache;
 	CueIO *cio;
 
 	struct IsoVolumeDescriptor
@@ -960,7 +1075,10 @@ class CueArchiver
 		// (mode1_2048)
 		uint64_t fsize = fs::file_size(filePath);
 		LogInfo("Opening file %s of size %" PRIu64, fileName, fsize);
-		cio = new CueIO(fileName, 0, fsize, ftype, tmode);
+		auto cacheChunks = std::max(0, sectorCacheSizeOption.get()) * 1024 /
+		                   (CueSectorCache::CHUNK_SECTORS * 2048);
+		sectorCache = mksp<CueSectorCache>(cacheChunks);
+		cio = new CueIO(fileName, 0, fsize, sectorCache, ftype, tmode);
 		if (!cio->fileStream)
 		{
 			LogError("Could not open file: bad stream!");
@@ -1042,7 +1160,8 @@ class CueArchiver
 		{
 			return nullptr;
 		}
-		return CueIO::getIo(imageFile, entry->offset, entry->length, fileType, trackMode);
+		return CueIO::getIo(imageFile, entry->offset, entry->length, sectorCache, fileType,
+		                    trackMode);
 	}
 
 	int stat(const char *name, PHYSFS_Stat *stat)
@@ -3,13 +3,22 @@
 #include "framework/framework.h"
 #include "framework/logger.h"
 #include "framework/palette.h"
+#include "framework/renderer.h"
 #include "library/sp.h"
+#include <algorithm>
 #include <cstring>
+#include <mutex>
 
 namespace OpenApoc
 {
 
-Image::~Image() = default;
+namespace
+{
+// Guards packing and unpacking palette images, and their lock counts
+std::mutex packMutex;
+} // anonymous namespace
+
+Image::~Image() { releaseRendererData(std::move(this->rendererPrivateData)); }
 
 Image::Image(Vec2<unsigned int> size)
     : size(size), dirty(true), bounds(0, 0, size.x, size.y), indexInSet(0)
@@ -29,20 +38,68 @@ PaletteImage::PaletteImage(Vec2<unsigned int> size, uint8_t initialIndex)
 
 PaletteImage::~PaletteImage() = default;
 
-sp<RGBImage> PaletteImage::toRGBImage(sp<Palette> p)
+bool PaletteImage::pack()
 {
-	sp<RGBImage> i = mksp<RGBImage>(size);
-
-	RGBImageLock imgLock{i, ImageLockUse::Write};
-
-	for (unsigned int y = 0; y < this->size.y; y++)
+	std::lock_guard<std::mutex> lock(packMutex);
+	if (!this->indices)
 	{
-		for (unsigned int x = 0; x < this->size.x; x++)
+		return true;
+	}
+	if (this->lockCount > 0)
+	{
+		return false;
+	}
+	size_t count = this->size.x * this->size.y;
+	std::vector<uint8_t> runs;
+	for (size_t i = 0; i < count;)
+	{
+		auto index = this->indices[i];
+		size_t run = 1;
+		while (run < 255 && i + run < count && this->indices[i + run] == index)
 		{
-			uint8_t idx = this->indices[y * this->size.x + x];
-			imgLock.set(Vec2<unsigned int>{x, y}, p->getColour(idx));
+			run++;
 		}
+		runs.push_back(static_cast<uint8_t>(run));
+		runs.push_back(index);
+		i += run;
+		// Not worth it once past the size of the image itself
+		if (runs.size() >= count)
+		{
+			return false;
+		}
+	}
+	runs.shrink_to_fit();
+	this->packedIndices = std::move(runs);
+	this->indices.reset();
+	return true;
+}
+
+void PaletteImage::unpack()
+{
+	if (this->indices)
+	{
+		return;
 	}
+	this->indices.reset(new uint8_t[this->size.x * this->size.y]);
+	size_t offset = 0;
+	for (size_t i = 0; i + 1 < this->packedIndices.size(); i += 2)
+	{
+		std::fill_n(this->indices.get() + offset, this->packedIndices[i],
+		            this->packedIndices[i + 1]);
+		offset += this->packedIndices[i];
+	}
+	this->packedIndices = {};
+}
+
+sp<RGBImage> PaletteImage::toRGBImage(sp<Palette> p)
+{
+	sp<RGBImage> i = mksp<RGBImage>(size);
+
+	PaletteImageLock reader{std::static_pointer_cast<PaletteImage>(shared_from_this()),
+	                        ImageLockUse::Read};
+	RGBImageLock imgLock{i, ImageLockUse::Write};
+	paletteToRGBA(this->indices.get(), this->size.x * this->size.y, *p,
+	              reinterpret_cast<Colour *>(imgLock.getData()));
 	return i;
 }
 
@@ -119,14 +176,23 @@ PaletteImageLock::PaletteImageLock(sp<PaletteImage> img, ImageLockUse use) : img
 {
 	// FIXME: Readback from renderer?
 	// FIXME: Disallow multiple locks?
+	std::lock_guard<std::mutex> lock(packMutex);
+	this->img->lockCount++;
+	this->img->unpack();
 }
 
-PaletteImageLock::~PaletteImageLock() = default;
+PaletteImageLock::~PaletteImageLock()
+{
+	std::lock_guard<std::mutex> lock(packMutex);
+	this->img->lockCount--;
+}
 
 void *PaletteImageLock::getData() { return this->img->indices.get(); }
 
 void PaletteImage::calculateBounds()
 {
+	PaletteImageLock reader{std::static_pointer_cast<PaletteImage>(shared_from_this()),
+	                        ImageLockUse::Read};
 	unsigned int minX = this->size.x, minY = this->size.y, maxX = 0, maxY = 0;
 
 	for (unsigned int y = 0; y < this->size.y; y++)
@@ -162,4 +228,25 @@ sp<Image> &LazyImage::getRealImage()
 	return this->realImage;
 }
 
+void paletteToRGBA(const uint8_t *indices, size_t count, const Palette &palette, Colour *out)
+{
+	// A table covering every index, so the loop needs no bounds check
+	Colour table[256];
+	size_t paletteSize = std::min<size_t>(palette.colours.size(), 256);
+	std::copy(palette.colours.begin(), palette.colours.begin() + paletteSize, table);
+	std::fill(table + paletteSize, table + 256, Colour{0, 0, 0, 0});
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = table[indices[i]];
+	}
+}
+
+void fillRepeating(uint8_t *out, size_t count, const uint8_t (&pattern)[4])
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = pattern[i % 4];
+	}
+}
+
 }; // namespace OpenApoc
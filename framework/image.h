@@ -6,6 +6,10 @@
 #include "library/resource.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -22,7 +26,7 @@ enum class ImageLockUse
 	ReadWrite,
 };
 
-class Image : public ResObject
+class Image : public ResObject, public std::enable_shared_from_this<Image>
 {
   protected:
 	Image(Vec2<unsigned int> size);
@@ -63,10 +67,21 @@ class PaletteImage : public Image
   private:
 	friend class PaletteImageLock;
 	up<uint8_t[]> indices;
+	// While packed, indices is empty and the image is kept here as runs of a count and an index
+	std::vector<uint8_t> packedIndices;
+	// Locks alive on the image, which can't be packed while there are any
+	unsigned int lockCount = 0;
+	void unpack();
 
   public:
 	PaletteImage(Vec2<unsigned int> size, uint8_t initialIndex = 0);
 	~PaletteImage() override;
+	// Set on images that are only looked at through locks once they are drawn, like those of
+	// image packs, for the renderer to pack them once it has them on the GPU
+	bool packOnUpload = false;
+	// Keeps the image run length encoded until the next lock, if nothing has it locked and that
+	// makes it smaller. Returns true if the image is packed
+	bool pack();
 	sp<RGBImage> toRGBImage(sp<Palette> p);
 	static void blit(sp<PaletteImage> src, sp<PaletteImage> dst,
 	                 Vec2<unsigned int> srcOffset = {0, 0}, Vec2<unsigned int> dstOffset = {0, 0});
@@ -156,4 +171,13 @@ class ImageSet : public ResObject
 	sp<RendererImageData> rendererPrivateData;
 };
 
+// Kernels over whole rows of pixels at a time, kept as plain loops over raw arrays for the
+// compiler to vectorise, rather than going through a lock a pixel at a time
+
+// Sets out[i] to the colour of index indices[i] in the palette, for count pixels. Indices past
+// the end of the palette give the transparent colour
+void paletteToRGBA(const uint8_t *indices, size_t count, const Palette &palette, Colour *out);
+// Sets out[i] to pattern[i % 4], for count pixels
+void fillRepeating(uint8_t *out, size_t count, const uint8_t (&pattern)[4]);
+
 }; // namespace OpenApoc
@@ -5,6 +5,7 @@
 #include "framework/palette.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <vector>
 
 using namespace OpenApoc;
 
@@ -111,6 +112,9 @@ class PCXImageLoader : public OpenApoc::ImageLoader
 
 		{
 			RGBImageLock lock(img);
+			auto *pixels = reinterpret_cast<Colour *>(lock.getData());
+			// Every row is decoded to indices first, then looked up in the palette all at once
+			std::vector<uint8_t> row(sizeX);
 
 			const uint8_t *img_data = reinterpret_cast<uint8_t *>(&data[sizeof(struct PcxHeader)]);
 
@@ -148,11 +152,12 @@ class PCXImageLoader : public OpenApoc::ImageLoader
 					}
 					while (run_length > 0 && x <= header->XEnd)
 					{
-						lock.set({x, y}, p->getColour(idx));
+						row[x - header->XStart] = idx;
 						x++;
 						run_length--;
 					}
 				}
+				paletteToRGBA(row.data(), sizeX, *p, pixels + (y - header->YStart) * sizeX);
 			}
 		}
 
@@ -0,0 +1,243 @@
+#include "framework/jobsystem.h"
+#include "framework/logger.h"
+#include "framework/trace.h"
+#include "library/strings_format.h"
+#include <algorithm>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+class ParallelForState
+{
+  public:
+	std::atomic<unsigned int> nextIndex{0};
+	std::atomic<unsigned int> nextSlot{0};
+	unsigned int count;
+	const std::function<void(unsigned int, unsigned int)> *work;
+
+	void run()
+	{
+		// Helpers that start after everything is claimed leave without a slot
+		unsigned int index = nextIndex++;
+		if (index >= count)
+		{
+			return;
+		}
+		unsigned int slot = nextSlot++;
+		while (index < count)
+		{
+			try
+			{
+				(*work)(index, slot);
+			}
+			catch (std::exception &e)
+			{
+				LogError("Exception occurred in parallel task %u: %s", index, e.what());
+			}
+			index = nextIndex++;
+		}
+	}
+};
+
+} // anonymous namespace
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	// Having no workers really doesn't make sense
+	LogAssert(threadCount > 0);
+	for (unsigned int i = 0; i < threadCount + 1; i++)
+	{
+		queues.push_back(mkup<Queue>());
+	}
+	// Jobs are only ever added once this returns, and taking them goes through the queue locks,
+	// so workers only look at threadIds once it is filled in
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back([this, i] {
+			Trace::setThreadName(format("JobSystem %u", i));
+			workerLoop(i);
+		});
+		threadIds.push_back(threads.back().get_id());
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+		stop = true;
+	}
+	wakeCondition.notify_all();
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned int JobSystem::getQueueIndex() const
+{
+	auto id = std::this_thread::get_id();
+	for (unsigned int i = 0; i < threadIds.size(); i++)
+	{
+		if (threadIds[i] == id)
+		{
+			return i;
+		}
+	}
+	return static_cast<unsigned int>(threadIds.size());
+}
+
+void JobSystem::run(Job job, JobCounter *counter)
+{
+	if (Trace::enabled)
+	{
+		// Links where the job was queued to where it ran in the trace
+		static const TraceName jobName("Job");
+		auto flow = Trace::flowStart(jobName);
+		auto queuedJob = std::move(job);
+		job = [queuedJob, flow]() {
+			TraceObj obj(jobName);
+			Trace::flowEnd(jobName, flow);
+			queuedJob();
+		};
+	}
+	if (counter)
+	{
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	auto &queue = *queues[getQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.jobs.push_back({std::move(job), counter});
+	}
+	queued++;
+	// Workers check queued with sleepLock held before sleeping, so going through it here means
+	// one can't miss the notification between checking and starting to wait
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+	}
+	wakeCondition.notify_one();
+}
+
+bool JobSystem::takeJob(unsigned int queueIndex, QueuedJob &job)
+{
+	{
+		auto &own = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.lock);
+		if (!own.jobs.empty())
+		{
+			// A worker takes the newest of its own, the shared queue is taken from in order
+			if (queueIndex < threads.size())
+			{
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+			}
+			else
+			{
+				job = std::move(own.jobs.front());
+				own.jobs.pop_front();
+			}
+			return true;
+		}
+	}
+	for (unsigned int i = 1; i < queues.size(); i++)
+	{
+		auto &other = *queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(other.lock);
+		if (!other.jobs.empty())
+		{
+			job = std::move(other.jobs.front());
+			other.jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::runOne(unsigned int queueIndex)
+{
+	if (queued.load() == 0)
+	{
+		return false;
+	}
+	QueuedJob job;
+	if (!takeJob(queueIndex, job))
+	{
+		return false;
+	}
+	queued--;
+	try
+	{
+		job.job();
+	}
+	catch (std::exception &e)
+	{
+		LogError("Exception occurred in job: %s", e.what());
+	}
+	if (job.counter)
+	{
+		job.counter->pending.fetch_sub(1, std::memory_order_release);
+	}
+	return true;
+}
+
+void JobSystem::workerLoop(unsigned int queueIndex)
+{
+	for (;;)
+	{
+		if (runOne(queueIndex))
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepLock);
+		wakeCondition.wait(lock, [this] { return stop || queued.load() > 0; });
+		if (stop && queued.load() == 0)
+		{
+			return;
+		}
+	}
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	auto queueIndex = getQueueIndex();
+	while (!counter.isDone())
+	{
+		// Whatever the counted jobs are waiting on may well be queued behind them, so only yield
+		// once nothing is left to run
+		if (!runOne(queueIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(unsigned int count,
+                            const std::function<void(unsigned int, unsigned int)> &work)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	// Everything lives on this stack, as nothing that refers to it can outlive the wait below.
+	// The helpers only capture a pointer to it, which fits in a Job without allocating
+	ParallelForState state;
+	state.count = count;
+	state.work = &work;
+	JobCounter counter;
+	// The calling thread takes part too, so if every worker is busy (or we are one of them) the
+	// work still gets done
+	unsigned int helpers = std::min(count - 1, getSize());
+	auto *statePtr = &state;
+	for (unsigned int i = 0; i < helpers; i++)
+	{
+		run([statePtr]() { statePtr->run(); }, &counter);
+	}
+	state.run();
+	wait(counter);
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "library/sp.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Counts the jobs added with it that are yet to finish, so a group of jobs can be waited on. It
+// lives wherever the caller puts it, usually the stack of whoever waits, so it costs no allocation.
+// A job may add more jobs with the counter it was added with, making them its children that the
+// same wait() also waits for
+class JobCounter
+{
+  public:
+	JobCounter() = default;
+	JobCounter(const JobCounter &) = delete;
+	JobCounter &operator=(const JobCounter &) = delete;
+
+	bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+	friend class JobSystem;
+	std::atomic<unsigned int> pending{0};
+};
+
+// Runs jobs on a fixed number of worker threads. Each worker has a deque of its own that jobs it
+// adds go on, taking from the back of it, so a job's children usually run on the thread that made
+// them while their data is still in its cache. A worker with nothing left takes from the front of
+// the others' deques, oldest first. Jobs added by any other thread go on a shared deque that every
+// worker takes from
+class JobSystem
+{
+  public:
+	using Job = std::function<void()>;
+
+	JobSystem(unsigned int threads);
+	// Waits for every job still queued to run
+	~JobSystem();
+
+	unsigned int getSize() const { return static_cast<unsigned int>(threads.size()); }
+
+	// Queues job, counting it in counter until it is done if one is given
+	void run(Job job, JobCounter *counter = nullptr);
+	// Runs queued jobs until every one counted in counter is done, so waiting from within a job
+	// can't leave the workers stuck waiting on each other
+	void wait(JobCounter &counter);
+	// Calls work(index, slot) for every index in [0, count), spread over the workers and the
+	// calling thread, and returns once all of them are done. Calls running at the same time
+	// always get different slots, each below getSize() + 1
+	void parallelFor(unsigned int count,
+	                 const std::function<void(unsigned int index, unsigned int slot)> &work);
+
+  private:
+	class QueuedJob
+	{
+	  public:
+		Job job;
+		JobCounter *counter;
+	};
+
+	class Queue
+	{
+	  public:
+		std::mutex lock;
+		std::deque<QueuedJob> jobs;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<std::thread::id> threadIds;
+	// One per worker, then the one shared by every other thread
+	std::vector<up<Queue>> queues;
+	// Jobs in any of the queues, for idle workers to know when to wake
+	std::atomic<unsigned int> queued{0};
+	std::mutex sleepLock;
+	std::condition_variable wakeCondition;
+	bool stop = false;
+
+	// The queue jobs added from the calling thread go on
+	unsigned int getQueueIndex() const;
+	bool takeJob(unsigned int queueIndex, QueuedJob &job);
+	// Runs one queued job if there is any, returning false if there were none
+	bool runOne(unsigned int queueIndex);
+	void workerLoop(unsigned int queueIndex);
+};
+
+}; // namespace OpenApoc
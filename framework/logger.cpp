@@ -8,9 +8,12 @@
 #include "framework/configfile.h"
 #include "framework/framework.h"
 #include "library/sp.h"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <mutex>
+#include <thread>
 #ifdef BACKTRACE_LIBUNWIND
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
@@ -74,6 +77,10 @@ ConfigOptionInt backtraceLogLevelOption(
     1);
 ConfigOptionString logFileOption("Logger", "File", "File to write log to", LOG_PATH LOGFILE);
 ConfigOptionBool showDialogOnErrorOption("Logger", "ShowDialog", "Show dialog on error", true);
+ConfigOptionBool asyncLogOption("Logger", "Async",
+                                "Write the log from a background thread (errors are always written "
+                                "straight away)",
+                                true);
 
 #if defined(BACKTRACE_LIBUNWIND)
 static void print_backtrace(FILE *f)
@@ -170,17 +177,68 @@ static FILE *outFile = nullptr;
 
 // We store options after init as querying every LogInfo() takes a long time
 
-LogLevel stderrLogLevel;
-LogLevel fileLogLevel;
+std::atomic<LogLevel> stderrLogLevel{LogLevel::Debug};
+std::atomic<LogLevel> fileLogLevel{LogLevel::Nothing};
 LogLevel backtraceLogLevel;
 bool showDialogOnError;
+bool asyncLogging;
 
-bool loggerInited = false;
+std::atomic<bool> loggerInited{false};
 
+// Held for reading the options and for writing anything out
 static std::mutex logMutex;
 static std::chrono::time_point<std::chrono::high_resolution_clock> timeInit =
     std::chrono::high_resolution_clock::now();
 
+namespace
+{
+
+// A line logged but not written out yet
+class LogRecord
+{
+  public:
+	LogLevel level;
+	unsigned long long clockns;
+	UString prefix;
+	UString text;
+	LogRecord *next;
+};
+
+// Lines waiting for the writer thread, newest first. Threads logging push onto it without taking
+// any lock, and the writer takes the whole list at once, so neither ever waits for the other
+std::atomic<LogRecord *> pendingRecords{nullptr};
+
+enum class LogWriterState
+{
+	NotStarted,
+	Running,
+	// Gone at exit, after which everything is written straight away
+	Stopped,
+};
+std::atomic<LogWriterState> logWriterState{LogWriterState::NotStarted};
+
+class LogWriter
+{
+  private:
+	std::thread thread;
+	std::once_flag started;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool stop = false;
+
+	void run();
+
+  public:
+	~LogWriter();
+	void start();
+	// Nudges the writer, which otherwise wakes up every so often anyway to not depend on it
+	void notify() { wake.notify_one(); }
+};
+
+LogWriter logWriter;
+
+} // anonymous namespace
+
 static void initLogger()
 {
 	outFile = NULL;
@@ -193,32 +251,138 @@ static void initLogger()
 		fileLogLevel = LogLevel::Nothing;
 		backtraceLogLevel = LogLevel::Nothing;
 		showDialogOnError = false;
+		asyncLogging = false;
 		// Returning withoput setting loggerInited causes this to be called evey Log call until the
 		// config is parsed
 		return;
 	}
 
-	loggerInited = true;
-
-	stderrLogLevel = (LogLevel)stderrLogLevelOption.get();
-	fileLogLevel = (LogLevel)fileLogLevelOption.get();
 	backtraceLogLevel = (LogLevel)backtraceLogLevelOption.get();
 	showDialogOnError = showDialogOnErrorOption.get();
+	asyncLogging = asyncLogOption.get();
+	stderrLogLevel = (LogLevel)stderrLogLevelOption.get();
 
 	auto logFilePath = logFileOption.get();
-	if (logFilePath.empty())
+	if (!logFilePath.empty())
+	{
+		outFile = fopen(logFilePath.cStr(), "w");
+	}
+	// No log file set, or failed to open it, either way disabling logging to file
+	fileLogLevel = outFile ? (LogLevel)fileLogLevelOption.get() : LogLevel::Nothing;
+
+	loggerInited = true;
+}
+
+// Only to be called with logMutex held
+static void ensureLoggerInited()
+{
+	if (!loggerInited)
+	{
+		initLogger();
+	}
+}
+
+static const char *getLevelPrefix(LogLevel level)
+{
+	switch (level)
+	{
+		case LogLevel::Info:
+			return "I";
+		case LogLevel::Warning:
+			return "W";
+		default:
+			return "E";
+	}
+}
+
+// Only to be called with logMutex held
+static void writeLine(LogLevel level, unsigned long long clockns, const UString &prefix,
+                      const UString &text)
+{
+	if (level <= fileLogLevel)
+	{
+		fprintf(outFile, "%s %llu %s: %s\n", getLevelPrefix(level), clockns, prefix.cStr(),
+		        text.cStr());
+	}
+	if (level <= stderrLogLevel)
+	{
+		fprintf(stderr, "%s %llu %s: %s\n", getLevelPrefix(level), clockns, prefix.cStr(),
+		        text.cStr());
+	}
+}
+
+// Writes out every line queued so far, oldest first. Only to be called with logMutex held, so
+// nothing written directly can get in between lines already taken off the queue
+static void writePendingRecords()
+{
+	auto *records = pendingRecords.exchange(nullptr, std::memory_order_acquire);
+	if (!records)
 	{
-		// No log file set, disabling logging to file
-		fileLogLevel = LogLevel::Nothing;
 		return;
 	}
-	outFile = fopen(logFilePath.cStr(), "w");
-	if (!outFile)
+	LogRecord *oldestFirst = nullptr;
+	while (records)
+	{
+		auto *next = records->next;
+		records->next = oldestFirst;
+		oldestFirst = records;
+		records = next;
+	}
+	while (oldestFirst)
+	{
+		writeLine(oldestFirst->level, oldestFirst->clockns, oldestFirst->prefix,
+		          oldestFirst->text);
+		auto *next = oldestFirst->next;
+		delete oldestFirst;
+		oldestFirst = next;
+	}
+	if (outFile)
+	{
+		fflush(outFile);
+	}
+	fflush(stderr);
+}
+
+void LogWriter::start()
+{
+	std::call_once(started, [this]() {
+		logWriterState = LogWriterState::Running;
+		thread = std::thread([this]() { run(); });
+	});
+}
+
+void LogWriter::run()
+{
+	std::unique_lock<std::mutex> l(lock);
+	while (!stop)
+	{
+		// Loggers notify without the lock, so one may be missed now and then, hence the timeout
+		wake.wait_for(l, std::chrono::milliseconds(100),
+		              [this]() { return stop || pendingRecords.load() != nullptr; });
+		l.unlock();
+		{
+			std::lock_guard<std::mutex> logLock(logMutex);
+			writePendingRecords();
+		}
+		l.lock();
+	}
+}
+
+LogWriter::~LogWriter()
+{
+	if (!thread.joinable())
 	{
-		// Failed to open log file, disabling logging to file
-		fileLogLevel = LogLevel::Nothing;
 		return;
 	}
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stop = true;
+	}
+	wake.notify_all();
+	thread.join();
+	std::lock_guard<std::mutex> logLock(logMutex);
+	logWriterState = LogWriterState::Stopped;
+	writePendingRecords();
 }
 
 void _logAssert(UString prefix, UString string, int line, UString file)
@@ -228,15 +392,24 @@ void _logAssert(UString prefix, UString string, int line, UString file)
 	exit(EXIT_FAILURE);
 }
 
+bool logLevelEnabled(LogLevel level)
+{
+	if (!loggerInited)
+	{
+		std::lock_guard<std::mutex> l(logMutex);
+		ensureLoggerInited();
+	}
+	return level <= fileLogLevel || level <= stderrLogLevel;
+}
+
 void Log(LogLevel level, UString prefix, const UString &text)
 {
 	bool exit_app = false;
-	const char *level_prefix;
 
-	logMutex.lock();
 	if (!loggerInited)
 	{
-		initLogger();
+		std::lock_guard<std::mutex> l(logMutex);
+		ensureLoggerInited();
 	}
 
 	bool writeToFile = (level <= fileLogLevel);
@@ -251,23 +424,42 @@ void Log(LogLevel level, UString prefix, const UString &text)
 	unsigned long long clockns =
 	    std::chrono::duration<unsigned long long, std::nano>(timeNow - timeInit).count();
 
-	switch (level)
+	// Anything wanting a backtrace has to be written from the thread that logged it, as do errors
+	// since they may stop the program before the writer gets to them
+	if (loggerInited && asyncLogging && level > backtraceLogLevel && level > LogLevel::Error)
 	{
-		case LogLevel::Info:
-			level_prefix = "I";
-			break;
-		case LogLevel::Warning:
-			level_prefix = "W";
-			break;
-		default:
-			level_prefix = "E";
-			exit_app = true;
-			break;
+		if (logWriterState == LogWriterState::NotStarted)
+		{
+			logWriter.start();
+		}
+		if (logWriterState == LogWriterState::Running)
+		{
+			auto *record = new LogRecord{level, clockns, prefix, text, nullptr};
+			auto *head = pendingRecords.load(std::memory_order_relaxed);
+			do
+			{
+				record->next = head;
+			} while (!pendingRecords.compare_exchange_weak(head, record, std::memory_order_release,
+			                                               std::memory_order_relaxed));
+			if (!head)
+			{
+				logWriter.notify();
+			}
+			return;
+		}
 	}
 
+	if (level <= LogLevel::Error)
+	{
+		exit_app = true;
+	}
+
+	logMutex.lock();
+	// Whatever was logged before this goes first
+	writePendingRecords();
+	writeLine(level, clockns, prefix, text);
 	if (writeToFile)
 	{
-		fprintf(outFile, "%s %llu %s: %s\n", level_prefix, clockns, prefix.cStr(), text.cStr());
 		// On error print a backtrace to the log file
 		if (level <= backtraceLogLevel)
 			print_backtrace(outFile);
@@ -276,7 +468,6 @@ void Log(LogLevel level, UString prefix, const UString &text)
 
 	if (writeToStderr)
 	{
-		fprintf(stderr, "%s %llu %s: %s\n", level_prefix, clockns, prefix.cStr(), text.cStr());
 		if (level <= backtraceLogLevel)
 			print_backtrace(stderr);
 		fflush(stderr);
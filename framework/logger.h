@@ -41,12 +41,25 @@ enum class LogLevel : int
 	Debug = 3,
 };
 void Log(LogLevel level, UString prefix, const UString &text);
+// Whether anything logged at level would be written anywhere, so the LogX() macros only format
+// what is
+bool logLevelEnabled(LogLevel level);
 
 NORETURN_FUNCTION void _logAssert(UString prefix, UString string, int line, UString file);
 
 // All logger output will be UTF8
 }; // namespace OpenApoc
 
+// The highest level that is compiled in at all. Calls above it evaluate nothing, not even their
+// arguments, so builds that never want them can leave LogInfo() in the hottest code for free
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX 3
+#endif
+
+#define LOG_LEVEL_ENABLED(level)                                                                   \
+	(static_cast<int>(OpenApoc::LogLevel::level) <= LOG_LEVEL_MAX &&                               \
+	 OpenApoc::logLevelEnabled(OpenApoc::LogLevel::level))
+
 #define LogAssert(X)                                                                               \
 	do                                                                                             \
 	{                                                                                              \
@@ -57,28 +70,25 @@ NORETURN_FUNCTION void _logAssert(UString prefix, UString string, int line, UStr
 //#ifndef __ANDROID__
 #if defined(__GNUC__)
 // GCC has an extension if __VA_ARGS__ are not supplied to 'remove' the precending comma
-#define LogDebug(f, ...)                                                                           \
-	OpenApoc::Log(OpenApoc::LogLevel::Debug, OpenApoc::UString(LOGGER_PREFIX),                     \
-	              ::OpenApoc::format(f, ##__VA_ARGS__))
-#define LogInfo(f, ...)                                                                            \
-	OpenApoc::Log(OpenApoc::LogLevel::Info, OpenApoc::UString(LOGGER_PREFIX),                      \
-	              ::OpenApoc::format(f, ##__VA_ARGS__))
-#define LogWarning(f, ...)                                                                         \
-	OpenApoc::Log(OpenApoc::LogLevel::Warning, OpenApoc::UString(LOGGER_PREFIX),                   \
-	              ::OpenApoc::format(f, ##__VA_ARGS__))
-#define LogError(f, ...)                                                                           \
-	OpenApoc::Log(OpenApoc::LogLevel::Error, OpenApoc::UString(LOGGER_PREFIX),                     \
-	              ::OpenApoc::format(f, ##__VA_ARGS__))
+#define LOG_AT_LEVEL(level, f, ...)                                                                \
+	(LOG_LEVEL_ENABLED(level) ? OpenApoc::Log(OpenApoc::LogLevel::level,                           \
+	                                          OpenApoc::UString(LOGGER_PREFIX),                     \
+	                                          ::OpenApoc::format(f, ##__VA_ARGS__))                 \
+	                          : (void)0)
+#define LogDebug(f, ...) LOG_AT_LEVEL(Debug, f, ##__VA_ARGS__)
+#define LogInfo(f, ...) LOG_AT_LEVEL(Info, f, ##__VA_ARGS__)
+#define LogWarning(f, ...) LOG_AT_LEVEL(Warning, f, ##__VA_ARGS__)
+#define LogError(f, ...) LOG_AT_LEVEL(Error, f, ##__VA_ARGS__)
 #else
 // At least msvc automatically removes the comma
-#define LogDebug(f, ...)                                                                           \
-	OpenApoc::Log(OpenApoc::LogLevel::Debug, LOGGER_PREFIX, ::OpenApoc::format(f, __VA_ARGS__))
-#define LogInfo(f, ...)                                                                            \
-	OpenApoc::Log(OpenApoc::LogLevel::Info, LOGGER_PREFIX, ::OpenApoc::format(f, __VA_ARGS__))
-#define LogWarning(f, ...)                                                                         \
-	OpenApoc::Log(OpenApoc::LogLevel::Warning, LOGGER_PREFIX, ::OpenApoc::format(f, __VA_ARGS__))
-#define LogError(f, ...)                                                                           \
-	OpenApoc::Log(OpenApoc::LogLevel::Error, LOGGER_PREFIX, ::OpenApoc::format(f, __VA_ARGS__))
+#define LOG_AT_LEVEL(level, f, ...)                                                                \
+	(LOG_LEVEL_ENABLED(level) ? OpenApoc::Log(OpenApoc::LogLevel::level, LOGGER_PREFIX,            \
+	                                          ::OpenApoc::format(f, __VA_ARGS__))                   \
+	                          : (void)0)
+#define LogDebug(f, ...) LOG_AT_LEVEL(Debug, f, __VA_ARGS__)
+#define LogInfo(f, ...) LOG_AT_LEVEL(Info, f, __VA_ARGS__)
+#define LogWarning(f, ...) LOG_AT_LEVEL(Warning, f, __VA_ARGS__)
+#define LogError(f, ...) LOG_AT_LEVEL(Error, f, __VA_ARGS__)
 #endif
 //#else
 #if 0
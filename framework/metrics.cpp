@@ -0,0 +1,242 @@
+#include "framework/metrics.h"
+#include "framework/configfile.h"
+#include "framework/logger.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+ConfigOptionString metricsFile("Metrics", "outputFile",
+                               "File to write snapshots of every metric to, one json object a "
+                               "line, or nothing for none",
+                               "");
+ConfigOptionInt metricsInterval("Metrics", "interval",
+                                "Seconds between snapshots written to the metrics file", 5);
+
+using Clock = std::chrono::steady_clock;
+
+class MetricsRegistry
+{
+  public:
+	std::mutex lock;
+	std::vector<Metric *> metrics;
+
+	static MetricsRegistry &get()
+	{
+		// Metrics are statics, so this has to be made on first use
+		static MetricsRegistry instance;
+		return instance;
+	}
+};
+
+// Only ever used from the thread calling Metrics::frame()
+class MetricsWriter
+{
+  public:
+	bool inited = false;
+	bool tracing = false;
+	std::ofstream outFile;
+	Clock::time_point start;
+	Clock::time_point lastWrite;
+	unsigned int frame = 0;
+	unsigned int lastFrame = 0;
+	// What every metric was at the last snapshot, by its place in the registry, for counters and
+	// histograms to be written as what changed since
+	std::vector<long long> lastTotals;
+	std::vector<std::vector<unsigned long long>> lastCounts;
+
+	void init();
+	void write();
+
+	static MetricsWriter &get()
+	{
+		static MetricsWriter instance;
+		return instance;
+	}
+};
+
+void MetricsWriter::init()
+{
+	inited = true;
+	auto path = metricsFile.get();
+	if (path.empty())
+	{
+		return;
+	}
+	outFile.open(path.str());
+	if (!outFile)
+	{
+		LogError("Failed to open metrics file \"%s\"", path);
+		return;
+	}
+	LogInfo("Writing metrics to \"%s\" every %ds", path, metricsInterval.get());
+	start = lastWrite = Clock::now();
+	Metrics::enabled = true;
+}
+
+void MetricsWriter::write()
+{
+	auto now = Clock::now();
+	auto seconds = std::chrono::duration<double>(now - lastWrite).count();
+	auto metrics = Metrics::getAll();
+	lastTotals.resize(metrics.size(), 0);
+	lastCounts.resize(metrics.size());
+
+	// Grouped as they are on trace tracks, in the order the first metric of each was made
+	std::vector<std::pair<UString, std::string>> groups;
+	for (size_t i = 0; i < metrics.size(); i++)
+	{
+		auto *metric = metrics[i];
+		std::string value;
+		switch (metric->kind)
+		{
+			case Metric::Kind::Counter:
+			{
+				auto total = static_cast<MetricCounter *>(metric)->getTotal();
+				value = format("%.2f", seconds > 0 ? (total - lastTotals[i]) / seconds : 0.0).str();
+				lastTotals[i] = total;
+				break;
+			}
+			case Metric::Kind::Gauge:
+				value = format("%lld", static_cast<MetricGauge *>(metric)->get()).str();
+				break;
+			case Metric::Kind::Histogram:
+			{
+				auto *histogram = static_cast<MetricHistogram *>(metric);
+				auto counts = histogram->getCounts();
+				auto &last = lastCounts[i];
+				last.resize(counts.size(), 0);
+				value = "{\"bounds\":[";
+				for (size_t b = 0; b < histogram->getBounds().size(); b++)
+				{
+					value += format(b ? ",%g" : "%g", histogram->getBounds()[b]).str();
+				}
+				value += "],\"counts\":[";
+				for (size_t b = 0; b < counts.size(); b++)
+				{
+					value += format(b ? ",%llu" : "%llu", counts[b] - last[b]).str();
+				}
+				value += "]}";
+				last = counts;
+				break;
+			}
+		}
+		auto group = std::find_if(groups.begin(), groups.end(),
+		                          [metric](const std::pair<UString, std::string> &g) {
+			                          return g.first == metric->group;
+		                          });
+		if (group == groups.end())
+		{
+			groups.emplace_back(metric->group, "");
+			group = groups.end() - 1;
+		}
+		else
+		{
+			group->second += ",";
+		}
+		group->second += "\"" + metric->name.str() + "\":" + value;
+	}
+
+	auto elapsed = std::chrono::duration<double>(now - start).count();
+	outFile << "{\"time\":" << format("%.3f", elapsed).str() << ",\"frame\":" << frame
+	        << ",\"fps\":"
+	        << format("%.2f", seconds > 0 ? (frame - lastFrame) / seconds : 0.0).str();
+	for (auto &group : groups)
+	{
+		outFile << ",\"" << group.first.str() << "\":{" << group.second << "}";
+	}
+	outFile << "}\n";
+	outFile.flush();
+	lastWrite = now;
+	lastFrame = frame;
+}
+
+} // anonymous namespace
+
+bool Metrics::enabled = false;
+
+std::vector<Metric *> Metrics::getAll()
+{
+	auto &registry = MetricsRegistry::get();
+	std::lock_guard<std::mutex> l(registry.lock);
+	return registry.metrics;
+}
+
+void Metrics::frame(unsigned int frame)
+{
+	auto &writer = MetricsWriter::get();
+	if (!writer.inited)
+	{
+		writer.init();
+	}
+	if (!writer.outFile.is_open())
+	{
+		return;
+	}
+	writer.frame = frame;
+	auto interval = std::chrono::seconds(std::max(1, metricsInterval.get()));
+	if (Clock::now() - writer.lastWrite >= interval)
+	{
+		writer.write();
+	}
+}
+
+void Metrics::finish()
+{
+	auto &writer = MetricsWriter::get();
+	if (!writer.outFile.is_open())
+	{
+		return;
+	}
+	writer.write();
+	writer.outFile.close();
+	enabled = writer.tracing;
+}
+
+void Metrics::setTracing(bool tracing)
+{
+	auto &writer = MetricsWriter::get();
+	writer.tracing = tracing;
+	enabled = tracing || writer.outFile.is_open();
+}
+
+Metric::Metric(const char *group, const char *name, Kind kind)
+    : group(group), name(name), kind(kind)
+{
+	auto &registry = MetricsRegistry::get();
+	std::lock_guard<std::mutex> l(registry.lock);
+	registry.metrics.push_back(this);
+}
+
+MetricHistogram::MetricHistogram(const char *group, const char *name, std::vector<double> bounds)
+    : Metric(group, name, Kind::Histogram), bounds(std::move(bounds)),
+      counts(this->bounds.size() + 1)
+{
+}
+
+void MetricHistogram::add(double value)
+{
+	if (!Metrics::enabled)
+		return;
+	auto bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+	counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<unsigned long long> MetricHistogram::getCounts() const
+{
+	std::vector<unsigned long long> values;
+	for (auto &count : counts)
+	{
+		values.push_back(count.load(std::memory_order_relaxed));
+	}
+	return values;
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "library/strings.h"
+#include <atomic>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class Metric;
+
+class Metrics
+{
+  public:
+	// Set while tracing or writing Metrics.outputFile, metrics keeping nothing otherwise
+	static bool enabled;
+
+	// Every metric made so far, in the order they were
+	static std::vector<Metric *> getAll();
+	// Called by Framework::run() every frame, writing a snapshot of every metric to
+	// Metrics.outputFile once Metrics.interval seconds have passed since the last
+	static void frame(unsigned int frame);
+	// Writes the last snapshot and closes the file
+	static void finish();
+	// For metrics to be kept while tracing, which records them every frame
+	static void setTracing(bool tracing);
+};
+
+// A value subsystems keep up to date from any thread. Each is recorded in the trace on the counter
+// track called group, and written to Metrics.outputFile with the others of its group, one json
+// object a snapshot. Metrics are meant to be statics, as they stay registered for good
+class Metric
+{
+  public:
+	enum class Kind
+	{
+		Counter,
+		Gauge,
+		Histogram,
+	};
+
+	const UString group;
+	const UString name;
+	const Kind kind;
+
+  protected:
+	Metric(const char *group, const char *name, Kind kind);
+	~Metric() = default;
+};
+
+// Counts things happening, such as rays cast. The trace has how many happened each frame, the
+// metrics file how many a second
+class MetricCounter : public Metric
+{
+  public:
+	MetricCounter(const char *group, const char *name) : Metric(group, name, Kind::Counter) {}
+
+	void add(long long count = 1)
+	{
+		if (Metrics::enabled)
+			total.fetch_add(count, std::memory_order_relaxed);
+	}
+	long long getTotal() const { return total.load(std::memory_order_relaxed); }
+
+  private:
+	std::atomic<long long> total{0};
+};
+
+// The level of something, such as how many units there are, kept until set again
+class MetricGauge : public Metric
+{
+  public:
+	MetricGauge(const char *group, const char *name) : Metric(group, name, Kind::Gauge) {}
+
+	void set(long long level)
+	{
+		if (Metrics::enabled)
+			value.store(level, std::memory_order_relaxed);
+	}
+	long long get() const { return value.load(std::memory_order_relaxed); }
+
+  private:
+	std::atomic<long long> value{0};
+};
+
+// How values such as durations are spread, each counted in the first of bounds it is not above,
+// or in one more bucket past the last. Only written to the metrics file, as a frame rarely has
+// enough of them to say much
+class MetricHistogram : public Metric
+{
+  public:
+	MetricHistogram(const char *group, const char *name, std::vector<double> bounds);
+
+	void add(double value);
+	const std::vector<double> &getBounds() const { return bounds; }
+	// How many values there have been in each bucket so far
+	std::vector<unsigned long long> getCounts() const;
+
+  private:
+	const std::vector<double> bounds;
+	std::vector<std::atomic<unsigned long long>> counts;
+};
+
+}; // namespace OpenApoc
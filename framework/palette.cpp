@@ -1,4 +1,6 @@
 #include "framework/palette.h"
+#include "framework/renderer.h"
+#include <utility>
 
 namespace OpenApoc
 {
@@ -9,7 +11,7 @@ Palette::Palette(unsigned int size, Colour initialColour) : colours(size)
 		colours[i] = initialColour;
 }
 
-Palette::~Palette() = default;
+Palette::~Palette() { releaseRendererData(std::move(this->rendererPrivateData)); }
 
 Palette::Palette(const Palette &source) { this->colours = source.colours; }
 
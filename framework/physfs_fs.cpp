@@ -7,6 +7,8 @@
 #include "framework/fs.h"
 #include "framework/logger.h"
 #include "framework/trace.h"
+#include <algorithm>
+#include <cstring>
 #include <physfs.h>
 
 #ifdef _WIN32
@@ -79,6 +81,29 @@ class PhysfsIFileImpl : public std::streambuf, public IFileImpl
 		return static_cast<unsigned char>(*gptr());
 	}
 
+	// Reads of a buffer's worth or more, like readAll() and loaders reading whole tables, go
+	// straight from the file into s once what is buffered is used up, rather than a buffer's
+	// worth at a time through the buffer
+	std::streamsize xsgetn(char_type *s, std::streamsize count) override
+	{
+		std::streamsize done = std::min<std::streamsize>(count, egptr() - gptr());
+		if (done > 0)
+		{
+			std::memcpy(s, gptr(), static_cast<size_t>(done));
+			setg(eback(), gptr() + done, egptr());
+		}
+		if (count - done < static_cast<std::streamsize>(bufferSize))
+		{
+			return done + std::streambuf::xsgetn(s + done, count - done);
+		}
+		auto bytesRead = PHYSFS_readBytes(file, s + done, static_cast<PHYSFS_uint64>(count - done));
+		if (bytesRead > 0)
+		{
+			done += static_cast<std::streamsize>(bytesRead);
+		}
+		return done;
+	}
+
 	pos_type seekoff(off_type pos, std::ios_base::seekdir dir,
 	                 std::ios_base::openmode mode) override
 	{
@@ -301,14 +326,16 @@ static std::list<UString> recursiveFindFilesInDirectory(const FileSystem &fs, US
 	auto list = fs.enumerateDirectory(path, "");
 	for (auto &entry : list)
 	{
-		if (entry.endsWith(extension))
+		auto entryPath = path + "/" + entry;
+		PHYSFS_Stat stat;
+		if (PHYSFS_stat(entryPath.cStr(), &stat) && stat.filetype == PHYSFS_FILETYPE_DIRECTORY)
 		{
-			foundFiles.push_back(path + "/" + entry);
+			auto subdirFiles = recursiveFindFilesInDirectory(fs, entryPath, extension);
+			foundFiles.insert(foundFiles.end(), subdirFiles.begin(), subdirFiles.end());
 		}
-		else
+		else if (entry.endsWith(extension))
 		{
-			auto subdirFiles = recursiveFindFilesInDirectory(fs, path + "/" + entry, extension);
-			foundFiles.insert(foundFiles.end(), subdirFiles.begin(), subdirFiles.end());
+			foundFiles.push_back(entryPath);
 		}
 	}
 	return foundFiles;
@@ -4,9 +4,12 @@
 #include "framework/renderer.h"
 #include "framework/renderer_interface.h"
 #include "library/sp.h"
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <glm/gtx/rotate_vector.hpp>
 #include <memory>
+#include <vector>
 
 /* Workaround MSVC not liking int64_t being defined here and in allegro */
 #define GLEXT_64_TYPES_DEFINED
@@ -18,6 +21,9 @@ namespace
 
 using namespace OpenApoc;
 
+// Those of the renderer, which everything drawing or uploading counts towards
+static RendererStats *stats = nullptr;
+
 class Program
 {
   public:
@@ -287,6 +293,78 @@ class PaletteProgram : public SpriteProgram
 	}
 };
 
+// Same as PaletteProgram, but with the tint given for every vertex, so sprites with different tints
+// can be drawn in one go
+const char *BatchProgram_vertexSource = {
+    "#version 110\n"
+    "attribute vec2 position;\n"
+    "attribute vec2 texcoord_in;\n"
+    "attribute vec4 tint_in;\n"
+    "varying vec2 texcoord;\n"
+    "varying vec4 tint;\n"
+    "uniform vec2 screenSize;\n"
+    "uniform bool flipY;\n"
+    "void main() {\n"
+    "  texcoord = texcoord_in;\n"
+    "  tint = tint_in;\n"
+    "  vec2 tmpPos = position;\n"
+    "  tmpPos /= screenSize;\n"
+    "  tmpPos -= vec2(0.5,0.5);\n"
+    "  if (flipY) gl_Position = vec4((tmpPos.x*2.0), -(tmpPos.y*2.0),0.0,1.0);\n"
+    "  else gl_Position = vec4((tmpPos.x*2.0), (tmpPos.y*2.0),0.0,1.0);\n"
+    "}\n"};
+const char *BatchProgram_fragmentSource = {
+    "#version 110\n"
+    "varying vec2 texcoord;\n"
+    "varying vec4 tint;\n"
+    "uniform sampler2D tex;\n"
+    "uniform sampler2D pal;\n"
+    "void main() {\n"
+    " float idx = texture2D(tex, texcoord,0.0).r;\n"
+    " gl_FragColor = tint * texture2D(pal, vec2(idx,0.0),0.0);\n"
+    "}\n"};
+class BatchProgram : public Program
+{
+  private:
+	Vec2<int> currentScreenSize;
+	bool currentFlipY;
+
+  public:
+	GLint posLoc;
+	GLint texcoordLoc;
+	GLint tintLoc;
+	GLint screenSizeLoc;
+	GLint flipYLoc;
+	BatchProgram()
+	    : Program(BatchProgram_vertexSource, BatchProgram_fragmentSource), currentScreenSize(0, 0),
+	      currentFlipY(false)
+	{
+		this->posLoc = gl20::GetAttribLocation(this->prog, "position");
+		this->texcoordLoc = gl20::GetAttribLocation(this->prog, "texcoord_in");
+		this->tintLoc = gl20::GetAttribLocation(this->prog, "tint_in");
+		this->screenSizeLoc = gl20::GetUniformLocation(this->prog, "screenSize");
+		this->flipYLoc = gl20::GetUniformLocation(this->prog, "flipY");
+		// The textures are always on the same units
+		gl20::UseProgram(this->prog);
+		this->uniform(gl20::GetUniformLocation(this->prog, "tex"), 0);
+		this->uniform(gl20::GetUniformLocation(this->prog, "pal"), 1);
+		gl20::UseProgram(0);
+	}
+	void setUniforms(Vec2<int> screenSize, bool flipY)
+	{
+		if (screenSize != currentScreenSize)
+		{
+			currentScreenSize = screenSize;
+			this->uniform(this->screenSizeLoc, screenSize);
+		}
+		if (currentFlipY != flipY)
+		{
+			currentFlipY = flipY;
+			this->uniform(this->flipYLoc, flipY);
+		}
+	}
+};
+
 const char *SolidColourProgram_vertexSource = {
     "#version 110\n"
     "attribute vec2 position;\n"
@@ -390,12 +468,14 @@ class Quad
 		gl20::EnableVertexAttribArray(texcoordAttribPos);
 		gl20::VertexAttribPointer(texcoordAttribPos, 2, gl20::FLOAT, gl20::FALSE_, 0, &texcoords);
 		gl20::DrawArrays(gl20::TRIANGLE_STRIP, 0, 4);
+		stats->drawCalls++;
 	}
 	void draw(GLuint vertexAttribPos)
 	{
 		gl20::EnableVertexAttribArray(vertexAttribPos);
 		gl20::VertexAttribPointer(vertexAttribPos, 2, gl20::FLOAT, gl20::FALSE_, 0, &vertices);
 		gl20::DrawArrays(gl20::TRIANGLE_STRIP, 0, 4);
+		stats->drawCalls++;
 	}
 };
 class Line
@@ -413,6 +493,7 @@ class Line
 		gl20::EnableVertexAttribArray(vertexAttribPos);
 		gl20::VertexAttribPointer(vertexAttribPos, 2, gl20::FLOAT, gl20::FALSE_, 0, &vertices);
 		gl20::DrawArrays(gl20::LINES, 0, 2);
+		stats->drawCalls++;
 	}
 };
 class ActiveTexture
@@ -605,6 +686,7 @@ class GLRGBImage : public RendererImageData
 		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_WRAP_T, gl20::CLAMP_TO_EDGE);
 		gl20::TexImage2D(gl20::TEXTURE_2D, 0, gl20::RGBA, parent->size.x, parent->size.y, 0,
 		                 gl20::RGBA, gl20::UNSIGNED_BYTE, l.getData());
+		stats->textureUploads++;
 	}
 	~GLRGBImage() override { gl20::DeleteTextures(1, &this->texID); }
 };
@@ -625,6 +707,7 @@ class GLPalette : public RendererImageData
 		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_WRAP_T, gl20::CLAMP_TO_EDGE);
 		gl20::TexImage2D(gl20::TEXTURE_2D, 0, gl20::RGBA, parent->colours.size(), 1, 0, gl20::RGBA,
 		                 gl20::UNSIGNED_BYTE, parent->colours.data());
+		stats->textureUploads++;
 	}
 	~GLPalette() override { gl20::DeleteTextures(1, &this->texID); }
 };
@@ -647,19 +730,108 @@ class GLPaletteImage : public RendererImageData
 		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_WRAP_T, gl20::CLAMP_TO_EDGE);
 		gl20::TexImage2D(gl20::TEXTURE_2D, 0, 1, parent->size.x, parent->size.y, 0, gl20::RED,
 		                 gl20::UNSIGNED_BYTE, l.getData());
+		stats->textureUploads++;
 	}
 	~GLPaletteImage() override { gl20::DeleteTextures(1, &this->texID); }
 };
 
+// Texture many small palette images are packed into, so that drawing any of them needs no other
+// texture bound and they can be drawn in one go. Images are packed left to right in shelves
+// as tall as the tallest image on them, and stay until the renderer goes
+class PaletteAtlasPage
+{
+	PaletteAtlasPage(const PaletteAtlasPage &) = delete;
+
+  public:
+	GLuint texID;
+	Vec2<int> size;
+	Vec2<int> shelfPosition = {0, 0};
+	int shelfHeight = 0;
+
+	PaletteAtlasPage(Vec2<int> size) : size(size)
+	{
+		gl20::GenTextures(1, &this->texID);
+		BindTexture b(this->texID);
+		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_MIN_FILTER, gl20::NEAREST);
+		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_MAG_FILTER, gl20::NEAREST);
+		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_WRAP_S, gl20::CLAMP_TO_EDGE);
+		gl20::TexParameteri(gl20::TEXTURE_2D, gl20::TEXTURE_WRAP_T, gl20::CLAMP_TO_EDGE);
+		gl20::TexImage2D(gl20::TEXTURE_2D, 0, 1, size.x, size.y, 0, gl20::RED, gl20::UNSIGNED_BYTE,
+		                 NULL);
+	}
+	~PaletteAtlasPage() { gl20::DeleteTextures(1, &this->texID); }
+
+	// Returns false, changing nothing, if image does not fit in what is left of the page
+	bool add(sp<PaletteImage> image, Rect<float> &texCoords)
+	{
+		// A texel is left between images, so nothing else can bleed into one
+		Vec2<int> paddedSize = Vec2<int>{image->size} + Vec2<int>{1, 1};
+		auto position = shelfPosition;
+		auto height = shelfHeight;
+		if (position.x + paddedSize.x > size.x)
+		{
+			position = {0, position.y + height};
+			height = 0;
+		}
+		if (position.x + paddedSize.x > size.x || position.y + paddedSize.y > size.y)
+		{
+			return false;
+		}
+		shelfPosition = {position.x + paddedSize.x, position.y};
+		shelfHeight = std::max(height, paddedSize.y);
+
+		PaletteImageLock l(image, ImageLockUse::Read);
+		BindTexture b(this->texID);
+		UnpackAlignment align(1);
+		gl20::TexSubImage2D(gl20::TEXTURE_2D, 0, position.x, position.y, image->size.x,
+		                    image->size.y, gl20::RED, gl20::UNSIGNED_BYTE, l.getData());
+		stats->textureUploads++;
+		Vec2<float> pageSize = size;
+		texCoords = {Vec2<float>{position} / pageSize,
+		             Vec2<float>{position + Vec2<int>{image->size}} / pageSize};
+		return true;
+	}
+};
+
+class GLPaletteAtlasImage : public RendererImageData
+{
+  public:
+	// Of the page it is on
+	GLuint texID;
+	Rect<float> texCoords;
+	GLPaletteAtlasImage(GLuint texID, Rect<float> texCoords) : texID(texID), texCoords(texCoords)
+	{
+	}
+};
+
+class BatchVertex
+{
+  public:
+	Vec2<float> position;
+	Vec2<float> texcoord;
+	Colour tint;
+};
+
 class OGL20Renderer : public Renderer
 {
   private:
 	sp<RGBProgram> rgbProgram;
 	sp<SolidColourProgram> colourProgram;
 	sp<PaletteProgram> paletteProgram;
+	sp<BatchProgram> batchProgram;
 	GLuint currentBoundProgram;
 	GLuint currentBoundFBO;
 
+	// Palette images no larger than this are packed into the atlas
+	Vec2<unsigned int> maxAtlasImageSize = {256, 256};
+	unsigned int maxAtlasPages = 4;
+	std::vector<up<PaletteAtlasPage>> atlasPages;
+	// Sprites from the atlas waiting to be drawn, all from the page batchTexID is
+	unsigned int maxBatchSprites = 4096;
+	std::vector<BatchVertex> batchVertices;
+	GLuint batchTexID = 0;
+	GLuint batchBuffer = 0;
+
 	sp<Surface> currentSurface;
 	sp<Palette> currentPalette;
 
@@ -686,8 +858,10 @@ class OGL20Renderer : public Renderer
   public:
 	OGL20Renderer()
 	    : rgbProgram(new RGBProgram()), colourProgram(new SolidColourProgram()),
-	      paletteProgram(new PaletteProgram()), currentBoundProgram(0), currentBoundFBO(0)
+	      paletteProgram(new PaletteProgram()), batchProgram(new BatchProgram()),
+	      currentBoundProgram(0), currentBoundFBO(0)
 	{
+		stats = &this->frameStats;
 		GLint viewport[4];
 		gl20::GetIntegerv(gl20::VIEWPORT, viewport);
 		LogInfo("Viewport {%d,%d,%d,%d}", viewport[0], viewport[1], viewport[2], viewport[3]);
@@ -702,8 +876,24 @@ class OGL20Renderer : public Renderer
 		gl20::Enable(gl20::BLEND);
 		gl20::BlendFuncSeparate(gl20::SRC_ALPHA, gl20::ONE_MINUS_SRC_ALPHA, gl20::SRC_ALPHA,
 		                        gl20::DST_ALPHA);
+
+		GLint maxTextureSize;
+		gl20::GetIntegerv(gl20::MAX_TEXTURE_SIZE, &maxTextureSize);
+		LogInfo("MAX_TEXTURE_SIZE: %d", maxTextureSize);
+		if (maxTextureSize < 2048)
+		{
+			LogInfo("Not packing palette images into an atlas");
+			this->maxAtlasPages = 0;
+		}
+		gl20::GenBuffers(1, &this->batchBuffer);
+		this->batchVertices.reserve(this->maxBatchSprites * 6);
+	}
+	~OGL20Renderer() override
+	{
+		if (this->batchBuffer)
+			gl20::DeleteBuffers(1, &this->batchBuffer);
+		stats = nullptr;
 	}
-	~OGL20Renderer() override = default;
 	void clear(Colour c = Colour{0, 0, 0, 0}) override
 	{
 		this->flush();
@@ -727,6 +917,7 @@ class OGL20Renderer : public Renderer
 	void drawRotated(sp<Image> image, Vec2<float> center, Vec2<float> position,
 	                 float angle) override
 	{
+		this->frameStats.sprites++;
 		auto size = image->size;
 		sp<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
 		if (rgbImage)
@@ -752,7 +943,7 @@ class OGL20Renderer : public Renderer
 	void drawScaledImage(sp<Image> image, Vec2<float> position, Vec2<float> size,
 	                     Scaler scaler = Scaler::Linear, Colour tint = {255, 255, 255, 255})
 	{
-
+		this->frameStats.sprites++;
 		sp<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
 		if (rgbImage)
 		{
@@ -769,6 +960,21 @@ class OGL20Renderer : public Renderer
 		sp<PaletteImage> paletteImage = std::dynamic_pointer_cast<PaletteImage>(image);
 		if (paletteImage)
 		{
+			if (!paletteImage->rendererPrivateData)
+			{
+				this->addToAtlas(paletteImage);
+			}
+			auto *atlasImg =
+			    dynamic_cast<GLPaletteAtlasImage *>(paletteImage->rendererPrivateData.get());
+			if (atlasImg)
+			{
+				if (scaler != Scaler::Nearest)
+				{
+					LogError("Only nearest scaler is supported on paletted images");
+				}
+				this->drawBatched(*atlasImg, position, size, tint);
+				return;
+			}
 			GLPaletteImage *img =
 			    dynamic_cast<GLPaletteImage *>(paletteImage->rendererPrivateData.get());
 			if (!img)
@@ -807,6 +1013,7 @@ class OGL20Renderer : public Renderer
 	}
 	void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) override
 	{
+		this->flush();
 		bindProgram(colourProgram);
 		Rect<float> pos(position, position + size);
 		bool flipY = false;
@@ -885,10 +1092,88 @@ class OGL20Renderer : public Renderer
 		this->drawFilledRect(C, sizeC, c);
 		this->drawFilledRect(D, sizeD, c);
 	}
-	void flush() override { /* Nothing to flush */}
+	void flush() override
+	{
+		if (this->batchVertices.empty())
+			return;
+		bindProgram(batchProgram);
+		bool flipY = false;
+		if (currentBoundFBO == 0)
+			flipY = true;
+		batchProgram->setUniforms(this->currentSurface->size, flipY);
+		BindTexture t(this->batchTexID, 0);
+		BindTexture p(
+		    static_cast<GLPalette *>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+
+		gl20::BindBuffer(gl20::ARRAY_BUFFER, this->batchBuffer);
+		// Handing over a new store each time leaves the last one to the driver while it is in use
+		gl20::BufferData(gl20::ARRAY_BUFFER, this->batchVertices.size() * sizeof(BatchVertex),
+		                 this->batchVertices.data(), gl20::STREAM_DRAW);
+		GLuint locs[] = {static_cast<GLuint>(batchProgram->posLoc),
+		                 static_cast<GLuint>(batchProgram->texcoordLoc),
+		                 static_cast<GLuint>(batchProgram->tintLoc)};
+		for (auto loc : locs)
+			gl20::EnableVertexAttribArray(loc);
+		gl20::VertexAttribPointer(locs[0], 2, gl20::FLOAT, gl20::FALSE_, sizeof(BatchVertex),
+		                          reinterpret_cast<void *>(offsetof(BatchVertex, position)));
+		gl20::VertexAttribPointer(locs[1], 2, gl20::FLOAT, gl20::FALSE_, sizeof(BatchVertex),
+		                          reinterpret_cast<void *>(offsetof(BatchVertex, texcoord)));
+		gl20::VertexAttribPointer(locs[2], 4, gl20::UNSIGNED_BYTE, gl20::TRUE_,
+		                          sizeof(BatchVertex),
+		                          reinterpret_cast<void *>(offsetof(BatchVertex, tint)));
+		gl20::DrawArrays(gl20::TRIANGLES, 0, this->batchVertices.size());
+		stats->drawCalls++;
+		// Everything else draws from client memory, with pointers set up every time
+		for (auto loc : locs)
+			gl20::DisableVertexAttribArray(loc);
+		gl20::BindBuffer(gl20::ARRAY_BUFFER, 0);
+		this->batchVertices.clear();
+	}
+	void newFrame() override { this->frameStats.texturePages = this->atlasPages.size(); }
 	UString getName() override { return "OGL2.0 Renderer"; }
 	sp<Surface> getDefaultSurface() override { return this->defaultSurface; }
 
+	void addToAtlas(sp<PaletteImage> image)
+	{
+		if (image->size.x > this->maxAtlasImageSize.x ||
+		    image->size.y > this->maxAtlasImageSize.y)
+			return;
+		Rect<float> texCoords;
+		for (auto &page : this->atlasPages)
+		{
+			if (page->add(image, texCoords))
+			{
+				image->rendererPrivateData.reset(new GLPaletteAtlasImage(page->texID, texCoords));
+				return;
+			}
+		}
+		if (this->atlasPages.size() >= this->maxAtlasPages)
+			return;
+		this->atlasPages.emplace_back(new PaletteAtlasPage({2048, 2048}));
+		LogInfo("Added palette atlas page %u", static_cast<unsigned>(this->atlasPages.size()));
+		if (this->atlasPages.back()->add(image, texCoords))
+			image->rendererPrivateData.reset(
+			    new GLPaletteAtlasImage(this->atlasPages.back()->texID, texCoords));
+	}
+	void drawBatched(GLPaletteAtlasImage &img, Vec2<float> offset, Vec2<float> size, Colour tint)
+	{
+		if (img.texID != this->batchTexID ||
+		    this->batchVertices.size() >= this->maxBatchSprites * 6)
+		{
+			this->flush();
+			this->batchTexID = img.texID;
+		}
+		Vec2<float> p0 = offset;
+		Vec2<float> p1 = offset + size;
+		Vec2<float> t0 = img.texCoords.p0;
+		Vec2<float> t1 = img.texCoords.p1;
+		this->batchVertices.push_back({p0, t0, tint});
+		this->batchVertices.push_back({{p1.x, p0.y}, {t1.x, t0.y}, tint});
+		this->batchVertices.push_back({{p0.x, p1.y}, {t0.x, t1.y}, tint});
+		this->batchVertices.push_back({{p0.x, p1.y}, {t0.x, t1.y}, tint});
+		this->batchVertices.push_back({{p1.x, p0.y}, {t1.x, t0.y}, tint});
+		this->batchVertices.push_back({p1, t1, tint});
+	}
 	void bindProgram(sp<Program> p)
 	{
 		if (this->currentBoundProgram == p->prog)
@@ -900,6 +1185,7 @@ class OGL20Renderer : public Renderer
 	             Vec2<float> rotationCenter = {0, 0}, float rotationAngleRadians = 0,
 	             Colour tint = {255, 255, 255, 255})
 	{
+		this->flush();
 		GLenum filter;
 		Rect<float> pos(offset, offset + size);
 		switch (scaler)
@@ -929,6 +1215,7 @@ class OGL20Renderer : public Renderer
 	void drawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size,
 	                 Colour tint = {255, 255, 255, 255})
 	{
+		this->flush();
 		bindProgram(paletteProgram);
 		Rect<float> pos(offset, offset + size);
 		bool flipY = false;
@@ -946,6 +1233,7 @@ class OGL20Renderer : public Renderer
 	void drawSurface(FBOData &fbo, Vec2<float> offset, Vec2<float> size, Scaler scaler,
 	                 Colour tint = {255, 255, 255, 255})
 	{
+		this->flush();
 		GLenum filter;
 		Rect<float> pos(offset, offset + size);
 		switch (scaler)
@@ -975,6 +1263,7 @@ class OGL20Renderer : public Renderer
 
 	void drawLine(Vec2<float> p0, Vec2<float> p1, Colour c, float thickness) override
 	{
+		this->flush();
 		bindProgram(colourProgram);
 		bool flipY = false;
 		if (currentBoundFBO == 0)
@@ -1,12 +1,19 @@
+#include "framework/configfile.h"
+#include "framework/data.h"
+#include "framework/framework.h"
 #include "framework/image.h"
 #include "framework/logger.h"
 #include "framework/palette.h"
 #include "framework/renderer.h"
 #include "framework/renderer_interface.h"
 #include "framework/trace.h"
+#include "library/strings_format.h"
 #include <algorithm>
 #include <cstdint>
+#include <fstream>
 #include <glm/gtx/rotate_vector.hpp>
+#include <iterator>
+#include <vector>
 
 #define GLESWRAP_GLES3
 #include "framework/render/gles30_v2/gleswrap.h"
@@ -24,6 +31,8 @@ namespace
 using GL = gles_wrap::Gles3;
 
 static up<GL> gl;
+// Those of the renderer, which everything drawing or uploading counts towards
+static RendererStats *stats = nullptr;
 
 static const auto RGB_IMAGE_TEX_SLOT = GL::TEXTURE0;
 static const int RGB_IMAGE_TEX_IDX = 0;
@@ -34,6 +43,18 @@ static const int PALETTE_TEX_IDX = 2;
 
 static const auto SCRATCH_TEX_SLOT = GL::TEXTURE3;
 
+ConfigOptionBool programCacheOption(
+    "Framework", "GLES30ProgramCache",
+    "Keep the GLES3 renderer's compiled shader programs for the next run, if the driver allows",
+    true);
+
+ConfigOptionBool packUploadedImagesOption(
+    "Framework", "PackUploadedImages",
+    "Keep the sprites of image packs run length encoded once they are on the GPU", true);
+
+// Starts every file of a stored program, followed by the binary format and the binary itself
+static const char PROGRAM_CACHE_MAGIC[4] = {'O', 'A', 'P', 'B'};
+
 GL::GLuint CreateShader(GL::GLenum type, const UString &source)
 {
 	GL::GLuint shader = gl->CreateShader(type);
@@ -59,8 +80,110 @@ GL::GLuint CreateShader(GL::GLenum type, const UString &source)
 	return 0;
 }
 
+// Where the program built from these sources is stored, different for every driver and version of
+// one, or empty if programs can't be stored
+UString getProgramCachePath(const UString &vertexSource, const UString &fragmentSource)
+{
+	if (!programCacheOption.get())
+	{
+		return "";
+	}
+	GL::GLint formatCount = 0;
+	gl->GetIntegerv(GL::NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+	{
+		return "";
+	}
+	// FNV-1a over everything a binary depends on
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const std::string &s) {
+		for (auto c : s)
+		{
+			hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+		}
+		hash = (hash ^ 0xff) * 1099511628211ull;
+	};
+	for (auto name : {GL::VENDOR, GL::RENDERER, GL::VERSION})
+	{
+		auto string = gl->GetString(name);
+		add(string ? reinterpret_cast<const char *>(string) : "");
+	}
+	add(vertexSource.str());
+	add(fragmentSource.str());
+	return format("%s/gles3_program_%016llx.bin", fw().data->fs.getWriteDir(),
+	              (unsigned long long)hash);
+}
+
+// Returns the program stored at path, or 0 if there is none the driver still takes
+GL::GLuint LoadProgram(const UString &path)
+{
+	std::ifstream file(path.str(), std::ios::binary);
+	if (!file)
+	{
+		return 0;
+	}
+	char magic[sizeof(PROGRAM_CACHE_MAGIC)];
+	uint32_t binaryFormat = 0;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char *>(&binaryFormat), sizeof(binaryFormat));
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)),
+	                         std::istreambuf_iterator<char>());
+	if (!file.eof() || !std::equal(magic, magic + sizeof(magic), PROGRAM_CACHE_MAGIC) ||
+	    binary.empty())
+	{
+		LogWarning("Ignoring broken stored program \"%s\"", path);
+		return 0;
+	}
+	GL::GLuint prog = gl->CreateProgram();
+	gl->ProgramBinary(prog, static_cast<GL::GLenum>(binaryFormat), binary.data(), binary.size());
+	GL::GLint linkStatus;
+	gl->GetProgramiv(prog, GL::LINK_STATUS, &linkStatus);
+	if (linkStatus == GL::TRUE)
+	{
+		return prog;
+	}
+	// Drivers can turn down their own binaries, after an update that kept the version string
+	LogInfo("Stored program \"%s\" no longer taken, compiling it again", path);
+	gl->DeleteProgram(prog);
+	return 0;
+}
+
+void StoreProgram(GL::GLuint prog, const UString &path)
+{
+	GL::GLint length = 0;
+	gl->GetProgramiv(prog, GL::PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+	std::vector<char> binary(length);
+	GL::GLenum binaryFormat = static_cast<GL::GLenum>(0);
+	gl->GetProgramBinary(prog, length, &length, &binaryFormat, binary.data());
+	std::ofstream file(path.str(), std::ios::binary | std::ios::trunc);
+	uint32_t storedFormat = binaryFormat;
+	file.write(PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+	file.write(reinterpret_cast<const char *>(&storedFormat), sizeof(storedFormat));
+	file.write(binary.data(), length);
+	if (!file)
+	{
+		LogWarning("Failed to store program \"%s\"", path);
+	}
+}
+
+// Builds the program from the sources, or takes the one stored by an earlier run on the same
+// driver if there is one
 GL::GLuint CompileProgram(const UString &vertexSource, const UString &fragmentSource)
 {
+	auto cachePath = getProgramCachePath(vertexSource, fragmentSource);
+	if (!cachePath.empty())
+	{
+		auto cached = LoadProgram(cachePath);
+		if (cached)
+		{
+			return cached;
+		}
+	}
+
 	GL::GLuint prog = 0;
 	GL::GLuint vShader = CreateShader(GL::VERTEX_SHADER, vertexSource);
 	if (!vShader)
@@ -83,12 +206,23 @@ GL::GLuint CompileProgram(const UString &vertexSource, const UString &fragmentSo
 	gl->DeleteShader(vShader);
 	gl->DeleteShader(fShader);
 
+	if (!cachePath.empty())
+	{
+		gl->ProgramParameteri(prog, static_cast<GL::GLenum>(GL::PROGRAM_BINARY_RETRIEVABLE_HINT),
+		                      GL::TRUE);
+	}
 	gl->LinkProgram(prog);
 
 	GL::GLint linkStatus;
 	gl->GetProgramiv(prog, GL::LINK_STATUS, &linkStatus);
 	if (linkStatus == GL::TRUE)
+	{
+		if (!cachePath.empty())
+		{
+			StoreProgram(prog, cachePath);
+		}
 		return prog;
+	}
 
 	GL::GLint logLength;
 	gl->GetProgramiv(prog, GL::INFO_LOG_LENGTH, &logLength);
@@ -116,8 +250,8 @@ struct SpriteDescription
 class SpritesheetEntry final : public RendererImageData
 {
   public:
-	SpritesheetEntry(Vec2<int> size, sp<Image> parent)
-	    : parent(parent), position({-1, -1}), size(size), page(-1)
+	SpritesheetEntry(Vec2<int> size, sp<Image> parent, bool usesPalette)
+	    : parent(parent), position({-1, -1}), size(size), page(-1), usesPalette(usesPalette)
 	{
 	}
 	wp<Image> parent;
@@ -125,6 +259,8 @@ class SpritesheetEntry final : public RendererImageData
 	Vec2<int> size;
 	// page == -1 means it's not yet packed into a spritesheet
 	int page;
+	// Which of the spritesheets it is in, the paletted or the RGB one
+	bool usesPalette;
 	~SpritesheetEntry() override = default;
 };
 
@@ -169,6 +305,8 @@ class SpritesheetPage
 				int idx = rects[i].id;
 				entries[idx]->page = this->page_no;
 				entries[idx]->position = {rects[i].x, rects[i].y};
+				this->entries.push_back(entries[idx]);
+				this->packed_area += rects[i].w * rects[i].h;
 			}
 		}
 	}
@@ -185,12 +323,33 @@ class SpritesheetPage
 			entry->position = {r.x, r.y};
 			entry->page = this->page_no;
 			this->entries.push_back(entry);
+			this->packed_area += r.w * r.h;
 			return true;
 		}
 		return false;
 	}
 
+	// Area of the entries still around, dropping those that are not from the list
+	int64_t getLiveArea()
+	{
+		int64_t area = 0;
+		for (auto it = this->entries.begin(); it != this->entries.end();)
+		{
+			auto entry = it->lock();
+			if (!entry)
+			{
+				it = this->entries.erase(it);
+				continue;
+			}
+			area += entry->size.x * entry->size.y;
+			++it;
+		}
+		return area;
+	}
+
 	std::list<wp<SpritesheetEntry>> entries;
+	// Area taken up by every entry ever packed in, as stb_rect_pack cannot give any of it back
+	int64_t packed_area = 0;
 };
 
 class Spritesheet
@@ -199,8 +358,40 @@ class Spritesheet
 	// stb_rect_pack)
 	const int node_count = 4096;
 
+	// Pages are only ever dropped to stay within the limit once they have not been drawn from for
+	// this many frames, so pages all drawn from on screen at once are not dropped and packed again
+	// every frame
+	const uint64_t page_eviction_frames = 600;
+
+	uint64_t current_frame = 0;
+	// Frame each page was last drawn from, by page number
+	std::vector<uint64_t> page_last_used;
+
+	// Drops every entry on a page, so the images on it are put back in a spritesheet the next
+	// time they are drawn
+	void evict(int page_no)
+	{
+		TRACE_FN;
+		auto &page = this->pages[page_no];
+		for (auto &entryPtr : page->entries)
+		{
+			auto entry = entryPtr.lock();
+			if (!entry)
+				continue;
+			entry->page = -1;
+			entry->position = {-1, -1};
+			auto image = entry->parent.lock();
+			if (image && image->rendererPrivateData == entry)
+			{
+				image->rendererPrivateData = nullptr;
+			}
+		}
+		page->entries.clear();
+	}
+
   public:
 	std::vector<sp<SpritesheetPage>> pages;
+	unsigned int getPageCount() const { return this->pages.size(); }
 	Vec2<int> page_size;
 	GL::GLenum format;
 	GL::GLuint tex_id;
@@ -272,18 +463,27 @@ class Spritesheet
 			gl->TexSubImage3D(GL::TEXTURE_2D_ARRAY, 0, entry->position.x, entry->position.y,
 			                  entry->page, entry->size.x, entry->size.y, 1, GL::RGBA,
 			                  GL::UNSIGNED_BYTE, l.getData());
+			stats->textureUploads++;
 			return;
 		}
 		auto palImage = std::dynamic_pointer_cast<PaletteImage>(image);
 		if (palImage)
 		{
 			LogAssert(format == GL::R8UI);
-			PaletteImageLock l(palImage);
-			gl->ActiveTexture(SCRATCH_TEX_SLOT);
-			gl->BindTexture(GL::TEXTURE_2D_ARRAY, this->tex_id);
-			gl->TexSubImage3D(GL::TEXTURE_2D_ARRAY, 0, entry->position.x, entry->position.y,
-			                  entry->page, entry->size.x, entry->size.y, 1, GL::RED_INTEGER,
-			                  GL::UNSIGNED_BYTE, l.getData());
+			{
+				PaletteImageLock l(palImage, ImageLockUse::Read);
+				gl->ActiveTexture(SCRATCH_TEX_SLOT);
+				gl->BindTexture(GL::TEXTURE_2D_ARRAY, this->tex_id);
+				gl->TexSubImage3D(GL::TEXTURE_2D_ARRAY, 0, entry->position.x, entry->position.y,
+				                  entry->page, entry->size.x, entry->size.y, 1, GL::RED_INTEGER,
+				                  GL::UNSIGNED_BYTE, l.getData());
+			}
+			stats->textureUploads++;
+			// Unpacked again by the next lock, as when the page has to be uploaded again
+			if (palImage->packOnUpload && packUploadedImagesOption.get())
+			{
+				palImage->pack();
+			}
 			return;
 		}
 		LogError("Unknown image type");
@@ -306,11 +506,14 @@ class Spritesheet
 			}
 		}
 		pages.clear();
+		page_last_used.clear();
 		while (!validEntries.empty())
 		{
 			LogInfo("Repack: creating sheet %d", (int)pages.size());
 			auto page = mksp<SpritesheetPage>((int)pages.size(), page_size, node_count);
 			pages.push_back(page);
+			// Whatever was still around was in use recently enough to have escaped eviction
+			page_last_used.push_back(current_frame);
 			page->addMultiple(validEntries);
 
 			std::vector<sp<SpritesheetEntry>> unpackedEntries;
@@ -349,10 +552,97 @@ class Spritesheet
 			         page_size);
 		}
 		this->pages.push_back(page);
+		this->page_last_used.push_back(current_frame);
 		// Because of the way texStorage sets the array length at creation time
 		// we have to re-upload /everything/...
 		this->reuploadTextures();
 	}
+	// Packs many entries at once, so every page is uploaded again at most once rather than once for
+	// every page that has to be added
+	void addSprites(std::vector<sp<SpritesheetEntry>> entries)
+	{
+		TRACE_FN;
+		std::vector<sp<SpritesheetEntry>> packedEntries;
+		auto takePacked = [&entries, &packedEntries]() {
+			std::vector<sp<SpritesheetEntry>> unpackedEntries;
+			for (auto &entry : entries)
+			{
+				if (entry->page == -1)
+					unpackedEntries.push_back(entry);
+				else
+					packedEntries.push_back(entry);
+			}
+			entries = std::move(unpackedEntries);
+		};
+		for (auto &page : this->pages)
+		{
+			if (entries.empty())
+				break;
+			page->addMultiple(entries);
+			takePacked();
+		}
+		bool addedPages = false;
+		while (!entries.empty())
+		{
+			LogInfo("Creating spritesheet page %d", (int)pages.size());
+			auto page = mksp<SpritesheetPage>((int)pages.size(), page_size, node_count);
+			this->pages.push_back(page);
+			this->page_last_used.push_back(current_frame);
+			addedPages = true;
+			auto unpackedCount = entries.size();
+			page->addMultiple(entries);
+			takePacked();
+			if (entries.size() == unpackedCount)
+			{
+				LogError("Failed to pack %u sprites in a new page of size %s?",
+				         (unsigned)entries.size(), page_size);
+				break;
+			}
+		}
+		if (addedPages)
+		{
+			this->reuploadTextures();
+			return;
+		}
+		for (auto &entry : packedEntries)
+		{
+			this->upload(entry);
+		}
+	}
+	void markUsed(int page_no) { this->page_last_used[page_no] = current_frame; }
+	// Called between frames, with nothing left to draw from the pages. If there are more than
+	// max_pages, the page drawn from least recently is dropped and the rest packed again, as long
+	// as it has not been drawn from in a while
+	void newFrame(unsigned int max_pages)
+	{
+		this->current_frame++;
+		if (this->pages.size() <= max_pages)
+			return;
+		auto oldest = std::min_element(this->page_last_used.begin(), this->page_last_used.end());
+		if (this->current_frame - *oldest < page_eviction_frames)
+			return;
+		int page_no = oldest - this->page_last_used.begin();
+		LogInfo("Evicting spritesheet page %d of %d", page_no, (int)this->pages.size());
+		this->evict(page_no);
+		this->repack();
+	}
+	// Packs the entries still around again if less than half of the area packed into the pages
+	// still has one on it. Taking a while, this is done at points a pause is not noticed
+	void compact()
+	{
+		int64_t live_area = 0;
+		int64_t packed_area = 0;
+		for (auto &page : this->pages)
+		{
+			live_area += page->getLiveArea();
+			packed_area += page->packed_area;
+		}
+		if (live_area * 2 >= packed_area)
+			return;
+		LogInfo("Compacting %d spritesheet pages, %lld of %lld packed pixels still in use",
+		        (int)this->pages.size(), (long long)live_area, (long long)packed_area);
+		this->repack();
+	}
 };
 
 class SpriteBuffer
@@ -449,35 +739,36 @@ class SpriteBuffer
 	bool isFull() const { return buffer_contents >= this->buffer.size(); }
 	bool isEmpty() const { return this->buffer.size() == 0; }
 	void reset() { this->buffer_contents = 0; }
-	void pushRGB(sp<SpritesheetEntry> e, Vec2<float> screenPos, Vec2<float> screenSize, Colour tint)
+	void pushRGB(const SpritesheetEntry &e, Vec2<float> screenPos, Vec2<float> screenSize,
+	             Colour tint)
 	{
 		LogAssert(!this->isFull());
-		LogAssert(e->page != -1);
+		LogAssert(e.page != -1);
 
 		auto &d = this->buffer[this->buffer_contents];
 		this->buffer_contents++;
 
 		d.uses_palette = 0;
-		d.page = e->page;
-		d.spritesheet_position = e->position;
-		d.spritesheet_size = e->size;
+		d.page = e.page;
+		d.spritesheet_position = e.position;
+		d.spritesheet_size = e.size;
 		d.screen_position = screenPos;
 		d.screen_size = screenSize;
 		d.tint = tint;
 	}
-	void pushPalette(sp<SpritesheetEntry> e, Vec2<float> screenPos, Vec2<float> screenSize,
+	void pushPalette(const SpritesheetEntry &e, Vec2<float> screenPos, Vec2<float> screenSize,
 	                 Colour tint)
 	{
 		LogAssert(!this->isFull());
-		LogAssert(e->page != -1);
+		LogAssert(e.page != -1);
 
 		auto &d = this->buffer[this->buffer_contents];
 		this->buffer_contents++;
 
 		d.uses_palette = 1;
-		d.page = e->page;
-		d.spritesheet_position = e->position;
-		d.spritesheet_size = e->size;
+		d.page = e.page;
+		d.spritesheet_position = e.position;
+		d.spritesheet_size = e.size;
 		d.screen_position = screenPos;
 		d.screen_size = screenSize;
 		d.tint = tint;
@@ -495,6 +786,7 @@ class SpriteBuffer
 		                  this->buffer.data());
 		gl->BindVertexArray(vao_id);
 		gl->DrawArraysInstanced(GL::TRIANGLE_STRIP, 0, 4, this->buffer_contents);
+		stats->drawCalls++;
 	}
 };
 
@@ -570,14 +862,14 @@ class SpriteDrawMachine
 
 	sp<SpritesheetEntry> createSpritesheetEntry(sp<RGBImage> i)
 	{
-		auto entry = mksp<SpritesheetEntry>(i->size, i);
+		auto entry = mksp<SpritesheetEntry>(i->size, i, false);
 		rgb_spritesheet.addSprite(entry);
 		return entry;
 	}
 
 	sp<SpritesheetEntry> createSpritesheetEntry(sp<PaletteImage> i)
 	{
-		auto entry = mksp<SpritesheetEntry>(i->size, i);
+		auto entry = mksp<SpritesheetEntry>(i->size, i, true);
 		palette_spritesheet.addSprite(entry);
 		return entry;
 	}
@@ -650,11 +942,7 @@ class SpriteDrawMachine
 			sprite = this->createSpritesheetEntry(i);
 			i->rendererPrivateData = sprite;
 		}
-		if (this->buffers[this->current_buffer]->isFull())
-		{
-			this->flush(viewport_size, flip_y);
-		}
-		this->buffers[this->current_buffer]->pushRGB(sprite, screenPos, screenSize, tint);
+		this->draw(*sprite, screenPos, screenSize, viewport_size, flip_y, tint);
 	}
 	void draw(sp<PaletteImage> i, Vec2<float> screenPos, Vec2<float> screenSize,
 	          Vec2<unsigned int> viewport_size, bool flip_y, Colour tint = {255, 255, 255, 255})
@@ -665,11 +953,68 @@ class SpriteDrawMachine
 			sprite = this->createSpritesheetEntry(i);
 			i->rendererPrivateData = sprite;
 		}
+		this->draw(*sprite, screenPos, screenSize, viewport_size, flip_y, tint);
+	}
+	// Draws an image that is already in a spritesheet, with no need for the image itself
+	void draw(const SpritesheetEntry &sprite, Vec2<float> screenPos, Vec2<float> screenSize,
+	          Vec2<unsigned int> viewport_size, bool flip_y, Colour tint = {255, 255, 255, 255})
+	{
 		if (this->buffers[this->current_buffer]->isFull())
 		{
 			this->flush(viewport_size, flip_y);
 		}
-		this->buffers[this->current_buffer]->pushPalette(sprite, screenPos, screenSize, tint);
+		if (sprite.usesPalette)
+		{
+			this->palette_spritesheet.markUsed(sprite.page);
+			this->buffers[this->current_buffer]->pushPalette(sprite, screenPos, screenSize, tint);
+		}
+		else
+		{
+			this->rgb_spritesheet.markUsed(sprite.page);
+			this->buffers[this->current_buffer]->pushRGB(sprite, screenPos, screenSize, tint);
+		}
+	}
+	// Puts the images not in a spritesheet yet into one, all at once
+	void preload(const std::vector<sp<PaletteImage>> &paletteImages,
+	             const std::vector<sp<RGBImage>> &rgbImages)
+	{
+		TRACE_FN;
+		std::vector<sp<SpritesheetEntry>> entries;
+		for (auto &i : paletteImages)
+		{
+			// The same image may well be in the list more than once
+			if (i->rendererPrivateData)
+				continue;
+			auto entry = mksp<SpritesheetEntry>(i->size, i, true);
+			i->rendererPrivateData = entry;
+			entries.push_back(entry);
+		}
+		this->palette_spritesheet.addSprites(std::move(entries));
+		entries.clear();
+		for (auto &i : rgbImages)
+		{
+			if (i->rendererPrivateData)
+				continue;
+			auto entry = mksp<SpritesheetEntry>(i->size, i, false);
+			i->rendererPrivateData = entry;
+			entries.push_back(entry);
+		}
+		this->rgb_spritesheet.addSprites(std::move(entries));
+	}
+	// Only to be called once every buffer is flushed, as they may move sprites around
+	void newFrame(unsigned int max_pages)
+	{
+		this->palette_spritesheet.newFrame(max_pages);
+		this->rgb_spritesheet.newFrame(max_pages);
+	}
+	void compact()
+	{
+		this->palette_spritesheet.compact();
+		this->rgb_spritesheet.compact();
+	}
+	unsigned int getPageCount() const
+	{
+		return this->palette_spritesheet.getPageCount() + this->rgb_spritesheet.getPageCount();
 	}
 };
 
@@ -687,6 +1032,7 @@ class GLRGBTexture final : public RendererImageData
 		gl->BindTexture(GL::TEXTURE_2D, this->tex_id);
 		gl->TexImage2D(GL::TEXTURE_2D, 0, GL::RGBA8, i->size.x, i->size.y, 0, GL::RGBA,
 		               GL::UNSIGNED_BYTE, l.getData());
+		stats->textureUploads++;
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
@@ -709,6 +1055,7 @@ class GLPaletteTexture final : public RendererImageData
 		gl->BindTexture(GL::TEXTURE_2D, this->tex_id);
 		gl->TexImage2D(GL::TEXTURE_2D, 0, GL::R8UI, i->size.x, i->size.y, 0, GL::RED_INTEGER,
 		               GL::UNSIGNED_BYTE, l.getData());
+		stats->textureUploads++;
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
@@ -1001,6 +1348,7 @@ class TexturedDrawMachine
 
 		gl->BindVertexArray(buf.vao_id);
 		gl->DrawArrays(GL::TRIANGLE_STRIP, 0, 4);
+		stats->drawCalls++;
 	}
 
 	void draw(sp<RGBImage> i, Vec2<float> screenPos, Vec2<float> screenSize,
@@ -1172,34 +1520,6 @@ class ColouredDrawMachine
 		}
 	}
 
-	// This expects screen coordinates as position values
-	void drawQuad(Vec2<float> positions[4], Colour colours[4], Vec2<unsigned int> viewport_size,
-	              bool flip_y)
-	{
-		TRACE_FN;
-		auto &buf = this->buffers[this->current_buffer];
-
-		ColouredDescription d;
-
-		for (int i = 0; i < 4; i++)
-		{
-			buf.data.vertices[i].position = positions[i];
-			buf.data.vertices[i].colour = colours[i];
-		}
-
-		gl->BindVertexArray(buf.vao_id);
-		gl->UseProgram(this->colour_program_id);
-		gl->Uniform1i(this->flip_y_location, flip_y);
-		gl->Uniform2f(this->viewport_size_location, viewport_size.x, viewport_size.y);
-
-		gl->BindBuffer(GL::ARRAY_BUFFER, buf.vertex_buffer);
-		gl->BufferSubData(GL::ARRAY_BUFFER, 0, sizeof(ColouredDescription), &buf.data);
-		gl->DrawArrays(GL::TRIANGLE_STRIP, 0, 4);
-
-		this->current_buffer = (this->current_buffer + 1) % this->buffers.size();
-		this->used_buffers++;
-	}
-
 	void drawLine(Vec2<float> positions[2], Colour colours[2], Vec2<float> viewport_size,
 	              bool flip_y, float thickness)
 	{
@@ -1223,6 +1543,7 @@ class ColouredDrawMachine
 		gl->BindBuffer(GL::ARRAY_BUFFER, buf.vertex_buffer);
 		gl->BufferSubData(GL::ARRAY_BUFFER, 0, sizeof(ColouredDescription), &buf.data);
 		gl->DrawArrays(GL::LINE_STRIP, 0, 2);
+		stats->drawCalls++;
 
 		this->current_buffer = (this->current_buffer + 1) % this->buffers.size();
 		this->used_buffers++;
@@ -1252,6 +1573,7 @@ class GLPalette final : public RendererImageData
 		gl->BindTexture(GL::TEXTURE_2D, this->tex_id);
 		gl->TexImage2D(GL::TEXTURE_2D, 0, GL::RGBA8, parent->colours.size(), 1, 0, GL::RGBA,
 		               GL::UNSIGNED_BYTE, parent->colours.data());
+		stats->textureUploads++;
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::NEAREST);
 		gl->TexParameteri(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
@@ -1283,6 +1605,8 @@ class OGLES30Renderer final : public Renderer
 	sp<Surface> getSurface() override { return this->current_surface; }
 	Vec2<unsigned int> spritesheetPageSize = {4096, 4096};
 	Vec2<unsigned int> maxSpriteSizeToPack{256, 256};
+	// Per spritesheet, beyond which pages not drawn from in a while are dropped
+	unsigned int maxSpritesheetPages = 4;
 	unsigned int spriteBufferSize = 16384;
 	unsigned int spriteBufferCount = 40;
 
@@ -1305,6 +1629,9 @@ class OGLES30Renderer final : public Renderer
 	sp<Surface> default_surface;
 	sp<Surface> current_surface;
 	sp<Palette> current_palette;
+	// Filled rects are drawn as this stretched and tinted, so they go in the same batch as the
+	// sprites around them instead of taking a draw call each
+	sp<RGBImage> white_pixel;
 
   public:
 	OGLES30Renderer();
@@ -1316,6 +1643,7 @@ class OGLES30Renderer final : public Renderer
 	{
 		LogInfo("Max %u sprite buffers %u textured buffers %u coloured buffers",
 		        this->maxSpriteBuffers, this->maxTexturedBuffers, this->maxColouredBuffers);
+		stats = nullptr;
 	}
 
 	void newFrame() override
@@ -1338,6 +1666,41 @@ class OGLES30Renderer final : public Renderer
 		this->spriteMachine->used_buffers = 0;
 		this->texturedMachine->used_buffers = 0;
 		this->colouredDrawMachine->used_buffers = 0;
+		this->spriteMachine->newFrame(this->maxSpritesheetPages);
+		this->frameStats.texturePages = this->spriteMachine->getPageCount();
+	}
+	void compact() override
+	{
+		TRACE_FN;
+		this->flush();
+		this->spriteMachine->compact();
+	}
+	void preload(const std::vector<sp<Image>> &images) override
+	{
+		TRACE_FN;
+		this->flush();
+		std::vector<sp<PaletteImage>> paletteImages;
+		std::vector<sp<RGBImage>> rgbImages;
+		for (auto &i : images)
+		{
+			// Only what would be drawn as a sprite is put in a spritesheet
+			if (!i || i->rendererPrivateData || i->size.x > this->maxSpriteSizeToPack.x ||
+			    i->size.y > this->maxSpriteSizeToPack.y)
+			{
+				continue;
+			}
+			if (auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(i))
+			{
+				paletteImages.push_back(paletteImage);
+			}
+			else if (auto rgbImage = std::dynamic_pointer_cast<RGBImage>(i))
+			{
+				rgbImages.push_back(rgbImage);
+			}
+		}
+		LogInfo("Preloading %u palette and %u RGB images", (unsigned)paletteImages.size(),
+		        (unsigned)rgbImages.size());
+		this->spriteMachine->preload(paletteImages, rgbImages);
 	}
 
 	void clear(Colour c) override
@@ -1374,6 +1737,7 @@ class OGLES30Renderer final : public Renderer
 	}
 	void drawRotated(sp<Image> i, Vec2<float> center, Vec2<float> position, float angle) override
 	{
+		this->frameStats.sprites++;
 		this->flush();
 		auto viewport_size = this->current_surface->size;
 		bool flip_y = (this->current_surface == this->default_surface);
@@ -1404,6 +1768,7 @@ class OGLES30Renderer final : public Renderer
 	}
 	void drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size, Scaler scaler) override
 	{
+		this->frameStats.sprites++;
 		auto viewport_size = this->current_surface->size;
 		bool flip_y = (this->current_surface == this->default_surface);
 		auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(i);
@@ -1460,6 +1825,7 @@ class OGLES30Renderer final : public Renderer
 	}
 	void drawTinted(sp<Image> i, Vec2<float> position, Colour tint) override
 	{
+		this->frameStats.sprites++;
 		auto viewport_size = this->current_surface->size;
 		bool flip_y = (this->current_surface == this->default_surface);
 		auto size = i->size;
@@ -1516,23 +1882,40 @@ class OGLES30Renderer final : public Renderer
 			return;
 		}
 	}
+	void drawSprites(const std::vector<RendererSprite> &sprites) override
+	{
+		auto viewport_size = this->current_surface->size;
+		bool flip_y = (this->current_surface == this->default_surface);
+		for (auto &s : sprites)
+		{
+			// Images already in a spritesheet go straight into the sprite buffer, anything else
+			// the usual way, which puts it in a spritesheet if it fits for next time
+			auto *sprite = dynamic_cast<SpritesheetEntry *>(s.image->rendererPrivateData.get());
+			if (!sprite || sprite->page == -1)
+			{
+				this->drawTinted(s.image->shared_from_this(), s.position, s.tint);
+				continue;
+			}
+			if (this->state != State::BatchingSprites)
+			{
+				this->flush();
+				this->state = State::BatchingSprites;
+			}
+			this->spriteMachine->draw(*sprite, s.position, s.image->size, viewport_size, flip_y,
+			                          s.tint);
+			this->frameStats.sprites++;
+		}
+	}
 	void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) override
 	{
-		this->flush();
-		Vec2<float> positions[4];
-		Colour colours[4];
-		static const Vec2<float> identity_quad[4] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
 		auto viewport_size = this->current_surface->size;
 		bool flip_y = (this->current_surface == this->default_surface);
-
-		for (int i = 0; i < 4; i++)
+		if (this->state != State::BatchingSprites)
 		{
-			// Position is currently in 0..current_surface.size coords, we want them in normalized
-			// device coords (-1..1)
-			positions[i] = position + size * identity_quad[i];
-			colours[i] = c;
+			this->flush();
+			this->state = State::BatchingSprites;
 		}
-		this->colouredDrawMachine->drawQuad(positions, colours, viewport_size, flip_y);
+		this->spriteMachine->draw(this->white_pixel, position, size, viewport_size, flip_y, c);
 	}
 	void drawRect(Vec2<float> position, Vec2<float> size, Colour c, float thickness) override
 	{
@@ -1654,10 +2037,12 @@ void GLESWRAP_APIENTRY debug_message_proc(GL::KhrDebug::GLenum, GL::KhrDebug::GL
 OGLES30Renderer::OGLES30Renderer() : state(State::Idle)
 {
 	TRACE_FN;
+	stats = &this->frameStats;
 	this->spriteMachine.reset(
 	    new SpriteDrawMachine{spriteBufferSize, spriteBufferCount, spritesheetPageSize});
 	this->texturedMachine.reset(new TexturedDrawMachine{texturedBufferCount});
 	this->colouredDrawMachine.reset(new ColouredDrawMachine{quadBufferCount});
+	this->white_pixel = mksp<RGBImage>(Vec2<unsigned int>{1, 1}, Colour{255, 255, 255, 255});
 	GL::GLint viewport[4];
 	gl->GetIntegerv(GL::VIEWPORT, viewport);
 	LogInfo("Viewport {%d,%d,%d,%d}", viewport[0], viewport[1], viewport[2], viewport[3]);
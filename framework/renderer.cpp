@@ -1,4 +1,5 @@
 #include "framework/renderer.h"
+#include "framework/image.h"
 #include "framework/logger.h"
 #include "library/sp.h"
 
@@ -15,6 +16,20 @@ RendererSurfaceBinding::~RendererSurfaceBinding() { r.setSurface(prevBinding); }
 
 Renderer::~Renderer() = default;
 
+void Renderer::endFrameStats()
+{
+	this->lastFrameStats = this->frameStats;
+	this->frameStats = RendererStats{};
+}
+
+void Renderer::drawSprites(const std::vector<RendererSprite> &sprites)
+{
+	for (auto &sprite : sprites)
+	{
+		this->drawTinted(sprite.image->shared_from_this(), sprite.position, sprite.tint);
+	}
+}
+
 RendererImageData::~RendererImageData() = default;
 
 sp<Image> RendererImageData::readBack()
@@ -5,6 +5,7 @@
 #include "library/strings.h"
 #include "library/vec.h"
 #include <memory>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -20,10 +21,41 @@ class RendererImageData
 	virtual ~RendererImageData();
 };
 
+// Drops what a renderer kept for an image or palette that is going away, handing it to the thread
+// that draws if that is not this one, as only that thread may free it (see ThreadedRenderer)
+void releaseRendererData(sp<RendererImageData> data);
+
+// One image to draw with Renderer::drawSprites. The image is not owned, so must be kept alive by
+// the caller, and must be owned by a shared pointer as everything else drawn is
+class RendererSprite
+{
+  public:
+	Image *image;
+	Vec2<float> position;
+	Colour tint;
+};
+
+// What a renderer did over one frame, for the stats overlay and traces
+class RendererStats
+{
+  public:
+	// Calls made to the graphics API that draw anything
+	unsigned int drawCalls = 0;
+	// Images drawn, however they were drawn
+	unsigned int sprites = 0;
+	// Images, or whole pages of images, sent to the graphics card
+	unsigned int textureUploads = 0;
+	// Textures images are packed into, as of the end of the frame
+	unsigned int texturePages = 0;
+	// Strings drawn or made into images by fonts
+	unsigned int fontStrings = 0;
+};
+
 class Renderer
 {
   private:
 	friend class RendererSurfaceBinding;
+	friend class ThreadedRenderer;
 	virtual void setSurface(sp<Surface> s) = 0;
 	virtual sp<Surface> getSurface() = 0;
 
@@ -49,12 +81,63 @@ class Renderer
 	virtual void drawRect(Vec2<float> position, Vec2<float> size, Colour c,
 	                      float thickness = 1.0) = 0;
 	virtual void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0) = 0;
+	// Draws every sprite in order, same as drawTinted() on each, but in one call so renderers can
+	// put them straight into their batches
+	virtual void drawSprites(const std::vector<RendererSprite> &sprites);
 	virtual void flush() = 0;
 	virtual UString getName() = 0;
 
 	virtual void newFrame(){};
+	// Tidies up whatever is kept for drawing images, which may take a while, so is only done at
+	// points a pause is not noticed, such as loading screens
+	virtual void compact(){};
+	// Gets images ready to be drawn before they are, such as by putting them in spritesheets, so
+	// the first frames they are drawn in do not stall. Like any drawing, only to be done from the
+	// thread that draws
+	virtual void preload(const std::vector<sp<Image>> & /*images*/){};
 
 	virtual sp<Surface> getDefaultSurface() = 0;
+
+	// Counts for the frame being drawn, which the renderer and anything drawing through it add to
+	RendererStats frameStats;
+	// Counts for the last whole frame
+	RendererStats lastFrameStats;
+	// Called once every frame is drawn, after newFrame(), to start the counts over
+	void endFrameStats();
+};
+
+// Sprites gathered up to be drawn with one Renderer::drawSprites() call. They are drawn on flush()
+// or when the batch goes, so anything else drawn with the renderer in between must be drawn with
+// what flush() returns to stay in order
+class RendererSpriteBatch
+{
+  private:
+	// Disallow copy
+	RendererSpriteBatch(const RendererSpriteBatch &) = delete;
+	Renderer &r;
+	std::vector<RendererSprite> sprites;
+
+  public:
+	RendererSpriteBatch(Renderer &r) : r(r) {}
+	~RendererSpriteBatch() { flush(); }
+	void add(Image *image, Vec2<float> position, Colour tint = Colour{255, 255, 255, 255})
+	{
+		sprites.push_back({image, position, tint});
+	}
+	void add(const sp<Image> &image, Vec2<float> position,
+	         Colour tint = Colour{255, 255, 255, 255})
+	{
+		add(image.get(), position, tint);
+	}
+	Renderer &flush()
+	{
+		if (!sprites.empty())
+		{
+			r.drawSprites(sprites);
+			sprites.clear();
+		}
+		return r;
+	}
 };
 
 class RendererSurfaceBinding
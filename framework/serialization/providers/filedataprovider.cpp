@@ -3,7 +3,6 @@
 #include "framework/logger.h"
 #include "library/strings.h"
 #include <fstream>
-#include <sstream>
 
 namespace OpenApoc
 {
@@ -20,10 +19,17 @@ bool FileDataProvider::openArchive(const UString &path, bool write)
 bool FileDataProvider::readDocument(const UString &path, UString &result)
 {
 	std::string documentPath = (static_cast<fs::path>(archivePath.str()) / path.str()).string();
-	std::ifstream in(documentPath, std::ios::binary);
-	std::ostringstream oss;
-	oss << in.rdbuf();
-	result = oss.str();
+	std::ifstream in(documentPath, std::ios::binary | std::ios::ate);
+	// Read in one go into a string of the right size, rather than through a stringstream
+	std::string data;
+	if (in)
+	{
+		auto size = in.tellg();
+		in.seekg(0, std::ios::beg);
+		data.resize(static_cast<size_t>(size));
+		in.read(&data[0], size);
+	}
+	result = std::move(data);
 	return !in.bad();
 }
 
@@ -18,8 +18,10 @@
 
 namespace OpenApoc
 {
+ConfigOptionBool useXXH64Checksum("Framework.Serialization", "XXH64",
+                                  "use an XXH64 checksum when saving files", true);
 ConfigOptionBool useCRCChecksum("Framework.Serialization", "CRC",
-                                "use a CRC checksum when saving files", true);
+                                "use a CRC checksum when saving files", false);
 ConfigOptionBool useSHA1Checksum("Framework.Serialization", "SHA1",
                                  "use a SHA1 checksum when saving files", false);
 
@@ -59,9 +61,102 @@ static UString calculateCRCChecksum(const std::string &str)
 	return hashString;
 }
 
+namespace
+{
+const uint64_t XXH64_PRIME1 = 0x9E3779B185EBCA87ull;
+const uint64_t XXH64_PRIME2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t XXH64_PRIME3 = 0x165667B19E3779F9ull;
+const uint64_t XXH64_PRIME4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t XXH64_PRIME5 = 0x27D4EB2F165667C5ull;
+
+uint64_t rotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+uint64_t readLE(const unsigned char *p, int bytes)
+{
+	uint64_t value = 0;
+	for (int i = bytes - 1; i >= 0; i--)
+	{
+		value = (value << 8) | p[i];
+	}
+	return value;
+}
+
+uint64_t xxh64Round(uint64_t acc, uint64_t input)
+{
+	acc += input * XXH64_PRIME2;
+	return rotateLeft(acc, 31) * XXH64_PRIME1;
+}
+
+uint64_t xxh64Merge(uint64_t acc, uint64_t value)
+{
+	acc ^= xxh64Round(0, value);
+	return acc * XXH64_PRIME1 + XXH64_PRIME4;
+}
+} // anonymous namespace
+
+// XXH64 with a seed of 0. Takes 32 bytes a step, so it is many times faster than the CRC made a
+// byte at a time, while being just as good at catching a damaged file
+static UString calculateXXH64Checksum(const std::string &str)
+{
+	TRACE_FN;
+	auto p = reinterpret_cast<const unsigned char *>(str.data());
+	auto end = p + str.size();
+	uint64_t hash;
+	if (str.size() >= 32)
+	{
+		uint64_t v1 = XXH64_PRIME1 + XXH64_PRIME2;
+		uint64_t v2 = XXH64_PRIME2;
+		uint64_t v3 = 0;
+		uint64_t v4 = 0 - XXH64_PRIME1;
+		for (; end - p >= 32; p += 32)
+		{
+			v1 = xxh64Round(v1, readLE(p, 8));
+			v2 = xxh64Round(v2, readLE(p + 8, 8));
+			v3 = xxh64Round(v3, readLE(p + 16, 8));
+			v4 = xxh64Round(v4, readLE(p + 24, 8));
+		}
+		hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+		hash = xxh64Merge(hash, v1);
+		hash = xxh64Merge(hash, v2);
+		hash = xxh64Merge(hash, v3);
+		hash = xxh64Merge(hash, v4);
+	}
+	else
+	{
+		hash = XXH64_PRIME5;
+	}
+	hash += str.size();
+	for (; end - p >= 8; p += 8)
+	{
+		hash ^= xxh64Round(0, readLE(p, 8));
+		hash = rotateLeft(hash, 27) * XXH64_PRIME1 + XXH64_PRIME4;
+	}
+	if (end - p >= 4)
+	{
+		hash ^= readLE(p, 4) * XXH64_PRIME1;
+		hash = rotateLeft(hash, 23) * XXH64_PRIME2 + XXH64_PRIME3;
+		p += 4;
+	}
+	for (; p < end; p++)
+	{
+		hash ^= *p * XXH64_PRIME5;
+		hash = rotateLeft(hash, 11) * XXH64_PRIME1;
+	}
+	hash ^= hash >> 33;
+	hash *= XXH64_PRIME2;
+	hash ^= hash >> 29;
+	hash *= XXH64_PRIME3;
+	hash ^= hash >> 32;
+	return format("%016llx", (unsigned long long)hash);
+}
+
 static UString calculateChecksum(const UString &type, const std::string &str)
 {
-	if (type == "CRC")
+	if (type == "XXH64")
+	{
+		return calculateXXH64Checksum(str);
+	}
+	else if (type == "CRC")
 	{
 		return calculateCRCChecksum(str);
 	}
@@ -199,6 +294,9 @@ bool ProviderWithChecksum::saveDocument(const UString &path, const UString &cont
 			LogWarning("Multiple document entries for path \"%s\"", path);
 		}
 		this->checksums[path.str()] = {};
+		if (useXXH64Checksum.get())
+			this->checksums[path.str()]["XXH64"] =
+			    calculateChecksum("XXH64", contents.str()).str();
 		if (useCRCChecksum.get())
 			this->checksums[path.str()]["CRC"] = calculateChecksum("CRC", contents.str()).str();
 		if (useSHA1Checksum.get())
@@ -87,14 +87,16 @@ bool ZipDataProvider::readDocument(const UString &filename, UString &result)
 	LogInfo("Reading %lu bytes for file \"%s\" in zip \"%s\"", (unsigned long)stat.m_uncomp_size,
 	        filename, zipPath);
 
-	up<char[]> data(new char[(unsigned int)stat.m_uncomp_size]);
-	if (!mz_zip_reader_extract_to_mem(&archive, fileId, data.get(), (size_t)stat.m_uncomp_size, 0))
+	// Extracted straight into the string that is handed back, rather than into a buffer that is
+	// then copied
+	std::string data((size_t)stat.m_uncomp_size, '\0');
+	if (!mz_zip_reader_extract_to_mem(&archive, fileId, &data[0], data.size(), 0))
 	{
 		LogWarning("Failed to extract file \"%s\" in zip \"%s\"", filename, zipPath);
 		return false;
 	}
 
-	result = std::string(data.get(), (unsigned int)stat.m_uncomp_size);
+	result = std::move(data);
 	return true;
 }
 bool ZipDataProvider::saveDocument(const UString &path, const UString &contents)
@@ -1,6 +1,7 @@
 #include "framework/serialization/serialize.h"
 #include "dependencies/pugixml/src/pugixml.hpp"
 #include "framework/filesystem.h"
+#include "framework/framework.h"
 #include "framework/logger.h"
 #include "framework/serialization/providers/filedataprovider.h"
 #include "framework/serialization/providers/providerwithchecksum.h"
@@ -9,8 +10,13 @@
 #include "library/sp.h"
 #include "library/strings.h"
 #include "library/strings_format.h"
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <map>
 #include <sstream>
+#include <unordered_map>
 
 namespace OpenApoc
 {
@@ -45,6 +51,132 @@ SerializationNode *SerializationNode::getNextSiblingReq(const UString &name)
 	return node;
 }
 
+namespace
+{
+
+// Binary archives are written with this document, so readArchive can tell them from XML ones
+const char *const BINARY_FORMAT_DOCUMENT = "format";
+const char *const BINARY_FORMAT_MAGIC = "OpenApoc binary archive 1";
+// At the start of every document in a binary archive
+const std::string BINARY_DOCUMENT_MAGIC = "OABD";
+
+// Seven bits to a byte, with the top bit set on all but the last
+void writeVarint(std::string &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+void writeString(std::string &out, const std::string &str)
+{
+	writeVarint(out, str.size());
+	out.append(str);
+}
+
+// Keeps small negative numbers short as varints
+uint64_t zigzagEncode(int64_t value)
+{
+	return (static_cast<uint64_t>(value) << 1) ^ (value < 0 ? ~0ull : 0ull);
+}
+
+int64_t zigzagDecode(uint64_t value)
+{
+	return static_cast<int64_t>((value >> 1) ^ (0ull - (value & 1)));
+}
+
+// Calls work(index) for every document index, on the thread pool when there is one. Documents
+// are only written out once built, and building one shares nothing with building another
+void forEachDocument(size_t count, std::function<void(unsigned int index)> work)
+{
+	auto framework = Framework::tryGetInstance();
+	if (framework && count > 1)
+	{
+		framework->threadPoolParallelFor(static_cast<unsigned int>(count),
+		                                 [&work](unsigned int index, unsigned int) { work(index); });
+	}
+	else
+	{
+		for (unsigned int index = 0; index < count; index++)
+		{
+			work(index);
+		}
+	}
+}
+
+} // anonymous namespace
+
+// The type tag written before every value. Getting a value as another type than it was set with
+// converts it the way the XML archive would, through text if need be
+enum class BinaryValueType : uint8_t
+{
+	None,
+	String,
+	Unsigned,
+	Signed,
+	Float,
+	Bool,
+	BoolVector
+};
+
+// Reads a binary document, every read returning false once it runs off the end of it
+class BinaryReader
+{
+  private:
+	const std::string &data;
+	size_t position = 0;
+
+  public:
+	BinaryReader(const std::string &data) : data(data) {}
+
+	bool readByte(uint8_t &value)
+	{
+		if (position >= data.size())
+		{
+			return false;
+		}
+		value = static_cast<uint8_t>(data[position++]);
+		return true;
+	}
+	bool readVarint(uint64_t &value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			uint8_t byte;
+			if (!readByte(byte))
+			{
+				return false;
+			}
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	bool readBytes(std::string &value, uint64_t length)
+	{
+		if (length > data.size() - position)
+		{
+			return false;
+		}
+		value.assign(data, position, static_cast<size_t>(length));
+		position += static_cast<size_t>(length);
+		return true;
+	}
+	bool readString(std::string &value)
+	{
+		uint64_t length;
+		return readVarint(length) && readBytes(value, length);
+	}
+	size_t remaining() const { return data.size() - position; }
+};
+
 using namespace pugi;
 class XMLSerializationNode;
 
@@ -94,6 +226,8 @@ class XMLSerializationNode : public SerializationNode
 	SerializationNode *getNodeOpt(const UString &name) override;
 	SerializationNode *getNextSiblingOpt(const UString &name) override;
 	SerializationNode *getSectionOpt(const UString &name) override;
+	SerializationNode *getFirstChildOpt() override;
+	SerializationNode *getNextSiblingOpt() override;
 
 	UString getName() override;
 	void setName(const UString &str) override;
@@ -136,8 +270,135 @@ class XMLSerializationNode : public SerializationNode
 	~XMLSerializationNode() override = default;
 };
 
-up<SerializationArchive> SerializationArchive::createArchive()
+class BinarySerializationArchive;
+
+// Unlike XMLSerializationNode, these are the tree itself rather than handles to it, so getting
+// a node allocates nothing
+class BinarySerializationNode : public SerializationNode
 {
+  private:
+	BinarySerializationArchive *archive;
+	BinarySerializationNode *parent;
+	// Position among the parent's children, for getNextSiblingOpt
+	size_t siblingIndex;
+	unsigned int name;
+	BinaryValueType type = BinaryValueType::None;
+	// Unsigned and Bool values, Signed ones zigzag encoded, Float ones as their bits and the length
+	// of BoolVector ones
+	uint64_t number = 0;
+	// String values, and BoolVector ones packed eight to a byte
+	std::string text;
+	std::vector<up<BinarySerializationNode>> children;
+	// One past the child the last lookup by name found. Members are read in the order they were
+	// written, so the next one asked for is nearly always there
+	size_t nextChild = 0;
+	// Whether no earlier sibling has the same name, so a lookup finding this node at nextChild
+	// can stop there. Only worked out for read documents
+	bool firstOfName = false;
+	// Only set on roots
+	UString prefix;
+	friend class BinarySerializationArchive;
+
+	unsigned long long getUnsigned() const;
+	long long getSigned() const;
+	float getFloat() const;
+
+  public:
+	BinarySerializationNode(BinarySerializationArchive *archive, BinarySerializationNode *parent,
+	                        size_t siblingIndex, unsigned int name)
+	    : archive(archive), parent(parent), siblingIndex(siblingIndex), name(name)
+	{
+	}
+
+	SerializationNode *addNode(const UString &name, const UString &value = "") override;
+	SerializationNode *addSection(const UString &name) override;
+
+	SerializationNode *getNodeOpt(const UString &name) override;
+	SerializationNode *getNextSiblingOpt(const UString &name) override;
+	SerializationNode *getSectionOpt(const UString &name) override;
+	SerializationNode *getFirstChildOpt() override;
+	SerializationNode *getNextSiblingOpt() override;
+
+	UString getName() override;
+	void setName(const UString &str) override;
+	UString getValue() override;
+	void setValue(const UString &str) override;
+
+	unsigned int getValueUInt() override;
+	void setValueUInt(unsigned int i) override;
+
+	unsigned char getValueUChar() override;
+	void setValueUChar(unsigned char i) override;
+
+	int getValueInt() override;
+	void setValueInt(int i) override;
+
+	unsigned long long getValueUInt64() override;
+	void setValueUInt64(unsigned long long i) override;
+
+	long long getValueInt64() override;
+	void setValueInt64(long long i) override;
+
+	float getValueFloat() override;
+	void setValueFloat(float f) override;
+
+	bool getValueBool() override;
+	void setValueBool(bool b) override;
+
+	std::vector<bool> getValueBoolVector() override;
+	void setValueBoolVector(const std::vector<bool> &vec) override;
+
+	UString getFullPath() override;
+	const UString &getPrefix() const override
+	{
+		if (this->parent)
+			return this->parent->getPrefix();
+		else
+			return this->prefix;
+	}
+
+	~BinarySerializationNode() override = default;
+};
+
+class BinarySerializationArchive : public SerializationArchive
+{
+  private:
+	up<SerializationDataProvider> dataProvider;
+	std::map<UString, up<BinarySerializationNode>> roots;
+	// Every node name used in the archive, each kept once and referred to by its index
+	std::vector<UString> names;
+	std::unordered_map<std::string, unsigned int> nameIndexes;
+	// For finding the first child of each name while reading, marked with a new value for every
+	// node whose children are gone through
+	std::vector<uint64_t> nameMarks;
+	uint64_t nameMark = 0;
+	friend class SerializationArchive;
+	friend class BinarySerializationNode;
+
+	unsigned int addName(const UString &name);
+	bool findName(const UString &name, unsigned int &index) const;
+	void writeNode(std::string &out, const BinarySerializationNode &node,
+	               std::vector<int> &localNames, std::vector<unsigned int> &documentNames) const;
+	up<BinarySerializationNode> readNode(BinaryReader &reader,
+	                                     const std::vector<unsigned int> &documentNames,
+	                                     BinarySerializationNode *parent, size_t siblingIndex);
+
+  public:
+	SerializationNode *newRoot(const UString &prefix, const UString &name) override;
+	SerializationNode *getRoot(const UString &prefix, const UString &name) override;
+	bool write(const UString &path, bool pack, bool pretty) override;
+	BinarySerializationArchive() = default;
+	BinarySerializationArchive(up<SerializationDataProvider> dataProvider)
+	    : dataProvider(std::move(dataProvider)){};
+	~BinarySerializationArchive() override = default;
+};
+
+up<SerializationArchive> SerializationArchive::createArchive(SerializationFormat format)
+{
+	if (format == SerializationFormat::Binary)
+	{
+		return mkup<BinarySerializationArchive>();
+	}
 	return mkup<XMLSerializationArchive>();
 }
 
@@ -165,6 +426,12 @@ up<SerializationArchive> SerializationArchive::readArchive(const UString &name)
 	}
 	LogInfo("Opened archive \"%s\"", name);
 
+	UString format;
+	if (dataProvider->readDocument(BINARY_FORMAT_DOCUMENT, format) &&
+	    format == BINARY_FORMAT_MAGIC)
+	{
+		return mkup<BinarySerializationArchive>(std::move(dataProvider));
+	}
 	return mkup<XMLSerializationArchive>(std::move(dataProvider));
 }
 
@@ -199,7 +466,8 @@ SerializationNode *XMLSerializationArchive::getRoot(const UString &prefix, const
 			// FIXME: Make this actually read from the root and load the xinclude tags properly?
 			auto &doc = this->docRoots[path];
 			TraceObj traceParse("Parsing archive", {{"path", path}});
-			auto parse_result = doc.load_string(content.cStr());
+			auto parse_result = doc.load_buffer(content.cStr(), content.cStrLength(),
+			                                   pugi::parse_default, pugi::encoding_utf8);
 			if (!parse_result)
 			{
 				LogInfo("Failed to parse \"%s\" : \"%s\" at \"%llu\"", path,
@@ -237,18 +505,30 @@ bool XMLSerializationArchive::write(const UString &path, bool pack, bool pretty)
 		return false;
 	}
 
+	unsigned int flags = pugi::format_default;
+	if (pretty == false)
+	{
+		flags = pugi::format_raw;
+	}
+	std::vector<std::pair<const UString *, const xml_document *>> roots;
 	for (auto &root : this->docRoots)
 	{
-		TraceObj traceSave("Saving root", {{"root", root.first}});
-		std::stringstream ss;
-		unsigned int flags = pugi::format_default;
-		if (pretty == false)
-		{
-			flags = pugi::format_raw;
-		}
-		root.second.save(ss, "", flags);
-		TraceObj traceSaveData("Saving root data", {{"root", root.first}});
-		if (!dataProvider->saveDocument(root.first, ss.str()))
+		roots.emplace_back(&root.first, &root.second);
+	}
+	std::vector<std::string> contents(roots.size());
+	{
+		TraceObj traceSave("Saving roots");
+		forEachDocument(roots.size(), [&roots, &contents, flags](unsigned int index) {
+			std::stringstream ss;
+			roots[index].second->save(ss, "", flags);
+			contents[index] = ss.str();
+		});
+	}
+
+	for (size_t i = 0; i < roots.size(); i++)
+	{
+		TraceObj traceSaveData("Saving root data", {{"root", *roots[i].first}});
+		if (!dataProvider->saveDocument(*roots[i].first, UString(std::move(contents[i]))))
 		{
 			return false;
 		}
@@ -288,6 +568,37 @@ SerializationNode *XMLSerializationNode::getNextSiblingOpt(const UString &name)
 	return this->archive->nodes.back().get();
 }
 
+SerializationNode *XMLSerializationNode::getFirstChildOpt()
+{
+	// Values are text children of their nodes, which aren't nodes of the tree
+	auto newNode = this->node.first_child();
+	while (newNode && newNode.type() != pugi::node_element)
+	{
+		newNode = newNode.next_sibling();
+	}
+	if (!newNode)
+	{
+		return nullptr;
+	}
+	this->archive->nodes.push_back(mkup<XMLSerializationNode>(this->archive, newNode, this));
+	return this->archive->nodes.back().get();
+}
+
+SerializationNode *XMLSerializationNode::getNextSiblingOpt()
+{
+	auto newNode = this->node.next_sibling();
+	while (newNode && newNode.type() != pugi::node_element)
+	{
+		newNode = newNode.next_sibling();
+	}
+	if (!newNode)
+	{
+		return nullptr;
+	}
+	this->archive->nodes.push_back(mkup<XMLSerializationNode>(this->archive, newNode, this));
+	return this->archive->nodes.back().get();
+}
+
 SerializationNode *XMLSerializationNode::addSection(const UString &name)
 {
 	auto includeNode = static_cast<XMLSerializationNode *>(this->addNode(UString{"xi:include"}));
@@ -400,4 +711,599 @@ UString XMLSerializationNode::getFullPath()
 	return str;
 }
 
+
+unsigned int BinarySerializationArchive::addName(const UString &name)
+{
+	auto it = nameIndexes.find(name.str());
+	if (it != nameIndexes.end())
+	{
+		return it->second;
+	}
+	auto index = static_cast<unsigned int>(names.size());
+	names.push_back(name);
+	nameIndexes.emplace(name.str(), index);
+	return index;
+}
+
+bool BinarySerializationArchive::findName(const UString &name, unsigned int &index) const
+{
+	auto it = nameIndexes.find(name.str());
+	if (it == nameIndexes.end())
+	{
+		return false;
+	}
+	index = it->second;
+	return true;
+}
+
+SerializationNode *BinarySerializationArchive::newRoot(const UString &prefix, const UString &name)
+{
+	auto path = prefix + name + ".bin";
+	auto root = mkup<BinarySerializationNode>(this, nullptr, 0, addName(name));
+	root->prefix = prefix + name + "/";
+	auto &entry = this->roots[path];
+	entry = std::move(root);
+	return entry.get();
+}
+
+SerializationNode *BinarySerializationArchive::getRoot(const UString &prefix, const UString &name)
+{
+	auto path = prefix + name + ".bin";
+	auto it = this->roots.find(path);
+	if (it == this->roots.end())
+	{
+		if (dataProvider == nullptr)
+		{
+			LogWarning("Reading from not opened archive: %s!", path);
+			return nullptr;
+		}
+		TraceObj trace("Reading archive", {{"path", path}});
+		UString content;
+		if (!dataProvider->readDocument(path, content))
+		{
+			return nullptr;
+		}
+		TraceObj traceParse("Parsing archive", {{"path", path}});
+		BinaryReader reader(content.str());
+		std::string magic;
+		uint64_t nameCount = 0;
+		if (!reader.readBytes(magic, BINARY_DOCUMENT_MAGIC.size()) ||
+		    magic != BINARY_DOCUMENT_MAGIC || !reader.readVarint(nameCount) ||
+		    nameCount > reader.remaining())
+		{
+			LogInfo("Failed to parse \"%s\" : not a binary document", path);
+			return nullptr;
+		}
+		std::vector<unsigned int> documentNames;
+		documentNames.reserve(static_cast<size_t>(nameCount));
+		for (uint64_t i = 0; i < nameCount; i++)
+		{
+			std::string documentName;
+			if (!reader.readString(documentName))
+			{
+				LogInfo("Failed to parse \"%s\" : truncated name table", path);
+				return nullptr;
+			}
+			documentNames.push_back(addName(documentName));
+		}
+		this->nameMarks.resize(this->names.size(), 0);
+		auto root = readNode(reader, documentNames, nullptr, 0);
+		if (!root)
+		{
+			LogInfo("Failed to parse \"%s\" : truncated or corrupt node", path);
+			return nullptr;
+		}
+		root->prefix = prefix + name + "/";
+		it = this->roots.emplace(path, std::move(root)).first;
+		LogInfo("Parsed \"%s\"", path);
+	}
+
+	if (this->names[it->second->name] != name)
+	{
+		LogWarning("Failed to find root with name \"%s\" in \"%s\"", name, path);
+		return nullptr;
+	}
+	return it->second.get();
+}
+
+void BinarySerializationArchive::writeNode(std::string &out, const BinarySerializationNode &node,
+                                           std::vector<int> &localNames,
+                                           std::vector<unsigned int> &documentNames) const
+{
+	// Documents only carry the names they use, numbered in the order they are first met
+	if (localNames[node.name] < 0)
+	{
+		localNames[node.name] = static_cast<int>(documentNames.size());
+		documentNames.push_back(node.name);
+	}
+	writeVarint(out, static_cast<uint64_t>(localNames[node.name]));
+	out.push_back(static_cast<char>(node.type));
+	switch (node.type)
+	{
+		case BinaryValueType::None:
+			break;
+		case BinaryValueType::String:
+			writeString(out, node.text);
+			break;
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Signed:
+		case BinaryValueType::Bool:
+			writeVarint(out, node.number);
+			break;
+		case BinaryValueType::Float:
+			for (int i = 0; i < 4; i++)
+			{
+				out.push_back(static_cast<char>((node.number >> (i * 8)) & 0xff));
+			}
+			break;
+		case BinaryValueType::BoolVector:
+			writeVarint(out, node.number);
+			out.append(node.text);
+			break;
+	}
+	writeVarint(out, node.children.size());
+	for (auto &child : node.children)
+	{
+		writeNode(out, *child, localNames, documentNames);
+	}
+}
+
+up<BinarySerializationNode>
+BinarySerializationArchive::readNode(BinaryReader &reader,
+                                     const std::vector<unsigned int> &documentNames,
+                                     BinarySerializationNode *parent, size_t siblingIndex)
+{
+	uint64_t nameIndex;
+	uint8_t type;
+	if (!reader.readVarint(nameIndex) || nameIndex >= documentNames.size() ||
+	    !reader.readByte(type) || type > static_cast<uint8_t>(BinaryValueType::BoolVector))
+	{
+		return nullptr;
+	}
+	auto node = mkup<BinarySerializationNode>(this, parent, siblingIndex,
+	                                          documentNames[static_cast<size_t>(nameIndex)]);
+	node->type = static_cast<BinaryValueType>(type);
+	switch (node->type)
+	{
+		case BinaryValueType::None:
+			break;
+		case BinaryValueType::String:
+			if (!reader.readString(node->text))
+			{
+				return nullptr;
+			}
+			break;
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Signed:
+		case BinaryValueType::Bool:
+			if (!reader.readVarint(node->number))
+			{
+				return nullptr;
+			}
+			break;
+		case BinaryValueType::Float:
+			for (int i = 0; i < 4; i++)
+			{
+				uint8_t byte;
+				if (!reader.readByte(byte))
+				{
+					return nullptr;
+				}
+				node->number |= static_cast<uint64_t>(byte) << (i * 8);
+			}
+			break;
+		case BinaryValueType::BoolVector:
+			if (!reader.readVarint(node->number) ||
+			    !reader.readBytes(node->text, (node->number + 7) / 8))
+			{
+				return nullptr;
+			}
+			break;
+	}
+	uint64_t childCount;
+	// Every child takes at least three bytes, which keeps a corrupt count from reserving much
+	if (!reader.readVarint(childCount) || childCount > reader.remaining() / 3)
+	{
+		return nullptr;
+	}
+	node->children.reserve(static_cast<size_t>(childCount));
+	for (uint64_t i = 0; i < childCount; i++)
+	{
+		auto child = readNode(reader, documentNames, node.get(), node->children.size());
+		if (!child)
+		{
+			return nullptr;
+		}
+		node->children.push_back(std::move(child));
+	}
+	this->nameMark++;
+	for (auto &child : node->children)
+	{
+		child->firstOfName = this->nameMarks[child->name] != this->nameMark;
+		this->nameMarks[child->name] = this->nameMark;
+	}
+	return node;
+}
+
+bool BinarySerializationArchive::write(const UString &path, bool pack, bool)
+{
+	TraceObj trace("Writing archive", {{"path", path}});
+	// warning! data provider must be freed when this method ends,
+	// so code calling this method may override archive
+	auto dataProvider = getProvider(pack);
+	if (!dataProvider->openArchive(path, true))
+	{
+		LogWarning("Failed to open archive at \"%s\"", path);
+		return false;
+	}
+	if (!dataProvider->saveDocument(BINARY_FORMAT_DOCUMENT, BINARY_FORMAT_MAGIC))
+	{
+		return false;
+	}
+
+	std::vector<std::pair<const UString *, const BinarySerializationNode *>> roots;
+	for (auto &root : this->roots)
+	{
+		roots.emplace_back(&root.first, root.second.get());
+	}
+	std::vector<std::string> contents(roots.size());
+	{
+		TraceObj traceSave("Saving roots");
+		forEachDocument(roots.size(), [this, &roots, &contents](unsigned int index) {
+			std::vector<int> localNames(this->names.size(), -1);
+			std::vector<unsigned int> documentNames;
+			std::string body;
+			writeNode(body, *roots[index].second, localNames, documentNames);
+
+			auto &data = contents[index];
+			data = BINARY_DOCUMENT_MAGIC;
+			writeVarint(data, documentNames.size());
+			for (auto name : documentNames)
+			{
+				writeString(data, this->names[name].str());
+			}
+			data += body;
+		});
+	}
+
+	for (size_t i = 0; i < roots.size(); i++)
+	{
+		TraceObj traceSaveData("Saving root data", {{"root", *roots[i].first}});
+		if (!dataProvider->saveDocument(*roots[i].first, UString(std::move(contents[i]))))
+		{
+			return false;
+		}
+	}
+
+	return dataProvider->finalizeSave();
+}
+
+SerializationNode *BinarySerializationNode::addNode(const UString &name, const UString &value)
+{
+	this->children.push_back(mkup<BinarySerializationNode>(
+	    this->archive, this, this->children.size(), this->archive->addName(name)));
+	auto newNode = this->children.back().get();
+	if (!value.empty())
+	{
+		newNode->setValue(value);
+	}
+	return newNode;
+}
+
+SerializationNode *BinarySerializationNode::getNodeOpt(const UString &name)
+{
+	unsigned int index;
+	if (!this->archive->findName(name, index))
+	{
+		return nullptr;
+	}
+	if (this->nextChild < this->children.size())
+	{
+		auto &child = this->children[this->nextChild];
+		if (child->name == index && child->firstOfName)
+		{
+			this->nextChild++;
+			return child.get();
+		}
+	}
+	for (size_t i = 0; i < this->children.size(); i++)
+	{
+		if (this->children[i]->name == index)
+		{
+			this->nextChild = i + 1;
+			return this->children[i].get();
+		}
+	}
+	return nullptr;
+}
+
+SerializationNode *BinarySerializationNode::getNextSiblingOpt(const UString &name)
+{
+	unsigned int index;
+	if (!this->parent || !this->archive->findName(name, index))
+	{
+		return nullptr;
+	}
+	auto &siblings = this->parent->children;
+	for (size_t i = this->siblingIndex + 1; i < siblings.size(); i++)
+	{
+		if (siblings[i]->name == index)
+		{
+			return siblings[i].get();
+		}
+	}
+	return nullptr;
+}
+
+SerializationNode *BinarySerializationNode::getFirstChildOpt()
+{
+	return this->children.empty() ? nullptr : this->children.front().get();
+}
+
+SerializationNode *BinarySerializationNode::getNextSiblingOpt()
+{
+	if (!this->parent || this->siblingIndex + 1 >= this->parent->children.size())
+	{
+		return nullptr;
+	}
+	return this->parent->children[this->siblingIndex + 1].get();
+}
+
+SerializationNode *BinarySerializationNode::addSection(const UString &name)
+{
+	return this->archive->newRoot(this->getPrefix(), name);
+}
+
+SerializationNode *BinarySerializationNode::getSectionOpt(const UString &name)
+{
+	return this->archive->getRoot(this->getPrefix(), name);
+}
+
+UString BinarySerializationNode::getName() { return this->archive->names[this->name]; }
+
+void BinarySerializationNode::setName(const UString &str)
+{
+	this->name = this->archive->addName(str);
+}
+
+UString BinarySerializationNode::getValue()
+{
+	switch (this->type)
+	{
+		case BinaryValueType::None:
+			return "";
+		case BinaryValueType::String:
+			return this->text;
+		case BinaryValueType::Unsigned:
+			return format("%llu", this->getUnsigned());
+		case BinaryValueType::Signed:
+			return format("%lld", this->getSigned());
+		case BinaryValueType::Float:
+			return format("%.9g", this->getValueFloat());
+		case BinaryValueType::Bool:
+			return this->number ? "true" : "false";
+		case BinaryValueType::BoolVector:
+		{
+			auto vec = this->getValueBoolVector();
+			std::string str(vec.size(), '0');
+			for (size_t i = 0; i < vec.size(); i++)
+			{
+				if (vec[i])
+					str[i] = '1';
+			}
+			return str;
+		}
+	}
+	return "";
+}
+
+void BinarySerializationNode::setValue(const UString &str)
+{
+	this->type = BinaryValueType::String;
+	this->text = str.str();
+}
+
+unsigned long long BinarySerializationNode::getUnsigned() const
+{
+	switch (this->type)
+	{
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Bool:
+			return this->number;
+		case BinaryValueType::Signed:
+			return static_cast<unsigned long long>(zigzagDecode(this->number));
+		case BinaryValueType::Float:
+			return static_cast<unsigned long long>(this->getFloat());
+		case BinaryValueType::String:
+			return std::strtoull(this->text.c_str(), nullptr, 10);
+		default:
+			return 0;
+	}
+}
+
+long long BinarySerializationNode::getSigned() const
+{
+	switch (this->type)
+	{
+		case BinaryValueType::Signed:
+			return zigzagDecode(this->number);
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Bool:
+			return static_cast<long long>(this->number);
+		case BinaryValueType::Float:
+			return static_cast<long long>(this->getFloat());
+		case BinaryValueType::String:
+			return std::strtoll(this->text.c_str(), nullptr, 10);
+		default:
+			return 0;
+	}
+}
+
+unsigned int BinarySerializationNode::getValueUInt()
+{
+	return static_cast<unsigned int>(this->getUnsigned());
+}
+
+void BinarySerializationNode::setValueUInt(unsigned int i) { this->setValueUInt64(i); }
+
+unsigned char BinarySerializationNode::getValueUChar()
+{
+	auto uint = this->getValueUInt();
+	if (uint > std::numeric_limits<unsigned char>::max())
+	{
+		throw SerializationException(format("Value %u is out of range of unsigned char type", uint),
+		                             this);
+	}
+	return static_cast<unsigned char>(uint);
+}
+
+void BinarySerializationNode::setValueUChar(unsigned char c) { this->setValueUInt64(c); }
+
+int BinarySerializationNode::getValueInt() { return static_cast<int>(this->getSigned()); }
+
+void BinarySerializationNode::setValueInt(int i) { this->setValueInt64(i); }
+
+unsigned long long BinarySerializationNode::getValueUInt64() { return this->getUnsigned(); }
+
+void BinarySerializationNode::setValueUInt64(unsigned long long i)
+{
+	this->type = BinaryValueType::Unsigned;
+	this->number = i;
+	this->text.clear();
+}
+
+long long BinarySerializationNode::getValueInt64() { return this->getSigned(); }
+
+void BinarySerializationNode::setValueInt64(long long i)
+{
+	this->type = BinaryValueType::Signed;
+	this->number = zigzagEncode(i);
+	this->text.clear();
+}
+
+float BinarySerializationNode::getFloat() const
+{
+	switch (this->type)
+	{
+		case BinaryValueType::Float:
+		{
+			auto bits = static_cast<uint32_t>(this->number);
+			float f;
+			memcpy(&f, &bits, sizeof(f));
+			return f;
+		}
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Bool:
+			return static_cast<float>(this->number);
+		case BinaryValueType::Signed:
+			return static_cast<float>(this->getSigned());
+		case BinaryValueType::String:
+			return std::strtof(this->text.c_str(), nullptr);
+		default:
+			return 0.0f;
+	}
+}
+
+float BinarySerializationNode::getValueFloat() { return this->getFloat(); }
+
+void BinarySerializationNode::setValueFloat(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	this->type = BinaryValueType::Float;
+	this->number = bits;
+	this->text.clear();
+}
+
+bool BinarySerializationNode::getValueBool()
+{
+	switch (this->type)
+	{
+		case BinaryValueType::Unsigned:
+		case BinaryValueType::Signed:
+		case BinaryValueType::Bool:
+			return this->number != 0;
+		case BinaryValueType::Float:
+			return this->getFloat() != 0.0f;
+		case BinaryValueType::String:
+		{
+			// Same as pugixml's as_bool
+			auto c = this->text.empty() ? '\0' : this->text[0];
+			return c == '1' || c == 't' || c == 'T' || c == 'y' || c == 'Y';
+		}
+		default:
+			return false;
+	}
+}
+
+void BinarySerializationNode::setValueBool(bool b)
+{
+	this->type = BinaryValueType::Bool;
+	this->number = b ? 1 : 0;
+	this->text.clear();
+}
+
+std::vector<bool> BinarySerializationNode::getValueBoolVector()
+{
+	std::vector<bool> vec;
+	switch (this->type)
+	{
+		case BinaryValueType::None:
+			break;
+		case BinaryValueType::BoolVector:
+			vec.resize(static_cast<size_t>(this->number));
+			for (size_t i = 0; i < vec.size(); i++)
+			{
+				vec[i] = (static_cast<uint8_t>(this->text[i / 8]) >> (i % 8)) & 1;
+			}
+			break;
+		case BinaryValueType::String:
+			vec.resize(this->text.length());
+			for (size_t i = 0; i < this->text.length(); i++)
+			{
+				auto c = this->text[i];
+				if (c == '1')
+					vec[i] = true;
+				else if (c == '0')
+					vec[i] = false;
+				else
+					throw SerializationException(format("Unknown char '%c' in bool vector", c),
+					                             this);
+			}
+			break;
+		default:
+			throw SerializationException("Value is not a bool vector", this);
+	}
+	return vec;
+}
+
+void BinarySerializationNode::setValueBoolVector(const std::vector<bool> &vec)
+{
+	this->type = BinaryValueType::BoolVector;
+	this->number = vec.size();
+	this->text.assign((vec.size() + 7) / 8, '\0');
+	for (size_t i = 0; i < vec.size(); i++)
+	{
+		if (vec[i])
+			this->text[i / 8] |= static_cast<char>(1 << (i % 8));
+	}
+}
+
+UString BinarySerializationNode::getFullPath()
+{
+	UString str;
+	if (this->parent)
+	{
+		str = this->parent->getFullPath();
+	}
+	else
+	{
+		str += this->getName();
+		str += ".bin:";
+	}
+	str += "/";
+	str += this->getName();
+	return str;
+}
+
 } // namespace OpenApoc
@@ -22,6 +22,11 @@ class SerializationNode
 	virtual SerializationNode *getSectionReq(const UString &name);
 	virtual SerializationNode *getSectionOpt(const UString &name) = 0;
 
+	// The children in order whatever their names, for going through a tree without knowing what
+	// is in it. Both return nullptr once there are no more
+	virtual SerializationNode *getFirstChildOpt() = 0;
+	virtual SerializationNode *getNextSiblingOpt() = 0;
+
 	SerializationNode *getNode(const UString &name) { return this->getNodeOpt(name); }
 	SerializationNode *getNextSibling(const UString &name) { return this->getNextSiblingOpt(name); }
 	SerializationNode *getSection(const UString &name) { return this->getSectionOpt(name); }
@@ -62,10 +67,22 @@ class SerializationNode
 	virtual ~SerializationNode() = default;
 };
 
+enum class SerializationFormat
+{
+	// One pugixml document per root, values written out as text
+	XML,
+	// One document per root with the tree in a tagged binary encoding, names stored once per
+	// document and values in their own type
+	Binary
+};
+
 class SerializationArchive
 {
   public:
-	static up<SerializationArchive> createArchive();
+	static up<SerializationArchive>
+	createArchive(SerializationFormat format = SerializationFormat::XML);
+	// Reads archives in either format, telling them apart by the format document binary archives
+	// are written with
 	static up<SerializationArchive> readArchive(const UString &path);
 
 	virtual SerializationNode *newRoot(const UString &prefix, const UString &name) = 0;
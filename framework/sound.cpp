@@ -48,4 +48,5 @@ void SoundBackend::playSample(sp<Sample> sample, Vec3<float> position, float gai
 	this->playSample(sample, gain * gainMultiplier);
 }
 void SoundBackend::setListenerPosition(Vec3<float> position) { this->listenerPosition = position; }
+void SoundBackend::prepareSamples(const std::vector<sp<Sample>> &) {}
 }; // namespace OpenApoc
@@ -116,6 +116,10 @@ class SoundBackend
 	/* A quick attempt at 'positional' audio */
 	virtual void playSample(sp<Sample> sample, Vec3<float> position, float gainMultiplier = 1.0f);
 	virtual void setListenerPosition(Vec3<float> position);
+
+	/* Readies samples to be played, such as converting them to the output format, so that
+	 * playing them later is quick. Safe to call from any thread, such as while loading */
+	virtual void prepareSamples(const std::vector<sp<Sample>> &samples);
 };
 
 class JukeBox
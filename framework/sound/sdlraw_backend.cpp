@@ -1,16 +1,21 @@
-#include "framework/framework.h"
+#include "framework/configfile.h"
 #include "framework/logger.h"
+#include "framework/metrics.h"
 #include "framework/sound_interface.h"
 #include "framework/trace.h"
+#include "library/resourcecache.h"
 #include "library/sp.h"
 #include "library/vec.h"
 #include <SDL.h>
 #include <SDL_audio.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
-#include <list>
 #include <mutex>
-#include <queue>
+#include <thread>
 #include <vector>
 
 namespace
@@ -18,19 +23,100 @@ namespace
 
 using namespace OpenApoc;
 
+ConfigOptionInt maxVoicesOption("Framework.Audio", "MaxVoices",
+                                "Most sounds mixed at once, the quietest making way for louder "
+                                "ones (0 for no limit)",
+                                32);
+ConfigOptionInt musicDecodeAheadOption("Framework.Audio", "MusicDecodeAhead",
+                                       "Milliseconds of music decoded ahead of it playing", 500);
+ConfigOptionInt convertedSampleCacheOption("Framework.Audio", "ConvertedSampleCache",
+                                           "MiB of sounds converted to the output format kept "
+                                           "for when they are played again",
+                                           32);
+ConfigOptionInt maxSampleVoicesOption("Framework.Audio", "MaxSampleVoices",
+                                      "Most times the same sound is mixed at once, the quietest "
+                                      "making way for louder ones (0 for no limit)",
+                                      4);
+
+MetricGauge voicesGauge("Audio", "voices");
+
+class SDLSampleData;
+
+// A sample being mixed, only ever touched by the audio thread once queued
 struct SampleData
 {
-	sp<Sample> sample;
+	sp<SDLSampleData> data;
 	float gain;
 	unsigned int sample_position; // in bytes
-	SampleData(sp<Sample> sample, float gain) : sample(sample), gain(gain), sample_position(0) {}
+	SampleData() : gain(0.0f), sample_position(0) {}
+	SampleData(sp<SDLSampleData> data, float gain)
+	    : data(data), gain(gain), sample_position(0)
+	{
+	}
 };
 
 struct MusicData
 {
-	MusicData() : sample_position(0) {}
+	MusicData() : sample_position(0), generation(0) {}
 	std::vector<unsigned char> samples;
 	unsigned int sample_position; // in bytes
+	// The music_generation it was decoded for, older music is dropped instead of played
+	unsigned int generation;
+};
+
+// A queue with one thread pushing and another popping that neither locks nor waits, so the audio
+// thread never stalls on the threads feeding it. It holds up to N - 1 items
+template <typename T, size_t N> class SPSCRing
+{
+  private:
+	std::array<T, N> items;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+
+  public:
+	SPSCRing() : head(0), tail(0) {}
+
+	// Only from the pushing thread, returning false if the ring is full
+	bool push(T item)
+	{
+		auto t = tail.load(std::memory_order_relaxed);
+		auto next = (t + 1) % N;
+		if (next == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		items[t] = std::move(item);
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Only from the popping thread, returning false if the ring is empty
+	bool pop(T &item)
+	{
+		auto h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = std::move(items[h]);
+		head.store((h + 1) % N, std::memory_order_release);
+		return true;
+	}
+
+	// Only from the pushing thread, as the popping thread may have made room by the time it
+	// returns
+	bool full() const
+	{
+		return (tail.load(std::memory_order_relaxed) + 1) % N ==
+		       head.load(std::memory_order_acquire);
+	}
+
+	// From either thread, which may be out of date by the time it returns
+	size_t size() const
+	{
+		return (tail.load(std::memory_order_acquire) + N - head.load(std::memory_order_acquire)) %
+		       N;
+	}
 };
 
 // 'samples' must already be large enough to contain the full output size
@@ -104,38 +190,82 @@ static void unwrap_callback(void *userdata, Uint8 *stream, int len);
 
 class SDLRawBackend : public SoundBackend
 {
-	std::recursive_mutex audio_lock;
-
-	float overall_volume;
-	float music_volume;
-	float sound_volume;
-
+	// Kept by the audio thread, so mixing never waits on a lock the game thread may be holding
+	// while it stalls. The game thread queues samples through sample_queue and sets the gains,
+	// and the music thread decodes music into music_queue
+	std::atomic<float> overall_volume;
+	std::atomic<float> music_volume;
+	std::atomic<float> sound_volume;
+
+	// Only used by the audio thread
+	std::vector<SampleData> live_samples;
+	size_t max_voices;
+	size_t max_sample_voices;
+	sp<MusicData> current_music_data;
+	std::vector<float> mix_buffer;
+
+	// Only for callers of playSample() to share sample_queue between them
+	std::mutex sample_queue_lock;
+	SPSCRing<SampleData, 256> sample_queue;
+	SPSCRing<sp<MusicData>, 32> music_queue;
+	// Bytes of music in music_queue and left of current_music_data, counted up by the music
+	// thread and down by the audio thread
+	std::atomic<size_t> music_queued_bytes;
+
+	// Guards the music state below, never taken by the audio thread. Recursive as the music
+	// finished callback may start the next track
+	std::recursive_mutex music_lock;
+	std::condition_variable_any music_wanted_condition;
 	sp<MusicTrack> track;
-	bool music_playing;
-
+	std::atomic<bool> music_playing;
+	// Counted up whenever the music changes, so the audio thread drops whatever it has queued
+	std::atomic<unsigned int> music_generation;
+	std::atomic<bool> music_wanted;
+	std::atomic<unsigned int> music_underruns;
+	bool music_thread_quit;
+	bool music_finishing;
 	std::function<void(void *)> music_finished_callback;
 	void *music_callback_data;
 
-	std::list<SampleData> live_samples;
-
 	SDL_AudioDeviceID devID;
 	SDL_AudioSpec output_spec;
 	AudioFormat preferred_format;
 
-	sp<MusicData> current_music_data;
-	std::queue<sp<MusicData>> music_queue;
+	// Samples converted to output_spec by path, so that samples let go of by the Data cache and
+	// loaded again are not converted again either
+	ResourceCacheBudget converted_samples_budget;
+	ResourceCache<SDLSampleData> converted_samples;
 
-	std::shared_future<void> get_music_future;
+	size_t music_decode_ahead_bytes;
 
-	unsigned int music_queue_size;
+	std::thread music_thread;
+
+	// Decodes music on its own thread, keeping music_decode_ahead_bytes of it ready ahead of the
+	// audio thread however busy the thread pool is. The audio thread cannot wake it up without a
+	// lock, so it looks every few milliseconds whether the audio thread took any
+	void musicThreadLoop()
+	{
+		std::unique_lock<std::recursive_mutex> lock(this->music_lock);
+		while (!this->music_thread_quit)
+		{
+			this->music_wanted_condition.wait_for(lock, std::chrono::milliseconds(5), [this] {
+				return this->music_thread_quit || this->music_wanted.load();
+			});
+			this->music_wanted = false;
+			auto underruns = this->music_underruns.exchange(0);
+			if (underruns)
+			{
+				LogWarning("Music underrun in %u audio callbacks!", underruns);
+			}
+			getMoreMusic();
+		}
+	}
 
 	void getMoreMusic()
 	{
 		TRACE_FN;
-		std::lock_guard<std::recursive_mutex> lock(this->audio_lock);
 		if (!this->music_playing)
 		{
-			// Music probably disabled in the time it took us to be scheduled?
 			return;
 		}
 		if (!this->track)
@@ -143,9 +273,11 @@ class SDLRawBackend : public SoundBackend
 			LogWarning("Music playing but no track?");
 			return;
 		}
-		while (this->music_queue.size() < this->music_queue_size)
+		while (this->track && this->music_queued_bytes < this->music_decode_ahead_bytes &&
+		       !this->music_queue.full())
 		{
 			auto data = mksp<MusicData>();
+			data->generation = this->music_generation;
 
 			unsigned int input_size = this->track->format.getSampleSize() *
 			                          this->track->format.channels *
@@ -181,97 +313,203 @@ class SDLRawBackend : public SoundBackend
 				this->track = nullptr;
 				if (this->music_finished_callback)
 				{
+					// The next track it sets follows on from what is queued of this one
+					this->music_finishing = true;
 					this->music_finished_callback(music_callback_data);
+					this->music_finishing = false;
 				}
 			}
-			this->music_queue.push(data);
+			// Music that changed while decoding is not worth queueing
+			if (data->generation == this->music_generation)
+			{
+				this->music_queued_bytes += data->samples.size();
+				this->music_queue.push(data);
+			}
 		}
 	}
 
-  public:
-	void mixingCallback(Uint8 *stream, int len)
+	// Restarts what the audio thread plays of the music, with music_lock held
+	void resetMusic()
 	{
-		TRACE_FN;
-		// initialize stream buffer
-		memset(stream, 0, len);
-		std::lock_guard<std::recursive_mutex> lock(this->audio_lock);
+		if (!this->music_finishing)
+		{
+			this->music_generation++;
+		}
+		this->music_wanted = true;
+		this->music_wanted_condition.notify_one();
+	}
+
+	void dropMusicData()
+	{
+		this->music_queued_bytes -=
+		    this->current_music_data->samples.size() - this->current_music_data->sample_position;
+		this->current_music_data = nullptr;
+	}
 
-		if (this->current_music_data || !this->music_queue.empty())
+	void mixMusic(float *mix, size_t count)
+	{
+		float gain = this->overall_volume * this->music_volume;
+		unsigned int generation = this->music_generation;
+		size_t mixed = 0;
+		while (mixed < count)
 		{
-			int int_music_volume =
-			    clamp((int)lrint(this->overall_volume * this->music_volume * 128.0f), 0, 128);
-			int music_bytes = 0;
-			while (music_bytes < len)
+			if (this->current_music_data && this->current_music_data->generation != generation)
+			{
+				dropMusicData();
+			}
+			while (!this->current_music_data && this->music_queue.pop(this->current_music_data))
+			{
+				if (this->current_music_data->generation != generation)
+				{
+					dropMusicData();
+				}
+				else
+				{
+					this->music_wanted = true;
+				}
+			}
+			if (!this->current_music_data)
 			{
-				if (!this->current_music_data)
+				// Running out part of the way through is an underrun, having nothing at all is
+				// music not having started yet or having ended
+				if (mixed > 0 && this->music_playing)
 				{
-					this->get_music_future =
-					    fw().threadPoolEnqueue(std::mem_fn(&SDLRawBackend::getMoreMusic), this);
-					if (this->music_queue.empty())
-					{
-						LogWarning("Music underrun!");
-						break;
-					}
-					this->current_music_data = this->music_queue.front();
-					this->music_queue.pop();
+					this->music_underruns++;
+					this->music_wanted = true;
 				}
-				int bytes_from_this_chunk =
-				    std::min(len - music_bytes, (int)(this->current_music_data->samples.size() -
-				                                      this->current_music_data->sample_position));
-				SDL_MixAudioFormat(stream + music_bytes,
-				                   this->current_music_data->samples.data() +
-				                       this->current_music_data->sample_position,
-				                   this->output_spec.format, bytes_from_this_chunk,
-				                   int_music_volume);
-				music_bytes += bytes_from_this_chunk;
-				this->current_music_data->sample_position += bytes_from_this_chunk;
-				LogAssert(this->current_music_data->sample_position <=
-				          this->current_music_data->samples.size());
-				if (this->current_music_data->sample_position ==
-				    this->current_music_data->samples.size())
+				return;
+			}
+			auto &samples = this->current_music_data->samples;
+			auto position = this->current_music_data->sample_position / sizeof(int16_t);
+			auto available = samples.size() / sizeof(int16_t) - position;
+			auto mixing = std::min(count - mixed, available);
+			auto source = reinterpret_cast<const int16_t *>(samples.data()) + position;
+			for (size_t i = 0; i < mixing; i++)
+			{
+				mix[mixed + i] += source[i] * gain;
+			}
+			mixed += mixing;
+			this->current_music_data->sample_position += mixing * sizeof(int16_t);
+			this->music_queued_bytes -= mixing * sizeof(int16_t);
+			if (mixing == available)
+			{
+				this->current_music_data = nullptr;
+			}
+		}
+	}
+
+	// Starts mixing voice unless that would go over max_voices, or max_sample_voices of the same
+	// sample, in which case it takes the place of the quietest voice it would go over the limit
+	// with, if that is not louder than it
+	void addVoice(SampleData voice)
+	{
+		// Of two voices as loud, the one further through its sample is the one to go
+		auto quieter = [](const SampleData &a, const SampleData &b) {
+			return a.gain < b.gain || (a.gain == b.gain && a.sample_position > b.sample_position);
+		};
+		size_t sameSample = 0;
+		auto quietest = this->live_samples.end();
+		auto quietestSame = this->live_samples.end();
+		for (auto it = this->live_samples.begin(); it != this->live_samples.end(); it++)
+		{
+			if (it->data == voice.data)
+			{
+				sameSample++;
+				if (quietestSame == this->live_samples.end() || quieter(*it, *quietestSame))
 				{
-					this->current_music_data = nullptr;
+					quietestSame = it;
 				}
 			}
+			if (quietest == this->live_samples.end() || quieter(*it, *quietest))
+			{
+				quietest = it;
+			}
+		}
+
+		auto replaced = this->live_samples.end();
+		if (this->max_sample_voices > 0 && sameSample >= this->max_sample_voices)
+		{
+			replaced = quietestSame;
+		}
+		else if (this->max_voices > 0 && this->live_samples.size() >= this->max_voices)
+		{
+			replaced = quietest;
+		}
+		if (replaced == this->live_samples.end())
+		{
+			this->live_samples.push_back(std::move(voice));
+		}
+		else if (voice.gain >= replaced->gain)
+		{
+			*replaced = std::move(voice);
+		}
+	}
+
+  public:
+	void mixingCallback(Uint8 *stream, int len)
+	{
+		TRACE_FN;
+		// The device is opened to always take native 16 bit samples, so everything is mixed as
+		// such. The loops are kept plain for the compiler to vectorise
+		size_t count = len / sizeof(int16_t);
+		if (this->mix_buffer.size() < count)
+		{
+			this->mix_buffer.resize(count);
 		}
+		float *mix = this->mix_buffer.data();
+		std::fill(mix, mix + count, 0.0f);
 
-		auto sampleIt = this->live_samples.begin();
-		while (sampleIt != this->live_samples.end())
+		mixMusic(mix, count);
+
+		SampleData queued;
+		while (this->sample_queue.pop(queued))
+		{
+			addVoice(std::move(queued));
+		}
+
+		float sound_gain = this->overall_volume * this->sound_volume;
+		size_t sampleIndex = 0;
+		while (sampleIndex < this->live_samples.size())
 		{
-			int int_sample_volume = clamp(
-			    (int)lrint(this->overall_volume * this->sound_volume * sampleIt->gain * 128.0f), 0,
-			    128);
-			auto sampleData =
-			    std::dynamic_pointer_cast<SDLSampleData>(sampleIt->sample->backendData);
-			if (!sampleData)
+			auto &sample = this->live_samples[sampleIndex];
+			auto &samples = sample.data->samples;
+			auto position = sample.sample_position / sizeof(int16_t);
+			auto mixing = std::min(count, samples.size() / sizeof(int16_t) - position);
+			auto source = reinterpret_cast<const int16_t *>(samples.data()) + position;
+			float gain = sound_gain * sample.gain;
+			for (size_t i = 0; i < mixing; i++)
 			{
-				LogWarning("Sample with invalid sample data");
-				// Clear it in case we've changed drivers or something
-				sampleIt->sample->backendData = nullptr;
-				sampleIt = this->live_samples.erase(sampleIt);
-				continue;
+				mix[i] += source[i] * gain;
 			}
-			if (sampleIt->sample_position == sampleData->samples.size())
+			sample.sample_position += mixing * sizeof(int16_t);
+			if (sample.sample_position >= samples.size())
 			{
 				// Reached the end of the sample
-				sampleIt = this->live_samples.erase(sampleIt);
+				std::swap(sample, this->live_samples.back());
+				this->live_samples.pop_back();
 				continue;
 			}
+			sampleIndex++;
+		}
+		voicesGauge.set(this->live_samples.size());
 
-			unsigned bytes_to_mix =
-			    std::min(len, (int)(sampleData->samples.size() - sampleIt->sample_position));
-			SDL_MixAudioFormat(stream, sampleData->samples.data() + sampleIt->sample_position,
-			                   this->output_spec.format, bytes_to_mix, int_sample_volume);
-			sampleIt->sample_position += bytes_to_mix;
-			LogAssert(sampleIt->sample_position <= sampleData->samples.size());
-
-			sampleIt++;
+		auto output = reinterpret_cast<int16_t *>(stream);
+		for (size_t i = 0; i < count; i++)
+		{
+			output[i] = static_cast<int16_t>(clamp(mix[i], -32768.0f, 32767.0f));
 		}
 	}
 
 	SDLRawBackend()
-	    : overall_volume(1.0f), music_volume(1.0f), sound_volume(1.0f), music_playing(false),
-	      music_callback_data(nullptr), music_queue_size(2)
+	    : overall_volume(1.0f), music_volume(1.0f), sound_volume(1.0f),
+	      max_voices(std::max(0, maxVoicesOption.get())),
+	      max_sample_voices(std::max(0, maxSampleVoicesOption.get())), music_queued_bytes(0),
+	      music_playing(false), music_generation(0), music_wanted(false), music_underruns(0),
+	      music_thread_quit(false), music_finishing(false), music_callback_data(nullptr),
+	      converted_samples_budget(
+	          static_cast<size_t>(std::max(0, convertedSampleCacheOption.get())) * 1024 * 1024),
+	      converted_samples(&converted_samples_budget,
+	                        [](const SDLSampleData &data) { return data.samples.size(); })
 	{
 		SDL_Init(SDL_INIT_AUDIO);
 		preferred_format.channels = 2;
@@ -291,7 +529,7 @@ class SDLRawBackend : public SoundBackend
 		LogInfo("Using audio device: %s", deviceName);
 		SDL_AudioSpec wantFormat;
 		wantFormat.channels = 2;
-		wantFormat.format = AUDIO_S16LSB;
+		wantFormat.format = AUDIO_S16SYS;
 		wantFormat.freq = 22050;
 		wantFormat.samples = 512;
 		wantFormat.callback = unwrap_callback;
@@ -301,8 +539,14 @@ class SDLRawBackend : public SoundBackend
 		             // available
 		    0,       // capturing is not supported
 		    &wantFormat, &output_spec,
-		    SDL_AUDIO_ALLOW_ANY_CHANGE); // hopefully we'll get a sane output format
-		SDL_PauseAudioDevice(devID, 0);  // Run at once?
+		    // SDL converts to the device's format if it differs, as mixing relies on it
+		    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+		mix_buffer.resize(output_spec.samples * output_spec.channels);
+		music_decode_ahead_bytes = static_cast<size_t>(std::max(1, musicDecodeAheadOption.get())) *
+		                           output_spec.freq / 1000 * output_spec.channels * sizeof(int16_t);
+		live_samples.reserve(max_voices > 0 ? max_voices : 64);
+		music_thread = std::thread(std::mem_fn(&SDLRawBackend::musicThreadLoop), this);
+		SDL_PauseAudioDevice(devID, 0); // Run at once?
 
 		LogWarning("Audio output format: Channels %d, format: %s %s %s %dbit, freq %d, samples %d",
 		           (int)output_spec.channels,
@@ -312,67 +556,94 @@ class SDLRawBackend : public SoundBackend
 		           SDL_AUDIO_BITSIZE(output_spec.format), (int)output_spec.freq,
 		           (int)output_spec.samples);
 	}
+	sp<SDLSampleData> convertSample(const sp<Sample> &sample)
+	{
+		if (sample->path.empty())
+		{
+			return mksp<SDLSampleData>(sample, this->output_spec);
+		}
+		return this->converted_samples.get(sample->path.toUpper(), [this, &sample] {
+			return mksp<SDLSampleData>(sample, this->output_spec);
+		});
+	}
+
+	void prepareSamples(const std::vector<sp<Sample>> &samples) override
+	{
+		TRACE_FN;
+		// Only the cache is filled, as backendData is only ever touched by the thread playing them
+		for (auto &sample : samples)
+		{
+			if (sample)
+			{
+				convertSample(sample);
+			}
+		}
+	}
+
 	void playSample(sp<Sample> sample, float gain) override
 	{
 		// Clamp to 0..1
 		gain = std::min(1.0f, std::max(0.0f, gain));
-		if (!sample->backendData)
+		auto sampleData = std::dynamic_pointer_cast<SDLSampleData>(sample->backendData);
+		if (!sampleData)
 		{
-			sample->backendData.reset(new SDLSampleData(sample, this->output_spec));
+			// Either never played or made by another driver
+			sampleData = convertSample(sample);
+			sample->backendData = sampleData;
 		}
+		if (sampleData->samples.empty())
 		{
-			std::lock_guard<std::recursive_mutex> l(this->audio_lock);
-			this->live_samples.emplace_back(sample, gain);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> l(this->sample_queue_lock);
+			if (!this->sample_queue.push(SampleData(sampleData, gain)))
+			{
+				LogWarning("Too many sounds queued, dropping sound %p", sample.get());
+				return;
+			}
 		}
 		LogInfo("Placed sound %p on queue", sample.get());
 	}
 
 	void playMusic(std::function<void(void *)> finishedCallback, void *callbackData) override
 	{
-		std::lock_guard<std::recursive_mutex> l(this->audio_lock);
-		while (!music_queue.empty())
-			music_queue.pop();
+		std::lock_guard<std::recursive_mutex> l(this->music_lock);
 		music_finished_callback = finishedCallback;
 		music_callback_data = callbackData;
 		music_playing = true;
-		this->get_music_future =
-		    fw().threadPoolEnqueue(std::mem_fn(&SDLRawBackend::getMoreMusic), this);
+		resetMusic();
 		LogInfo("Playing music on SDL backend");
 	}
 
 	void setTrack(sp<MusicTrack> track) override
 	{
-		std::lock_guard<std::recursive_mutex> l(this->audio_lock);
+		std::lock_guard<std::recursive_mutex> l(this->music_lock);
 		LogInfo("Setting track to %p", track.get());
 		this->track = track;
-		while (!music_queue.empty())
-			music_queue.pop();
+		resetMusic();
 	}
 
 	void stopMusic() override
 	{
-		std::shared_future<void> outstanding_get_music;
-		{
-			std::lock_guard<std::recursive_mutex> l(this->audio_lock);
-			this->music_playing = false;
-			this->track = nullptr;
-			if (this->get_music_future.valid())
-				outstanding_get_music = std::move(this->get_music_future);
-			while (!music_queue.empty())
-				music_queue.pop();
-		}
-		if (outstanding_get_music.valid())
-			outstanding_get_music.wait();
+		std::lock_guard<std::recursive_mutex> l(this->music_lock);
+		this->music_playing = false;
+		this->track = nullptr;
+		resetMusic();
 	}
 
 	~SDLRawBackend() override
 	{
-		// Lock the device and stop any outstanding music threads to ensure everything is dead
-		// before destroying the device
-		SDL_LockAudioDevice(devID);
+		// Stop the device and the music thread to ensure everything is dead before destroying
+		// the device
 		SDL_PauseAudioDevice(devID, 1);
 		this->stopMusic();
-		SDL_UnlockAudioDevice(devID);
+		{
+			std::lock_guard<std::recursive_mutex> l(this->music_lock);
+			this->music_thread_quit = true;
+		}
+		this->music_wanted_condition.notify_one();
+		this->music_thread.join();
 		SDL_CloseAudioDevice(devID);
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	}
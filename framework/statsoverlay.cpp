@@ -0,0 +1,171 @@
+#include "framework/statsoverlay.h"
+#include "framework/apocresources/apocfont.h"
+#include "framework/data.h"
+#include "framework/font.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "framework/metrics.h"
+#include "framework/palette.h"
+#include "framework/trace.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <limits>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+static const UString FONT_PATH = "fonts/smalfont.font";
+static const UString PALETTE_PATH = "xcom3/ufodata/pal_06.dat";
+
+// Upper bounds of the histogram's bars in milliseconds, the last taking anything longer
+static const std::vector<float> HISTOGRAM_BOUNDS = {10.0f, 15.0f, 20.0f, 33.0f, 50.0f, 100.0f,
+                                                    std::numeric_limits<float>::infinity()};
+static const int HISTOGRAM_BAR_WIDTH = 200;
+
+static const Colour BACKGROUND_COLOUR = {0, 0, 0, 192};
+static const Colour BAR_COLOUR = {96, 192, 96, 255};
+
+MetricHistogram frameTimesHistogram("Frame", "ms", {10.0, 15.0, 20.0, 33.0, 50.0, 100.0});
+MetricGauge drawCallsGauge("Renderer", "draw calls");
+MetricGauge spritesGauge("Renderer", "sprites");
+MetricGauge textureUploadsGauge("Renderer", "texture uploads");
+MetricGauge texturePagesGauge("Renderer", "texture pages");
+MetricGauge fontStringsGauge("Renderer", "font strings");
+
+} // anonymous namespace
+
+StatsOverlay::StatsOverlay() { history.reserve(HISTORY_FRAMES); }
+
+StatsOverlay::~StatsOverlay() = default;
+
+void StatsOverlay::toggle()
+{
+	visible = !visible;
+	if (visible && !font)
+	{
+		font = ApocalypseFont::loadFont(FONT_PATH);
+		palette = fw().data->loadPalette(PALETTE_PATH);
+		if (!font || !palette)
+		{
+			LogWarning("Failed to load \"%s\" for the stats overlay", FONT_PATH);
+			font = nullptr;
+			visible = false;
+		}
+	}
+}
+
+void StatsOverlay::frameDone(const FrameTimes &times, const RendererStats &rendererStats)
+{
+	lastTimes = times;
+	lastStats = rendererStats;
+	if (history.size() < HISTORY_FRAMES)
+	{
+		history.push_back(times.total());
+	}
+	else
+	{
+		history[nextHistory] = times.total();
+		nextHistory = (nextHistory + 1) % HISTORY_FRAMES;
+	}
+
+	frameTimesHistogram.add(times.total());
+	drawCallsGauge.set(rendererStats.drawCalls);
+	spritesGauge.set(rendererStats.sprites);
+	textureUploadsGauge.set(rendererStats.textureUploads);
+	texturePagesGauge.set(rendererStats.texturePages);
+	fontStringsGauge.set(rendererStats.fontStrings);
+
+	if (!Trace::enabled)
+	{
+		return;
+	}
+	Trace::counter("Frame ms", {{"jobs", Strings::fromFloat(times.jobs)},
+	                            {"events", Strings::fromFloat(times.events)},
+	                            {"update", Strings::fromFloat(times.update)},
+	                            {"upload", Strings::fromFloat(times.upload)},
+	                            {"render", Strings::fromFloat(times.render)},
+	                            {"flip", Strings::fromFloat(times.flip)}});
+}
+
+void StatsOverlay::render(Renderer &r)
+{
+	if (!visible)
+	{
+		return;
+	}
+
+	std::vector<UString> lines;
+	lines.push_back(format("Frame %.1fms: jobs %.1f events %.1f update %.1f upload %.1f render "
+	                       "%.1f flip %.1f",
+	                       lastTimes.total(), lastTimes.jobs, lastTimes.events, lastTimes.update,
+	                       lastTimes.upload, lastTimes.render, lastTimes.flip));
+	lines.push_back(format("Draw calls %u sprites %u texture uploads %u pages %u strings %u",
+	                       lastStats.drawCalls, lastStats.sprites, lastStats.textureUploads,
+	                       lastStats.texturePages, lastStats.fontStrings));
+	lines.push_back(format("Last %u frames:", static_cast<unsigned int>(history.size())));
+
+	std::vector<unsigned int> counts(HISTOGRAM_BOUNDS.size(), 0);
+	for (auto time : history)
+	{
+		auto bound = std::upper_bound(HISTOGRAM_BOUNDS.begin(), HISTOGRAM_BOUNDS.end(), time);
+		counts[std::min<size_t>(bound - HISTOGRAM_BOUNDS.begin(), counts.size() - 1)]++;
+	}
+	std::vector<UString> labels;
+	for (unsigned int i = 0; i < HISTOGRAM_BOUNDS.size(); i++)
+	{
+		if (i + 1 < HISTOGRAM_BOUNDS.size())
+		{
+			labels.push_back(format("<%.0fms %u", HISTOGRAM_BOUNDS[i], counts[i]));
+		}
+		else
+		{
+			labels.push_back(format(">=%.0fms %u", HISTOGRAM_BOUNDS[i - 1], counts[i]));
+		}
+	}
+
+	int lineHeight = font->getFontHeight() + 2;
+	int width = 0;
+	for (auto &line : lines)
+	{
+		width = std::max(width, font->getFontWidth(line));
+	}
+	int labelWidth = 0;
+	for (auto &label : labels)
+	{
+		labelWidth = std::max(labelWidth, font->getFontWidth(label));
+	}
+	width = std::max(width, labelWidth + 4 + HISTOGRAM_BAR_WIDTH);
+	int height = lineHeight * static_cast<int>(lines.size() + labels.size());
+
+	// Drawn with the palette the UI is, since the overlay goes over whatever the stage drew
+	auto previousPalette = r.getPalette();
+	r.setPalette(palette);
+	Vec2<float> position = {4, 4};
+	r.drawFilledRect(position - Vec2<float>{2, 2}, Vec2<float>{width + 4, height + 4},
+	                 BACKGROUND_COLOUR);
+	for (auto &line : lines)
+	{
+		font->drawString(line, position);
+		position.y += lineHeight;
+	}
+	for (unsigned int i = 0; i < labels.size(); i++)
+	{
+		font->drawString(labels[i], position);
+		if (counts[i] > 0)
+		{
+			float barWidth = static_cast<float>(HISTOGRAM_BAR_WIDTH) * counts[i] / history.size();
+			r.drawFilledRect(position + Vec2<float>{labelWidth + 4, 0},
+			                 Vec2<float>{std::max(barWidth, 1.0f), lineHeight - 2}, BAR_COLOUR);
+		}
+		position.y += lineHeight;
+	}
+	if (previousPalette)
+	{
+		r.setPalette(previousPalette);
+	}
+}
+
+}; // namespace OpenApoc
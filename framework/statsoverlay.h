@@ -0,0 +1,61 @@
+#pragma once
+
+#include "framework/renderer.h"
+#include "library/sp.h"
+#include <vector>
+
+namespace OpenApoc
+{
+
+class BitmapFont;
+class Palette;
+
+// Milliseconds spent on each part of one frame of Framework::run
+class FrameTimes
+{
+  public:
+	// Waiting on the last frame's jobs, see Framework::frameQueueJob()
+	float jobs = 0.0f;
+	float events = 0.0f;
+	float update = 0.0f;
+	// Getting images loaded in the background ready to draw, see Framework::frameQueueUpload()
+	float upload = 0.0f;
+	float render = 0.0f;
+	// Flushing the renderer and swapping the window
+	float flip = 0.0f;
+
+	float total() const { return jobs + events + update + upload + render + flip; }
+};
+
+// Counters of the last frame and how long recent frames took, drawn over everything when toggled
+// by a hotkey so they can be read off or screenshotted for performance reports. They are recorded
+// as trace counters as well, whether shown or not
+class StatsOverlay
+{
+  private:
+	// Frames the histogram of frame times is made of
+	static const unsigned int HISTORY_FRAMES = 200;
+
+	bool visible = false;
+	sp<BitmapFont> font;
+	sp<Palette> palette;
+
+	FrameTimes lastTimes;
+	RendererStats lastStats;
+	// Total time of each of the last HISTORY_FRAMES frames, nextHistory being the oldest once full
+	std::vector<float> history;
+	unsigned int nextHistory = 0;
+
+  public:
+	StatsOverlay();
+	~StatsOverlay();
+
+	void toggle();
+	bool isVisible() const { return visible; }
+
+	// Takes note of a frame once it is done, with what the renderer drew in it
+	void frameDone(const FrameTimes &times, const RendererStats &rendererStats);
+	void render(Renderer &r);
+};
+
+}; // namespace OpenApoc
@@ -0,0 +1,344 @@
+#include "framework/threadedrenderer.h"
+#include "framework/image.h"
+#include "framework/logger.h"
+#include "framework/palette.h"
+#include "framework/trace.h"
+#include <atomic>
+#include <utility>
+
+namespace OpenApoc
+{
+
+namespace
+{
+// The renderer that draws on a thread of its own, if any
+std::atomic<ThreadedRenderer *> activeRenderer{nullptr};
+} // anonymous namespace
+
+void releaseRendererData(sp<RendererImageData> data)
+{
+	if (!data)
+	{
+		return;
+	}
+	auto renderer = activeRenderer.load();
+	if (renderer)
+	{
+		renderer->release(std::move(data));
+	}
+}
+
+ThreadedRenderer::ThreadedRenderer(up<Renderer> renderer, PresentFunction present,
+                                   ContextFunction context)
+    : renderer(std::move(renderer)), present(std::move(present)), context(std::move(context)),
+      recording(mkup<Frame>())
+{
+	this->currentSurface = this->renderer->getSurface();
+	this->currentPalette = this->renderer->getPalette();
+	this->defaultSurface = this->renderer->getDefaultSurface();
+	this->name = this->renderer->getName() + " (threaded)";
+	this->context(false);
+	this->thread = std::thread([this] { this->threadMain(); });
+	activeRenderer = this;
+}
+
+ThreadedRenderer::~ThreadedRenderer()
+{
+	activeRenderer = nullptr;
+	{
+		std::unique_lock<std::mutex> l(this->lock);
+		waitIdle(l);
+		this->stopping = true;
+		this->changed.notify_all();
+	}
+	this->thread.join();
+	this->context(true);
+	// Everything left holding renderer data has to go while the context is still here
+	this->recording.reset();
+	this->spare.reset();
+	this->released.clear();
+	this->currentSurface.reset();
+	this->currentPalette.reset();
+	this->defaultSurface.reset();
+	this->renderer.reset();
+}
+
+void ThreadedRenderer::submitFrame()
+{
+	auto frame = std::move(this->recording);
+	frame->present = true;
+	{
+		std::unique_lock<std::mutex> l(this->lock);
+		waitIdle(l);
+		// The renderer only counts what it draws, the rest is counted here as it is recorded
+		auto fontStrings = this->frameStats.fontStrings;
+		this->lastFrameStats = this->finishedStats;
+		this->lastFrameStats.fontStrings += fontStrings;
+		this->frameStats = RendererStats{};
+
+		this->submitted = std::move(frame);
+		this->recording = this->spare ? std::move(this->spare) : mkup<Frame>();
+		this->changed.notify_all();
+	}
+}
+
+void ThreadedRenderer::wait()
+{
+	std::unique_lock<std::mutex> l(this->lock);
+	waitIdle(l);
+}
+
+void ThreadedRenderer::run(std::function<void(Renderer &)> call)
+{
+	auto frame = mkup<Frame>();
+	frame->commands.emplace_back(Command::Op::Call);
+	frame->commands.back().call = std::move(call);
+	submit(std::move(frame));
+	wait();
+}
+
+void ThreadedRenderer::release(sp<RendererImageData> data)
+{
+	if (std::this_thread::get_id() == this->thread.get_id())
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> l(this->lock);
+	this->released.push_back(std::move(data));
+}
+
+void ThreadedRenderer::setSurface(sp<Surface> s)
+{
+	record(Command::Op::SetSurface).image = s;
+	this->currentSurface = s;
+}
+
+sp<Surface> ThreadedRenderer::getSurface() { return this->currentSurface; }
+
+void ThreadedRenderer::clear(Colour c) { record(Command::Op::Clear).colour = c; }
+
+void ThreadedRenderer::setPalette(sp<Palette> p)
+{
+	record(Command::Op::SetPalette).palette = p;
+	this->currentPalette = p;
+}
+
+sp<Palette> ThreadedRenderer::getPalette() { return this->currentPalette; }
+
+void ThreadedRenderer::draw(sp<Image> i, Vec2<float> position)
+{
+	auto &command = record(Command::Op::Draw);
+	command.image = std::move(i);
+	command.a = position;
+}
+
+void ThreadedRenderer::drawRotated(sp<Image> i, Vec2<float> center, Vec2<float> position,
+                                   float angle)
+{
+	auto &command = record(Command::Op::DrawRotated);
+	command.image = std::move(i);
+	command.a = center;
+	command.b = position;
+	command.value = angle;
+}
+
+void ThreadedRenderer::drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size,
+                                  Scaler scaler)
+{
+	auto &command = record(Command::Op::DrawScaled);
+	command.image = std::move(i);
+	command.a = position;
+	command.b = size;
+	command.scaler = scaler;
+}
+
+void ThreadedRenderer::drawTinted(sp<Image> i, Vec2<float> position, Colour tint)
+{
+	auto &command = record(Command::Op::DrawTinted);
+	command.image = std::move(i);
+	command.a = position;
+	command.colour = tint;
+}
+
+void ThreadedRenderer::drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c)
+{
+	auto &command = record(Command::Op::DrawFilledRect);
+	command.a = position;
+	command.b = size;
+	command.colour = c;
+}
+
+void ThreadedRenderer::drawRect(Vec2<float> position, Vec2<float> size, Colour c,
+                                float thickness)
+{
+	auto &command = record(Command::Op::DrawRect);
+	command.a = position;
+	command.b = size;
+	command.colour = c;
+	command.value = thickness;
+}
+
+void ThreadedRenderer::drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness)
+{
+	auto &command = record(Command::Op::DrawLine);
+	command.a = p1;
+	command.b = p2;
+	command.colour = c;
+	command.value = thickness;
+}
+
+void ThreadedRenderer::drawSprites(const std::vector<RendererSprite> &sprites)
+{
+	if (sprites.empty())
+	{
+		return;
+	}
+	auto &command = record(Command::Op::DrawSprites);
+	command.sprites = sprites;
+	command.spriteImages.reserve(sprites.size());
+	for (auto &sprite : sprites)
+	{
+		command.spriteImages.push_back(sprite.image->shared_from_this());
+	}
+}
+
+void ThreadedRenderer::flush() { record(Command::Op::Flush); }
+
+UString ThreadedRenderer::getName() { return this->name; }
+
+void ThreadedRenderer::newFrame() { record(Command::Op::NewFrame); }
+
+void ThreadedRenderer::compact()
+{
+	record(Command::Op::Call).call = [](Renderer &r) { r.compact(); };
+}
+
+void ThreadedRenderer::preload(const std::vector<sp<Image>> &images)
+{
+	record(Command::Op::Call).call = [images](Renderer &r) { r.preload(images); };
+}
+
+sp<Surface> ThreadedRenderer::getDefaultSurface() { return this->defaultSurface; }
+
+ThreadedRenderer::Command &ThreadedRenderer::record(Command::Op op)
+{
+	this->recording->commands.emplace_back(op);
+	return this->recording->commands.back();
+}
+
+void ThreadedRenderer::submit(up<Frame> frame)
+{
+	std::unique_lock<std::mutex> l(this->lock);
+	waitIdle(l);
+	this->submitted = std::move(frame);
+	this->changed.notify_all();
+}
+
+void ThreadedRenderer::waitIdle(std::unique_lock<std::mutex> &l)
+{
+	if (this->submitted)
+	{
+		TraceObj obj("Wait for render thread");
+		this->changed.wait(l, [this] { return !this->submitted; });
+	}
+}
+
+void ThreadedRenderer::threadMain()
+{
+	Trace::setThreadName("Render");
+	this->context(true);
+	std::unique_lock<std::mutex> l(this->lock);
+	while (true)
+	{
+		this->changed.wait(l, [this] { return this->submitted || this->stopping; });
+		if (!this->submitted)
+		{
+			break;
+		}
+		// Nothing else touches a submitted frame until the thread is done with it
+		auto &frame = *this->submitted;
+		bool presented = frame.present;
+		l.unlock();
+		drawFrame(frame);
+		if (presented)
+		{
+			TraceObj obj("Flip");
+			this->renderer->endFrameStats();
+			this->present();
+		}
+		// Whatever only the frame kept alive goes here, on the thread its renderer data is for
+		frame.commands.clear();
+		frame.present = false;
+		std::vector<sp<RendererImageData>> releasedData;
+		l.lock();
+		releasedData.swap(this->released);
+		l.unlock();
+		releasedData.clear();
+		l.lock();
+		if (presented)
+		{
+			this->finishedStats = this->renderer->lastFrameStats;
+		}
+		this->spare = std::move(this->submitted);
+		this->changed.notify_all();
+	}
+	l.unlock();
+	this->context(false);
+}
+
+void ThreadedRenderer::drawFrame(Frame &frame)
+{
+	TraceObj obj("Render commands",
+	             {{"commands", Strings::fromInteger(static_cast<int>(frame.commands.size()))}});
+	auto &r = *this->renderer;
+	for (auto &command : frame.commands)
+	{
+		switch (command.op)
+		{
+			case Command::Op::Clear:
+				r.clear(command.colour);
+				break;
+			case Command::Op::SetPalette:
+				r.setPalette(command.palette);
+				break;
+			case Command::Op::SetSurface:
+				r.setSurface(std::static_pointer_cast<Surface>(command.image));
+				break;
+			case Command::Op::Draw:
+				r.draw(command.image, command.a);
+				break;
+			case Command::Op::DrawRotated:
+				r.drawRotated(command.image, command.a, command.b, command.value);
+				break;
+			case Command::Op::DrawScaled:
+				r.drawScaled(command.image, command.a, command.b, command.scaler);
+				break;
+			case Command::Op::DrawTinted:
+				r.drawTinted(command.image, command.a, command.colour);
+				break;
+			case Command::Op::DrawFilledRect:
+				r.drawFilledRect(command.a, command.b, command.colour);
+				break;
+			case Command::Op::DrawRect:
+				r.drawRect(command.a, command.b, command.colour, command.value);
+				break;
+			case Command::Op::DrawLine:
+				r.drawLine(command.a, command.b, command.colour, command.value);
+				break;
+			case Command::Op::DrawSprites:
+				r.drawSprites(command.sprites);
+				break;
+			case Command::Op::Flush:
+				r.flush();
+				break;
+			case Command::Op::NewFrame:
+				r.newFrame();
+				break;
+			case Command::Op::Call:
+				command.call(r);
+				break;
+		}
+	}
+}
+
+}; // namespace OpenApoc
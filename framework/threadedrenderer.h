@@ -0,0 +1,155 @@
+#pragma once
+
+#include "framework/renderer.h"
+#include "library/colour.h"
+#include "library/sp.h"
+#include "library/vec.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Draws through another renderer on a thread of its own, which owns the graphics context, so that
+// frame N is drawn and flipped while the main thread updates and records frame N + 1.
+//
+// Everything drawn through it is recorded, keeping whatever it draws alive, and only drawn once
+// the frame is submitted, so anything that needs the other renderer right away (like reading a
+// surface back) has to go through run(). Images must not change once drawn, as renderers keep
+// what they uploaded of them anyway, and palettes must not change at all. Renderer data of
+// images and palettes that go away is handed to the thread by releaseRendererData(). The stats
+// are those of the last frame the thread finished, so a frame behind.
+class ThreadedRenderer final : public Renderer
+{
+  public:
+	// Called on the thread that draws, to flip a finished frame to the screen
+	using PresentFunction = std::function<void()>;
+	// Called to make the graphics context current (true) or not (false) on the calling thread
+	using ContextFunction = std::function<void(bool current)>;
+
+	// Takes over renderer, which must have been made on the calling thread, moving its context to
+	// the new thread
+	ThreadedRenderer(up<Renderer> renderer, PresentFunction present, ContextFunction context);
+	// Waits for the thread to finish what it was given, then gives the context back to the
+	// calling thread
+	~ThreadedRenderer() override;
+
+	// Hands the frame recorded so far to the thread to draw and flip, once it finished the last
+	// one, and starts recording the next
+	void submitFrame();
+	// Waits until the thread finished everything submitted
+	void wait();
+	// Has the thread call call with the other renderer once it finished everything submitted,
+	// and waits for it, for anything that has to be done right away. What was recorded since the
+	// last submitFrame() is not drawn yet
+	void run(std::function<void(Renderer &)> call);
+	// Drops data once the thread is done with everything submitted so far
+	void release(sp<RendererImageData> data);
+
+	void clear(Colour c = Colour{0, 0, 0, 0}) override;
+	void setPalette(sp<Palette> p) override;
+	sp<Palette> getPalette() override;
+	void draw(sp<Image> i, Vec2<float> position) override;
+	void drawRotated(sp<Image> i, Vec2<float> center, Vec2<float> position,
+	                 float angle) override;
+	void drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size,
+	                Scaler scaler = Scaler::Linear) override;
+	void drawTinted(sp<Image> i, Vec2<float> position, Colour tint) override;
+	void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) override;
+	void drawRect(Vec2<float> position, Vec2<float> size, Colour c,
+	              float thickness = 1.0) override;
+	void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0) override;
+	void drawSprites(const std::vector<RendererSprite> &sprites) override;
+	void flush() override;
+	UString getName() override;
+	void newFrame() override;
+	void compact() override;
+	void preload(const std::vector<sp<Image>> &images) override;
+	sp<Surface> getDefaultSurface() override;
+
+  private:
+	void setSurface(sp<Surface> s) override;
+	sp<Surface> getSurface() override;
+
+	class Command
+	{
+	  public:
+		enum class Op
+		{
+			Clear,
+			SetPalette,
+			SetSurface,
+			Draw,
+			DrawRotated,
+			DrawScaled,
+			DrawTinted,
+			DrawFilledRect,
+			DrawRect,
+			DrawLine,
+			DrawSprites,
+			Flush,
+			NewFrame,
+			Call,
+		};
+		Op op;
+		sp<Image> image;
+		sp<Palette> palette;
+		// Positions and sizes, in the order the draw call takes them
+		Vec2<float> a;
+		Vec2<float> b;
+		Vec2<float> c;
+		// Angle or thickness
+		float value = 0.0f;
+		Colour colour;
+		Scaler scaler = Scaler::Linear;
+		std::vector<RendererSprite> sprites;
+		// Keeps what sprites point at alive
+		std::vector<sp<Image>> spriteImages;
+		std::function<void(Renderer &)> call;
+
+		Command(Op op) : op(op) {}
+	};
+	class Frame
+	{
+	  public:
+		std::vector<Command> commands;
+		// Flipped once drawn, done for frames but not for run()
+		bool present = false;
+	};
+
+	up<Renderer> renderer;
+	PresentFunction present;
+	ContextFunction context;
+	// What the main thread sees as current, as the renderer only gets there once drawing
+	sp<Surface> currentSurface;
+	sp<Palette> currentPalette;
+	sp<Surface> defaultSurface;
+	UString name;
+
+	up<Frame> recording;
+	// The last frame the thread finished, emptied for recording into again
+	up<Frame> spare;
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable changed;
+	// Frame given to the thread, or empty once it is done
+	up<Frame> submitted;
+	bool stopping = false;
+	// Stats of the last frame the thread finished
+	RendererStats finishedStats;
+	// Dropped by the thread once it finished the frame it is drawing
+	std::vector<sp<RendererImageData>> released;
+
+	// Adds a command to the frame being recorded
+	Command &record(Command::Op op);
+	// Hands frame to the thread once it is idle
+	void submit(up<Frame> frame);
+	void waitIdle(std::unique_lock<std::mutex> &l);
+	void threadMain();
+	void drawFrame(Frame &frame);
+};
+
+}; // namespace OpenApoc
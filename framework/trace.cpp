@@ -1,12 +1,19 @@
 #include "framework/trace.h"
 #include "framework/configfile.h"
+#include "framework/metrics.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -18,8 +25,21 @@ using OpenApoc::UString;
 OpenApoc::ConfigOptionBool enableTrace("Trace", "enable", "Enable json call/time tracking");
 OpenApoc::ConfigOptionString traceFile("Trace", "outputFile", "File to output trace json to",
                                        "openapoc.trace");
-
-const unsigned int TRACE_CHUNK_SIZE = 100000;
+OpenApoc::ConfigOptionBool enableProfiler("Profiler", "enable",
+                                          "Sample which traced scopes every thread is in, written "
+                                          "out for flame graph tools on exit");
+OpenApoc::ConfigOptionInt profilerInterval("Profiler", "interval",
+                                           "Milliseconds between profiler samples", 5);
+OpenApoc::ConfigOptionString profilerFile("Profiler", "outputFile",
+                                          "File to output the sampled stacks of scopes to",
+                                          "openapoc.folded");
+
+// Events each thread can have waiting to be written, a power of two
+const size_t TRACE_RING_SIZE = 1 << 15;
+// How often what was traced is written out, when the rings are not filling up anyway
+const std::chrono::milliseconds TRACE_WRITE_INTERVAL(50);
+// Scopes deeper than this are sampled as if they were the one this deep
+const unsigned int PROFILER_MAX_DEPTH = 64;
 
 std::mutex initTraceLock;
 static bool traceInited = false;
@@ -33,76 +53,138 @@ static void initTrace()
 	traceInited = true;
 	if (enableTrace.get())
 		OpenApoc::Trace::enable();
+	if (enableProfiler.get())
+		OpenApoc::Trace::startProfiling();
 }
 
+// Every name interned so far, id 0 being the empty name
+class TraceNames
+{
+  private:
+	std::mutex lock;
+	std::unordered_map<std::string, unsigned int> ids;
+	std::vector<std::string> names = {""};
+
+  public:
+	unsigned int intern(const std::string &name)
+	{
+		std::lock_guard<std::mutex> l(lock);
+		auto inserted = ids.emplace(name, static_cast<unsigned int>(names.size()));
+		if (inserted.second)
+		{
+			names.push_back(name);
+		}
+		return inserted.first->second;
+	}
+	// Copies the names interned since ones were last copied into into
+	void copyNew(std::vector<std::string> &into)
+	{
+		std::lock_guard<std::mutex> l(lock);
+		into.insert(into.end(), names.begin() + into.size(), names.end());
+	}
+
+	static TraceNames &get()
+	{
+		// Names are interned from static initialisers, so this has to be made on first use
+		static TraceNames instance;
+		return instance;
+	}
+};
+
 enum class EventType : unsigned char
 {
 	Begin,
 	End,
+	Counter,
+	Instant,
+	FlowStart,
+	FlowEnd,
 };
 
 class TraceEvent
 {
   public:
+	uint64_t timeNS;
+	unsigned int nameId;
+	// Only for flow events
+	unsigned int flowId;
 	EventType type;
-	uint64_t timeNS : 48; // (2^48) nanoseconds = 3.25781223 days
-	UString name;
-	std::vector<std::pair<UString, UString>> args;
-	TraceEvent(EventType type, const UString &name,
-	           const std::vector<std::pair<UString, UString>> &args, uint64_t timeNS)
-	    : type(type), timeNS(timeNS), name(name), args(args)
-	{
-	}
-	TraceEvent() = default;
+	bool hasArgs;
 };
 
-class EventList
+// Events of one thread waiting to be written, pushed by that thread and taken by the writer, so
+// neither locks anything. The arguments of an event, already put into json, are kept next to it
+// for the few that have any
+class EventRing
 {
+  private:
+	std::vector<TraceEvent> events;
+	std::vector<std::string> args;
+	std::atomic<size_t> head{0};
+	std::atomic<size_t> tail{0};
+
   public:
+	// Only read or written with the TraceManager's listMutex held
 	UString tid;
-	std::vector<TraceEvent> *current_buffer;
-	void pushEvent(const EventType &type, const UString &name,
-	               const std::vector<std::pair<UString, UString>> &args, uint64_t &timeNS)
+
+	EventRing() : events(TRACE_RING_SIZE), args(TRACE_RING_SIZE) {}
+
+	// Returns false if there is no room
+	bool push(EventType type, unsigned int nameId, const std::string *eventArgs,
+	          unsigned int flowId, uint64_t timeNS)
 	{
-		if (this->current_buffer->size() == TRACE_CHUNK_SIZE)
+		auto pushed = head.load(std::memory_order_relaxed);
+		if (pushed - tail.load(std::memory_order_acquire) == TRACE_RING_SIZE)
 		{
-			this->buffer_list.emplace_back();
-			this->current_buffer = &this->buffer_list.back();
-			this->current_buffer->reserve(TRACE_CHUNK_SIZE);
-			OpenApoc::TraceObj("Trace::EventList::newbuffer");
+			return false;
 		}
-		this->current_buffer->emplace_back(type, name, args, timeNS);
+		auto slot = pushed & (TRACE_RING_SIZE - 1);
+		events[slot] = {timeNS, nameId, flowId, type, eventArgs != nullptr};
+		if (eventArgs)
+		{
+			args[slot] = *eventArgs;
+		}
+		head.store(pushed + 1, std::memory_order_release);
+		return true;
 	}
-	std::list<std::vector<TraceEvent>> buffer_list;
 
-	EventList()
+	// Calls write(event, args) for every event pushed so far, oldest first
+	template <typename F> void take(F write)
 	{
-		this->buffer_list.emplace_back();
-		this->current_buffer = &buffer_list.back();
-		this->current_buffer->reserve(TRACE_CHUNK_SIZE);
+		auto taken = tail.load(std::memory_order_relaxed);
+		auto pushed = head.load(std::memory_order_acquire);
+		for (; taken != pushed; taken++)
+		{
+			auto slot = taken & (TRACE_RING_SIZE - 1);
+			write(events[slot], args[slot]);
+		}
+		tail.store(taken, std::memory_order_release);
 	}
 };
 
+// Writes the events of every thread to the trace file as they come, so little is kept in memory
+// and a trace of a run that crashes is still there up to a moment before. The file is in the
+// json array format, which is fine to load without the closing bracket
 class TraceManager
 {
   public:
-	// We need a list of all the EventLists created for each thread to dump out & free at
-	// TraceManager destructor time
-	std::list<std::unique_ptr<EventList>> lists;
+	// Every ring made for a thread, all of them kept until tracing stops as threads that have
+	// gone may still have events to write
+	std::list<std::unique_ptr<EventRing>> lists;
 	std::mutex listMutex;
-	EventList *createThreadEventList()
+	std::ofstream outFile;
+
+	EventRing *createThreadEventList()
 	{
 		std::stringstream ss;
-		listMutex.lock();
-		auto list = new EventList;
+		std::lock_guard<std::mutex> l(listMutex);
+		auto list = new EventRing;
 		ss << std::this_thread::get_id();
 		list->tid = ss.str();
 		lists.emplace_back(list);
-		listMutex.unlock();
 		return list;
 	}
-	~TraceManager();
-	std::ofstream outFile;
+
 	TraceManager() : outFile(traceFile.get().str())
 	{
 		if (!outFile)
@@ -110,8 +192,102 @@ class TraceManager
 			LogError("Failed to open trace file \"%s\"", traceFile.get());
 			return;
 		}
+		outFile << "[\n";
+		writer = std::thread([this]() { writeLoop(); });
+	}
+	~TraceManager();
+
+	// Wakes the writer early, such as for when a ring is full
+	void wakeWriter() { writerCondition.notify_one(); }
+	// Stops the writer and writes out whatever is left
+	void finish();
+
+  private:
+	std::thread writer;
+	std::mutex writerMutex;
+	std::condition_variable writerCondition;
+	bool stopWriter = false;
+	bool firstEvent = true;
+	// The writer's copy of the interned names
+	std::vector<std::string> names;
+
+	void writeLoop();
+	void writeEvents();
+};
+
+// The names of the scopes a thread is in, outermost first. Only the thread itself changes it, the
+// sampler reads it from the outside without locking, so at worst a sample has a scope that was
+// just left or misses one just started
+class ScopeStack
+{
+  public:
+	std::atomic<unsigned int> ids[PROFILER_MAX_DEPTH];
+	std::atomic<unsigned int> depth{0};
+	// Only read or written with the Profiler's lock held
+	UString threadName;
+
+	ScopeStack()
+	{
+		for (auto &id : ids)
+			id.store(0, std::memory_order_relaxed);
+	}
+
+	void push(unsigned int id)
+	{
+		auto d = depth.load(std::memory_order_relaxed);
+		if (d < PROFILER_MAX_DEPTH)
+			ids[d].store(id, std::memory_order_relaxed);
+		depth.store(d + 1, std::memory_order_release);
+	}
+	void pop()
+	{
+		// Scopes started before profiling was may end while it is on
+		auto d = depth.load(std::memory_order_relaxed);
+		if (d > 0)
+			depth.store(d - 1, std::memory_order_release);
 	}
-	void write();
+};
+
+// Looks at every thread's ScopeStack at a fixed interval, counting how often each stack was seen
+class Profiler
+{
+  public:
+	std::mutex lock;
+	// Every thread's stack, kept for good as threads may still be using theirs when it stops
+	std::list<std::unique_ptr<ScopeStack>> stacks;
+
+	ScopeStack *createThreadStack()
+	{
+		std::stringstream ss;
+		std::lock_guard<std::mutex> l(lock);
+		auto stack = new ScopeStack;
+		ss << std::this_thread::get_id();
+		stack->threadName = ss.str();
+		stacks.emplace_back(stack);
+		return stack;
+	}
+
+	void start(std::chrono::milliseconds interval);
+	// Stops the sampler and writes what it saw to path
+	void finish(const UString &path);
+
+	static Profiler &get()
+	{
+		// Never freed, as threads may still end scopes after statics are destroyed
+		static Profiler *instance = new Profiler;
+		return *instance;
+	}
+
+  private:
+	std::thread sampler;
+	std::mutex samplerMutex;
+	std::condition_variable samplerCondition;
+	bool stopSampler = false;
+	// How often each stack was seen, by the thread's place in stacks and then the scope ids
+	std::map<std::vector<unsigned int>, unsigned long long> samples;
+
+	void sampleLoop(std::chrono::milliseconds interval);
+	void sample();
 };
 
 static std::unique_ptr<TraceManager> trace_manager;
@@ -122,98 +298,295 @@ static std::unique_ptr<TraceManager> trace_manager;
 
 // thread_local isn't implemented until msvc 2015 (_MSC_VER 1900)
 #if defined(_MSC_VER) && _MSC_VER < 1900
-static __declspec(thread) EventList *events = nullptr;
+static __declspec(thread) EventRing *events = nullptr;
+static __declspec(thread) unsigned int eventsGeneration = 0;
+static __declspec(thread) ScopeStack *scopes = nullptr;
 #else
 #if defined(BROKEN_THREAD_LOCAL)
 #warning Using pthread path
 
 static pthread_key_t eventListKey;
+static pthread_key_t scopeStackKey;
+static std::once_flag scopeStackKeyOnce;
 
 #else
-static thread_local EventList *events = nullptr;
+static thread_local EventRing *events = nullptr;
+static thread_local ScopeStack *scopes = nullptr;
+// The rings go with the manager, so ones made while tracing was enabled before are gone
+static thread_local unsigned int eventsGeneration = 0;
 #endif
 #endif
+static unsigned int traceGeneration = 0;
 static std::chrono::time_point<std::chrono::high_resolution_clock> traceStartTime;
 
+static EventRing *getThreadEvents()
+{
+#if defined(BROKEN_THREAD_LOCAL)
+	EventRing *events = (EventRing *)pthread_getspecific(eventListKey);
+	if (!events)
+	{
+		events = trace_manager->createThreadEventList();
+		pthread_setspecific(eventListKey, events);
+	}
+#else
+	if (!events || eventsGeneration != traceGeneration)
+	{
+		events = trace_manager->createThreadEventList();
+		eventsGeneration = traceGeneration;
+	}
+#endif
+	return events;
+}
+
+static ScopeStack *getThreadScopes()
+{
+#if defined(BROKEN_THREAD_LOCAL)
+	std::call_once(scopeStackKeyOnce, []() { pthread_key_create(&scopeStackKey, NULL); });
+	ScopeStack *scopes = (ScopeStack *)pthread_getspecific(scopeStackKey);
+	if (!scopes)
+	{
+		scopes = Profiler::get().createThreadStack();
+		pthread_setspecific(scopeStackKey, scopes);
+	}
+#else
+	if (!scopes)
+	{
+		scopes = Profiler::get().createThreadStack();
+	}
+#endif
+	return scopes;
+}
+
+static void pushEvent(EventType type, unsigned int nameId, const std::string *args = nullptr,
+                      unsigned int flowId = 0)
+{
+	auto timeNow = std::chrono::high_resolution_clock::now();
+	uint64_t timeNS = std::chrono::duration<uint64_t, std::nano>(timeNow - traceStartTime).count();
+	auto *ring = getThreadEvents();
+	// Waiting for the writer keeps the begin and end of every event paired up, which dropping
+	// events would not
+	while (!ring->push(type, nameId, args, flowId, timeNS))
+	{
+		if (!OpenApoc::Trace::enabled)
+		{
+			return;
+		}
+		trace_manager->wakeWriter();
+		std::this_thread::yield();
+	}
+}
+
+std::atomic<unsigned int> nextFlowId{1};
+
+static std::string argsToJson(const std::vector<std::pair<UString, UString>> &args,
+                              bool quoteValues)
+{
+	std::string json;
+	for (auto &arg : args)
+	{
+		if (!json.empty())
+			json += ",";
+		json += "\"" + arg.first.str() + "\":";
+		if (quoteValues)
+			json += "\"" + arg.second.str() + "\"";
+		else
+			json += arg.second.str();
+	}
+	return json;
+}
+
 } // anonymous namespace
 
-TraceManager::~TraceManager()
+void Profiler::start(std::chrono::milliseconds interval)
 {
-	if (OpenApoc::Trace::enabled)
-		this->write();
+	{
+		std::lock_guard<std::mutex> l(lock);
+		samples.clear();
+		// What was left over from profiling before would put every sample in the wrong scope
+		for (auto &stack : stacks)
+			stack->depth.store(0, std::memory_order_relaxed);
+	}
+	stopSampler = false;
+	sampler = std::thread([this, interval]() { sampleLoop(interval); });
 }
 
-void TraceManager::write()
+void Profiler::finish(const UString &path)
 {
-	LogAssert(OpenApoc::Trace::enabled);
-	OpenApoc::Trace::enabled = false;
+	{
+		std::lock_guard<std::mutex> l(samplerMutex);
+		stopSampler = true;
+	}
+	samplerCondition.notify_all();
+	sampler.join();
 
-	// FIXME: Use proper json parser instead of magically constructing from strings?
+	std::ofstream outFile(path.str());
+	if (!outFile)
+	{
+		LogError("Failed to open profiler file \"%s\"", path);
+		return;
+	}
+	// The folded format separates scopes with ';' and the count with a space, so names can't have
+	// the former in them. Spaces are fine, as only the last one counts
+	auto fold = [](std::string name) {
+		std::replace(name.begin(), name.end(), ';', ':');
+		return name;
+	};
+	std::vector<std::string> names;
+	TraceNames::get().copyNew(names);
+	std::vector<std::string> threadNames;
+	std::lock_guard<std::mutex> l(lock);
+	for (auto &stack : stacks)
+		threadNames.push_back(fold(stack->threadName.str()));
+	unsigned long long total = 0;
+	for (auto &sample : samples)
+	{
+		outFile << threadNames[sample.first[0]];
+		for (size_t i = 1; i < sample.first.size(); i++)
+			outFile << ";" << fold(names[sample.first[i]]);
+		outFile << " " << sample.second << "\n";
+		total += sample.second;
+	}
+	LogInfo("Wrote %llu profiler samples to \"%s\"", total, path);
+}
 
-	outFile << "{\"traceEvents\":[\n";
+void Profiler::sampleLoop(std::chrono::milliseconds interval)
+{
+	OpenApoc::Trace::setThreadName("Profiler");
+	std::unique_lock<std::mutex> l(samplerMutex);
+	while (!stopSampler)
+	{
+		samplerCondition.wait_for(l, interval);
+		if (stopSampler)
+			break;
+		l.unlock();
+		this->sample();
+		l.lock();
+	}
+}
 
-	bool firstEvent = true;
+void Profiler::sample()
+{
+	std::vector<unsigned int> key;
+	std::lock_guard<std::mutex> l(lock);
+	unsigned int index = 0;
+	for (auto &stack : stacks)
+	{
+		auto depth = std::min(stack->depth.load(std::memory_order_acquire), PROFILER_MAX_DEPTH);
+		// Threads outside any scope are mostly waiting for work, which would bury the rest
+		if (depth > 0)
+		{
+			key.assign(1, index);
+			for (unsigned int i = 0; i < depth; i++)
+				key.push_back(stack->ids[i].load(std::memory_order_relaxed));
+			samples[key]++;
+		}
+		index++;
+	}
+}
+
+TraceManager::~TraceManager() { this->finish(); }
 
-	listMutex.lock();
+void TraceManager::finish()
+{
+	if (!writer.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l(writerMutex);
+		stopWriter = true;
+	}
+	writerCondition.notify_all();
+	writer.join();
+	this->writeEvents();
+	outFile << "\n]\n";
+	outFile.flush();
+}
+
+void TraceManager::writeLoop()
+{
+	std::unique_lock<std::mutex> l(writerMutex);
+	while (!stopWriter)
+	{
+		writerCondition.wait_for(l, TRACE_WRITE_INTERVAL);
+		l.unlock();
+		this->writeEvents();
+		l.lock();
+	}
+}
+
+void TraceManager::writeEvents()
+{
+	// FIXME: Use proper json parser instead of magically constructing from strings?
+
+	TraceNames::get().copyNew(names);
+
+	std::lock_guard<std::mutex> l(listMutex);
 	for (auto &eventList : lists)
 	{
-		for (auto &buffer : eventList->buffer_list)
-		{
-			for (auto &event : buffer)
+		const auto &tid = eventList->tid;
+		eventList->take([this, &tid](const TraceEvent &event, const std::string &args) {
+			if (!firstEvent)
+				outFile << ",\n";
+
+			firstEvent = false;
+
+			// An event pushed after the names were copied may have a name interned since
+			if (event.nameId >= names.size())
+				TraceNames::get().copyNew(names);
+
+			outFile << "{"
+			        << "\"pid\":1,"
+			        << "\"tid\":\"" << tid << "\","
+			        // Time is in microseconds, not nanoseconds
+			        << "\"ts\":" << event.timeNS / 1000 << ","
+			        << "\"name\":\"" << names[event.nameId] << "\",";
+
+			switch (event.type)
 			{
-				if (!firstEvent)
-					outFile << ",\n";
-
-				firstEvent = false;
-
-				outFile << "{"
-				        << "\"pid\":1,"
-				        << "\"tid\":\"" << eventList->tid << "\","
-				        // Time is in microseconds, not nanoseconds
-				        << "\"ts\":" << event.timeNS / 1000 << ","
-				        << "\"name\":\"" << event.name << "\",";
-
-				switch (event.type)
-				{
-					case EventType::Begin:
-					{
-						outFile << "\"ph\":\"B\"";
-
-						if (!event.args.empty())
-						{
-							outFile << ",\"args\":{";
-
-							bool firstArg = true;
-
-							for (auto &arg : event.args)
-							{
-								if (!firstArg)
-									outFile << ",";
-								firstArg = false;
-								outFile << "\"" << arg.first << "\":\"" << arg.second << "\"";
-							}
-							outFile << "}";
-						}
-						break;
-					}
-					case EventType::End:
-						outFile << "\"ph\":\"E\"";
-						break;
-				}
-				outFile << "}";
+				case EventType::Begin:
+					outFile << "\"ph\":\"B\"";
+					if (event.hasArgs)
+						outFile << ",\"args\":{" << args << "}";
+					break;
+				case EventType::End:
+					outFile << "\"ph\":\"E\"";
+					break;
+				case EventType::Counter:
+					outFile << "\"ph\":\"C\",\"args\":{" << (event.hasArgs ? args : "") << "}";
+					break;
+				case EventType::Instant:
+					// Drawn across every thread
+					outFile << "\"ph\":\"i\",\"s\":\"g\"";
+					if (event.hasArgs)
+						outFile << ",\"args\":{" << args << "}";
+					break;
+				case EventType::FlowStart:
+					outFile << "\"ph\":\"s\",\"cat\":\"flow\",\"id\":" << event.flowId;
+					break;
+				case EventType::FlowEnd:
+					// Bound to the event it is in rather than the next to start
+					outFile << "\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"flow\",\"id\":"
+					        << event.flowId;
+					break;
 			}
-		}
+			outFile << "}";
+		});
 	}
-	listMutex.unlock();
-	outFile << "]}\n";
 	outFile.flush();
 }
 
 namespace OpenApoc
 {
 
+TraceName::TraceName(const char *name) : id(TraceNames::get().intern(name)) {}
+
+TraceName::TraceName(const UString &name) : id(TraceNames::get().intern(name.str())) {}
+
 bool Trace::enabled = false;
 
+bool Trace::profiling = false;
+
 void Trace::enable()
 {
 	if (!traceInited)
@@ -224,21 +597,45 @@ void Trace::enable()
 #if defined(BROKEN_THREAD_LOCAL)
 	pthread_key_create(&eventListKey, NULL);
 #endif
-	enabled = true;
+	traceGeneration++;
 	traceStartTime = std::chrono::high_resolution_clock::now();
+	enabled = true;
+	Metrics::setTracing(true);
 }
 
 void Trace::disable()
 {
+	stopProfiling();
 	if (!enabled)
 		return;
 	LogAssert(trace_manager);
-	trace_manager->write();
+	enabled = false;
+	Metrics::setTracing(false);
+	trace_manager->finish();
 	trace_manager.reset(nullptr);
 #if defined(BROKEN_THREAD_LOCAL)
 	pthread_key_delete(eventListKey);
 #endif
-	enabled = false;
+}
+
+void Trace::startProfiling()
+{
+	if (!traceInited)
+		initTrace();
+	if (profiling)
+		return;
+	auto interval = std::max(1, profilerInterval.get());
+	LogInfo("Profiling every %dms", interval);
+	profiling = true;
+	Profiler::get().start(std::chrono::milliseconds(interval));
+}
+
+void Trace::stopProfiling()
+{
+	if (!profiling)
+		return;
+	profiling = false;
+	Profiler::get().finish(profilerFile.get());
 }
 
 void Trace::setThreadName(const UString &name)
@@ -252,64 +649,164 @@ void Trace::setThreadName(const UString &name)
 	pthread_setname_np(name.cStr());
 #endif
 #endif
+	if (profiling)
+	{
+		auto *stack = getThreadScopes();
+		std::lock_guard<std::mutex> l(Profiler::get().lock);
+		stack->threadName = name;
+	}
 	if (!enabled)
 		return;
 
-#if defined(BROKEN_THREAD_LOCAL)
-	EventList *events = (EventList *)pthread_getspecific(eventListKey);
-	if (!events)
+	auto *ring = getThreadEvents();
+	std::lock_guard<std::mutex> l(trace_manager->listMutex);
+	ring->tid = name;
+}
+
+void Trace::start(const UString &name, const TraceArgs &args)
+{
+	if (!traceInited)
+		initTrace();
+	if (!enabled && !profiling)
+		return;
+	start(TraceName(name), args);
+}
+
+void Trace::start(const TraceName &name, const TraceArgs &args)
+{
+	if (!traceInited)
+		initTrace();
+	if (profiling)
+		getThreadScopes()->push(name.id);
+	if (!enabled)
+		return;
+	if (args.empty())
 	{
-		events = trace_manager->createThreadEventList();
-		pthread_setspecific(eventListKey, events);
+		pushEvent(EventType::Begin, name.id);
 	}
-#else
-	if (!events)
-		events = trace_manager->createThreadEventList();
-#endif
+	else
+	{
+		auto json = argsToJson(args, true);
+		pushEvent(EventType::Begin, name.id, &json);
+	}
+}
+
+void Trace::end(const UString &name)
+{
+	if (!enabled && !profiling)
+		return;
+	end(TraceName(name));
+}
 
-	events->tid = name;
+void Trace::end(const TraceName &name)
+{
+	if (profiling)
+		getThreadScopes()->pop();
+	if (!enabled)
+		return;
+	pushEvent(EventType::End, name.id);
 }
 
-void Trace::start(const UString &name, const std::vector<std::pair<UString, UString>> &args)
+void Trace::counter(const UString &name, const TraceArgs &values)
 {
 	if (!traceInited)
 		initTrace();
 	if (!enabled)
 		return;
-#if defined(BROKEN_THREAD_LOCAL)
-	EventList *events = (EventList *)pthread_getspecific(eventListKey);
-	if (!events)
+	auto json = argsToJson(values, false);
+	pushEvent(EventType::Counter, TraceName(name).id, &json);
+}
+
+void Trace::instant(const TraceName &name, const TraceArgs &args)
+{
+	if (!enabled)
+		return;
+	if (args.empty())
 	{
-		events = trace_manager->createThreadEventList();
-		pthread_setspecific(eventListKey, events);
+		pushEvent(EventType::Instant, name.id);
 	}
-#else
-	if (!events)
-		events = trace_manager->createThreadEventList();
-#endif
+	else
+	{
+		auto json = argsToJson(args, true);
+		pushEvent(EventType::Instant, name.id, &json);
+	}
+}
 
-	auto timeNow = std::chrono::high_resolution_clock::now();
-	uint64_t timeNS = std::chrono::duration<uint64_t, std::nano>(timeNow - traceStartTime).count();
-	events->pushEvent(EventType::Begin, name, args, timeNS);
+unsigned int Trace::flowStart(const TraceName &name)
+{
+	if (!enabled)
+		return 0;
+	// 0 is left for when tracing is not enabled, so wrapping around skips it
+	unsigned int id;
+	do
+	{
+		id = nextFlowId++;
+	} while (id == 0);
+	pushEvent(EventType::FlowStart, name.id, nullptr, id);
+	return id;
 }
-void Trace::end(const UString &name)
+
+void Trace::flowEnd(const TraceName &name, unsigned int id)
+{
+	if (!enabled || id == 0)
+		return;
+	pushEvent(EventType::FlowEnd, name.id, nullptr, id);
+}
+
+void Trace::frame(unsigned int frame)
 {
+	if (!traceInited)
+		initTrace();
 	if (!enabled)
 		return;
-#if defined(BROKEN_THREAD_LOCAL)
-	EventList *events = (EventList *)pthread_getspecific(eventListKey);
-	if (!events)
+	static const TraceName frameName("Frame start");
+	instant(frameName, {{"frame", Strings::fromU64(frame)}});
+
+	// Every track with its values, in the order the first metric of each was made
+	std::vector<std::pair<unsigned int, TraceArgs>> tracks;
+	// What every counter was last frame and the track of every metric, by its place in the
+	// registry. Only Framework::run() calls this, so they are only ever used by one thread
+	static std::vector<long long> lastTotals;
+	static std::vector<unsigned int> trackIds;
+	auto metrics = Metrics::getAll();
+	lastTotals.resize(metrics.size(), 0);
+	while (trackIds.size() < metrics.size())
+		trackIds.push_back(TraceName(metrics[trackIds.size()]->group).id);
+	for (size_t i = 0; i < metrics.size(); i++)
 	{
-		events = trace_manager->createThreadEventList();
-		pthread_setspecific(eventListKey, events);
+		auto *metric = metrics[i];
+		long long value;
+		if (metric->kind == Metric::Kind::Counter)
+		{
+			auto total = static_cast<MetricCounter *>(metric)->getTotal();
+			value = total - lastTotals[i];
+			lastTotals[i] = total;
+		}
+		else if (metric->kind == Metric::Kind::Gauge)
+		{
+			value = static_cast<MetricGauge *>(metric)->get();
+		}
+		else
+		{
+			continue;
+		}
+		auto trackId = trackIds[i];
+		auto track = std::find_if(tracks.begin(), tracks.end(),
+		                          [trackId](const std::pair<unsigned int, TraceArgs> &t) {
+			                          return t.first == trackId;
+		                          });
+		if (track == tracks.end())
+		{
+			tracks.emplace_back(trackId, TraceArgs{});
+			track = tracks.end() - 1;
+		}
+		track->second.emplace_back(metric->name, OpenApoc::format("%lld", value));
+	}
+	for (auto &track : tracks)
+	{
+		auto json = argsToJson(track.second, false);
+		pushEvent(EventType::Counter, track.first, &json);
 	}
-#else
-	if (!events)
-		events = trace_manager->createThreadEventList();
-#endif
-	auto timeNow = std::chrono::high_resolution_clock::now();
-	uint64_t timeNS = std::chrono::duration<uint64_t, std::nano>(timeNow - traceStartTime).count();
-	events->pushEvent(EventType::End, name, std::vector<std::pair<UString, UString>>{}, timeNS);
 }
 
 } // namespace OpenApoc
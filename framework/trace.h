@@ -3,40 +3,120 @@
 #include "library/strings.h"
 // Include logger for 'LOGGER_PREFIX' definition
 #include "framework/logger.h"
+#include <atomic>
+#include <utility>
 #include <vector>
 
 namespace OpenApoc
 {
 
+using TraceArgs = std::vector<std::pair<UString, UString>>;
+
+// The name of trace events, kept once and passed around as an id. Interning a name takes a lock,
+// so names that are known when compiling are best kept in a static, as TRACE_FN does
+class TraceName
+{
+  public:
+	TraceName() = default;
+	explicit TraceName(const char *name);
+	explicit TraceName(const UString &name);
+	unsigned int id = 0;
+};
+
 class Trace
 {
   public:
 	static void enable();
 	static void disable();
 
-	static void start(const UString &name,
-	                  const std::vector<std::pair<UString, UString>> &args = {});
+	static void start(const UString &name, const TraceArgs &args = {});
+	static void start(const TraceName &name, const TraceArgs &args = {});
 	static void end(const UString &end);
+	static void end(const TraceName &name);
+	// Records the values of a counter called name, each value a number
+	static void counter(const UString &name, const TraceArgs &values);
+	// Records a moment on every thread's track, such as the start of a frame
+	static void instant(const TraceName &name, const TraceArgs &args = {});
+	// An arrow from the event the calling thread is in to the one flowEnd() is called in with the
+	// id returned, such as from queueing a job to running it. Returns 0 if tracing is not enabled
+	static unsigned int flowStart(const TraceName &name);
+	static void flowEnd(const TraceName &name, unsigned int id);
+	// Marks the start of a frame, then records every metric on the counter track of its group,
+	// counters as how many there were since the last frame. Called by Framework::run()
+	static void frame(unsigned int frame);
 
 	static bool enabled;
+	// Set while the sampling profiler runs, which needs every scope of every thread started and
+	// ended, whether tracing is enabled or not
+	static bool profiling;
+
+	// Starts sampling which scopes every thread is in at a fixed interval, which is done from the
+	// start if Profiler.enable is set. Unlike tracing it costs next to nothing, so users can leave
+	// it on while reproducing an issue
+	static void startProfiling();
+	// Stops sampling and writes how often each stack of scopes was seen to Profiler.outputFile, in
+	// the folded format flame graph tools take. Also done by disable()
+	static void stopProfiling();
 
 	static void setThreadName(const UString &name);
 };
 
+// Records the time from its construction to its destruction, doing nothing at all if neither
+// tracing nor profiling was enabled when constructed
 class TraceObj
 {
+  private:
+	bool active;
+	TraceName name;
+
   public:
-	UString name;
-	TraceObj(const UString &name, const std::vector<std::pair<UString, UString>> &args = {})
-	    : name(name)
+	TraceObj(const TraceName &name, const TraceArgs &args = {})
+	    : active(Trace::enabled || Trace::profiling)
+	{
+		if (active)
+		{
+			this->name = name;
+			Trace::start(name, args);
+		}
+	}
+	TraceObj(const char *name, const TraceArgs &args = {})
+	    : active(Trace::enabled || Trace::profiling)
+	{
+		if (active)
+		{
+			this->name = TraceName(name);
+			Trace::start(this->name, args);
+		}
+	}
+	TraceObj(const UString &name, const TraceArgs &args = {})
+	    : active(Trace::enabled || Trace::profiling)
+	{
+		if (active)
+		{
+			this->name = TraceName(name);
+			Trace::start(this->name, args);
+		}
+	}
+	~TraceObj()
 	{
-		Trace::start(name, args);
+		if (active)
+		{
+			Trace::end(name);
+		}
 	}
-	~TraceObj() { Trace::end(name); }
 };
 
-#define TRACE_FN TraceObj trace_object_##__COUNTER__(LOGGER_PREFIX)
+// The function's name is interned the first time it is called, after which tracing it costs a
+// check of Trace::enabled when tracing is not enabled
+#define TRACE_FN                                                                                   \
+	static const OpenApoc::TraceName trace_name_fn(LOGGER_PREFIX);                                 \
+	OpenApoc::TraceObj trace_object_fn(trace_name_fn)
 
-#define TRACE_FN_ARGS1(a, b) TraceObj trace_object_##__COUNTER__(LOGGER_PREFIX, {{a, b}})
+// The argument is only evaluated if tracing is enabled
+#define TRACE_FN_ARGS1(a, b)                                                                       \
+	static const OpenApoc::TraceName trace_name_fn(LOGGER_PREFIX);                                 \
+	OpenApoc::TraceObj trace_object_fn(trace_name_fn, OpenApoc::Trace::enabled                     \
+	                                                      ? OpenApoc::TraceArgs{{a, b}}            \
+	                                                      : OpenApoc::TraceArgs{})
 
 } // namespace OpenApoc
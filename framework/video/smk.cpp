@@ -5,9 +5,11 @@
 #include "framework/sound.h"
 #include "framework/trace.h"
 #include "framework/video.h"
+#include <condition_variable>
 #include <cstring>
 #include <mutex>
 #include <queue>
+#include <thread>
 
 // libsmacker.h doesn't set C abi by default, so wrap
 extern "C" {
@@ -53,9 +55,18 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 
 	bool stopped;
 
-	std::recursive_mutex frame_queue_lock;
+	// Frames are decoded on decode_thread, which keeps up to FRAMES_AHEAD of them queued ahead of
+	// whichever of the video and its audio is further behind, so playing only waits on decoding
+	// when decoding cannot keep up
+	static const size_t FRAMES_AHEAD = 8;
+	std::mutex frame_queue_lock;
+	std::condition_variable frame_queue_condition;
 	std::queue<sp<FrameImage>> image_queue;
 	std::queue<sp<FrameAudio>> audio_queue;
+	// Set once no more frames are to be decoded, having reached the end, failed or been stopped
+	bool decode_done;
+	bool decode_thread_quit;
+	std::thread decode_thread;
 
 	AudioFormat audio_format;
 	unsigned audio_bytes_per_sample;
@@ -66,7 +77,7 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 	SMKVideo()
 	    : smk_ctx(nullptr), frame_time(0), frame_count(0), current_frame_video(0),
 	      current_frame_audio(0), current_frame_read(0), frame_size(0, 0), video_data_size(0),
-	      stopped(false)
+	      stopped(false), decode_done(false), decode_thread_quit(false)
 	{
 	}
 
@@ -80,44 +91,79 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 	sp<FrameImage> popImage() override
 	{
 		TRACE_FN_ARGS1("Frame", Strings::fromInteger(this->current_frame_video));
-		std::lock_guard<std::recursive_mutex> l(this->frame_queue_lock);
+		std::unique_lock<std::mutex> l(this->frame_queue_lock);
+		startDecoding();
+		this->frame_queue_condition.wait(
+		    l, [this] { return !this->image_queue.empty() || this->decode_done; });
 		if (this->image_queue.empty())
 		{
-			if (this->readNextFrame() == false)
-			{
-				return nullptr;
-			}
+			return nullptr;
 		}
 		auto frame = this->image_queue.front();
 		this->image_queue.pop();
 		this->current_frame_video++;
+		this->frame_queue_condition.notify_all();
 		return frame;
 	}
 
 	sp<FrameAudio> popAudio() override
 	{
 		TRACE_FN_ARGS1("Frame", Strings::fromInteger(this->current_frame_audio));
-		std::lock_guard<std::recursive_mutex> l(this->frame_queue_lock);
+		std::unique_lock<std::mutex> l(this->frame_queue_lock);
+		startDecoding();
+		this->frame_queue_condition.wait(
+		    l, [this] { return !this->audio_queue.empty() || this->decode_done; });
 		if (this->audio_queue.empty())
 		{
-			if (this->readNextFrame() == false)
-			{
-				return nullptr;
-			}
+			return nullptr;
 		}
 		auto frame = this->audio_queue.front();
 		this->audio_queue.pop();
 		this->current_frame_audio++;
+		this->frame_queue_condition.notify_all();
 		return frame;
 	}
 
+	// With frame_queue_lock held
+	void startDecoding()
+	{
+		if (!this->decode_thread.joinable() && !this->decode_done)
+		{
+			this->decode_thread = std::thread(&SMKVideo::decodeLoop, this);
+		}
+	}
+
+	void decodeLoop()
+	{
+		std::unique_lock<std::mutex> l(this->frame_queue_lock);
+		while (!this->decode_thread_quit && !this->stopped)
+		{
+			this->frame_queue_condition.wait(l, [this] {
+				return this->decode_thread_quit || this->stopped ||
+				       this->image_queue.size() < FRAMES_AHEAD ||
+				       this->audio_queue.size() < FRAMES_AHEAD;
+			});
+			if (this->decode_thread_quit || this->stopped)
+			{
+				break;
+			}
+			l.unlock();
+			bool read = readNextFrame();
+			l.lock();
+			if (!read)
+			{
+				break;
+			}
+			this->frame_queue_condition.notify_all();
+		}
+		this->decode_done = true;
+		this->frame_queue_condition.notify_all();
+	}
+
+	// Only called by decode_thread, so it is the only one to use smk_ctx once playing
 	bool readNextFrame()
 	{
 		TRACE_FN;
-		std::lock_guard<std::recursive_mutex> l(this->frame_queue_lock);
-		if (this->stopped)
-			return false;
-
 		char ret;
 		if (this->current_frame_read == 0)
 			ret = smk_first(this->smk_ctx);
@@ -130,10 +176,10 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 			return false;
 		}
 
-		if (ret == SMK_LAST)
+		bool last = ret == SMK_LAST;
+		if (last)
 		{
 			LogInfo("Last frame %u", this->current_frame_read);
-			this->stopped = true;
 		}
 
 		const unsigned char *palette_data = smk_get_palette(this->smk_ctx);
@@ -191,15 +237,27 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 
 		LogInfo("Read %lu samples bytes, %u samples", audio_bytes, audio_frame->sample_count);
 
-		this->image_queue.push(frame);
-		this->audio_queue.push(audio_frame);
+		{
+			std::lock_guard<std::mutex> l(this->frame_queue_lock);
+			this->image_queue.push(frame);
+			this->audio_queue.push(audio_frame);
+			if (last)
+			{
+				this->stopped = true;
+			}
+		}
 
 		LogInfo("read frame %u", this->current_frame_read);
 		this->current_frame_read++;
 		return true;
 	}
 
-	void stop() override { this->stopped = true; }
+	void stop() override
+	{
+		std::lock_guard<std::mutex> l(this->frame_queue_lock);
+		this->stopped = true;
+		this->frame_queue_condition.notify_all();
+	}
 
 	bool load(IFile &file)
 	{
@@ -339,6 +397,15 @@ class SMKVideo : public Video, public std::enable_shared_from_this<SMKVideo>
 
 	~SMKVideo() override
 	{
+		{
+			std::lock_guard<std::mutex> l(this->frame_queue_lock);
+			this->decode_thread_quit = true;
+			this->frame_queue_condition.notify_all();
+		}
+		if (this->decode_thread.joinable())
+		{
+			this->decode_thread.join();
+		}
 		if (this->smk_ctx)
 			smk_close(this->smk_ctx);
 	}
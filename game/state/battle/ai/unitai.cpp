@@ -1,4 +1,5 @@
 #include "game/state/battle/ai/unitai.h"
+#include "framework/configfile.h"
 #include "game/state/battle/ai/unitaibehavior.h"
 #include "game/state/battle/ai/unitaidefault.h"
 #include "game/state/battle/ai/unitaihardcore.h"
@@ -13,6 +14,11 @@ namespace OpenApoc
 
 static const uint64_t UNIT_AI_THINK_INTERVAL = TICKS_PER_SECOND / 8;
 
+ConfigOptionInt aiThinkBudgetOption("Game.AI", "ThinkBudget",
+                                    "Milliseconds all unit AI may spend thinking in one battle "
+                                    "update, units left over think in the next (0 = unlimited)",
+                                    10);
+
 const UString UnitAI::getName()
 {
 	switch (type)
@@ -124,6 +130,17 @@ AIDecision AIBlockUnit::think(GameState &state, BattleUnit &u, bool forceInterru
 		}
 	}
 
+	// Once this update has used up its budget, units that have not thought yet go on with what
+	// they were last told to do and try again next update, by when those that have just thought
+	// are waiting out their interval. Forced thinking (reaction fire and such) cannot wait
+	auto &thinkTime = state.current_battle->aiThinkTime;
+	auto budget = std::chrono::milliseconds(aiThinkBudgetOption.get());
+	if (!forceInterrupt && budget.count() > 0 && thinkTime >= budget)
+	{
+		return {};
+	}
+	auto thinkStart = std::chrono::steady_clock::now();
+
 	ticksLastThink = curTicks;
 	ticksUntilReThink = UNIT_AI_THINK_INTERVAL;
 
@@ -155,6 +172,7 @@ AIDecision AIBlockUnit::think(GameState &state, BattleUnit &u, bool forceInterru
 			break;
 		}
 	}
+	thinkTime += std::chrono::steady_clock::now() - thinkStart;
 	return decision;
 }
 
@@ -1,4 +1,5 @@
 #include "game/state/battle/ai/unitaivanilla.h"
+#include "framework/framework.h"
 #include "game/state/battle/ai/aidecision.h"
 #include "game/state/battle/ai/unitaihelper.h"
 #include "game/state/battle/battleunit.h"
@@ -88,7 +89,7 @@ UnitAIVanilla::UnitAIVanilla() { type = Type::Vanilla; }
 // Chance to advance is equal to chance to miss
 std::tuple<AIDecision, float, unsigned>
 UnitAIVanilla::getWeaponDecision(GameState &state, BattleUnit &u, sp<AEquipment> e,
-                                 StateRef<BattleUnit> target)
+                                 StateRef<BattleUnit> target, bool hasLine)
 {
 #ifdef VANILLA_AI_DEBUG_OUTPUT
 	LogWarning("VANILLA AI %s: getWeaponDecision()", u.id);
@@ -124,7 +125,7 @@ UnitAIVanilla::getWeaponDecision(GameState &state, BattleUnit &u, sp<AEquipment>
 	damage =
 	    std::max(0, payload->damage_type->dealDamage(damage * 1.5f, damageModifier) - armorValue);
 
-	if (u.canAttackUnit(state, target, e) == WeaponStatus::NotFiring)
+	if (!hasLine || u.canAttackUnitInLine(state, target, e) == WeaponStatus::NotFiring)
 	{
 		movement->type = AIMovement::Type::GetInRange;
 		movement->targetLocation = target->position;
@@ -544,11 +545,42 @@ std::tuple<AIDecision, float, unsigned> UnitAIVanilla::getAttackDecision(GameSta
 			}
 		}
 	}
+	// Lines of fire are the same whichever weapon is used, and finding them is what costs, so find
+	// them all at once on the pool. Scoring stays serial as it draws from state.rng
+	std::vector<sp<BattleUnit>> targets;
+	std::vector<char> hasLine;
+	if (!items.empty())
+	{
+		// Resolve refs here, as resolving them from several threads at once is a race
+		for (auto &target : visibleEnemies)
+		{
+			targets.push_back(target);
+		}
+		hasLine.resize(targets.size());
+		// Targets in blocks no line of fire is known to get to are ruled out without a ray
+		auto findLine = [&state, &u, &targets, &hasLine](unsigned int index, unsigned int) {
+			hasLine[index] = u.mayHaveLineToUnit(state, targets[index]) &&
+			                 u.hasLineToUnit(targets[index]);
+		};
+		auto framework = Framework::tryGetInstance();
+		if (framework && targets.size() > 1)
+		{
+			framework->threadPoolParallelFor(targets.size(), findLine);
+		}
+		else
+		{
+			for (unsigned int index = 0; index < targets.size(); index++)
+			{
+				findLine(index, 0);
+			}
+		}
+	}
 	for (auto &e : items)
 	{
+		size_t index = 0;
 		for (auto &target : visibleEnemies)
 		{
-			auto newDecision = getWeaponDecision(state, u, e, target);
+			auto newDecision = getWeaponDecision(state, u, e, target, hasLine[index++]);
 			if (std::get<1>(newDecision) > std::get<1>(decision))
 			{
 				decision = newDecision;
@@ -69,7 +69,8 @@ class UnitAIVanilla : public UnitAI
 
 	std::tuple<AIDecision, float, unsigned> getWeaponDecision(GameState &state, BattleUnit &u,
 	                                                          sp<AEquipment> e,
-	                                                          StateRef<BattleUnit> target);
+	                                                          StateRef<BattleUnit> target,
+	                                                          bool hasLine);
 	std::tuple<AIDecision, float, unsigned> getPsiDecision(GameState &state, BattleUnit &u,
 	                                                       sp<AEquipment> e,
 	                                                       StateRef<BattleUnit> target,
@@ -1,6 +1,7 @@
 #include "game/state/battle/battle.h"
 #include "framework/configfile.h"
 #include "framework/framework.h"
+#include "framework/metrics.h"
 #include "framework/sound.h"
 #include "framework/trace.h"
 #include "game/state/battle/ai/aitype.h"
@@ -41,11 +42,16 @@
 #include "game/state/tilemap/tileobject_doodad.h"
 #include "game/state/tilemap/tileobject_projectile.h"
 #include "game/state/tilemap/tileobject_shadow.h"
+#include "library/pool.h"
+#include "library/spatialhash.h"
 #include "library/strings_format.h"
+#include "library/voxel.h"
 #include "library/xorshift.h"
 #include <algorithm>
 #include <glm/glm.hpp>
+#include <functional>
 #include <limits>
+#include <utility>
 
 namespace OpenApoc
 {
@@ -61,6 +67,31 @@ static std::vector<std::set<TileObject::Type>> layerMap = {
      TileObject::Type::Hazard},
 };
 
+// Units whose vision was refreshed for a tile in front of them changing
+static MetricCounter visionRefreshes("Battle", "vision refreshes");
+// Pairs of los blocks that lines of fire were sampled between
+static MetricCounter losBlockLinesSampled("Battle", "los block lines sampled");
+
+// What is known of the lines of fire between two los blocks
+enum LosBlockLine : uint8_t
+{
+	LOS_BLOCK_LINE_UNKNOWN = 0,
+	LOS_BLOCK_LINE_BLOCKED,
+	LOS_BLOCK_LINE_MAY_PASS,
+};
+
+// Where lines between los blocks are sampled from: the middle of the block and halfway from there
+// to each corner, all halfway up the middle level
+std::vector<Vec3<float>> getLosBlockSamplePoints(const BattleMapSector::LineOfSightBlock &l)
+{
+	Vec3<float> centre = {(l.start.x + l.end.x) / 2.0f, (l.start.y + l.end.y) / 2.0f,
+	                      (l.start.z + l.end.z - 1) / 2 + 0.5f};
+	float dx = (l.end.x - l.start.x) / 4.0f;
+	float dy = (l.end.y - l.start.y) / 4.0f;
+	return {centre, centre + Vec3<float>{-dx, -dy, 0}, centre + Vec3<float>{dx, -dy, 0},
+	        centre + Vec3<float>{-dx, dy, 0}, centre + Vec3<float>{dx, dy, 0}};
+}
+
 Battle::~Battle()
 {
 	TRACE_FN;
@@ -86,6 +117,7 @@ Battle::~Battle()
 		s->tileObject = nullptr;
 	}
 	this->map_parts.clear();
+	this->activeMapParts.clear();
 	for (auto &u : this->visibleUnits)
 	{
 		u.second.clear();
@@ -104,6 +136,7 @@ Battle::~Battle()
 		i->item->ownerUnit.clear();
 	}
 	this->items.clear();
+	this->activeItems.clear();
 	this->doors.clear();
 }
 
@@ -120,11 +153,18 @@ void Battle::initBattle(GameState &state, bool first)
 			s->door->mapParts.push_back(s);
 			s->door->position = s->getPosition();
 		}
+		s->battle = stt;
+		if (s->needsUpdate())
+		{
+			s->activate();
+		}
 	}
 	for (auto &o : this->items)
 	{
 		o->item->ownerItem = o->shared_from_this();
 		o->strategySprite = state.battle_common_image_list->strategyImages->at(480);
+		o->battle = stt;
+		o->activate();
 	}
 	for (auto &o : this->units)
 	{
@@ -203,6 +243,9 @@ void Battle::initBattle(GameState &state, bool first)
 			}
 		}
 	}
+	sealedFloorCounts = std::vector<std::vector<int>>(size.z);
+	sealedFloorsNeedUpdate = std::vector<bool>(size.z, true);
+	losBlockLines.reset(new std::atomic<uint8_t>[losBlocks.size() * losBlocks.size()]());
 	// Hazards
 	for (auto &h : hazards)
 	{
@@ -466,53 +509,50 @@ void Battle::initialMapPartLinkUp()
 	LogWarning("Begun initial map parts link up!");
 	auto &mapref = *map;
 
+	// Parts by level, to link up from the ground up
+	std::vector<std::vector<BattleMapPart *>> levels(mapref.size.z);
 	for (auto &s : this->map_parts)
 	{
 		if (!s->destroyed)
 		{
 			s->queueCollapse();
+			int z = (int)s->position.z;
+			if (z >= 0 && z < mapref.size.z)
+			{
+				levels[z].push_back(s.get());
+			}
 		}
 	}
 
-	for (int z = 0; z < mapref.size.z; z++)
+	for (auto &level : levels)
 	{
-		for (auto &s : this->map_parts)
+		for (auto s : level)
 		{
-			if ((int)s->position.z == z && !s->destroyed && s->findSupport())
+			if (s->findSupport())
 			{
 				s->cancelCollapse();
 			}
 		}
 	}
 	LogWarning("Begun map parts link up cycle!");
-	bool foundSupport;
-	// Establish support based on existing supported map parts
-	do
+	// Nothing here makes a part collapse, so only those still collapsing need to be tried again
+	std::vector<BattleMapPart *> unlinked;
+	for (auto &s : this->map_parts)
 	{
-		foundSupport = false;
-		for (auto &s : this->map_parts)
+		if (s->willCollapse())
 		{
-			if (!s->willCollapse())
-			{
-				continue;
-			}
-			if (s->findSupport())
-			{
-				s->cancelCollapse();
-				foundSupport = true;
-			}
+			unlinked.push_back(s.get());
 		}
-	} while (foundSupport);
+	}
+	// Establish support based on existing supported map parts
+	SupportedMapPart::linkUpCollapsing(unlinked, [](BattleMapPart &s) { return s.findSupport(); });
 
 	// Report unlinked parts
-	for (auto &mp : this->map_parts)
+	for (auto s : unlinked)
 	{
-		if (mp->willCollapse())
-		{
-			auto pos = mp->tileObject->getOwningTile()->position;
-			LogWarning("MP %s SBT %d at %s is UNLINKED", mp->type.id,
-			           (int)mp->type->getVanillaSupportedById(), pos);
-		}
+		auto pos = s->tileObject->getOwningTile()->position;
+		LogWarning("MP %s SBT %d at %s is UNLINKED", s->type.id,
+		           (int)s->type->getVanillaSupportedById(), pos);
 	}
 
 	LogWarning("Attempting link up of unlinked parts");
@@ -521,22 +561,10 @@ void Battle::initialMapPartLinkUp()
 	{
 		bool skipTypeCheck = iteration > 0;
 		bool skipHardCheck = iteration > 1;
-		do
-		{
-			foundSupport = false;
-			for (auto &s : this->map_parts)
-			{
-				if (!s->willCollapse())
-				{
-					continue;
-				}
-				if (s->attachToSomething(!skipTypeCheck, !skipHardCheck))
-				{
-					s->cancelCollapse();
-					foundSupport = true;
-				}
-			}
-		} while (foundSupport);
+		SupportedMapPart::linkUpCollapsing(
+		    unlinked, [skipTypeCheck, skipHardCheck](BattleMapPart &s) {
+			    return s.attachToSomething(!skipTypeCheck, !skipHardCheck);
+		    });
 	}
 
 	// Report unlinked parts
@@ -1118,7 +1146,7 @@ void Battle::setMode(Mode mode) { this->mode = mode; }
 
 sp<Doodad> Battle::placeDoodad(StateRef<DoodadType> type, Vec3<float> position)
 {
-	auto doodad = mksp<Doodad>(position, type);
+	auto doodad = mkpooled<Doodad>(position, type);
 	if (map)
 	{
 		map->addObjectToMap(doodad);
@@ -1187,7 +1215,7 @@ sp<BattleExplosion> Battle::addExplosion(GameState &state, Vec3<int> position,
 	}
 
 	// Explosion
-	auto explosion = mksp<BattleExplosion>(
+	auto explosion = mkpooled<BattleExplosion>(
 	    position, damageType, power, depletionRate,
 	    !config().getBool("OpenApoc.NewFeature.InstantExplosionDamage"), ownerOrg, ownerUnit);
 	explosions.insert(explosion);
@@ -1256,6 +1284,9 @@ sp<BattleItem> Battle::placeItem(GameState &state, sp<AEquipment> item, Vec3<flo
 		map->addObjectToMap(bitem);
 	}
 	items.push_back(bitem);
+	bitem->battle = shared_from_this();
+	// Updated at least once, to find out whether it has anything to do
+	bitem->activate();
 	return bitem;
 }
 
@@ -1296,14 +1327,7 @@ sp<BattleHazard> Battle::placeHazard(GameState &state, StateRef<Organisation> ow
 			return nullptr;
 		}
 		// Clear existing hazards
-		sp<BattleHazard> existingHazard;
-		for (auto &obj : tile->ownedObjects)
-		{
-			if (obj->getType() == TileObject::Type::Hazard)
-			{
-				existingHazard = std::static_pointer_cast<TileObjectBattleHazard>(obj)->getHazard();
-			}
-		}
+		auto existingHazard = tile->getHazardIfPresent();
 		if (existingHazard)
 		{
 			// Fire cannot spread into another fire
@@ -1355,7 +1379,6 @@ void Battle::updateProjectiles(GameState &state, unsigned int ticks)
 		p->update(state, ticks);
 	}
 	// Since projectiles can kill projectiles just kill everyone in the end
-	std::set<std::tuple<sp<Projectile>, bool, bool>> deadProjectiles;
 	for (auto &p : projectiles)
 	{
 		notifyAction(p->position);
@@ -1404,45 +1427,68 @@ void Battle::updateProjectiles(GameState &state, unsigned int ticks)
 						LogError("Collision with non-collidable object");
 				}
 			}
-			deadProjectiles.emplace(c.projectile->shared_from_this(), displayDoodad, playSound);
+			deadProjectiles.emplace_back(c.projectile->shared_from_this(), displayDoodad,
+			                             playSound);
 		}
 	}
 	// Kill projectiles that collided
-	for (auto &p : deadProjectiles)
-	{
-		std::get<0>(p)->die(state, std::get<1>(p), std::get<2>(p));
-	}
+	Projectile::dieCollided(state, deadProjectiles);
 }
 
 void Battle::updateVision(GameState &state)
 {
-	std::set<sp<BattleUnit>> unitsToUpdate;
+	// Changed tiles by area, so that each unit only goes through those near what it can see
+	static const float CHANGED_TILES_CELL_SIZE = 8.0f;
+	SpatialHash<Vec3<int>> changedTiles{CHANGED_TILES_CELL_SIZE};
+	for (auto &pos : tilesChangedForVision)
+	{
+		changedTiles.insert(pos, pos);
+	}
+
+	// In the order of units, so that every run updates them the same way
+	std::vector<sp<BattleUnit>> unitsToUpdate;
 	for (auto &entry : units)
 	{
 		auto unit = entry.second;
-		if (!unit->isConscious())
+		if (unit->visionRefreshQueued)
 		{
+			unit->visionRefreshQueued = false;
+			unitsToUpdate.push_back(unit);
 			continue;
 		}
-		for (auto &pos : tilesChangedForVision)
+		if (tilesChangedForVision.empty())
 		{
-			auto vec = pos - (Vec3<int>)unit->position;
-			// Quick check it's to the right side of us and in range
-			// FIXME: Should we check more thoroughly to save CPU time (probably)?
-			if ((vec.x > 0 && unit->facing.x < 0) || (vec.y > 0 && unit->facing.y < 0) ||
-			    (vec.x < 0 && unit->facing.x > 0) || (vec.y < 0 && unit->facing.y > 0) ||
-			    (vec.x * vec.x + vec.y * vec.y + vec.z * vec.z > 400))
+			continue;
+		}
+		auto viewer = unit->getVisionHotData();
+		if (!viewer.conscious)
+		{
+			continue;
+		}
+		auto bounds = unit->getVisionBounds();
+		bool changed = false;
+		changedTiles.forEachIn(bounds.p0, bounds.p1 - 1, [&changed, &viewer](const Vec3<int> &pos) {
+			if (changed)
 			{
-				continue;
+				return;
 			}
-			unitsToUpdate.insert(unit);
-			break;
+			// Has to be in range and within the vision cone
+			auto vec = pos - viewer.position;
+			if (vec.x * vec.x + vec.y * vec.y + vec.z * vec.z > VIEW_DISTANCE * VIEW_DISTANCE ||
+			    !BattleUnit::isWithinVisionCone(vec, viewer.facing, viewer.allRound))
+			{
+				return;
+			}
+			changed = true;
+		});
+		if (changed)
+		{
+			unitsToUpdate.push_back(unit);
 		}
 	}
-	for (auto &unit : unitsToUpdate)
-	{
-		unit->refreshUnitVision(state);
-	}
+	visionRefreshes.add(unitsToUpdate.size());
+	BattleUnit::refreshUnitsVision(state, unitsToUpdate);
+	forgetLosBlockLines(tilesChangedForVision);
 	tilesChangedForVision.clear();
 }
 
@@ -1504,7 +1550,7 @@ bool findLosBlockCenter(TileMap &map, BattleUnitType type,
 
 void Battle::updatePathfinding(GameState &, unsigned int ticks)
 {
-	// Throttling updates so that big explosions won't lag
+	// Throttling updates so that big explosions won't lag (this is per thread doing the updates)
 	static const int LIMIT_PER_TICK = 10;
 
 	// How much attempts are given to the pathfinding until giving up and concluding that
@@ -1554,10 +1600,13 @@ void Battle::updatePathfinding(GameState &, unsigned int ticks)
 		}
 	}
 
-	int updatesRemaining = ticks > 0 ? LIMIT_PER_TICK * ticks : -1;
+	auto framework = Framework::tryGetInstance();
+	unsigned int threadCount = framework ? framework->threadPoolGetSize() + 1 : 1;
+	int updatesRemaining = ticks > 0 ? LIMIT_PER_TICK * threadCount * ticks : -1;
 
-	// Now update all paths
-	for (int i = 0; i < lbCount - 1; i++)
+	// Collect links to update
+	std::vector<std::pair<int, int>> linksToUpdate;
+	for (int i = 0; i < lbCount - 1 && updatesRemaining != 0; i++)
 	{
 		for (int j = i + 1; j < lbCount; j++)
 		{
@@ -1570,55 +1619,207 @@ void Battle::updatePathfinding(GameState &, unsigned int ticks)
 				updatesRemaining--;
 				if (updatesRemaining == 0)
 				{
-					return;
+					break;
 				}
 			}
 			linkNeedsUpdate[i + j * lbCount] = false;
+			linksToUpdate.emplace_back(i, j);
+		}
+	}
+	if (linksToUpdate.empty())
+	{
+		return;
+	}
 
-			// Update link for every kind of unit
-			for (auto &type : BattleUnitTypeList)
+	// Pathfinding jobs only read the map, every one writes into its own slot of results,
+	// which are then committed to linkCost here
+	std::vector<BattleUnitType> types(BattleUnitTypeList.begin(), BattleUnitTypeList.end());
+	std::vector<const std::vector<bool> *> availableByType;
+	std::vector<const std::vector<Vec3<int>> *> centerByType;
+	for (auto &type : types)
+	{
+		availableByType.push_back(&blockAvailable[type]);
+		centerByType.push_back(&blockCenterPos[type]);
+	}
+	int typeCount = types.size();
+	std::vector<int> results(linksToUpdate.size() * typeCount, -1);
+	auto updateLink = [&](unsigned int index, PathfindingArena *arena) {
+		int i = linksToUpdate[index].first;
+		int j = linksToUpdate[index].second;
+		for (int t = 0; t < typeCount; t++)
+		{
+			auto &available = *availableByType[t];
+			auto &center = *centerByType[t];
+			// Do not try if one of blocks is unavailable
+			if (!available[i] || !available[j])
 			{
-				// Do not try if one of blocks is unavailable
-				if (!blockAvailable[type][i] || !blockAvailable[type][j])
-				{
-					linkCost[type][i + j * lbCount] = -1;
-					linkCost[type][j + i * lbCount] = -1;
-					continue;
-				}
+				continue;
+			}
 
-				// See if path from one center to another center is possible
-				// within reasonable number of attempts
-				int dX = std::abs(blockCenterPos[type][i].x - blockCenterPos[type][j].x);
-				int dY = std::abs(blockCenterPos[type][i].y - blockCenterPos[type][j].y);
-				int dZ = std::abs(blockCenterPos[type][i].z - blockCenterPos[type][j].z);
-				int distance = (dX + dY + dZ + std::max(dX, std::max(dY, dZ))) / 2;
+			// See if path from one center to another center is possible
+			// within reasonable number of attempts
+			int dX = std::abs(center[i].x - center[j].x);
+			int dY = std::abs(center[i].y - center[j].y);
+			int dZ = std::abs(center[i].z - center[j].z);
+			int distance = (dX + dY + dZ + std::max(dX, std::max(dY, dZ))) / 2;
 
-				float cost = 0.0f;
+			float cost = 0.0f;
 
-				auto path = mapRef.findShortestPath(
-				    blockCenterPos[type][i], blockCenterPos[type][j],
-				    distance * PATH_ITERATION_LIMIT_MULTIPLIER, helperMap[(int)type], false, true,
-				    true, true, &cost, distance * 4 * PATH_COST_LIMIT_MULTIPLIER);
+			auto path = mapRef.findShortestPath(
+			    center[i], center[j], distance * PATH_ITERATION_LIMIT_MULTIPLIER,
+			    helperMap[(int)types[t]], false, true, true, true, &cost,
+			    distance * 4 * PATH_COST_LIMIT_MULTIPLIER, arena);
 
-				if (path.empty() || (*path.rbegin()) != blockCenterPos[type][j])
-				{
-					linkCost[type][i + j * lbCount] = -1;
-					linkCost[type][j + i * lbCount] = -1;
-				}
-				else
-				{
-					linkCost[type][i + j * lbCount] = (int)cost;
-					linkCost[type][j + i * lbCount] = (int)cost;
-				}
+			if (!path.empty() && (*path.rbegin()) == center[j])
+			{
+				results[index * typeCount + t] = (int)cost;
+			}
+		}
+	};
+
+	if (framework && linksToUpdate.size() > 1)
+	{
+		if (linkPathfindingArenas.size() < threadCount)
+		{
+			linkPathfindingArenas.resize(threadCount);
+		}
+		framework->threadPoolParallelFor(
+		    linksToUpdate.size(), [this, &updateLink](unsigned int index, unsigned int slot) {
+			    updateLink(index, &linkPathfindingArenas[slot]);
+			});
+	}
+	else
+	{
+		for (unsigned int index = 0; index < linksToUpdate.size(); index++)
+		{
+			updateLink(index, nullptr);
+		}
+	}
+
+	blockComponentsNeedUpdate = true;
+	for (unsigned int index = 0; index < linksToUpdate.size(); index++)
+	{
+		int i = linksToUpdate[index].first;
+		int j = linksToUpdate[index].second;
+		for (int t = 0; t < typeCount; t++)
+		{
+			auto &cost = linkCost[types[t]];
+			cost[i + j * lbCount] = results[index * typeCount + t];
+			cost[j + i * lbCount] = results[index * typeCount + t];
+		}
+	}
+}
+
+namespace
+{
+
+MetricGauge battleUnitsGauge("Entities", "battle units");
+MetricGauge battleItemsGauge("Entities", "battle items");
+MetricGauge battleProjectilesGauge("Entities", "battle projectiles");
+
+// What a phase of Battle::update reads or writes
+enum TickData : unsigned int
+{
+	TickUnits = 1 << 0,
+	TickMap = 1 << 1,
+	TickDoors = 1 << 2,
+	TickDoodads = 1 << 3,
+	TickScanners = 1 << 4,
+	// Anything else, such as the random number generator, sounds or the lists of objects
+	TickOther = 1 << 5,
+	TickAll = ~0u,
+};
+
+// One step of Battle::update. If tasks is set it is called just before the phase runs and work
+// is called once for each task it returns, at once on the thread pool, so each task must only
+// ever write what belongs to it alone. Otherwise work is called once with index 0
+class TickPhase
+{
+  public:
+	const char *name;
+	unsigned int reads;
+	unsigned int writes;
+	std::function<unsigned int()> tasks;
+	std::function<void(unsigned int index)> work;
+};
+
+bool tickPhasesConflict(const TickPhase &a, const TickPhase &b)
+{
+	return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+}
+
+// Runs phases in order, except that phases next to each other that don't read or write what
+// another of them writes are run together on the thread pool with the tasks of one another.
+// If times is given, the time each group took is added to it under the group's name
+void runTickPhases(const std::vector<TickPhase> &phases,
+                   std::map<UString, std::chrono::steady_clock::duration> *times)
+{
+	auto framework = Framework::tryGetInstance();
+	size_t first = 0;
+	while (first < phases.size())
+	{
+		size_t last = first + 1;
+		for (; last < phases.size(); last++)
+		{
+			bool conflict = false;
+			for (size_t i = first; i < last && !conflict; i++)
+			{
+				conflict = tickPhasesConflict(phases[i], phases[last]);
+			}
+			if (conflict)
+			{
+				break;
+			}
+		}
+
+		// Which phase each task belongs to and the index of the task in it
+		std::vector<std::pair<size_t, unsigned int>> tasks;
+		UString name;
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int count = phases[i].tasks ? phases[i].tasks() : 1;
+			for (unsigned int index = 0; index < count; index++)
+			{
+				tasks.emplace_back(i, index);
+			}
+			name += i == first ? phases[i].name : UString("+") + phases[i].name;
+		}
+		auto doTask = [&phases, &tasks](unsigned int task, unsigned int) {
+			phases[tasks[task].first].work(tasks[task].second);
+		};
+		Trace::start(name, {{"phases", Strings::fromInteger(static_cast<int>(last - first))},
+		                    {"tasks", Strings::fromInteger(static_cast<int>(tasks.size()))}});
+		auto start = std::chrono::steady_clock::now();
+		if (framework && tasks.size() > 1)
+		{
+			framework->threadPoolParallelFor(tasks.size(), doTask);
+		}
+		else
+		{
+			for (unsigned int task = 0; task < tasks.size(); task++)
+			{
+				doTask(task, 0);
 			}
 		}
+		if (times)
+		{
+			(*times)[name] += std::chrono::steady_clock::now() - start;
+		}
+		Trace::end(name);
+		first = last;
 	}
 }
 
+} // anonymous namespace
+
 void Battle::update(GameState &state, unsigned int ticks)
 {
 	TRACE_FN_ARGS1("ticks", Strings::fromInteger(static_cast<int>(ticks)));
+	battleUnitsGauge.set(units.size());
+	battleItemsGauge.set(items.size());
+	battleProjectilesGauge.set(projectiles.size());
 
+	aiThinkTime = {};
 	if (missionEndTimer > 0)
 	{
 		missionEndTimer++;
@@ -1645,80 +1846,123 @@ void Battle::update(GameState &state, unsigned int ticks)
 			break;
 		}
 	}
-	Trace::start("Battle::update::projectiles->update");
-	updateProjectiles(state, ticks);
-	Trace::end("Battle::update::projectiles->update");
-	Trace::start("Battle::update::doors->update");
-	for (auto &o : this->doors)
-	{
-		o.second->update(state, ticks);
-	}
-	Trace::end("Battle::update::doors->update");
-	Trace::start("Battle::update::doodads->update");
-	for (auto it = this->doodads.begin(); it != this->doodads.end();)
-	{
-		auto d = *it++;
-		d->update(state, ticks);
-	}
-	Trace::end("Battle::update::doodads->update");
-	Trace::start("Battle::update::hazards->update");
-	for (auto it = this->hazards.begin(); it != this->hazards.end();)
-	{
-		auto d = *it++;
-		d->update(state, ticks);
-	}
-	Trace::end("Battle::update::hazards->update");
-	Trace::start("Battle::update::explosions->update");
-	for (auto it = this->explosions.begin(); it != this->explosions.end();)
-	{
-		auto d = *it++;
-		d->update(state, ticks);
-	}
-	Trace::end("Battle::update::explosions->update");
-	Trace::start("Battle::update::map_parts->update");
-	for (auto &o : this->map_parts)
-	{
-		o->update(state, ticks);
-	}
-	Trace::end("Battle::update::map_parts->update");
-	Trace::start("Battle::update::items->update");
-	for (auto it = this->items.begin(); it != this->items.end();)
-	{
-		auto p = *it++;
-		p->update(state, ticks);
-	}
-	Trace::end("Battle::update::items->update");
-	Trace::start("Battle::update::scanners->update");
-	for (auto &o : this->scanners)
-	{
-		o.second->update(state, ticks);
-	}
-	Trace::end("Battle::update::scanners->update");
-	Trace::start("Battle::update::units->update");
-	for (auto &o : this->units)
-	{
-		o.second->update(state, ticks);
-	}
-	Trace::end("Battle::update::units->update");
-	Trace::start("Battle::update::ai->think");
-	{
-		auto result = aiBlock.think(state);
-		for (auto &entry : result)
-		{
-			BattleUnit::executeGroupAIDecision(state, entry.second, entry.first);
-		}
-	}
-	Trace::end("Battle::update::ai->think");
-
-	// Now after we called update() for everything, we update what needs to be updated last
-
-	// Update unit vision for units that see changes in terrain or hazards
-	Trace::start("Battle::update::vision");
-	updateVision(state);
-	Trace::end("Battle::update::vision");
-	Trace::start("Battle::update::pathfinding");
-	updatePathfinding(state, ticks);
-	Trace::end("Battle::update::pathfinding");
+	// Each phase with what it reads and writes, for runTickPhases to tell which can go together.
+	// Objects that can remove themselves from their list while updating are stepped past first
+	std::vector<BattleScanner *> scannerList;
+	std::vector<TickPhase> phases = {
+	    {"Battle::update::projectiles->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) { updateProjectiles(state, ticks); }},
+	    {"Battle::update::doors->update", TickMap, TickDoors | TickMap | TickOther, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     for (auto &o : this->doors)
+		     {
+			     o.second->update(state, ticks);
+		     }
+	     }},
+	    {"Battle::update::doodads->update", TickDoodads, TickDoodads | TickMap | TickOther,
+	     nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     for (auto it = this->doodads.begin(); it != this->doodads.end();)
+		     {
+			     auto d = *it++;
+			     d->update(state, ticks);
+		     }
+	     }},
+	    {"Battle::update::hazards->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     for (auto it = this->hazards.begin(); it != this->hazards.end();)
+		     {
+			     auto d = *it++;
+			     d->update(state, ticks);
+		     }
+	     }},
+	    {"Battle::update::explosions->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     for (auto it = this->explosions.begin(); it != this->explosions.end();)
+		     {
+			     auto d = *it++;
+			     d->update(state, ticks);
+		     }
+	     }},
+	    {"Battle::update::map_parts->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     // Parts that start to fall or collapse in here are first updated in the next update
+		     std::vector<sp<BattleMapPart>> updatingParts;
+		     updatingParts.swap(this->activeMapParts);
+		     for (auto &o : updatingParts)
+		     {
+			     o->active = false;
+			     // Gone since it was activated
+			     if (!o->tileObject)
+			     {
+				     continue;
+			     }
+			     o->update(state, ticks);
+			     if (o->tileObject && o->needsUpdate())
+			     {
+				     o->activate();
+			     }
+		     }
+	     }},
+	    {"Battle::update::items->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     // Items that start to fall or collapse in here are first updated in the next update
+		     std::vector<sp<BattleItem>> updatingItems;
+		     updatingItems.swap(this->activeItems);
+		     for (auto &p : updatingItems)
+		     {
+			     p->active = false;
+			     // Gone since it was activated
+			     if (!p->tileObject)
+			     {
+				     continue;
+			     }
+			     p->update(state, ticks);
+			     if (p->tileObject && p->needsUpdate())
+			     {
+				     p->activate();
+			     }
+		     }
+	     }},
+	    // A scanner only changes itself and reads where units are, so they all go at once
+	    {"Battle::update::scanners->update", TickUnits | TickScanners, TickScanners,
+	     [this, &scannerList]() {
+		     // Movements from here on are seen by the scanners next update
+		     this->scannerMovements.swap(this->pendingScannerMovements);
+		     this->pendingScannerMovements.clear();
+		     scannerList.clear();
+		     for (auto &o : this->scanners)
+		     {
+			     scannerList.push_back(o.second.get());
+		     }
+		     return (unsigned int)scannerList.size();
+	     },
+	     [&scannerList, &state, ticks](unsigned int index) {
+		     scannerList[index]->update(state, ticks);
+	     }},
+	    {"Battle::update::units->update", TickAll, TickAll, nullptr,
+	     [this, &state, ticks](unsigned int) {
+		     for (auto &o : this->units)
+		     {
+			     o.second->update(state, ticks);
+		     }
+	     }},
+	    {"Battle::update::ai->think", TickAll, TickAll, nullptr,
+	     [this, &state](unsigned int) {
+		     auto result = aiBlock.think(state);
+		     for (auto &entry : result)
+		     {
+			     BattleUnit::executeGroupAIDecision(state, entry.second, entry.first);
+		     }
+	     }},
+	    // Now after we called update() for everything, we update what needs to be updated last
+	    // Update unit vision for units that see changes in terrain or hazards
+	    {"Battle::update::vision", TickUnits | TickMap, TickUnits, nullptr,
+	     [this, &state](unsigned int) { updateVision(state); }},
+	    {"Battle::update::pathfinding", TickUnits | TickMap, TickUnits, nullptr,
+	     [this, &state, ticks](unsigned int) { updatePathfinding(state, ticks); }},
+	};
+	runTickPhases(phases, timePhases ? &phaseTimes : nullptr);
 }
 
 void Battle::updateTB(GameState &state)
@@ -1861,24 +2105,228 @@ int Battle::getLosBlockID(int x, int y, int z) const
 	return tileToLosBlock.at(z * size.x * size.y + y * size.x + x);
 }
 
+void Battle::updateSealedFloors(int z)
+{
+	auto &counts = sealedFloorCounts[z];
+	counts.assign((size.x + 1) * (size.y + 1), 0);
+	for (int y = 0; y < size.y; y++)
+	{
+		for (int x = 0; x < size.x; x++)
+		{
+			// A line going from below this tile to above it steps through every voxel layer of
+			// it, so a map part filling the tile with a full layer stops all sight
+			bool sealed = false;
+			auto tile = map->getTile(x, y, z);
+			for (auto &obj : tile->ownedObjects)
+			{
+				if (obj->getType() != TileObject::Type::Ground &&
+				    obj->getType() != TileObject::Type::Feature &&
+				    obj->getType() != TileObject::Type::LeftWall &&
+				    obj->getType() != TileObject::Type::RightWall)
+				{
+					continue;
+				}
+				auto mp = std::static_pointer_cast<TileObjectBattleMapPart>(obj)->getOwner();
+				auto voxelMap = mp->type->voxelMapLOS;
+				// Doors change shape without telling us
+				if (mp->falling || mp->destroyed || mp->door || !voxelMap ||
+				    voxelMap->size != map->voxelMapSize)
+				{
+					continue;
+				}
+				auto voxelStart = obj->getCenter() - obj->getVoxelOffset();
+				if (glm::length(voxelStart - Vec3<float>{x, y, z}) > 0.001f)
+				{
+					continue;
+				}
+				for (auto &slice : voxelMap->slices)
+				{
+					if (slice && slice->isFull())
+					{
+						sealed = true;
+						break;
+					}
+				}
+				if (sealed)
+				{
+					break;
+				}
+			}
+			counts[(y + 1) * (size.x + 1) + x + 1] = (sealed ? 1 : 0) +
+			                                         counts[y * (size.x + 1) + x + 1] +
+			                                         counts[(y + 1) * (size.x + 1) + x] -
+			                                         counts[y * (size.x + 1) + x];
+		}
+	}
+	sealedFloorsNeedUpdate[z] = false;
+}
+
+bool Battle::getLosBlocksMayBeVisible(int from, int to)
+{
+	auto &a = *losBlocks[from];
+	auto &b = *losBlocks[to];
+	// Any line between the blocks stays within the rectangle holding both of them
+	int x0 = std::min(a.start.x, b.start.x);
+	int y0 = std::min(a.start.y, b.start.y);
+	int x1 = std::max(a.end.x, b.end.x);
+	int y1 = std::max(a.end.y, b.end.y);
+	// Only levels entirely in between the blocks can stand in the way
+	int zStart = std::min(a.end.z, b.end.z);
+	int zEnd = std::max(a.start.z, b.start.z);
+	for (int z = zStart; z < zEnd; z++)
+	{
+		if (sealedFloorsNeedUpdate[z])
+		{
+			updateSealedFloors(z);
+		}
+		auto &counts = sealedFloorCounts[z];
+		int sealed = counts[y1 * (size.x + 1) + x1] - counts[y0 * (size.x + 1) + x1] -
+		             counts[y1 * (size.x + 1) + x0] + counts[y0 * (size.x + 1) + x0];
+		if (sealed == (x1 - x0) * (y1 - y0))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Battle::getLosBlocksMayHaveLine(int from, int to)
+{
+	if (!losBlockLines)
+	{
+		return true;
+	}
+	auto &entry = losBlockLines[from * losBlocks.size() + to];
+	auto known = entry.load(std::memory_order_relaxed);
+	if (known == LOS_BLOCK_LINE_UNKNOWN)
+	{
+		// Threads asking at once sample the same, so whichever stores last is as good
+		known = sampleLosBlockLines(from, to) ? LOS_BLOCK_LINE_MAY_PASS : LOS_BLOCK_LINE_BLOCKED;
+		entry.store(known, std::memory_order_relaxed);
+		losBlockLinesSampled.add();
+	}
+	return known == LOS_BLOCK_LINE_MAY_PASS;
+}
+
+bool Battle::sampleLosBlockLines(int from, int to) const
+{
+	if (from == to)
+	{
+		return true;
+	}
+	CollisionOptions options;
+	options.validTypes = TileObject::getTypeMask(TileObject::Type::Ground) |
+	                     TileObject::getTypeMask(TileObject::Type::LeftWall) |
+	                     TileObject::getTypeMask(TileObject::Type::RightWall) |
+	                     TileObject::getTypeMask(TileObject::Type::Feature);
+	auto fromPoints = getLosBlockSamplePoints(*losBlocks[from]);
+	auto toPoints = getLosBlockSamplePoints(*losBlocks[to]);
+	for (auto &start : fromPoints)
+	{
+		for (auto &end : toPoints)
+		{
+			auto c = map->findCollision(start, end, options);
+			if (!c)
+			{
+				return true;
+			}
+			// A point inside something solid says nothing of lines from near it
+			Vec3<int> hit = c.position;
+			if (hit == Vec3<int>{start} || hit == Vec3<int>{end})
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void Battle::forgetLosBlockLines(const std::set<Vec3<int>> &tiles)
+{
+	if (!losBlockLines || tiles.empty())
+	{
+		return;
+	}
+	int count = losBlocks.size();
+	for (int from = 0; from < count; from++)
+	{
+		auto &a = *losBlocks[from];
+		for (int to = 0; to < count; to++)
+		{
+			// Lines that may pass are cast anyway, so only blocked ones can be wrong
+			auto &entry = losBlockLines[from * count + to];
+			if (entry.load(std::memory_order_relaxed) != LOS_BLOCK_LINE_BLOCKED)
+			{
+				continue;
+			}
+			// Any line between the blocks stays within the box holding both of them
+			auto &b = *losBlocks[to];
+			Vec3<int> start = {std::min(a.start.x, b.start.x), std::min(a.start.y, b.start.y),
+			                   std::min(a.start.z, b.start.z)};
+			Vec3<int> end = {std::max(a.end.x, b.end.x), std::max(a.end.y, b.end.y),
+			                 std::max(a.end.z, b.end.z)};
+			for (auto &tile : tiles)
+			{
+				if (tile.x >= start.x && tile.x < end.x && tile.y >= start.y && tile.y < end.y &&
+				    tile.z >= start.z && tile.z < end.z)
+				{
+					entry.store(LOS_BLOCK_LINE_UNKNOWN, std::memory_order_relaxed);
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool Battle::getTileSealed(int x, int y, int z)
+{
+	if (sealedFloorsNeedUpdate[z])
+	{
+		updateSealedFloors(z);
+	}
+	auto &counts = sealedFloorCounts[z];
+	int width = size.x + 1;
+	int sealed = counts[(y + 1) * width + x + 1] - counts[y * width + x + 1] -
+	             counts[(y + 1) * width + x] + counts[y * width + x];
+	return sealed > 0;
+}
+
 bool Battle::getVisible(StateRef<Organisation> org, int x, int y, int z) const
 {
-	return visibleTiles.at(org).at(z * size.x * size.y + y * size.x + x);
+	return visibleTiles.at(org).get(z * size.x * size.y + y * size.x + x);
 }
 
 void Battle::setVisible(StateRef<Organisation> org, int x, int y, int z, bool val)
 {
-	visibleTiles[org][z * size.x * size.y + y * size.x + x] = val;
+	visibleTiles[org].set(z * size.x * size.y + y * size.x + x, val);
 }
 
-void Battle::queueVisionRefresh(Vec3<int> tile) { tilesChangedForVision.insert(tile); }
+void Battle::setVisibleBox(StateRef<Organisation> org, Vec3<int> start, Vec3<int> end, bool val)
+{
+	auto &tiles = visibleTiles[org];
+	for (int z = start.z; z < end.z; z++)
+	{
+		for (int y = start.y; y < end.y; y++)
+		{
+			auto row = z * size.x * size.y + y * size.x;
+			tiles.setRange(row + start.x, row + end.x, val);
+		}
+	}
+}
+
+void Battle::queueVisionRefresh(Vec3<int> tile)
+{
+	tilesChangedForVision.insert(tile);
+	map->addHeat(TileMap::HeatKind::VisionRefreshes, tile);
+}
 
 void Battle::notifyScanners(Vec3<int> position)
 {
-	for (auto &s : scanners)
+	if (scanners.empty())
 	{
-		s.second->notifyMovement(position);
+		return;
 	}
+	pendingScannerMovements.push_back(position);
 }
 
 void Battle::notifyAction(Vec3<int> location, StateRef<BattleUnit> actorUnit)
@@ -2191,7 +2639,7 @@ void Battle::handleProjectileHit(GameState &state, sp<Projectile> projectile, bo
 			auto velocity = glm::normalize(
 			    VehicleType::directionToVector(VehicleType::getDirectionLarge(direction)));
 			velocity *= p->speed * PROJECTILE_VELOCITY_MULTIPLIER;
-			auto newProj = mksp<Projectile>(
+			auto newProj = mkpooled<Projectile>(
 			    p->guided ? Projectile::Type::Missile : Projectile::Type::Beam,
 			    projectile->firerUnit, projectile->trackedUnit, projectile->targetPosition,
 			    projectile->position, velocity, p->turn_rate, p->ttl, p->damage, 0, 0, p->tail_size,
@@ -2210,6 +2658,12 @@ void Battle::handleProjectileHit(GameState &state, sp<Projectile> projectile, bo
 
 void Battle::queuePathfindingRefresh(Vec3<int> tile)
 {
+	map->notifyCollisionChange();
+	if (tile.z >= 0 && tile.z < (int)sealedFloorsNeedUpdate.size())
+	{
+		sealedFloorsNeedUpdate[tile.z] = true;
+	}
+	pathfindingChanges.add(tile);
 	blockNeedsUpdate[getLosBlockID(tile.x, tile.y, tile.z)] = true;
 	auto tXgt0 = tile.x > 0;
 	auto tYgt0 = tile.y > 0;
@@ -2304,6 +2758,7 @@ void Battle::beginTurn(GameState &state)
 		LogError("beginTurn called in real time?");
 		return;
 	}
+	batchingVisionRefreshes = true;
 
 	// Cancel mind control
 	for (auto &u : units)
@@ -2328,6 +2783,11 @@ void Battle::beginTurn(GameState &state)
 		u.second->beginTurn(state);
 	}
 
+	// Everything up to here, from the hazards of the turn that ended on, only changed the map and
+	// queued what it changed, so the AI gets to see it all refreshed at once
+	batchingVisionRefreshes = false;
+	updateVision(state);
+
 	aiBlock.beginTurnRoutine(state, currentActiveOrganisation);
 
 	for (auto &p : participants)
@@ -2340,6 +2800,7 @@ void Battle::beginTurn(GameState &state)
 
 void Battle::endTurn(GameState &state)
 {
+	batchingVisionRefreshes = true;
 	updateTBEnd(state);
 
 	// Pass turn to next org, if final org - increment turn counter and pass to first org
@@ -2469,10 +2930,7 @@ void Battle::enterBattle(GameState &state)
 
 	if (b->mission_type == MissionType::BaseDefense)
 	{
-		for (size_t i = 0; i < b->visibleTiles[b->locationOwner].size(); i++)
-		{
-			b->visibleTiles[b->locationOwner][i] = true;
-		}
+		b->visibleTiles[b->locationOwner].setAll();
 		for (size_t i = 0; i < b->visibleBlocks[b->locationOwner].size(); i++)
 		{
 			b->visibleBlocks[b->locationOwner][i] = true;
@@ -3429,22 +3887,139 @@ void Battle::loadResources(GameState &state)
 	battle_map->loadTilesets(state);
 	loadImagePacks(state);
 	loadAnimationPacks(state);
+	prepareSamples(state);
+}
+
+void Battle::prepareSamples(GameState &state)
+{
+	std::set<sp<Sample>> samples;
+	auto addList = [&samples](const std::list<sp<Sample>> &list) {
+		samples.insert(list.begin(), list.end());
+	};
+	if (auto list = state.battle_common_sample_list)
+	{
+		samples.insert({list->gravlift, list->door, list->brainsuckerHatch, list->brainsuckerSuck,
+		                list->teleport, list->burn});
+		if (list->genericHitSounds)
+		{
+			addList(*list->genericHitSounds);
+		}
+		for (auto &walkSounds : list->walkSounds)
+		{
+			if (walkSounds)
+			{
+				samples.insert(walkSounds->begin(), walkSounds->end());
+			}
+		}
+		samples.insert(list->objectDropSounds.begin(), list->objectDropSounds.end());
+		addList(list->throwSounds);
+	}
+	for (auto &u : units)
+	{
+		auto &type = u.second->agent->type;
+		samples.insert(type->walkSfx.begin(), type->walkSfx.end());
+		addList(type->crySfx);
+		for (auto *sounds : {&type->damageSfx, &type->fatalWoundSfx, &type->dieSfx})
+		{
+			for (auto &gender : *sounds)
+			{
+				addList(gender.second);
+			}
+		}
+		samples.insert(type->gravLiftSfx);
+		for (auto &e : u.second->agent->equipment)
+		{
+			samples.insert({e->type->fire_sfx, e->type->impact_sfx});
+		}
+	}
+	samples.erase(nullptr);
+	fw().soundBackend->prepareSamples({samples.begin(), samples.end()});
 }
 
 void Battle::unloadResources(GameState &state)
 {
+	// Image and animation packs stay loaded, the next battle is likely to use a lot of the same
+	// ones and only loads those it does not find
 	BattleMap::unloadTilesets(state);
-	unloadImagePacks(state);
-	unloadAnimationPacks(state);
 }
 
-void Battle::loadImagePacks(GameState &state)
+namespace
 {
-	if (state.battle_unit_image_packs.size() > 0)
+
+// Makes packs hold the packs named in packNames, loading the ones it does not have yet over the
+// thread pool, as loading a pack only reads the state, and dropping those not named.
+// load(pack, path) reads in one pack
+template <typename Pack, typename Load>
+void loadPacks(StateRefMap<Pack> &packs, const std::set<UString> &packNames, const UString &kind,
+               const UString &packPath, Load load)
+{
+	std::set<UString> ids;
+	std::vector<UString> namesToLoad;
+	for (auto &packName : packNames)
 	{
-		LogInfo("Image packs are already loaded.");
-		return;
+		if (packName.length() == 0)
+			continue;
+		auto id = format("%s%s", Pack::getPrefix(), packName);
+		ids.insert(id);
+		if (packs.find(id) == packs.end())
+		{
+			namesToLoad.push_back(packName);
+		}
 	}
+	for (auto it = packs.begin(); it != packs.end();)
+	{
+		if (ids.find(it->first) == ids.end())
+		{
+			it = packs.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	LogInfo("Loading %u %ss, %u already loaded", (unsigned)namesToLoad.size(), kind,
+	        (unsigned)packs.size());
+
+	std::vector<sp<Pack>> loadedPacks(namesToLoad.size());
+	auto loadPack = [&](unsigned int index, unsigned int) {
+		auto &packName = namesToLoad[index];
+		auto path = packPath + "/" + packName;
+		LogInfo("Loading %s \"%s\" from \"%s\"", kind, packName, path);
+		auto pack = mksp<Pack>();
+		if (!load(*pack, path))
+		{
+			LogError("Failed to load %s \"%s\" from \"%s\"", kind, packName, path);
+			return;
+		}
+		loadedPacks[index] = pack;
+		LogInfo("Loaded %s \"%s\" from \"%s\"", kind, packName, path);
+	};
+	auto framework = Framework::tryGetInstance();
+	if (framework && namesToLoad.size() > 1)
+	{
+		framework->threadPoolParallelFor(namesToLoad.size(), loadPack);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < namesToLoad.size(); index++)
+		{
+			loadPack(index, 0);
+		}
+	}
+
+	for (unsigned int index = 0; index < namesToLoad.size(); index++)
+	{
+		if (loadedPacks[index])
+		{
+			packs[format("%s%s", Pack::getPrefix(), namesToLoad[index])] = loadedPacks[index];
+		}
+	}
+}
+
+} // anonymous namespace
+
+void Battle::loadImagePacks(GameState &state)
+{
 	// Find out all image packs used by map's units and items
 	std::set<UString> imagePacks;
 	UString brainsucker = "bsk";
@@ -3555,22 +4130,11 @@ void Battle::loadImagePacks(GameState &state)
 		}
 	}
 	// Load all used image packs
-	for (auto &imagePackName : imagePacks)
-	{
-		if (imagePackName.length() == 0)
-			continue;
-		auto imagePackPath = BattleUnitImagePack::getImagePackPath() + "/" + imagePackName;
-		LogInfo("Loading image pack \"%s\" from \"%s\"", imagePackName, imagePackPath);
-		auto imagePack = mksp<BattleUnitImagePack>();
-		if (!imagePack->loadImagePack(state, imagePackPath))
-		{
-			LogError("Failed to load image pack \"%s\" from \"%s\"", imagePackName, imagePackPath);
-			continue;
-		}
-		state.battle_unit_image_packs[format("%s%s", BattleUnitImagePack::getPrefix(),
-		                                     imagePackName)] = imagePack;
-		LogInfo("Loaded image pack \"%s\" from \"%s\"", imagePackName, imagePackPath);
-	}
+	loadPacks(state.battle_unit_image_packs, imagePacks, "image pack",
+	          BattleUnitImagePack::getImagePackPath(),
+	          [&state](BattleUnitImagePack &pack, const UString &path) {
+		          return pack.loadImagePack(state, path);
+		      });
 }
 
 void Battle::unloadImagePacks(GameState &state)
@@ -3581,11 +4145,6 @@ void Battle::unloadImagePacks(GameState &state)
 
 void Battle::loadAnimationPacks(GameState &state)
 {
-	if (state.battle_unit_animation_packs.size() > 0)
-	{
-		LogInfo("Animation packs are already loaded.");
-		return;
-	}
 	// Find out all animation packs used by units
 	std::set<UString> animationPacks;
 	UString brainsucker = "bsk";
@@ -3659,22 +4218,11 @@ void Battle::loadAnimationPacks(GameState &state)
 		}
 	}
 	// Load all used animation packs
-	for (auto &animationPackName : animationPacks)
-	{
-		auto animationPackPath =
-		    BattleUnitAnimationPack::getAnimationPackPath() + "/" + animationPackName;
-		LogInfo("Loading animation pack \"%s\" from \"%s\"", animationPackName, animationPackPath);
-		auto animationPack = mksp<BattleUnitAnimationPack>();
-		if (!animationPack->loadAnimationPack(state, animationPackPath))
-		{
-			LogError("Failed to load animation pack \"%s\" from \"%s\"", animationPackName,
-			         animationPackPath);
-			continue;
-		}
-		state.battle_unit_animation_packs[format("%s%s", BattleUnitAnimationPack::getPrefix(),
-		                                         animationPackName)] = animationPack;
-		LogInfo("Loaded animation pack \"%s\" from \"%s\"", animationPackName, animationPackPath);
-	}
+	loadPacks(state.battle_unit_animation_packs, animationPacks, "animation pack",
+	          BattleUnitAnimationPack::getAnimationPackPath(),
+	          [&state](BattleUnitAnimationPack &pack, const UString &path) {
+		          return pack.loadAnimationPack(state, path);
+		      });
 }
 
 void Battle::unloadAnimationPacks(GameState &state)
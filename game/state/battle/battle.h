@@ -7,11 +7,17 @@
 #include "game/state/rules/agenttype.h"
 #include "game/state/rules/battle/battlemapsector.h"
 #include "game/state/stateobject.h"
+#include "game/state/tilemap/pathfinding.h"
+#include "library/bitvector.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <set>
+#include <tuple>
 #include <vector>
 
 namespace OpenApoc
@@ -94,8 +100,8 @@ class Battle : public std::enable_shared_from_this<Battle>
 	StateRef<BattleMap> battle_map;
 
 	std::vector<sp<BattleMapSector::LineOfSightBlock>> losBlocks;
-	// Map of vectors of bools, one bool for every tile, denotes visible tiles (same indexing)
-	std::map<StateRef<Organisation>, std::vector<bool>> visibleTiles;
+	// Map of bit vectors, one bit for every tile, denotes visible tiles (same indexing)
+	std::map<StateRef<Organisation>, BitVector> visibleTiles;
 	// Map of vectors of bools, one bool for every los block, denotes visible blocks
 	std::map<StateRef<Organisation>, std::vector<bool>> visibleBlocks;
 	std::map<StateRef<Organisation>, std::set<StateRef<BattleUnit>>> visibleUnits;
@@ -122,6 +128,14 @@ class Battle : public std::enable_shared_from_this<Battle>
 	// Example: If there's a link update required between ids 2 and 3,
 	// we will set only [2 + 3 * size] to true
 	std::vector<bool> linkNeedsUpdate;
+	// Scratch storage for link updates, one per thread doing them (not serialized)
+	std::vector<PathfindingArena> linkPathfindingArenas;
+	// Tiles queued for pathfinding refresh, for units replanning incrementally (not serialized)
+	PathfindingChangeLog pathfindingChanges;
+	// For every kind of unit, which group of los blocks linked to each other directly or through
+	// others every block is in. Made again when asked for after linkCost changed (not serialized)
+	std::map<BattleUnitType, std::vector<int>> blockComponents;
+	bool blockComponentsNeedUpdate = true;
 
 	// Tiles that have something changed inside them and require to re-calculate vision
 	// of every soldier who has them in LOS. Triggers include:
@@ -144,11 +158,25 @@ class Battle : public std::enable_shared_from_this<Battle>
 	StateRef<Vehicle> player_craft;
 
 	std::list<sp<BattleMapPart>> map_parts;
+	// Not serialized, map parts that are falling, queued to collapse or animated, which are all
+	// of them that need updating. Built again in initBattle and added to as parts change
+	std::vector<sp<BattleMapPart>> activeMapParts;
 	std::list<sp<BattleItem>> items;
+	// Not serialized, items that are falling, collapsing or whose equipment needs updating, which
+	// are all of them that need updating. Built again in initBattle and added to as items are
+	// placed or start to fall or collapse
+	std::vector<sp<BattleItem>> activeItems;
 	StateRefMap<BattleUnit> units;
 	StateRefMap<BattleScanner> scanners;
+	// Not serialized, where units moved to since scanners last updated, and the batch of those
+	// that every scanner goes through in its update, swapped over when the scanners update
+	std::vector<Vec3<int>> pendingScannerMovements;
+	std::vector<Vec3<int>> scannerMovements;
 	std::list<sp<Doodad>> doodads;
 	std::set<sp<Projectile>> projectiles;
+	// Not serialized, projectiles that collided this update with whether to show the hit doodad
+	// and play its sound, kept between updates to reuse the memory
+	std::vector<std::tuple<sp<Projectile>, bool, bool>> deadProjectiles;
 	StateRefMap<BattleDoor> doors;
 	std::set<sp<BattleExplosion>> explosions;
 	std::set<sp<BattleHazard>> hazards;
@@ -159,6 +187,16 @@ class Battle : public std::enable_shared_from_this<Battle>
 	std::map<StateRef<Organisation>, int> leadershipBonus;
 
 	AIBlockTactical aiBlock;
+	// Not serialized, time unit AI has spent thinking since this update began, which
+	// AIBlockUnit::think keeps within its budget
+	std::chrono::steady_clock::duration aiThinkTime = {};
+	// Not serialized, when set the time taken by every group of update phases that runs together
+	// is added up here under the group's name, for tools that report where an update goes
+	bool timePhases = false;
+	// Not serialized, set while a turn ends and the next begins, when units only queue their own
+	// vision to be refreshed, for it to be done once for all of them when the turn has begun
+	bool batchingVisionRefreshes = false;
+	std::map<UString, std::chrono::steady_clock::duration> phaseTimes;
 
 	// Current player in control of the interface (will only change if we're going multiplayer)
 	StateRef<Organisation> currentPlayer;
@@ -224,13 +262,27 @@ class Battle : public std::enable_shared_from_this<Battle>
 	               bool useTeleporter = false);
 
 	int getLosBlockID(int x, int y, int z) const;
+	// False if nothing in the los block from can ever see anything in the los block to, as there
+	// is a whole level of floor between them
+	bool getLosBlocksMayBeVisible(int from, int to);
+	// False if every line of fire sampled from the los block from to the los block to hits a map
+	// part on the way, so that the AI can rule out lines between them without a ray of its own.
+	// Sampled the first time it is asked, and again once a map part between them changes. Safe to
+	// call from several threads at once
+	bool getLosBlocksMayHaveLine(int from, int to);
+	// True if the tile has a floor (or anything else) that no sight gets through from below to
+	// above it
+	bool getTileSealed(int x, int y, int z);
 	bool getVisible(StateRef<Organisation> org, int x, int y, int z) const;
 	void setVisible(StateRef<Organisation> org, int x, int y, int z, bool val = true);
+	// Sets every tile from start up to (but not including) end
+	void setVisibleBox(StateRef<Organisation> org, Vec3<int> start, Vec3<int> end,
+	                   bool val = true);
 
 	// Queue tile for vision update
 	void queueVisionRefresh(Vec3<int> tile);
 
-	// Notify scanners about movement at position
+	// Notify scanners about movement at position, which they see the next time they update
 	void notifyScanners(Vec3<int> position);
 
 	// Notify about action happening
@@ -254,6 +306,7 @@ class Battle : public std::enable_shared_from_this<Battle>
 	void updateTBEnd(GameState &state);
 
 	void updateProjectiles(GameState &state, unsigned int ticks);
+	// Refreshes the vision of units that queued it and of those that see changed tiles
 	void updateVision(GameState &state);
 	void updatePathfinding(GameState &state, unsigned int ticks);
 
@@ -338,6 +391,9 @@ class Battle : public std::enable_shared_from_this<Battle>
 	// Find path over the graph of los blocks
 	std::list<int> findLosBlockPath(int origin, int destination, BattleUnitType type,
 	                                int iterationLimit = 1000);
+	// Whether any path over the graph of los blocks goes from origin to destination, which
+	// findLosBlockPath would otherwise only find out by going through every block it can reach
+	bool getLosBlocksConnected(int origin, int destination, BattleUnitType type);
 
   private:
 	// The part of findShortestPath that uses LBs
@@ -356,6 +412,10 @@ class Battle : public std::enable_shared_from_this<Battle>
 	void loadAnimationPacks(GameState &state);
 	void unloadAnimationPacks(GameState &state);
 
+	// Has the sound backend ready the sounds the units and the battle itself are most likely to
+	// play, so that each one playing the first time does not have to
+	void prepareSamples(GameState &state);
+
 	friend class BattleMap;
 
   public:
@@ -392,6 +452,19 @@ class Battle : public std::enable_shared_from_this<Battle>
 	std::vector<int> losBlockRandomizer;
 	// Vector of indexes to los blocks, for each tile (index is like tile's location in tilemap)
 	std::vector<int> tileToLosBlock;
+	// For every level, number of tiles with a floor that blocks all sight through it among the
+	// tiles before each x and y, so that a rectangle of floor can be checked at once
+	// Not serialized, made again when queuePathfindingRefresh marks a level as changed
+	std::vector<std::vector<int>> sealedFloorCounts;
+	std::vector<bool> sealedFloorsNeedUpdate;
+	void updateSealedFloors(int z);
+	// For every pair of los blocks (from * losBlocks.size() + to), what getLosBlocksMayHaveLine
+	// found, or 0 if not asked yet. Not serialized, nothing being known after loading
+	up<std::atomic<uint8_t>[]> losBlockLines;
+	// Whether any sampled line of fire from the los block from to the los block to gets through
+	bool sampleLosBlockLines(int from, int to) const;
+	// Forgets blocked lines that pass by any of the tiles, as what blocked them may be gone
+	void forgetLosBlockLines(const std::set<Vec3<int>> &tiles);
 };
 
 }; // namespace OpenApoc
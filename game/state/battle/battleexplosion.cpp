@@ -49,16 +49,7 @@ void BattleExplosion::die(GameState &state)
 	auto &map = *state.current_battle->map;
 	for (auto &pos : locationsVisited)
 	{
-		auto tile = map.getTile(pos.x, pos.y, pos.z);
-		sp<BattleHazard> existingHazard;
-		for (auto &obj : tile->ownedObjects)
-		{
-			if (obj->getType() == TileObject::Type::Hazard)
-			{
-				existingHazard = std::static_pointer_cast<TileObjectBattleHazard>(obj)->getHazard();
-				break;
-			}
-		}
+		auto existingHazard = map.getTile(pos.x, pos.y, pos.z)->getHazardIfPresent();
 		if (existingHazard)
 		{
 			existingHazard->nextUpdateTicksAccumulated = 0;
@@ -182,68 +173,64 @@ void BattleExplosion::damage(GameState &state, const TileMap &map, Vec3<int> pos
 void BattleExplosion::expand(GameState &state, const TileMap &map, const Vec3<int> &from,
                              const Vec3<int> &to, int nextPower)
 {
-	// list of coordinates to check
-	static const std::map<Vec3<int>, std::list<std::pair<Vec3<int>, std::set<TileObject::Type>>>>
+	static const auto GROUND = TileObject::getTypeMask(TileObject::Type::Ground);
+	static const auto FEATURE = TileObject::getTypeMask(TileObject::Type::Feature);
+	static const auto LEFT_WALL = TileObject::getTypeMask(TileObject::Type::LeftWall);
+	static const auto RIGHT_WALL = TileObject::getTypeMask(TileObject::Type::RightWall);
+	// list of coordinates to check, with the types of map parts there that deplete the explosion
+	static const std::map<Vec3<int>, std::list<std::pair<Vec3<int>, TileObject::TypeMask>>>
 	    searchPattern = {
 	        // Vertical
-	        {{0, 0, 1}, {{{0, 0, 1}, {TileObject::Type::Ground, TileObject::Type::Feature}}}},
-	        {{0, 0, -1},
-	         {{{0, 0, 0}, {TileObject::Type::Ground}}, {{0, 0, -1}, {TileObject::Type::Feature}}}},
+	        {{0, 0, 1}, {{{0, 0, 1}, GROUND | FEATURE}}},
+	        {{0, 0, -1}, {{{0, 0, 0}, GROUND}, {{0, 0, -1}, FEATURE}}},
 	        // Horizontal direct
-	        {{0, -1, 0},
-	         {{{0, 0, 0}, {TileObject::Type::RightWall}},
-	          {{0, -1, 0}, {TileObject::Type::Feature}}}},
-	        {{0, 1, 0},
-	         {{{0, 1, 0}, {TileObject::Type::RightWall}},
-	          {{0, 1, 0}, {TileObject::Type::Feature}}}},
-	        {{-1, 0, 0},
-	         {{{0, 0, 0}, {TileObject::Type::LeftWall}},
-	          {{-1, 0, 0}, {TileObject::Type::Feature}}}},
-	        {{1, 0, 0},
-	         {{{1, 0, 0}, {TileObject::Type::LeftWall}}, {{1, 0, 0}, {TileObject::Type::Feature}}}},
+	        {{0, -1, 0}, {{{0, 0, 0}, RIGHT_WALL}, {{0, -1, 0}, FEATURE}}},
+	        {{0, 1, 0}, {{{0, 1, 0}, RIGHT_WALL}, {{0, 1, 0}, FEATURE}}},
+	        {{-1, 0, 0}, {{{0, 0, 0}, LEFT_WALL}, {{-1, 0, 0}, FEATURE}}},
+	        {{1, 0, 0}, {{{1, 0, 0}, LEFT_WALL}, {{1, 0, 0}, FEATURE}}},
 	        // Horizontal top-left
 	        {{-1, -1, 0},
 	         {
-	             {{-1, -1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, -1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 0, 0}, {TileObject::Type::RightWall}},
-	             {{0, -1, 0}, {TileObject::Type::LeftWall}},
-	             {{0, 0, 0}, {TileObject::Type::RightWall}},
-	             {{0, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{-1, -1, 0}, FEATURE},
+	             {{-1, 0, 0}, FEATURE},
+	             {{0, -1, 0}, FEATURE},
+	             {{-1, 0, 0}, RIGHT_WALL},
+	             {{0, -1, 0}, LEFT_WALL},
+	             {{0, 0, 0}, RIGHT_WALL},
+	             {{0, 0, 0}, LEFT_WALL},
 	         }},
 	        // Horizontal bottom-right
 	        {{1, 1, 0},
 	         {
-	             {{1, 1, 0}, {TileObject::Type::Feature}},
-	             {{0, 1, 0}, {TileObject::Type::Feature}},
-	             {{1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, 1, 0}, {TileObject::Type::RightWall}},
-	             {{1, 0, 0}, {TileObject::Type::LeftWall}},
-	             {{1, 1, 0}, {TileObject::Type::RightWall}},
-	             {{1, 1, 0}, {TileObject::Type::LeftWall}},
+	             {{1, 1, 0}, FEATURE},
+	             {{0, 1, 0}, FEATURE},
+	             {{1, 0, 0}, FEATURE},
+	             {{0, 1, 0}, RIGHT_WALL},
+	             {{1, 0, 0}, LEFT_WALL},
+	             {{1, 1, 0}, RIGHT_WALL},
+	             {{1, 1, 0}, LEFT_WALL},
 	         }},
 	        // Horizontal top-right
 	        {{1, -1, 0},
 	         {
-	             {{1, -1, 0}, {TileObject::Type::Feature}},
-	             {{1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, -1, 0}, {TileObject::Type::Feature}},
-	             {{0, 0, 0}, {TileObject::Type::RightWall}},
-	             {{1, -1, 0}, {TileObject::Type::LeftWall}},
-	             {{1, 0, 0}, {TileObject::Type::RightWall}},
-	             {{1, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{1, -1, 0}, FEATURE},
+	             {{1, 0, 0}, FEATURE},
+	             {{0, -1, 0}, FEATURE},
+	             {{0, 0, 0}, RIGHT_WALL},
+	             {{1, -1, 0}, LEFT_WALL},
+	             {{1, 0, 0}, RIGHT_WALL},
+	             {{1, 0, 0}, LEFT_WALL},
 	         }},
 	        // Horizontal bottom-left
 	        {{-1, 1, 0},
 	         {
-	             {{-1, 1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, 1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 1, 0}, {TileObject::Type::RightWall}},
-	             {{0, 0, 0}, {TileObject::Type::LeftWall}},
-	             {{0, 1, 0}, {TileObject::Type::RightWall}},
-	             {{0, 1, 0}, {TileObject::Type::LeftWall}},
+	             {{-1, 1, 0}, FEATURE},
+	             {{-1, 0, 0}, FEATURE},
+	             {{0, 1, 0}, FEATURE},
+	             {{-1, 1, 0}, RIGHT_WALL},
+	             {{0, 0, 0}, LEFT_WALL},
+	             {{0, 1, 0}, RIGHT_WALL},
+	             {{0, 1, 0}, LEFT_WALL},
 	         }},
 	    };
 
@@ -255,6 +242,7 @@ void BattleExplosion::expand(GameState &state, const TileMap &map, const Vec3<in
 	}
 	locationsVisited.insert(to);
 	auto dir = to - from;
+	auto blockType = damageType->blockType;
 	int depletionThis = 0;
 	int depletionNext = 0;
 
@@ -265,11 +253,11 @@ void BattleExplosion::expand(GameState &state, const TileMap &map, const Vec3<in
 		auto tile = map.getTile(pos);
 		for (auto &obj : tile->ownedObjects)
 		{
-			if (pair.second.find(obj->getType()) != pair.second.end())
+			if (pair.second & TileObject::getTypeMask(obj->getType()))
 			{
 				auto mp = std::static_pointer_cast<TileObjectBattleMapPart>(obj)->getOwner();
 
-				int depletion = 2 * mp->type->block[damageType->blockType];
+				int depletion = 2 * mp->type->block[blockType];
 
 				depletionNext = std::max(depletionNext, depletion);
 				// Feature in target tile does not block damage to the tile
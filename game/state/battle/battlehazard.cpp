@@ -59,70 +59,70 @@ bool BattleHazard::expand(GameState &state, const TileMap &map, const Vec3<int>
                           bool fireSmoke)
 {
 	// list of coordinates to check
-	static const std::map<Vec3<int>, std::list<std::pair<Vec3<int>, std::set<TileObject::Type>>>>
+	static const std::map<Vec3<int>, std::list<std::pair<Vec3<int>, TileObject::Type>>>
 	    searchPattern = {
 	        // Vertical
-	        {{0, 0, 1}, {{{0, 0, 1}, {TileObject::Type::Ground}}}},
+	        {{0, 0, 1}, {{{0, 0, 1}, TileObject::Type::Ground}}},
 	        {{0, 0, -1},
 	         {
-	             {{0, 0, 0}, {TileObject::Type::Ground}},
+	             {{0, 0, 0}, TileObject::Type::Ground},
 	         }},
 	        // Horizontal direct
 	        {{0, -1, 0},
 	         {
-	             {{0, 0, 0}, {TileObject::Type::RightWall}},
+	             {{0, 0, 0}, TileObject::Type::RightWall},
 	         }},
 	        {{0, 1, 0},
 	         {
-	             {{0, 1, 0}, {TileObject::Type::RightWall}},
+	             {{0, 1, 0}, TileObject::Type::RightWall},
 	         }},
 	        {{-1, 0, 0},
 	         {
-	             {{0, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{0, 0, 0}, TileObject::Type::LeftWall},
 	         }},
 	        {{1, 0, 0},
 	         {
-	             {{1, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{1, 0, 0}, TileObject::Type::LeftWall},
 	         }},
 	        // Horizontal top-left
 	        {{-1, -1, 0},
 	         {
-	             {{-1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, -1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 0, 0}, {TileObject::Type::RightWall}},
-	             {{0, -1, 0}, {TileObject::Type::LeftWall}},
-	             {{0, 0, 0}, {TileObject::Type::RightWall}},
-	             {{0, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{-1, 0, 0}, TileObject::Type::Feature},
+	             {{0, -1, 0}, TileObject::Type::Feature},
+	             {{-1, 0, 0}, TileObject::Type::RightWall},
+	             {{0, -1, 0}, TileObject::Type::LeftWall},
+	             {{0, 0, 0}, TileObject::Type::RightWall},
+	             {{0, 0, 0}, TileObject::Type::LeftWall},
 	         }},
 	        // Horizontal bottom-right
 	        {{1, 1, 0},
 	         {
-	             {{0, 1, 0}, {TileObject::Type::Feature}},
-	             {{1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, 1, 0}, {TileObject::Type::RightWall}},
-	             {{1, 0, 0}, {TileObject::Type::LeftWall}},
-	             {{1, 1, 0}, {TileObject::Type::RightWall}},
-	             {{1, 1, 0}, {TileObject::Type::LeftWall}},
+	             {{0, 1, 0}, TileObject::Type::Feature},
+	             {{1, 0, 0}, TileObject::Type::Feature},
+	             {{0, 1, 0}, TileObject::Type::RightWall},
+	             {{1, 0, 0}, TileObject::Type::LeftWall},
+	             {{1, 1, 0}, TileObject::Type::RightWall},
+	             {{1, 1, 0}, TileObject::Type::LeftWall},
 	         }},
 	        // Horizontal top-right
 	        {{1, -1, 0},
 	         {
-	             {{1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, -1, 0}, {TileObject::Type::Feature}},
-	             {{0, 0, 0}, {TileObject::Type::RightWall}},
-	             {{1, -1, 0}, {TileObject::Type::LeftWall}},
-	             {{1, 0, 0}, {TileObject::Type::RightWall}},
-	             {{1, 0, 0}, {TileObject::Type::LeftWall}},
+	             {{1, 0, 0}, TileObject::Type::Feature},
+	             {{0, -1, 0}, TileObject::Type::Feature},
+	             {{0, 0, 0}, TileObject::Type::RightWall},
+	             {{1, -1, 0}, TileObject::Type::LeftWall},
+	             {{1, 0, 0}, TileObject::Type::RightWall},
+	             {{1, 0, 0}, TileObject::Type::LeftWall},
 	         }},
 	        // Horizontal bottom-left
 	        {{-1, 1, 0},
 	         {
-	             {{-1, 0, 0}, {TileObject::Type::Feature}},
-	             {{0, 1, 0}, {TileObject::Type::Feature}},
-	             {{-1, 1, 0}, {TileObject::Type::RightWall}},
-	             {{0, 0, 0}, {TileObject::Type::LeftWall}},
-	             {{0, 1, 0}, {TileObject::Type::RightWall}},
-	             {{0, 1, 0}, {TileObject::Type::LeftWall}},
+	             {{-1, 0, 0}, TileObject::Type::Feature},
+	             {{0, 1, 0}, TileObject::Type::Feature},
+	             {{-1, 1, 0}, TileObject::Type::RightWall},
+	             {{0, 0, 0}, TileObject::Type::LeftWall},
+	             {{0, 1, 0}, TileObject::Type::RightWall},
+	             {{0, 1, 0}, TileObject::Type::LeftWall},
 	         }},
 	    };
 
@@ -144,24 +144,18 @@ bool BattleHazard::expand(GameState &state, const TileMap &map, const Vec3<int>
 
 	// Ensure no hazard already there
 
-	sp<BattleHazard> existingHazard;
 	bool replaceWeaker = false;
 	auto targetTile = map.getTile(to.x, to.y, to.z);
-	for (auto &obj : targetTile->ownedObjects)
+	auto existingHazard = targetTile->getHazardIfPresent();
+	if (existingHazard)
 	{
-		if (obj->getType() == TileObject::Type::Hazard)
+		// Replace weaker hazards (if not smoke from fire or fire itself)
+		// Replace non-fire hazards if fire
+		if ((hazardType->fire && !fireSmoke && existingHazard->damageType != spreadDamageType) ||
+		    (!hazardType->fire && existingHazard->damageType == spreadDamageType &&
+		     existingHazard->lifetime - existingHazard->age < ttl))
 		{
-			existingHazard = std::static_pointer_cast<TileObjectBattleHazard>(obj)->getHazard();
-			// Replace weaker hazards (if not smoke from fire or fire itself)
-			// Replace non-fire hazards if fire
-			if ((hazardType->fire && !fireSmoke &&
-			     existingHazard->damageType != spreadDamageType) ||
-			    (!hazardType->fire && existingHazard->damageType == spreadDamageType &&
-			     existingHazard->lifetime - existingHazard->age < ttl))
-			{
-				replaceWeaker = true;
-			}
-			break;
+			replaceWeaker = true;
 		}
 	}
 	if (!replaceWeaker && existingHazard)
@@ -179,7 +173,7 @@ bool BattleHazard::expand(GameState &state, const TileMap &map, const Vec3<int>
 		auto tile = map.getTile(pos);
 		for (auto &obj : tile->ownedObjects)
 		{
-			if (pair.second.find(obj->getType()) != pair.second.end())
+			if (obj->getType() == pair.second)
 			{
 				auto mp = std::static_pointer_cast<TileObjectBattleMapPart>(obj)->getOwner();
 				block = std::max(block, mp->type->block[spreadDamageType->blockType]);
@@ -76,6 +76,7 @@ void BattleItem::hopTo(GameState &state, Vec3<float> targetPosition)
 	if (distance > 1)
 	{
 		falling = true;
+		activate();
 		velocity = (glm::normalize(Vec3<float>{targetVector.x, targetVector.y, 0.0f}) * velXY +
 		            Vec3<float>{0.0f, 0.0f, velZ}) *
 		           VELOCITY_SCALE_BATTLE;
@@ -144,14 +145,21 @@ Collision BattleItem::checkItemCollision(Vec3<float> previousPosition, Vec3<floa
 {
 	if (collisionIgnoredTicks > 0)
 		return {};
-	Collision c = tileObject->map.findCollision(
-	    previousPosition, nextPosition, {},
-	    ownerInvulnerableTicks > 0 ? item->ownerUnit->tileObject : nullptr);
-	return c;
+	CollisionOptions options;
+	if (ownerInvulnerableTicks > 0)
+	{
+		options.ignoredObject = item->ownerUnit->tileObject;
+	}
+	return tileObject->map.findCollision(previousPosition, nextPosition, options);
 }
 
 void BattleItem::updateTB(GameState &state) { item->updateTB(state); }
 
+bool BattleItem::needsUpdate() const
+{
+	return falling || ticksUntilCollapse > 0 || item->needsUpdate();
+}
+
 void BattleItem::update(GameState &state, unsigned int ticks)
 {
 	item->update(state, ticks);
@@ -344,9 +352,25 @@ void BattleItem::tryCollapse()
 	if (!findSupport())
 	{
 		ticksUntilCollapse = TICKS_MULTIPLIER;
+		activate();
 	}
 }
 
-void BattleItem::collapse() { falling = true; }
+void BattleItem::collapse()
+{
+	falling = true;
+	activate();
+}
+
+void BattleItem::activate()
+{
+	auto b = battle.lock();
+	if (active || !b)
+	{
+		return;
+	}
+	active = true;
+	b->activeItems.push_back(shared_from_this());
+}
 
 } // namespace OpenApoc
@@ -61,6 +61,8 @@ class BattleItem : public std::enable_shared_from_this<BattleItem>
 
 	void update(GameState &state, unsigned int ticks);
 	void updateTB(GameState &state);
+	// Whether update() has anything to do, which it doesn't for an item lying still
+	bool needsUpdate() const;
 
 	BattleItem() = default;
 	~BattleItem() = default;
@@ -78,5 +80,10 @@ class BattleItem : public std::enable_shared_from_this<BattleItem>
 
 	sp<TileObjectBattleItem> tileObject;
 	sp<TileObjectShadow> shadowObject;
+	wp<Battle> battle;
+	// Set while the item is in its battle's activeItems
+	bool active = false;
+	// Puts the item in its battle's activeItems, for when it starts falling or collapsing
+	void activate();
 };
 } // namespace OpenApoc
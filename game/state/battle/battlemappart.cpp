@@ -71,6 +71,7 @@ void BattleMapPart::die(GameState &state, bool explosive, bool violently)
 		{
 			this->type = type->damaged_map_part;
 			this->damaged = true;
+			activate();
 		}
 		// Destroy
 		else
@@ -81,6 +82,7 @@ void BattleMapPart::die(GameState &state, bool explosive, bool violently)
 			{
 				this->damaged = true;
 				this->type = type->destroyed_ground_tile;
+				activate();
 			}
 			// Destroy map part
 			else
@@ -99,6 +101,7 @@ void BattleMapPart::die(GameState &state, bool explosive, bool violently)
 		// Queue updates
 		state.current_battle->queueVisionRefresh(position);
 		state.current_battle->queuePathfindingRefresh(position);
+		tileObject->notifyDrawnChange();
 
 		// Cease functioning
 		ceaseBeingSupported();
@@ -238,6 +241,12 @@ void BattleMapPart::ceaseDoorFunction()
 		return false;
 	});
 	door.clear();
+	if (tileObject)
+	{
+		tileObject->notifyDrawnChange();
+	}
+	// May be animated now it is no longer a door
+	activate();
 }
 
 bool BattleMapPart::attachToSomething(bool checkType, bool checkHard)
@@ -1078,10 +1087,13 @@ void BattleMapPart::collapse(GameState &state)
 	{
 		this->damaged = true;
 		this->type = type->destroyed_ground_tile;
+		tileObject->notifyDrawnChange();
+		activate();
 	}
 	else
 	{
 		falling = true;
+		activate();
 		state.current_battle->queueVisionRefresh(position);
 		state.current_battle->queuePathfindingRefresh(position);
 		// Note: Pathfinding refresh relies on tile's battlescape parameters being updated
@@ -1133,6 +1145,22 @@ void BattleMapPart::update(GameState &state, unsigned int ticks)
 	}
 }
 
+bool BattleMapPart::needsUpdate() const
+{
+	return falling || ticksUntilCollapse > 0 || (!door && type->animation_frames.size() > 0);
+}
+
+void BattleMapPart::activate()
+{
+	auto b = battle.lock();
+	if (active || !b)
+	{
+		return;
+	}
+	active = true;
+	b->activeMapParts.push_back(shared_from_this());
+}
+
 void BattleMapPart::updateFalling(GameState &state, unsigned int ticks)
 {
 	auto fallTicksRemaining = ticks;
@@ -1147,7 +1175,9 @@ void BattleMapPart::updateFalling(GameState &state, unsigned int ticks)
 	if (newPosition.z < 0 || floorf(newPosition.z) != floorf(position.z))
 	{
 		sp<BattleMapPart> rubble;
-		for (auto &obj : tileObject->getOwningTile()->ownedObjects)
+		// Units hurt here may die and drop what they carry onto the tile
+		auto objects = tileObject->getOwningTile()->ownedObjects;
+		for (auto &obj : objects)
 		{
 			switch (obj->getType())
 			{
@@ -1223,8 +1253,10 @@ void BattleMapPart::updateFalling(GameState &state, unsigned int ticks)
 					rubble->position = initialPosition;
 					rubble->position += Vec3<float>(0.5f, 0.5f, 0.0f);
 					rubble->type = type->rubble.front();
+					rubble->battle = battle;
 					state.current_battle->map_parts.push_back(rubble);
 					state.current_battle->map->addObjectToMap(rubble);
+					rubble->activate();
 				}
 				else
 				{
@@ -1234,6 +1266,7 @@ void BattleMapPart::updateFalling(GameState &state, unsigned int ticks)
 					{
 						rubble->type = *it;
 						rubble->setPosition(state, rubble->position);
+						rubble->activate();
 					}
 				}
 			}
@@ -1279,6 +1312,7 @@ void BattleMapPart::queueCollapse(unsigned additionalDelay)
 {
 	ticksUntilCollapse = TICKS_MULTIPLIER + additionalDelay;
 	providesHardSupport = false;
+	activate();
 }
 
 void BattleMapPart::cancelCollapse() { ticksUntilCollapse = 0; }
@@ -70,6 +70,9 @@ class BattleMapPart : public SupportedMapPart, public std::enable_shared_from_th
 
 	void update(GameState &state, unsigned int ticks);
 	void updateFalling(GameState &state, unsigned int ticks);
+	// Whether update() has anything to do, which it doesn't for a part that is neither falling,
+	// queued to collapse nor animated
+	bool needsUpdate() const;
 
 	bool isAlive() const;
 
@@ -78,6 +81,11 @@ class BattleMapPart : public SupportedMapPart, public std::enable_shared_from_th
 	// Following members are not serialized, but rather are set in initBattle method
 
 	sp<TileObjectBattleMapPart> tileObject;
+	wp<Battle> battle;
+	// Set while the part is in its battle's activeMapParts
+	bool active = false;
+	// Puts the part in its battle's activeMapParts, for when it may have started to need updates
+	void activate();
 
   private:
 	friend class Battle;
@@ -1,6 +1,8 @@
 #include "game/state/battle/battlescanner.h"
 #include "game/state/battle/battleunit.h"
 #include "game/state/gamestate.h"
+#include "game/state/tilemap/tilemap.h"
+#include "game/state/tilemap/tileobject_battleunit.h"
 
 namespace OpenApoc
 {
@@ -37,17 +39,29 @@ void BattleScanner::update(GameState &state, unsigned int ticks)
 {
 	static const Vec3<int> midPos = {MOTION_SCANNER_X / 2, MOTION_SCANNER_Y / 2, 0};
 
+	// Seen where the holder was when they happened, as if notified right then
+	for (auto &position : state.current_battle->scannerMovements)
+	{
+		notifyMovement(position);
+	}
+
 	updateTicksAccumulated += ticks;
 	bool changed = false;
 	while (updateTicksAccumulated >= TICKS_PER_SCANNER_UPDATE)
 	{
 		updateTicksAccumulated -= TICKS_PER_SCANNER_UPDATE;
+		if (!anyLit)
+		{
+			continue;
+		}
+		anyLit = false;
 		for (size_t i = 0; i < movementTicks.size(); i++)
 		{
 			if (movementTicks[i] > TICKS_PER_SCANNER_UPDATE)
 			{
 				movementTicks[i] -= TICKS_PER_SCANNER_UPDATE;
 				changed = true;
+				anyLit = true;
 			}
 			else if (movementTicks[i] > 0)
 			{
@@ -81,20 +95,29 @@ void BattleScanner::update(GameState &state, unsigned int ticks)
 		    }
 		}*/
 
-		// Introduce movement ticks for every unit
-		for (auto &u : state.current_battle->units)
-		{
-			if (u.second->destroyed)
+		// Introduce movement ticks for every unit within range
+		auto &map = *state.current_battle->map;
+		Vec3<int> min = {newPosition.x - midPos.x, newPosition.y - midPos.y, 0};
+		Vec3<int> max = {min.x + MOTION_SCANNER_X - 1, min.y + MOTION_SCANNER_Y - 1,
+		                 map.size.z - 1};
+		map.forEachUnitOrItemIn(min, max, [&](const sp<TileObject> &object) {
+			if (object->getType() != TileObject::Type::Unit)
+			{
+				return;
+			}
+			auto u = std::static_pointer_cast<TileObjectBattleUnit>(object)->getUnit();
+			if (!u || u->destroyed)
 			{
-				continue;
+				return;
 			}
-			auto pos = (Vec3<int>)u.second->position - newPosition + midPos;
+			auto pos = (Vec3<int>)u->position - newPosition + midPos;
 			if (pos.x < 0 || pos.y < 0 || pos.x >= MOTION_SCANNER_X || pos.y >= MOTION_SCANNER_Y)
 			{
-				continue;
+				return;
 			}
 			movementTicks[pos.y * MOTION_SCANNER_X + pos.x] = TICKS_SCANNER_REMAIN_LIT;
-		}
+			anyLit = true;
+		});
 
 		lastPosition = holder->position;
 	}
@@ -117,5 +140,6 @@ void BattleScanner::notifyMovement(Vec3<int> position)
 	}
 	version++;
 	movementTicks[pos.y * MOTION_SCANNER_X + pos.x] = TICKS_SCANNER_REMAIN_LIT;
+	anyLit = true;
 }
 }
\ No newline at end of file
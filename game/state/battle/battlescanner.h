@@ -36,7 +36,11 @@ class BattleScanner : public StateObject
 	unsigned int updateTicksAccumulated = 0;
 	Vec3<int> lastPosition;
 	StateRef<BattleUnit> holder;
+	// Not serialized, cleared once a fade leaves no dot lit, so that scanners with nothing around
+	// them skip going through the map. Set on load, when which are lit is not yet known
+	bool anyLit = true;
 
+	// Goes through the movements notified since the last update before fading the dots
 	void update(GameState &state, unsigned int ticks);
 	void notifyMovement(Vec3<int> position);
 };
@@ -19,7 +19,9 @@
 #include "game/state/tilemap/collision.h"
 #include "game/state/tilemap/tileobject_battleunit.h"
 #include "game/state/tilemap/tileobject_shadow.h"
+#include "library/batchgeometry.h"
 #include "library/line.h"
+#include "library/shadowcast.h"
 #include "library/strings_format.h"
 #include <algorithm>
 #include <cmath>
@@ -31,10 +33,12 @@ namespace OpenApoc
 
 namespace
 {
-static const std::set<TileObject::Type> mapPartSet = {
-    TileObject::Type::Ground, TileObject::Type::LeftWall, TileObject::Type::RightWall,
-    TileObject::Type::Feature};
-static const std::set<TileObject::Type> unitSet = {TileObject::Type::Unit};
+static constexpr TileObject::TypeMask mapPartTypes =
+    TileObject::getTypeMask(TileObject::Type::Ground) |
+    TileObject::getTypeMask(TileObject::Type::LeftWall) |
+    TileObject::getTypeMask(TileObject::Type::RightWall) |
+    TileObject::getTypeMask(TileObject::Type::Feature);
+static constexpr TileObject::TypeMask unitTypes = TileObject::getTypeMask(TileObject::Type::Unit);
 }
 
 namespace
@@ -256,14 +260,19 @@ void BattleUnit::refreshUnitVisibility(GameState &state)
 
 bool BattleUnit::isWithinVision(Vec3<int> pos)
 {
-	auto diff = pos - (Vec3<int>)position;
+	// Static units have 360 vision
+	return isWithinVisionCone(pos - (Vec3<int>)position, facing,
+	                          agent->type->bodyType->allowed_movement_states.size() == 1);
+}
+
+bool BattleUnit::isWithinVisionCone(Vec3<int> diff, Vec2<int> facing, bool allRound)
+{
 	// Distance quick check
 	if (diff.x * diff.x + diff.y * diff.y > VIEW_DISTANCE * VIEW_DISTANCE)
 	{
 		return false;
 	}
-	// Static units have 360 vision
-	if (agent->type->bodyType->allowed_movement_states.size() == 1)
+	if (allRound)
 	{
 		return true;
 	}
@@ -304,8 +313,80 @@ bool BattleUnit::isWithinVision(Vec3<int> pos)
 	return true;
 }
 
+void BattleUnit::keepWithinVisionCone(const PositionBatch<int> &positions, Vec3<int> from,
+                                      Vec2<int> facing, bool allRound, uint8_t *keep)
+{
+	const int *x = positions.x.data();
+	const int *y = positions.y.data();
+	// Facing along one of the axes narrows the cone beyond which side the position is on
+	bool alongX = facing.x != 0 && facing.y == 0;
+	bool alongY = facing.x == 0 && facing.y != 0;
+	// The checks are the same as isWithinVisionCone's, but all made and put together without
+	// branching for the loop to vectorise
+	size_t count = positions.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		int dx = x[i] - from.x;
+		int dy = y[i] - from.y;
+		int absX = std::abs(dx);
+		int absY = std::abs(dy);
+		bool inRange = dx * dx + dy * dy <= VIEW_DISTANCE * VIEW_DISTANCE;
+		bool rightSide = (dx * facing.x >= 0) & (dy * facing.y >= 0);
+		bool inCone = (!alongX | (absX >= absY)) & (!alongY | (absX <= absY));
+		keep[i] &= (inRange & (allRound | (rightSide & inCone))) ? 1 : 0;
+	}
+}
+
+BattleUnit::VisionHotData BattleUnit::getVisionHotData()
+{
+	VisionHotData data;
+	data.unit = this;
+	data.owner = owner.operator->();
+	data.position = position;
+	data.facing = facing;
+	data.conscious = isConscious();
+	// Static units have 360 vision
+	data.allRound = agent->type->bodyType->allowed_movement_states.size() == 1;
+	return data;
+}
+
+Rect<int> BattleUnit::getVisionBounds()
+{
+	Vec3<int> pos = position;
+	Rect<int> bounds{pos.x - VIEW_DISTANCE, pos.y - VIEW_DISTANCE, pos.x + VIEW_DISTANCE + 1,
+	                 pos.y + VIEW_DISTANCE + 1};
+	// Static units have 360 vision
+	if (agent->type->bodyType->allowed_movement_states.size() == 1)
+	{
+		return bounds;
+	}
+	// Only the side we're facing, same as isWithinVision
+	if (facing.x > 0)
+	{
+		bounds.p0.x = pos.x;
+	}
+	else if (facing.x < 0)
+	{
+		bounds.p1.x = pos.x + 1;
+	}
+	if (facing.y > 0)
+	{
+		bounds.p0.y = pos.y;
+	}
+	else if (facing.y < 0)
+	{
+		bounds.p1.y = pos.y + 1;
+	}
+	return bounds;
+}
+
 void BattleUnit::calculateVisionToTerrain(GameState &state)
 {
+	if (config().getBool("OpenApoc.NewFeature.ShadowcastVision"))
+	{
+		calculateVisionToTilesShadowcast(state);
+		return;
+	}
 	auto &battle = *state.current_battle;
 
 	static const int lazyLimit = 5 * 9;
@@ -321,6 +402,11 @@ void BattleUnit::calculateVisionToTerrain(GameState &state)
 			discoveredBlocks.insert(idx);
 		}
 	}
+	// Block our eyes are in, as tall units can look out of the block they stand in
+	Vec3<int> eyesTile = getEyeLocation();
+	eyesTile = {clamp(eyesTile.x, 0, battle.size.x - 1), clamp(eyesTile.y, 0, battle.size.y - 1),
+	            clamp(eyesTile.z, 0, battle.size.z - 1)};
+	auto eyesBlock = battle.getLosBlockID(eyesTile.x, eyesTile.y, eyesTile.z);
 
 	auto blocksToCheck = std::set<int>();
 	int totalChecks = 0;
@@ -332,6 +418,11 @@ void BattleUnit::calculateVisionToTerrain(GameState &state)
 		{
 			continue;
 		}
+		// Block can't be seen from here whatever we do
+		if (!battle.getLosBlocksMayBeVisible(eyesBlock, idx))
+		{
+			continue;
+		}
 
 		totalChecks++;
 		blocksToCheck.insert(idx);
@@ -354,16 +445,7 @@ void BattleUnit::calculateVisionToTerrain(GameState &state)
 	for (auto &idx : discoveredBlocks)
 	{
 		auto l = battle.losBlocks.at(idx);
-		for (int x = l->start.x; x < l->end.x; x++)
-		{
-			for (int y = l->start.y; y < l->end.y; y++)
-			{
-				for (int z = l->start.z; z < l->end.z; z++)
-				{
-					battle.setVisible(owner, x, y, z);
-				}
-			}
-		}
+		battle.setVisibleBox(owner, l->start, l->end);
 	}
 }
 
@@ -442,8 +524,13 @@ void BattleUnit::calculateVisionToLosBlocks(GameState &state, std::set<int> &dis
 		// If target is found then we can try to los to this block
 		if (targetFound)
 		{
-			auto c = map.findCollision(eyesPos, {target.x + 0.5f, target.y + 0.5f, target.z + 0.5f},
-			                           mapPartSet, tileObject, true, false, VIEW_DISTANCE);
+			CollisionOptions options;
+			options.validTypes = mapPartTypes;
+			options.ignoredObject = tileObject;
+			options.useLOS = true;
+			options.maxRange = VIEW_DISTANCE;
+			auto c = map.findCollision(
+			    eyesPos, {target.x + 0.5f, target.y + 0.5f, target.z + 0.5f}, options);
 
 			// FIXME: Handle collisions with left/right/ground that prevent seeing inside
 			// If going positive on axes, we must shorten our beam a little bit, so that if
@@ -481,6 +568,7 @@ void BattleUnit::calculateVisionToLosBlocksLazy(GameState &state, std::set<int>
 	// Value for the coordinate which is zero in the facing (Y if facing along X etc.)
 	static const std::vector<float> dirTarget = {-0.82f, -0.45f, 0.0f, 0.45f, 0.82f};
 
+	std::vector<std::pair<Vec3<float>, Vec3<float>>> beams;
 	for (int z = 0; z < 9; z++)
 	{
 		for (int xy = 0; xy < 5; xy++)
@@ -503,18 +591,237 @@ void BattleUnit::calculateVisionToLosBlocksLazy(GameState &state, std::set<int>
 				                (float)facing.y * zTarget.at(z).x, zTarget.at(z).y};
 			}
 			targetVector = glm::normalize(targetVector) * (float)VIEW_DISTANCE;
+			beams.emplace_back(eyesPos, eyesPos + targetVector);
+		}
+	}
+
+	CollisionOptions options;
+	options.validTypes = mapPartTypes;
+	options.ignoredObject = tileObject;
+	options.useLOS = true;
+	options.maxRange = VIEW_DISTANCE;
+	// Kept for the next unit this thread works out the vision of, so the beams allocate nothing.
+	// Taken out while in use, in case waiting on the beams runs another unit's vision here
+	static thread_local std::vector<Collision> threadCollisions;
+	static thread_local std::vector<std::vector<Vec3<int>>> threadPassedTiles;
+	std::vector<Collision> collisions;
+	std::vector<std::vector<Vec3<int>>> passedTiles;
+	collisions.swap(threadCollisions);
+	passedTiles.swap(threadPassedTiles);
+	map.findCollisions(beams, options, collisions, &passedTiles);
+	for (auto &tiles : passedTiles)
+	{
+		for (auto &t : tiles)
+		{
+			auto idx = tileToLosBlock.at(t.z * battle.size.x * battle.size.y +
+			                             t.y * battle.size.x + t.x);
+			if (!visibleBlocks.at(idx))
+			{
+				visibleBlocks.at(idx) = true;
+				discoveredBlocks.insert(idx);
+			}
+		}
+	}
+	// Only the memory is kept, not the objects hit
+	collisions.clear();
+	threadCollisions.swap(collisions);
+	threadPassedTiles.swap(passedTiles);
+}
 
-			auto c = map.findCollision(eyesPos, eyesPos + targetVector, mapPartSet, tileObject,
-			                           true, false, VIEW_DISTANCE, true);
+void BattleUnit::calculateVisionToTilesShadowcast(GameState &state)
+{
+	auto &battle = *state.current_battle;
+	auto &map = *battle.map;
+
+	Vec3<int> voxelSize = map.voxelMapSize;
+	Vec3<int> eyesVoxel = getEyeLocation() * Vec3<float>{voxelSize};
+	eyesVoxel = {clamp(eyesVoxel.x, 0, battle.size.x * voxelSize.x - 1),
+	             clamp(eyesVoxel.y, 0, battle.size.y * voxelSize.y - 1),
+	             clamp(eyesVoxel.z, 0, battle.size.z * voxelSize.z - 1)};
+	Vec3<int> eyesTile = eyesVoxel / voxelSize;
+
+	// Everything within sight, along with the tiles next to it, fits in a square this wide
+	static const int side = 2 * VIEW_DISTANCE + 3;
+	auto getIndex = [&eyesTile](int x, int y) {
+		x += VIEW_DISTANCE + 1 - eyesTile.x;
+		y += VIEW_DISTANCE + 1 - eyesTile.y;
+		return x >= 0 && x < side && y >= 0 && y < side ? y * side + x : -1;
+	};
+
+	// Which sides of a tile are walled at the height of our eyes, and if it's blocked inside,
+	// worked out by looking at a few voxels along each side the first time it's needed
+	static const int blocksWest = 1;
+	static const int blocksEast = 2;
+	static const int blocksNorth = 4;
+	static const int blocksSouth = 8;
+	static const int blocksInside = 16;
+	static const int notKnown = -1;
+	std::vector<int> tileSides(side * side, notKnown);
+	auto getSides = [&](int x, int y) -> int {
+		auto index = getIndex(x, y);
+		if (index < 0 || !map.tileIsValid(x, y, eyesTile.z))
+		{
+			return -1;
+		}
+		auto &sides = tileSides[index];
+		if (sides != notKnown)
+		{
+			return sides;
+		}
+		auto filled = [&](int vx, int vy) {
+			return map.getVoxelFilled(
+			    {x * voxelSize.x + vx, y * voxelSize.y + vy, eyesVoxel.z}, mapPartTypes, true);
+		};
+		const int samplesX[3] = {voxelSize.x / 4, voxelSize.x / 2, voxelSize.x * 3 / 4};
+		const int samplesY[3] = {voxelSize.y / 4, voxelSize.y / 2, voxelSize.y * 3 / 4};
+		int west = 0, east = 0, north = 0, south = 0, inside = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			west += filled(0, samplesY[i]) || filled(1, samplesY[i]) ? 1 : 0;
+			east += filled(voxelSize.x - 1, samplesY[i]) || filled(voxelSize.x - 2, samplesY[i])
+			            ? 1
+			            : 0;
+			north += filled(samplesX[i], 0) || filled(samplesX[i], 1) ? 1 : 0;
+			south += filled(samplesX[i], voxelSize.y - 1) || filled(samplesX[i], voxelSize.y - 2)
+			             ? 1
+			             : 0;
+			for (int j = 0; j < 3; j++)
+			{
+				inside += filled(samplesX[i], samplesY[j]) ? 1 : 0;
+			}
+		}
+		// Most of it has to be filled, so that windows and gaps are seen through
+		sides = (west >= 2 ? blocksWest : 0) | (east >= 2 ? blocksEast : 0) |
+		        (north >= 2 ? blocksNorth : 0) | (south >= 2 ? blocksSouth : 0) |
+		        (inside >= 5 ? blocksInside : 0);
+		return sides;
+	};
+
+	// Cells with both coordinates odd are tiles, cells between two tiles are the walls between
+	// them and cells between four are corners
+	auto getEdgeBlocks = [&](Vec2<int> cell) -> bool {
+		int x = cell.x / 2;
+		int y = cell.y / 2;
+		if (cell.x % 2 == 0)
+		{
+			auto before = getSides(x - 1, y);
+			auto after = getSides(x, y);
+			return before < 0 || after < 0 || (before & blocksEast) || (after & blocksWest);
+		}
+		auto before = getSides(x, y - 1);
+		auto after = getSides(x, y);
+		return before < 0 || after < 0 || (before & blocksSouth) || (after & blocksNorth);
+	};
+	auto getBlockage = [&](Vec2<int> cell) -> int {
+		if (cell.x < 0 || cell.y < 0)
+		{
+			return -1;
+		}
+		int x = cell.x / 2;
+		int y = cell.y / 2;
+		if (cell.x % 2 == 1 && cell.y % 2 == 1)
+		{
+			auto sides = getSides(x, y);
+			if (sides < 0 || (sides & blocksInside))
+			{
+				return -1;
+			}
+			// Smoke, counted twice as the grid is twice as fine
+			return 2 * map.getTile(x, y, eyesTile.z)->visionBlockValue;
+		}
+		if (cell.x % 2 == 1 || cell.y % 2 == 1)
+		{
+			return getEdgeBlocks(cell) ? -1 : 0;
+		}
+		// Corners block where walls meet, so that there's no peeking in between, but not where
+		// a wall ends
+		int walls = (getEdgeBlocks({cell.x - 1, cell.y}) ? 1 : 0) +
+		            (getEdgeBlocks({cell.x + 1, cell.y}) ? 1 : 0) +
+		            (getEdgeBlocks({cell.x, cell.y - 1}) ? 1 : 0) +
+		            (getEdgeBlocks({cell.x, cell.y + 1}) ? 1 : 0);
+		return walls >= 2 ? -1 : 0;
+	};
+
+	// How far we see past every tile seen, seeing a wall means seeing the tile it belongs to
+	std::vector<int> tileRanges(side * side, -1);
+	auto seeTile = [&](int x, int y, int range) {
+		auto index = getIndex(x, y);
+		if (index >= 0 && map.tileIsValid(x, y, eyesTile.z))
+		{
+			tileRanges[index] = std::max(tileRanges[index], range);
+		}
+	};
+	auto visit = [&](Vec2<int> cell, int range) {
+		if (cell.x < 0 || cell.y < 0)
+		{
+			return;
+		}
+		int x = cell.x / 2;
+		int y = cell.y / 2;
+		if (cell.x % 2 == 1 && cell.y % 2 == 1)
+		{
+			seeTile(x, y, range);
+		}
+		else if (cell.y % 2 == 1)
+		{
+			if (getSides(x - 1, y) > 0 && (getSides(x - 1, y) & blocksEast))
+			{
+				seeTile(x - 1, y, range);
+			}
+			if (getSides(x, y) > 0 && (getSides(x, y) & blocksWest))
+			{
+				seeTile(x, y, range);
+			}
+		}
+		else if (cell.x % 2 == 1)
+		{
+			if (getSides(x, y - 1) > 0 && (getSides(x, y - 1) & blocksSouth))
+			{
+				seeTile(x, y - 1, range);
+			}
+			if (getSides(x, y) > 0 && (getSides(x, y) & blocksNorth))
+			{
+				seeTile(x, y, range);
+			}
+		}
+	};
+	shadowcast(Vec2<int>{eyesTile.x * 2 + 1, eyesTile.y * 2 + 1}, 2 * VIEW_DISTANCE, getBlockage,
+	           visit);
 
-			for (auto &t : c.passedTiles)
+	// Look up and down from every tile seen, until going through a floor
+	for (int y = eyesTile.y - VIEW_DISTANCE - 1; y <= eyesTile.y + VIEW_DISTANCE + 1; y++)
+	{
+		for (int x = eyesTile.x - VIEW_DISTANCE - 1; x <= eyesTile.x + VIEW_DISTANCE + 1; x++)
+		{
+			auto index = getIndex(x, y);
+			if (index < 0 || tileRanges[index] < 0 || !isWithinVision({x, y, eyesTile.z}))
+			{
+				continue;
+			}
+			int range = tileRanges[index] / 2;
+			int distanceXY =
+			    (x - eyesTile.x) * (x - eyesTile.x) + (y - eyesTile.y) * (y - eyesTile.y);
+			battle.setVisible(owner, x, y, eyesTile.z);
+			for (int z = eyesTile.z - 1; z >= 0; z--)
+			{
+				int dz = eyesTile.z - z;
+				if (battle.getTileSealed(x, y, z + 1) || distanceXY + dz * dz > range * range)
+				{
+					break;
+				}
+				battle.setVisible(owner, x, y, z);
+			}
+			for (int z = eyesTile.z + 1; z < battle.size.z; z++)
 			{
-				auto idx = tileToLosBlock.at(t.z * battle.size.x * battle.size.y +
-				                             t.y * battle.size.x + t.x);
-				if (!visibleBlocks.at(idx))
+				int dz = z - eyesTile.z;
+				if (distanceXY + dz * dz > range * range)
+				{
+					break;
+				}
+				battle.setVisible(owner, x, y, z);
+				if (battle.getTileSealed(x, y, z))
 				{
-					visibleBlocks.at(idx) = true;
-					discoveredBlocks.insert(idx);
+					break;
 				}
 			}
 		}
@@ -523,8 +830,59 @@ void BattleUnit::calculateVisionToLosBlocksLazy(GameState &state, std::set<int>
 
 bool BattleUnit::calculateVisionToUnit(GameState &state, BattleUnit &u)
 {
-	auto eyesPos = getEyeLocation();
+	Vec3<float> from;
+	Vec3<float> to;
+	CollisionOptions options;
+	if (!getVisionToUnitCheck(state, u, from, to, options))
+	{
+		return false;
+	}
 	auto &map = *state.current_battle->map;
+	bool seen = false;
+	if (getStoredVisionToUnit(map, u, from, to, options.maxRange, seen))
+	{
+		return seen;
+	}
+	auto c = map.findCollision(from, to, options);
+	seen = !c && !c.outOfRange;
+	storeVisionToUnit(map, u, from, to, options.maxRange, seen);
+	return seen;
+}
+
+bool BattleUnit::getStoredVisionToUnit(const TileMap &map, const BattleUnit &u,
+                                       Vec3<float> from, Vec3<float> to, unsigned maxRange,
+                                       bool &seen) const
+{
+	auto it = visionChecks.find(&u);
+	if (it == visionChecks.end())
+	{
+		return false;
+	}
+	auto &check = it->second;
+	if (check.revision != map.getVisionRevision() || check.from != from ||
+	    check.to != to || check.maxRange != maxRange)
+	{
+		return false;
+	}
+	seen = check.seen;
+	return true;
+}
+
+void BattleUnit::storeVisionToUnit(const TileMap &map, const BattleUnit &u, Vec3<float> from,
+                                   Vec3<float> to, unsigned maxRange, bool seen)
+{
+	auto &check = visionChecks[&u];
+	check.from = from;
+	check.to = to;
+	check.maxRange = maxRange;
+	check.revision = map.getVisionRevision();
+	check.seen = seen;
+}
+
+bool BattleUnit::getVisionToUnitCheck(GameState &, BattleUnit &u, Vec3<float> &from,
+                                      Vec3<float> &to, CollisionOptions &options)
+{
+	auto eyesPos = getEyeLocation();
 
 	// Unit unconscious, we own this unit or can't see it, skip
 	if (!u.isConscious() || u.owner == owner || !isWithinVision(u.position))
@@ -539,12 +897,12 @@ bool BattleUnit::calculateVisionToUnit(GameState &state, BattleUnit &u)
 		auto targetvVectorDelta = glm::normalize(target - eyesPos) * 0.75f;
 		target -= targetvVectorDelta;
 	}
-	auto c = map.findCollision(eyesPos, target, mapPartSet, tileObject, true, false,
-	                           VIEW_DISTANCE / (u.isCloaked() ? 2 : 1));
-	if (c || c.outOfRange)
-	{
-		return false;
-	}
+	options.validTypes = mapPartTypes;
+	options.ignoredObject = tileObject;
+	options.useLOS = true;
+	options.maxRange = VIEW_DISTANCE / (u.isCloaked() ? 2 : 1);
+	from = eyesPos;
+	to = target;
 	return true;
 }
 
@@ -562,9 +920,16 @@ void BattleUnit::calculateVisionToUnits(GameState &state)
 void BattleUnit::refreshUnitVision(GameState &state, bool forceBlind,
                                    StateRef<BattleUnit> targetUnit)
 {
-	auto &battle = *state.current_battle;
+	if (!targetUnit)
+	{
+		if (!forceBlind && state.current_battle->batchingVisionRefreshes)
+		{
+			visionRefreshQueued = true;
+			return;
+		}
+		visionRefreshQueued = false;
+	}
 	auto lastVisibleUnits = visibleUnits;
-	auto ticks = state.gameTime.getTicks();
 	visibleUnits.clear();
 	visibleEnemies.clear();
 
@@ -598,6 +963,134 @@ void BattleUnit::refreshUnitVision(GameState &state, bool forceBlind,
 			}
 		}
 	}
+	updateVisibleUnits(state, lastVisibleUnits);
+}
+
+void BattleUnit::refreshUnitsVision(GameState &state, const std::vector<sp<BattleUnit>> &units)
+{
+	auto &battle = *state.current_battle;
+	auto &map = *battle.map;
+
+	// Nothing here changes what any unit can see of another, so every check can be done before
+	// any unit is updated and the result is the same as updating them one by one
+	class Check
+	{
+	  public:
+		size_t viewer;
+		BattleUnit *targetUnit;
+		StateRef<BattleUnit> target;
+		Vec3<float> from;
+		Vec3<float> to;
+		CollisionOptions options;
+		bool stored = false;
+		bool seen = false;
+	};
+	std::vector<Check> checks;
+	// Checks that have not been done since either unit or the map last changed
+	std::vector<size_t> checksToDo;
+	// Every viewer goes through every unit, so first rule out those it can't see using only what
+	// is in here, in the same order as battle.units
+	std::vector<VisionHotData> targets;
+	std::vector<const UString *> targetIds;
+	PositionBatch<int> targetPositions;
+	targets.reserve(battle.units.size());
+	targetIds.reserve(battle.units.size());
+	targetPositions.reserve(battle.units.size());
+	for (auto &entry : battle.units)
+	{
+		targets.push_back(entry.second->getVisionHotData());
+		targetIds.push_back(&entry.first);
+		targetPositions.push_back(targets.back().position);
+	}
+	// Which targets are within the vision cone of the viewer, worked out for all of them at once
+	std::vector<uint8_t> inCone(targets.size());
+	for (size_t i = 0; i < units.size(); i++)
+	{
+		auto viewer = units[i]->getVisionHotData();
+		if (!viewer.conscious)
+		{
+			continue;
+		}
+		std::fill(inCone.begin(), inCone.end(), 1);
+		keepWithinVisionCone(targetPositions, viewer.position, viewer.facing, viewer.allRound,
+		                     inCone.data());
+		for (size_t j = 0; j < targets.size(); j++)
+		{
+			auto &target = targets[j];
+			if (!inCone[j] || !target.conscious || target.owner == viewer.owner)
+			{
+				continue;
+			}
+			Check check;
+			if (units[i]->getVisionToUnitCheck(state, *target.unit, check.from, check.to,
+			                                   check.options))
+			{
+				check.viewer = i;
+				check.targetUnit = target.unit;
+				check.target = {&state, *targetIds[j]};
+				check.stored =
+				    units[i]->getStoredVisionToUnit(map, *target.unit, check.from, check.to,
+				                                    check.options.maxRange, check.seen);
+				if (!check.stored)
+				{
+					checksToDo.push_back(checks.size());
+				}
+				checks.push_back(std::move(check));
+			}
+		}
+	}
+	auto doCheck = [&checks, &checksToDo, &map](unsigned int index, unsigned int) {
+		auto &check = checks[checksToDo[index]];
+		auto c = map.findCollision(check.from, check.to, check.options);
+		check.seen = !c && !c.outOfRange;
+	};
+	auto framework = Framework::tryGetInstance();
+	if (framework && checksToDo.size() > 1)
+	{
+		framework->threadPoolParallelFor(checksToDo.size(), doCheck);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < checksToDo.size(); index++)
+		{
+			doCheck(index, 0);
+		}
+	}
+
+	// Apply in the order given, as units of one organisation share what they have seen
+	auto check = checks.begin();
+	for (size_t i = 0; i < units.size(); i++)
+	{
+		auto &unit = *units[i];
+		auto lastVisibleUnits = unit.visibleUnits;
+		unit.visionRefreshQueued = false;
+		unit.visibleUnits.clear();
+		unit.visibleEnemies.clear();
+		if (unit.isConscious())
+		{
+			unit.calculateVisionToTerrain(state);
+		}
+		for (; check != checks.end() && check->viewer == i; check++)
+		{
+			if (!check->stored)
+			{
+				unit.storeVisionToUnit(map, *check->targetUnit, check->from, check->to,
+				                       check->options.maxRange, check->seen);
+			}
+			if (check->seen)
+			{
+				unit.visibleUnits.insert(check->target);
+			}
+		}
+		unit.updateVisibleUnits(state, lastVisibleUnits);
+	}
+}
+
+void BattleUnit::updateVisibleUnits(GameState &state,
+                                    const std::set<StateRef<BattleUnit>> &lastVisibleUnits)
+{
+	auto &battle = *state.current_battle;
+	auto ticks = state.gameTime.getTicks();
 
 	// Add newly visible units to owner's list and enemy list
 	for (auto &vu : visibleUnits)
@@ -877,32 +1370,38 @@ WeaponStatus BattleUnit::canAttackUnit(GameState &state, sp<BattleUnit> unit)
 
 WeaponStatus BattleUnit::canAttackUnit(GameState &state, sp<BattleUnit> unit,
                                        sp<AEquipment> rightHand, sp<AEquipment> leftHand)
+{
+	if (!hasLineToUnit(unit))
+	{
+		return WeaponStatus::NotFiring;
+	}
+	return canAttackUnitInLine(state, unit, rightHand, leftHand);
+}
+
+WeaponStatus BattleUnit::canAttackUnitInLine(GameState &state, sp<BattleUnit> unit,
+                                             sp<AEquipment> rightHand, sp<AEquipment> leftHand)
 {
 	bool realTime = state.current_battle->mode == Battle::Mode::RealTime;
 	auto targetPosition = unit->tileObject->getVoxelCentrePosition();
-	if (hasLineToUnit(unit))
+	// One of held weapons is in range
+	bool rightCanFire =
+	    rightHand && rightHand->canFire(state, targetPosition) &&
+	    (realTime ||
+	     canAfford(state, getAttackCost(state, *rightHand, unit->position), true, true));
+	bool leftCanFire =
+	    leftHand && leftHand->canFire(state, targetPosition) &&
+	    (realTime || canAfford(state, getAttackCost(state, *leftHand, unit->position), true, true));
+	if (rightCanFire && leftCanFire)
 	{
-		// One of held weapons is in range
-		bool rightCanFire =
-		    rightHand && rightHand->canFire(state, targetPosition) &&
-		    (realTime ||
-		     canAfford(state, getAttackCost(state, *rightHand, unit->position), true, true));
-		bool leftCanFire =
-		    leftHand && leftHand->canFire(state, targetPosition) &&
-		    (realTime ||
-		     canAfford(state, getAttackCost(state, *leftHand, unit->position), true, true));
-		if (rightCanFire && leftCanFire)
-		{
-			return WeaponStatus::FiringBothHands;
-		}
-		else if (rightCanFire)
-		{
-			return WeaponStatus::FiringRightHand;
-		}
-		else if (leftCanFire)
-		{
-			return WeaponStatus::FiringLeftHand;
-		}
+		return WeaponStatus::FiringBothHands;
+	}
+	else if (rightCanFire)
+	{
+		return WeaponStatus::FiringRightHand;
+	}
+	else if (leftCanFire)
+	{
+		return WeaponStatus::FiringLeftHand;
 	}
 	return WeaponStatus::NotFiring;
 }
@@ -925,12 +1424,15 @@ bool BattleUnit::hasLineToPosition(Vec3<float> targetPosition, bool useLOS) cons
 {
 	auto muzzleLocation = getMuzzleLocation();
 	// Map part that prevents Line to target
-	auto cMap = tileObject->map.findCollision(muzzleLocation, targetPosition, mapPartSet,
-	                                          tileObject, useLOS);
+	CollisionOptions options;
+	options.validTypes = mapPartTypes;
+	options.ignoredObject = tileObject;
+	options.useLOS = useLOS;
+	auto cMap = tileObject->map.findCollision(muzzleLocation, targetPosition, options);
 	// Unit that prevents Line to target
-	auto cUnitObj =
-	    useLOS ? Collision()
-	           : tileObject->map.findCollision(muzzleLocation, targetPosition, unitSet, tileObject);
+	options.validTypes = unitTypes;
+	auto cUnitObj = useLOS ? Collision()
+	                       : tileObject->map.findCollision(muzzleLocation, targetPosition, options);
 	auto cUnit = cUnitObj ? std::static_pointer_cast<TileObjectBattleUnit>(cUnitObj.obj)->getUnit()
 	                      : nullptr;
 	// Condition:
@@ -943,6 +1445,19 @@ bool BattleUnit::hasLineToPosition(Vec3<float> targetPosition, bool useLOS) cons
 	           || cUnit->brainSucker);
 }
 
+bool BattleUnit::mayHaveLineToUnit(GameState &state, const sp<BattleUnit> unit) const
+{
+	auto &battle = *state.current_battle;
+	auto blockAt = [&battle](Vec3<float> position) {
+		Vec3<int> tile = position;
+		return battle.getLosBlockID(clamp(tile.x, 0, battle.size.x - 1),
+		                            clamp(tile.y, 0, battle.size.y - 1),
+		                            clamp(tile.z, 0, battle.size.z - 1));
+	};
+	return battle.getLosBlocksMayHaveLine(blockAt(getMuzzleLocation()),
+	                                      blockAt(unit->tileObject->getVoxelCentrePosition()));
+}
+
 int BattleUnit::getPsiCost(PsiStatus status, bool attack)
 {
 	switch (status)
@@ -2654,9 +3169,11 @@ void BattleUnit::updateMovementFalling(GameState &state, unsigned int &moveTicks
 	}
 
 	// Check if new position is valid
+	CollisionOptions options;
+	options.ignoredObject = tileObject;
 	auto c = (collisionIgnoredTicks > 0 || isConscious())
 	             ? Collision()
-	             : tileObject->map.findCollision(previousPosition, newPosition, {}, tileObject);
+	             : tileObject->map.findCollision(previousPosition, newPosition, options);
 	if (c)
 	{
 		// If colliding with anything but ground, bounce back once
@@ -5180,6 +5697,11 @@ void BattleUnit::setFacing(GameState &state, Vec2<int> newFacing)
 	facing = newFacing;
 	goalFacing = newFacing;
 	turning_animation_ticks_remaining = 0;
+	// Units are a different shape when facing elsewhere
+	if (tileObject)
+	{
+		tileObject->map.notifyCollisionChange();
+	}
 	refreshUnitVision(state);
 }
 
@@ -5318,14 +5840,20 @@ void BattleUnit::playDistantSound(GameState &state, sp<Sample> sfx, float gainMu
 	}
 	else
 	{
-		for (auto &u : state.current_battle->units)
-		{
-			if (u.second->owner != state.current_battle->currentPlayer || !u.second->isConscious())
-			{
-				continue;
-			}
-			distance = std::min(distance, glm::distance(u.second->position, position));
-		}
+		// Only those of the player close enough to hear it matter
+		state.current_battle->map->forEachUnitOrItemNear(
+		    position, MAX_HEARING_DISTANCE, [&](const sp<TileObject> &object) {
+			    if (object->getType() != TileObject::Type::Unit)
+			    {
+				    return;
+			    }
+			    auto u = std::static_pointer_cast<TileObjectBattleUnit>(object)->getUnit();
+			    if (!u || u->owner != state.current_battle->currentPlayer || !u->isConscious())
+			    {
+				    return;
+			    }
+			    distance = std::min(distance, glm::distance(u->position, position));
+		    });
 	}
 	if (distance < MAX_HEARING_DISTANCE)
 	{
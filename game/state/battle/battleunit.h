@@ -7,6 +7,7 @@
 #include "game/state/battle/battleunitmission.h"
 #include "game/state/gametime.h"
 #include "game/state/rules/agenttype.h"
+#include "library/rect.h"
 #include "library/sp.h"
 #include "library/strings.h"
 #include "library/vec.h"
@@ -70,9 +71,11 @@ class DamageType;
 class AIDecision;
 class AIAction;
 class AIMovement;
+class CollisionOptions;
 enum class GameEventType;
 enum class DamageSource;
 class Agent;
+template <typename T> class PositionBatch;
 
 enum class MovementMode
 {
@@ -339,6 +342,9 @@ class BattleUnit : public StateObject, public std::enable_shared_from_this<Battl
 	std::set<StateRef<BattleUnit>> visibleUnits;
 	// Visible units that are hostile to us
 	std::set<StateRef<BattleUnit>> visibleEnemies;
+	// Not serialized, set when vision was to be refreshed while the battle batches refreshes,
+	// for Battle::updateVision to do it along with the other units
+	bool visionRefreshQueued = false;
 
 	// Miscellaneous
 
@@ -399,12 +405,18 @@ class BattleUnit : public StateObject, public std::enable_shared_from_this<Battl
 	// Checks wether target unit is in range, and clear LOF exists to it
 	WeaponStatus canAttackUnit(GameState &state, sp<BattleUnit> unit, sp<AEquipment> rightHand,
 	                           sp<AEquipment> leftHand = nullptr);
+	// Same as above, for when clear LOF to target unit is already known to exist
+	WeaponStatus canAttackUnitInLine(GameState &state, sp<BattleUnit> unit,
+	                                 sp<AEquipment> rightHand, sp<AEquipment> leftHand = nullptr);
 	// Clear LOF means no friendly fire and no map part in between
 	// Clear LOS means nothing in between
 	bool hasLineToUnit(const sp<BattleUnit> unit, bool useLOS = false) const;
 	// Clear LOF means no friendly fire and no map part in between
 	// Clear LOS means nothing in between
 	bool hasLineToPosition(Vec3<float> targetPosition, bool useLOS = false) const;
+	// False if no clear LOF to target unit is likely, going by what is known of lines between the
+	// los blocks we and it are in, which is cheaper than hasLineToUnit but may be wrong
+	bool mayHaveLineToUnit(GameState &state, const sp<BattleUnit> unit) const;
 
 	// Psi
 
@@ -816,19 +828,74 @@ class BattleUnit : public StateObject, public std::enable_shared_from_this<Battl
 	// Calculate unit's vision to LBs using "shotgun" approach:
 	// Shoot 25 beams and include everything that was passed through into list of visible blocks
 	void calculateVisionToLosBlocksLazy(GameState &state, std::set<int> &discoveredBlocks);
+	// Calculate unit's vision to tiles by shadowcasting on the level of its eyes, with walls
+	// between tiles on a grid twice as fine, then looking up and down from every tile seen
+	void calculateVisionToTilesShadowcast(GameState &state);
 	// Calculate vision to every other unit
 	void calculateVisionToUnits(GameState &state);
 	// Return if unit sees unit
 	bool calculateVisionToUnit(GameState &state, BattleUnit &u);
+	// Fill in the line of sight check that tells if unit sees unit, return false if it can't see
+	// it whatever the check finds
+	bool getVisionToUnitCheck(GameState &state, BattleUnit &u, Vec3<float> &from,
+	                          Vec3<float> &to, CollisionOptions &options);
 	// Return if target is within vision cone
 	bool isWithinVision(Vec3<int> pos);
+	// Return if something diff away from a unit facing that way is within its vision cone
+	static bool isWithinVisionCone(Vec3<int> diff, Vec2<int> facing, bool allRound);
+	// The same for every one of positions at once as seen from a unit at from, clearing keep[i]
+	// for each outside the vision cone
+	static void keepWithinVisionCone(const PositionBatch<int> &positions, Vec3<int> from,
+	                                 Vec2<int> facing, bool allRound, uint8_t *keep);
+
+	// What tells if a unit could be seen at all, copied out of every unit into one array so that
+	// going through all pairs of units doesn't chase pointers into both of them
+	class VisionHotData
+	{
+	  public:
+		BattleUnit *unit = nullptr;
+		const Organisation *owner = nullptr;
+		Vec3<int> position;
+		Vec2<int> facing;
+		bool conscious = false;
+		bool allRound = false;
+	};
+	VisionHotData getVisionHotData();
+	// Return the tiles on the XY plane outside of which nothing is within vision cone
+	Rect<int> getVisionBounds();
 
 	// Update unit's vision of other units and terrain
 	void refreshUnitVisibility(GameState &state);
-	// Update other units's vision of this unit
+	// Update other units's vision of this unit. While the battle batches vision refreshes, a full
+	// refresh is only queued
 	void refreshUnitVision(GameState &state, bool forceBlind = false,
 	                       StateRef<BattleUnit> targetUnit = StateRef<BattleUnit>());
 	// Update both this unit's vision and other unit's vision of this unit
 	void refreshUnitVisibilityAndVision(GameState &state);
+	// Same as refreshUnitVision on every unit in turn, but with the checks for which units they
+	// see done up front on the thread pool
+	static void refreshUnitsVision(GameState &state, const std::vector<sp<BattleUnit>> &units);
+	// Update the battle's lists of visible units and enemies after visibleUnits changed
+	void updateVisibleUnits(GameState &state,
+	                        const std::set<StateRef<BattleUnit>> &lastVisibleUnits);
+
+	// Line of sight checked to another unit, which ends the same way until either end of it moves
+	// or the map's vision revision changes
+	class VisionCheck
+	{
+	  public:
+		Vec3<float> from;
+		Vec3<float> to;
+		unsigned maxRange = 0;
+		unsigned int revision = 0;
+		bool seen = false;
+	};
+	// Not saved, as it is only there to skip checks
+	std::map<const BattleUnit *, VisionCheck> visionChecks;
+	// Return if this check was done since the map last changed, and if so set seen to its result
+	bool getStoredVisionToUnit(const TileMap &map, const BattleUnit &u, Vec3<float> from,
+	                           Vec3<float> to, unsigned maxRange, bool &seen) const;
+	void storeVisionToUnit(const TileMap &map, const BattleUnit &u, Vec3<float> from,
+	                       Vec3<float> to, unsigned maxRange, bool seen);
 };
 }
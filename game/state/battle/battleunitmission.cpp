@@ -42,7 +42,8 @@ BattleUnitTileHelper::BattleUnitTileHelper(TileMap &map, BattleUnitType type, bo
 BattleUnitTileHelper::BattleUnitTileHelper(TileMap &map, bool large, bool flying, bool allowJumping,
                                            int maxHeight, sp<TileObjectBattleUnit> tileObject)
     : map(map), large(large), flying(flying), maxHeight(maxHeight), tileObject(tileObject),
-      canJump(allowJumping && !flying)
+      canJump(allowJumping && !flying),
+      edgeCache(&map.getEdgeCache(maxHeight * 4 + (large ? 2 : 0) + (flying ? 1 : 0)))
 {
 }
 
@@ -128,6 +129,58 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool ignoreStaticU
 bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping, bool &jumped,
                                         float &cost, bool &doorInTheWay, bool ignoreStaticUnits,
                                         bool ignoreMovingUnits, bool ignoreAllUnits) const
+{
+	if (!from || !to || jumped)
+	{
+		return canEnterTileUncached(from, to, allowJumping, jumped, cost, doorInTheWay,
+		                            ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits);
+	}
+	auto offset = to->position - from->position;
+	bool neighbour = offset != Vec3<int>{0, 0, 0} && std::abs(offset.x) <= 1 &&
+	                 std::abs(offset.y) <= 1 && std::abs(offset.z) <= 1;
+	if (!neighbour)
+	{
+		return canEnterTileUncached(from, to, allowJumping, jumped, cost, doorInTheWay,
+		                            ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits);
+	}
+
+	// Units can only ever block a step the terrain allows, and never change what it costs. A step
+	// the terrain allows without jumping is never a jump, but one it blocks may still be jumped
+	bool mayJump = allowJumping && canJump && !large && offset.z == 0;
+	auto &edge = edgeCache->getEdge(from->position, offset);
+	auto known = edge.load(std::memory_order_relaxed);
+	if (known != TileEdgeCache::UNKNOWN)
+	{
+		if (TileEdgeCache::getPassable(known))
+		{
+			if (!ignoreAllUnits)
+			{
+				return canEnterTileUncached(from, to, false, jumped, cost, doorInTheWay,
+				                            ignoreStaticUnits, ignoreMovingUnits, false);
+			}
+			cost = TileEdgeCache::getCost(known);
+			doorInTheWay = TileEdgeCache::getDoorInTheWay(known);
+			return true;
+		}
+		if (!mayJump)
+		{
+			return false;
+		}
+	}
+	bool passable = canEnterTileUncached(from, to, allowJumping, jumped, cost, doorInTheWay,
+	                                     ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits);
+	// Unless units were ignored, a step they block tells nothing of the terrain
+	if (known == TileEdgeCache::UNKNOWN && !jumped && (passable || ignoreAllUnits))
+	{
+		edge.store(TileEdgeCache::encode(passable, cost, doorInTheWay), std::memory_order_relaxed);
+	}
+	return passable;
+}
+
+bool BattleUnitTileHelper::canEnterTileUncached(Tile *from, Tile *to, bool allowJumping,
+                                                bool &jumped, float &cost, bool &doorInTheWay,
+                                                bool ignoreStaticUnits, bool ignoreMovingUnits,
+                                                bool ignoreAllUnits) const
 {
 	int costInt = 0;
 	doorInTheWay = false;
@@ -462,10 +515,10 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 		{
 			// Will we bump our head when leaving current spot?
 			// Check four tiles above our "from"'s head
-			if (map.getTile(Vec3<int>{fromPos.x, fromPos.y, fromPos.z + 2})->solidGround ||
-			    map.getTile(Vec3<int>{fromX1Pos.x, fromX1Pos.y, fromX1Pos.z + 2})->solidGround ||
-			    map.getTile(Vec3<int>{fromY1Pos.x, fromY1Pos.y, fromY1Pos.z + 2})->solidGround ||
-			    map.getTile(Vec3<int>{fromXY1Pos.x, fromXY1Pos.y, fromXY1Pos.z + 2})->solidGround)
+			if (map.getNavigation(fromPos.x, fromPos.y, fromPos.z + 2).solidGround ||
+			    map.getNavigation(fromX1Pos.x, fromX1Pos.y, fromX1Pos.z + 2).solidGround ||
+			    map.getNavigation(fromY1Pos.x, fromY1Pos.y, fromY1Pos.z + 2).solidGround ||
+			    map.getNavigation(fromXY1Pos.x, fromXY1Pos.y, fromXY1Pos.z + 2).solidGround)
 			{
 				return false;
 			}
@@ -474,7 +527,7 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 		{
 			// Will we bump our head when leaving current spot?
 			// Check tile above our "from"'s head
-			if (map.getTile(Vec3<int>{fromPos.x, fromPos.y, fromPos.z + 1})->solidGround)
+			if (map.getNavigation(fromPos.x, fromPos.y, fromPos.z + 1).solidGround)
 			{
 				return false;
 			}
@@ -525,16 +578,16 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 				*/
 				Tile *rightTopZ0 =
 				    map.getTile(std::max(fromPos.x, toPos.x), std::max(fromPos.y, toPos.y) - 2, z);
-				Tile *rightBottomZ0 =
-				    map.getTile(std::max(fromPos.x, toPos.x), std::max(fromPos.y, toPos.y) - 1, z);
+				auto &rightBottomZ0 = map.getNavigation(std::max(fromPos.x, toPos.x),
+				                                        std::max(fromPos.y, toPos.y) - 1, z);
 				Tile *bottomLeftZ0 =
 				    map.getTile(std::max(fromPos.x, toPos.x) - 2, std::max(fromPos.y, toPos.y), z);
 				Tile *bottomRightZ0 =
 				    map.getTile(std::max(fromPos.x, toPos.x) - 1, std::max(fromPos.y, toPos.y), z);
 				Tile *rightTopZ1 = map.getTile(std::max(fromPos.x, toPos.x),
 				                               std::max(fromPos.y, toPos.y) - 2, z + 1);
-				Tile *rightBottomZ1 = map.getTile(std::max(fromPos.x, toPos.x),
-				                                  std::max(fromPos.y, toPos.y) - 1, z + 1);
+				auto &rightBottomZ1 = map.getNavigation(std::max(fromPos.x, toPos.x),
+				                                        std::max(fromPos.y, toPos.y) - 1, z + 1);
 				Tile *bottomLeftZ1 = map.getTile(std::max(fromPos.x, toPos.x) - 2,
 				                                 std::max(fromPos.y, toPos.y), z + 1);
 				Tile *bottomRightZ1 = map.getTile(std::max(fromPos.x, toPos.x) - 1,
@@ -543,20 +596,20 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 				// STEP 06: [For large units if moving: down-right or up-left / SE or NW]
 				// Find highest movement cost amongst all walls we intersect
 				costInt = std::max(costInt, rightTopZ0->movementCostLeft);
-				costInt = std::max(costInt, rightBottomZ0->movementCostRight);
+				costInt = std::max(costInt, rightBottomZ0.movementCostRight);
 				costInt = std::max(costInt, bottomLeftZ0->movementCostRight);
 				costInt = std::max(costInt, bottomRightZ0->movementCostLeft);
 				costInt = std::max(costInt, rightTopZ1->movementCostLeft);
-				costInt = std::max(costInt, rightBottomZ1->movementCostRight);
+				costInt = std::max(costInt, rightBottomZ1.movementCostRight);
 				costInt = std::max(costInt, bottomLeftZ1->movementCostRight);
 				costInt = std::max(costInt, bottomRightZ1->movementCostLeft);
 				// Check door state
 				doorInTheWay = doorInTheWay || rightTopZ0->closedDoorLeft;
-				doorInTheWay = doorInTheWay || rightBottomZ0->closedDoorRight;
+				doorInTheWay = doorInTheWay || rightBottomZ0.closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomLeftZ0->closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomRightZ0->closedDoorLeft;
 				doorInTheWay = doorInTheWay || rightTopZ1->closedDoorLeft;
-				doorInTheWay = doorInTheWay || rightBottomZ1->closedDoorRight;
+				doorInTheWay = doorInTheWay || rightBottomZ1.closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomLeftZ1->closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomRightZ1->closedDoorLeft;
 
@@ -587,14 +640,14 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 					// Going down-right
 					if (toPos.x > fromPos.x)
 					{
-						auto edge = map.getTile(toPos.x, toPos.y, toPos.z + 2);
+						auto &edge = map.getNavigation(toPos.x, toPos.y, toPos.z + 2);
 						// Legend: * = from, + = "to" tile, X = tiles we already have
 						//  **X
 						//  **X
 						//  XX+
 						// Must check 5 tiles above our head, already have 4 of them
-						if (edge->solidGround || edge->hasLift || rightBottomZ1->solidGround ||
-						    rightBottomZ1->hasLift || bottomRightZ1->solidGround ||
+						if (edge.solidGround || edge.hasLift || rightBottomZ1.solidGround ||
+						    rightBottomZ1.hasLift || bottomRightZ1->solidGround ||
 						    bottomRightZ1->hasLift || rightTopZ1->solidGround ||
 						    rightTopZ1->hasLift || bottomLeftZ1->solidGround ||
 						    bottomLeftZ1->hasLift)
@@ -605,17 +658,17 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 					// Going up-left
 					else
 					{
-						auto leftTop = map.getTile(toPos.x - 1, toPos.y - 1, toPos.z + 2);
-						auto leftMiddle = map.getTile(toPos.x - 1, toPos.y, toPos.z + 2);
-						auto topMiddle = map.getTile(toPos.x, toPos.y - 1, toPos.z + 2);
+						auto &leftTop = map.getNavigation(toPos.x - 1, toPos.y - 1, toPos.z + 2);
+						auto &leftMiddle = map.getNavigation(toPos.x - 1, toPos.y, toPos.z + 2);
+						auto &topMiddle = map.getNavigation(toPos.x, toPos.y - 1, toPos.z + 2);
 						// Legend: * = from, + = "to" tile, X = tiles we already have
 						//  xxX
 						//  x+*
 						//  X**
 						// Must check 5 tiles above our head, already have 2 of them
-						if (leftMiddle->solidGround || leftMiddle->hasLift ||
-						    leftTop->solidGround || leftTop->hasLift || topMiddle->solidGround ||
-						    topMiddle->hasLift || rightTopZ1->solidGround || rightTopZ1->hasLift ||
+						if (leftMiddle.solidGround || leftMiddle.hasLift ||
+						    leftTop.solidGround || leftTop.hasLift || topMiddle.solidGround ||
+						    topMiddle.hasLift || rightTopZ1->solidGround || rightTopZ1->hasLift ||
 						    bottomLeftZ1->solidGround || bottomLeftZ1->hasLift || toZ1->hasLift ||
 						    toXZ1->hasLift || toYZ1->hasLift || toXYZ1->hasLift)
 						{
@@ -648,38 +701,38 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 				*/
 				Tile *topLeftZ0 = map.getTile(std::max(fromPos.x, toPos.x) - 2,
 				                              std::max(fromPos.y, toPos.y) - 2, z);
-				Tile *topZ0 = map.getTile(std::max(fromPos.x, toPos.x) - 1,
-				                          std::max(fromPos.y, toPos.y) - 2, z);
-				Tile *leftZ0 = map.getTile(std::max(fromPos.x, toPos.x) - 2,
-				                           std::max(fromPos.y, toPos.y) - 1, z);
+				auto &topZ0 = map.getNavigation(std::max(fromPos.x, toPos.x) - 1,
+				                                std::max(fromPos.y, toPos.y) - 2, z);
+				auto &leftZ0 = map.getNavigation(std::max(fromPos.x, toPos.x) - 2,
+				                                 std::max(fromPos.y, toPos.y) - 1, z);
 				Tile *bottomRightZ0 =
 				    map.getTile(std::max(fromPos.x, toPos.x), std::max(fromPos.y, toPos.y), z);
 				Tile *topLeftZ1 = map.getTile(std::max(fromPos.x, toPos.x) - 2,
 				                              std::max(fromPos.y, toPos.y) - 2, z + 1);
-				Tile *topZ1 = map.getTile(std::max(fromPos.x, toPos.x) - 1,
-				                          std::max(fromPos.y, toPos.y) - 2, z + 1);
-				Tile *leftZ1 = map.getTile(std::max(fromPos.x, toPos.x) - 2,
-				                           std::max(fromPos.y, toPos.y) - 1, z + 1);
+				auto &topZ1 = map.getNavigation(std::max(fromPos.x, toPos.x) - 1,
+				                                std::max(fromPos.y, toPos.y) - 2, z + 1);
+				auto &leftZ1 = map.getNavigation(std::max(fromPos.x, toPos.x) - 2,
+				                                 std::max(fromPos.y, toPos.y) - 1, z + 1);
 				Tile *bottomRightZ1 =
 				    map.getTile(std::max(fromPos.x, toPos.x), std::max(fromPos.y, toPos.y), z + 1);
 
 				// STEP 06: [For large units if moving: down-left or up-right / NE or SW]
 				// Find highest movement cost amongst all walls we intersect
-				costInt = std::max(costInt, topZ0->movementCostLeft);
-				costInt = std::max(costInt, leftZ0->movementCostRight);
+				costInt = std::max(costInt, topZ0.movementCostLeft);
+				costInt = std::max(costInt, leftZ0.movementCostRight);
 				costInt = std::max(costInt, bottomRightZ0->movementCostLeft);
 				costInt = std::max(costInt, bottomRightZ0->movementCostRight);
-				costInt = std::max(costInt, topZ1->movementCostLeft);
-				costInt = std::max(costInt, leftZ1->movementCostRight);
+				costInt = std::max(costInt, topZ1.movementCostLeft);
+				costInt = std::max(costInt, leftZ1.movementCostRight);
 				costInt = std::max(costInt, bottomRightZ1->movementCostLeft);
 				costInt = std::max(costInt, bottomRightZ1->movementCostRight);
 				// Check door state
-				doorInTheWay = doorInTheWay || topZ0->closedDoorLeft;
-				doorInTheWay = doorInTheWay || leftZ0->closedDoorRight;
+				doorInTheWay = doorInTheWay || topZ0.closedDoorLeft;
+				doorInTheWay = doorInTheWay || leftZ0.closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomRightZ0->closedDoorLeft;
 				doorInTheWay = doorInTheWay || bottomRightZ0->closedDoorRight;
-				doorInTheWay = doorInTheWay || topZ1->closedDoorLeft;
-				doorInTheWay = doorInTheWay || leftZ1->closedDoorRight;
+				doorInTheWay = doorInTheWay || topZ1.closedDoorLeft;
+				doorInTheWay = doorInTheWay || leftZ1.closedDoorRight;
 				doorInTheWay = doorInTheWay || bottomRightZ1->closedDoorLeft;
 				doorInTheWay = doorInTheWay || bottomRightZ1->closedDoorRight;
 
@@ -711,16 +764,16 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 					// Going up-right
 					if (toPos.x > fromPos.x)
 					{
-						auto rightMiddle = map.getTile(toPos.x, toPos.y, toPos.z + 2);
-						auto rightTop = map.getTile(toPos.x, toPos.y - 1, toPos.z + 2);
+						auto &rightMiddle = map.getNavigation(toPos.x, toPos.y, toPos.z + 2);
+						auto &rightTop = map.getNavigation(toPos.x, toPos.y - 1, toPos.z + 2);
 						// Legend: * = from, + = "to" tile, X = tiles we already have
 						//  XXx
 						//  **+
 						//  **X
 						// Must check 5 tiles above our head, already have 3 of them
-						if (rightMiddle->solidGround || rightMiddle->hasLift ||
-						    rightTop->solidGround || rightTop->hasLift || topLeftZ1->solidGround ||
-						    topLeftZ1->hasLift || topZ1->solidGround || topZ1->hasLift ||
+						if (rightMiddle.solidGround || rightMiddle.hasLift ||
+						    rightTop.solidGround || rightTop.hasLift || topLeftZ1->solidGround ||
+						    topLeftZ1->hasLift || topZ1.solidGround || topZ1.hasLift ||
 						    bottomRightZ1->solidGround || bottomRightZ1->hasLift || toZ1->hasLift ||
 						    toXZ1->hasLift || toYZ1->hasLift || toXYZ1->hasLift)
 						{
@@ -731,16 +784,16 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 					else
 					{
 						auto bottomLeft = map.getTile(toPos.x - 1, toPos.y, toPos.z + 2);
-						auto bottomMiddle = map.getTile(toPos.x, toPos.y, toPos.z + 2);
+						auto &bottomMiddle = map.getNavigation(toPos.x, toPos.y, toPos.z + 2);
 						// Legend: * = from, + = "to" tile, X = tiles we already have
 						//  X**
 						//  X**
 						//  x+X
 						// Must check 5 tiles above our head, already have 2 of them
 						if (bottomLeft->solidGround || bottomLeft->hasLift ||
-						    bottomMiddle->solidGround || bottomMiddle->hasLift ||
-						    topLeftZ1->solidGround || topLeftZ1->hasLift || leftZ1->solidGround ||
-						    leftZ1->hasLift || bottomRightZ1->solidGround ||
+						    bottomMiddle.solidGround || bottomMiddle.hasLift ||
+						    topLeftZ1->solidGround || topLeftZ1->hasLift || leftZ1.solidGround ||
+						    leftZ1.hasLift || bottomRightZ1->solidGround ||
 						    bottomRightZ1->hasLift || toZ1->hasLift || toXZ1->hasLift ||
 						    toYZ1->hasLift || toXYZ1->hasLift)
 						{
@@ -756,22 +809,22 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 			// STEP 06: [For large units if moving along X]
 			if (fromPos.x != toPos.x)
 			{
-				Tile *topZ0 = map.getTile(toPos.x, toPos.y - 1, z);
-				Tile *bottomz0 = map.getTile(toPos.x, toPos.y, z);
-				Tile *topZ1 = map.getTile(toPos.x, toPos.y - 1, z + 1);
-				Tile *bottomZ1 = map.getTile(toPos.x, toPos.y, z + 1);
+				auto &topZ0 = map.getNavigation(toPos.x, toPos.y - 1, z);
+				auto &bottomz0 = map.getNavigation(toPos.x, toPos.y, z);
+				auto &topZ1 = map.getNavigation(toPos.x, toPos.y - 1, z + 1);
+				auto &bottomZ1 = map.getNavigation(toPos.x, toPos.y, z + 1);
 
 				// STEP 06: [For large units if moving along X]
 				// Find highest movement cost amongst all walls we intersect
-				costInt = std::max(costInt, topZ0->movementCostLeft);
-				costInt = std::max(costInt, bottomz0->movementCostLeft);
-				costInt = std::max(costInt, topZ1->movementCostLeft);
-				costInt = std::max(costInt, bottomZ1->movementCostLeft);
+				costInt = std::max(costInt, topZ0.movementCostLeft);
+				costInt = std::max(costInt, bottomz0.movementCostLeft);
+				costInt = std::max(costInt, topZ1.movementCostLeft);
+				costInt = std::max(costInt, bottomZ1.movementCostLeft);
 				// Check door state
-				doorInTheWay = doorInTheWay || topZ0->closedDoorLeft;
-				doorInTheWay = doorInTheWay || bottomz0->closedDoorLeft;
-				doorInTheWay = doorInTheWay || topZ1->closedDoorLeft;
-				doorInTheWay = doorInTheWay || bottomZ1->closedDoorLeft;
+				doorInTheWay = doorInTheWay || topZ0.closedDoorLeft;
+				doorInTheWay = doorInTheWay || bottomz0.closedDoorLeft;
+				doorInTheWay = doorInTheWay || topZ1.closedDoorLeft;
+				doorInTheWay = doorInTheWay || bottomZ1.closedDoorLeft;
 
 				// Do not have to check for units because we already checked in STEP 01
 				// Do not have to check for scenery because that's included in movement cost
@@ -782,11 +835,11 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 				// We still have to check it for gravlift though
 				if (goingDown)
 				{
-					auto topOther = map.getTile(toPos.x - 1, toPos.y - 1, toPos.z + 2);
-					auto bottomOther = map.getTile(toPos.x - 1, toPos.y, toPos.z + 2);
-					if (topZ1->solidGround || topZ1->hasLift || bottomZ1->solidGround ||
-					    bottomZ1->hasLift || topOther->solidGround || topOther->hasLift ||
-					    bottomOther->solidGround || bottomOther->hasLift || toZ1->hasLift ||
+					auto &topOther = map.getNavigation(toPos.x - 1, toPos.y - 1, toPos.z + 2);
+					auto &bottomOther = map.getNavigation(toPos.x - 1, toPos.y, toPos.z + 2);
+					if (topZ1.solidGround || topZ1.hasLift || bottomZ1.solidGround ||
+					    bottomZ1.hasLift || topOther.solidGround || topOther.hasLift ||
+					    bottomOther.solidGround || bottomOther.hasLift || toZ1->hasLift ||
 					    toXZ1->hasLift || toYZ1->hasLift || toXYZ1->hasLift)
 					{
 						return false;
@@ -796,22 +849,22 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 			// STEP 06: [For large units if moving along Y]
 			else if (fromPos.y != toPos.y)
 			{
-				Tile *leftZ0 = map.getTile(toPos.x - 1, toPos.y, z);
-				Tile *rightZ0 = map.getTile(toPos.x, toPos.y, z);
-				Tile *leftZ1 = map.getTile(toPos.x - 1, toPos.y, z + 1);
-				Tile *rightZ1 = map.getTile(toPos.x, toPos.y, z + 1);
+				auto &leftZ0 = map.getNavigation(toPos.x - 1, toPos.y, z);
+				auto &rightZ0 = map.getNavigation(toPos.x, toPos.y, z);
+				auto &leftZ1 = map.getNavigation(toPos.x - 1, toPos.y, z + 1);
+				auto &rightZ1 = map.getNavigation(toPos.x, toPos.y, z + 1);
 
 				// STEP 06: [For large units if moving along Y]
 				// Find highest movement cost amongst all walls we intersect
-				costInt = std::max(costInt, leftZ0->movementCostRight);
-				costInt = std::max(costInt, rightZ0->movementCostRight);
-				costInt = std::max(costInt, leftZ1->movementCostRight);
-				costInt = std::max(costInt, rightZ1->movementCostRight);
+				costInt = std::max(costInt, leftZ0.movementCostRight);
+				costInt = std::max(costInt, rightZ0.movementCostRight);
+				costInt = std::max(costInt, leftZ1.movementCostRight);
+				costInt = std::max(costInt, rightZ1.movementCostRight);
 				// Check door state
-				doorInTheWay = doorInTheWay || leftZ0->closedDoorRight;
-				doorInTheWay = doorInTheWay || rightZ0->closedDoorRight;
-				doorInTheWay = doorInTheWay || leftZ1->closedDoorRight;
-				doorInTheWay = doorInTheWay || rightZ1->closedDoorRight;
+				doorInTheWay = doorInTheWay || leftZ0.closedDoorRight;
+				doorInTheWay = doorInTheWay || rightZ0.closedDoorRight;
+				doorInTheWay = doorInTheWay || leftZ1.closedDoorRight;
+				doorInTheWay = doorInTheWay || rightZ1.closedDoorRight;
 
 				// Do not have to check for units because we already did in STEP 01
 				// Do not have to check for scenery because that's included in movement cost
@@ -822,11 +875,11 @@ bool BattleUnitTileHelper::canEnterTile(Tile *from, Tile *to, bool allowJumping,
 				// We still have to check it for gravlift though
 				if (goingDown)
 				{
-					auto leftOther = map.getTile(toPos.x - 1, toPos.y - 1, toPos.z + 2);
-					auto rightOther = map.getTile(toPos.x, toPos.y - 1, toPos.z + 2);
-					if (leftZ1->solidGround || leftZ1->hasLift || rightZ1->solidGround ||
-					    rightZ1->hasLift || leftOther->solidGround || leftOther->hasLift ||
-					    rightOther->solidGround || rightOther->hasLift || toZ1->hasLift ||
+					auto &leftOther = map.getNavigation(toPos.x - 1, toPos.y - 1, toPos.z + 2);
+					auto &rightOther = map.getNavigation(toPos.x, toPos.y - 1, toPos.z + 2);
+					if (leftZ1.solidGround || leftZ1.hasLift || rightZ1.solidGround ||
+					    rightZ1.hasLift || leftOther.solidGround || leftOther.hasLift ||
+					    rightOther.solidGround || rightOther.hasLift || toZ1->hasLift ||
 					    toXZ1->hasLift || toYZ1->hasLift || toXYZ1->hasLift)
 					{
 						return false;
@@ -2046,16 +2099,37 @@ void BattleUnitMission::setPathTo(GameState &state, BattleUnit &u, Vec3<int> tar
 			break;
 		}
 
-		auto path = state.current_battle->findShortestPath(
-		    u.goalPosition, target, BattleUnitTileHelper{map, u}, approachOnly, demandGiveWay,
-		    !blockedByMovingUnit);
+		// Expansions allowed when replanning incrementally before falling back to a full search
+		static const unsigned int REPLAN_ITERATION_LIMIT = 2000;
 
-		// Always start with the current position
-		this->currentPlannedPath.push_back(u.goalPosition);
-		for (auto &p : path)
+		auto &battle = *state.current_battle;
+		bool ignoreMovingUnits = !blockedByMovingUnit;
+		std::list<Vec3<int>> path;
+		// Replanning towards the same target only repairs what changed since the last time
+		if (!approachOnly && incrementalPath &&
+		    incrementalPath->matches(target, demandGiveWay, ignoreMovingUnits, false))
 		{
-			this->currentPlannedPath.push_back(p);
+			path = incrementalPath->findPath(map, battle.pathfindingChanges, u.goalPosition,
+			                                 REPLAN_ITERATION_LIMIT, BattleUnitTileHelper{map, u});
 		}
+		else if (!approachOnly)
+		{
+			incrementalPath.reset(new IncrementalPathfinder(
+			    target, demandGiveWay, ignoreMovingUnits, false, battle.pathfindingChanges));
+		}
+		else
+		{
+			incrementalPath = nullptr;
+		}
+		if (path.empty())
+		{
+			path = battle.findShortestPath(u.goalPosition, target, BattleUnitTileHelper{map, u},
+			                               approachOnly, demandGiveWay, ignoreMovingUnits);
+		}
+
+		// Always start with the current position
+		this->currentPlannedPath.push_back(u.goalPosition);
+		this->currentPlannedPath.splice(this->currentPlannedPath.end(), path);
 		targetLocation = currentPlannedPath.back();
 	}
 	else
@@ -2117,6 +2191,10 @@ bool BattleUnitMission::advanceAlongPath(GameState &state, BattleUnit &u, Vec3<f
 	                                               closedDoorInTheWay, true))
 	{
 		// Next tile became impassable, pick a new path
+		if (incrementalPath)
+		{
+			incrementalPath->notifyChange(pos);
+		}
 		currentPlannedPath.clear();
 		u.addMission(state, Type::RestartNextMission);
 		return false;
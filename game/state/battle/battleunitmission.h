@@ -1,6 +1,7 @@
 #pragma once
 
 #include "game/state/shared/agent.h"
+#include "game/state/tilemap/pathfinding.h"
 #include "game/state/tilemap/tilemap.h"
 #include "library/sp.h"
 #include "library/strings.h"
@@ -24,6 +25,12 @@ class BattleUnitTileHelper : public CanEnterTileHelper
 	int maxHeight;
 	sp<TileObjectBattleUnit> tileObject;
 	bool canJump = false;
+	// Shared by every helper for units of the same size, movement and height
+	TileEdgeCache *edgeCache;
+
+	bool canEnterTileUncached(Tile *from, Tile *to, bool allowJumping, bool &jumped, float &cost,
+	                          bool &doorInTheWay, bool ignoreStaticUnits, bool ignoreMovingUnits,
+	                          bool ignoreAllUnits) const;
 
   public:
 	BattleUnitTileHelper(TileMap &map, BattleUnit &u);
@@ -41,12 +48,16 @@ class BattleUnitTileHelper : public CanEnterTileHelper
 	// Alexey Andronov:
 	// This huge function figures out wether unit can go from one tile to another
 	// It's huge but I see no way to split it
+	// Steps to a neighbour that can't be a jump are looked up in the map's edge cache, which
+	// tells those the terrain blocks apart from those only units could block
 	bool canEnterTile(Tile *from, Tile *to, bool allowJumping, bool &jumped, float &cost,
 	                  bool &doorInTheWay, bool ignoreStaticUnits = false,
 	                  bool ignoreMovingUnits = true, bool ignoreAllUnits = false) const override;
 
 	float pathOverheadAlloawnce() const override { return 1.25f; }
 
+	bool canFlyStraight() const override { return flying; }
+
 	BattleUnitType getType() const;
 };
 
@@ -175,6 +186,8 @@ class BattleUnitMission
 	bool blockedByMovingUnit = false;
 	// Unit paid for movement before turning and will be refunded when actually moving
 	int costPaidUpFront = 0;
+	// Search state kept for replanning towards the same target (not serialized)
+	up<IncrementalPathfinder> incrementalPath;
 
 	// [Turn]
 
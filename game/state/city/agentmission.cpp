@@ -16,6 +16,7 @@
 #include "game/state/tilemap/tileobject_doodad.h"
 #include "game/state/tilemap/tileobject_scenery.h"
 #include "game/state/tilemap/tileobject_shadow.h"
+#include "game/state/tilemap/tileroutingtable.h"
 #include "library/strings_format.h"
 #include <glm/glm.hpp>
 
@@ -454,18 +455,8 @@ void AgentMission::setPathTo(GameState &state, Agent &a, StateRef<Building> b)
 	auto &map = *a.city->map;
 
 	std::list<Vec3<int>> path;
-	auto key = Vec3<int>{(Vec3<int>)a.position * map.size + b->crewQuarters};
-	if (map.agentPathCache.find(key) != map.agentPathCache.end())
-	{
-		LogWarning("Found cached path from %s to %s, using it", a.position, b->crewQuarters);
-		path = map.agentPathCache[key];
-	}
-	else
-	{
-		path = map.findShortestPath(a.position, b->crewQuarters, 2000, AgentTileHelper{map});
-		map.agentPathCache[key] = path;
-	}
-	if (path.empty() || path.back() != b->crewQuarters)
+	if (!map.agentRouting->getRoute(map, AgentTileHelper{map}, a.position, b->crewQuarters,
+	                                path))
 	{
 		cancelled = true;
 		return;
@@ -473,10 +464,7 @@ void AgentMission::setPathTo(GameState &state, Agent &a, StateRef<Building> b)
 
 	// Always start with the current position
 	this->currentPlannedPath.push_back(a.position);
-	for (auto &p : path)
-	{
-		this->currentPlannedPath.push_back(p);
-	}
+	this->currentPlannedPath.splice(this->currentPlannedPath.end(), path);
 }
 
 bool AgentMission::advanceAlongPath(GameState &state, Agent &a, Vec3<float> &destPos)
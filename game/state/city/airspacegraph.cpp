@@ -0,0 +1,473 @@
+#include "game/state/city/airspacegraph.h"
+#include "game/state/city/scenery.h"
+#include "game/state/city/vehiclemission.h"
+#include "game/state/rules/city/scenerytiletype.h"
+#include "game/state/tilemap/tilemap.h"
+#include "game/state/tilemap/tileobject_scenery.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <limits>
+#include <queue>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+// Pathfinding helper that only allows movement within the bounds of one cluster
+class ClusterTileHelper : public CanEnterTileHelper
+{
+  private:
+	Vec3<int> start;
+	Vec3<int> end;
+
+  public:
+	ClusterTileHelper(Vec3<int> start, Vec3<int> end) : start(start), end(end) {}
+
+	bool canEnterTile(Tile *from, Tile *to, bool, bool &, float &cost, bool &, bool, bool,
+	                  bool) const override
+	{
+		auto &pos = to->position;
+		if (pos.x < start.x || pos.x >= end.x || pos.y < start.y || pos.y >= end.y ||
+		    pos.z < start.z || pos.z >= end.z)
+		{
+			return false;
+		}
+		if (!AirspaceGraph::getPassable(*to))
+		{
+			return false;
+		}
+		cost = glm::length(Vec3<float>{from->position} - Vec3<float>{pos});
+		return true;
+	}
+	bool canEnterTile(Tile *from, Tile *to, bool ignoreStaticUnits, bool ignoreMovingUnits,
+	                  bool ignoreAllUnits) const override
+	{
+		float nothing;
+		bool none1;
+		bool none2;
+		return canEnterTile(from, to, false, none1, nothing, none2, ignoreStaticUnits,
+		                    ignoreMovingUnits, ignoreAllUnits);
+	}
+	float getDistance(Vec3<float> from, Vec3<float> to) const override
+	{
+		return FlyingVehicleTileHelper::getDistanceStatic(from, to);
+	}
+	float getDistance(Vec3<float> from, Vec3<float> toStart, Vec3<float> toEnd) const override
+	{
+		return FlyingVehicleTileHelper::getDistanceStatic(from, toStart, toEnd);
+	}
+};
+
+} // anonymous namespace
+
+AirspaceGraph::AirspaceGraph(TileMap &map) : map(map)
+{
+	clusterCount = {(map.size.x + CLUSTER_SIZE - 1) / CLUSTER_SIZE,
+	                (map.size.y + CLUSTER_SIZE - 1) / CLUSTER_SIZE};
+	clusters.resize(clusterCount.x * clusterCount.y);
+	for (int j = 0; j < clusterCount.y; j++)
+	{
+		for (int i = 0; i < clusterCount.x; i++)
+		{
+			auto &c = clusters[j * clusterCount.x + i];
+			c.start = {i * CLUSTER_SIZE, j * CLUSTER_SIZE, 0};
+			c.end = {std::min((i + 1) * CLUSTER_SIZE, map.size.x),
+			         std::min((j + 1) * CLUSTER_SIZE, map.size.y), map.size.z};
+		}
+	}
+	// Faces are created in a fixed order, so that cluster's own node order is stable
+	for (int j = 0; j < clusterCount.y; j++)
+	{
+		for (int i = 0; i < clusterCount.x; i++)
+		{
+			int id = j * clusterCount.x + i;
+			if (i + 1 < clusterCount.x)
+			{
+				Face f;
+				f.clusterA = id;
+				f.clusterB = id + 1;
+				f.alongX = true;
+				clusters[f.clusterA].faces.push_back(faces.size());
+				clusters[f.clusterB].faces.push_back(faces.size());
+				faces.push_back(f);
+			}
+			if (j + 1 < clusterCount.y)
+			{
+				Face f;
+				f.clusterA = id;
+				f.clusterB = id + clusterCount.x;
+				f.alongX = false;
+				clusters[f.clusterA].faces.push_back(faces.size());
+				clusters[f.clusterB].faces.push_back(faces.size());
+				faces.push_back(f);
+			}
+		}
+	}
+}
+
+bool AirspaceGraph::getPassable(const Tile &tile)
+{
+	// Underground is only entered when landing into a building
+	if (tile.position.z == 0)
+	{
+		return false;
+	}
+	for (auto &obj : tile.ownedObjects)
+	{
+		if (obj->getType() != TileObject::Type::Scenery)
+		{
+			continue;
+		}
+		auto sceneryTile = std::static_pointer_cast<TileObjectScenery>(obj);
+		if (!sceneryTile->scenery.lock()->type->isLandingPad)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int AirspaceGraph::getClusterID(Vec3<int> position) const
+{
+	return (position.y / CLUSTER_SIZE) * clusterCount.x + position.x / CLUSTER_SIZE;
+}
+
+void AirspaceGraph::notifyChange(Vec3<int> position)
+{
+	if (!map.tileIsValid(position))
+	{
+		return;
+	}
+	auto &c = clusters[getClusterID(position)];
+	c.costsValid = false;
+	for (auto &f : c.faces)
+	{
+		auto &face = faces[f];
+		// Only faces next to the changed tile can get different portals
+		if (face.alongX)
+		{
+			if ((face.clusterA == getClusterID(position) && position.x == c.end.x - 1) ||
+			    (face.clusterB == getClusterID(position) && position.x == c.start.x))
+			{
+				face.dirty = true;
+			}
+		}
+		else
+		{
+			if ((face.clusterA == getClusterID(position) && position.y == c.end.y - 1) ||
+			    (face.clusterB == getClusterID(position) && position.y == c.start.y))
+			{
+				face.dirty = true;
+			}
+		}
+	}
+}
+
+bool AirspaceGraph::shouldUse(Vec3<int> origin, Vec3<int> destination) const
+{
+	// Within neighbouring clusters direct pathfinding is cheap enough
+	return std::max(std::abs(origin.x / CLUSTER_SIZE - destination.x / CLUSTER_SIZE),
+	                std::abs(origin.y / CLUSTER_SIZE - destination.y / CLUSTER_SIZE)) > 1;
+}
+
+void AirspaceGraph::rebuildFace(Face &face)
+{
+	face.dirty = false;
+	face.portals.clear();
+	clusters[face.clusterA].costsValid = false;
+	clusters[face.clusterB].costsValid = false;
+	needsRenumbering = true;
+
+	auto &a = clusters[face.clusterA];
+	// Face is a 2d grid of (position along the face, z)
+	int along = face.alongX ? a.end.y - a.start.y : a.end.x - a.start.x;
+	int height = map.size.z;
+	auto getPair = [&](int u, int z) {
+		return face.alongX ? std::make_pair(Vec3<int>{a.end.x - 1, a.start.y + u, z},
+		                                    Vec3<int>{a.end.x, a.start.y + u, z})
+		                   : std::make_pair(Vec3<int>{a.start.x + u, a.end.y - 1, z},
+		                                    Vec3<int>{a.start.x + u, a.end.y, z});
+	};
+	std::vector<bool> open(along * height, false);
+	for (int z = 0; z < height; z++)
+	{
+		for (int u = 0; u < along; u++)
+		{
+			auto p = getPair(u, z);
+			open[z * along + u] = getPassable(*map.getTile(p.first)) &&
+			                      getPassable(*map.getTile(p.second));
+		}
+	}
+
+	// One portal per connected patch, at the open cell closest to the patch's middle
+	std::vector<bool> seen(along * height, false);
+	for (int start = 0; start < along * height; start++)
+	{
+		if (!open[start] || seen[start])
+		{
+			continue;
+		}
+		std::vector<int> patch;
+		std::list<int> toVisit = {start};
+		seen[start] = true;
+		Vec2<float> sum = {0.0f, 0.0f};
+		while (!toVisit.empty())
+		{
+			int cell = toVisit.front();
+			toVisit.pop_front();
+			patch.push_back(cell);
+			int u = cell % along;
+			int z = cell / along;
+			sum.x += u;
+			sum.y += z;
+			const int du[] = {-1, 1, 0, 0};
+			const int dz[] = {0, 0, -1, 1};
+			for (int d = 0; d < 4; d++)
+			{
+				int nu = u + du[d];
+				int nz = z + dz[d];
+				if (nu < 0 || nu >= along || nz < 0 || nz >= height)
+				{
+					continue;
+				}
+				int next = nz * along + nu;
+				if (open[next] && !seen[next])
+				{
+					seen[next] = true;
+					toVisit.push_back(next);
+				}
+			}
+		}
+		Vec2<float> middle = {sum.x / patch.size(), sum.y / patch.size()};
+		int best = patch.front();
+		float bestDistance = std::numeric_limits<float>::max();
+		for (auto &cell : patch)
+		{
+			float du = (float)(cell % along) - middle.x;
+			float dz = (float)(cell / along) - middle.y;
+			float distance = du * du + dz * dz;
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = cell;
+			}
+		}
+		face.portals.push_back(getPair(best % along, best / along));
+	}
+}
+
+void AirspaceGraph::renumber()
+{
+	needsRenumbering = false;
+	nodePosition.clear();
+	nodeCluster.clear();
+	nodePartner.clear();
+	for (int c = 0; c < (int)clusters.size(); c++)
+	{
+		auto &cluster = clusters[c];
+		cluster.firstNode = nodePosition.size();
+		for (auto &f : cluster.faces)
+		{
+			auto &face = faces[f];
+			bool sideA = face.clusterA == c;
+			if (sideA)
+			{
+				face.firstNodeA = nodePosition.size();
+			}
+			else
+			{
+				face.firstNodeB = nodePosition.size();
+			}
+			for (auto &p : face.portals)
+			{
+				nodePosition.push_back(sideA ? p.first : p.second);
+				nodeCluster.push_back(c);
+			}
+		}
+		int nodeCount = nodePosition.size() - cluster.firstNode;
+		if (nodeCount != cluster.nodeCount)
+		{
+			cluster.nodeCount = nodeCount;
+			cluster.costsValid = false;
+		}
+	}
+	nodePartner.resize(nodePosition.size());
+	for (auto &face : faces)
+	{
+		for (int i = 0; i < (int)face.portals.size(); i++)
+		{
+			nodePartner[face.firstNodeA + i] = face.firstNodeB + i;
+			nodePartner[face.firstNodeB + i] = face.firstNodeA + i;
+		}
+	}
+}
+
+void AirspaceGraph::update()
+{
+	for (auto &face : faces)
+	{
+		if (face.dirty)
+		{
+			rebuildFace(face);
+		}
+	}
+	if (needsRenumbering)
+	{
+		renumber();
+	}
+}
+
+float AirspaceGraph::findClusterPathCost(const Cluster &cluster, Vec3<int> from, Vec3<int> to,
+                                         PathfindingArena *arena) const
+{
+	if (from == to)
+	{
+		return 0.0f;
+	}
+	ClusterTileHelper helper(cluster.start, cluster.end);
+	auto volume = cluster.end - cluster.start;
+	float cost = 0.0f;
+	auto path = map.findShortestPath(from, to, volume.x * volume.y * volume.z, helper, false,
+	                                 true, true, true, &cost, 0.0f, arena);
+	if (path.empty() || path.back() != to)
+	{
+		return -1.0f;
+	}
+	return cost;
+}
+
+void AirspaceGraph::ensureCosts(Cluster &cluster, PathfindingArena *arena)
+{
+	if (cluster.costsValid)
+	{
+		return;
+	}
+	cluster.costsValid = true;
+	int n = cluster.nodeCount;
+	cluster.costs.assign(n * n, -1.0f);
+	for (int i = 0; i < n; i++)
+	{
+		cluster.costs[i * n + i] = 0.0f;
+		for (int j = i + 1; j < n; j++)
+		{
+			float cost =
+			    findClusterPathCost(cluster, nodePosition[cluster.firstNode + i],
+			                        nodePosition[cluster.firstNode + j], arena);
+			cluster.costs[i * n + j] = cost;
+			cluster.costs[j * n + i] = cost;
+		}
+	}
+}
+
+std::list<Vec3<int>> AirspaceGraph::findWaypoints(Vec3<int> origin, Vec3<int> destination,
+                                                   PathfindingArena *arena)
+{
+	if (!map.tileIsValid(origin) || !map.tileIsValid(destination))
+	{
+		return {};
+	}
+	std::lock_guard<std::mutex> lock(queryMutex);
+	update();
+
+	int nodeCount = nodePosition.size();
+	// Origin and destination get the two ids past the real nodes
+	int originNode = nodeCount;
+	int destinationNode = nodeCount + 1;
+	auto &originCluster = clusters[getClusterID(origin)];
+	auto &destinationCluster = clusters[getClusterID(destination)];
+
+	std::vector<float> destinationCosts(destinationCluster.nodeCount);
+	for (int i = 0; i < destinationCluster.nodeCount; i++)
+	{
+		destinationCosts[i] = findClusterPathCost(
+		    destinationCluster, nodePosition[destinationCluster.firstNode + i], destination);
+	}
+
+	auto getPosition = [&](int node) {
+		return node == originNode ? origin
+		                          : node == destinationNode ? destination : nodePosition[node];
+	};
+	std::vector<float> costToGetHere(nodeCount + 2, std::numeric_limits<float>::max());
+	std::vector<int> parentNode(nodeCount + 2, -1);
+	std::vector<bool> visited(nodeCount + 2, false);
+	using Entry = std::pair<float, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> fringe;
+	auto addToFringe = [&](int node, int parent, float cost) {
+		if (cost >= costToGetHere[node])
+		{
+			return;
+		}
+		costToGetHere[node] = cost;
+		parentNode[node] = parent;
+		fringe.emplace(
+		    cost + FlyingVehicleTileHelper::getDistanceStatic(getPosition(node), destination),
+		    node);
+	};
+
+	visited[originNode] = true;
+	costToGetHere[originNode] = 0.0f;
+	for (int i = 0; i < originCluster.nodeCount; i++)
+	{
+		float cost = findClusterPathCost(originCluster, origin,
+		                                 nodePosition[originCluster.firstNode + i]);
+		if (cost >= 0.0f)
+		{
+			addToFringe(originCluster.firstNode + i, originNode, cost);
+		}
+	}
+
+	while (!fringe.empty())
+	{
+		int node = fringe.top().second;
+		fringe.pop();
+		if (visited[node])
+		{
+			continue;
+		}
+		visited[node] = true;
+		if (node == destinationNode)
+		{
+			break;
+		}
+		float cost = costToGetHere[node];
+		auto &cluster = clusters[nodeCluster[node]];
+		// Step over the portal
+		int partner = nodePartner[node];
+		if (!visited[partner])
+		{
+			addToFringe(partner, node, cost + 1.0f);
+		}
+		// Move within the cluster
+		ensureCosts(cluster, arena);
+		int local = node - cluster.firstNode;
+		for (int i = 0; i < cluster.nodeCount; i++)
+		{
+			float linkCost = cluster.costs[local * cluster.nodeCount + i];
+			if (i == local || linkCost < 0.0f || visited[cluster.firstNode + i])
+			{
+				continue;
+			}
+			addToFringe(cluster.firstNode + i, node, cost + linkCost);
+		}
+		if (&cluster == &destinationCluster && destinationCosts[local] >= 0.0f)
+		{
+			addToFringe(destinationNode, node, cost + destinationCosts[local]);
+		}
+	}
+
+	if (!visited[destinationNode])
+	{
+		LogInfo("No airspace route from %s to %s", origin, destination);
+		return {};
+	}
+	std::list<Vec3<int>> result;
+	for (int node = destinationNode; node != -1; node = parentNode[node])
+	{
+		result.push_front(getPosition(node));
+	}
+	return result;
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "library/vec.h"
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class TileMap;
+class Tile;
+class PathfindingArena;
+
+// Hierarchical abstraction of the city's airspace, used to speed up long flying routes.
+//
+// The map is split into clusters of CLUSTER_SIZE x CLUSTER_SIZE tiles spanning every level.
+// Every connected passable patch on the face shared by two neighbouring clusters gets a portal
+// (a pair of adjacent tiles, one on each side), and travel costs between portals of the same
+// cluster are calculated only when a search needs them, then cached.
+//
+// Only scenery is considered, as vehicles move around too much to be worth tracking here.
+// Changes to the scenery dirty the clusters they happened in, which are then repaired on the
+// next query.
+class AirspaceGraph
+{
+  public:
+	static const int CLUSTER_SIZE = 10;
+
+	AirspaceGraph(TileMap &map);
+
+	// Queue rebuild of whatever the change at this position could have affected
+	void notifyChange(Vec3<int> position);
+
+	// True if the two points are far enough apart for the abstraction to pay off
+	bool shouldUse(Vec3<int> origin, Vec3<int> destination) const;
+
+	// Find a list of waypoints from origin to destination (both included) through cluster
+	// portals, every two consecutive waypoints lying within the same cluster or being adjacent.
+	// Returns empty list if no route is known. Can be called from several threads at once as long
+	// as nothing changes the map meanwhile, in which case each must provide its own arena
+	std::list<Vec3<int>> findWaypoints(Vec3<int> origin, Vec3<int> destination,
+	                                   PathfindingArena *arena = nullptr);
+
+	// True if a flying object can pass through this tile, ignoring other vehicles
+	static bool getPassable(const Tile &tile);
+
+  private:
+	class Face
+	{
+	  public:
+		// Cluster to the west or north is A, to the east or south is B
+		int clusterA = 0;
+		int clusterB = 0;
+		// True if A and B are neighbours along the X axis
+		bool alongX = true;
+		bool dirty = true;
+		// First tile is in A, second is in B
+		std::vector<std::pair<Vec3<int>, Vec3<int>>> portals;
+		// Global node ids of the first portal on each side, filled when renumbering
+		int firstNodeA = 0;
+		int firstNodeB = 0;
+	};
+
+	class Cluster
+	{
+	  public:
+		Vec3<int> start;
+		Vec3<int> end;
+		std::vector<int> faces;
+		int firstNode = 0;
+		int nodeCount = 0;
+		bool costsValid = false;
+		// nodeCount x nodeCount matrix in local node indices, -1 if no path
+		std::vector<float> costs;
+	};
+
+	TileMap &map;
+	Vec2<int> clusterCount;
+	std::vector<Cluster> clusters;
+	std::vector<Face> faces;
+	bool needsRenumbering = true;
+	// Guards lazy repairs and cost calculations done by queries
+	std::mutex queryMutex;
+
+	// Flattened node data, indexed by global node id
+	std::vector<Vec3<int>> nodePosition;
+	std::vector<int> nodeCluster;
+	std::vector<int> nodePartner;
+
+	int getClusterID(Vec3<int> position) const;
+	void rebuildFace(Face &face);
+	void renumber();
+	void update();
+	void ensureCosts(Cluster &cluster, PathfindingArena *arena);
+	// Cost of path within cluster, or -1 if not found
+	float findClusterPathCost(const Cluster &cluster, Vec3<int> from, Vec3<int> to,
+	                          PathfindingArena *arena) const;
+};
+
+}; // namespace OpenApoc
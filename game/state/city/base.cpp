@@ -534,7 +534,11 @@ int Base::getUsage(GameState &state, sp<Facility> facility, int delta) const
 
 int Base::getUsage(GameState &state, FacilityType::Capacity type, int delta) const
 {
-	int used = getCapacityUsed(state, type) + delta;
+	return getUsageOf(type, getCapacityUsed(state, type) + delta);
+}
+
+int Base::getUsageOf(FacilityType::Capacity type, int used) const
+{
 	int total = getCapacityTotal(type);
 	if (total == 0)
 	{
@@ -60,6 +60,8 @@ class Base : public StateObject, public std::enable_shared_from_this<Base>
 	int getCapacityTotal(FacilityType::Capacity type) const;
 	int getUsage(GameState &state, sp<Facility> facility, int delta = 0) const;
 	int getUsage(GameState &state, FacilityType::Capacity type, int delta = 0) const;
+	// Same as above, for when how much of the capacity is used is already known
+	int getUsageOf(FacilityType::Capacity type, int used) const;
 };
 
 }; // namespace OpenApoc
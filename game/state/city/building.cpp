@@ -848,27 +848,12 @@ void Building::alienMovement(GameState &state)
 	}
 	// Run once when crew landed and once every hour after grow
 	// Pick 15 intact buildings within range of 15 tiles (counting from center to center)
-	std::list<StateRef<Building>> neighbours;
-	for (auto &b : city->buildings)
-	{
-		auto distVec = bounds.p0 + bounds.p1 - b.second->bounds.p0 - b.second->bounds.p1;
-		distVec /= 2;
-		int distance = std::abs(distVec.x) + std::abs(distVec.y);
-		if (distance > 0 && distance <= 15)
-		{
-			neighbours.emplace_back(&state, b.first);
-		}
-		if (neighbours.size() >= 15)
-		{
-			break;
-		}
-	}
-	if (neighbours.empty())
+	if (nearbyBuildings.empty())
 	{
 		return;
 	}
 	// Pick one random of them
-	auto bld = listRandomiser(state.rng, neighbours);
+	auto bld = vectorRandomizer(state.rng, nearbyBuildings);
 	// For every alien calculate move percent as:
 	//   alien's move chance + random 0..30
 	// Calculate amount of moving aliens
@@ -92,6 +92,9 @@ class Building : public StateObject, public std::enable_shared_from_this<Buildin
 	Vec3<int> carEntranceLocation = {-1, -1, -1};
 	std::set<Vec3<int>> landingPadLocations;
 	std::set<Vec3<int>> buildingParts;
+	// Buildings aliens here can move to, the first 15 within 15 tiles (counting from center to
+	// center)
+	std::vector<StateRef<Building>> nearbyBuildings;
 };
 
 }; // namespace OpenApoc
@@ -1,7 +1,9 @@
 #include "game/state/city/city.h"
 #include "framework/framework.h"
+#include "framework/metrics.h"
 #include "framework/sound.h"
 #include "framework/trace.h"
+#include "game/state/city/airspacegraph.h"
 #include "game/state/city/base.h"
 #include "game/state/city/building.h"
 #include "game/state/city/scenery.h"
@@ -20,6 +22,8 @@
 #include "game/state/tilemap/tileobject_projectile.h"
 #include "game/state/tilemap/tileobject_scenery.h"
 #include "game/state/tilemap/tileobject_vehicle.h"
+#include "library/pool.h"
+#include <algorithm>
 #include <functional>
 #include <future>
 #include <glm/glm.hpp>
@@ -28,6 +32,14 @@
 namespace OpenApoc
 {
 
+namespace
+{
+MetricGauge cityProjectilesGauge("Entities", "city projectiles");
+} // anonymous namespace
+
+// Size in tiles of the columns City::vehicleHash buckets vehicles into
+static const float VEHICLE_HASH_CELL_SIZE = 8.0f;
+
 // An ordered list of the types drawn in each layer
 // Within the same layer these are ordered by a calculated z based on the 'center' position
 static std::vector<std::set<TileObject::Type>> layerMap = {
@@ -48,8 +60,13 @@ City::~City()
 		p->tileObject = nullptr;
 	}
 	this->projectiles.clear();
+	this->projectileHash.clear();
+	this->vehicleHash.clear();
+	this->activeScenery.clear();
+	this->damagedScenery.clear();
 	for (auto &s : this->scenery)
 	{
+		s->queuedForRepair = false;
 		if (s->tileObject)
 			s->tileObject->removeFromMap();
 		s->tileObject = nullptr;
@@ -88,6 +105,14 @@ void City::initMap(GameState &state)
 		{
 			this->map->addObjectToMap(s);
 		}
+		if (s->willCollapse() || s->falling)
+		{
+			s->activate();
+		}
+		if (s->damaged || !s->isAlive())
+		{
+			s->queueRepair();
+		}
 		if (!s->building)
 		{
 			continue;
@@ -143,6 +168,26 @@ void City::initMap(GameState &state)
 		}
 		b.second->owner->buildings.emplace_back(&state, b.first);
 	}
+	// Buildings never move, so where aliens can go from each is only found once
+	for (auto &b : this->buildings)
+	{
+		b.second->nearbyBuildings.clear();
+		for (auto &other : this->buildings)
+		{
+			auto distVec = b.second->bounds.p0 + b.second->bounds.p1 - other.second->bounds.p0 -
+			               other.second->bounds.p1;
+			distVec /= 2;
+			int distance = std::abs(distVec.x) + std::abs(distVec.y);
+			if (distance > 0 && distance <= 15)
+			{
+				b.second->nearbyBuildings.emplace_back(&state, other.first);
+			}
+			if (b.second->nearbyBuildings.size() >= 15)
+			{
+				break;
+			}
+		}
+	}
 	for (auto &p : this->projectiles)
 	{
 		this->map->addObjectToMap(p);
@@ -155,6 +200,7 @@ void City::initMap(GameState &state)
 	{
 		this->map->addObjectToMap(p);
 	}
+	this->airspace.reset(new AirspaceGraph(*this->map));
 }
 
 int City::getRoadSegmentID(const Vec3<int> &position) const
@@ -175,6 +221,11 @@ void City::notifyRoadChange(const Vec3<int> &position, bool intact)
 	if (segId != -1)
 	{
 		roadSegments.at(segId).notifyRoadChange(position, intact);
+		roadRouting.notifyChange(segId, intact);
+	}
+	if (airspace)
+	{
+		airspace->notifyChange(position);
 	}
 }
 
@@ -199,7 +250,7 @@ void City::handleProjectileHit(GameState &state, sp<Projectile> projectile, bool
 			auto velocity = glm::normalize(
 			    VehicleType::directionToVector(VehicleType::getDirectionLarge(direction)));
 			velocity *= p->speed * PROJECTILE_VELOCITY_MULTIPLIER;
-			auto newProj = mksp<Projectile>(
+			auto newProj = mkpooled<Projectile>(
 			    p->guided ? Projectile::Type::Missile : Projectile::Type::Beam,
 			    projectile->firerVehicle, projectile->trackedVehicle, projectile->targetPosition,
 			    projectile->position, velocity, p->turn_rate, p->ttl, p->damage, 0, 0, p->tail_size,
@@ -208,6 +259,7 @@ void City::handleProjectileHit(GameState &state, sp<Projectile> projectile, bool
 			    projectile->manualFire);
 			map->addObjectToMap(newProj);
 			projectiles.insert(newProj);
+			projectileHash.insert(newProj->position, newProj);
 			if (p->fire_sfx)
 			{
 				fireSounds.insert(p->fire_sfx);
@@ -221,6 +273,42 @@ void City::handleProjectileHit(GameState &state, sp<Projectile> projectile, bool
 	projectiles.erase(projectile);
 }
 
+void City::updateVehicleHash(GameState &state, unsigned int ticks)
+{
+	vehicleHash.clear();
+	float fastestSpeed = 0.0f;
+	for (auto &pair : state.vehicles)
+	{
+		auto &v = pair.second;
+		if (v->city != this)
+		{
+			continue;
+		}
+		addToVehicleHash(v);
+		if (v->tileObject)
+		{
+			fastestSpeed = std::max(fastestSpeed, v->getSpeed());
+		}
+	}
+	vehicleHashSlack =
+	    fastestSpeed * (float)ticks / (float)TICK_SCALE / VELOCITY_SCALE_CITY.x + 1.0f;
+}
+
+void City::addToVehicleHash(sp<Vehicle> vehicle)
+{
+	// No auto-acquiring of non-aggressive vehicles
+	if (!vehicle->tileObject || vehicle->type->aggressiveness == 0)
+	{
+		return;
+	}
+	auto it = vehicleHash.find(vehicle->owner);
+	if (it == vehicleHash.end())
+	{
+		it = vehicleHash.emplace(vehicle->owner, VEHICLE_HASH_CELL_SIZE).first;
+	}
+	it->second.insert(vehicle->position, vehicle);
+}
+
 void City::update(GameState &state, unsigned int ticks)
 {
 	TRACE_FN_ARGS1("ticks", Strings::fromInteger(static_cast<int>(ticks)));
@@ -229,9 +317,21 @@ void City::update(GameState &state, unsigned int ticks)
 	 * some activity in the city*/
 	std::uniform_int_distribution<int> bld_distribution(0, (int)this->buildings.size() - 1);
 
+	// How many path requests to process per tick per thread
+	static const unsigned int PATH_REQUEST_LIMIT_PER_TICK = 4;
+
+	// Paths requested by vehicles last update, done before anything moves so that every search
+	// in the batch sees the same map
+	Trace::start("City::update::pathRequests->process");
+	auto framework = Framework::tryGetInstance();
+	unsigned int threadCount = framework ? framework->threadPoolGetSize() + 1 : 1;
+	pathRequests.process(PATH_REQUEST_LIMIT_PER_TICK * threadCount * std::max(ticks, 1u));
+	Trace::end("City::update::pathRequests->process");
+
 	// Need to use a 'safe' iterator method (IE keep the next it before calling ->update)
 	// as update() calls can erase it's object from the lists
 
+	cityProjectilesGauge.set(projectiles.size());
 	Trace::start("City::update::projectiles->update");
 	for (auto it = this->projectiles.begin(); it != this->projectiles.end();)
 	{
@@ -240,7 +340,6 @@ void City::update(GameState &state, unsigned int ticks)
 		p->update(state, ticks);
 	}
 	// Since projectiles can kill projectiles just kill everyone in the end
-	std::set<std::tuple<sp<Projectile>, bool, bool>> deadProjectiles;
 	for (auto &p : projectiles)
 	{
 		auto c = p->checkProjectileCollision(*map);
@@ -265,7 +364,7 @@ void City::update(GameState &state, unsigned int ticks)
 				}
 				case TileObject::Type::Projectile:
 				{
-					deadProjectiles.emplace(
+					deadProjectiles.emplace_back(
 					    std::static_pointer_cast<TileObjectProjectile>(c.obj)->getProjectile(),
 					    true, true);
 					break;
@@ -273,20 +372,30 @@ void City::update(GameState &state, unsigned int ticks)
 				default:
 					LogError("Collision with non-collidable object");
 			}
-			deadProjectiles.emplace(c.projectile->shared_from_this(), displayDoodad, playSound);
+			deadProjectiles.emplace_back(c.projectile->shared_from_this(), displayDoodad,
+			                             playSound);
 		}
 	}
 	// Kill projectiles that collided
-	for (auto &p : deadProjectiles)
+	Projectile::dieCollided(state, deadProjectiles);
+	projectileHash.clear();
+	for (auto &p : projectiles)
 	{
-		std::get<0>(p)->die(state, std::get<1>(p), std::get<2>(p));
+		projectileHash.insert(p->position, p);
 	}
-
 	Trace::end("City::update::projectiles->update");
 	Trace::start("City::update::scenery->update");
-	for (auto &s : this->scenery)
+	// Scenery that starts to collapse or fall in here is first updated in the next update
+	std::vector<sp<Scenery>> updatingScenery;
+	updatingScenery.swap(activeScenery);
+	for (auto &s : updatingScenery)
 	{
+		s->active = false;
 		s->update(state, ticks);
+		if (s->tileObject && (s->willCollapse() || s->falling))
+		{
+			s->activate();
+		}
 	}
 	Trace::end("City::update::scenery->update");
 	Trace::start("City::update::doodads->update");
@@ -393,9 +502,40 @@ void City::updateInfiltration(GameState &state)
 
 void City::repairScenery(GameState &state)
 {
+	// Only queued scenery can need repairs, gone through in the order of scenery, which is that of
+	// initial positions
+	std::vector<sp<Scenery>> queued;
+	queued.swap(damagedScenery);
+	std::sort(queued.begin(), queued.end(), [](const sp<Scenery> &a, const sp<Scenery> &b) {
+		return a->initialPosition < b->initialPosition;
+	});
+	for (auto &s : queued)
+	{
+		s->queuedForRepair = false;
+	}
+	// Scenery is kept in the order of initial positions, but go through all of it if not
+	auto findScenery = [this](Vec3<int> initialPosition) -> sp<Scenery> {
+		auto it = std::lower_bound(scenery.begin(), scenery.end(), initialPosition,
+		                           [](const sp<Scenery> &s, const Vec3<int> &position) {
+			                           return s->initialPosition < position;
+		                           });
+		if (it != scenery.end() && (*it)->initialPosition == initialPosition)
+		{
+			return *it;
+		}
+		for (auto &s : scenery)
+		{
+			if (s->initialPosition == initialPosition)
+			{
+				return s;
+			}
+		}
+		return nullptr;
+	};
+
 	// Step 01: Repair damaged scenery one by one
 	std::list<sp<Scenery>> sceneryToUndamage;
-	for (auto &s : scenery)
+	for (auto &s : queued)
 	{
 		if (s->damaged && s->isAlive())
 		{
@@ -416,7 +556,7 @@ void City::repairScenery(GameState &state)
 	}
 	// Step 02: Repair destroyed scenery
 	std::set<sp<Scenery>> sceneryToRepair;
-	for (auto &s : scenery)
+	for (auto &s : queued)
 	{
 		if (!s->isAlive())
 		{
@@ -449,13 +589,10 @@ void City::repairScenery(GameState &state)
 						if (addedPositions.find(p) == addedPositions.end())
 						{
 							// Need to find it by its initial position
-							for (auto &deadScenery : scenery)
+							auto deadScenery = findScenery(p);
+							if (deadScenery)
 							{
-								if (deadScenery->initialPosition == p)
-								{
-									repairedTogether.insert(deadScenery);
-									break;
-								}
+								repairedTogether.insert(deadScenery);
 							}
 						}
 					}
@@ -502,6 +639,30 @@ void City::repairScenery(GameState &state)
 			}
 		}
 	}
+	// What couldn't be afforded is looked at again next time
+	for (auto &s : queued)
+	{
+		if (s->damaged || !s->isAlive())
+		{
+			s->queueRepair();
+		}
+	}
+}
+
+void City::findDamagedScenery()
+{
+	for (auto &s : damagedScenery)
+	{
+		s->queuedForRepair = false;
+	}
+	damagedScenery.clear();
+	for (auto &s : scenery)
+	{
+		if (s->damaged || !s->isAlive())
+		{
+			s->queueRepair();
+		}
+	}
 }
 
 void City::repairVehicles(GameState &state)
@@ -564,88 +725,55 @@ void City::initialSceneryLinkUp()
 	LogWarning("Begun scenery link up!");
 	auto &mapref = *map;
 
+	// Scenery by level, to link up from the ground up
+	std::vector<std::vector<Scenery *>> levels(mapref.size.z);
 	for (auto &s : this->scenery)
 	{
 		if (!s->destroyed)
 		{
 			s->queueCollapse();
+			int z = (int)s->currentPosition.z;
+			if (z >= 0 && z < mapref.size.z)
+			{
+				levels[z].push_back(s.get());
+			}
 		}
 	}
 
-	for (int z = 0; z < mapref.size.z; z++)
+	for (auto &level : levels)
 	{
-		for (auto &s : this->scenery)
+		for (auto s : level)
 		{
-			if ((int)s->currentPosition.z == z && !s->destroyed && s->findSupport())
+			if (s->findSupport())
 			{
 				s->cancelCollapse();
 			}
 		}
 	}
 	LogWarning("Begun scenery link up cycle!");
-	bool foundSupport;
-	// First support without clinging to establish proper links
-	do
+	// Nothing here makes scenery collapse, so only what is still collapsing needs to be tried again
+	std::vector<Scenery *> unlinked;
+	for (auto &s : this->scenery)
 	{
-		foundSupport = false;
-		for (auto &s : this->scenery)
+		if (s->willCollapse())
 		{
-			if (!s->willCollapse())
-			{
-				continue;
-			}
-			if (s->findSupport(false))
-			{
-				s->cancelCollapse();
-				foundSupport = true;
-			}
+			unlinked.push_back(s.get());
 		}
-	} while (foundSupport);
+	}
+	// First support without clinging to establish proper links
+	SupportedMapPart::linkUpCollapsing(unlinked, [](Scenery &s) { return s.findSupport(false); });
 	// Then cling remaining items
-	do
-	{
-		foundSupport = false;
-		for (auto &s : this->scenery)
-		{
-			if (!s->willCollapse())
-			{
-				continue;
-			}
-			if (s->findSupport(true))
-			{
-				s->cancelCollapse();
-				foundSupport = true;
-			}
-		}
-	} while (foundSupport);
+	SupportedMapPart::linkUpCollapsing(unlinked, [](Scenery &s) { return s.findSupport(true); });
 
 	// Report unlinked parts
-	for (auto &mp : this->scenery)
+	for (auto s : unlinked)
 	{
-		if (mp->willCollapse())
-		{
-			auto pos = mp->tileObject->getOwningTile()->position;
-			LogWarning("SC %s at %s is UNLINKED", mp->type.id, pos);
-		}
+		auto pos = s->tileObject->getOwningTile()->position;
+		LogWarning("SC %s at %s is UNLINKED", s->type.id, pos);
 	}
 
 	LogWarning("Attempting link up of unlinked parts");
-	do
-	{
-		foundSupport = false;
-		for (auto &s : this->scenery)
-		{
-			if (!s->willCollapse())
-			{
-				continue;
-			}
-			if (s->attachToSomething())
-			{
-				s->cancelCollapse();
-				foundSupport = true;
-			}
-		}
-	} while (foundSupport);
+	SupportedMapPart::linkUpCollapsing(unlinked, [](Scenery &s) { return s.attachToSomething(); });
 
 	// Report unlinked parts
 	for (auto &mp : this->scenery)
@@ -658,12 +786,14 @@ void City::initialSceneryLinkUp()
 	}
 
 	mapref.updateAllCityInfo();
+	// Everything was queued for collapse on the way, so forget what was queued for repair here
+	findDamagedScenery();
 	LogWarning("Link up finished!");
 }
 
 sp<Doodad> City::placeDoodad(StateRef<DoodadType> type, Vec3<float> position)
 {
-	auto doodad = mksp<Doodad>(position, type);
+	auto doodad = mkpooled<Doodad>(position, type);
 	map->addObjectToMap(doodad);
 	this->doodads.push_back(doodad);
 	return doodad;
@@ -1,11 +1,16 @@
 #pragma once
 
+#include "game/state/city/roadroutingtable.h"
 #include "game/state/stateobject.h"
+#include "game/state/tilemap/pathrequest.h"
 #include "library/sp.h"
+#include "library/spatialhash.h"
 #include "library/vec.h"
 #include <list>
 #include <map>
 #include <set>
+#include <tuple>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -33,6 +38,8 @@ class Agent;
 class ResearchTopic;
 class TileMap;
 class GroundVehicleTileHelper;
+class FlyingVehicleTileHelper;
+class AirspaceGraph;
 
 class RoadSegment
 {
@@ -90,12 +97,34 @@ class City : public StateObject, public std::enable_shared_from_this<City>
 	std::list<Vec3<int>> initial_portals;
 	StateRefMap<Building> buildings;
 	std::vector<sp<Scenery>> scenery;
+	// Not serialized, scenery that is collapsing or falling, which is all of it that needs
+	// updating. Built again in initMap and added to as scenery starts to collapse or fall
+	std::vector<sp<Scenery>> activeScenery;
+	// Not serialized, scenery that was damaged or stopped being alive since it was last looked at
+	// for repairs, which is all of it that can need them. Built again in initMap and added to as
+	// scenery is damaged, collapses or is destroyed
+	std::vector<sp<Scenery>> damagedScenery;
 	std::list<sp<Doodad>> doodads;
 	std::vector<sp<Doodad>> portals;
 
 	std::set<sp<Projectile>> projectiles;
+	// Not serialized, projectiles by position in tiles, built again every update and added to as
+	// they are fired. May still hold projectiles that died since, which have no tileObject
+	SpatialHash<sp<Projectile>> projectileHash{8.0f};
+	// Not serialized, projectiles that collided this update with whether to show the hit doodad
+	// and play its sound, kept between updates to reuse the memory
+	std::vector<std::tuple<sp<Projectile>, bool, bool>> deadProjectiles;
+	// Not serialized, vehicles in the map that may be fired upon on sight, by owner and then by
+	// position in tiles, built again every update before vehicles move and added to as they are
+	// launched. Positions may be off by up to vehicleHashSlack tiles, as vehicles keep moving
+	std::map<StateRef<Organisation>, SpatialHash<sp<Vehicle>>> vehicleHash;
+	float vehicleHashSlack = 0.0f;
 
 	up<TileMap> map;
+	// Not serialized, created in initMap
+	up<AirspaceGraph> airspace;
+	// Not serialized, vehicles request their paths again after loading
+	PathRequestQueue pathRequests;
 
 	// Unlocks when visiting this
 	std::list<StateRef<ResearchTopic>> researchUnlock;
@@ -104,6 +133,8 @@ class City : public StateObject, public std::enable_shared_from_this<City>
 
 	std::vector<int> tileToRoadSegmentMap;
 	std::vector<RoadSegment> roadSegments;
+	// Not serialized, tables are built again when needed
+	RoadRoutingTable roadRouting;
 	int getRoadSegmentID(const Vec3<int> &position) const;
 	const RoadSegment &getRoadSegment(const Vec3<int> &position) const;
 	void notifyRoadChange(const Vec3<int> &position, bool intact);
@@ -122,6 +153,9 @@ class City : public StateObject, public std::enable_shared_from_this<City>
 	                         bool playSound, bool expired);
 
 	void update(GameState &state, unsigned int ticks);
+	// Builds vehicleHash again, for vehicles to move by up to the given ticks each before next
+	void updateVehicleHash(GameState &state, unsigned int ticks);
+	void addToVehicleHash(sp<Vehicle> vehicle);
 	void hourlyLoop(GameState &state);
 	void dailyLoop(GameState &state);
 
@@ -129,6 +163,8 @@ class City : public StateObject, public std::enable_shared_from_this<City>
 	void updateInfiltration(GameState &state);
 	void repairVehicles(GameState &state);
 	void repairScenery(GameState &state);
+	// Fills damagedScenery from all the scenery there is
+	void findDamagedScenery();
 
 	void initialSceneryLinkUp();
 
@@ -153,6 +189,11 @@ class City : public StateObject, public std::enable_shared_from_this<City>
 	                                      bool approachOnly = false, bool ignoreStaticUnits = false,
 	                                      bool ignoreMovingUnits = true,
 	                                      bool ignoreAllUnits = false);
+	// Find shortest path for a flyer, using airspace clusters as a guide if going far
+	std::list<Vec3<int>> findShortestPath(Vec3<int> origin, Vec3<int> destination,
+	                                      int iterationLimit,
+	                                      const FlyingVehicleTileHelper &canEnterTile,
+	                                      PathfindingArena *arena = nullptr);
 
 	// Move a group of vehicles in formation
 	void groupMove(GameState &state, std::list<StateRef<Vehicle>> &selectedVehicles,
@@ -17,6 +17,16 @@
 namespace OpenApoc
 {
 
+namespace
+{
+// Count of an item in an inventory, without adding an entry for it if there is none
+unsigned getInventoryCount(const std::map<UString, unsigned> &inventory, const UString &id)
+{
+	auto it = inventory.find(id);
+	return it == inventory.end() ? 0 : it->second;
+}
+} // anonymous namespace
+
 bool ResearchTopic::isComplete() const
 {
 	return (this->type != ResearchTopic::Type::Engineering) &&
@@ -69,14 +79,14 @@ bool ItemDependency::satisfied(StateRef<Base> base) const
 		int mult = e.first->type == AEquipmentType::Type::Ammo ? e.first->max_ammo : 1;
 		if (e.first->bioStorage)
 		{
-			if (base->inventoryBioEquipment[e.first.id] < e.second * mult)
+			if (getInventoryCount(base->inventoryBioEquipment, e.first.id) < e.second * mult)
 			{
 				return false;
 			}
 		}
 		else
 		{
-			if (base->inventoryAgentEquipment[e.first.id] < e.second * mult)
+			if (getInventoryCount(base->inventoryAgentEquipment, e.first.id) < e.second * mult)
 			{
 				return false;
 			}
@@ -84,7 +94,7 @@ bool ItemDependency::satisfied(StateRef<Base> base) const
 	}
 	for (auto &e : vehicleItemsRequired)
 	{
-		if (base->inventoryVehicleEquipment[e.first.id] < e.second)
+		if (getInventoryCount(base->inventoryVehicleEquipment, e.first.id) < e.second)
 		{
 			return false;
 		}
@@ -0,0 +1,201 @@
+#include "game/state/city/roadroutingtable.h"
+#include "framework/logger.h"
+#include "framework/trace.h"
+#include "game/state/city/city.h"
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace OpenApoc
+{
+
+namespace
+{
+const float UNREACHABLE = std::numeric_limits<float>::infinity();
+} // anonymous namespace
+
+float RoadRoutingTable::getCost(const std::vector<RoadSegment> &segments, int destination,
+                                int segment, int entrance)
+{
+	if (segment < 0 || segment >= (int)segments.size() || destination < 0 ||
+	    destination >= (int)segments.size())
+	{
+		return -1.0f;
+	}
+	auto &table = getTable(segments, destination);
+	auto cost = table.costs[segment * 2 + entrance];
+	return cost == UNREACHABLE ? -1.0f : cost;
+}
+
+bool RoadRoutingTable::getRoute(const std::vector<RoadSegment> &segments, int destination,
+                                int segment, int entrance, std::list<int> &route)
+{
+	if (getCost(segments, destination, segment, entrance) < 0.0f)
+	{
+		return false;
+	}
+	auto &table = getTable(segments, destination);
+	// Every step gets strictly closer, this only guards against a broken table
+	int stepsLeft = (int)table.costs.size();
+	while (segment != destination)
+	{
+		int state = segment * 2 + entrance;
+		segment = table.nextSegment[state];
+		entrance = table.nextEntrance[state];
+		if (segment == -1 || stepsLeft-- == 0)
+		{
+			LogError("Broken road routing table towards segment %d", destination);
+			return false;
+		}
+		route.push_back(segment);
+	}
+	return true;
+}
+
+void RoadRoutingTable::notifyChange(int segment, bool repaired)
+{
+	if (repaired)
+	{
+		clear();
+		return;
+	}
+	for (auto it = tables.begin(); it != tables.end();)
+	{
+		auto &usedAsHop = it->second.usedAsHop;
+		if (segment >= 0 && segment < (int)usedAsHop.size() && usedAsHop[segment])
+		{
+			recentlyUsed.erase(it->second.lastUse);
+			it = tables.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+void RoadRoutingTable::clear()
+{
+	tables.clear();
+	recentlyUsed.clear();
+}
+
+RoadRoutingTable::Table &RoadRoutingTable::getTable(const std::vector<RoadSegment> &segments,
+                                                    int destination)
+{
+	auto it = tables.find(destination);
+	if (it != tables.end())
+	{
+		recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second.lastUse);
+		return it->second;
+	}
+
+	while (tables.size() >= MAX_TABLES)
+	{
+		tables.erase(recentlyUsed.back());
+		recentlyUsed.pop_back();
+	}
+	auto &table = tables[destination];
+	build(segments, destination, table);
+	recentlyUsed.push_front(destination);
+	table.lastUse = recentlyUsed.begin();
+	return table;
+}
+
+void RoadRoutingTable::build(const std::vector<RoadSegment> &segments, int destination,
+                             Table &table) const
+{
+	TRACE_FN;
+	int count = (int)segments.size();
+	table.costs.assign(count * 2, UNREACHABLE);
+	table.nextSegment.assign(count * 2, -1);
+	table.nextEntrance.assign(count * 2, -1);
+	table.usedAsHop.assign(count, false);
+
+	// Search backwards from destination, which counts as reached no matter the end entered from
+	using Entry = std::pair<float, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> fringe;
+	for (int entrance = 0; entrance < (segments[destination].length > 1 ? 2 : 1); entrance++)
+	{
+		table.costs[destination * 2 + entrance] = 0.0f;
+		fringe.push({0.0f, destination * 2 + entrance});
+	}
+	std::vector<int> previousIDs;
+	while (!fringe.empty())
+	{
+		auto entry = fringe.top();
+		fringe.pop();
+		if (entry.first > table.costs[entry.second])
+		{
+			continue;
+		}
+		int thisID = entry.second / 2;
+		int thisEntrance = entry.second % 2;
+		auto &thisSeg = segments[thisID];
+		// Nobody can come in through here
+		if (!thisSeg.getIntactByConnectID(thisEntrance))
+		{
+			continue;
+		}
+		// Roads can only be entered from the segment at the same end, intersections from any
+		previousIDs.clear();
+		if (thisSeg.length > 1)
+		{
+			if (thisEntrance < (int)thisSeg.connections.size())
+			{
+				previousIDs.push_back(thisSeg.connections[thisEntrance]);
+			}
+		}
+		else
+		{
+			previousIDs.assign(thisSeg.connections.begin(), thisSeg.connections.end());
+		}
+		for (auto previousID : previousIDs)
+		{
+			if (previousID < 0 || previousID >= count)
+			{
+				continue;
+			}
+			auto &previousSeg = segments[previousID];
+			// Broken segments can't be passed through
+			if (!previousSeg.intact)
+			{
+				continue;
+			}
+			float newCost = entry.first + previousSeg.length;
+			for (int previousEntrance = 0; previousEntrance < (previousSeg.length > 1 ? 2 : 1);
+			     previousEntrance++)
+			{
+				// Roads are left through the end opposite to the one they were entered from
+				if (previousSeg.length > 1)
+				{
+					int exit = 1 - previousEntrance;
+					if (exit >= (int)previousSeg.connections.size() ||
+					    previousSeg.connections[exit] != thisID)
+					{
+						continue;
+					}
+				}
+				int previousState = previousID * 2 + previousEntrance;
+				if (newCost < table.costs[previousState])
+				{
+					table.costs[previousState] = newCost;
+					table.nextSegment[previousState] = thisID;
+					table.nextEntrance[previousState] = thisEntrance;
+					fringe.push({newCost, previousState});
+				}
+			}
+		}
+	}
+
+	for (auto next : table.nextSegment)
+	{
+		if (next != -1)
+		{
+			table.usedAsHop[next] = true;
+		}
+	}
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class RoadSegment;
+
+// Next-hop routing over the city's road segment graph.
+//
+// For every destination segment asked about, one backwards search over the intact roads gives
+// the cost and the next segment to take from every segment, so any later route to the same
+// destination is only a walk along the table. A road can only be left through the end opposite
+// to the one it was entered from, so roads get an entry for each of their ends.
+//
+// Damage only drops the tables that routed through the damaged segment, while a repair could
+// make a route shorter anywhere and drops them all. The least recently used tables are dropped
+// once there are more than MAX_TABLES of them.
+class RoadRoutingTable
+{
+  public:
+	static const unsigned int MAX_TABLES = 128;
+
+	// Cost of getting from a segment, entered through the given end (always 0 for intersections),
+	// to the destination segment, or a negative value if it can't be reached
+	float getCost(const std::vector<RoadSegment> &segments, int destination, int segment,
+	              int entrance);
+	// Append the segments after this one up to and including destination to the route.
+	// Returns false if destination can't be reached
+	bool getRoute(const std::vector<RoadSegment> &segments, int destination, int segment,
+	              int entrance, std::list<int> &route);
+
+	// Must be called whenever a tile of a segment changes its intact state
+	void notifyChange(int segment, bool repaired);
+	// Must be called whenever the segments are rebuilt
+	void clear();
+
+  private:
+	class Table
+	{
+	  public:
+		// Indexed by segment * 2 + entrance
+		std::vector<float> costs;
+		std::vector<int> nextSegment;
+		std::vector<int> nextEntrance;
+		// Segments some route in this table passes through
+		std::vector<bool> usedAsHop;
+		// Position in the recently used list
+		std::list<int>::iterator lastUse;
+	};
+
+	std::unordered_map<int, Table> tables;
+	// Destinations, most recently used first
+	std::list<int> recentlyUsed;
+
+	Table &getTable(const std::vector<RoadSegment> &segments, int destination);
+	void build(const std::vector<RoadSegment> &segments, int destination, Table &table) const;
+};
+
+}; // namespace OpenApoc
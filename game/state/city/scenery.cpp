@@ -33,6 +33,28 @@ void Scenery::ceaseSupportProvision()
 void Scenery::queueCollapse(unsigned additionalDelay)
 {
 	ticksUntilCollapse = TICKS_MULTIPLIER + additionalDelay;
+	activate();
+	queueRepair();
+}
+
+void Scenery::activate()
+{
+	if (active || !city)
+	{
+		return;
+	}
+	active = true;
+	city->activeScenery.push_back(shared_from_this());
+}
+
+void Scenery::queueRepair()
+{
+	if (queuedForRepair || !city)
+	{
+		return;
+	}
+	queuedForRepair = true;
+	city->damagedScenery.push_back(shared_from_this());
 }
 
 void Scenery::cancelCollapse() { ticksUntilCollapse = 0; }
@@ -1256,6 +1278,7 @@ bool Scenery::applyDamage(GameState &state, int power, StateRef<Organisation> at
 
 void Scenery::die(GameState &state, bool forced)
 {
+	queueRepair();
 	if (falling)
 	{
 		// Spawn explosion doodad at us
@@ -1424,6 +1447,7 @@ void Scenery::collapse(GameState &state)
 	{
 		return;
 	}
+	queueRepair();
 	// Level 0 can't collapse
 	if (this->initialPosition.z <= 1)
 	{
@@ -1434,6 +1458,7 @@ void Scenery::collapse(GameState &state)
 	{
 		LogWarning("Scenery at %s type %s now falling", currentPosition, type.id);
 		falling = true;
+		activate();
 		// state.current_battle->queueVisionRefresh(position);
 		// state.current_battle->queuePathfindingRefresh(position);
 		// Note: Pathfinding refresh relies on tile's battlescape parameters being updated
@@ -1504,8 +1529,9 @@ void Scenery::updateFalling(GameState &state, unsigned int ticks)
 	std::set<sp<Scenery>> killedScenery;
 	if (floorf(newPosition.z) != floorf(currentPosition.z))
 	{
-		// Leaving tile: collide with everything left
-		for (auto &obj : tileObject->getOwningTile()->ownedObjects)
+		// Leaving tile: collide with everything left, vehicles hurt here may crash and leave it
+		auto objects = tileObject->getOwningTile()->ownedObjects;
+		for (auto &obj : objects)
 		{
 			switch (obj->getType())
 			{
@@ -1656,7 +1682,8 @@ void Scenery::repair(GameState &state)
 	{
 		building->buildingPartChange(state, initialPosition, true);
 	}
-	map.clearPathCaches();
+	city->notifyRoadChange(initialPosition, true);
+	map.invalidatePathCaches(initialPosition);
 }
 
 bool Scenery::isAlive() const
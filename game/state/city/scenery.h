@@ -83,6 +83,14 @@ class Scenery : public SupportedMapPart, public std::enable_shared_from_this<Sce
 	sp<Doodad> overlayDoodad;
 	StateRef<Building> building;
 	StateRef<City> city;
+	// Set while the scenery is in its city's activeScenery
+	bool active = false;
+	// Puts the scenery in its city's activeScenery, for when it starts collapsing or falling
+	void activate();
+	// Set while the scenery is in its city's damagedScenery
+	bool queuedForRepair = false;
+	// Puts the scenery in its city's damagedScenery, for when it could need repairs
+	void queueRepair();
 
 	Scenery();
 	~Scenery() = default;
@@ -29,6 +29,7 @@
 #include "game/state/tilemap/tileobject_projectile.h"
 #include "game/state/tilemap/tileobject_shadow.h"
 #include "game/state/tilemap/tileobject_vehicle.h"
+#include "library/batchgeometry.h"
 #include "library/sp.h"
 #include <glm/glm.hpp>
 #include <glm/gtx/vector_angle.hpp>
@@ -42,7 +43,23 @@ namespace OpenApoc
 namespace
 {
 static const float M_2xPI = 2.0f * M_PI;
+
+// Clears keep[i] for every position outside the firing arc of a vehicle at position facing that
+// way, arc being in eighths of a half turn to either side of facing and above or below the plane
+void keepWithinFiringArc(const PositionBatch<float> &positions, Vec3<float> position,
+                         Vec3<float> facing, Vec2<int> arc, uint8_t *keep)
+{
+	if (arc.x < 8)
+	{
+		keepWithinArcXY(positions, position, glm::normalize(Vec2<float>{facing.x, facing.y}),
+		                cosf((float)arc.x * (float)M_PI / 8.0f), keep);
+	}
+	if (arc.y < 8)
+	{
+		keepWithinElevation(positions, position, cosf((float)arc.y * (float)M_PI / 8.0f), keep);
+	}
 }
+} // anonymous namespace
 
 const UString &Vehicle::getPrefix()
 {
@@ -461,7 +478,9 @@ class FlyingVehicleMover : public VehicleMover
 				vehicle.popFinishedMissions(state);
 				// Vehicle is considered idle if at goal even if there's more missions to do
 				updateIdle(state);
-				int turboTiles = state.skipTurboCalculations ? ticksToMove / ticksPerTile : 0;
+				int turboTiles = state.skipTurboCalculations || vehicle.coarseTurbo
+				                     ? ticksToMove / ticksPerTile
+				                     : 0;
 				int turboTilesBefore = turboTiles;
 				// Get new goal from mission
 				if (!vehicle.getNewGoal(state, turboTiles))
@@ -714,7 +733,9 @@ class GroundVehicleMover : public VehicleMover
 					vehicle.popFinishedMissions(state);
 					// Vehicle is considered idle if at goal even if there's more missions to do
 					updateIdle(state);
-					int turboTiles = state.skipTurboCalculations ? ticksToMove / ticksPerTile : 0;
+					int turboTiles = state.skipTurboCalculations || vehicle.coarseTurbo
+					                     ? ticksToMove / ticksPerTile
+					                     : 0;
 					int turboTilesBefore = turboTiles;
 					// Get new goal from mission
 					if (!vehicle.getNewGoal(state, turboTiles))
@@ -1301,6 +1322,7 @@ void Vehicle::leaveDimensionGate(GameState &state)
 	if (city->map)
 	{
 		city->map->addObjectToMap(state, shared_from_this());
+		city->addToVehicleHash(shared_from_this());
 	}
 	if (state.current_city == city)
 	{
@@ -1359,6 +1381,7 @@ void Vehicle::leaveBuilding(GameState &state, Vec3<float> initialPosition, float
 	if (city->map)
 	{
 		city->map->addObjectToMap(state, shared_from_this());
+		city->addToVehicleHash(shared_from_this());
 	}
 }
 
@@ -2552,66 +2575,70 @@ bool Vehicle::handleCollision(GameState &state, Collision &c, bool &soundHandled
 sp<TileObjectVehicle> Vehicle::findClosestEnemy(GameState &state, sp<TileObjectVehicle> vehicleTile,
                                                 Vec2<int> arc)
 {
-	// Find the closest enemy within the firing arc
-	float closestEnemyRange = std::numeric_limits<float>::max();
-	sp<TileObjectVehicle> closestEnemy;
-	for (auto &pair : state.vehicles)
-	{
-		auto otherVehicle = pair.second;
+	// Find the closest enemy within the firing arc, anything further than our longest range
+	// could not be fired at anyway
+	auto &velocityScale = vehicleTile->map.velocityScale;
+	float searchRadius = getFiringRange() / std::min(velocityScale.x, velocityScale.y) +
+	                     this->city->vehicleHashSlack;
+	// Whatever passes the checks that need the vehicle itself, the arc and distance then being
+	// worked out for all of them at once
+	std::vector<sp<TileObjectVehicle>> candidates;
+	PositionBatch<float> positions;
+	PositionBatch<float> centres;
+	auto checkVehicle = [&](const sp<Vehicle> &otherVehicle) {
 		if (otherVehicle.get() == this)
 		{
 			/* Can't fire at yourself */
-			continue;
+			return;
 		}
 		if (otherVehicle->crashed || otherVehicle->falling || otherVehicle->sliding)
 		{
 			// Can't auto-fire at crashed vehicles
-			continue;
-		}
-		if (otherVehicle->type->aggressiveness == 0)
-		{
-			// No auto-acquiring of non-aggressive vehicles
-			continue;
+			return;
 		}
 		if (otherVehicle->city != this->city)
 		{
 			/* Can't fire on things a world away */
-			continue;
-		}
-		if (this->owner->isRelatedTo(otherVehicle->owner) != Organisation::Relation::Hostile)
-		{
-			/* Not hostile, skip */
-			continue;
+			return;
 		}
 		auto otherVehicleTile = otherVehicle->tileObject;
 		if (!otherVehicleTile)
 		{
 			/* Not in the map, ignore */
-			continue;
+			return;
 		}
-		// Check firing arc
-		if (type->type != VehicleType::Type::UFO && (arc.x < 8 || arc.y < 8))
+		candidates.push_back(otherVehicleTile);
+		positions.push_back(otherVehicleTile->getPosition());
+		centres.push_back(otherVehicleTile->getCenter());
+	};
+	// Relations are the same for every vehicle of an owner, so are only looked up once for each
+	for (auto &pair : this->city->vehicleHash)
+	{
+		if (this->owner->isRelatedTo(pair.first) != Organisation::Relation::Hostile)
 		{
-			auto facing = type->directionToVector(direction);
-			auto vecToTarget = otherVehicleTile->getPosition() - position;
-			float angleXY = glm::angle(glm::normalize(Vec2<float>{facing.x, facing.y}),
-			                           glm::normalize(Vec2<float>{vecToTarget.x, vecToTarget.y}));
-			float vecToTargetXY =
-			    sqrtf(vecToTarget.x * vecToTarget.x + vecToTarget.y * vecToTarget.y);
-			float angleZ = glm::angle(Vec2<float>{1.0f, 0.0f},
-			                          glm::normalize(Vec2<float>{vecToTargetXY, vecToTarget.z}));
-			if (angleXY > (float)arc.x * (float)M_PI / 8.0f ||
-			    angleZ > (float)arc.y * (float)M_PI / 8.0f)
-			{
-				continue;
-			}
+			/* Not hostile, skip */
+			continue;
 		}
-		// Finally add closest
-		float distance = vehicleTile->getDistanceTo(otherVehicleTile);
-		if (distance < closestEnemyRange)
+		pair.second.forEachNear(position, searchRadius, checkVehicle);
+	}
+
+	std::vector<uint8_t> keep(candidates.size(), 1);
+	if (type->type != VehicleType::Type::UFO && (arc.x < 8 || arc.y < 8))
+	{
+		keepWithinFiringArc(positions, position, type->directionToVector(direction), arc,
+		                    keep.data());
+	}
+	std::vector<float> distances(candidates.size());
+	distancesSquared(centres, vehicleTile->getCenter(), velocityScale, distances.data());
+	// Finally pick the closest
+	float closestEnemyRange = std::numeric_limits<float>::max();
+	sp<TileObjectVehicle> closestEnemy;
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		if (keep[i] && distances[i] < closestEnemyRange)
 		{
-			closestEnemyRange = distance;
-			closestEnemy = otherVehicleTile;
+			closestEnemyRange = distances[i];
+			closestEnemy = candidates[i];
 		}
 	}
 	return closestEnemy;
@@ -2621,47 +2648,56 @@ sp<TileObjectProjectile> Vehicle::findClosestHostileMissile(GameState &state,
                                                             sp<TileObjectVehicle> vehicleTile,
                                                             Vec2<int> arc)
 {
-	// Find the closest missile within the firing arc
-	float closestEnemyRange = std::numeric_limits<float>::max();
-	sp<TileObjectProjectile> closestEnemy;
-	for (auto &projectile : state.current_city->projectiles)
-	{
+	// Find the closest missile within the firing arc, anything further than our longest range
+	// could not be fired at anyway
+	float firingRange = getFiringRange();
+	auto &velocityScale = vehicleTile->map.velocityScale;
+	float searchRadius = firingRange / std::min(velocityScale.x, velocityScale.y);
+	// As in findClosestEnemy, the arc and distance are worked out for every candidate at once
+	std::vector<sp<TileObjectProjectile>> candidates;
+	PositionBatch<float> positions;
+	auto checkProjectile = [&](const sp<Projectile> &projectile) {
+		// Died since the hash was built
+		if (!projectile->tileObject)
+		{
+			return;
+		}
 		// Can't shoot down projectiles w/o voxelMap
 		if (!projectile->voxelMapLof)
 		{
-			continue;
+			return;
 		}
 #ifndef DEBUG_ALLOW_PROJECTILE_ON_PROJECTILE_FRIENDLY_FIRE
 		// Can't fire at friendly projectiles
 		if (projectile->firerVehicle->owner == owner ||
 		    owner->isRelatedTo(projectile->firerVehicle->owner) != Organisation::Relation::Hostile)
 		{
-			continue;
+			return;
 		}
 #endif // ! DEBUG_ALLOW_PROJECTILE_ON_PROJECTILE_FRIENDLY_FIRE
-		// Check firing arc
-		if (type->type != VehicleType::Type::UFO && (arc.x < 8 || arc.y < 8))
-		{
-			auto facing = type->directionToVector(direction);
-			auto vecToTarget = projectile->getPosition() - position;
-			float angleXY = glm::angle(glm::normalize(Vec2<float>{facing.x, facing.y}),
-			                           glm::normalize(Vec2<float>{vecToTarget.x, vecToTarget.y}));
-			float vecToTargetXY =
-			    sqrtf(vecToTarget.x * vecToTarget.x + vecToTarget.y * vecToTarget.y);
-			float angleZ = glm::angle(Vec2<float>{1.0f, 0.0f},
-			                          glm::normalize(Vec2<float>{vecToTargetXY, vecToTarget.z}));
-			if (angleXY > (float)arc.x * (float)M_PI / 8.0f ||
-			    angleZ > (float)arc.y * (float)M_PI / 8.0f)
-			{
-				continue;
-			}
-		}
-		// Finally add closest
-		float distance = vehicleTile->getDistanceTo(projectile->position);
-		if (distance < closestEnemyRange)
+		candidates.push_back(projectile->tileObject);
+		positions.push_back(projectile->getPosition());
+	};
+	state.current_city->projectileHash.forEachNear(position, searchRadius, checkProjectile);
+
+	std::vector<uint8_t> keep(candidates.size(), 1);
+	if (type->type != VehicleType::Type::UFO && (arc.x < 8 || arc.y < 8))
+	{
+		keepWithinFiringArc(positions, position, type->directionToVector(direction), arc,
+		                    keep.data());
+	}
+	std::vector<float> distances(candidates.size());
+	distancesSquared(positions, vehicleTile->getCenter(), velocityScale, distances.data());
+	// Finally pick the closest in range
+	float rangeSquared = firingRange * firingRange;
+	float closestEnemyRange = std::numeric_limits<float>::max();
+	sp<TileObjectProjectile> closestEnemy;
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		if (keep[i] && distances[i] <= rangeSquared && distances[i] < closestEnemyRange)
 		{
-			closestEnemyRange = distance;
-			closestEnemy = projectile->tileObject;
+			closestEnemyRange = distances[i];
+			closestEnemy = candidates[i];
 		}
 	}
 	return closestEnemy;
@@ -2822,8 +2858,9 @@ sp<VEquipment> Vehicle::getFirstFiringWeapon(GameState &state, Vec3<float> &targ
                                              Vec3<float> targetVelocity,
                                              sp<TileObjectVehicle> enemyTile, bool pd)
 {
-	static const std::set<TileObject::Type> sceneryVehicleSet = {TileObject::Type::Scenery,
-	                                                             TileObject::Type::Vehicle};
+	static const TileObject::TypeMask sceneryVehicleTypes =
+	    TileObject::getTypeMask(TileObject::Type::Scenery) |
+	    TileObject::getTypeMask(TileObject::Type::Vehicle);
 
 	sp<VEquipment> firingWeapon;
 
@@ -2893,6 +2930,16 @@ sp<VEquipment> Vehicle::getFirstFiringWeapon(GameState &state, Vec3<float> &targ
 		return nullptr;
 	}
 
+	auto &map = tileObject->map;
+	Vec3<int> fromTile = position;
+	Vec3<int> targetTile = target;
+	if (checkLOF && fireBlockedFrom == fromTile && fireBlockedAt == targetTile &&
+	    fireBlockedRevision == map.getSceneryRevision() &&
+	    state.gameTime.getTicks() < fireBlockedUntil)
+	{
+		return nullptr;
+	}
+
 	int attepmpt = 1;
 	auto originalTarget = target;
 	if (!checkLOF)
@@ -2912,13 +2959,18 @@ sp<VEquipment> Vehicle::getFirstFiringWeapon(GameState &state, Vec3<float> &targ
 	// Check if have sight to target
 	// Two attempts, at second attempt try to fire at target itself
 	bool hitSomethingBad = false;
+	bool hitScenery = false;
 	for (int i = attepmpt; i < 2; i++)
 	{
 		hitSomethingBad = false;
+		hitScenery = false;
 		// Checking los as otherwise we're colliding with ground when firing at bogus voxelmaps like
 		// bikes
-		auto hitObject = tileObject->map.findCollision(firePosition, target, sceneryVehicleSet,
-		                                               tileObject, true);
+		CollisionOptions options;
+		options.validTypes = sceneryVehicleTypes;
+		options.ignoredObject = tileObject;
+		options.useLOS = true;
+		auto hitObject = map.findCollision(firePosition, target, options);
 		if (hitObject)
 		{
 			if (hitObject.obj->getType() == TileObject::Type::Vehicle)
@@ -2934,6 +2986,7 @@ sp<VEquipment> Vehicle::getFirstFiringWeapon(GameState &state, Vec3<float> &targ
 			else if (hitObject.obj->getType() == TileObject::Type::Scenery)
 			{
 				hitSomethingBad = true;
+				hitScenery = true;
 			}
 		}
 		if (hitSomethingBad)
@@ -2948,6 +3001,14 @@ sp<VEquipment> Vehicle::getFirstFiringWeapon(GameState &state, Vec3<float> &targ
 	}
 	if (hitSomethingBad)
 	{
+		// Vehicles in the way move on, but scenery is going to stay there for a while
+		if (hitScenery)
+		{
+			fireBlockedFrom = fromTile;
+			fireBlockedAt = targetTile;
+			fireBlockedRevision = map.getSceneryRevision();
+			fireBlockedUntil = state.gameTime.getTicks() + TICKS_FIRE_BLOCKED_DELAY;
+		}
 		return nullptr;
 	}
 
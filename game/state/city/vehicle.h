@@ -21,6 +21,9 @@ static const Vec3<float> SMOKE_DOODAD_SHIFT{0.0f, 0.0f, 0.25f};
 static const unsigned CLOAK_TICKS_REQUIRED_VEHICLE = TICKS_PER_SECOND * 3 / 2;
 static const unsigned TELEPORT_TICKS_REQUIRED_VEHICLE = TICKS_PER_SECOND * 30;
 static const unsigned TICKS_AUTO_ACTION_DELAY = TICKS_PER_SECOND / 4;
+// How long a line of fire found blocked by scenery is taken to stay blocked, see
+// getFirstFiringWeapon
+static const unsigned TICKS_FIRE_BLOCKED_DELAY = TICKS_PER_SECOND / 4;
 static const unsigned TICKS_CARGO_TTL = 6 * TICKS_PER_HOUR;
 static const unsigned TICKS_CARGO_WARNING = TICKS_PER_HOUR;
 
@@ -208,6 +211,9 @@ class Vehicle : public StateObject,
 	bool crashed = false;
 	bool falling = false;
 	bool sliding = false;
+	// Not serialized, set only for the update of a turbo step, in which the vehicle is far enough
+	// from the player's that it moves whole tiles at once as with skipTurboCalculations
+	bool coarseTurbo = false;
 	int fuelSpentTicks = 0;
 	// Cloak, increases each turn, set to 0 when firing or no cloaking device on vehicle
 	// Vehicle is cloaked when this is >= CLOAK_TICKS_REQUIRED_VEHICLE
@@ -375,6 +381,12 @@ class Vehicle : public StateObject,
   private:
 	Vec3<float> manualFirePosition = {0.0f, 0.0f, 0.0f};
 	bool manualFire = false;
+	// Tiles between which scenery was last found in the line of fire, taken to still be in the
+	// way until fireBlockedUntil unless either end leaves its tile or the scenery changes
+	Vec3<int> fireBlockedFrom = {-1, -1, -1};
+	Vec3<int> fireBlockedAt = {-1, -1, -1};
+	unsigned int fireBlockedRevision = 0;
+	uint64_t fireBlockedUntil = 0;
 	std::list<sp<VEquipmentType>> getEquipmentTypes() const;
 };
 
@@ -547,30 +547,44 @@ VehicleMission *VehicleMission::selfDestruct(GameState &state, Vehicle &v)
 }
 
 VehicleMission *VehicleMission::arriveFromDimensionGate(GameState &state, Vehicle &v, int ticks)
+{
+	int lastArrival = getLastDimensionGateArrival(state, v.city, v.owner);
+	return arriveFromDimensionGate(state, v, ticks, lastArrival);
+}
+
+VehicleMission *VehicleMission::arriveFromDimensionGate(GameState &, Vehicle &, int ticks,
+                                                        int &lastArrival)
 {
 	auto *mission = new VehicleMission();
 	mission->type = MissionType::ArriveFromDimensionGate;
-	// find max delay arrival and increment
-	int lastTicks = -DIMENSION_GATE_DELAY;
-	for (auto &v2 : state.vehicles)
+	// Arrive after the last one
+	if (lastArrival == -DIMENSION_GATE_DELAY)
+	{
+		lastArrival += ticks;
+	}
+	mission->timeToSnooze = lastArrival + DIMENSION_GATE_DELAY;
+	lastArrival = mission->timeToSnooze;
+	return mission;
+}
+
+int VehicleMission::getLastDimensionGateArrival(GameState &state, StateRef<City> city,
+                                                StateRef<Organisation> owner)
+{
+	int lastArrival = -DIMENSION_GATE_DELAY;
+	for (auto &v : state.vehicles)
 	{
-		if (v2.second->city == v.city && v2.second->owner == v.owner)
+		if (v.second->city == city && v.second->owner == owner)
 		{
-			for (auto &m : v2.second->missions)
+			for (auto &m : v.second->missions)
 			{
 				if (m->type == MissionType::ArriveFromDimensionGate)
 				{
-					lastTicks = std::max(lastTicks, (int)m->timeToSnooze);
+					lastArrival = std::max(lastArrival, (int)m->timeToSnooze);
 				}
 			}
 		}
 	}
-	if (lastTicks == -DIMENSION_GATE_DELAY)
-	{
-		lastTicks += ticks;
-	}
-	mission->timeToSnooze = lastTicks + DIMENSION_GATE_DELAY;
-	return mission;
+	return lastArrival;
 }
 
 VehicleMission *VehicleMission::restartNextMission(GameState &, Vehicle &)
@@ -1034,10 +1048,11 @@ bool VehicleMission::teleportCheck(GameState &state, Vehicle &v)
 bool VehicleMission::getNextDestination(GameState &state, Vehicle &v, Vec3<float> &destPos,
                                         float &destFacing, int &turboTiles)
 {
-	static const std::set<TileObject::Type> sceneryVehicleSet = {TileObject::Type::Scenery,
-	                                                             TileObject::Type::Vehicle};
+	static const TileObject::TypeMask sceneryVehicleTypes =
+	    TileObject::getTypeMask(TileObject::Type::Scenery) |
+	    TileObject::getTypeMask(TileObject::Type::Vehicle);
 
-	if (cancelled)
+	if (isWaitingForPath(v) || cancelled)
 	{
 		return false;
 	}
@@ -1163,9 +1178,12 @@ bool VehicleMission::getNextDestination(GameState &state, Vehicle &v, Vec3<float
 
 					// Have LOS if first thing we hit is target vehicle or not scenery
 					bool haveLOS = true;
-					auto hitObject =
-					    vTile->map.findCollision(v.position, targetTile->getVoxelCentrePosition(),
-					                             sceneryVehicleSet, vTile, true);
+					CollisionOptions options;
+					options.validTypes = sceneryVehicleTypes;
+					options.ignoredObject = vTile;
+					options.useLOS = true;
+					auto hitObject = vTile->map.findCollision(
+					    v.position, targetTile->getVoxelCentrePosition(), options);
 					if (hitObject)
 					{
 						if (hitObject.obj->getType() == TileObject::Type::Vehicle)
@@ -1275,6 +1293,10 @@ bool VehicleMission::getNextDestination(GameState &state, Vehicle &v, Vec3<float
 
 void VehicleMission::update(GameState &state, Vehicle &v, unsigned int ticks, bool finished)
 {
+	if (isWaitingForPath(v))
+	{
+		return;
+	}
 	finished = finished || isFinishedInternal(state, v);
 	switch (this->type)
 	{
@@ -1451,6 +1473,10 @@ bool VehicleMission::isFinished(GameState &state, Vehicle &v, bool callUpdateIfF
 
 bool VehicleMission::isFinishedInternal(GameState &state, Vehicle &v)
 {
+	if (isWaitingForPath(v))
+	{
+		return false;
+	}
 	if (cancelled)
 	{
 		return true;
@@ -2598,6 +2624,11 @@ void VehicleMission::setPathTo(GameState &state, Vehicle &v, Vec3<int> target, i
                                bool checkValidity, bool giveUpIfInvalid)
 {
 	currentPlannedPath.clear();
+	if (pathRequest)
+	{
+		pathRequest->cancel();
+		pathRequest = nullptr;
+	}
 	auto vehicleTile = v.tileObject;
 	if (vehicleTile)
 	{
@@ -2629,63 +2660,120 @@ void VehicleMission::setPathTo(GameState &state, Vehicle &v, Vec3<int> target, i
 			return;
 		}
 
-		std::list<Vec3<int>> path;
-		float distance = 0.0f;
 		auto position = vehicleTile->getOwningTile()->position;
+		auto &city = *v.city;
 		switch (v.type->type)
 		{
 			case VehicleType::Type::Road:
-				path = v.city->findShortestPath(position, target,
-				                                GroundVehicleTileHelper{*v.city->map, v});
-				distance = GroundVehicleTileHelper::getDistanceStatic(position, target);
-				break;
+				// Road network search is cheap enough to do right away
+				setPath(v, city.findShortestPath(position, target,
+				                                 GroundVehicleTileHelper{*city.map, v}),
+				        target, maxIterations, giveUpIfInvalid);
+				return;
 			case VehicleType::Type::ATV:
-				path = v.city->map->findShortestPath(position, target, maxIterations,
-				                                     GroundVehicleTileHelper{*v.city->map, v});
-				distance = GroundVehicleTileHelper::getDistanceStatic(position, target);
+			{
+				GroundVehicleTileHelper helper{*city.map, v};
+				pathRequest = city.pathRequests.request(
+				    [&city, position, target, maxIterations, helper](PathfindingArena &arena) {
+					    return city.map->findShortestPath(position, target, maxIterations, helper,
+					                                      false, false, true, false, nullptr, 0.0f,
+					                                      &arena);
+				    },
+				    isPlayerSelected(v));
 				break;
+			}
 			case VehicleType::Type::Flying:
 			case VehicleType::Type::UFO:
-				path = v.city->map->findShortestPath(position, target, maxIterations,
-				                                     FlyingVehicleTileHelper{*v.city->map, v});
-				distance = FlyingVehicleTileHelper::getDistanceStatic(position, target);
+			{
+				FlyingVehicleTileHelper helper{*city.map, v};
+				pathRequest = city.pathRequests.request(
+				    [&city, position, target, maxIterations, helper](PathfindingArena &arena) {
+					    return city.findShortestPath(position, target, maxIterations, helper,
+					                                 &arena);
+				    },
+				    isPlayerSelected(v));
 				break;
+			}
 		}
+		pathRequestOrigin = position;
+		pathRequestTarget = target;
+		pathRequestIterations = maxIterations;
+		pathRequestGiveUp = giveUpIfInvalid;
+	}
+	else
+	{
+		LogError("Mission %s: Take off before pathfinding!", this->getName());
+	}
+}
 
-		// Did not reach destination
-		if (path.empty() || path.back() != target)
+void VehicleMission::setPath(Vehicle &v, std::list<Vec3<int>> path, Vec3<int> target,
+                             int maxIterations, bool giveUpIfInvalid)
+{
+	auto position = v.tileObject->getOwningTile()->position;
+	float distance = v.type->isGround()
+	                     ? GroundVehicleTileHelper::getDistanceStatic(position, target)
+	                     : FlyingVehicleTileHelper::getDistanceStatic(position, target);
+
+	// Did not reach destination
+	if (path.empty() || path.back() != target)
+	{
+		// If target was close enough to reach
+		if (maxIterations > (int)distance)
 		{
-			// If target was close enough to reach
-			if (maxIterations > (int)distance)
+			// If told to give up - cancel mission
+			if (giveUpIfInvalid)
 			{
-				// If told to give up - cancel mission
-				if (giveUpIfInvalid)
-				{
-					cancelled = true;
-					return;
-				}
-				// If not told to give up - subtract attempt
-				else
+				cancelled = true;
+				return;
+			}
+			// If not told to give up - subtract attempt
+			else
+			{
+				if (reRouteAttempts > 0)
 				{
-					if (reRouteAttempts > 0)
-					{
-						reRouteAttempts--;
-					}
+					reRouteAttempts--;
 				}
 			}
 		}
+	}
 
-		// Always start with the current position
-		this->currentPlannedPath.push_back(vehicleTile->getOwningTile()->position);
-		for (auto &p : path)
-		{
-			this->currentPlannedPath.push_back(p);
-		}
+	// Always start with the current position
+	this->currentPlannedPath.push_back(position);
+	this->currentPlannedPath.splice(this->currentPlannedPath.end(), path);
+}
+
+bool VehicleMission::isWaitingForPath(Vehicle &v)
+{
+	if (!pathRequest)
+	{
+		return false;
 	}
-	else
+	if (!pathRequest->isFinished())
 	{
-		LogError("Mission %s: Take off before pathfinding!", this->getName());
+		return true;
 	}
+	auto request = pathRequest;
+	pathRequest = nullptr;
+	// Vehicle was moved while waiting (dodging, or carrying out another mission), the path
+	// would not start from where it is now, so leave it empty for the mission to request again
+	if (!v.tileObject || v.tileObject->getOwningTile()->position != pathRequestOrigin)
+	{
+		return false;
+	}
+	setPath(v, request->takePath(), pathRequestTarget, pathRequestIterations, pathRequestGiveUp);
+	return false;
+}
+
+bool VehicleMission::isPlayerSelected(Vehicle &v)
+{
+	for (auto &selected : v.city->cityViewSelectedVehicles)
+	{
+		if (selected == &v)
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
 void VehicleMission::setFollowPath(GameState &state, Vehicle &v)
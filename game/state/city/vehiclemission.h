@@ -27,6 +27,8 @@ class TileMap;
 class Building;
 class UString;
 class City;
+class Organisation;
+class PathRequest;
 
 class FlyingVehicleTileHelper : public CanEnterTileHelper
 {
@@ -49,6 +51,8 @@ class FlyingVehicleTileHelper : public CanEnterTileHelper
 
 	float pathOverheadAlloawnce() const override;
 
+	bool canFlyStraight() const override { return true; }
+
 	// Support 'from' being nullptr for if a vehicle is being spawned in the map
 	bool canEnterTile(Tile *from, Tile *to, bool, bool &, float &cost, bool &, bool, bool,
 	                  bool) const override;
@@ -127,6 +131,16 @@ class VehicleMission
 	bool takeOffCheck(GameState &state, Vehicle &v);
 	bool teleportCheck(GameState &state, Vehicle &v);
 
+	// Replaces planned path with the one found, path being empty or not reaching target means
+	// pathfinding failed
+	void setPath(Vehicle &v, std::list<Vec3<int>> path, Vec3<int> target, int maxIterations,
+	             bool giveUpIfInvalid);
+	// Takes the result of the path requested by setPathTo if it's ready.
+	// Returns true if still waiting for it
+	bool isWaitingForPath(Vehicle &v);
+	// Player's selected vehicles get their paths first
+	static bool isPlayerSelected(Vehicle &v);
+
   public:
 	VehicleMission() = default;
 
@@ -175,6 +189,14 @@ class VehicleMission
 	static VehicleMission *snooze(GameState &state, Vehicle &v, unsigned int ticks);
 	static VehicleMission *selfDestruct(GameState &state, Vehicle &v);
 	static VehicleMission *arriveFromDimensionGate(GameState &state, Vehicle &v, int ticks = 0);
+	// As above, with lastArrival from getLastDimensionGateArrival() kept up to date by the caller,
+	// for when many vehicles come through the gate at once
+	static VehicleMission *arriveFromDimensionGate(GameState &state, Vehicle &v, int ticks,
+	                                               int &lastArrival);
+	// When the last of owner's vehicles arriving in city from the dimension gate will arrive, or
+	// -DIMENSION_GATE_DELAY if none is
+	static int getLastDimensionGateArrival(GameState &state, StateRef<City> city,
+	                                       StateRef<Organisation> owner);
 	static VehicleMission *restartNextMission(GameState &state, Vehicle &v);
 	static VehicleMission *crashLand(GameState &state, Vehicle &v);
 	static VehicleMission *patrol(GameState &state, Vehicle &v, bool home = false,
@@ -237,5 +259,13 @@ class VehicleMission
 	bool cancelled = false;
 
 	std::list<Vec3<int>> currentPlannedPath;
+
+	// Not serialized, the path is requested again after loading
+	sp<PathRequest> pathRequest;
+	// Parameters of the requested path, used once it's found
+	Vec3<int> pathRequestOrigin = {0, 0, 0};
+	Vec3<int> pathRequestTarget = {0, 0, 0};
+	int pathRequestIterations = 0;
+	bool pathRequestGiveUp = false;
 };
 } // namespace OpenApoc
@@ -13,6 +13,7 @@
 #include "game/state/shared/projectile.h"
 #include "game/state/tilemap/tilemap.h"
 #include "game/state/tilemap/tileobject_vehicle.h"
+#include "library/pool.h"
 #include "library/sp.h"
 #include <glm/glm.hpp>
 
@@ -92,7 +93,7 @@ bool VEquipment::fire(GameState &state, Vec3<float> targetPosition, Vec3<float>
 	// I believe this is the correct formula
 	velocity *= type->speed * PROJECTILE_VELOCITY_MULTIPLIER;
 
-	auto projectile = mksp<Projectile>(
+	auto projectile = mkpooled<Projectile>(
 	    type->guided ? Projectile::Type::Missile : Projectile::Type::Beam, owner, targetVehicle,
 	    homingPosition, muzzle, velocity, type->turn_rate, type->ttl, type->damage, /*delay*/ 0,
 	    /*depletion rate*/ 0, type->tail_size, type->projectile_sprites, type->impact_sfx,
@@ -100,6 +101,7 @@ bool VEquipment::fire(GameState &state, Vec3<float> targetPosition, Vec3<float>
 	    type->splitIntoTypes, manual);
 	owner->tileObject->map.addObjectToMap(projectile);
 	owner->city->projectiles.insert(projectile);
+	owner->city->projectileHash.insert(projectile->position, projectile);
 
 	return true;
 }
@@ -2,6 +2,8 @@
 #include "framework/configfile.h"
 #include "framework/data.h"
 #include "framework/framework.h"
+#include "framework/jobsystem.h"
+#include "framework/metrics.h"
 #include "framework/sound.h"
 #include "framework/trace.h"
 #include "game/state/battle/battle.h"
@@ -33,6 +35,7 @@
 #include "game/state/rules/city/ufopaedia.h"
 #include "game/state/rules/city/vammotype.h"
 #include "game/state/rules/city/vehicletype.h"
+#include "game/state/rules/city/vequipmenttype.h"
 #include "game/state/rules/doodadtype.h"
 #include "game/state/shared/aequipment.h"
 #include "game/state/shared/doodad.h"
@@ -46,6 +49,12 @@
 namespace OpenApoc
 {
 
+namespace
+{
+MetricGauge vehiclesGauge("Entities", "vehicles");
+MetricGauge agentsGauge("Entities", "agents");
+} // anonymous namespace
+
 GameState::GameState() : player(this) {}
 
 GameState::~GameState()
@@ -136,6 +145,9 @@ void GameState::initState()
 {
 	// FIXME: reseed rng when game starts
 
+	// Saves made before the log was capped, or by a build with a larger cap, may have more
+	trimMessages(MAX_MESSAGES);
+
 	if (current_battle)
 	{
 		current_battle->initBattle(*this);
@@ -165,6 +177,10 @@ void GameState::initState()
 	for (auto &c : this->cities)
 	{
 		auto &city = c.second;
+		for (auto &t : city->tile_types)
+		{
+			t.second->voxelMap = voxelPool.intern(t.second->voxelMap);
+		}
 		city->initMap(*this);
 		if (newGame)
 		{
@@ -212,6 +228,21 @@ void GameState::initState()
 		a.second->leftHandItem = a.second->getFirstItemInSlot(EquipmentSlotType::LeftHand, false);
 		a.second->rightHandItem = a.second->getFirstItemInSlot(EquipmentSlotType::RightHand, false);
 	}
+	// This runs while loading, so the sounds of the city are readied for playing here instead of
+	// the first time each plays
+	std::set<sp<Sample>> samples;
+	if (auto list = city_common_sample_list)
+	{
+		samples.insert({list->teleport, list->vehicleExplosion, list->sceneryExplosion,
+		                list->shieldHit, list->dimensionShiftIn, list->dimensionShiftOut});
+		samples.insert(list->alertSounds.begin(), list->alertSounds.end());
+	}
+	for (auto &e : this->vehicle_equipment)
+	{
+		samples.insert({e.second->fire_sfx, e.second->impact_sfx});
+	}
+	samples.erase(nullptr);
+	fw().soundBackend->prepareSamples({samples.begin(), samples.end()});
 	// Run nessecary methods for different types
 	research.updateTopicList();
 	// Apply mods (Stub until we actually have mods)
@@ -266,8 +297,17 @@ void GameState::setCurrentCity(StateRef<City> city)
 void GameState::validate()
 {
 	LogWarning("Validating GameState");
-	validateResearch();
-	validateScenery();
+	// The checks only read the state, the research and every city's scenery each touching
+	// references nothing else does, so they all run at once
+	auto &jobs = fw().getJobSystem();
+	JobCounter checks;
+	jobs.run([this]() { validateResearch(); }, &checks);
+	for (auto &c : cities)
+	{
+		const City *city = c.second.get();
+		jobs.run([this, city]() { validateScenery(*city); }, &checks);
+	}
+	jobs.wait(checks);
 	LogWarning("Validated GameState");
 }
 
@@ -413,64 +453,61 @@ void GameState::validateResearch()
 	}
 }
 
-void GameState::validateScenery()
+void GameState::validateScenery(const City &city)
 {
-	for (auto &c : cities)
-	{
-		for (auto &sc : c.second->tile_types)
-		{
-			auto thisSc = StateRef<SceneryTileType>{this, sc.first};
-			std::set<StateRef<SceneryTileType>> seenTypes;
-			while (thisSc->damagedTile)
+	for (auto &sc : city.tile_types)
+	{
+		auto thisSc = StateRef<SceneryTileType>{this, sc.first};
+		std::set<StateRef<SceneryTileType>> seenTypes;
+		while (thisSc->damagedTile)
+		{
+			seenTypes.insert(thisSc);
+			bool roadAlive = false;
+			bool roadDead = false;
+			bool newRoad = false;
+			if (thisSc->tile_type != SceneryTileType::TileType::Road &&
+			    thisSc->damagedTile->tile_type == SceneryTileType::TileType::Road)
 			{
-				seenTypes.insert(thisSc);
-				bool roadAlive = false;
-				bool roadDead = false;
-				bool newRoad = false;
-				if (thisSc->tile_type != SceneryTileType::TileType::Road &&
-				    thisSc->damagedTile->tile_type == SceneryTileType::TileType::Road)
-				{
-					newRoad = true;
-				}
-				else
+				newRoad = true;
+			}
+			else
+			{
+				for (int i = 0; i < 4; i++)
 				{
-					for (int i = 0; i < 4; i++)
+					if (thisSc->connection[i] &&
+					    thisSc->connection[i] == thisSc->damagedTile->connection[i])
 					{
-						if (thisSc->connection[i] &&
-						    thisSc->connection[i] == thisSc->damagedTile->connection[i])
-						{
-							roadAlive = true;
-						}
-						if (thisSc->connection[i] &&
-						    thisSc->connection[i] != thisSc->damagedTile->connection[i])
-						{
-							roadDead = true;
-						}
-						if (!thisSc->connection[i] &&
-						    thisSc->connection[i] != thisSc->damagedTile->connection[i])
-						{
-							newRoad = true;
-						}
+						roadAlive = true;
+					}
+					if (thisSc->connection[i] &&
+					    thisSc->connection[i] != thisSc->damagedTile->connection[i])
+					{
+						roadDead = true;
+					}
+					if (!thisSc->connection[i] &&
+					    thisSc->connection[i] != thisSc->damagedTile->connection[i])
+					{
+						newRoad = true;
 					}
 				}
-				if (newRoad || (roadAlive && roadDead))
-				{
-					LogError("ROAD MUTATION: In %s when damaged from %s to %s roads go [%d%d%d%d] "
-					         "to [%d%d%d%d]",
-					         sc.first, thisSc.id, thisSc->damagedTile.id,
-					         (int)thisSc->connection[0], (int)thisSc->connection[1],
-					         (int)thisSc->connection[2], (int)thisSc->connection[3],
-					         (int)thisSc->damagedTile->connection[0],
-					         (int)thisSc->damagedTile->connection[1],
-					         (int)thisSc->damagedTile->connection[2],
-					         (int)thisSc->damagedTile->connection[3]);
-				}
-				if (seenTypes.find(thisSc->damagedTile) != seenTypes.end())
-				{
-					break;
-				}
-				thisSc = thisSc->damagedTile;
 			}
+			if (newRoad || (roadAlive && roadDead))
+			{
+				LogError("ROAD MUTATION: In %s when damaged from %s to %s roads go [%d%d%d%d] "
+				         "to [%d%d%d%d]",
+				         sc.first, thisSc.id, thisSc->damagedTile.id,
+				         (int)thisSc->connection[0], (int)thisSc->connection[1],
+				         (int)thisSc->connection[2], (int)thisSc->connection[3],
+				         (int)thisSc->damagedTile->connection[0],
+				         (int)thisSc->damagedTile->connection[1],
+				         (int)thisSc->damagedTile->connection[2],
+				         (int)thisSc->damagedTile->connection[3]);
+			}
+			if (seenTypes.find(thisSc->damagedTile) != seenTypes.end())
+			{
+				break;
+			}
+			thisSc = thisSc->damagedTile;
 		}
 	}
 }
@@ -769,46 +806,32 @@ void GameState::fillPlayerStartingProperty()
 void GameState::updateEconomy()
 {
 	std::list<UString> newItems;
+	auto player = getPlayer();
+	// Items with no entry in the economy are not sold
+	auto updateItem = [this, &player, &newItems](const UString &id, const UString &name,
+	                                             const StateRef<Organisation> &manufacturer) {
+		auto it = economy.find(id);
+		if (it != economy.end() && it->second.update(*this, manufacturer == player))
+		{
+			newItems.push_back(name);
+		}
+	};
 
 	for (auto &v : vehicle_types)
 	{
-		if (economy.find(v.first) != economy.end())
-		{
-			if (economy[v.first].update(*this, v.second->manufacturer == getPlayer()))
-			{
-				newItems.push_back(v.second->name);
-			}
-		}
+		updateItem(v.first, v.second->name, v.second->manufacturer);
 	}
 	for (auto &ve : vehicle_equipment)
 	{
-		if (economy.find(ve.first) != economy.end())
-		{
-			if (economy[ve.first].update(*this, ve.second->manufacturer == getPlayer()))
-			{
-				newItems.push_back(ve.second->name);
-			}
-		}
+		updateItem(ve.first, ve.second->name, ve.second->manufacturer);
 	}
 	for (auto &va : vehicle_ammo)
 	{
-		if (economy.find(va.first) != economy.end())
-		{
-			if (economy[va.first].update(*this, va.second->manufacturer == getPlayer()))
-			{
-				newItems.push_back(va.second->name);
-			}
-		}
+		updateItem(va.first, va.second->name, va.second->manufacturer);
 	}
 	for (auto &ae : agent_equipment)
 	{
-		if (economy.find(ae.first) != economy.end())
-		{
-			if (economy[ae.first].update(*this, ae.second->manufacturer == getPlayer()))
-			{
-				newItems.push_back(ae.second->name);
-			}
-		}
+		updateItem(ae.first, ae.second->name, ae.second->manufacturer);
 	}
 
 	if (!newItems.empty())
@@ -954,6 +977,9 @@ void GameState::invasion()
 		return;
 	}
 
+	// Every invader arrives through the gate after the one before, so only look for when the
+	// last one already on its way arrives once
+	int lastArrival = VehicleMission::getLastDimensionGateArrival(*this, invadedCity, invadingOrg);
 	std::set<StateRef<Vehicle>> escorted;
 	for (auto &v : currentIncursion->primaryList)
 	{
@@ -965,7 +991,8 @@ void GameState::invasion()
 			invader->enterDimensionGate(*this);
 			invader->equipDefaultEquipment(*this);
 			invader->city = invadedCity;
-			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader));
+			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader, 0,
+			                                                                   lastArrival));
 			switch (missionType)
 			{
 				case UFOIncursion::PrimaryMission::Attack:
@@ -1001,7 +1028,8 @@ void GameState::invasion()
 
 			invader->enterDimensionGate(*this);
 			invader->city = invadedCity;
-			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader));
+			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader, 0,
+			                                                                   lastArrival));
 			// This creates a copy of escorted list in randomised order
 			auto escortedCopy = escorted;
 			std::list<StateRef<Vehicle>> escortedRandomized;
@@ -1024,7 +1052,8 @@ void GameState::invasion()
 
 			invader->enterDimensionGate(*this);
 			invader->city = invadedCity;
-			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader));
+			invader->setMission(*this, VehicleMission::arriveFromDimensionGate(*this, *invader, 0,
+			                                                                   lastArrival));
 			invader->addMission(*this, VehicleMission::attackBuilding(*this, *invader), true);
 		}
 	}
@@ -1077,13 +1106,32 @@ void OpenApoc::GameState::cleanUpDeathNote()
 	}
 }
 
+void GameState::startUpdateScope(const UString &name)
+{
+	Trace::start(name);
+	if (timeUpdates)
+	{
+		updateScopeStarts.push_back(std::chrono::steady_clock::now());
+	}
+}
+
+void GameState::endUpdateScope(const UString &name)
+{
+	if (timeUpdates && !updateScopeStarts.empty())
+	{
+		updateTimes[name] += std::chrono::steady_clock::now() - updateScopeStarts.back();
+		updateScopeStarts.pop_back();
+	}
+	Trace::end(name);
+}
+
 void GameState::update(unsigned int ticks)
 {
 	if (this->current_battle)
 	{
-		Trace::start("GameState::update::battles");
+		startUpdateScope("GameState::update::battles");
 		this->current_battle->update(*this, ticks);
-		Trace::end("GameState::update::battles");
+		endUpdateScope("GameState::update::battles");
 		gameTime.addTicks(ticks);
 	}
 	else
@@ -1094,18 +1142,23 @@ void GameState::update(unsigned int ticks)
 			upateAfterBattle();
 		}
 
-		Trace::start("GameState::update::cities");
+		vehiclesGauge.set(vehicles.size());
+		agentsGauge.set(agents.size());
+
+		startUpdateScope("GameState::update::cities");
 		current_city->update(*this, ticks);
-		Trace::end("GameState::update::cities");
+		endUpdateScope("GameState::update::cities");
 
-		Trace::start("GameState::update::organisations");
+		startUpdateScope("GameState::update::organisations");
+		updateVehicleIndexes();
 		for (auto &o : this->organisations)
 		{
 			o.second->updateMissions(*this);
 		}
-		Trace::end("GameState::update::organisations");
+		endUpdateScope("GameState::update::organisations");
 
-		Trace::start("GameState::update::vehicles");
+		startUpdateScope("GameState::update::vehicles");
+		current_city->updateVehicleHash(*this, ticks);
 		for (auto &v : this->vehicles)
 		{
 			if (v.second->city == current_city)
@@ -1114,17 +1167,23 @@ void GameState::update(unsigned int ticks)
 			}
 		}
 		cleanUpDeathNote();
-		Trace::end("GameState::update::vehicles");
+		endUpdateScope("GameState::update::vehicles");
 
-		Trace::start("GameState::update::agents");
-		for (auto &a : this->agents)
+		startUpdateScope("GameState::update::agents");
+		if (movingAgentsChanged)
+		{
+			updateMovingAgents();
+		}
+		// Agents given missions by these are only added on the next update
+		for (auto &a : movingAgents)
 		{
-			if (a.second->city == current_city)
+			if (a->city == current_city)
 			{
-				a.second->update(*this, ticks);
+				a->update(*this, ticks);
 			}
 		}
-		Trace::end("GameState::update::agents");
+		idleAgentTicks += ticks;
+		endUpdateScope("GameState::update::agents");
 
 		gameTime.addTicks(ticks);
 
@@ -1158,7 +1217,7 @@ void GameState::update(unsigned int ticks)
 
 void GameState::updateEndOfSecond()
 {
-	Trace::start("GameState::updateEachSecond::buildings");
+	startUpdateScope("GameState::updateEachSecond::buildings");
 	for (auto &b : current_city->buildings)
 	{
 		b.second->updateCargo(*this);
@@ -1202,8 +1261,8 @@ void GameState::updateEndOfSecond()
 			}
 		}
 	}
-	Trace::end("GameState::updateEachSecond::buildings");
-	Trace::start("GameState::updateEachSecond::vehicles");
+	endUpdateScope("GameState::updateEachSecond::buildings");
+	startUpdateScope("GameState::updateEachSecond::vehicles");
 	for (auto &v : vehicles)
 	{
 		if (v.second->city == current_city)
@@ -1211,22 +1270,46 @@ void GameState::updateEndOfSecond()
 			v.second->updateEachSecond(*this);
 		}
 	}
-	Trace::end("GameState::updateEachSecond::vehicles");
-	Trace::start("GameState::updateEachSecond::agents");
+	endUpdateScope("GameState::updateEachSecond::vehicles");
+	startUpdateScope("GameState::updateEachSecond::agents");
 	for (auto &a : this->agents)
 	{
 		if (a.second->city == current_city)
 		{
 			a.second->updateEachSecond(*this);
+			if (!a.second->updatedEachTick)
+			{
+				a.second->updateIdle(*this, idleAgentTicks);
+			}
+		}
+	}
+	idleAgentTicks = 0;
+	updateMovingAgents();
+	endUpdateScope("GameState::updateEachSecond::agents");
+}
+
+void GameState::updateMovingAgents()
+{
+	for (auto &a : movingAgents)
+	{
+		a->updatedEachTick = false;
+	}
+	movingAgents.clear();
+	for (auto &a : this->agents)
+	{
+		if (a.second->city == current_city && a.second->isMovingInCity())
+		{
+			a.second->updatedEachTick = true;
+			movingAgents.push_back(a.second);
 		}
 	}
-	Trace::end("GameState::updateEachSecond::agents");
+	movingAgentsChanged = false;
 }
 
 void GameState::updateEndOfFiveMinutes()
 {
 	// TakeOver calculation stops when org is taken over
-	Trace::start("GameState::updateEndOfFiveMinutes::organisations");
+	startUpdateScope("GameState::updateEndOfFiveMinutes::organisations");
 	for (auto &o : this->organisations)
 	{
 		if (o.second->takenOver)
@@ -1239,10 +1322,10 @@ void GameState::updateEndOfFiveMinutes()
 			break;
 		}
 	}
-	Trace::end("GameState::updateEndOfFiveMinutes::organisations");
+	endUpdateScope("GameState::updateEndOfFiveMinutes::organisations");
 
 	// Detection calculation stops when detection happens
-	Trace::start("GameState::updateEndOfFiveMinutes::buildings");
+	startUpdateScope("GameState::updateEndOfFiveMinutes::buildings");
 	for (auto &b : current_city->buildings)
 	{
 		bool detected = b.second->ticksDetectionTimeOut > 0;
@@ -1256,40 +1339,62 @@ void GameState::updateEndOfFiveMinutes()
 	{
 		b.second->updateCargo(*this);
 	}
-	Trace::end("GameState::updateEndOfFiveMinutes::buildings");
+	endUpdateScope("GameState::updateEndOfFiveMinutes::buildings");
 }
 
 void GameState::updateEndOfHour()
 {
-	Trace::start("GameState::updateEndOfHour::agents");
+	startUpdateScope("GameState::updateEndOfHour::agents");
+	// Every agent staying at a base, with how used its facilities are worked out once per base
+	// first rather than by every agent going through every other one
+	std::map<sp<Base>, AgentFacilityUsage> usages;
+	std::vector<std::pair<sp<Agent>, const AgentFacilityUsage *>> roster;
 	for (auto &a : this->agents)
 	{
-		a.second->updateHourly(*this);
+		auto base = a.second->getBaseStayingAt();
+		if (!base)
+		{
+			continue;
+		}
+		auto it = usages.find(base.getSp());
+		if (it == usages.end())
+		{
+			AgentFacilityUsage usage;
+			usage.medical = base->getUsage(*this, FacilityType::Capacity::Medical);
+			usage.training = base->getUsage(*this, FacilityType::Capacity::Training);
+			usage.psi = base->getUsage(*this, FacilityType::Capacity::Psi);
+			it = usages.emplace(base.getSp(), usage).first;
+		}
+		roster.emplace_back(a.second, &it->second);
+	}
+	for (auto &entry : roster)
+	{
+		entry.first->updateHourly(*this, *entry.second);
 	}
-	Trace::end("GameState::updateEndOfHour::agents");
-	Trace::start("GameState::updateEndOfHour::labs");
+	endUpdateScope("GameState::updateEndOfHour::agents");
+	startUpdateScope("GameState::updateEndOfHour::labs");
 	for (auto &lab : this->research.labs)
 	{
 		Lab::update(TICKS_PER_HOUR, {this, lab.second}, shared_from_this());
 	}
-	Trace::end("GameState::updateEndOfHour::labs");
-	Trace::start("GameState::updateEndOfHour::cities");
+	endUpdateScope("GameState::updateEndOfHour::labs");
+	startUpdateScope("GameState::updateEndOfHour::cities");
 	for (auto &c : this->cities)
 	{
 		c.second->hourlyLoop(*this);
 	}
-	Trace::end("GameState::updateEndOfHour::cities");
-	Trace::start("GameState::updateEndOfHour::organisations");
+	endUpdateScope("GameState::updateEndOfHour::cities");
+	startUpdateScope("GameState::updateEndOfHour::organisations");
 	for (auto &o : this->organisations)
 	{
 		o.second->updateInfiltration(*this);
 	}
-	Trace::end("GameState::updateEndOfHour::organisations");
+	endUpdateScope("GameState::updateEndOfHour::organisations");
 }
 
 void GameState::updateEndOfDay()
 {
-	Trace::start("GameState::updateEndOfDay::bases");
+	startUpdateScope("GameState::updateEndOfDay::bases");
 	for (auto &b : this->player_bases)
 	{
 		for (auto &f : b.second->facilities)
@@ -1305,26 +1410,26 @@ void GameState::updateEndOfDay()
 			}
 		}
 	}
-	Trace::end("GameState::updateEndOfDay::bases");
-	Trace::start("GameState::updateEndOfDay::organisations");
+	endUpdateScope("GameState::updateEndOfDay::bases");
+	startUpdateScope("GameState::updateEndOfDay::organisations");
 	for (auto &o : this->organisations)
 	{
 		o.second->updateVehicleAgentPark(*this);
 		o.second->updateHirableAgents(*this);
 	}
-	Trace::end("GameState::updateEndOfDay::organisations");
-	Trace::start("GameState::updateEndOfDay::agents");
+	endUpdateScope("GameState::updateEndOfDay::organisations");
+	startUpdateScope("GameState::updateEndOfDay::agents");
 	for (auto &a : this->agents)
 	{
 		a.second->updateDaily(*this);
 	}
-	Trace::end("GameState::updateEndOfDay::agents");
-	Trace::start("GameState::updateEndOfDay::cities");
+	endUpdateScope("GameState::updateEndOfDay::agents");
+	startUpdateScope("GameState::updateEndOfDay::cities");
 	for (auto &c : this->cities)
 	{
 		c.second->dailyLoop(*this);
 	}
-	Trace::end("GameState::updateEndOfDay::cities");
+	endUpdateScope("GameState::updateEndOfDay::cities");
 }
 
 void GameState::updateEndOfWeek()
@@ -1346,6 +1451,32 @@ void GameState::updateEndOfWeek()
 	updateEconomy();
 }
 
+void GameState::updateVehicleIndexes()
+{
+	vehiclesByOwner.clear();
+	crashedVehicles.clear();
+	vehiclesBeingRecovered.clear();
+	for (auto &v : this->vehicles)
+	{
+		vehiclesByOwner[v.second->owner].push_back(v.second);
+		if (v.second->crashed && !v.second->carriedByVehicle)
+		{
+			crashedVehicles.push_back(v.second);
+		}
+		if (!v.second->type->canRescueCrashed)
+		{
+			continue;
+		}
+		for (auto &m : v.second->missions)
+		{
+			if (m->type == VehicleMission::MissionType::RecoverVehicle)
+			{
+				vehiclesBeingRecovered.emplace(v.second->city, m->targetVehicle.id);
+			}
+		}
+	}
+}
+
 void GameState::updateTurbo()
 {
 	if (!this->canTurbo())
@@ -1359,13 +1490,74 @@ void GameState::updateTurbo()
 	{
 		ticksToUpdate -= align;
 	}
+	auto coarseVehicles = this->getCoarseTurboVehicles();
+	for (auto &v : coarseVehicles)
+	{
+		v->coarseTurbo = true;
+	}
 	this->update(ticksToUpdate);
+	for (auto &v : coarseVehicles)
+	{
+		v->coarseTurbo = false;
+	}
 	this->updateAfterTurbo();
 }
 
+std::vector<sp<Vehicle>> GameState::getCoarseTurboVehicles()
+{
+	std::vector<sp<Vehicle>> coarseVehicles;
+	if (skipTurboCalculations || !config().getBool("OpenApoc.NewFeature.CoarseTurbo"))
+	{
+		return coarseVehicles;
+	}
+	auto player = getPlayer();
+	std::vector<Vec3<float>> playerPositions;
+	for (auto &v : this->vehicles)
+	{
+		if (v.second->city == current_city && v.second->owner == player && v.second->tileObject)
+		{
+			playerPositions.push_back(v.second->position);
+		}
+	}
+	for (auto &b : this->player_bases)
+	{
+		if (b.second->building && b.second->building->city == current_city)
+		{
+			auto bounds = b.second->building->bounds;
+			playerPositions.push_back(
+			    {(bounds.p0.x + bounds.p1.x) / 2.0f, (bounds.p0.y + bounds.p1.y) / 2.0f, 0.0f});
+		}
+	}
+	float radius = (float)COARSE_TURBO_DISTANCE;
+	for (auto &v : this->vehicles)
+	{
+		if (v.second->city != current_city || v.second->owner == player || !v.second->tileObject)
+		{
+			continue;
+		}
+		bool nearPlayer = false;
+		for (auto &position : playerPositions)
+		{
+			auto offset = v.second->position - position;
+			if (offset.x * offset.x + offset.y * offset.y < radius * radius)
+			{
+				nearPlayer = true;
+				break;
+			}
+		}
+		if (!nearPlayer)
+		{
+			coarseVehicles.push_back(v.second);
+		}
+	}
+	return coarseVehicles;
+}
+
 void GameState::updateAfterTurbo()
 {
-	Trace::start("GameState::updateAfterTurbo::vehicles");
+	startUpdateScope("GameState::updateAfterTurbo::vehicles");
+	static const unsigned int MAX_TICKS_AFTER_TURBO = 20 * TICKS_PER_SECOND;
+	current_city->updateVehicleHash(*this, MAX_TICKS_AFTER_TURBO);
 	for (auto &v : this->vehicles)
 	{
 		if (v.second->city != current_city)
@@ -1376,9 +1568,9 @@ void GameState::updateAfterTurbo()
 		{
 			continue;
 		}
-		v.second->update(*this, randBoundsExclusive(rng, (unsigned)0, 20 * TICKS_PER_SECOND));
+		v.second->update(*this, randBoundsExclusive(rng, (unsigned)0, MAX_TICKS_AFTER_TURBO));
 	}
-	Trace::end("GameState::updateAfterTurbo::vehicles");
+	endUpdateScope("GameState::updateAfterTurbo::vehicles");
 }
 
 void GameState::updateBeforeBattle()
@@ -1433,12 +1625,17 @@ void GameState::upateAfterBattle()
 	}
 }
 
-void GameState::logEvent(GameEvent *ev)
+void GameState::trimMessages(size_t count)
 {
-	if (messages.size() == MAX_MESSAGES)
+	while (messages.size() > count)
 	{
 		messages.pop_front();
 	}
+}
+
+void GameState::logEvent(GameEvent *ev)
+{
+	trimMessages(MAX_MESSAGES - 1);
 	Vec3<int> location = EventMessage::NO_LOCATION;
 	if (GameVehicleEvent *gve = dynamic_cast<GameVehicleEvent *>(ev))
 	{
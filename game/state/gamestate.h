@@ -8,11 +8,15 @@
 #include "game/state/stateobject.h"
 #include "library/sp.h"
 #include "library/strings.h"
+#include "library/voxel.h"
 #include "library/xorshift.h"
+#include <chrono>
 #include <cstdint>
 #include <list>
 #include <map>
 #include <mutex>
+#include <set>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -49,6 +53,13 @@ class UFOMissionPreference;
 static const int MAX_MESSAGES = 50;
 static const unsigned ORIGINAL_TICKS = 36;
 static const bool UPDATE_EVERY_TICK = false;
+// With OpenApoc.NewFeature.FixedUpdateRate, how many times a second the views advance the game
+// by the ticks their speed gives, whatever the frame rate, and how many times at most in a frame
+static const unsigned UPDATES_PER_SECOND = 60;
+static const unsigned MAX_UPDATES_PER_FRAME = 4;
+// With OpenApoc.NewFeature.CoarseTurbo, how many tiles away from all of the player's vehicles and
+// bases others have to be to move whole tiles at once in turbo
+static const int COARSE_TURBO_DISTANCE = 20;
 
 class GameScore
 {
@@ -102,6 +113,7 @@ class GameState : public std::enable_shared_from_this<GameState>
 	StateRefMap<BattleUnitAnimationPack> battle_unit_animation_packs;
 	StateRefMap<BattleMapPartType> battleMapTiles;
 
+	// The last MAX_MESSAGES events, oldest first
 	std::list<EventMessage> messages;
 
 	int difficulty = 0;
@@ -180,6 +192,8 @@ class GameState : public std::enable_shared_from_this<GameState>
 
 	// serializes gamestate to archive
 	bool serialize(SerializationArchive *archive) const;
+	// serializes only what differs from reference, so that it is read back over that
+	bool serialize(SerializationArchive *archive, const GameState &reference) const;
 
 	// deserializes gamestate from archive
 	bool deserialize(SerializationArchive *archive);
@@ -199,7 +213,7 @@ class GameState : public std::enable_shared_from_this<GameState>
 	// Validates gamestate, sanity checks for all the possible fuck-ups
 	void validate();
 	void validateResearch();
-	void validateScenery();
+	void validateScenery(const City &city);
 	void validateAgentEquipment();
 
 	void fillOrgStartingProperty();
@@ -229,10 +243,18 @@ class GameState : public std::enable_shared_from_this<GameState>
 	// this moves non-aggressive vehicles around for some more ticks so that when time is paused
 	// after turbo city appears more alive
 	void updateAfterTurbo();
+	// Vehicles in the current city to move coarsely through the next turbo step
+	std::vector<sp<Vehicle>> getCoarseTurboVehicles();
 
 	void updateBeforeBattle();
 	void upateAfterBattle();
 
+	// Builds the vehicle indexes again, for organisations to update their missions with
+	void updateVehicleIndexes();
+
+	// Builds movingAgents again from the agents in the current city
+	void updateMovingAgents();
+
 	void updateEndOfSecond();
 	void updateEndOfFiveMinutes();
 	void updateEndOfHour();
@@ -240,10 +262,42 @@ class GameState : public std::enable_shared_from_this<GameState>
 	void updateEndOfWeek();
 
 	void logEvent(GameEvent *ev);
+	// Drops the oldest messages until there are no more than count
+	void trimMessages(size_t count);
 
 	// Following members are not serialized
 	bool newGame = false;
 	bool skipTurboCalculations = false;
+	// Shares identical voxel maps between scenery and map part types
+	VoxelPool voxelPool;
+	// Vehicles by owner, crashed vehicles not being carried yet and the cities and IDs of the
+	// vehicles rescue craft are on their way to recover, all in the order of vehicles. Built again
+	// by updateVehicleIndexes() every update and added to as rescues are sent
+	std::map<StateRef<Organisation>, std::vector<sp<Vehicle>>> vehiclesByOwner;
+	std::vector<sp<Vehicle>> crashedVehicles;
+	std::set<std::pair<StateRef<City>, UString>> vehiclesBeingRecovered;
+	// The agents of the current city update() goes through every tick, the others sitting still
+	// in a building or vehicle until the pass at the end of every second. Built again then and on
+	// the next update after any agent got a mission, which sets movingAgentsChanged
+	std::vector<sp<Agent>> movingAgents;
+	bool movingAgentsChanged = true;
+	// Ticks gone by since the agents not in movingAgents were last updated
+	unsigned int idleAgentTicks = 0;
+	// The gamestates under the data directory this one was started from, in the order they were
+	// loaded, which saves can be written as a delta against
+	std::vector<UString> baseStates;
+	// When set the time taken by every scope of update(), and of the updates it runs at the end of
+	// every second, five minutes, hour, day and week, is added up here under the scope's name, for
+	// tools that report where an update goes. Only to be changed between updates
+	bool timeUpdates = false;
+	std::map<UString, std::chrono::steady_clock::duration> updateTimes;
+
+  private:
+	// When the update scopes being timed started, innermost last
+	std::vector<std::chrono::steady_clock::time_point> updateScopeStarts;
+	// Trace scopes of the updates, timed as well when timeUpdates is set
+	void startUpdateScope(const UString &name);
+	void endUpdateScope(const UString &name);
 };
 
 }; // namespace OpenApoc
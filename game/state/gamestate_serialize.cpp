@@ -2,6 +2,7 @@
 #include "framework/data.h"
 #include "framework/framework.h"
 #include "framework/image.h"
+#include "framework/metrics.h"
 #include "framework/serialization/serialize.h"
 #include "framework/trace.h"
 #include "game/state/battle/battlemappart.h"
@@ -23,6 +24,7 @@
 #include "game/state/shared/doodad.h"
 #include "game/state/shared/projectile.h"
 #include "library/voxel.h"
+#include <chrono>
 
 namespace OpenApoc
 {
@@ -98,6 +100,14 @@ void serializeIn(const GameState *, SerializationNode *node, std::vector<bool> &
 	vector = node->getValueBoolVector();
 }
 
+// Saved the same way as a std::vector<bool>
+void serializeIn(const GameState *, SerializationNode *node, BitVector &bits)
+{
+	if (!node)
+		return;
+	bits = BitVector::fromBoolVector(node->getValueBoolVector());
+}
+
 void serializeIn(const GameState *, SerializationNode *node, sp<VoxelSlice> &ptr)
 {
 	if (!node)
@@ -211,6 +221,11 @@ void serializeOut(SerializationNode *node, const std::vector<bool> &vector,
 	node->setValueBoolVector(vector);
 }
 
+void serializeOut(SerializationNode *node, const BitVector &bits, const BitVector &)
+{
+	node->setValueBoolVector(bits.toBoolVector());
+}
+
 void serializeOut(SerializationNode *node, const VoxelMap &map, const VoxelMap &ref)
 {
 	serializeOut(node->addNode("size"), map.size, ref.size);
@@ -431,13 +446,18 @@ bool operator==(const TacticalAI &a, const TacticalAI &b)
 }
 bool operator!=(const TacticalAI &a, const TacticalAI &b) { return !(a == b); }
 
+static MetricHistogram saveTimes("Saves", "seconds", {0.5, 1.0, 2.0, 5.0, 10.0, 30.0});
+
 bool GameState::saveGame(const UString &path, bool pack, bool pretty)
 {
 	TRACE_FN_ARGS1("path", path);
+	auto start = std::chrono::steady_clock::now();
 	auto archive = SerializationArchive::createArchive();
 	if (serialize(archive.get()))
 	{
 		archive->write(path, pack, pretty);
+		saveTimes.add(
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 		return true;
 	}
 	return false;
@@ -458,13 +478,18 @@ bool GameState::loadGame(const UString &path)
 }
 
 bool GameState::serialize(SerializationArchive *archive) const
+{
+	GameState defaultState;
+	return serialize(archive, defaultState);
+}
+
+bool GameState::serialize(SerializationArchive *archive, const GameState &reference) const
 {
 	try
 	{
-		GameState defaultState;
 		auto root = archive->newRoot("", "gamestate");
 		root->addNode("serialization_version", GAMESTATE_SERIALIZATION_VERSION);
-		serializeOut(root, *this, defaultState);
+		serializeOut(root, *this, reference);
 	}
 	catch (SerializationException &e)
 	{
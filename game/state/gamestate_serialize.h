@@ -131,6 +131,7 @@ void serializeIn(const GameState *, SerializationNode *node, bool &val);
 void serializeIn(const GameState *, SerializationNode *node, sp<LazyImage> &ptr);
 void serializeIn(const GameState *, SerializationNode *node, sp<Image> &ptr);
 void serializeIn(const GameState *, SerializationNode *node, std::vector<bool> &vector);
+void serializeIn(const GameState *, SerializationNode *node, BitVector &bits);
 void serializeIn(const GameState *, SerializationNode *node, sp<VoxelSlice> &ptr);
 void serializeIn(const GameState *, SerializationNode *node, sp<Sample> &ptr);
 void serializeIn(const GameState *state, SerializationNode *node, VoxelMap &map);
@@ -224,8 +225,15 @@ void serializeIn(const GameState *state, SerializationNode *node, std::map<Key,
 	{
 		Key key;
 		serializeIn(state, entry->getNodeReq("key"), key);
-		auto &value = map[key];
-		serializeIn(state, entry->getNodeReq("value"), value);
+		if (entry->getNodeOpt("erase"))
+		{
+			map.erase(key);
+		}
+		else
+		{
+			auto &value = map[key];
+			serializeIn(state, entry->getNodeReq("value"), value);
+		}
 
 		entry = entry->getNextSiblingOpt("entry");
 	}
@@ -242,8 +250,15 @@ void serializeInSectionMap(const GameState *state, SerializationNode *node,
 	{
 		UString key;
 		serializeIn(state, entry->getNodeReq("key"), key);
-		auto &value = map[key];
-		serializeIn(state, entry->getSectionReq(key), value);
+		if (entry->getNodeOpt("erase"))
+		{
+			map.erase(key);
+		}
+		else
+		{
+			auto &value = map[key];
+			serializeIn(state, entry->getSectionReq(key), value);
+		}
 
 		entry = entry->getNextSiblingOpt("entry");
 	}
@@ -260,8 +275,15 @@ void serializeIn(const GameState *state, SerializationNode *node, std::map<Key,
 	{
 		Key key = {};
 		serializeIn(state, entry->getNodeReq("key"), key, keyMap);
-		auto &value = map[key];
-		serializeIn(state, entry->getNodeReq("value"), value);
+		if (entry->getNodeOpt("erase"))
+		{
+			map.erase(key);
+		}
+		else
+		{
+			auto &value = map[key];
+			serializeIn(state, entry->getNodeReq("value"), value);
+		}
 
 		entry = entry->getNextSiblingOpt("entry");
 	}
@@ -281,6 +303,8 @@ void serializeIn(const GameState *state, SerializationNode *node, std::list<T> &
 {
 	if (!node)
 		return;
+	if (node->getNodeOpt("clear"))
+		list.clear();
 	auto entry = node->getNodeOpt("entry");
 	while (entry)
 	{
@@ -295,6 +319,8 @@ void serializeIn(const GameState *state, SerializationNode *node, std::vector<T>
 {
 	if (!node)
 		return;
+	if (node->getNodeOpt("clear"))
+		vector.clear();
 	auto entry = node->getNodeOpt("entry");
 	uint64_t sizeHint = 0;
 	serializeIn(state, node->getNodeOpt("sizeHint"), sizeHint);
@@ -317,6 +343,8 @@ void serializeIn(const GameState *state, SerializationNode *node, std::set<T> &s
 {
 	if (!node)
 		return;
+	if (node->getNodeOpt("clear"))
+		set.clear();
 	auto entry = node->getNodeOpt("entry");
 	while (entry)
 	{
@@ -350,6 +378,7 @@ void serializeOut(SerializationNode *node, const sp<LazyImage> &ptr, const sp<La
 void serializeOut(SerializationNode *node, const sp<Image> &ptr, const sp<Image> &ref);
 void serializeOut(SerializationNode *node, const std::vector<bool> &vector,
                   const std::vector<bool> &ref);
+void serializeOut(SerializationNode *node, const BitVector &bits, const BitVector &ref);
 void serializeOut(SerializationNode *node, const sp<VoxelSlice> &ptr, const sp<VoxelSlice> &ref);
 void serializeOut(SerializationNode *node, const sp<Sample> &ptr, const sp<Sample> &ref);
 void serializeOut(SerializationNode *node, const VoxelMap &map, const VoxelMap &ref);
@@ -444,6 +473,16 @@ void serializeOut(SerializationNode *node, const std::map<Key, Value> &map,
 			serializeOut(entry->addNode("value"), pair.second, defaultValue);
 		}
 	}
+	// Entries only in the reference are marked to be taken out again when this is read over it
+	for (const auto &pair : ref)
+	{
+		if (map.find(pair.first) == map.end())
+		{
+			auto entry = node->addNode("entry");
+			serializeOut(entry->addNode("key"), pair.first, defaultKey);
+			entry->addNode("erase");
+		}
+	}
 }
 
 template <typename T>
@@ -474,6 +513,16 @@ void serializeOut(SerializationNode *node, const StateRefMap<T> &map, const Stat
 			serializeOut(entry->addNode("value"), pair.second, defaultValue);
 		}
 	}
+	// Entries only in the reference are marked to be taken out again when this is read over it
+	for (const auto &pair : ref)
+	{
+		if (map.find(pair.first) == map.end())
+		{
+			auto entry = node->addNode("entry");
+			serializeOut(entry->addNode("key"), pair.first, defaultKey);
+			entry->addNode("erase");
+		}
+	}
 }
 
 template <typename Value>
@@ -505,11 +554,24 @@ void serializeOutSectionMap(SerializationNode *node, const std::map<UString, Val
 			serializeOut(entry->addSection(pair.first), pair.second, defaultValue);
 		}
 	}
+	// Entries only in the reference are marked to be taken out again when this is read over it
+	for (const auto &pair : ref)
+	{
+		if (map.find(pair.first) == map.end())
+		{
+			auto entry = node->addNode("entry");
+			serializeOut(entry->addNode("key"), pair.first, defaultKey);
+			entry->addNode("erase");
+		}
+	}
 }
 
 template <typename T>
-void serializeOut(SerializationNode *node, const std::set<T> &set, const std::set<T> &)
+void serializeOut(SerializationNode *node, const std::set<T> &set, const std::set<T> &ref)
 {
+	// Read over anything but an empty set, this replaces it rather than adding to it
+	if (!ref.empty())
+		node->addNode("clear");
 	T defaultRef;
 	for (const auto &entry : set)
 	{
@@ -525,8 +587,10 @@ void serializeOut(SerializationNode *node, const std::pair<A, B> &pair, const st
 }
 
 template <typename T>
-void serializeOut(SerializationNode *node, const std::list<T> &list, const std::list<T> &)
+void serializeOut(SerializationNode *node, const std::list<T> &list, const std::list<T> &ref)
 {
+	if (!ref.empty())
+		node->addNode("clear");
 	T defaultRef;
 	for (auto &entry : list)
 	{
@@ -535,8 +599,11 @@ void serializeOut(SerializationNode *node, const std::list<T> &list, const std::
 }
 
 template <typename T>
-void serializeOut(SerializationNode *node, const std::vector<T> &vector, const std::vector<T> &)
+void serializeOut(SerializationNode *node, const std::vector<T> &vector,
+                  const std::vector<T> &ref)
 {
+	if (!ref.empty())
+		node->addNode("clear");
 	T defaultRef;
 	for (auto &entry : vector)
 	{
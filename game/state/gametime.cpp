@@ -1,7 +1,9 @@
 #include "game/state/gametime.h"
 #include "game/state/gametime_facet.h"
 #include "library/strings_format.h"
+#include <cstdint>
 #include <locale>
+#include <mutex>
 #include <sstream>
 
 // Disable automatic #pragma linking for boost - only enabled in msvc and that should provide boost
@@ -37,7 +39,33 @@ static boost::posix_time::ptime getPtime(uint64_t ticks)
 	return GAME_START + ticksToPosix(ticks);
 }
 
-UString GameTime::getLongTimeString() const
+// A formatted string stays the same for every tick of its period (the minute for hh:mm, the day
+// for dates), so it is only formatted again once asked for a tick in another one
+class FormattedTime
+{
+  public:
+	uint64_t period = UINT64_MAX;
+	UString text;
+};
+static std::mutex formattedTimesLock;
+static FormattedTime longTime;
+static FormattedTime shortTime;
+static FormattedTime longDate;
+static FormattedTime shortDate;
+
+static UString getFormatted(FormattedTime &cached, uint64_t period,
+                            UString (*formatTicks)(uint64_t ticks), uint64_t ticks)
+{
+	std::lock_guard<std::mutex> lock(formattedTimesLock);
+	if (cached.period != period)
+	{
+		cached.text = formatTicks(ticks);
+		cached.period = period;
+	}
+	return cached.text;
+}
+
+static UString formatLongTime(uint64_t ticks)
 {
 	std::stringstream ss;
 	if (TIME_LONG_FORMAT == nullptr)
@@ -47,11 +75,11 @@ UString GameTime::getLongTimeString() const
 		TIME_LONG_FORMAT = new std::locale(std::locale::classic(), timeFacet);
 	}
 	ss.imbue(*TIME_LONG_FORMAT);
-	ss << getPtime(this->ticks);
+	ss << getPtime(ticks);
 	return ss.str();
 }
 
-UString GameTime::getShortTimeString() const
+static UString formatShortTime(uint64_t ticks)
 {
 	std::stringstream ss;
 	if (TIME_SHORT_FORMAT == nullptr)
@@ -61,11 +89,11 @@ UString GameTime::getShortTimeString() const
 		TIME_SHORT_FORMAT = new std::locale(std::locale::classic(), timeFacet);
 	}
 	ss.imbue(*TIME_SHORT_FORMAT);
-	ss << getPtime(this->ticks);
+	ss << getPtime(ticks);
 	return ss.str();
 }
 
-UString GameTime::getLongDateString() const
+static UString formatLongDate(uint64_t ticks)
 {
 	std::stringstream ss;
 	if (DATE_LONG_FORMAT == nullptr)
@@ -97,11 +125,11 @@ UString GameTime::getLongDateString() const
 		dateFacet->longDayNames(days);
 	}
 	ss.imbue(*DATE_LONG_FORMAT);
-	ss << getPtime(this->ticks).date();
+	ss << getPtime(ticks).date();
 	return ss.str();
 }
 
-UString GameTime::getShortDateString() const
+static UString formatShortDate(uint64_t ticks)
 {
 	std::stringstream ss;
 	if (DATE_SHORT_FORMAT == nullptr)
@@ -128,10 +156,30 @@ UString GameTime::getShortDateString() const
 		dateFacet->longDayNames(days);
 	}
 	ss.imbue(*DATE_SHORT_FORMAT);
-	ss << getPtime(this->ticks).date();
+	ss << getPtime(ticks).date();
 	return ss.str();
 }
 
+UString GameTime::getLongTimeString() const
+{
+	return getFormatted(longTime, ticks / TICKS_PER_SECOND, formatLongTime, ticks);
+}
+
+UString GameTime::getShortTimeString() const
+{
+	return getFormatted(shortTime, ticks / TICKS_PER_MINUTE, formatShortTime, ticks);
+}
+
+UString GameTime::getLongDateString() const
+{
+	return getFormatted(longDate, ticks / TICKS_PER_DAY, formatLongDate, ticks);
+}
+
+UString GameTime::getShortDateString() const
+{
+	return getFormatted(shortDate, ticks / TICKS_PER_DAY, formatShortDate, ticks);
+}
+
 UString GameTime::getWeekString() const { return format("%s %d", tr("Week"), getWeek()); }
 
 unsigned int GameTime::getWeek() const
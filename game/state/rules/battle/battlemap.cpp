@@ -1,4 +1,6 @@
 #include "game/state/rules/battle/battlemap.h"
+#include "framework/configfile.h"
+#include "framework/framework.h"
 #include "game/state/battle/battle.h"
 #include "game/state/battle/battledoor.h"
 #include "game/state/battle/battleitem.h"
@@ -26,6 +28,14 @@ namespace OpenApoc
 
 namespace
 {
+ConfigOptionInt sectorTilesCacheOption("Game.Battle", "SectorTilesCache",
+                                       "Number of map sectors whose tiles are kept loaded between "
+                                       "battles, for maps fought on again to be made without "
+                                       "reading them (0 = none)",
+                                       64);
+
+unsigned int battlesMade = 0;
+
 int getCorridorSectorID(sp<Base> base, Vec2<int> pos)
 {
 	// key is North South West East (true = occupied, false = vacant)
@@ -1000,6 +1010,51 @@ BattleMap::fillMap(std::vector<std::list<std::pair<Vec3<int>, sp<BattleMapPart>>
 	b->reinforcementsInterval = reinforcementsInterval * TICKS_PER_SECOND;
 	b->ticksUntilNextReinforcement = reinforcementsInterval * TICKS_PER_SECOND;
 
+	// Reading the sectors' tiles takes most of the time here, and each only fills in its own, so
+	// the ones not loaded yet are read in parallel before placing anything
+	std::vector<BattleMapSector *> sectorsToLoad;
+	unsigned int alreadyLoaded = 0;
+	battlesMade++;
+	for (auto &sec : sec_map)
+	{
+		if (!sec || sec->tilesLastUsed == battlesMade)
+		{
+			continue;
+		}
+		sec->tilesLastUsed = battlesMade;
+		if (sec->tiles)
+		{
+			alreadyLoaded++;
+			continue;
+		}
+		sectorsToLoad.push_back(sec.get());
+	}
+	LogInfo("Loading %u sector tiles, %u already loaded", (unsigned)sectorsToLoad.size(),
+	        alreadyLoaded);
+	auto loadTiles = [&state, &sectorsToLoad](unsigned int index, unsigned int) {
+		auto *sec = sectorsToLoad[index];
+		LogInfo("Loading sector tiles \"%s\"", sec->sectorTilesName);
+		auto tiles = mkup<BattleMapSectorTiles>();
+		if (!tiles->loadSector(state, BattleMapSectorTiles::getMapSectorPath() + "/" +
+		                                  sec->sectorTilesName))
+		{
+			LogError("Failed to load sector tiles \"%s\"", sec->sectorTilesName);
+		}
+		sec->tiles = std::move(tiles);
+	};
+	auto framework = Framework::tryGetInstance();
+	if (framework && sectorsToLoad.size() > 1)
+	{
+		framework->threadPoolParallelFor(sectorsToLoad.size(), loadTiles);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < sectorsToLoad.size(); index++)
+		{
+			loadTiles(index, 0);
+		}
+	}
+
 	for (int x = 0; x < size.x; x++)
 	{
 		for (int y = 0; y < size.y; y++)
@@ -1009,21 +1064,6 @@ BattleMap::fillMap(std::vector<std::list<std::pair<Vec3<int>, sp<BattleMapPart>>
 				auto sec = sec_map[x + y * size.x + z * size.x * size.y];
 				if (!sec)
 					continue;
-				if (!sec->tiles)
-				{
-					LogInfo("Loading sector tiles \"%s\"", sec->sectorTilesName);
-					sec->tiles.reset(new BattleMapSectorTiles());
-					if (!sec->tiles->loadSector(state,
-					                            BattleMapSectorTiles::getMapSectorPath() + "/" +
-					                                sec->sectorTilesName))
-					{
-						LogError("Failed to load sector tiles \"%s\"", sec->sectorTilesName);
-					}
-				}
-				else
-				{
-					LogInfo("Using already-loaded sector tiles \"%s\"", sec->sectorTilesName);
-				}
 				auto &tiles = *sec->tiles;
 				Vec3<int> shift = {x * chunk_size.x, y * chunk_size.y, z * chunk_size.z};
 
@@ -1402,7 +1442,7 @@ void BattleMap::initNewMap(sp<Battle> b)
 	// Init visibility
 	for (auto &o : b->participants)
 	{
-		b->visibleTiles[o] = std::vector<bool>(b->size.x * b->size.y * b->size.z, false);
+		b->visibleTiles[o] = BitVector(b->size.x * b->size.y * b->size.z);
 		b->visibleBlocks[o] = std::vector<bool>(b->losBlocks.size(), false);
 		b->visibleUnits[o] = {};
 	}
@@ -1445,11 +1485,36 @@ void BattleMap::initNewMap(sp<Battle> b)
 	}
 }
 
-void BattleMap::unloadTiles()
+void BattleMap::unloadTiles(GameState &state)
 {
-	for (auto &s : sectors)
-		s.second->tiles = nullptr;
-	LogInfo("Unloaded sector tiles.");
+	std::vector<BattleMapSector *> loaded;
+	for (auto &map : state.battle_maps)
+	{
+		for (auto &s : map.second->sectors)
+		{
+			if (s.second->tiles)
+			{
+				loaded.push_back(s.second.get());
+			}
+		}
+	}
+	auto keep = static_cast<size_t>(std::max(0, sectorTilesCacheOption.get()));
+	if (loaded.size() > keep)
+	{
+		std::sort(loaded.begin(), loaded.end(), [](BattleMapSector *a, BattleMapSector *b) {
+			return a->tilesLastUsed > b->tilesLastUsed;
+		});
+		for (size_t i = keep; i < loaded.size(); i++)
+		{
+			loaded[i]->tiles = nullptr;
+		}
+		loaded.resize(keep);
+	}
+	for (auto *s : loaded)
+	{
+		s->tiles->clearResolvedTypes();
+	}
+	LogInfo("Unloaded sector tiles, kept those of %u sectors", (unsigned)loaded.size());
 }
 
 sp<Battle> BattleMap::createBattle(GameState &state, StateRef<Organisation> propertyOwner,
@@ -1517,7 +1582,7 @@ sp<Battle> BattleMap::createBattle(GameState &state, StateRef<Organisation> prop
 	initNewMap(b);
 
 	// Step 07: Unload sector tiles
-	unloadTiles();
+	unloadTiles(state);
 
 	// Step 08: Make target hostile
 	state.getPlayer()->current_relations[target_organisation] = -100.0f;
@@ -1575,6 +1640,8 @@ void BattleMap::loadTilesets(GameState &state) const
 					break;
 			}
 			tile->damageModifier = {&state, "DAMAGEMODIFIER_TERRAIN_1_"};
+			tile->voxelMapLOF = state.voxelPool.intern(tile->voxelMapLOF);
+			tile->voxelMapLOS = state.voxelPool.intern(tile->voxelMapLOS);
 			// Sanity check
 			if (state.battleMapTiles.find(tileName) != state.battleMapTiles.end())
 			{
@@ -108,7 +108,9 @@ class BattleMap : public StateObject
 
 	void initNewMap(sp<Battle> b);
 
-	void unloadTiles();
+	// Unloads the tiles of every battle map's sectors but those of the most recently used
+	// Game.Battle.SectorTilesCache, as the same maps tend to be fought on again
+	static void unloadTiles(GameState &state);
 
 	void loadTilesets(GameState &state) const;
 	static void unloadTilesets(GameState &state);
@@ -41,4 +41,16 @@ sp<BattleMapSector::LineOfSightBlock> BattleMapSector::LineOfSightBlock::clone(V
 }
 
 UString BattleMapSectorTiles::getMapSectorPath() { return fw().getDataDir() + "/maps"; }
+
+void BattleMapSectorTiles::clearResolvedTypes()
+{
+	for (auto *parts :
+	     {&initial_grounds, &initial_left_walls, &initial_right_walls, &initial_features})
+	{
+		for (auto &pair : *parts)
+		{
+			pair.second = pair.second.id;
+		}
+	}
+}
 }
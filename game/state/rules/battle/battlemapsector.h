@@ -58,6 +58,9 @@ class BattleMapSector : public StateObject
 
 	UString sectorTilesName;
 	up<BattleMapSectorTiles> tiles;
+	// The last battle made with the sector, counting up, for BattleMap::unloadTiles() to tell whose
+	// tiles were used most recently
+	unsigned int tilesLastUsed = 0;
 
 	std::map<StateRef<AgentType>, std::list<Vec3<int>>> spawnLocations;
 };
@@ -78,6 +81,10 @@ class BattleMapSectorTiles
 
 	static UString getMapSectorPath();
 
+	// Makes the map part types be looked up again the next time they are used, as the tilesets
+	// are loaded again for every battle while the tiles may be kept for the next
+	void clearResolvedTypes();
+
 	// high level api for loading map sectors
 	bool loadSector(GameState &state, const UString &path);
 
@@ -66,28 +66,204 @@ BattleUnitAnimationPack::AnimationEntry::Frame::InfoBlock::InfoBlock(int index,
 {
 }
 
+namespace
+{
+// Every value of each enum the tables are indexed by
+const int WIELD_MODES = 3;
+const int HAND_STATES = 3;
+const int MOVEMENT_STATES = 6;
+const int BODY_STATES = 8;
+// Firing angles go from -2 to 2
+const int FIRING_ANGLES = 5;
+const int FACINGS = 9;
+
+ItemWieldMode getWieldMode(const StateRef<AEquipmentType> &heldItem)
+{
+	return heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
+	                : ItemWieldMode::None;
+}
+
+// Returns -1 for facings that aren't one of the 8 directions or none
+int getFacingIndex(Vec2<int> facing)
+{
+	if (facing.x < -1 || facing.x > 1 || facing.y < -1 || facing.y > 1)
+	{
+		return -1;
+	}
+	return (facing.x + 1) * 3 + facing.y + 1;
+}
+
+int getStandardIndex(ItemWieldMode wield, HandState hands, MovementState movement, BodyState body)
+{
+	return (((int)wield * HAND_STATES + (int)hands) * MOVEMENT_STATES + (int)movement) *
+	           BODY_STATES +
+	       (int)body;
+}
+
+int getHandIndex(ItemWieldMode wield, HandState currentHands, HandState targetHands,
+                 MovementState movement, BodyState body)
+{
+	return ((((int)wield * HAND_STATES + (int)currentHands) * HAND_STATES + (int)targetHands) *
+	            MOVEMENT_STATES +
+	        (int)movement) *
+	           BODY_STATES +
+	       (int)body;
+}
+
+int getBodyIndex(ItemWieldMode wield, HandState hands, MovementState movement,
+                 BodyState currentBody, BodyState targetBody)
+{
+	return ((((int)wield * HAND_STATES + (int)hands) * MOVEMENT_STATES + (int)movement) *
+	            BODY_STATES +
+	        (int)currentBody) *
+	           BODY_STATES +
+	       (int)targetBody;
+}
+
+// Returns -1 for angles there can't be animations for
+int getAltFireIndex(ItemWieldMode wield, HandState hands, int angle, MovementState movement,
+                    BodyState body)
+{
+	if (angle < -2 || angle > 2)
+	{
+		return -1;
+	}
+	return ((((int)wield * HAND_STATES + (int)hands) * FIRING_ANGLES + angle + 2) *
+	            MOVEMENT_STATES +
+	        (int)movement) *
+	           BODY_STATES +
+	       (int)body;
+}
+} // anonymous namespace
+
+void BattleUnitAnimationPack::buildFrameTables()
+{
+	facingSpans.assign(1, FacingSpan());
+	auto addSpan = [this](std::vector<uint16_t> &table, int index,
+	                      const std::map<Vec2<int>, sp<AnimationEntry>> &byFacing) {
+		FacingSpan span;
+		bool any = false;
+		for (auto &entry : byFacing)
+		{
+			int facing = getFacingIndex(entry.first);
+			if (facing == -1 || !entry.second)
+			{
+				continue;
+			}
+			span.entries[facing] = entry.second.get();
+			any = true;
+		}
+		if (any)
+		{
+			table[index] = static_cast<uint16_t>(facingSpans.size());
+			facingSpans.push_back(span);
+		}
+	};
+
+	standardTable.assign(WIELD_MODES * HAND_STATES * MOVEMENT_STATES * BODY_STATES, 0);
+	for (auto &a : standart_animations)
+	{
+		auto &k = a.first;
+		addSpan(standardTable, getStandardIndex(k.itemWieldMode, k.handState, k.movementState,
+		                                        k.bodyState),
+		        a.second);
+	}
+	handTable.assign(WIELD_MODES * HAND_STATES * HAND_STATES * MOVEMENT_STATES * BODY_STATES, 0);
+	for (auto &a : hand_state_animations)
+	{
+		auto &k = a.first;
+		addSpan(handTable, getHandIndex(k.itemWieldMode, k.currentHand, k.targetHand,
+		                                k.movementState, k.bodyState),
+		        a.second);
+	}
+	bodyTable.assign(WIELD_MODES * HAND_STATES * MOVEMENT_STATES * BODY_STATES * BODY_STATES, 0);
+	for (auto &a : body_state_animations)
+	{
+		auto &k = a.first;
+		addSpan(bodyTable, getBodyIndex(k.itemWieldMode, k.handState, k.movementState,
+		                                k.currentBodyState, k.targetBodyState),
+		        a.second);
+	}
+	altFireTable.assign(WIELD_MODES * HAND_STATES * FIRING_ANGLES * MOVEMENT_STATES * BODY_STATES,
+	                    0);
+	for (auto &a : alt_fire_animations)
+	{
+		auto &k = a.first;
+		int index =
+		    getAltFireIndex(k.itemWieldMode, k.handState, k.angle, k.movementState, k.bodyState);
+		if (index != -1)
+		{
+			addSpan(altFireTable, index, a.second);
+		}
+	}
+	frameTablesBuilt = true;
+}
+
+BattleUnitAnimationPack::AnimationEntry *
+BattleUnitAnimationPack::findInTable(const std::vector<uint16_t> &table, int index,
+                                     Vec2<int> facing)
+{
+	if (!frameTablesBuilt)
+	{
+		buildFrameTables();
+	}
+	int facingIndex = getFacingIndex(facing);
+	if (index == -1 || facingIndex == -1)
+	{
+		return nullptr;
+	}
+	return facingSpans[table[index]].entries[facingIndex];
+}
+
+BattleUnitAnimationPack::AnimationEntry *
+BattleUnitAnimationPack::getStandardAnimation(ItemWieldMode wield, HandState hands,
+                                              MovementState movement, BodyState body,
+                                              Vec2<int> facing)
+{
+	return findInTable(standardTable, getStandardIndex(wield, hands, movement, body), facing);
+}
+
+BattleUnitAnimationPack::AnimationEntry *
+BattleUnitAnimationPack::getHandAnimation(ItemWieldMode wield, HandState currentHands,
+                                          HandState targetHands, MovementState movement,
+                                          BodyState body, Vec2<int> facing)
+{
+	return findInTable(handTable, getHandIndex(wield, currentHands, targetHands, movement, body),
+	                   facing);
+}
+
+BattleUnitAnimationPack::AnimationEntry *
+BattleUnitAnimationPack::getBodyAnimation(ItemWieldMode wield, HandState hands,
+                                          MovementState movement, BodyState currentBody,
+                                          BodyState targetBody, Vec2<int> facing)
+{
+	return findInTable(bodyTable,
+	                   getBodyIndex(wield, hands, movement, currentBody, targetBody), facing);
+}
+
+BattleUnitAnimationPack::AnimationEntry *
+BattleUnitAnimationPack::getAltFireAnimation(ItemWieldMode wield, HandState hands, int angle,
+                                             MovementState movement, BodyState body,
+                                             Vec2<int> facing)
+{
+	return findInTable(altFireTable, getAltFireIndex(wield, hands, angle, movement, body),
+	                   facing);
+}
+
 int BattleUnitAnimationPack::getFrameCountBody(StateRef<AEquipmentType> heldItem,
                                                BodyState currentBody, BodyState targetBody,
                                                HandState currentHands, MovementState movement,
                                                Vec2<int> facing)
 {
-	sp<AnimationEntry> e;
+	auto wieldMode = getWieldMode(heldItem);
+	AnimationEntry *e = nullptr;
 	if (currentBody == targetBody)
 	{
-		AnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody};
-
-		e = standart_animations[key][facing];
+		e = getStandardAnimation(wieldMode, currentHands, movement, currentBody, facing);
 	}
 	else
 	{
-		ChangingBodyStateAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody, targetBody};
-		e = body_state_animations[key][facing];
+		e = getBodyAnimation(wieldMode, currentHands, movement, currentBody, targetBody, facing);
 	}
 	if (e)
 		return e->frame_count;
@@ -100,23 +276,15 @@ int BattleUnitAnimationPack::getFrameCountHands(StateRef<AEquipmentType> heldIte
                                                 HandState targetHands, MovementState movement,
                                                 Vec2<int> facing)
 {
-	sp<AnimationEntry> e;
+	auto wieldMode = getWieldMode(heldItem);
+	AnimationEntry *e = nullptr;
 	if (currentHands == targetHands)
 	{
-		AnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody};
-
-		e = standart_animations[key][facing];
+		e = getStandardAnimation(wieldMode, currentHands, movement, currentBody, facing);
 	}
 	else
 	{
-		ChangingHandAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, targetHands, movement, currentBody};
-		e = hand_state_animations[key][facing];
+		e = getHandAnimation(wieldMode, currentHands, targetHands, movement, currentBody, facing);
 	}
 	if (e)
 		return e->frame_count;
@@ -128,14 +296,8 @@ int BattleUnitAnimationPack::getFrameCountFiring(StateRef<AEquipmentType> heldIt
                                                  BodyState currentBody, MovementState movement,
                                                  Vec2<int> facing)
 {
-	sp<AnimationEntry> e;
-	{
-		AnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    HandState::Firing, movement, currentBody};
-		e = standart_animations[key][facing];
-	}
+	auto e = getStandardAnimation(getWieldMode(heldItem), HandState::Firing, movement,
+	                              currentBody, facing);
 	if (e)
 		return e->frame_count;
 	else
@@ -155,15 +317,12 @@ void BattleUnitAnimationPack::drawShadow(
 	// If we are calling this, then we have already ensured that object has shadows,
 	// and should not check for it again
 
-	sp<AnimationEntry> e;
+	auto wieldMode = getWieldMode(heldItem);
+	AnimationEntry *e = nullptr;
 	int frame = -1;
 	if (currentHands != targetHands)
 	{
-		ChangingHandAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, targetHands, movement, currentBody};
-		e = hand_state_animations[key][facing];
+		e = getHandAnimation(wieldMode, currentHands, targetHands, movement, currentBody, facing);
 		if (!e)
 		{
 			LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -174,11 +333,7 @@ void BattleUnitAnimationPack::drawShadow(
 	}
 	else if (currentBody != targetBody)
 	{
-		ChangingBodyStateAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody, targetBody};
-		e = body_state_animations[key][facing];
+		e = getBodyAnimation(wieldMode, currentHands, movement, currentBody, targetBody, facing);
 		if (!e)
 		{
 			LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -189,12 +344,7 @@ void BattleUnitAnimationPack::drawShadow(
 	}
 	else
 	{
-		AnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody};
-
-		e = standart_animations[key][facing];
+		e = getStandardAnimation(wieldMode, currentHands, movement, currentBody, facing);
 		if (!e)
 		{
 			LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -250,17 +400,14 @@ void BattleUnitAnimationPack::drawUnit(
 		return;
 	}
 
-	sp<AnimationEntry> e;
-	sp<AnimationEntry> e_legs;
+	auto wieldMode = getWieldMode(heldItem);
+	AnimationEntry *e = nullptr;
+	AnimationEntry *e_legs = nullptr;
 	int frame = -1;
 	int frame_legs = -1;
 	if (currentHands != targetHands)
 	{
-		ChangingHandAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, targetHands, movement, currentBody};
-		e = hand_state_animations[key][facing];
+		e = getHandAnimation(wieldMode, currentHands, targetHands, movement, currentBody, facing);
 		if (!e)
 		{
 			LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -270,22 +417,15 @@ void BattleUnitAnimationPack::drawUnit(
 		frame = e->frame_count - hands_animation_delay;
 		if (e->is_overlay)
 		{
-			AnimationKey standardKey = {heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded
-			                                                             : ItemWieldMode::OneHanded)
-			                                     : ItemWieldMode::None,
-			                            HandState::AtEase, movement, currentBody};
-			e_legs = standart_animations[standardKey][facing];
+			e_legs =
+			    getStandardAnimation(wieldMode, HandState::AtEase, movement, currentBody, facing);
 			frame_legs =
 			    (distance_travelled * 100 / e_legs->units_per_100_frames) % e_legs->frame_count;
 		}
 	}
 	else if (currentBody != targetBody)
 	{
-		ChangingBodyStateAnimationKey key = {
-		    heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded : ItemWieldMode::OneHanded)
-		             : ItemWieldMode::None,
-		    currentHands, movement, currentBody, targetBody};
-		e = body_state_animations[key][facing];
+		e = getBodyAnimation(wieldMode, currentHands, movement, currentBody, targetBody, facing);
 		if (!e)
 		{
 			LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -299,10 +439,8 @@ void BattleUnitAnimationPack::drawUnit(
 		if ((currentHands == HandState::Firing || currentHands == HandState::Aiming) &&
 		    hasAlternativeFiringAnimations && firingAngle != 0)
 		{
-			e = alt_fire_animations[{heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded
-			                                                          : ItemWieldMode::OneHanded)
-			                                  : ItemWieldMode::None,
-			                         currentHands, firingAngle, movement, currentBody}][facing];
+			e = getAltFireAnimation(wieldMode, currentHands, firingAngle, movement, currentBody,
+			                        facing);
 			if (!e)
 			{
 				LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -312,11 +450,7 @@ void BattleUnitAnimationPack::drawUnit(
 		}
 		else
 		{
-			AnimationKey key = {heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded
-			                                                     : ItemWieldMode::OneHanded)
-			                             : ItemWieldMode::None,
-			                    currentHands, movement, currentBody};
-			e = standart_animations[key][facing];
+			e = getStandardAnimation(wieldMode, currentHands, movement, currentBody, facing);
 			if (!e)
 			{
 				LogWarning("Body %d %d Hands %d %d Movement %d Frame missing!", (int)currentBody,
@@ -334,11 +468,8 @@ void BattleUnitAnimationPack::drawUnit(
 		// But since frame_count is 1, the previous line attains the same result, so why bother
 		if (e->is_overlay)
 		{
-			AnimationKey key = {heldItem ? (heldItem->two_handed ? ItemWieldMode::TwoHanded
-			                                                     : ItemWieldMode::OneHanded)
-			                             : ItemWieldMode::None,
-			                    HandState::AtEase, movement, currentBody};
-			e_legs = standart_animations[key][facing];
+			e_legs =
+			    getStandardAnimation(wieldMode, HandState::AtEase, movement, currentBody, facing);
 			frame_legs =
 			    (distance_travelled * 100 / e_legs->units_per_100_frames) % e_legs->frame_count;
 		}
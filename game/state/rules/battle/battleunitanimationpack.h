@@ -5,6 +5,7 @@
 #include "library/sp.h"
 #include "library/strings.h"
 #include "library/vec.h"
+#include <cstdint>
 #include <list>
 #include <map>
 #include <vector>
@@ -229,5 +230,38 @@ class BattleUnitAnimationPack : public StateObject
 	static const UString getNameFromID(UString id);
 
 	static UString getAnimationPackPath();
+
+	// Must be called if any of the animation maps change after the pack was first drawn
+	void buildFrameTables();
+
+  private:
+	// The animation maps compiled into flat tables, indexed by every enum in their keys, that
+	// give a span of the animation for every facing. Built the first time an animation is
+	// looked up, as drawing goes through them for every unit every frame
+	class FacingSpan
+	{
+	  public:
+		// By facing, (x + 1) * 3 + y + 1, nullptr where there's no animation
+		AnimationEntry *entries[9] = {};
+	};
+	// The first of them has no animations, for every key without any
+	std::vector<FacingSpan> facingSpans;
+	std::vector<uint16_t> standardTable;
+	std::vector<uint16_t> handTable;
+	std::vector<uint16_t> bodyTable;
+	std::vector<uint16_t> altFireTable;
+	bool frameTablesBuilt = false;
+
+	AnimationEntry *findInTable(const std::vector<uint16_t> &table, int index, Vec2<int> facing);
+	AnimationEntry *getStandardAnimation(ItemWieldMode wield, HandState hands,
+	                                     MovementState movement, BodyState body, Vec2<int> facing);
+	AnimationEntry *getHandAnimation(ItemWieldMode wield, HandState currentHands,
+	                                 HandState targetHands, MovementState movement, BodyState body,
+	                                 Vec2<int> facing);
+	AnimationEntry *getBodyAnimation(ItemWieldMode wield, HandState hands, MovementState movement,
+	                                 BodyState currentBody, BodyState targetBody,
+	                                 Vec2<int> facing);
+	AnimationEntry *getAltFireAnimation(ItemWieldMode wield, HandState hands, int angle,
+	                                    MovementState movement, BodyState body, Vec2<int> facing);
 };
 }
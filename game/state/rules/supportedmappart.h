@@ -5,6 +5,7 @@
 #include "library/sp.h"
 #include "library/vec.h"
 #include <set>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -17,6 +18,37 @@ class SupportedMapPart
 	// Attempts to re-link map parts to supports in the provided set
 	static void attemptReLinkSupports(sp<std::set<SupportedMapPart *>> set);
 
+	// Calls link(part) on every part that will collapse, in the order given, then again on those
+	// left until none of them links, cancelling the collapse of every part that does. Parts that
+	// are not going to collapse are dropped from the list, so that each round only goes through
+	// the ones still waiting for support
+	template <typename Part, typename Link>
+	static void linkUpCollapsing(std::vector<Part *> &parts, Link link)
+	{
+		bool linked;
+		do
+		{
+			linked = false;
+			size_t waiting = 0;
+			for (size_t i = 0; i < parts.size(); i++)
+			{
+				auto part = parts[i];
+				if (!part->willCollapse())
+				{
+					continue;
+				}
+				if (link(*part))
+				{
+					part->cancelCollapse();
+					linked = true;
+					continue;
+				}
+				parts[waiting++] = part;
+			}
+			parts.resize(waiting);
+		} while (linked);
+	}
+
   public:
 	// Compiles a list of parts supported by this part
 	// Using sp because we switch to a new one constantly in re-linking
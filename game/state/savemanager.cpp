@@ -6,6 +6,10 @@
 #include "framework/trace.h"
 #include "game/state/gamestate.h"
 #include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 // Disable automatic #pragma linking for boost - only enabled in msvc and that should provide boost
@@ -22,10 +26,16 @@ namespace OpenApoc
 {
 const UString saveManifestName = "save_manifest";
 const UString saveFileExtension = ".save";
+const UString saveIndexName = "save_index";
 
 ConfigOptionString saveDirOption("Game.Save", "Directory", "Directory containing saved games",
                                  "./saves");
 ConfigOptionBool packSaveOption("Game.Save", "Pack", "Pack saved games into a zip", true);
+ConfigOptionBool binarySaveOption("Game.Save", "Binary",
+                                  "Write saved games in the binary format instead of XML", false);
+ConfigOptionBool deltaSaveOption("Game.Save", "Delta",
+                                 "Only save what differs from the rules the game was started from",
+                                 false);
 
 SaveManager::SaveManager() : saveDirectory(saveDirOption.get()) {}
 
@@ -49,11 +59,64 @@ std::shared_future<void> SaveManager::loadGame(const SaveMetadata &metadata,
 	return loadGame(metadata.getFile(), state);
 }
 
+// Delta saves list the gamestates they were written against in a delta_base document, and are
+// only read over those, which are loaded first
+static bool loadDeltaBase(const UString &savePath, GameState &state)
+{
+	auto archive = SerializationArchive::readArchive(savePath);
+	if (!archive)
+	{
+		return false;
+	}
+	auto root = archive->getRoot("", "delta_base");
+	if (!root)
+	{
+		return true;
+	}
+	for (auto base = root->getNodeOpt("base"); base; base = base->getNextSiblingOpt("base"))
+	{
+		auto basePath = base->getValue();
+		if (!state.loadGame(fw().getDataDir() + "/" + basePath))
+		{
+			LogError("Failed to load \"%s\" the save is a delta against", basePath);
+			return false;
+		}
+		state.baseStates.push_back(basePath);
+	}
+	return true;
+}
+
+// Loading the gamestates a delta is against takes a while, so the last ones are kept
+static sp<GameState> getDeltaBase(const std::vector<UString> &baseStates)
+{
+	static std::mutex mutex;
+	static std::vector<UString> cachedBaseStates;
+	static sp<GameState> cachedBase;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (cachedBase && cachedBaseStates == baseStates)
+	{
+		return cachedBase;
+	}
+	auto base = mksp<GameState>();
+	for (auto &basePath : baseStates)
+	{
+		if (!base->loadGame(fw().getDataDir() + "/" + basePath))
+		{
+			LogError("Failed to load \"%s\" to save a delta against", basePath);
+			return nullptr;
+		}
+	}
+	cachedBaseStates = baseStates;
+	cachedBase = base;
+	return cachedBase;
+}
+
 std::shared_future<void> SaveManager::loadGame(const UString &savePath, sp<GameState> state) const
 {
 	UString saveArchiveLocation = savePath;
 	auto loadTask = fw().threadPoolEnqueue([saveArchiveLocation, state]() -> void {
-		if (!state->loadGame(saveArchiveLocation))
+		if (!loadDeltaBase(saveArchiveLocation, *state) ||
+		    !state->loadGame(saveArchiveLocation))
 		{
 			LogError("Failed to load '%s'", saveArchiveLocation);
 			return;
@@ -89,8 +152,12 @@ std::shared_future<void> SaveManager::loadSpecialSave(const SaveType type,
 	return loadGame(createSavePath(saveName), state);
 }
 
+// Saves written in the background may still be going when another one to the same path starts
+static std::mutex writeArchiveMutex;
+
 bool writeArchiveWithBackup(SerializationArchive *archive, const UString &path, bool pack)
 {
+	std::lock_guard<std::mutex> lock(writeArchiveMutex);
 	fs::path savePath = path.str();
 	fs::path tempPath;
 	bool shouldCleanup = false;
@@ -166,6 +233,124 @@ bool writeArchiveWithBackup(SerializationArchive *archive, const UString &path,
 	return false;
 }
 
+// The index of a save directory keeps the manifest of every save in it, so that listing the saves
+// only has to open those written since the index was. Every line is a save, as its file name,
+// size, modification time and manifest separated by tabs. A save with a different size or
+// modification time than in the index is read again, so the index going stale (like after a save
+// is renamed, or changed by something else) only costs that
+namespace
+{
+class SaveIndexEntry
+{
+  public:
+	uintmax_t size = 0;
+	int64_t modified = 0;
+	SaveMetadata metadata;
+};
+} // anonymous namespace
+
+// Guards reading and writing the index, as background saves update it from the thread pool
+static std::mutex saveIndexMutex;
+
+static bool getSaveStamp(const fs::path &path, uintmax_t &size, int64_t &modified)
+{
+	try
+	{
+		// Unpacked saves are directories, which are rewritten as a whole
+		size = fs::is_directory(path) ? 0 : fs::file_size(path);
+#if defined(USE_BOOST_FILESYSTEM)
+		modified = static_cast<int64_t>(fs::last_write_time(path));
+#else
+		modified = static_cast<int64_t>(fs::last_write_time(path).time_since_epoch().count());
+#endif
+		return true;
+	}
+	catch (fs::filesystem_error)
+	{
+		return false;
+	}
+}
+
+// Returns the entries of the index of the save directory by file name, with their manifests
+// giving the saves' paths as within saveDirectory
+static std::map<std::string, SaveIndexEntry> readSaveIndex(const UString &saveDirectory)
+{
+	std::map<std::string, SaveIndexEntry> index;
+	std::ifstream in((saveDirectory + "/" + saveIndexName).str());
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string fileName, size, modified, name, difficulty, creationDate, type, gameTicks;
+		if (!std::getline(fields, fileName, '\t') || !std::getline(fields, size, '\t') ||
+		    !std::getline(fields, modified, '\t') || !std::getline(fields, creationDate, '\t') ||
+		    !std::getline(fields, type, '\t') || !std::getline(fields, gameTicks, '\t') ||
+		    !std::getline(fields, difficulty, '\t') || !std::getline(fields, name))
+		{
+			LogWarning("Ignoring malformed save index line \"%s\"", line);
+			continue;
+		}
+		SaveIndexEntry entry;
+		entry.size = std::strtoull(size.c_str(), nullptr, 10);
+		entry.modified = std::strtoll(modified.c_str(), nullptr, 10);
+		entry.metadata = SaveMetadata(
+		    name, saveDirectory + "/" + fileName, difficulty,
+		    static_cast<time_t>(std::strtoll(creationDate.c_str(), nullptr, 10)),
+		    static_cast<SaveType>(std::strtoul(type.c_str(), nullptr, 10)),
+		    std::strtoull(gameTicks.c_str(), nullptr, 10));
+		index[fileName] = entry;
+	}
+	return index;
+}
+
+static void writeSaveIndex(const UString &saveDirectory,
+                           const std::map<std::string, SaveIndexEntry> &index)
+{
+	auto path = saveDirectory + "/" + saveIndexName;
+	std::ofstream out(path.str(), std::ios::trunc);
+	for (auto &pair : index)
+	{
+		auto &metadata = pair.second.metadata;
+		// Anything that would break up the line is left out, to be read from the save every time
+		if (metadata.getName().str().find_first_of("\t\r\n") != std::string::npos ||
+		    metadata.getDifficulty().str().find_first_of("\t\r\n") != std::string::npos)
+		{
+			continue;
+		}
+		out << pair.first << '\t' << pair.second.size << '\t' << pair.second.modified << '\t'
+		    << static_cast<int64_t>(metadata.getCreationDate()) << '\t'
+		    << static_cast<unsigned>(metadata.getType()) << '\t' << metadata.getGameTicks()
+		    << '\t' << metadata.getDifficulty().str() << '\t' << metadata.getName().str()
+		    << '\n';
+	}
+	if (!out)
+	{
+		LogWarning("Failed to write save index \"%s\"", path);
+	}
+}
+
+// Puts the save just written with this metadata in the index of its directory, or with
+// written false takes it out
+static void updateSaveIndex(const SaveMetadata &metadata, bool written)
+{
+	fs::path savePath = metadata.getFile().str();
+	UString saveDirectory = savePath.parent_path().string();
+	std::string fileName = savePath.filename().string();
+	std::lock_guard<std::mutex> lock(saveIndexMutex);
+	auto index = readSaveIndex(saveDirectory);
+	SaveIndexEntry entry;
+	if (written && getSaveStamp(savePath, entry.size, entry.modified))
+	{
+		entry.metadata = metadata;
+		index[fileName] = entry;
+	}
+	else
+	{
+		index.erase(fileName);
+	}
+	writeSaveIndex(saveDirectory, index);
+}
+
 bool SaveManager::findFreePath(UString &path, const UString &name) const
 {
 	path = createSavePath("save_" + name);
@@ -230,16 +415,45 @@ bool SaveManager::saveGame(const SaveMetadata &metadata, const sp<GameState> gam
 	bool pack = packSaveOption.get();
 	const UString path = metadata.getFile();
 	TRACE_FN_ARGS1("path", path);
-	auto archive = SerializationArchive::createArchive();
-	if (gameState->serialize(archive.get()) && metadata.serializeManifest(archive.get()))
+	auto archive = serializeGame(metadata, gameState);
+	if (archive && writeArchiveWithBackup(archive.get(), path, pack))
 	{
-		return writeArchiveWithBackup(archive.get(), path, pack);
+		updateSaveIndex(metadata, true);
+		return true;
 	}
 
 	return false;
 }
 
-bool SaveManager::specialSaveGame(SaveType type, const sp<GameState> gameState) const
+up<SerializationArchive> SaveManager::serializeGame(const SaveMetadata &metadata,
+                                                    const sp<GameState> gameState) const
+{
+	auto archive = SerializationArchive::createArchive(
+	    binarySaveOption.get() ? SerializationFormat::Binary : SerializationFormat::XML);
+	sp<GameState> base;
+	if (deltaSaveOption.get() && !gameState->baseStates.empty())
+	{
+		base = getDeltaBase(gameState->baseStates);
+	}
+	if (base)
+	{
+		auto root = archive->newRoot("", "delta_base");
+		for (auto &basePath : gameState->baseStates)
+		{
+			root->addNode("base", basePath);
+		}
+	}
+	if ((base ? gameState->serialize(archive.get(), *base) : gameState->serialize(archive.get())) &&
+	    metadata.serializeManifest(archive.get()))
+	{
+		return archive;
+	}
+
+	return nullptr;
+}
+
+bool SaveManager::createSpecialMetadata(SaveType type, const sp<GameState> gameState,
+                                        SaveMetadata &metadata) const
 {
 	if (type == SaveType::Manual)
 	{
@@ -258,10 +472,48 @@ bool SaveManager::specialSaveGame(SaveType type, const sp<GameState> gameState)
 		return false;
 	}
 
-	SaveMetadata manifest(saveName, createSavePath(saveName), time(nullptr), type, gameState);
+	metadata = SaveMetadata(saveName, createSavePath(saveName), time(nullptr), type, gameState);
+	return true;
+}
+
+bool SaveManager::specialSaveGame(SaveType type, const sp<GameState> gameState) const
+{
+	SaveMetadata manifest;
+	if (!createSpecialMetadata(type, gameState, manifest))
+	{
+		return false;
+	}
 	return saveGame(manifest, gameState);
 }
 
+std::shared_future<bool>
+SaveManager::specialSaveGameInBackground(SaveType type, const sp<GameState> gameState) const
+{
+	SaveMetadata manifest;
+	if (!createSpecialMetadata(type, gameState, manifest))
+	{
+		return std::async(std::launch::deferred, []() -> bool { return false; });
+	}
+	TRACE_FN_ARGS1("path", manifest.getFile());
+	// The archive holds its own copy of everything to be written, so once it is filled in the
+	// game can go on changing while it is turned into text, compressed and written out
+	sp<SerializationArchive> archive = serializeGame(manifest, gameState);
+	if (!archive)
+	{
+		return std::async(std::launch::deferred, []() -> bool { return false; });
+	}
+	bool pack = packSaveOption.get();
+	UString path = manifest.getFile();
+	return fw().threadPoolEnqueue([archive, manifest, path, pack]() -> bool {
+		if (!writeArchiveWithBackup(archive.get(), path, pack))
+		{
+			return false;
+		}
+		updateSaveIndex(manifest, true);
+		return true;
+	});
+}
+
 std::vector<SaveMetadata> SaveManager::getSaveList() const
 {
 	auto dirString = saveDirOption.get();
@@ -276,6 +528,9 @@ std::vector<SaveMetadata> SaveManager::getSaveList() const
 			return saveList;
 		}
 
+		std::lock_guard<std::mutex> lock(saveIndexMutex);
+		auto index = readSaveIndex(saveDirectory.string());
+		std::map<std::string, SaveIndexEntry> newIndex;
 		for (auto i = fs::directory_iterator(currentPath / saveDirectory);
 		     i != fs::directory_iterator(); ++i)
 		{
@@ -285,6 +540,16 @@ std::vector<SaveMetadata> SaveManager::getSaveList() const
 			}
 
 			std::string saveFileName = i->path().filename().string();
+			SaveIndexEntry entry;
+			bool stamped = getSaveStamp(i->path(), entry.size, entry.modified);
+			auto indexed = index.find(saveFileName);
+			if (stamped && indexed != index.end() && indexed->second.size == entry.size &&
+			    indexed->second.modified == entry.modified)
+			{
+				saveList.push_back(indexed->second.metadata);
+				newIndex[saveFileName] = indexed->second;
+				continue;
+			}
 			// miniz can't read paths not starting with dor or with windows slashes
 			UString savePath = saveDirectory.string() + "/" + saveFileName;
 			if (auto archive = SerializationArchive::readArchive(savePath))
@@ -293,6 +558,11 @@ std::vector<SaveMetadata> SaveManager::getSaveList() const
 				if (metadata.deserializeManifest(archive.get(), savePath))
 				{
 					saveList.push_back(metadata);
+					if (stamped)
+					{
+						entry.metadata = metadata;
+						newIndex[saveFileName] = entry;
+					}
 				}
 				else // accept saves with missing manifest if extension is correct
 				{
@@ -301,6 +571,16 @@ std::vector<SaveMetadata> SaveManager::getSaveList() const
 				}
 			}
 		}
+		if (newIndex.size() != index.size() ||
+		    !std::equal(newIndex.begin(), newIndex.end(), index.begin(),
+		                [](const std::pair<const std::string, SaveIndexEntry> &a,
+		                   const std::pair<const std::string, SaveIndexEntry> &b) {
+			                return a.first == b.first && a.second.size == b.second.size &&
+			                       a.second.modified == b.second.modified;
+		                }))
+		{
+			writeSaveIndex(saveDirectory.string(), newIndex);
+		}
 	}
 	catch (fs::filesystem_error er)
 	{
@@ -325,6 +605,7 @@ bool SaveManager::deleteGame(const sp<SaveMetadata> &slot) const
 		}
 
 		fs::remove_all(slot->getFile().str());
+		updateSaveIndex(*slot, false);
 		return true;
 	}
 	catch (fs::filesystem_error exception)
@@ -437,6 +718,12 @@ SaveMetadata::SaveMetadata(const SaveMetadata &metdata, time_t creationDate,
 		// this->difficulty = gameState->difficulty; ?
 	}
 }
+SaveMetadata::SaveMetadata(UString name, UString file, UString difficulty, time_t creationDate,
+                           SaveType type, uint64_t gameTicks)
+    : name(name), file(file), difficulty(difficulty), creationDate(creationDate), type(type),
+      gameTicks(gameTicks)
+{
+}
 const UString &SaveMetadata::getName() const { return name; }
 const UString &SaveMetadata::getFile() const { return file; }
 const UString &SaveMetadata::getDifficulty() const { return difficulty; }
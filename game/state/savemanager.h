@@ -35,6 +35,8 @@ class SaveMetadata
 	SaveMetadata(UString name, UString file, time_t creationDate, SaveType type,
 	             const sp<GameState> gameState);
 	SaveMetadata(const SaveMetadata &metdata, time_t creationDate, const sp<GameState> gameState);
+	SaveMetadata(UString name, UString file, UString difficulty, time_t creationDate,
+	             SaveType type, uint64_t gameTicks);
 
 	/* Deserialize given manifest document	*/
 	bool deserializeManifest(SerializationArchive *archive, const UString &saveFileName);
@@ -68,6 +70,10 @@ class SaveManager
 	bool findFreePath(UString &path, const UString &name) const;
 
 	bool saveGame(const SaveMetadata &metadata, const sp<GameState> gameState) const;
+	up<SerializationArchive> serializeGame(const SaveMetadata &metadata,
+	                                       const sp<GameState> gameState) const;
+	bool createSpecialMetadata(SaveType type, const sp<GameState> gameState,
+	                           SaveMetadata &metadata) const;
 
   public:
 	SaveManager();
@@ -92,6 +98,11 @@ class SaveManager
 	// can be used for autosaves, quicksaves etc.
 	bool specialSaveGame(SaveType type, const sp<GameState> gameState) const;
 
+	// same as specialSaveGame, but only serializes the game before returning and leaves writing
+	// the archive out to the thread pool, so autosaves don't hold up the game for long
+	std::shared_future<bool> specialSaveGameInBackground(SaveType type,
+	                                                     const sp<GameState> gameState) const;
+
 	// list all reachable saved games
 	std::vector<SaveMetadata> getSaveList() const;
 
@@ -14,6 +14,7 @@
 #include "game/state/shared/agent.h"
 #include "game/state/shared/projectile.h"
 #include "game/state/tilemap/tileobject_battleunit.h"
+#include "library/pool.h"
 #include "library/sp.h"
 #include <algorithm>
 #include <glm/glm.hpp>
@@ -577,6 +578,16 @@ void AEquipment::update(GameState &state, unsigned int ticks)
 	}
 }
 
+bool AEquipment::needsUpdate() const
+{
+	if (isFiring() || inUse || primed)
+	{
+		return true;
+	}
+	auto payload = getPayloadType();
+	return payload && payload->recharge > 0 && ammo < payload->max_ammo;
+}
+
 void AEquipment::updateTB(GameState &state) { updateInner(state, TICKS_PER_TURN); }
 
 void AEquipment::prime(bool onImpact, int triggerDelay, float triggerRange)
@@ -668,7 +679,7 @@ void AEquipment::explode(GameState &state)
 				                (float)randBoundsInclusive(state.rng, 1, 1000) / 1000.0f};
 				velocity = glm::normalize(velocity);
 				velocity *= payload->speed * PROJECTILE_VELOCITY_MULTIPLIER;
-				auto p = mksp<Projectile>(
+				auto p = mkpooled<Projectile>(
 				    payload->guided ? Projectile::Type::Missile : Projectile::Type::Beam, ownerUnit,
 				    nullptr, Vec3<float>{0.0f, 0.0f, 0.0f},
 				    position + Vec3<float>{0.0f, 0.0f, 0.33f}, velocity, 0, payload->ttl,
@@ -758,7 +769,7 @@ void AEquipment::fire(GameState &state, Vec3<float> targetPosition, StateRef<Bat
 
 		if (state.current_battle->map->tileIsValid(unitPos))
 		{
-			auto p = mksp<Projectile>(
+			auto p = mkpooled<Projectile>(
 			    payload->guided ? Projectile::Type::Missile : Projectile::Type::Beam, unit,
 			    targetUnit, originalTarget, unitPos, velocity, payload->turn_rate, payload->ttl,
 			    payload->damage, payload->projectile_delay, payload->explosion_depletion_rate,
@@ -949,18 +960,34 @@ bool AEquipment::getVelocityForThrowLaunch(const BattleUnit *unit, const TileMap
 		return false;
 	}
 
+	// The same throws are looked at again and again while aiming, so remember what was found
+	// until anything changes on the map
+	sp<TileObject> thrower = unit ? unit->tileObject : nullptr;
+	if (auto solution = map.getThrowSolution(thrower.get(), startPos, target, velocityXY))
+	{
+		velocityXY = solution->velocityXY;
+		velocityZ = solution->velocityZ;
+		return solution->valid;
+	}
+	auto initialVelocityXY = velocityXY;
+
 	// Calculate trajectory
 	bool valid = true;
 	while (AEquipment::calculateNextVelocityForThrow(distance, startPos.z - target.z - 6.0f / 40.0f,
 	                                                 velocityXY, velocityZ))
 	{
-		valid = map.checkThrowTrajectory(unit ? unit->tileObject : nullptr, startPos, target,
-		                                 targetVectorXY, velocityXY, velocityZ);
+		valid = map.checkThrowTrajectory(thrower, startPos, target, targetVectorXY, velocityXY,
+		                                 velocityZ);
 		if (valid)
 		{
 			break;
 		}
 	}
+	ThrowSolution solution;
+	solution.valid = valid;
+	solution.velocityXY = velocityXY;
+	solution.velocityZ = velocityZ;
+	map.storeThrowSolution(thrower.get(), startPos, target, initialVelocityXY, solution);
 	return valid;
 }
 bool AEquipment::getCanThrow(const TileMap &map, int strength, Vec3<float> startPos,
@@ -106,6 +106,9 @@ class AEquipment : public std::enable_shared_from_this<AEquipment>, public Equip
 	bool canBeUsed(GameState &state) const;
 
 	void update(GameState &state, unsigned int ticks);
+	// Whether update() has anything to do, which it doesn't for an item that is not firing, in
+	// use, primed or recharging
+	bool needsUpdate() const;
 	void updateTB(GameState &state);
 	void updateInner(GameState &state, unsigned int ticks);
 
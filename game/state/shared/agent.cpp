@@ -845,6 +845,7 @@ bool Agent::addMission(GameState &state, AgentMission *mission, bool toBack)
 	{
 		missions.emplace_back(mission);
 	}
+	state.movingAgentsChanged = true;
 	return true;
 }
 
@@ -853,6 +854,7 @@ bool Agent::setMission(GameState &state, AgentMission *mission)
 	missions.clear();
 	missions.emplace_front(mission);
 	missions.front()->start(state, *this);
+	state.movingAgentsChanged = true;
 	return true;
 }
 
@@ -955,14 +957,7 @@ void Agent::update(GameState &state, unsigned ticks)
 		return;
 	}
 
-	if (teleportTicksAccumulated < TELEPORT_TICKS_REQUIRED_VEHICLE)
-	{
-		teleportTicksAccumulated += ticks;
-	}
-	if (!hasTeleporter())
-	{
-		teleportTicksAccumulated = 0;
-	}
+	updateTeleporter(ticks);
 
 	// Agents in vehicles don't update missions and dont' move
 	if (!currentVehicle)
@@ -976,6 +971,38 @@ void Agent::update(GameState &state, unsigned ticks)
 	}
 }
 
+bool Agent::isMovingInCity() const
+{
+	return !isDead() && city && !currentVehicle &&
+	       (!missions.empty() || position != goalPosition);
+}
+
+void Agent::updateIdle(GameState &state, unsigned ticks)
+{
+	if (isDead() || !city)
+	{
+		return;
+	}
+	updateTeleporter(ticks);
+	// The ground could still go from under an agent not in a vehicle, as updateMovement() checks
+	if (!currentVehicle && !city->map->getTile(position)->presentScenery)
+	{
+		die(state);
+	}
+}
+
+void Agent::updateTeleporter(unsigned ticks)
+{
+	if (teleportTicksAccumulated < TELEPORT_TICKS_REQUIRED_VEHICLE)
+	{
+		teleportTicksAccumulated += ticks;
+	}
+	if (!hasTeleporter())
+	{
+		teleportTicksAccumulated = 0;
+	}
+}
+
 void Agent::updateEachSecond(GameState &state)
 {
 	if (type->role != AgentType::Role::Soldier && currentBuilding != homeBuilding &&
@@ -987,28 +1014,28 @@ void Agent::updateEachSecond(GameState &state)
 
 void Agent::updateDaily(GameState &state) { recentlyFought = false; }
 
-void Agent::updateHourly(GameState &state)
+StateRef<Base> Agent::getBaseStayingAt() const
 {
-	StateRef<Base> base;
 	if (currentBuilding == homeBuilding)
 	{
 		// agent is in home building
-		base = currentBuilding->base;
+		return currentBuilding->base;
 	}
-	else if (currentVehicle && currentVehicle->currentBuilding == homeBuilding)
+	if (currentVehicle && currentVehicle->currentBuilding == homeBuilding)
 	{
 		// agent is in a vehicle stationed in home building
-		base = currentVehicle->currentBuilding->base;
-	}
-	else
-	{
-		// not in a base
-		return;
+		return currentVehicle->currentBuilding->base;
 	}
+	// not in a base
+	return {};
+}
+
+void Agent::updateHourly(GameState &state, const AgentFacilityUsage &facilityUsage)
+{
 	// Heal
 	if (modified_stats.health < current_stats.health && !recentlyFought)
 	{
-		int usage = base->getUsage(state, FacilityType::Capacity::Medical);
+		int usage = facilityUsage.medical;
 		if (usage < 999)
 		{
 			usage = std::max(100, usage);
@@ -1024,10 +1051,8 @@ void Agent::updateHourly(GameState &state)
 	// Train
 	if (trainingAssignment != TrainingAssignment::None)
 	{
-		int usage = base->getUsage(state,
-		                           trainingAssignment == TrainingAssignment::Physical
-		                               ? FacilityType::Capacity::Training
-		                               : FacilityType::Capacity::Psi);
+		int usage = trainingAssignment == TrainingAssignment::Physical ? facilityUsage.training
+		                                                                : facilityUsage.psi;
 		if (usage < 999)
 		{
 			usage = std::max(100, usage);
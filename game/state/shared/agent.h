@@ -35,6 +35,7 @@ class Vehicle;
 class AgentMission;
 class VoxelMap;
 class City;
+class Base;
 enum class AIType;
 
 enum class Rank
@@ -55,6 +56,16 @@ enum class TrainingAssignment
 	Psi
 };
 
+// How used the facilities agents heal and train in are at a base, worked out once an hour for
+// every agent staying there
+class AgentFacilityUsage
+{
+  public:
+	int medical = 0;
+	int training = 0;
+	int psi = 0;
+};
+
 class Agent : public StateObject,
               public std::enable_shared_from_this<Agent>,
               public EquippableObject
@@ -185,10 +196,20 @@ class Agent : public StateObject,
 
 	// Update agent in city
 	void update(GameState &state, unsigned ticks);
+	// Whether the agent has to be updated every tick, rather than sitting in a building or
+	// vehicle until it next gets a mission
+	bool isMovingInCity() const;
+	// Updates an agent that wasn't updated every tick for how long it sat still
+	void updateIdle(GameState &state, unsigned ticks);
+	void updateTeleporter(unsigned ticks);
 	void updateEachSecond(GameState &state);
 	void updateDaily(GameState &state);
-	void updateHourly(GameState &state);
+	// The base the agent heals and trains at this hour, if it is home
+	StateRef<Base> getBaseStayingAt() const;
+	void updateHourly(GameState &state, const AgentFacilityUsage &usage);
 	void updateMovement(GameState &state, unsigned ticks);
+	// Whether in GameState::movingAgents. Not serialized
+	bool updatedEachTick = false;
 
 	void trainPhysical(GameState &state, unsigned ticks);
 	void trainPsi(GameState &state, unsigned ticks);
@@ -311,83 +311,47 @@ void Organisation::updateMissions(GameState &state)
 	}
 	// Find rescue-capable craft
 	StateRef<Vehicle> rescueTransport;
-	for (auto &v : state.vehicles)
+	for (auto &v : state.vehiclesByOwner[{&state, id}])
 	{
-		if (v.second->owner.id == id && v.second->missions.empty() &&
-		    v.second->type->canRescueCrashed)
+		if (v->owner.id == id && v->missions.empty() && v->type->canRescueCrashed)
 		{
-			rescueTransport = {&state, v.first};
+			rescueTransport = {&state, v};
 			break;
 		}
 	}
 	// Attempt rescue someone
 	if (rescueTransport)
 	{
+		auto sendRescue = [&state, &rescueTransport](const sp<Vehicle> &v) {
+			StateRef<Vehicle> crashedVehicle = {&state, v};
+			if (!state.vehiclesBeingRecovered.emplace(rescueTransport->city, crashedVehicle.id)
+			         .second)
+			{
+				return false;
+			}
+			rescueTransport->setMission(
+			    state, VehicleMission::recoverVehicle(state, *rescueTransport, crashedVehicle));
+			rescueTransport->addMission(state, VehicleMission::gotoBuilding(state, *rescueTransport),
+			                            true);
+			return true;
+		};
 		// Rescue owned
-		for (auto &v : state.vehicles)
+		for (auto &v : state.crashedVehicles)
 		{
-			if (v.second->city == rescueTransport->city && v.second->crashed &&
-			    !v.second->carriedByVehicle && v.second->owner.id == id)
+			if (v->city == rescueTransport->city && v->crashed && !v->carriedByVehicle &&
+			    v->owner.id == id && sendRescue(v))
 			{
-				bool foundRescuer = false;
-				for (auto &r : state.vehicles)
-				{
-					if (r.second->city == rescueTransport->city && r.second->type->canRescueCrashed)
-					{
-						for (auto &m : r.second->missions)
-						{
-							if (m->type == VehicleMission::MissionType::RecoverVehicle &&
-							    m->targetVehicle.id == v.first)
-							{
-								foundRescuer = true;
-								break;
-							}
-						}
-					}
-				}
-				if (!foundRescuer)
-				{
-					rescueTransport->setMission(
-					    state,
-					    VehicleMission::recoverVehicle(state, *rescueTransport, {&state, v.first}));
-					rescueTransport->addMission(
-					    state, VehicleMission::gotoBuilding(state, *rescueTransport), true);
-					break;
-				}
+				break;
 			}
 		}
 		// Rescue allies but not aliens
-		for (auto &v : state.vehicles)
+		for (auto &v : state.crashedVehicles)
 		{
-			if (v.second->city == rescueTransport->city && v.second->crashed &&
-			    v.second->owner != state.getAliens() && !v.second->carriedByVehicle &&
-			    v.second->owner.id != id && isRelatedTo(v.second->owner) == Relation::Allied)
+			if (v->city == rescueTransport->city && v->crashed &&
+			    v->owner != state.getAliens() && !v->carriedByVehicle && v->owner.id != id &&
+			    isRelatedTo(v->owner) == Relation::Allied && sendRescue(v))
 			{
-				bool foundRescuer = false;
-				for (auto &r : state.vehicles)
-				{
-					if (r.second->city == rescueTransport->city && r.second->type->canRescueCrashed)
-					{
-						for (auto &m : r.second->missions)
-						{
-							if (m->type == VehicleMission::MissionType::RecoverVehicle &&
-							    m->targetVehicle.id == v.first)
-							{
-								foundRescuer = true;
-								break;
-							}
-						}
-					}
-				}
-				if (!foundRescuer)
-				{
-					rescueTransport->setMission(
-					    state,
-					    VehicleMission::recoverVehicle(state, *rescueTransport, {&state, v.first}));
-					rescueTransport->addMission(
-					    state, VehicleMission::gotoBuilding(state, *rescueTransport), true);
-					break;
-				}
+				break;
 			}
 		}
 	}
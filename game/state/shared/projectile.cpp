@@ -185,6 +185,22 @@ void Projectile::die(GameState &state, bool displayDoodad, bool playSound, bool
 	}
 }
 
+void Projectile::dieCollided(GameState &state,
+                             std::vector<std::tuple<sp<Projectile>, bool, bool>> &collided)
+{
+	for (auto &p : collided)
+	{
+		auto &projectile = std::get<0>(p);
+		// Already died, as only living projectiles are on the map
+		if (!projectile->tileObject)
+		{
+			continue;
+		}
+		projectile->die(state, std::get<1>(p), std::get<2>(p));
+	}
+	collided.clear();
+}
+
 Collision Projectile::checkProjectileCollision(TileMap &map)
 {
 	if (!this->tileObject)
@@ -224,8 +240,10 @@ Collision Projectile::checkProjectileCollision(TileMap &map)
 	}
 #endif // DEBUG_ALLOW_PROJECTILE_ON_PROJECTILE_FRIENDLY_FIRE
 
-	Collision c = map.findCollision(this->previousPosition, this->position, {}, ignoredObject,
-	                                false, false, 0, false, firer);
+	CollisionOptions options;
+	options.ignoredObject = ignoredObject;
+	options.ignoreOwnedProjectiles = firer;
+	Collision c = map.findCollision(this->previousPosition, this->position, options);
 	if (!c)
 		return {};
 
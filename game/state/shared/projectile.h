@@ -11,6 +11,8 @@
 #include "library/vec.h"
 #include <list>
 #include <map>
+#include <tuple>
+#include <vector>
 
 // Based on the fact that retribution (tr = 10) turns 90 degrees (PI/2) per second
 #define PROJECTILE_TURN_PER_TICK ((float)(M_PI / 2.0f) / 10.0f / TICKS_PER_SECOND)
@@ -67,6 +69,10 @@ class Projectile : public std::enable_shared_from_this<Projectile>
 	virtual void update(GameState &state, unsigned int ticks);
 	void die(GameState &state, bool displayDoodad = true, bool playSound = true,
 	         bool expired = false);
+	// Kill the projectiles that collided, in order, and empty the list. Each projectile dies only
+	// once, the first time it is listed, even if it both hit something and was hit itself
+	static void dieCollided(GameState &state,
+	                        std::vector<std::tuple<sp<Projectile>, bool, bool>> &collided);
 
 	Vec3<float> getPosition() const { return this->position; }
 
@@ -79,9 +79,7 @@ template <typename T> class StateRef
 	{
 		if (id.empty())
 			return;
-		auto &prefix = T::getPrefix();
-		auto idPrefix = id.substr(0, prefix.length());
-		if (prefix != idPrefix)
+		if (!id.startsWith(T::getPrefix()))
 		{
 			LogWarning("%s object has invalid prefix - expected \"%s\" ID \"%s\"", T::getTypeName(),
 			           T::getPrefix(), id);
@@ -150,6 +148,11 @@ template <typename T> class StateRef
 	}
 	bool operator==(const StateRef<T> &other) const
 	{
+		// Refs to the same object have the same ID, no need to compare the strings
+		if (this->obj && this->obj == other.obj)
+		{
+			return true;
+		}
 		if (this->id != other.id)
 		{
 			return false;
@@ -2,6 +2,8 @@
 #define _USE_MATH_DEFINES
 #endif
 #include "game/state/tilemap/collision.h"
+#include "framework/framework.h"
+#include "framework/metrics.h"
 #include "game/state/battle/battle.h"
 #include "game/state/battle/battleitem.h"
 #include "game/state/city/vehicle.h"
@@ -20,21 +22,59 @@
 namespace OpenApoc
 {
 
+namespace
+{
+MetricCounter raysCounter("Collision", "rays");
+} // anonymous namespace
+
 Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
-                                 const std::set<TileObject::Type> validTypes,
+                                 const std::set<TileObject::Type> &validTypes,
                                  sp<TileObject> ignoredObject, bool useLOS, bool check_full_path,
-                                 unsigned maxRange, bool recordPassedTiles,
+                                 unsigned maxRange, std::vector<Vec3<int>> *passedTiles,
                                  StateRef<Organisation> ignoreOwnedProjectiles) const
 {
-	bool typeChecking = validTypes.size() > 0;
+	CollisionOptions options;
+	options.validTypes = TileObject::getTypeMask(validTypes);
+	options.ignoredObject = ignoredObject;
+	options.useLOS = useLOS;
+	options.checkFullPath = check_full_path;
+	options.maxRange = maxRange;
+	options.passedTiles = passedTiles;
+	options.ignoreOwnedProjectiles = ignoreOwnedProjectiles;
+	return findCollision(lineSegmentStart, lineSegmentEnd, options);
+}
+
+Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
+                                 const CollisionOptions &options) const
+{
+	return findCollision(lineSegmentStart, lineSegmentEnd, options, options.passedTiles);
+}
+
+Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
+                                 const CollisionOptions &options,
+                                 std::vector<Vec3<int>> *passedTiles) const
+{
+	collisionCount.fetch_add(1, std::memory_order_relaxed);
+	raysCounter.add();
+	auto validTypes = options.validTypes;
+	auto &ignoredObject = options.ignoredObject;
+	bool useLOS = options.useLOS;
+	bool check_full_path = options.checkFullPath;
+	unsigned maxRange = options.maxRange;
+	auto &ignoreOwnedProjectiles = options.ignoreOwnedProjectiles;
+	bool typeChecking = validTypes != 0;
 	bool rangeChecking = maxRange > 0.0f;
-	const Tile *lastT = nullptr;
+	// Tiles are told apart by position, as every one not made yet is the same empty tile
+	bool passedTile = false;
+	Vec3<int> lastTile;
 	// We apply a median value accumulated in all tiles passed every time we pass a tile
 	// This makes it so that we do not over or under-apply smoke when going diagonally
 	float blockageAccumulatedSoFar = 0.0f;
 	int distanceToLastTile = 0;
 	float accumulatedSinceLastTile = 0;
 	int numberTilesWithBlockage = 0;
+	bool recordingHeat = isRecordingHeat();
+	Vec3<int> lastHeatTile = {-1, -1, -1};
 	// Init collision parameters
 	Collision c;
 	c.obj = nullptr;
@@ -42,46 +82,43 @@ Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineS
 	Vec3<float> tileSizef = voxelMapSize;
 	Vec3<int> lineSegmentStartVoxel = lineSegmentStart * tileSizef;
 	Vec3<int> lineSegmentEndVoxel = lineSegmentEnd * tileSizef;
-	LineSegment<int, true> line{lineSegmentStartVoxel, lineSegmentEndVoxel};
 
 	// "point" is thee corrdinate measured in voxel scale units, meaning,
 	// voxel point coordinate within map
-	for (auto &point : line)
-	{
-		auto tile = point / tileSize;
+	auto visit = [&](const Vec3<int> &point, const Vec3<int> &tile) -> LineVisit {
 		if (tile.x < 0 || tile.x >= size.x || tile.y < 0 || tile.y >= size.y || tile.z < 0 ||
 		    tile.z >= size.z)
 		{
-			if (check_full_path)
-			{
-				continue;
-			}
-			else
-			{
-				return c;
-			}
+			// Nothing outside the map to collide with either
+			return check_full_path ? LineVisit::SkipTile : LineVisit::Stop;
+		}
+		if (recordingHeat && tile != lastHeatTile)
+		{
+			addHeat(HeatKind::LineTiles, tile);
+			lastHeatTile = tile;
 		}
 		const Tile *t = this->getTile(tile);
 		if (rangeChecking)
 		{
-			if (!lastT)
+			if (!passedTile)
 			{
-				lastT = t;
-				if (recordPassedTiles)
+				passedTile = true;
+				lastTile = tile;
+				if (passedTiles)
 				{
-					c.passedTiles.push_back(tile);
+					passedTiles->push_back(tile);
 				}
 			}
 			else
 			{
-				if (t != lastT)
+				if (tile != lastTile)
 				{
-					lastT = t;
-					if (recordPassedTiles)
+					lastTile = tile;
+					if (passedTiles)
 					{
-						c.passedTiles.push_back(tile);
+						passedTiles->push_back(tile);
 					}
-					auto vec = t->position;
+					auto vec = tile;
 					// Apply vision blockage if we passed at least 1 tile
 					auto thisDistance =
 					    sqrtf((vec.x - lineSegmentStart.x) * (vec.x - lineSegmentStart.x) +
@@ -106,7 +143,7 @@ Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineS
 						c.outOfRange = true;
 						c.position = Vec3<float>{point};
 						c.position /= tileSizef;
-						return c;
+						return LineVisit::Stop;
 					}
 
 					// Add this tile's vision blockage to accumulated since last tile blockage
@@ -120,10 +157,15 @@ Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineS
 			}
 		}
 
+		// Nothing to collide with in this tile, so none of its other voxels need looking at
+		if ((useLOS ? t->voxelObjectsLOS : t->voxelObjectsLOF) == 0)
+		{
+			return LineVisit::SkipTile;
+		}
 		for (auto &obj : t->intersectingObjects)
 		{
 			if ((!obj->hasVoxelMap(useLOS)) ||
-			    (typeChecking && validTypes.find(obj->type) == validTypes.end()) ||
+			    (typeChecking && !(validTypes & TileObject::getTypeMask(obj->type))) ||
 			    (obj == ignoredObject))
 			{
 				continue;
@@ -162,14 +204,86 @@ Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineS
 				c.obj = obj;
 				c.position = Vec3<float>{point};
 				c.position /= tileSizef;
-				return c;
+				return LineVisit::Stop;
 			}
 		}
-	}
+		return LineVisit::Continue;
+	};
+	walkLine<true>(lineSegmentStartVoxel, lineSegmentEndVoxel, tileSize, visit);
 
 	return c;
 }
 
+void TileMap::findCollisions(const std::vector<std::pair<Vec3<float>, Vec3<float>>> &lineSegments,
+                             const CollisionOptions &options, std::vector<Collision> &collisions,
+                             std::vector<std::vector<Vec3<int>>> *passedTiles) const
+{
+	collisions.resize(lineSegments.size());
+	if (passedTiles)
+	{
+		passedTiles->resize(lineSegments.size());
+	}
+	// Every segment only writes its own result
+	auto findOne = [this, &lineSegments, &options, &collisions,
+	                passedTiles](unsigned int index, unsigned int) {
+		std::vector<Vec3<int>> *segmentTiles = nullptr;
+		if (passedTiles)
+		{
+			segmentTiles = &(*passedTiles)[index];
+			segmentTiles->clear();
+		}
+		collisions[index] = findCollision(lineSegments[index].first, lineSegments[index].second,
+		                                  options, segmentTiles);
+	};
+	auto framework = Framework::tryGetInstance();
+	if (framework && lineSegments.size() > 1)
+	{
+		framework->threadPoolParallelFor(lineSegments.size(), findOne);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < lineSegments.size(); index++)
+		{
+			findOne(index, 0);
+		}
+	}
+}
+
+bool TileMap::getVoxelFilled(Vec3<int> point, TileObject::TypeMask validTypes, bool useLOS) const
+{
+	Vec3<int> tileSize = voxelMapSize;
+	Vec3<float> tileSizef = voxelMapSize;
+	auto tile = point / tileSize;
+	if (point.x < 0 || point.y < 0 || point.z < 0 || !tileIsValid(tile))
+	{
+		return false;
+	}
+	const Tile *t = this->getTile(tile);
+	if ((useLOS ? t->voxelObjectsLOS : t->voxelObjectsLOF) == 0)
+	{
+		return false;
+	}
+	for (auto &obj : t->intersectingObjects)
+	{
+		if (!obj->hasVoxelMap(useLOS) ||
+		    (validTypes != 0 && !(validTypes & TileObject::getTypeMask(obj->type))))
+		{
+			continue;
+		}
+		// Same as in findCollision
+		auto objPos = obj->getCenter();
+		objPos -= obj->getVoxelOffset();
+		objPos *= tileSizef;
+		Vec3<int> voxelPos = point - Vec3<int>{objPos};
+		auto voxelMap = obj->getVoxelMap(voxelPos / tileSize, useLOS);
+		if (voxelMap && voxelMap->getBit(voxelPos % tileSize))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 // Checks if, while going along the trajectory, we reach target tile or get first collision within
 // it's boundaries
 bool TileMap::checkThrowTrajectory(const sp<TileObject> thrower, Vec3<float> start, Vec3<int> end,
@@ -201,7 +315,7 @@ bool TileMap::checkThrowTrajectory(const sp<TileObject> thrower, Vec3<float> sta
 		}
 		else
 		{
-			c = findCollision(curPos, newPos, {});
+			c = findCollision(curPos, newPos, CollisionOptions());
 		}
 		if (c && c.obj == thrower)
 		{
@@ -212,6 +326,30 @@ bool TileMap::checkThrowTrajectory(const sp<TileObject> thrower, Vec3<float> sta
 	return (Vec3<int>)curPos == end;
 }
 
+const ThrowSolution *TileMap::getThrowSolution(const TileObject *thrower, Vec3<float> start,
+                                               Vec3<int> end, float velocityXY) const
+{
+	if (throwSolutionsRevision != collisionRevision)
+	{
+		return nullptr;
+	}
+	auto it = throwSolutions.find(ThrowKey{thrower, start, end, velocityXY});
+	return it != throwSolutions.end() ? &it->second : nullptr;
+}
+
+void TileMap::storeThrowSolution(const TileObject *thrower, Vec3<float> start, Vec3<int> end,
+                                 float velocityXY, const ThrowSolution &solution) const
+{
+	// Only a handful of throws are looked at between changes, it's not worth keeping more
+	static const size_t THROW_SOLUTION_LIMIT = 1024;
+	if (throwSolutionsRevision != collisionRevision || throwSolutions.size() >= THROW_SOLUTION_LIMIT)
+	{
+		throwSolutions.clear();
+		throwSolutionsRevision = collisionRevision;
+	}
+	throwSolutions[ThrowKey{thrower, start, end, velocityXY}] = solution;
+}
+
 // Figure out where to fire on a moving target
 Vec3<float> Collision::getLeadingOffset(Vec3<float> tarPosRelative, float ourVelocity,
                                         Vec3<float> tarVelocity)
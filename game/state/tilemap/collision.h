@@ -2,7 +2,6 @@
 
 #include "library/sp.h"
 #include "library/vec.h"
-#include <list>
 
 namespace OpenApoc
 {
@@ -17,7 +16,6 @@ class Collision
 	sp<TileObject> obj;
 	sp<Projectile> projectile;
 	Vec3<float> position;
-	std::list<Vec3<int>> passedTiles;
 	bool outOfRange = false;
 	explicit operator bool() const { return obj != nullptr; }
 
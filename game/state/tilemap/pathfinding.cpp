@@ -1,7 +1,9 @@
+#include "framework/metrics.h"
 #include "framework/trace.h"
 #include "game/state/battle/battle.h"
 #include "game/state/battle/battleunit.h"
 #include "game/state/battle/battleunitmission.h"
+#include "game/state/city/airspacegraph.h"
 #include "game/state/city/city.h"
 #include "game/state/city/scenery.h"
 #include "game/state/city/vehicle.h"
@@ -9,12 +11,15 @@
 #include "game/state/gamestate.h"
 #include "game/state/rules/battle/battlemap.h"
 #include "game/state/rules/city/scenerytiletype.h"
+#include "game/state/tilemap/pathfinding.h"
 #include "game/state/tilemap/tilemap.h"
 #include "game/state/tilemap/tileobject_battleunit.h"
 #include "game/state/tilemap/tileobject_vehicle.h"
 #include "limits.h"
 #include <algorithm>
 #include <glm/glm.hpp>
+#include <limits>
+#include <utility>
 
 // Show debug pathfinding output
 //#define PATHFINDING_DEBUG
@@ -24,133 +29,804 @@ namespace OpenApoc
 
 namespace
 {
-class PathNode
+
+// Nodes expanded by searches, for the trace to show what a frame spent on pathfinding
+MetricCounter tileExpansions("Pathfinding", "tiles");
+MetricCounter blockExpansions("Pathfinding", "blocks");
+MetricCounter unconnectedBlocks("Pathfinding", "unconnected blocks");
+MetricCounter roadExpansions("Pathfinding", "road segments");
+
+class LosNode
+{
+  public:
+	LosNode(float costToGetHere, float distanceToGoal, LosNode *parentNode, int block)
+	    : costToGetHere(costToGetHere), parentNode(parentNode), block(block),
+	      distanceToGoal(distanceToGoal)
+	{
+	}
+
+	std::list<int> getPathToNode()
+	{
+		std::list<int> path;
+		path.push_back(block);
+		LosNode *t = parentNode;
+		while (t)
+		{
+			path.push_front(t->block);
+			t = t->parentNode;
+		}
+
+		return path;
+	}
+
+	float costToGetHere;
+	LosNode *parentNode;
+	int block;
+	float distanceToGoal;
+};
+
+class RoadSegmentNode
 {
   public:
-	PathNode(float costToGetHere, float trueCost, float distanceToGoal, PathNode *parentNode,
-	         Tile *thisTile)
-	    : costToGetHere(costToGetHere), trueCost(trueCost), parentNode(parentNode),
-	      thisTile(thisTile), distanceToGoal(distanceToGoal)
+	RoadSegmentNode(float costToGetHere, float distanceToGoal, RoadSegmentNode *parentNode,
+	                int segment)
+	    : costToGetHere(costToGetHere), parentNode(parentNode), segment(segment),
+	      distanceToGoal(distanceToGoal)
 	{
 	}
 
-	std::list<Vec3<int>> getPathToNode()
+	std::list<int> getPathToNode()
 	{
-		std::list<Vec3<int>> path;
-		path.push_back(thisTile->position);
-		PathNode *t = parentNode;
+		std::list<int> path;
+		path.push_back(segment);
+		RoadSegmentNode *t = parentNode;
 		while (t)
 		{
-			path.push_front(t->thisTile->position);
+			path.push_front(t->segment);
 			t = t->parentNode;
 		}
-
-		return path;
+
+		return path;
+	}
+
+	float costToGetHere;
+	RoadSegmentNode *parentNode;
+	int segment;
+	float distanceToGoal;
+};
+
+Vec3<int> rotate(Vec3<int> vec, int rotation)
+{
+	switch (rotation)
+	{
+		case 1:
+			return {-vec.y, vec.x, vec.z};
+		case 2:
+			return {-vec.x, -vec.y, vec.z};
+		case 3:
+			return {vec.y, -vec.x, vec.z};
+		default:
+			return vec;
+	}
+}
+
+// Turn path through road segments, starting with origin's segment, into path through tiles
+std::list<Vec3<int>> followRoadSegments(const std::vector<RoadSegment> &roadSegments,
+                                        Vec3<int> origin, Vec3<int> destination, int originID,
+                                        int destinationID, std::list<int> segmentPath)
+{
+	auto &originSeg = roadSegments[originID];
+	std::list<Vec3<int>> result;
+
+	// Expecting non-zero path here as we at least have our own node
+	// we don't need it though
+	segmentPath.pop_front();
+
+	// Step 01: Path to exit of origin segment
+
+	// If road then path to road end
+	if (originSeg.length > 1 && !segmentPath.empty())
+	{
+		int toConnect = originSeg.connections[0] == segmentPath.front() ? 0 : 1;
+		result = originSeg.findPath(origin, originSeg.getByConnectID(toConnect));
+	}
+	else
+	{
+		// If we're intersection just add origin
+		// If we're a non-connected road we will path to closest to destination point
+		// When we reach step 3, so just add origin for now
+		result.push_back(origin);
+	}
+
+	// Step 02: Path through segments
+
+	int thisID = originID;
+	int lastID = destinationID;
+	if (!segmentPath.empty())
+	{
+		lastID = segmentPath.back();
+	}
+	for (auto &segID : segmentPath)
+	{
+		auto &nextSeg = roadSegments[segID];
+		int intoConnect = nextSeg.length == 1 || nextSeg.connections[0] == thisID ? 0 : 1;
+		// If not last and not broken then path through
+		if (segID != lastID && nextSeg.intact)
+		{
+			result.splice(result.end(), nextSeg.findPathThrough(intoConnect));
+		}
+		// If last or broken we need to add entrance point and we will exit the cycle now
+		// Expecting broken to be the last one as otherwise we have no point visiting it!
+		else
+		{
+			result.push_back(nextSeg.getByConnectID(intoConnect));
+		}
+		thisID = segID;
+	}
+
+	// Step 03: Path within segment to destination
+
+	auto &destSeg = roadSegments[thisID];
+	// 1) Reached destination? Path to destination, and we don't care if it's broken,
+	// as the result will be the closest path even if it is broken
+	// 2) Didn't reach destination? Path to closest point, this is the closest we get to it
+	auto pathToDestination = thisID == destinationID
+	                             ? destSeg.findPath(result.back(), destination)
+	                             : destSeg.findClosestPath(result.back(), destination);
+
+	// Expecting to have at least our pos at the start, as our pos must be intact
+	pathToDestination.pop_front();
+	result.splice(result.end(), pathToDestination);
+
+	return result;
+}
+
+// Try to fly straight from origin to destination, stepping along the line one tile at a time.
+// Fails if any step can't be taken, if the line costs more than pathOverheadAlloawnce allows over
+// the distance (which can't be more than what the best path costs) or if it is too long
+bool findStraightPath(TileMap &map, Vec3<int> origin, Vec3<int> destination, int iterationLimit,
+                      const CanEnterTileHelper &canEnterTileHelper, bool ignoreStaticUnits,
+                      bool ignoreMovingUnits, bool ignoreAllUnits, float maxCost,
+                      std::list<Vec3<int>> &path, float &trueCost)
+{
+	auto diff = destination - origin;
+	int steps = std::max(std::max(std::abs(diff.x), std::abs(diff.y)), std::abs(diff.z));
+	if (steps > iterationLimit)
+	{
+		return false;
+	}
+	float costLimit = canEnterTileHelper.getDistance(origin, destination) *
+	                  canEnterTileHelper.pathOverheadAlloawnce();
+	float nodeCost = 0.0f;
+	trueCost = 0.0f;
+	path = {origin};
+	auto previousPosition = origin;
+	Tile *previousTile = map.getTile(origin);
+	for (int i = 1; i <= steps; i++)
+	{
+		auto position = origin + Vec3<int>{glm::round(Vec3<float>{diff} * (float)i / (float)steps)};
+		Tile *tile = map.getTile(position);
+		float thisCost = 0.0f;
+		bool unused = false;
+		bool jumped = false;
+		if (!canEnterTileHelper.canEnterTile(previousTile, tile, false, jumped, thisCost, unused,
+		                                     ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits))
+		{
+			return false;
+		}
+		trueCost += thisCost;
+		// Same as the cost used by TileMap::findShortestPath
+		nodeCost += thisCost / canEnterTileHelper.pathOverheadAlloawnce() +
+		            canEnterTileHelper.adjustCost(position, position.z - previousPosition.z);
+		if (trueCost > costLimit || (maxCost != 0.0f && nodeCost >= maxCost))
+		{
+			return false;
+		}
+		path.push_back(position);
+		previousPosition = position;
+		previousTile = tile;
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+void PathfindingArena::beginSearch(unsigned int tileCount)
+{
+	nodes.clear();
+	fringe.clear();
+	if (visited.size() != tileCount)
+	{
+		visited.assign(tileCount, 0);
+		generation = 0;
+	}
+	generation++;
+	// On wrap-around old stamps could alias the new generation, so clear once
+	if (generation == 0)
+	{
+		std::fill(visited.begin(), visited.end(), 0);
+		generation = 1;
+	}
+}
+
+int PathfindingArena::addNode(float costToGetHere, float trueCost, float distanceToGoal,
+                              int parentNode, Tile *thisTile)
+{
+	nodes.push_back({costToGetHere, trueCost, distanceToGoal, parentNode, thisTile});
+	return static_cast<int>(nodes.size()) - 1;
+}
+
+bool PathfindingArena::fringeCompare(int a, int b) const
+{
+	// std heaps keep the "largest" element on top, so "a < b" means "a is expanded after b"
+	float priorityA = nodes[a].getPriority();
+	float priorityB = nodes[b].getPriority();
+	if (priorityA != priorityB)
+	{
+		return priorityA > priorityB;
+	}
+	return a < b;
+}
+
+void PathfindingArena::pushFringe(int index)
+{
+	fringe.push_back(index);
+	std::push_heap(fringe.begin(), fringe.end(),
+	               [this](int a, int b) { return fringeCompare(a, b); });
+}
+
+int PathfindingArena::popFringe()
+{
+	std::pop_heap(fringe.begin(), fringe.end(),
+	              [this](int a, int b) { return fringeCompare(a, b); });
+	int index = fringe.back();
+	fringe.pop_back();
+	return index;
+}
+
+std::list<Vec3<int>> PathfindingArena::getPathToNode(int index) const
+{
+	std::list<Vec3<int>> path;
+	while (index != -1)
+	{
+		path.push_front(nodes[index].thisTile->position);
+		index = nodes[index].parentNode;
+	}
+	return path;
+}
+
+static const float INFINITE_COST = std::numeric_limits<float>::infinity();
+static const float KEY_TOLERANCE = 0.01f;
+
+void PathfindingChangeLog::add(Vec3<int> position)
+{
+	changes.push_back(position);
+	if (changes.size() > CAPACITY)
+	{
+		changes.pop_front();
+	}
+	version++;
+}
+
+bool PathfindingChangeLog::getChangesSince(unsigned int since,
+                                           std::vector<Vec3<int>> &changesOut) const
+{
+	unsigned int missed = version - since;
+	if (missed > changes.size())
+	{
+		return false;
+	}
+	changesOut.insert(changesOut.end(), changes.end() - missed, changes.end());
+	return true;
+}
+
+IncrementalPathfinder::IncrementalPathfinder(Vec3<int> destination, bool ignoreStaticUnits,
+                                             bool ignoreMovingUnits, bool ignoreAllUnits,
+                                             const PathfindingChangeLog &log)
+    : destination(destination), ignoreStaticUnits(ignoreStaticUnits),
+      ignoreMovingUnits(ignoreMovingUnits), ignoreAllUnits(ignoreAllUnits),
+      knownVersion(log.getVersion())
+{
+}
+
+bool IncrementalPathfinder::matches(Vec3<int> destination, bool ignoreStaticUnits,
+                                    bool ignoreMovingUnits, bool ignoreAllUnits) const
+{
+	return this->destination == destination && this->ignoreStaticUnits == ignoreStaticUnits &&
+	       this->ignoreMovingUnits == ignoreMovingUnits && this->ignoreAllUnits == ignoreAllUnits;
+}
+
+void IncrementalPathfinder::notifyChange(Vec3<int> position) { pendingChanges.push_back(position); }
+
+void IncrementalPathfinder::restart()
+{
+	started = false;
+	keyModifier = 0.0f;
+	nodes.clear();
+	queue = decltype(queue)();
+	pendingChanges.clear();
+}
+
+unsigned int IncrementalPathfinder::getIndex(Vec3<int> position) const
+{
+	return (position.z * mapSize.y + position.y) * mapSize.x + position.x;
+}
+
+Vec3<int> IncrementalPathfinder::getPosition(unsigned int index) const
+{
+	int i = index;
+	return {i % mapSize.x, (i / mapSize.x) % mapSize.y, i / (mapSize.x * mapSize.y)};
+}
+
+int IncrementalPathfinder::getNeighbours(Vec3<int> position, Vec3<int> (&neighbours)[26]) const
+{
+	int count = 0;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				if (x == 0 && y == 0 && z == 0)
+				{
+					continue;
+				}
+				Vec3<int> next = {position.x + x, position.y + y, position.z + z};
+				if (next.x < 0 || next.x >= mapSize.x || next.y < 0 || next.y >= mapSize.y ||
+				    next.z < 0 || next.z >= mapSize.z)
+				{
+					continue;
+				}
+				neighbours[count++] = next;
+			}
+		}
+	}
+	return count;
+}
+
+IncrementalPathfinder::Node &IncrementalPathfinder::getNode(unsigned int index)
+{
+	auto it = nodes.find(index);
+	if (it == nodes.end())
+	{
+		Node node;
+		node.g = INFINITE_COST;
+		node.rhs = INFINITE_COST;
+		it = nodes.emplace(index, node).first;
+	}
+	return it->second;
+}
+
+float IncrementalPathfinder::getEdgeCost(TileMap &map, const CanEnterTileHelper &canEnterTile,
+                                         Vec3<int> from, Vec3<int> to) const
+{
+	float cost = 0.0f;
+	bool jumped = false;
+	bool doorInTheWay = false;
+	if (!canEnterTile.canEnterTile(map.getTile(from), map.getTile(to), false, jumped, cost,
+	                               doorInTheWay, ignoreStaticUnits, ignoreMovingUnits,
+	                               ignoreAllUnits))
+	{
+		return INFINITE_COST;
+	}
+	// Same as the cost used by TileMap::findShortestPath
+	return cost / canEnterTile.pathOverheadAlloawnce() +
+	       canEnterTile.adjustCost(to, to.z - from.z);
+}
+
+IncrementalPathfinder::Key IncrementalPathfinder::calculateKey(
+    const CanEnterTileHelper &canEnterTile, Vec3<int> origin, unsigned int index,
+    const Node &node) const
+{
+	float value = std::min(node.g, node.rhs);
+	return {value + canEnterTile.getDistance(origin, getPosition(index)) + keyModifier, value};
+}
+
+void IncrementalPathfinder::queueNode(const CanEnterTileHelper &canEnterTile, Vec3<int> origin,
+                                      unsigned int index, Node &node)
+{
+	// Entries already in the queue are ignored once the node is requeued or dropped
+	node.queued = false;
+	if (node.g != node.rhs)
+	{
+		node.queued = true;
+		node.queuedKey = calculateKey(canEnterTile, origin, index, node);
+		queue.push({node.queuedKey, index});
+	}
+}
+
+void IncrementalPathfinder::updateNode(TileMap &map, const CanEnterTileHelper &canEnterTile,
+                                       Vec3<int> origin, unsigned int index)
+{
+	auto &node = getNode(index);
+	auto position = getPosition(index);
+	if (position != destination)
+	{
+		node.rhs = INFINITE_COST;
+		Vec3<int> neighbours[26];
+		int count = getNeighbours(position, neighbours);
+		for (int i = 0; i < count; i++)
+		{
+			auto it = nodes.find(getIndex(neighbours[i]));
+			if (it == nodes.end() || it->second.g == INFINITE_COST)
+			{
+				continue;
+			}
+			node.rhs = std::min(node.rhs, getEdgeCost(map, canEnterTile, position, neighbours[i]) +
+			                                  it->second.g);
+		}
+	}
+	queueNode(canEnterTile, origin, index, node);
+}
+
+bool IncrementalPathfinder::computePath(TileMap &map, const CanEnterTileHelper &canEnterTile,
+                                        Vec3<int> origin, unsigned int iterationLimit)
+{
+	unsigned int iterationCount = 0;
+	unsigned int originIndex = getIndex(origin);
+	while (true)
+	{
+		// Skip entries left behind by nodes that were requeued or became consistent
+		while (!queue.empty())
+		{
+			auto &top = queue.top();
+			auto &topNode = nodes[top.index];
+			if (topNode.queued && topNode.queuedKey == top.key)
+			{
+				break;
+			}
+			queue.pop();
+		}
+		// Costs are sums of floats, which could make a key that should be equal to origin's
+		// slightly bigger, so allow for that
+		auto &originNode = getNode(originIndex);
+		auto originKey = calculateKey(canEnterTile, origin, originIndex, originNode);
+		if (queue.empty() ||
+		    (queue.top().key.first > originKey.first + KEY_TOLERANCE &&
+		     originNode.g == originNode.rhs))
+		{
+			tileExpansions.add(iterationCount);
+			return true;
+		}
+		if (iterationCount++ >= iterationLimit)
+		{
+			tileExpansions.add(iterationCount);
+			return false;
+		}
+
+		auto entry = queue.top();
+		queue.pop();
+		auto &node = nodes[entry.index];
+		node.queued = false;
+		auto position = getPosition(entry.index);
+		auto newKey = calculateKey(canEnterTile, origin, entry.index, node);
+		Vec3<int> neighbours[26];
+		int count = getNeighbours(position, neighbours);
+		if (entry.key < newKey)
+		{
+			// Origin moved since this was queued
+			node.queued = true;
+			node.queuedKey = newKey;
+			queue.push({newKey, entry.index});
+		}
+		else if (node.g > node.rhs)
+		{
+			// Got cheaper, which can only make neighbours cheaper
+			node.g = node.rhs;
+			for (int i = 0; i < count; i++)
+			{
+				if (neighbours[i] == destination)
+				{
+					continue;
+				}
+				float cost = getEdgeCost(map, canEnterTile, neighbours[i], position) + node.g;
+				if (cost == INFINITE_COST)
+				{
+					continue;
+				}
+				auto neighbourIndex = getIndex(neighbours[i]);
+				auto &neighbour = getNode(neighbourIndex);
+				if (cost < neighbour.rhs)
+				{
+					neighbour.rhs = cost;
+					queueNode(canEnterTile, origin, neighbourIndex, neighbour);
+				}
+			}
+		}
+		else
+		{
+			// Got more expensive, so whoever went through it has to look again
+			node.g = INFINITE_COST;
+			updateNode(map, canEnterTile, origin, entry.index);
+			for (int i = 0; i < count; i++)
+			{
+				auto it = nodes.find(getIndex(neighbours[i]));
+				if (it == nodes.end() || it->second.rhs == INFINITE_COST)
+				{
+					continue;
+				}
+				updateNode(map, canEnterTile, origin, it->first);
+			}
+		}
+	}
+}
+
+std::list<Vec3<int>> IncrementalPathfinder::findPath(TileMap &map, const PathfindingChangeLog &log,
+                                                     Vec3<int> origin, unsigned int iterationLimit,
+                                                     const CanEnterTileHelper &canEnterTile)
+{
+	TRACE_FN;
+	if (!map.tileIsValid(origin))
+	{
+		LogError("Bad origin %s", origin);
+		return {};
+	}
+	if (!map.tileIsValid(destination))
+	{
+		LogError("Bad destination %s", destination);
+		return {};
+	}
+	if (origin == destination)
+	{
+		return {origin};
+	}
+
+	if (mapSize != map.size || !log.getChangesSince(knownVersion, pendingChanges))
+	{
+		if (started)
+		{
+			LogInfo("Lost track of map changes, replanning to %s from scratch", destination);
+		}
+		restart();
+	}
+	knownVersion = log.getVersion();
+	mapSize = map.size;
+
+	if (!started)
+	{
+		started = true;
+		lastOrigin = origin;
+		pendingChanges.clear();
+		auto destinationIndex = getIndex(destination);
+		auto &destinationNode = getNode(destinationIndex);
+		destinationNode.rhs = 0.0f;
+		queueNode(canEnterTile, origin, destinationIndex, destinationNode);
+	}
+	else
+	{
+		keyModifier += canEnterTile.getDistance(lastOrigin, origin);
+		lastOrigin = origin;
+		// Moves into and out of changed tiles could have changed, re-evaluate both
+		for (auto &change : pendingChanges)
+		{
+			if (!map.tileIsValid(change))
+			{
+				continue;
+			}
+			updateNode(map, canEnterTile, origin, getIndex(change));
+			Vec3<int> neighbours[26];
+			int count = getNeighbours(change, neighbours);
+			for (int i = 0; i < count; i++)
+			{
+				updateNode(map, canEnterTile, origin, getIndex(neighbours[i]));
+			}
+		}
+		pendingChanges.clear();
+	}
+
+	if (!computePath(map, canEnterTile, origin, iterationLimit))
+	{
+		LogInfo("No incremental route from %s to %s found after %d iterations", origin,
+		        destination, iterationLimit);
+		return {};
+	}
+
+	// Follow the cheapest moves from origin
+	std::list<Vec3<int>> path = {origin};
+	auto position = origin;
+	unsigned int maxLength = mapSize.x * mapSize.y * mapSize.z;
+	while (position != destination)
+	{
+		float bestCost = INFINITE_COST;
+		Vec3<int> bestPosition = position;
+		Vec3<int> neighbours[26];
+		int count = getNeighbours(position, neighbours);
+		for (int i = 0; i < count; i++)
+		{
+			auto it = nodes.find(getIndex(neighbours[i]));
+			if (it == nodes.end() || it->second.g == INFINITE_COST)
+			{
+				continue;
+			}
+			float cost = getEdgeCost(map, canEnterTile, position, neighbours[i]) + it->second.g;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestPosition = neighbours[i];
+			}
+		}
+		if (bestCost == INFINITE_COST || path.size() > maxLength)
+		{
+			LogInfo("No incremental route from %s to %s", origin, destination);
+			return {};
+		}
+		position = bestPosition;
+		path.push_back(position);
+	}
+	return path;
+}
+
+FlowField::FlowField(TileMap &map, Vec3<int> destination, Vec3<int> boundsMin,
+                     Vec3<int> boundsMax, const CanEnterTileHelper &canEnterTile,
+                     bool ignoreStaticUnits, bool ignoreMovingUnits, bool ignoreAllUnits,
+                     const std::vector<Vec3<int>> &required, float minimumCost)
+    : destination(destination), boundsMin(glm::max(boundsMin, Vec3<int>{0, 0, 0})),
+      boundsMax(glm::min(boundsMax, map.size - Vec3<int>{1, 1, 1}))
+{
+	TRACE_FN;
+	size = glm::max(this->boundsMax - this->boundsMin + Vec3<int>{1, 1, 1}, Vec3<int>{0, 0, 0});
+	costs.resize(size.x * size.y * size.z, INFINITE_COST);
+	next.resize(costs.size(), -1);
+	if (!withinBounds(destination))
+	{
+		LogError("Destination %s outside of field bounds %s-%s", destination, this->boundsMin,
+		         this->boundsMax);
+		return;
+	}
+
+	std::vector<bool> settled(costs.size(), false);
+	unsigned int requiredLeft = 0;
+	std::vector<bool> isRequired(costs.size(), false);
+	for (auto &position : required)
+	{
+		if (withinBounds(position) && !isRequired[getIndex(position)])
+		{
+			isRequired[getIndex(position)] = true;
+			requiredLeft++;
+		}
+	}
+
+	bool limited = !required.empty() || minimumCost > 0.0f;
+	using Entry = std::pair<float, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> fringe;
+	costs[getIndex(destination)] = 0.0f;
+	fringe.push({0.0f, getIndex(destination)});
+	while (!fringe.empty())
+	{
+		auto entry = fringe.top();
+		fringe.pop();
+		if (settled[entry.second])
+		{
+			continue;
+		}
+		if (limited && requiredLeft == 0 && entry.first > minimumCost)
+		{
+			break;
+		}
+		settled[entry.second] = true;
+		settledCost = entry.first;
+		if (isRequired[entry.second])
+		{
+			requiredLeft--;
+		}
+
+		auto currentPosition = getPosition(entry.second);
+		auto currentTile = map.getTile(currentPosition);
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					if (x == 0 && y == 0 && z == 0)
+					{
+						continue;
+					}
+					Vec3<int> previousPosition = currentPosition + Vec3<int>{x, y, z};
+					if (!withinBounds(previousPosition))
+					{
+						continue;
+					}
+					int previousIndex = getIndex(previousPosition);
+					if (settled[previousIndex])
+					{
+						continue;
+					}
+					// Searching backwards, so the move is from the neighbour to this position
+					float thisCost = 0.0f;
+					bool jumped = false;
+					bool doorInTheWay = false;
+					if (!canEnterTile.canEnterTile(map.getTile(previousPosition), currentTile, false,
+					                               jumped, thisCost, doorInTheWay,
+					                               ignoreStaticUnits, ignoreMovingUnits,
+					                               ignoreAllUnits))
+					{
+						continue;
+					}
+					// Same as the cost used by TileMap::findShortestPath
+					float newCost = entry.first + thisCost / canEnterTile.pathOverheadAlloawnce() +
+					                canEnterTile.adjustCost(currentPosition, -z);
+					if (newCost < costs[previousIndex])
+					{
+						costs[previousIndex] = newCost;
+						next[previousIndex] = entry.second;
+						fringe.push({newCost, previousIndex});
+					}
+				}
+			}
+		}
 	}
-
-	float costToGetHere;
-	float trueCost;
-	PathNode *parentNode;
-	Tile *thisTile;
-	float distanceToGoal;
-};
-
-class LosNode
-{
-  public:
-	LosNode(float costToGetHere, float distanceToGoal, LosNode *parentNode, int block)
-	    : costToGetHere(costToGetHere), parentNode(parentNode), block(block),
-	      distanceToGoal(distanceToGoal)
+	// Searched everything there was to search
+	if (fringe.empty())
 	{
+		settledCost = INFINITE_COST;
 	}
+}
 
-	std::list<int> getPathToNode()
+bool FlowField::reaches(Vec3<int> position) const
+{
+	if (!withinBounds(position))
 	{
-		std::list<int> path;
-		path.push_back(block);
-		LosNode *t = parentNode;
-		while (t)
-		{
-			path.push_front(t->block);
-			t = t->parentNode;
-		}
-
-		return path;
+		return false;
 	}
+	auto cost = costs[getIndex(position)];
+	return cost != INFINITE_COST && cost <= settledCost;
+}
 
-	float costToGetHere;
-	LosNode *parentNode;
-	int block;
-	float distanceToGoal;
-};
+float FlowField::getCost(Vec3<int> position) const { return costs[getIndex(position)]; }
 
-class RoadSegmentNode
+std::list<Vec3<int>> FlowField::getPath(Vec3<int> origin, float stopCost) const
 {
-  public:
-	RoadSegmentNode(float costToGetHere, float distanceToGoal, RoadSegmentNode *parentNode,
-	                int segment)
-	    : costToGetHere(costToGetHere), parentNode(parentNode), segment(segment),
-	      distanceToGoal(distanceToGoal)
+	std::list<Vec3<int>> path;
+	if (!reaches(origin))
 	{
+		return path;
 	}
-
-	std::list<int> getPathToNode()
+	int index = getIndex(origin);
+	path.push_back(origin);
+	while (next[index] != -1 && costs[index] > stopCost)
 	{
-		std::list<int> path;
-		path.push_back(segment);
-		RoadSegmentNode *t = parentNode;
-		while (t)
-		{
-			path.push_front(t->segment);
-			t = t->parentNode;
-		}
-
-		return path;
+		index = next[index];
+		path.push_back(getPosition(index));
 	}
+	return path;
+}
 
-	float costToGetHere;
-	RoadSegmentNode *parentNode;
-	int segment;
-	float distanceToGoal;
-};
+bool FlowField::withinBounds(Vec3<int> position) const
+{
+	return position.x >= boundsMin.x && position.x <= boundsMax.x && position.y >= boundsMin.y &&
+	       position.y <= boundsMax.y && position.z >= boundsMin.z && position.z <= boundsMax.z;
+}
 
-Vec3<int> rotate(Vec3<int> vec, int rotation)
+int FlowField::getIndex(Vec3<int> position) const
 {
-	switch (rotation)
-	{
-		case 1:
-			return {-vec.y, vec.x, vec.z};
-		case 2:
-			return {-vec.x, -vec.y, vec.z};
-		case 3:
-			return {vec.y, -vec.x, vec.z};
-		default:
-			return vec;
-	}
+	auto local = position - boundsMin;
+	return (local.z * size.y + local.y) * size.x + local.x;
 }
 
-} // anonymous namespace
+Vec3<int> FlowField::getPosition(int index) const
+{
+	return boundsMin + Vec3<int>{index % size.x, (index / size.x) % size.y,
+	                             index / (size.x * size.y)};
+}
 
 std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> destinationStart,
                                                Vec3<int> destinationEnd, int iterationLimit,
                                                const CanEnterTileHelper &canEnterTileHelper,
                                                bool approachOnly, bool ignoreStaticUnits,
                                                bool ignoreMovingUnits, bool ignoreAllUnits,
-                                               float *cost, float maxCost)
+                                               float *cost, float maxCost,
+                                               PathfindingArena *customArena)
 {
 #ifdef PATHFINDING_DEBUG
-	for (auto &t : tiles)
-		t.pathfindingDebugFlag = false;
+	tiles.forEach([](Tile &t) { t.pathfindingDebugFlag = false; });
 #endif
 
 	TRACE_FN;
 	maxCost /= canEnterTileHelper.pathOverheadAlloawnce();
-	// Faster than looking up in a set
-	std::vector<bool> visitedTiles = std::vector<bool>(size.x * size.y * size.z, false);
 	int strideZ = size.x * size.y;
 	int strideY = size.x;
-	std::list<PathNode *> nodesToDelete;
-	std::list<PathNode *> fringe;
+	auto &arena = customArena ? *customArena : *pathfindingArena;
 	Vec3<float> goalPositionStart;
 	Vec3<float> goalPositionEnd;
 	bool destinationIsSingleTile = destinationStart == destinationEnd - Vec3<int>{1, 1, 1};
@@ -214,60 +890,76 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 		return {startTile->position};
 	}
 
-	auto startNode = new PathNode(
-	    0.0f, 0.0f, canEnterTileHelper.getDistance(origin, goalPositionStart, goalPositionEnd),
-	    nullptr, startTile);
-	nodesToDelete.push_back(startNode);
-	fringe.emplace_back(startNode);
+	// In open space there is usually nothing in the way, so there is no need to search at all
+	if (destinationIsSingleTile && !approachOnly && canEnterTileHelper.canFlyStraight())
+	{
+		std::list<Vec3<int>> straightPath;
+		float straightCost = 0.0f;
+		if (findStraightPath(*this, origin, destinationStart, iterationLimit, canEnterTileHelper,
+		                     ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits, maxCost,
+		                     straightPath, straightCost))
+		{
+			if (cost)
+			{
+				*cost = straightCost;
+			}
+			return straightPath;
+		}
+	}
 
-	auto closestNodeSoFar = *fringe.begin();
+	arena.beginSearch(size.x * size.y * size.z);
+	int startNode = arena.addNode(
+	    0.0f, 0.0f, canEnterTileHelper.getDistance(origin, goalPositionStart, goalPositionEnd), -1,
+	    startTile);
+	arena.pushFringe(startNode);
+
+	auto closestNodeSoFar = startNode;
 
 	while (iterationCount++ < iterationLimit)
 	{
-		auto first = fringe.begin();
-		if (first == fringe.end())
+		if (arena.fringeEmpty())
 		{
 			LogInfo("No more tiles to expand after %d iterations", iterationCount);
 			break;
 		}
-		auto nodeToExpand = *first;
-		fringe.erase(first);
+		// Copy, as adding nodes below may reallocate the arena
+		auto nodeToExpandIndex = arena.popFringe();
+		auto nodeToExpand = arena.getNode(nodeToExpandIndex);
 
 		// Skip if we've already expanded this, as in a 3d-grid we know the first
 		// expansion will be the shortest route
-		if (visitedTiles[nodeToExpand->thisTile->position.z * strideZ +
-		                 nodeToExpand->thisTile->position.y * strideY +
-		                 nodeToExpand->thisTile->position.x])
+		Vec3<int> currentPosition = nodeToExpand.thisTile->position;
+		unsigned int currentIndex =
+		    currentPosition.z * strideZ + currentPosition.y * strideY + currentPosition.x;
+		if (arena.isVisited(currentIndex))
 		{
 			iterationCount--;
 			continue;
 		}
-		visitedTiles[nodeToExpand->thisTile->position.z * strideZ +
-		             nodeToExpand->thisTile->position.y * strideY +
-		             nodeToExpand->thisTile->position.x] = true;
+		arena.setVisited(currentIndex);
+		addHeat(HeatKind::PathfindingNodes, currentPosition);
 
 #ifdef PATHFINDING_DEBUG
-		LogInfo("EXPAND %s", nodeToExpand->thisTile->position);
-		nodeToExpand->thisTile->pathfindingDebugFlag = true;
+		LogInfo("EXPAND %s", currentPosition);
+		nodeToExpand.thisTile->pathfindingDebugFlag = true;
 #endif
 
 		// Make it so we always try to move at least one tile
-		if (closestNodeSoFar->parentNode == nullptr)
-			closestNodeSoFar = nodeToExpand;
+		if (arena.getNode(closestNodeSoFar).parentNode == -1)
+			closestNodeSoFar = nodeToExpandIndex;
 
-		if (nodeToExpand->distanceToGoal == 0 ||
-		    (approachOnly && nodeToExpand->thisTile->position.z == goalPositionStart.z &&
-		     std::max(std::abs(nodeToExpand->thisTile->position.x - goalPositionStart.x),
-		              std::abs(nodeToExpand->thisTile->position.y - goalPositionStart.y)) <= 1))
+		if (nodeToExpand.distanceToGoal == 0 ||
+		    (approachOnly && currentPosition.z == goalPositionStart.z &&
+		     std::max(std::abs(currentPosition.x - goalPositionStart.x),
+		              std::abs(currentPosition.y - goalPositionStart.y)) <= 1))
 		{
-			closestNodeSoFar = nodeToExpand;
+			closestNodeSoFar = nodeToExpandIndex;
 			break;
 		}
-		else if (nodeToExpand->distanceToGoal < closestNodeSoFar->distanceToGoal)
+		else if (nodeToExpand.distanceToGoal < arena.getNode(closestNodeSoFar).distanceToGoal)
 		{
-			closestNodeSoFar = nodeToExpand;
+			closestNodeSoFar = nodeToExpandIndex;
 		}
-		Vec3<int> currentPosition = nodeToExpand->thisTile->position;
 		for (int z = -1; z <= 1; z++)
 		{
 			for (int y = -1; y <= 1; y++)
@@ -286,8 +978,8 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 					{
 						continue;
 					}
-					if (visitedTiles[nextPosition.z * strideZ + nextPosition.y * strideY +
-					                 nextPosition.x])
+					if (arena.isVisited(nextPosition.z * strideZ + nextPosition.y * strideY +
+					                    nextPosition.x))
 					{
 						continue;
 					}
@@ -295,7 +987,7 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 					float thisCost = 0.0f;
 					bool unused = false;
 					bool jumped = false;
-					if (!canEnterTileHelper.canEnterTile(nodeToExpand->thisTile, tile, true, jumped,
+					if (!canEnterTileHelper.canEnterTile(nodeToExpand.thisTile, tile, true, jumped,
 					                                     thisCost, unused, ignoreStaticUnits,
 					                                     ignoreMovingUnits, ignoreAllUnits))
 						continue;
@@ -318,8 +1010,8 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 						nextPosition = nextNextPosition;
 						tile = nextTile;
 					}
-					float newNodeCost = nodeToExpand->costToGetHere;
-					float newTrueCost = nodeToExpand->trueCost;
+					float newNodeCost = nodeToExpand.costToGetHere;
+					float newTrueCost = nodeToExpand.trueCost;
 
 					newNodeCost += thisCost /* * (jumped ? 2 : 1) */
 					               / canEnterTileHelper.pathOverheadAlloawnce();
@@ -332,36 +1024,32 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 					if (maxCost != 0.0f && newNodeCost >= maxCost)
 						continue;
 
-					auto newNode = new PathNode(
+					auto newNode = arena.addNode(
 					    newNodeCost, newTrueCost,
 					    destinationIsSingleTile
 					        ? canEnterTileHelper.getDistance(nextPosition, goalPositionStart)
 					        : canEnterTileHelper.getDistance(nextPosition, goalPositionStart,
 					                                         goalPositionEnd),
-					    nodeToExpand, tile);
-					nodesToDelete.push_back(newNode);
+					    nodeToExpandIndex, tile);
 
 #ifdef PATHFINDING_DEBUG
-					LogInfo("NEW ND %s [%f, %f]", nextPosition, newNode->costToGetHere,
-					        newNode->distanceToGoal);
+					LogInfo("NEW ND %s [%f, %f]", nextPosition,
+					        arena.getNode(newNode).costToGetHere,
+					        arena.getNode(newNode).distanceToGoal);
 #endif
 
-					// Put node at appropriate place in the list
-					auto it = fringe.begin();
-					while (it != fringe.end() &&
-					       ((*it)->costToGetHere + (*it)->distanceToGoal) <
-					           (newNode->costToGetHere + newNode->distanceToGoal))
-						it++;
-					fringe.emplace(it, newNode);
+					arena.pushFringe(newNode);
 				}
 			}
 		}
 	}
+	tileExpansions.add(iterationCount);
+	auto &closestNode = arena.getNode(closestNodeSoFar);
 	if (iterationCount > iterationLimit)
 	{
-		if (approachOnly && closestNodeSoFar->thisTile->position.z == goalPositionStart.z &&
-		    std::max(std::abs(closestNodeSoFar->thisTile->position.x - goalPositionStart.x),
-		             std::abs(closestNodeSoFar->thisTile->position.y - goalPositionStart.y)) <= 1)
+		if (approachOnly && closestNode.thisTile->position.z == goalPositionStart.z &&
+		    std::max(std::abs(closestNode.thisTile->position.x - goalPositionStart.x),
+		             std::abs(closestNode.thisTile->position.y - goalPositionStart.y)) <= 1)
 		{
 			// Nothing?
 		}
@@ -370,44 +1058,39 @@ std::list<Vec3<int>> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> desti
 			LogInfo("No route from %s to %s-%s found after %d iterations, returning "
 			        "closest path %s",
 			        origin, destinationStart, destinationEnd, iterationCount,
-			        closestNodeSoFar->thisTile->position);
+			        closestNode.thisTile->position);
 		}
 		else
 		{
 			LogInfo("No route from %s to %s-%s found after %d iterations, returning "
 			        "closest path %s",
 			        origin, destinationStart, destinationEnd, iterationCount,
-			        closestNodeSoFar->thisTile->position);
+			        closestNode.thisTile->position);
 		}
 	}
-	else if (closestNodeSoFar->distanceToGoal > 0)
+	else if (closestNode.distanceToGoal > 0)
 	{
 		if (maxCost > 0.0f)
 		{
 			LogInfo("Could not find path within maxPath, returning closest path ending at %s",
-			        closestNodeSoFar->thisTile->position.x);
+			        closestNode.thisTile->position.x);
 		}
 		else
 		{
 			LogInfo("Surprisingly, no nodes to expand! Closest path ends at %s",
-			        closestNodeSoFar->thisTile->position);
+			        closestNode.thisTile->position);
 		}
 	}
 	/*else
 	{
-	    LogInfo("Path of length %d found in %d iterations", (int)(closestNodeSoFar->costToGetHere *
+	    LogInfo("Path of length %d found in %d iterations", (int)(closestNode.costToGetHere *
 	canEnterTile.pathOverheadAlloawnce() / 4.0f), iterationCount);
 	}*/
 
-	auto result = closestNodeSoFar->getPathToNode();
+	auto result = arena.getPathToNode(closestNodeSoFar);
 	if (cost)
 	{
-		*cost = closestNodeSoFar->trueCost;
-	}
-
-	for (auto &p : nodesToDelete)
-	{
-		delete p;
+		*cost = closestNode.trueCost;
 	}
 
 	return result;
@@ -621,10 +1304,18 @@ std::list<Vec3<int>> Battle::findShortestPathUsingLB(Vec3<int> origin, Vec3<int>
 	// Pathfind on graphs of los blocks
 	int startLB = getLosBlockID(origin.x, origin.y, origin.z);
 	int destLB = getLosBlockID(destination.x, destination.y, destination.z);
-	auto pathLB = findLosBlockPath(startLB, destLB, canEnterTile.getType());
+	std::list<int> pathLB;
+	if (getLosBlocksConnected(startLB, destLB, canEnterTile.getType()))
+	{
+		pathLB = findLosBlockPath(startLB, destLB, canEnterTile.getType());
+	}
+	else
+	{
+		unconnectedBlocks.add();
+	}
 
 	// If pathfinding on graphs failed - return short part of the path towards target
-	if ((*pathLB.rbegin()) != destLB)
+	if (pathLB.empty() || pathLB.back() != destLB)
 	{
 		if (!result.empty())
 		{
@@ -663,11 +1354,7 @@ std::list<Vec3<int>> Battle::findShortestPathUsingLB(Vec3<int> origin, Vec3<int>
 		                                  canEnterTile, false, ignoreStaticUnits, ignoreMovingUnits,
 		                                  ignoreAllUnits, &curCost, curMaxCost);
 		// Include new entries into result
-		while (!path.empty())
-		{
-			result.push_back(path.front());
-			path.pop_front();
-		}
+		result.splice(result.end(), path);
 		// Update costs
 		if (cost)
 		{
@@ -695,11 +1382,7 @@ std::list<Vec3<int>> Battle::findShortestPathUsingLB(Vec3<int> origin, Vec3<int>
 	    distToNext * GRAPH_ITERATION_LIMIT_MULTIPLIER + GRAPH_ITERATION_LIMIT_EXTRA, canEnterTile,
 	    approachOnly, ignoreStaticUnits, ignoreMovingUnits, ignoreAllUnits, &curCost, curMaxCost);
 	// Include new entries into result
-	while (!path.empty())
-	{
-		result.push_back(path.front());
-		path.pop_front();
-	}
+	result.splice(result.end(), path);
 	// Update costs
 	if (cost)
 	{
@@ -825,6 +1508,7 @@ std::list<int> Battle::findLosBlockPath(int origin, int destination, BattleUnitT
 		}
 	}
 
+	blockExpansions.add(iterationCount);
 	if (iterationCount > iterationLimit)
 	{
 		LogWarning("No route from lb %d to %d found after %d iterations, returning "
@@ -847,6 +1531,51 @@ std::list<int> Battle::findLosBlockPath(int origin, int destination, BattleUnitT
 	return result;
 }
 
+bool Battle::getLosBlocksConnected(int origin, int destination, BattleUnitType type)
+{
+	if (origin == destination)
+	{
+		return true;
+	}
+	int lbCount = losBlocks.size();
+	if (blockComponentsNeedUpdate)
+	{
+		blockComponentsNeedUpdate = false;
+		std::vector<int> stack;
+		for (auto &t : BattleUnitTypeList)
+		{
+			// Flood every group of linked blocks in turn, numbering them by the first block in it
+			auto &components = blockComponents[t];
+			components.assign(lbCount, -1);
+			auto &cost = linkCost[t];
+			for (int start = 0; start < lbCount; start++)
+			{
+				if (components[start] != -1)
+				{
+					continue;
+				}
+				components[start] = start;
+				stack.push_back(start);
+				while (!stack.empty())
+				{
+					int i = stack.back();
+					stack.pop_back();
+					for (int j = 0; j < lbCount; j++)
+					{
+						if (components[j] == -1 && cost[i + j * lbCount] != -1)
+						{
+							components[j] = start;
+							stack.push_back(j);
+						}
+					}
+				}
+			}
+		}
+	}
+	auto &components = blockComponents[type];
+	return components[origin] == components[destination];
+}
+
 // FIXME: Implement usage of teleporters in group move
 void Battle::groupMove(GameState &state, std::list<StateRef<BattleUnit>> &selectedUnits,
                        Vec3<int> targetLocation, int facingDelta, bool demandGiveWay,
@@ -1076,6 +1805,46 @@ void Battle::groupMove(GameState &state, std::list<StateRef<BattleUnit>> &select
 	log += format("\nTarget location is now %d, %d, %d. Leader is %s", targetLocation.x,
 	              targetLocation.y, targetLocation.z, leadUnit.id);
 
+	// How far an offset location can be from target to be considered a part of the formation
+	auto getCostLimit = [](Vec3<int> offset) {
+		return 1.50f * 2.0f *
+		       (float)(std::max(std::abs(offset.x), std::abs(offset.y)) + std::abs(offset.x) +
+		               std::abs(offset.y));
+	};
+
+	// Build one field around target that is used to check offset locations and that units which
+	// move like the leader follow, instead of every unit searching for a path on its own
+	static const int FLOW_FIELD_MARGIN = 5;
+	auto canShareField = [&leadUnit](BattleUnit &u) {
+		return u.isLarge() == leadUnit->isLarge() && u.canFly() == leadUnit->canFly() &&
+		       u.agent->type->bodyType->maxHeight == leadUnit->agent->type->bodyType->maxHeight &&
+		       u.tileObject && u.tileObject->getOwningTile()->position == (Vec3<int>)u.goalPosition;
+	};
+	Vec3<int> fieldMin = targetLocation;
+	Vec3<int> fieldMax = targetLocation;
+	std::vector<Vec3<int>> fieldOrigins;
+	for (auto &unit : localUnits)
+	{
+		if (canShareField(*unit))
+		{
+			Vec3<int> origin = unit->goalPosition;
+			fieldMin = glm::min(fieldMin, origin);
+			fieldMax = glm::max(fieldMax, origin);
+			fieldOrigins.push_back(origin);
+		}
+	}
+	float maxCostLimit = 0.0f;
+	for (auto &offset : targetOffsets)
+	{
+		maxCostLimit = std::max(maxCostLimit, getCostLimit(offset));
+	}
+	fieldMin -= Vec3<int>{FLOW_FIELD_MARGIN, FLOW_FIELD_MARGIN, 0};
+	fieldMax += Vec3<int>{FLOW_FIELD_MARGIN, FLOW_FIELD_MARGIN, 0};
+	fieldMin.z = 0;
+	fieldMax.z = map->size.z - 1;
+	FlowField field(*map, targetLocation, fieldMin, fieldMax, h, true, true, false, fieldOrigins,
+	                maxCostLimit);
+
 	auto itOffset = targetOffsets.begin();
 	for (auto &unit : localUnits)
 	{
@@ -1102,19 +1871,40 @@ void Battle::groupMove(GameState &state, std::list<StateRef<BattleUnit>> &select
 			log += format("\nTrying location %d, %d, %d at offset %d, %d, %d",
 			              targetLocationOffsetted.x, targetLocationOffsetted.y,
 			              targetLocationOffsetted.z, offset.x, offset.y, offset.z);
-			float costLimit =
-			    1.50f * 2.0f * (float)(std::max(std::abs(offset.x), std::abs(offset.y)) +
-			                           std::abs(offset.x) + std::abs(offset.y));
-			auto path =
-			    map->findShortestPath(targetLocation, targetLocationOffsetted, costLimit / 2.0f, h,
-			                          false, true, true, false, nullptr, costLimit);
+			float costLimit = getCostLimit(offset);
 			itOffset++;
-			if (!path.empty() && path.back() == targetLocationOffsetted)
+			if (field.reaches(targetLocationOffsetted) &&
+			    field.getCost(targetLocationOffsetted) < costLimit / h.pathOverheadAlloawnce())
 			{
 				log += format("\nLocation checks out, pathing to it");
-				unit->setMission(state, BattleUnitMission::gotoLocation(
-				                            *unit, targetLocationOffsetted, facingDelta,
-				                            demandGiveWay, true, 20, false));
+				auto mission =
+				    BattleUnitMission::gotoLocation(*unit, targetLocationOffsetted, facingDelta,
+				                                    demandGiveWay, true, 20, false);
+				Vec3<int> origin = unit->goalPosition;
+				if (canShareField(*unit) && field.reaches(origin))
+				{
+					// Follow the field until as close to target as the location, then find the
+					// way over the remaining short distance
+					auto path = field.getPath(origin, field.getCost(targetLocationOffsetted));
+					if (path.back() != targetLocationOffsetted)
+					{
+						auto rest = map->findShortestPath(
+						    path.back(), targetLocationOffsetted, costLimit * 2.0f,
+						    BattleUnitTileHelper{*map, *unit}, false, demandGiveWay, true, false,
+						    nullptr, costLimit * 2.0f);
+						if (!rest.empty() && rest.back() == targetLocationOffsetted)
+						{
+							path.insert(path.end(), ++rest.begin(), rest.end());
+						}
+						else
+						{
+							path.clear();
+						}
+					}
+					// Mission will find its own path if this is empty
+					mission->currentPlannedPath = path;
+				}
+				unit->setMission(state, mission);
 				break;
 			}
 			log += format("\nLocation was unreachable, trying next one");
@@ -1156,6 +1946,68 @@ std::list<Vec3<int>> City::findShortestPath(Vec3<int> origin, Vec3<int> destinat
 	// Part 1: Pathfinding on RoadSegments
 	//
 
+	// Routes over intact roads to an intact destination come from the routing tables, anything
+	// else needs the search below to find the closest we can get
+	if (destinationID >= 0 && originID != destinationID &&
+	    (roadSegments[destinationID].length == 1 || roadSegments[destinationID].intact))
+	{
+		std::list<int> segmentPath = {originID};
+		bool found = false;
+		if (originSeg.length > 1)
+		{
+			// Try leaving through either end
+			float bestCost = -1.0f;
+			int bestConnect = -1;
+			int bestEntrance = 0;
+			for (int connect = 0; connect < (int)originSeg.connections.size(); connect++)
+			{
+				auto exitTile = originSeg.getByConnectID(connect);
+				auto pathToExit = originSeg.findPath(origin, exitTile);
+				if (pathToExit.empty() || pathToExit.back() != exitTile)
+				{
+					continue;
+				}
+				int nextID = originSeg.connections[connect];
+				auto &nextSeg = roadSegments[nextID];
+				int intoConnect =
+				    nextSeg.length == 1 || nextSeg.connections[0] == originID ? 0 : 1;
+				if (!nextSeg.getIntactByConnectID(intoConnect))
+				{
+					continue;
+				}
+				float cost =
+				    roadRouting.getCost(roadSegments, destinationID, nextID, intoConnect);
+				if (cost < 0.0f)
+				{
+					continue;
+				}
+				cost += pathToExit.size() - 1;
+				if (bestCost < 0.0f || cost < bestCost)
+				{
+					bestCost = cost;
+					bestConnect = connect;
+					bestEntrance = intoConnect;
+				}
+			}
+			if (bestConnect != -1)
+			{
+				int nextID = originSeg.connections[bestConnect];
+				segmentPath.push_back(nextID);
+				found = roadRouting.getRoute(roadSegments, destinationID, nextID, bestEntrance,
+				                             segmentPath);
+			}
+		}
+		else
+		{
+			found = roadRouting.getRoute(roadSegments, destinationID, originID, 0, segmentPath);
+		}
+		if (found)
+		{
+			return followRoadSegments(roadSegments, origin, destination, originID, destinationID,
+			                          std::move(segmentPath));
+		}
+	}
+
 	int iterationLimit = 9001;
 	int rsCount = roadSegments.size();
 	std::vector<bool> visitetSegmentsC1 = std::vector<bool>(rsCount, false);
@@ -1367,6 +2219,7 @@ std::list<Vec3<int>> City::findShortestPath(Vec3<int> origin, Vec3<int> destinat
 		}
 	}
 
+	roadExpansions.add(iterationCount);
 	if (iterationCount > iterationLimit)
 	{
 		LogWarning("No route from lb %d to %d found after %d iterations, returning "
@@ -1389,77 +2242,55 @@ std::list<Vec3<int>> City::findShortestPath(Vec3<int> origin, Vec3<int> destinat
 	// Part 2: Pathfinding using RoadSegment path
 	//
 
-	std::list<Vec3<int>> result;
-
-	// Expecting non-zero path here as we at least have our own node
-	// we don't need it though
-	segmentPath.pop_front();
+	return followRoadSegments(roadSegments, origin, destination, originID, destinationID,
+	                          std::move(segmentPath));
+}
 
-	// Step 01: Path to exit of origin segment
+std::list<Vec3<int>> City::findShortestPath(Vec3<int> origin, Vec3<int> destination,
+                                            int iterationLimit,
+                                            const FlyingVehicleTileHelper &canEnterTile,
+                                            PathfindingArena *arena)
+{
+	// How much attempts are given to the pathfinding between two waypoints. This is a multiplier
+	// for "distance", which is a minimum number of iterations required to pathfind there
+	static const int WAYPOINT_ITERATION_LIMIT_MULTIPLIER = 4;
+	static const int WAYPOINT_ITERATION_LIMIT_EXTRA = 20;
 
-	// If road then path to road end
-	if (originSeg.length > 1 && !segmentPath.empty())
-	{
-		int toConnect = originSeg.connections[0] == segmentPath.front() ? 0 : 1;
-		auto pathToExit = originSeg.findPath(origin, originSeg.getByConnectID(toConnect));
-		for (auto &p : pathToExit)
-		{
-			result.push_back(p);
-		}
-	}
-	else
+	if (!airspace || !airspace->shouldUse(origin, destination))
 	{
-		// If we're intersection just add origin
-		// If we're a non-connected road we will path to closest to destination point
-		// When we reach step 3, so just add origin for now
-		result.push_back(origin);
+		return map->findShortestPath(origin, destination, iterationLimit, canEnterTile, false,
+		                             false, true, false, nullptr, 0.0f, arena);
 	}
 
-	// Step 02: Path through segments
-
-	int thisID = originID;
-	int lastID = destinationID;
-	if (!segmentPath.empty())
+	auto waypoints = airspace->findWaypoints(origin, destination, arena);
+	if (waypoints.empty())
 	{
-		lastID = segmentPath.back();
+		return map->findShortestPath(origin, destination, iterationLimit, canEnterTile, false,
+		                             false, true, false, nullptr, 0.0f, arena);
 	}
-	for (auto &segID : segmentPath)
+
+	// Expecting origin to be the first waypoint
+	waypoints.pop_front();
+	std::list<Vec3<int>> result = {origin};
+	for (auto &waypoint : waypoints)
 	{
-		auto &nextSeg = roadSegments[segID];
-		int intoConnect = nextSeg.length == 1 || nextSeg.connections[0] == thisID ? 0 : 1;
-		// If not last and not broken then path through
-		if (segID != lastID && nextSeg.intact)
+		auto distance = canEnterTile.getDistance(result.back(), waypoint);
+		auto path = map->findShortestPath(result.back(), waypoint,
+		                                  distance * WAYPOINT_ITERATION_LIMIT_MULTIPLIER +
+		                                      WAYPOINT_ITERATION_LIMIT_EXTRA,
+		                                  canEnterTile, false, false, true, false, nullptr, 0.0f,
+		                                  arena);
+		// Something (most likely another vehicle) is in the way, can't trust the abstraction
+		if (path.empty() || path.back() != waypoint)
 		{
-			auto pathThrough = nextSeg.findPathThrough(intoConnect);
-			for (auto &p : pathThrough)
-			{
-				result.push_back(p);
-			}
-		}
-		// If last or broken we need to add entrance point and we will exit the cycle now
-		// Expecting broken to be the last one as otherwise we have no point visiting it!
-		else
-		{
-			result.push_back(nextSeg.getByConnectID(intoConnect));
+			LogInfo("Airspace route from %s to %s blocked at %s, pathing directly", origin,
+			        destination, waypoint);
+			return map->findShortestPath(origin, destination, iterationLimit, canEnterTile,
+			                             false, false, true, false, nullptr, 0.0f, arena);
 		}
-		thisID = segID;
-	}
-
-	// Step 03: Path within segment to destination
-
-	auto &destSeg = roadSegments[thisID];
-	// 1) Reached destination? Path to destination, and we don't care if it's broken,
-	// as the result will be the closest path even if it is broken
-	// 2) Didn't reach destination? Path to closest point, this is the closest we get to it
-	auto pathToDestination = thisID == destinationID
-	                             ? destSeg.findPath(result.back(), destination)
-	                             : destSeg.findClosestPath(result.back(), destination);
-
-	// Expecting to have at least our pos at the start, as our pos must be intact
-	pathToDestination.pop_front();
-	for (auto &p : pathToDestination)
-	{
-		result.push_back(p);
+		// Expecting path to start at our current position which is already in the result
+		path.pop_front();
+		result.splice(result.end(), path);
 	}
 
 	return result;
@@ -1666,6 +2497,46 @@ void City::groupMove(GameState &state, std::list<StateRef<Vehicle>> &selectedVeh
 	auto &targetOffsets = diagonal ? targetOffsetsDiagonal : targetOffsetsLinear;
 	int rotation = diagonal ? rotationDiagonal.at(dir) : rotationLinear.at(dir);
 
+	// Flying vehicles of the same type at the same altitude share a field around target, used to
+	// rule out the locations they cannot get to from there, such as those inside buildings
+	static const int FLOW_FIELD_RADIUS = 6;
+	std::map<std::pair<UString, int>, sp<FlowField>> fields;
+	auto getField = [this, &fields, &selectedVehicles, &targetOffsets, rotation,
+	                 targetLocation](Vehicle &v) -> sp<FlowField> {
+		if (v.type->isGround())
+		{
+			return nullptr;
+		}
+		auto destination = v.getPreferredPosition(targetLocation);
+		auto key = std::make_pair(v.type.id, destination.z);
+		auto existing = fields.find(key);
+		if (existing != fields.end())
+		{
+			return existing->second;
+		}
+		Vec3<int> fieldMin = {destination.x - FLOW_FIELD_RADIUS,
+		                      destination.y - FLOW_FIELD_RADIUS, 0};
+		Vec3<int> fieldMax = {destination.x + FLOW_FIELD_RADIUS,
+		                      destination.y + FLOW_FIELD_RADIUS, map->size.z - 1};
+		auto field = mksp<FlowField>(*map, destination, fieldMin, fieldMax,
+		                             FlyingVehicleTileHelper{*map, v}, false, false, true);
+		// Target itself is blocked or too cramped to fit everyone, do not rule anything out
+		unsigned int reachable = 0;
+		for (auto &offset : targetOffsets)
+		{
+			if (field->reaches(destination + rotate(offset, rotation)))
+			{
+				reachable++;
+			}
+		}
+		if (reachable < selectedVehicles.size())
+		{
+			field = nullptr;
+		}
+		fields[key] = field;
+		return field;
+	};
+
 	auto itOffset = targetOffsets.begin();
 	while (it != selectedVehicles.end())
 	{
@@ -1689,6 +2560,11 @@ void City::groupMove(GameState &state, std::list<StateRef<Vehicle>> &selectedVeh
 			itOffset++;
 
 			auto targetPos = (*it)->getPreferredPosition(targetLocationOffsetted);
+			auto field = getField(**it);
+			if (field && !field->reaches(targetPos))
+			{
+				continue;
+			}
 			// FIXME: Don't clear missions if not replacing current mission
 			(*it)->setMission(state,
 			                  VehicleMission::gotoLocation(state, **it, targetPos, useTeleporter));
@@ -1704,6 +2580,7 @@ void City::fillRoadSegmentMap(GameState &state)
 	// Expecting this to be done on clean intact map
 	tileToRoadSegmentMap.clear();
 	roadSegments.clear();
+	roadRouting.clear();
 	auto &m = *map;
 	auto helper = GroundVehicleTileHelper{m, VehicleType::Type::Road, false};
 
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "library/vec.h"
+#include <deque>
+#include <functional>
+#include <list>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class Tile;
+class TileMap;
+class CanEnterTileHelper;
+
+// Scratch storage for TileMap::findShortestPath, owned by the map and reused between searches
+// so that a search does not allocate once the buffers have grown to the map's working size.
+class PathfindingArena
+{
+  public:
+	class Node
+	{
+	  public:
+		float costToGetHere;
+		float trueCost;
+		float distanceToGoal;
+		// Index of the parent node in the arena, -1 for the start node
+		int parentNode;
+		Tile *thisTile;
+
+		float getPriority() const { return costToGetHere + distanceToGoal; }
+	};
+
+	// Prepares the arena for a new search over a map of tileCount tiles. Visited flags are
+	// generation-stamped so nothing is cleared unless the generation counter wraps.
+	void beginSearch(unsigned int tileCount);
+
+	// Adds a node and returns its index. Indices are issued in insertion order, which is what
+	// breaks ties between nodes of equal priority.
+	int addNode(float costToGetHere, float trueCost, float distanceToGoal, int parentNode,
+	            Tile *thisTile);
+	const Node &getNode(int index) const { return nodes[index]; }
+
+	bool isVisited(unsigned int tileIndex) const { return visited[tileIndex] == generation; }
+	void setVisited(unsigned int tileIndex)
+	{
+		visited[tileIndex] = generation;
+		expansionCount++;
+	}
+	// Number of tiles expanded by every search done using this arena
+	unsigned long long getExpansionCount() const { return expansionCount; }
+
+	// Fringe is a binary heap of node indices. Lowest priority is popped first, and of equal
+	// priority nodes the most recently pushed one wins (this matches the ordering of the sorted
+	// list the pathfinder used before, so routes are unchanged).
+	void pushFringe(int index);
+	int popFringe();
+	bool fringeEmpty() const { return fringe.empty(); }
+
+	std::list<Vec3<int>> getPathToNode(int index) const;
+
+  private:
+	bool fringeCompare(int a, int b) const;
+
+	std::vector<Node> nodes;
+	std::vector<int> fringe;
+	std::vector<unsigned int> visited;
+	unsigned int generation = 0;
+	unsigned long long expansionCount = 0;
+};
+
+// Positions of map changes that could affect pathfinding, in the order they happened. Only the
+// most recent ones are kept, whoever falls behind further than that has to start over.
+class PathfindingChangeLog
+{
+  public:
+	static const unsigned int CAPACITY = 1024;
+
+	void add(Vec3<int> position);
+	// Number of changes ever added
+	unsigned int getVersion() const { return version; }
+	// Adds changes made after given version to the list.
+	// Returns false if some of them were already forgotten
+	bool getChangesSince(unsigned int since, std::vector<Vec3<int>> &changesOut) const;
+
+  private:
+	std::deque<Vec3<int>> changes;
+	unsigned int version = 0;
+};
+
+// Incremental planner (D* Lite) towards a fixed destination. The search runs backwards from the
+// destination and its results are kept, so that when the origin moves along the path or some tiles
+// change, the next query only repairs what was affected instead of searching again.
+//
+// Moves are evaluated without jumping, and the unit flags given on creation are used for every
+// query, as the kept costs would not be valid otherwise.
+class IncrementalPathfinder
+{
+  public:
+	IncrementalPathfinder(Vec3<int> destination, bool ignoreStaticUnits, bool ignoreMovingUnits,
+	                      bool ignoreAllUnits, const PathfindingChangeLog &log);
+
+	// True if this can be used to plan a route with these settings
+	bool matches(Vec3<int> destination, bool ignoreStaticUnits, bool ignoreMovingUnits,
+	             bool ignoreAllUnits) const;
+
+	// Moves into or out of the tile at position will be re-evaluated by the next query
+	void notifyChange(Vec3<int> position);
+
+	// Find path from origin (included) to destination, reusing previous searches. Picks up changes
+	// from the log, which must be the one given on creation. Returns empty list if no path was
+	// found within iterationLimit expansions, in which case the next query will carry on from there
+	std::list<Vec3<int>> findPath(TileMap &map, const PathfindingChangeLog &log, Vec3<int> origin,
+	                              unsigned int iterationLimit,
+	                              const CanEnterTileHelper &canEnterTile);
+
+  private:
+	// Primary, secondary
+	using Key = std::pair<float, float>;
+
+	class Node
+	{
+	  public:
+		float g;
+		float rhs;
+		bool queued = false;
+		// Key this node was last queued with, older entries for it in the queue are stale
+		Key queuedKey;
+	};
+
+	class QueueEntry
+	{
+	  public:
+		Key key;
+		unsigned int index;
+		bool operator>(const QueueEntry &other) const { return key > other.key; }
+	};
+
+	Vec3<int> destination;
+	bool ignoreStaticUnits;
+	bool ignoreMovingUnits;
+	bool ignoreAllUnits;
+	// Version of the change log this has caught up with
+	unsigned int knownVersion;
+
+	// Set up by the first query
+	Vec3<int> mapSize = {0, 0, 0};
+	bool started = false;
+	Vec3<int> lastOrigin;
+	float keyModifier = 0.0f;
+	std::unordered_map<unsigned int, Node> nodes;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	std::vector<Vec3<int>> pendingChanges;
+
+	void restart();
+	unsigned int getIndex(Vec3<int> position) const;
+	Vec3<int> getPosition(unsigned int index) const;
+	// Returns how many of the 26 adjacent positions are within the map
+	int getNeighbours(Vec3<int> position, Vec3<int> (&neighbours)[26]) const;
+	Node &getNode(unsigned int index);
+	float getEdgeCost(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> from,
+	                  Vec3<int> to) const;
+	Key calculateKey(const CanEnterTileHelper &canEnterTile, Vec3<int> origin,
+	                 unsigned int index, const Node &node) const;
+	// Puts node in the queue if it is inconsistent, removes it otherwise
+	void queueNode(const CanEnterTileHelper &canEnterTile, Vec3<int> origin, unsigned int index,
+	               Node &node);
+	// Recalculates node's rhs from its neighbours and queues it
+	void updateNode(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> origin,
+	                unsigned int index);
+	// False if limit was reached before origin became consistent
+	bool computePath(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> origin,
+	                 unsigned int iterationLimit);
+};
+
+// Costs of getting to a destination from every position around it, found by a single search
+// running backwards from the destination. Everyone moving to the same place can then follow the
+// field instead of searching for a path of their own.
+//
+// Only positions within the bounds given are considered, and moves are evaluated without jumping.
+// If given required positions or minimumCost, the search stops once all of those positions are
+// reached and every position closer than minimumCost is known, so costs are only final up to
+// getSettledCost(). Otherwise everything within bounds is searched.
+class FlowField
+{
+  public:
+	FlowField(TileMap &map, Vec3<int> destination, Vec3<int> boundsMin, Vec3<int> boundsMax,
+	          const CanEnterTileHelper &canEnterTile, bool ignoreStaticUnits,
+	          bool ignoreMovingUnits, bool ignoreAllUnits,
+	          const std::vector<Vec3<int>> &required = {}, float minimumCost = 0.0f);
+
+	// True if destination can be reached from position
+	bool reaches(Vec3<int> position) const;
+	// Cost of moving from position to destination, only valid if reaches() is true
+	float getCost(Vec3<int> position) const;
+	float getSettledCost() const { return settledCost; }
+	// Path from origin (included) following the field until a position no further than stopCost
+	// from destination is reached. Returns empty list if origin does not reach destination
+	std::list<Vec3<int>> getPath(Vec3<int> origin, float stopCost = 0.0f) const;
+
+  private:
+	Vec3<int> destination;
+	// Inclusive bounds
+	Vec3<int> boundsMin;
+	Vec3<int> boundsMax;
+	Vec3<int> size;
+	float settledCost = 0.0f;
+	std::vector<float> costs;
+	// Index of the next position towards destination, -1 if none
+	std::vector<int> next;
+
+	bool withinBounds(Vec3<int> position) const;
+	int getIndex(Vec3<int> position) const;
+	Vec3<int> getPosition(int index) const;
+};
+
+}; // namespace OpenApoc
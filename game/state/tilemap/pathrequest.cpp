@@ -0,0 +1,86 @@
+#include "game/state/tilemap/pathrequest.h"
+#include "framework/framework.h"
+#include "framework/trace.h"
+#include "library/strings.h"
+
+namespace OpenApoc
+{
+
+PathRequest::PathRequest(Search search) : search(std::move(search)) {}
+
+sp<PathRequest> PathRequestQueue::request(PathRequest::Search search, bool priority)
+{
+	auto newRequest = mksp<PathRequest>(std::move(search));
+	if (priority)
+	{
+		priorityPending.push_back(newRequest);
+	}
+	else
+	{
+		pending.push_back(newRequest);
+	}
+	return newRequest;
+}
+
+void PathRequestQueue::process(unsigned int budget)
+{
+	std::vector<sp<PathRequest>> batch;
+	auto takeFrom = [&batch, budget](std::list<sp<PathRequest>> &requests) {
+		while (!requests.empty() && batch.size() < budget)
+		{
+			auto request = requests.front();
+			requests.pop_front();
+			// If we hold the only reference then nobody is waiting for the result
+			if (request->cancelled || request.use_count() == 1)
+			{
+				continue;
+			}
+			batch.push_back(request);
+		}
+	};
+	takeFrom(priorityPending);
+	takeFrom(pending);
+	if (batch.empty())
+	{
+		return;
+	}
+
+	TRACE_FN_ARGS1("requests", Strings::fromInteger(static_cast<int>(batch.size())));
+	auto framework = Framework::tryGetInstance();
+	unsigned int threadCount = framework ? framework->threadPoolGetSize() + 1 : 1;
+	if (arenas.size() < threadCount)
+	{
+		arenas.resize(threadCount);
+	}
+	// Every search only touches its own request, so there is nothing to synchronise
+	auto runSearch = [this, &batch](unsigned int index, unsigned int slot) {
+		auto &request = *batch[index];
+		request.path = request.search(arenas[slot]);
+	};
+	if (framework && batch.size() > 1)
+	{
+		framework->threadPoolParallelFor(batch.size(), runSearch);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < batch.size(); index++)
+		{
+			runSearch(index, 0);
+		}
+	}
+
+	for (auto &request : batch)
+	{
+		request->finished = true;
+		// Release whatever the search captured
+		request->search = nullptr;
+	}
+}
+
+void PathRequestQueue::clear()
+{
+	priorityPending.clear();
+	pending.clear();
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "game/state/tilemap/pathfinding.h"
+#include "library/sp.h"
+#include "library/vec.h"
+#include <functional>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// A path search waiting in a PathRequestQueue. Whoever placed the request keeps a reference to
+// it and picks up the result once it is finished; dropping that reference (for example when the
+// mission holding it is replaced) or calling cancel() means the search is never run.
+class PathRequest
+{
+  public:
+	// Performs the search. It is called possibly on a worker thread, alongside other searches,
+	// while the map is left untouched, so it must only read game state, and must do all its
+	// map searches using the arena provided
+	using Search = std::function<std::list<Vec3<int>>(PathfindingArena &arena)>;
+
+	PathRequest(Search search);
+
+	void cancel() { cancelled = true; }
+	bool isFinished() const { return finished; }
+	// Only valid once finished
+	const std::list<Vec3<int>> &getPath() const { return path; }
+	// Only valid once finished, leaves the request without a path
+	std::list<Vec3<int>> takePath() { return std::move(path); }
+
+  private:
+	friend class PathRequestQueue;
+
+	Search search;
+	bool cancelled = false;
+	bool finished = false;
+	std::list<Vec3<int>> path;
+};
+
+// Collects path searches requested during an update and runs them in batches on the thread
+// pool. A batch only runs from process(), which returns once all of its searches are done, so
+// every search in it sees the same state of the map.
+class PathRequestQueue
+{
+  public:
+	// Queue a search. Priority requests (player's units) are run before any others
+	sp<PathRequest> request(PathRequest::Search search, bool priority = false);
+
+	// Run up to budget pending searches. Must be called when nothing is modifying the map
+	void process(unsigned int budget);
+
+	// Drop everything pending, requests will never finish
+	void clear();
+
+  private:
+	std::list<sp<PathRequest>> priorityPending;
+	std::list<sp<PathRequest>> pending;
+	// One per thread that can be running a search
+	std::vector<PathfindingArena> arenas;
+};
+
+}; // namespace OpenApoc
@@ -86,9 +86,9 @@ bool Tile::getSolidGround(bool large)
 			         position.x, position.y, position.z);
 			return false;
 		}
-		if (solidGround || map.getTile(position.x - 1, position.y, position.z)->solidGround ||
-		    map.getTile(position.x, position.y - 1, position.z)->solidGround ||
-		    map.getTile(position.x - 1, position.y - 1, position.z)->solidGround)
+		if (solidGround || map.getNavigation(position.x - 1, position.y, position.z).solidGround ||
+		    map.getNavigation(position.x, position.y - 1, position.z).solidGround ||
+		    map.getNavigation(position.x - 1, position.y - 1, position.z).solidGround)
 		{
 			return true;
 		}
@@ -114,9 +114,9 @@ bool Tile::getCanStand(bool large)
 			    position.x, position.y, position.z);
 			return false;
 		}
-		if (canStand || map.getTile(position.x - 1, position.y, position.z)->canStand ||
-		    map.getTile(position.x, position.y - 1, position.z)->canStand ||
-		    map.getTile(position.x - 1, position.y - 1, position.z)->canStand)
+		if (canStand || map.getNavigation(position.x - 1, position.y, position.z).canStand ||
+		    map.getNavigation(position.x, position.y - 1, position.z).canStand ||
+		    map.getNavigation(position.x - 1, position.y - 1, position.z).canStand)
 		{
 			return true;
 		}
@@ -175,42 +175,42 @@ bool Tile::getPassable(bool large, int height)
 			return false;
 		}
 
-		auto tX = map.getTile(position.x - 1, position.y, position.z);
-		if (tX->movementCostIn == 255)
+		auto &tX = map.getNavigation(position.x - 1, position.y, position.z);
+		if (tX.movementCostIn == 255)
 			return false;
-		if (tX->movementCostRight == 255)
+		if (tX.movementCostRight == 255)
 			return false;
 
-		auto tY = map.getTile(position.x, position.y - 1, position.z);
-		if (tY->movementCostIn == 255)
+		auto &tY = map.getNavigation(position.x, position.y - 1, position.z);
+		if (tY.movementCostIn == 255)
 			return false;
-		if (tY->movementCostLeft == 255)
+		if (tY.movementCostLeft == 255)
 			return false;
 
-		if (map.getTile(position.x - 1, position.y - 1, position.z)->movementCostIn == 255)
+		if (map.getNavigation(position.x - 1, position.y - 1, position.z).movementCostIn == 255)
 			return false;
 
-		auto tZ = map.getTile(position.x, position.y, position.z + 1);
-		if (tZ->movementCostIn == 255)
+		auto &tZ = map.getNavigation(position.x, position.y, position.z + 1);
+		if (tZ.movementCostIn == 255)
 			return false;
-		if (tZ->movementCostLeft == 255)
+		if (tZ.movementCostLeft == 255)
 			return false;
-		if (tZ->movementCostRight == 255)
+		if (tZ.movementCostRight == 255)
 			return false;
 
-		auto tXZ = map.getTile(position.x - 1, position.y, position.z + 1);
-		if (tXZ->movementCostIn == 255)
+		auto &tXZ = map.getNavigation(position.x - 1, position.y, position.z + 1);
+		if (tXZ.movementCostIn == 255)
 			return false;
-		if (tXZ->movementCostRight == 255)
+		if (tXZ.movementCostRight == 255)
 			return false;
 
-		auto tYZ = map.getTile(position.x, position.y - 1, position.z + 1);
-		if (tYZ->movementCostIn == 255)
+		auto &tYZ = map.getNavigation(position.x, position.y - 1, position.z + 1);
+		if (tYZ.movementCostIn == 255)
 			return false;
-		if (tYZ->movementCostLeft == 255)
+		if (tYZ.movementCostLeft == 255)
 			return false;
 
-		if (map.getTile(position.x - 1, position.y - 1, position.z + 1)->movementCostIn == 255)
+		if (map.getNavigation(position.x - 1, position.y - 1, position.z + 1).movementCostIn == 255)
 			return false;
 	}
 
@@ -224,19 +224,19 @@ bool Tile::getHeadFits(bool large, int height)
 	if (large)
 	{
 		// Check four tiles above our "to"'s head
-		if (map.getTile(Vec3<int>{position.x, position.y, position.z + 2})->solidGround ||
-		    map.getTile(Vec3<int>{position.x - 1, position.y, position.z + 2})->solidGround ||
-		    map.getTile(Vec3<int>{position.x, position.y - 1, position.z + 2})->solidGround ||
-		    map.getTile(Vec3<int>{position.x - 1, position.y - 1, position.z + 2})->solidGround)
+		if (map.getNavigation(position.x, position.y, position.z + 2).solidGround ||
+		    map.getNavigation(position.x - 1, position.y, position.z + 2).solidGround ||
+		    map.getNavigation(position.x, position.y - 1, position.z + 2).solidGround ||
+		    map.getNavigation(position.x - 1, position.y - 1, position.z + 2).solidGround)
 		{
-			auto toX1 = map.getTile(Vec3<int>{position.x - 1, position.y, position.z});
-			auto toY1 = map.getTile(Vec3<int>{position.x, position.y - 1, position.z});
-			auto toXY1 = map.getTile(Vec3<int>{position.x - 1, position.y - 1, position.z});
+			auto &toX1 = map.getNavigation(position.x - 1, position.y, position.z);
+			auto &toY1 = map.getNavigation(position.x, position.y - 1, position.z);
+			auto &toXY1 = map.getNavigation(position.x - 1, position.y - 1, position.z);
 
 			float maxHeight = this->height;
-			maxHeight = std::max(maxHeight, toX1->height);
-			maxHeight = std::max(maxHeight, toY1->height);
-			maxHeight = std::max(maxHeight, toXY1->height);
+			maxHeight = std::max(maxHeight, toX1.height);
+			maxHeight = std::max(maxHeight, toY1.height);
+			maxHeight = std::max(maxHeight, toXY1.height);
 			if (height + maxHeight * 40 - 1 > 80)
 			{
 				return false;
@@ -245,7 +245,7 @@ bool Tile::getHeadFits(bool large, int height)
 	}
 	else
 	{
-		if (map.getTile(Vec3<int>{position.x, position.y, position.z + 1})->solidGround &&
+		if (map.getNavigation(position.x, position.y, position.z + 1).solidGround &&
 		    height + this->height * 40 - 1 > 40)
 		{
 			return false;
@@ -292,11 +292,20 @@ void Tile::updateBattlescapeUIDrawOrder()
 void Tile::updateBattlescapeUnitPresent()
 {
 	firstUnitPresent = nullptr;
+	occupyingUnits.clear();
 	for (auto &o : intersectingObjects)
 	{
 		if (o->getType() == TileObject::Type::Unit)
 		{
 			auto u = std::static_pointer_cast<TileObjectBattleUnit>(o);
+			if (u->occupiedTiles.find(position) != u->occupiedTiles.end())
+			{
+				occupyingUnits.push_back(u);
+			}
+			if (firstUnitPresent && doorOpeningUnitPresent)
+			{
+				continue;
+			}
 			if (!firstUnitPresent)
 			{
 				firstUnitPresent = u;
@@ -307,10 +316,6 @@ void Tile::updateBattlescapeUnitPresent()
 			doorOpeningUnitPresent =
 			    doorOpeningUnitPresent | (x > 0.45f && x < 0.55f && y > 0.45f && y < 0.55f) ||
 			    u->getUnit()->isLarge();
-			if (firstUnitPresent && doorOpeningUnitPresent)
-			{
-				break;
-			}
 		}
 	}
 	if (!firstUnitPresent)
@@ -325,6 +330,7 @@ void Tile::updateCityscapeParameters()
 	{
 		return;
 	}
+	map.notifySceneryChange();
 	height = 0.0f;
 	overlayHeight = 0.0f;
 	presentScenery = nullptr;
@@ -343,6 +349,7 @@ void Tile::updateCityscapeParameters()
 			break;
 		}
 	}
+	map.updateNavigation(*this);
 }
 
 void Tile::updateBattlescapeParameters()
@@ -351,6 +358,9 @@ void Tile::updateBattlescapeParameters()
 	{
 		return;
 	}
+	// Map parts may have changed shape, as doors do when opening
+	map.notifyCollisionChange();
+	map.notifyVisionChange();
 	bool providedGroundUpwards = solidGround && height >= 0.9625f;
 	height = 0.0f;
 	movementCostIn = -1; // -1 means empty, and will be set to 4 afterwards
@@ -447,10 +457,12 @@ void Tile::updateBattlescapeParameters()
 			{
 				t->canStand = true;
 				t->movementCostIn = std::max(movementCostOver, t->movementCostIn);
+				map.updateNavigation(*t);
 			}
 		}
 	}
 	height = height / (float)TILE_Z_BATTLE;
+	map.updateNavigation(*this);
 	// Propagate update upwards if we provided ground and ceased to do so
 	if (!(solidGround && height >= 0.9625f) && providedGroundUpwards && position.z + 1 < map.size.z)
 	{
@@ -466,11 +478,17 @@ bool Tile::updateVisionBlockage(int value)
 		return false;
 	}
 	visionBlockValue = value;
+	map.notifyVisionChange();
 	return true;
 }
 
 sp<TileObjectBattleUnit> Tile::getUnitIfPresent() const { return firstUnitPresent; }
 
+sp<BattleHazard> Tile::getHazardIfPresent() const
+{
+	return presentHazard ? presentHazard->getHazard() : nullptr;
+}
+
 sp<TileObjectBattleUnit> Tile::getUnitIfPresent(bool onlyConscious, bool mustOccupy,
                                                 bool mustBeStatic,
                                                 sp<TileObjectBattleUnit> exceptThis, bool onlyLarge,
@@ -504,6 +522,24 @@ sp<TileObjectBattleUnit> Tile::getUnitIfPresent(bool onlyConscious, bool mustOcc
 		}
 	}
 
+	if (!firstUnitPresent)
+	{
+		return nullptr;
+	}
+	if (mustOccupy)
+	{
+		for (auto &unitTileObject : occupyingUnits)
+		{
+			auto unit = unitTileObject->getUnit();
+			if ((onlyConscious && !unit->isConscious()) || (exceptThis == unitTileObject) ||
+			    (mustBeStatic && !unit->isStatic()) || (onlyLarge && !unit->isLarge()))
+			{
+				continue;
+			}
+			return unitTileObject;
+		}
+		return nullptr;
+	}
 	for (auto &o : intersectingObjects)
 	{
 		if (o->getType() == TileObject::Type::Unit)
@@ -511,9 +547,6 @@ sp<TileObjectBattleUnit> Tile::getUnitIfPresent(bool onlyConscious, bool mustOcc
 			auto unitTileObject = std::static_pointer_cast<TileObjectBattleUnit>(o);
 			auto unit = unitTileObject->getUnit();
 			if ((onlyConscious && !unit->isConscious()) || (exceptThis == unitTileObject) ||
-			    (mustOccupy &&
-			     unitTileObject->occupiedTiles.find(position) ==
-			         unitTileObject->occupiedTiles.end()) ||
 			    (mustBeStatic && !unit->isStatic()) || (onlyLarge && !unit->isLarge()))
 			{
 				continue;
@@ -5,7 +5,9 @@
 #include "game/state/stateobject.h"
 #include "library/colour.h"
 #include "library/rect.h"
+#include "library/smallset.h"
 #include "library/sp.h"
+#include <cstdint>
 #include <map>
 #include <set>
 #include <vector>
@@ -40,14 +42,38 @@ class Sample;
 class TileObject;
 class Organisation;
 
+// What pathfinding looks at on a tile, the same as the fields of the same names in Tile. TileMap
+// keeps a copy for every tile next to each other, so that checks going over the tiles a unit
+// touches read a few bytes of each rather than a whole Tile
+class TileNavigation
+{
+  public:
+	float height = 0.0f;
+	uint8_t movementCostIn = 4;
+	uint8_t movementCostOver = 255;
+	uint8_t movementCostLeft = 0;
+	uint8_t movementCostRight = 0;
+	bool closedDoorLeft = false;
+	bool closedDoorRight = false;
+	bool solidGround = false;
+	bool canStand = false;
+	bool hasLift = false;
+};
+
 class Tile
 {
   public:
 	TileMap &map;
 	Vec3<int> position;
 
-	std::set<sp<TileObject>> ownedObjects;
-	std::set<sp<TileObject>> intersectingObjects;
+	// Few tiles have more than a handful of objects, and projectiles move between tiles all the
+	// time, so these keep their first few within the tile rather than allocating for each
+	SmallSet<sp<TileObject>, 4> ownedObjects;
+	SmallSet<sp<TileObject>, 4> intersectingObjects;
+	// Number of intersectingObjects that have a voxel map for LOF and for LOS, which lets
+	// collision checks skip over tiles that have nothing in them to collide with
+	unsigned int voxelObjectsLOF = 0;
+	unsigned int voxelObjectsLOS = 0;
 
 	// FIXME: This is effectively a z-sorted list of ownedObjects - can this be merged somehow?
 	// Alexey Andronov (Istrebitel): This is no longer so, because
@@ -91,6 +117,9 @@ class Tile
 	bool hasExit = false;
 	// True = unit is present in this tile
 	sp<TileObjectBattleUnit> firstUnitPresent;
+	// Units in intersectingObjects that occupy this tile too, in the same order, so the checks
+	// of whether a unit is in the way of another look at nothing else
+	std::vector<sp<TileObjectBattleUnit>> occupyingUnits;
 	// True = unit that qualifies as a door opener present in this tile
 	bool doorOpeningUnitPresent = false;
 	// position in drawnObjects vector to draw back selection bracket at
@@ -107,6 +136,8 @@ class Tile
 	int visionBlockValue = 0;
 	// Non-dead scenery present in this tile
 	sp<Scenery> presentScenery;
+	// Hazard owned by this tile, there is never more than one
+	sp<TileObjectBattleHazard> presentHazard;
 
 	// Methods
 
@@ -122,6 +153,8 @@ class Tile
 	                                   bool mustBeStatic = false,
 	                                   sp<TileObjectBattleUnit> exceptThis = nullptr,
 	                                   bool onlyLarge = false, bool checkLargeSpace = false) const;
+	// Returns hazard owned by the tile, if any
+	sp<BattleHazard> getHazardIfPresent() const;
 	// Returns items that can be collected by standing in this tile)
 	std::list<sp<BattleItem>> getItems();
 	// Returns resting position for items and units in the tile
@@ -178,6 +211,9 @@ class CanEnterTileHelper
 	// Value here defines how much, in percent, can resulting path afford to be unoptimal
 	// For example 1.05 means resulting path can be 5% longer than an optimal one
 	virtual float pathOverheadAlloawnce() const { return 1.0f; }
+	// Whether a straight line is worth trying before searching, which is only the case for those
+	// moving through open space where nothing is usually in the way
+	virtual bool canFlyStraight() const { return false; }
 };
 
 }; // namespace OpenApoc
@@ -13,6 +13,7 @@
 #include "game/state/shared/doodad.h"
 #include "game/state/shared/projectile.h"
 #include "game/state/tilemap/collision.h"
+#include "game/state/tilemap/pathfinding.h"
 #include "game/state/tilemap/tileobject_battlehazard.h"
 #include "game/state/tilemap/tileobject_battleitem.h"
 #include "game/state/tilemap/tileobject_battlemappart.h"
@@ -22,6 +23,7 @@
 #include "game/state/tilemap/tileobject_scenery.h"
 #include "game/state/tilemap/tileobject_shadow.h"
 #include "game/state/tilemap/tileobject_vehicle.h"
+#include "game/state/tilemap/tileroutingtable.h"
 #include "library/sp.h"
 #include <algorithm>
 #include <random>
@@ -30,21 +32,58 @@
 namespace OpenApoc
 {
 
-TileMap::TileMap(Vec3<int> size, Vec3<float> velocityScale, Vec3<int> voxelMapSize,
-                 std::vector<std::set<TileObject::Type>> layerMap)
-    : layerMap(layerMap), size(size), voxelMapSize(voxelMapSize), velocityScale(velocityScale)
+TileStore::TileStore(Vec3<int> size)
+    : size(size), chunkCount((size.x + CHUNK_SIZE - 1) / CHUNK_SIZE,
+                             (size.y + CHUNK_SIZE - 1) / CHUNK_SIZE),
+      chunks(chunkCount.x * chunkCount.y * size.z)
+{
+}
+
+TileStore::~TileStore()
+{
+	for (auto &chunk : chunks)
+	{
+		delete chunk.load();
+	}
+}
+
+TileStore::Chunk *TileStore::makeChunk(TileMap &map, int index)
 {
-	tiles.reserve(size.x * size.y * size.z);
-	for (int z = 0; z < size.z; z++)
+	int z = index / (chunkCount.x * chunkCount.y);
+	auto chunk = new Chunk();
+	chunk->origin = {index % chunkCount.x * CHUNK_SIZE,
+	                 index / chunkCount.x % chunkCount.y * CHUNK_SIZE};
+	chunk->width = std::min(CHUNK_SIZE, size.x - chunk->origin.x);
+	int height = std::min(CHUNK_SIZE, size.y - chunk->origin.y);
+	chunk->tiles.reserve(chunk->width * height);
+	for (int y = chunk->origin.y; y < chunk->origin.y + height; y++)
 	{
-		for (int y = 0; y < size.y; y++)
+		for (int x = chunk->origin.x; x < chunk->origin.x + chunk->width; x++)
 		{
-			for (int x = 0; x < size.x; x++)
-			{
-				tiles.emplace_back(*this, Vec3<int>{x, y, z}, this->getLayerCount());
-			}
+			chunk->tiles.emplace_back(map, Vec3<int>{x, y, z}, map.getLayerCount());
 		}
 	}
+	// Another thread may have made the same chunk in the meantime, in which case that one is kept
+	Chunk *expected = nullptr;
+	if (!chunks[index].compare_exchange_strong(expected, chunk, std::memory_order_acq_rel))
+	{
+		delete chunk;
+		return expected;
+	}
+	return chunk;
+}
+
+TileMap::TileMap(Vec3<int> size, Vec3<float> velocityScale, Vec3<int> voxelMapSize,
+                 std::vector<std::set<TileObject::Type>> layerMap)
+    : tiles(size), layerMap(layerMap), pathfindingArena(mkup<PathfindingArena>()), size(size),
+      voxelMapSize(voxelMapSize), velocityScale(velocityScale),
+      agentRouting(mkup<TileRoutingTable>())
+{
+	emptyTile = mkup<Tile>(*this, Vec3<int>{-1, -1, -1}, this->getLayerCount());
+	navigation.resize(size.x * size.y * size.z);
+
+	auto chunkCount = getDrawChunkCount();
+	drawRevisions.resize(chunkCount.x * chunkCount.y * chunkCount.z, 0);
 
 	// Quick sanity check of the layer map:
 	std::set<TileObject::Type> seenTypes;
@@ -63,6 +102,69 @@ TileMap::TileMap(Vec3<int> size, Vec3<float> velocityScale, Vec3<int> voxelMapSi
 
 TileMap::~TileMap() = default;
 
+void TileEdgeCache::invalidate(Vec3<int> position, int distance)
+{
+	for (int z = std::max(0, position.z - distance);
+	     z <= std::min(size.z - 1, position.z + distance); z++)
+	{
+		for (int y = std::max(0, position.y - distance);
+		     y <= std::min(size.y - 1, position.y + distance); y++)
+		{
+			int first = (z * size.y + y) * size.x + std::max(0, position.x - distance);
+			int last = (z * size.y + y) * size.x + std::min(size.x - 1, position.x + distance);
+			for (int i = first * 27; i < (last + 1) * 27; i++)
+			{
+				edges[i].store(UNKNOWN, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+TileEdgeCache &TileMap::getEdgeCache(unsigned int key)
+{
+	auto &cache = edgeCaches[key];
+	if (!cache)
+	{
+		cache = mkup<TileEdgeCache>(size);
+	}
+	return *cache;
+}
+
+void TileMap::updateNavigation(const Tile &tile)
+{
+	auto &pos = tile.position;
+	auto &nav = navigation[pos.z * size.x * size.y + pos.y * size.x + pos.x];
+	auto previous = nav;
+	nav.height = tile.height;
+	nav.movementCostIn = static_cast<uint8_t>(tile.movementCostIn);
+	nav.movementCostOver = static_cast<uint8_t>(tile.movementCostOver);
+	nav.movementCostLeft = static_cast<uint8_t>(tile.movementCostLeft);
+	nav.movementCostRight = static_cast<uint8_t>(tile.movementCostRight);
+	nav.closedDoorLeft = tile.closedDoorLeft;
+	nav.closedDoorRight = tile.closedDoorRight;
+	nav.solidGround = tile.solidGround;
+	nav.canStand = tile.canStand;
+	nav.hasLift = tile.hasLift;
+	if (edgeCaches.empty())
+	{
+		return;
+	}
+	if (previous.height != nav.height || previous.movementCostIn != nav.movementCostIn ||
+	    previous.movementCostOver != nav.movementCostOver ||
+	    previous.movementCostLeft != nav.movementCostLeft ||
+	    previous.movementCostRight != nav.movementCostRight ||
+	    previous.closedDoorLeft != nav.closedDoorLeft ||
+	    previous.closedDoorRight != nav.closedDoorRight ||
+	    previous.solidGround != nav.solidGround || previous.canStand != nav.canStand ||
+	    previous.hasLift != nav.hasLift)
+	{
+		for (auto &cache : edgeCaches)
+		{
+			cache.second->invalidate(pos, EDGE_CACHE_REACH);
+		}
+	}
+}
+
 void TileMap::addObjectToMap(sp<Projectile> projectile)
 {
 	if (projectile->tileObject)
@@ -223,6 +325,112 @@ unsigned int TileMap::getLayer(TileObject::Type type) const
 
 unsigned int TileMap::getLayerCount() const { return (unsigned)this->layerMap.size(); }
 
+Vec3<int> TileMap::getDrawChunkCount() const
+{
+	return {(size.x + DRAW_CHUNK_SIZE - 1) / DRAW_CHUNK_SIZE,
+	        (size.y + DRAW_CHUNK_SIZE - 1) / DRAW_CHUNK_SIZE, size.z};
+}
+
+void TileMap::notifyDrawnChange(Vec3<int> position)
+{
+	if (!tileIsValid(position))
+	{
+		return;
+	}
+	auto chunkCount = getDrawChunkCount();
+	drawRevisions[position.z * chunkCount.x * chunkCount.y +
+	              position.y / DRAW_CHUNK_SIZE * chunkCount.x + position.x / DRAW_CHUNK_SIZE]++;
+}
+
+void TileMap::placeShadows(Vec2<int> min, Vec2<int> max)
+{
+	TRACE_FN;
+	// Big units and the shadow sprites go a bit past the tile the owner is on
+	static const int margin = 2;
+	for (size_t i = 0; i < movedShadows.size();)
+	{
+		auto shadow = movedShadows[i].lock();
+		if (shadow && shadow->moved)
+		{
+			auto &position = shadow->ownerPosition;
+			if (position.x < min.x - margin || position.x >= max.x + margin ||
+			    position.y < min.y - margin || position.y >= max.y + margin)
+			{
+				i++;
+				continue;
+			}
+			shadow->place();
+		}
+		movedShadows[i] = std::move(movedShadows.back());
+		movedShadows.pop_back();
+	}
+}
+
+void TileMap::queueShadow(sp<TileObjectShadow> shadow)
+{
+	if (movedShadows.size() >= shadowsPruneSize)
+	{
+		movedShadows.erase(std::remove_if(movedShadows.begin(), movedShadows.end(),
+		                                  [](const wp<TileObjectShadow> &queued) {
+			                                  auto s = queued.lock();
+			                                  return !s || !s->moved;
+		                                  }),
+		                   movedShadows.end());
+		shadowsPruneSize = std::max<size_t>(64, movedShadows.size() * 2);
+	}
+	movedShadows.push_back(shadow);
+}
+
+void TileMap::setHeatRecording(bool record)
+{
+	if (record && heat.empty())
+	{
+		unsigned int count = size.x * size.y * size.z;
+		for (int kind = 0; kind < HEAT_KIND_COUNT; kind++)
+		{
+			heat.emplace_back(new std::atomic<unsigned int>[count]);
+			for (unsigned int i = 0; i < count; i++)
+			{
+				heat.back()[i].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+	// Anything that sees recording on also sees the counts made
+	heatRecording.store(record, std::memory_order_release);
+}
+
+void TileMap::addHeatAt(int kind, Vec3<int> tile) const
+{
+	if (!tileIsValid(tile))
+	{
+		return;
+	}
+	heat[kind][(tile.z * size.y + tile.y) * size.x + tile.x].fetch_add(1,
+	                                                                    std::memory_order_relaxed);
+}
+
+std::vector<unsigned int> TileMap::takeHeat(HeatKind kind)
+{
+	std::vector<unsigned int> counts;
+	if (heat.empty())
+	{
+		return counts;
+	}
+	unsigned int count = size.x * size.y * size.z;
+	counts.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		counts[i] = heat[(int)kind][i].exchange(0, std::memory_order_relaxed);
+	}
+	return counts;
+}
+
+unsigned int TileMap::getDrawRevision(Vec3<int> chunk) const
+{
+	auto chunkCount = getDrawChunkCount();
+	return drawRevisions[chunk.z * chunkCount.x * chunkCount.y + chunk.y * chunkCount.x + chunk.x];
+}
+
 bool TileMap::tileIsValid(int x, int y, int z) const
 {
 	if (z < 0 || z >= this->size.z || y < 0 || y >= this->size.y || x < 0 || x >= this->size.x)
@@ -258,29 +466,44 @@ sp<Image> TileMap::dumpVoxelView(const Rect<int> viewRect, const TileTransform &
 
 	int inc = fast ? 2 : 1;
 
+	CollisionOptions options;
+	options.useLOS = los;
+	options.checkFullPath = true;
+	std::vector<std::pair<Vec3<float>, Vec3<float>>> lineSegments;
+	std::vector<Collision> collisions;
 	for (int y = 0; y < h; y += inc)
 	{
+		// A row at a time goes over the thread pool, which keeps the results held at once small
+		lineSegments.clear();
 		for (int x = 0; x < w; x += inc)
 		{
 			auto topPos = transform.screenToTileCoords(Vec2<float>{x, y} + offset, maxZ - 0.01f);
 			auto bottomPos = transform.screenToTileCoords(Vec2<float>{x, y} + offset, 0.0f);
+			lineSegments.emplace_back(topPos, bottomPos);
+		}
+		this->findCollisions(lineSegments, options, collisions);
 
-			auto collision = this->findCollision(topPos, bottomPos, {}, nullptr, los, true);
-			if (collision)
+		for (unsigned int i = 0; i < collisions.size(); i++)
+		{
+			auto &collision = collisions[i];
+			if (!collision)
 			{
-				if (objectColours.find(collision.obj) == objectColours.end())
-				{
-					Colour c = {static_cast<uint8_t>(colourDist(colourRNG)),
-					            static_cast<uint8_t>(colourDist(colourRNG)),
-					            static_cast<uint8_t>(colourDist(colourRNG)), 255};
-					objectColours[collision.obj] = c;
-				}
-				lock.set({x, y}, objectColours[collision.obj]);
-				if (fast)
+				continue;
+			}
+			if (objectColours.find(collision.obj) == objectColours.end())
+			{
+				Colour c = {static_cast<uint8_t>(colourDist(colourRNG)),
+				            static_cast<uint8_t>(colourDist(colourRNG)),
+				            static_cast<uint8_t>(colourDist(colourRNG)), 255};
+				objectColours[collision.obj] = c;
+			}
+			int x = i * inc;
+			auto colour = objectColours[collision.obj];
+			for (int pixelY = y; pixelY < std::min(y + inc, h); pixelY++)
+			{
+				for (int pixelX = x; pixelX < std::min(x + inc, w); pixelX++)
 				{
-					lock.set({x + 1, y}, objectColours[collision.obj]);
-					lock.set({x, y + 1}, objectColours[collision.obj]);
-					lock.set({x + 1, y + 1}, objectColours[collision.obj]);
+					lock.set({pixelX, pixelY}, colour);
 				}
 			}
 		}
@@ -291,22 +514,29 @@ sp<Image> TileMap::dumpVoxelView(const Rect<int> viewRect, const TileTransform &
 
 void TileMap::updateAllBattlescapeInfo()
 {
-	for (auto &t : tiles)
-	{
+	// Tiles not made yet have nothing on them, so they are as they would be after any update
+	tiles.forEach([](Tile &t) {
 		t.updateBattlescapeParameters();
 		t.updateBattlescapeUIDrawOrder();
 		t.updateBattlescapeUnitPresent();
-	}
+	});
 }
 
 void TileMap::updateAllCityInfo()
 {
-	for (auto &t : tiles)
-	{
-		t.updateCityscapeParameters();
-	}
+	tiles.forEach([](Tile &t) { t.updateCityscapeParameters(); });
+}
+
+unsigned long long TileMap::getPathfindingExpansionCount() const
+{
+	return pathfindingArena->getExpansionCount();
+}
+
+void TileMap::invalidatePathCaches(Vec3<int> position)
+{
+	agentRouting->invalidate(*this, position);
 }
 
-void TileMap::clearPathCaches() { agentPathCache.clear(); }
+void TileMap::clearPathCaches() { agentRouting->clear(); }
 
 }; // namespace OpenApoc
@@ -8,8 +8,12 @@
 #include "library/colour.h"
 #include "library/rect.h"
 #include "library/sp.h"
+#include "library/spatialhash.h"
+#include <atomic>
 #include <map>
 #include <set>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #define VELOCITY_SCALE_CITY (Vec3<float>{32, 32, 16})
@@ -33,6 +37,7 @@ class Vehicle;
 class TileObjectVehicle;
 class Scenery;
 class TileObjectScenery;
+class TileObjectShadow;
 class Doodad;
 class TileObjectDoodad;
 class BattleMapPart;
@@ -45,6 +50,27 @@ class BattleHazard;
 class TileObjectBattleHazard;
 class Sample;
 class Organisation;
+class PathfindingArena;
+class TileRoutingTable;
+
+class CollisionOptions
+{
+  public:
+	// Types of objects that can be collided with, any type if 0
+	TileObject::TypeMask validTypes = 0;
+	sp<TileObject> ignoredObject;
+	// Use LOS voxel maps instead of LOF ones
+	bool useLOS = false;
+	// Keep going past the map's edges instead of stopping there
+	bool checkFullPath = false;
+	// Distance after which to stop, including vision blockage passed, unlimited if 0
+	unsigned maxRange = 0;
+	// Every tile passed is appended to this, only when there is a maxRange. Nothing clears it, so
+	// the caller can keep one buffer for every line it checks
+	std::vector<Vec3<int>> *passedTiles = nullptr;
+	// Ignore projectiles fired by this organisation
+	StateRef<Organisation> ignoreOwnedProjectiles;
+};
 
 class TileTransform
 {
@@ -69,11 +95,172 @@ enum class MapDirection
 	Down = 5
 };
 
+// Launch velocities found for a throw, see AEquipment::getVelocityForThrowLaunch
+class ThrowSolution
+{
+  public:
+	bool valid = false;
+	float velocityXY = 0.0f;
+	float velocityZ = 0.0f;
+};
+
+// What a CanEnterTileHelper worked out from the terrain alone about stepping from each tile to
+// each of its neighbours, for one kind of mover. Searches fill it in as they go, from whichever
+// thread they run on, and TileMap::updateNavigation forgets the steps a changed tile could affect
+class TileEdgeCache
+{
+  public:
+	// Nothing is known of a step until it is stored
+	static const uint16_t UNKNOWN = 0;
+
+	TileEdgeCache(Vec3<int> size) : size(size), edges(size.x * size.y * size.z * 27) {}
+
+	// The offset to the neighbour must be no more than 1 on every axis
+	std::atomic<uint16_t> &getEdge(Vec3<int> from, Vec3<int> offset)
+	{
+		return edges[((from.z * size.y + from.y) * size.x + from.x) * 27 +
+		             (offset.z + 1) * 9 + (offset.y + 1) * 3 + offset.x + 1];
+	}
+	// Cost is kept in halves, which is all the helpers use
+	static uint16_t encode(bool passable, float cost, bool doorInTheWay)
+	{
+		return static_cast<uint16_t>(1 | (passable ? 2 : 0) | (doorInTheWay ? 4 : 0) |
+		                             (passable ? static_cast<int>(cost * 2.0f) << 3 : 0));
+	}
+	static bool getPassable(uint16_t edge) { return edge & 2; }
+	static bool getDoorInTheWay(uint16_t edge) { return edge & 4; }
+	static float getCost(uint16_t edge) { return static_cast<float>(edge >> 3) / 2.0f; }
+	// Forget every step from the tiles within distance of position
+	void invalidate(Vec3<int> position, int distance);
+
+  private:
+	Vec3<int> size;
+	std::vector<std::atomic<uint16_t>> edges;
+};
+
+// The tiles of a map, made a chunk at a time the first time a tile of the chunk is asked for, so
+// that the parts of a map nothing goes to (like most of the air above a city) only take a pointer
+// for each chunk. Tiles can be asked for from any thread, as searches running on other threads
+// do, and once made they stay where they are until the whole map goes
+class TileStore
+{
+  public:
+	// Chunks are this many tiles by this many on one level
+	static const int CHUNK_SIZE = 8;
+
+	TileStore(Vec3<int> size);
+	~TileStore();
+
+	// The tile at position, which must be on the map, or nullptr if its chunk wasn't made yet
+	Tile *find(Vec3<int> position) const
+	{
+		auto chunk = chunks[getChunkIndex(position)].load(std::memory_order_acquire);
+		return chunk ? &chunk->at(position) : nullptr;
+	}
+	// The tile at position, which must be on the map, making its chunk if needed
+	Tile &get(TileMap &map, Vec3<int> position)
+	{
+		int index = getChunkIndex(position);
+		auto chunk = chunks[index].load(std::memory_order_acquire);
+		if (!chunk)
+		{
+			chunk = makeChunk(map, index);
+		}
+		return chunk->at(position);
+	}
+	size_t count() const
+	{
+		size_t tileCount = 0;
+		for (auto &chunk : chunks)
+		{
+			auto c = chunk.load(std::memory_order_acquire);
+			tileCount += c ? c->tiles.size() : 0;
+		}
+		return tileCount;
+	}
+	// Calls fn with every tile made so far, level by level from the bottom
+	template <typename F> void forEach(F fn)
+	{
+		for (auto &chunk : chunks)
+		{
+			auto c = chunk.load(std::memory_order_acquire);
+			if (c)
+			{
+				for (auto &tile : c->tiles)
+				{
+					fn(tile);
+				}
+			}
+		}
+	}
+
+  private:
+	class Chunk
+	{
+	  public:
+		Vec2<int> origin;
+		int width = 0;
+		// Row by row from origin
+		std::vector<Tile> tiles;
+
+		Tile &at(Vec3<int> position)
+		{
+			return tiles[(position.y - origin.y) * width + position.x - origin.x];
+		}
+	};
+	Vec3<int> size;
+	Vec2<int> chunkCount;
+	std::vector<std::atomic<Chunk *>> chunks;
+
+	int getChunkIndex(Vec3<int> position) const
+	{
+		return (position.z * chunkCount.y + position.y / CHUNK_SIZE) * chunkCount.x +
+		       position.x / CHUNK_SIZE;
+	}
+	Chunk *makeChunk(TileMap &map, int index);
+};
+
 class TileMap
 {
   private:
-	std::vector<Tile> tiles;
+	TileStore tiles;
+	// What every tile that wasn't made yet reads as, at no position on the map
+	up<Tile> emptyTile;
+	// By z, then y, then x
+	std::vector<TileNavigation> navigation;
 	std::vector<std::set<TileObject::Type>> layerMap;
+	// Reused between findShortestPath calls
+	up<PathfindingArena> pathfindingArena;
+	unsigned int collisionRevision = 0;
+	unsigned int visionRevision = 0;
+	unsigned int sceneryRevision = 0;
+	// Revision of what is drawn on each chunk, see getDrawRevision
+	std::vector<unsigned int> drawRevisions;
+	// Shadows that moved since they were last placed, see placeShadows. Expired and already placed
+	// ones are only dropped once the list gets to shadowsPruneSize
+	std::vector<wp<TileObjectShadow>> movedShadows;
+	size_t shadowsPruneSize = 64;
+	// Throws solved since collisionRevision last changed, by thrower, start, target and starting
+	// XY velocity
+	using ThrowKey = std::tuple<const TileObject *, Vec3<float>, Vec3<int>, float>;
+	mutable std::map<ThrowKey, ThrowSolution> throwSolutions;
+	mutable unsigned int throwSolutionsRevision = 0;
+	// Counted from whichever thread the lines go through on
+	mutable std::atomic<unsigned long long> collisionCount{0};
+	// By the key of the kind of mover each is for
+	std::map<unsigned int, up<TileEdgeCache>> edgeCaches;
+	// Work counted on each tile, by kind and then in the same order as tiles, see addHeat. Only
+	// made once recording first starts, and counted from whichever thread does the work
+	std::vector<up<std::atomic<unsigned int>[]>> heat;
+	std::atomic<bool> heatRecording{false};
+	void addHeatAt(int kind, Vec3<int> tile) const;
+	// Battle units and items by the position of the tile that owns them, kept up to date by
+	// TileObject as they move, see forEachUnitOrItemIn
+	SpatialHash<sp<TileObject>> unitsAndItems{8.0f};
+	// findCollision with the tiles passed appended to passedTiles instead of options.passedTiles
+	Collision findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
+	                        const CollisionOptions &options,
+	                        std::vector<Vec3<int>> *passedTiles) const;
 
   public:
 	const Tile *getTile(int x, int y, int z) const
@@ -84,7 +271,8 @@ class TileMap
 			LogError("Incorrect tile coordinates (const) %d,%d,%d", x, y, z);
 			return nullptr;
 		}
-		return &this->tiles[z * size.x * size.y + y * size.x + x];
+		auto tile = this->tiles.find({x, y, z});
+		return tile ? tile : emptyTile.get();
 	}
 	Tile *getTile(int x, int y, int z)
 	{
@@ -93,7 +281,7 @@ class TileMap
 			LogError("Incorrect tile coordinates %d,%d,%d", x, y, z);
 			return nullptr;
 		}
-		return &this->tiles[z * size.x * size.y + y * size.x + x];
+		return &this->tiles.get(*this, {x, y, z});
 	}
 	Tile *getTile(Vec3<int> pos) { return this->getTile(pos.x, pos.y, pos.z); }
 	const Tile *getTile(Vec3<int> pos) const { return this->getTile(pos.x, pos.y, pos.z); }
@@ -108,6 +296,23 @@ class TileMap
 		return this->getTile(static_cast<int>(pos.x), static_cast<int>(pos.y),
 		                     static_cast<int>(pos.z));
 	}
+	// What pathfinding looks at on the tile, which must be on the map
+	const TileNavigation &getNavigation(int x, int y, int z) const
+	{
+		return this->navigation[z * size.x * size.y + y * size.x + x];
+	}
+	const TileNavigation &getNavigation(Vec3<int> pos) const
+	{
+		return this->getNavigation(pos.x, pos.y, pos.z);
+	}
+	// Called by tiles whenever anything getNavigation() has for them changes
+	void updateNavigation(const Tile &tile);
+	// The cache of steps for the kind of mover key stands for, made the first time it is asked
+	// for. Must not be called while searches run on other threads
+	TileEdgeCache &getEdgeCache(unsigned int key);
+	// How far from a changed tile, on any axis, the steps of any mover could have looked at it
+	static const int EDGE_CACHE_REACH = 3;
+
 	Vec3<int> size;
 	Vec3<int> voxelMapSize;
 	Vec3<float> velocityScale;
@@ -118,34 +323,153 @@ class TileMap
 	~TileMap();
 
 	// Path to target area (bounds are exclusive)
+	// Searches use the map's own scratch storage unless an arena is supplied, so calls from
+	// threads other than the main one must supply their own
 	std::list<Vec3<int>> findShortestPath(Vec3<int> origin, Vec3<int> destinationStart,
 	                                      Vec3<int> destinationEnd, int iterationLimit,
 	                                      const CanEnterTileHelper &canEnterTile,
 	                                      bool approachOnly = false, bool ignoreStaticUnits = false,
 	                                      bool ignoreMovingUnits = true,
 	                                      bool ignoreAllUnits = false, float *cost = nullptr,
-	                                      float maxCost = 0.0f);
+	                                      float maxCost = 0.0f, PathfindingArena *arena = nullptr);
+	// Number of tiles expanded by searches that used the map's own scratch storage
+	unsigned long long getPathfindingExpansionCount() const;
 	// Path to target position
 	std::list<Vec3<int>>
 	findShortestPath(Vec3<int> origin, Vec3<int> destination, unsigned int iterationLimit,
 	                 const CanEnterTileHelper &canEnterTile, bool approachOnly = false,
 	                 bool ignoreStaticUnits = false, bool ignoreMovingUnits = true,
-	                 bool ignoreAllUnits = false, float *cost = nullptr, float maxCost = 0.0f)
+	                 bool ignoreAllUnits = false, float *cost = nullptr, float maxCost = 0.0f,
+	                 PathfindingArena *arena = nullptr)
 	{
 		return findShortestPath(origin, destination, destination + Vec3<int>{1, 1, 1},
 		                        iterationLimit, canEnterTile, approachOnly, ignoreStaticUnits,
-		                        ignoreMovingUnits, ignoreAllUnits, cost, maxCost);
+		                        ignoreMovingUnits, ignoreAllUnits, cost, maxCost, arena);
 	}
 
 	Collision findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
-	                        const std::set<TileObject::Type> validTypes = {},
+	                        const CollisionOptions &options) const;
+	// Same as findCollision for every segment, with the segments spread over the thread pool,
+	// leaving a result for each in collisions and, if given, the tiles each passed in
+	// passedTiles. Both keep their memory from one call to the next, for callers to reuse them.
+	// Nothing on the map may change until it returns
+	void findCollisions(const std::vector<std::pair<Vec3<float>, Vec3<float>>> &lineSegments,
+	                    const CollisionOptions &options, std::vector<Collision> &collisions,
+	                    std::vector<std::vector<Vec3<int>>> *passedTiles = nullptr) const;
+	Collision findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd,
+	                        const std::set<TileObject::Type> &validTypes = {},
 	                        sp<TileObject> ignoredObject = nullptr, bool useLOS = false,
 	                        bool check_full_path = false, unsigned maxRange = 0,
-	                        bool recordPassedTiles = false,
+	                        std::vector<Vec3<int>> *passedTiles = nullptr,
 	                        StateRef<Organisation> ignoreOwnedProjectiles = nullptr) const;
 
+	// Calls visit(object) for every battle unit and item tile object owned by a tile from min to
+	// max (inclusive), without going through every one on the map
+	template <typename F> void forEachUnitOrItemIn(Vec3<int> min, Vec3<int> max, F visit) const
+	{
+		unitsAndItems.forEachIn({(float)min.x, (float)min.y}, {(float)max.x, (float)max.y},
+		                        [&](const sp<TileObject> &object) {
+			                        auto position = object->getOwningTile()->position;
+			                        if (position.x >= min.x && position.y >= min.y &&
+			                            position.z >= min.z && position.x <= max.x &&
+			                            position.y <= max.y && position.z <= max.z)
+			                        {
+				                        visit(object);
+			                        }
+		                        });
+	}
+	// Same for every one whose position is within radius of centre
+	template <typename F> void forEachUnitOrItemNear(Vec3<float> centre, float radius, F visit) const
+	{
+		Vec3<int> min = {(int)std::floor(centre.x - radius), (int)std::floor(centre.y - radius),
+		                 (int)std::floor(centre.z - radius)};
+		Vec3<int> max = {(int)std::floor(centre.x + radius), (int)std::floor(centre.y + radius),
+		                 (int)std::floor(centre.z + radius)};
+		forEachUnitOrItemIn(min, max, [&](const sp<TileObject> &object) {
+			auto offset = object->getPosition() - centre;
+			if (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z <=
+			    radius * radius)
+			{
+				visit(object);
+			}
+		});
+	}
+	// Called by battle units and items as they start or stop being owned by a tile
+	void addUnitOrItem(const sp<TileObject> &object, Vec3<int> position)
+	{
+		unitsAndItems.insert(Vec3<float>{position}, object);
+	}
+	void removeUnitOrItem(const sp<TileObject> &object, Vec3<int> position)
+	{
+		if (!unitsAndItems.erase(Vec3<float>{position}, object))
+		{
+			LogError("Unit or item at %s was not in the index", position);
+		}
+	}
+
+	// Number of tiles made so far, see TileStore
+	size_t getTileCount() const { return tiles.count(); }
+	// Number of lines findCollision went along since the map was made
+	unsigned long long getCollisionCount() const { return collisionCount.load(); }
+
+	// Work counted by the tile it is done on while heat is recorded, for views to draw where on
+	// the map the time goes
+	enum class HeatKind
+	{
+		PathfindingNodes,
+		LineTiles,
+		VisionRefreshes,
+	};
+	static const int HEAT_KIND_COUNT = 3;
+	void setHeatRecording(bool record);
+	bool isRecordingHeat() const { return heatRecording.load(std::memory_order_acquire); }
+	void addHeat(HeatKind kind, Vec3<int> tile) const
+	{
+		if (isRecordingHeat())
+		{
+			addHeatAt((int)kind, tile);
+		}
+	}
+	// Counts of every tile since the last call, which leaves them at 0 for the next
+	std::vector<unsigned int> takeHeat(HeatKind kind);
+	// Return if an object of one of validTypes (any if 0) fills the voxel at this point, which is
+	// measured in voxels from the start of the map
+	bool getVoxelFilled(Vec3<int> point, TileObject::TypeMask validTypes, bool useLOS) const;
+
 	bool checkThrowTrajectory(const sp<TileObject> thrower, Vec3<float> start, Vec3<int> end,
 	                          Vec3<float> targetVectorXY, float velocityXY, float velocityZ) const;
+	// Must be called whenever anything a line going through the map could hit appears, moves,
+	// changes shape or goes away, so that results worked out from collisions are thrown away
+	void notifyCollisionChange() { collisionRevision++; }
+	// Must be called whenever map parts or anything else that can block a unit's vision change,
+	// lines of sight checked while the revision is the same are going to end the same way
+	void notifyVisionChange() { visionRevision++; }
+	unsigned int getVisionRevision() const { return visionRevision; }
+	// Must be called whenever city scenery appears, moves or goes away. Unlike the collision
+	// revision this one stays the same while only vehicles and projectiles move
+	void notifySceneryChange() { sceneryRevision++; }
+	unsigned int getSceneryRevision() const { return sceneryRevision; }
+	// Tiles are grouped in chunks of this many by this many on every level, so that views can tell
+	// what changed on the map since they last drew it
+	static const int DRAW_CHUNK_SIZE = TileStore::CHUNK_SIZE;
+	// Must be called whenever an object starts or stops being drawn on the tile at position, or
+	// changes the way it looks, so that views draw the chunk the tile is in again
+	void notifyDrawnChange(Vec3<int> position);
+	// Shadows take a collision check down to the ground every time their owner moves, so they are
+	// only placed once the area is drawn: views must call this before drawing the tiles from min
+	// to max (exclusive). Shadows elsewhere stay off the map until then
+	void placeShadows(Vec2<int> min, Vec2<int> max);
+	// Called by a shadow the first time its owner moves after it was placed
+	void queueShadow(sp<TileObjectShadow> shadow);
+	// Changes every time anything drawn on the chunk changes, chunk being measured in chunks
+	unsigned int getDrawRevision(Vec3<int> chunk) const;
+	Vec3<int> getDrawChunkCount() const;
+	// Returns the solution stored for this throw, or nullptr if it was never stored or the map
+	// changed since
+	const ThrowSolution *getThrowSolution(const TileObject *thrower, Vec3<float> start,
+	                                      Vec3<int> end, float velocityXY) const;
+	void storeThrowSolution(const TileObject *thrower, Vec3<float> start, Vec3<int> end,
+	                        float velocityXY, const ThrowSolution &solution) const;
 
 	void addObjectToMap(sp<Projectile>);
 	void addObjectToMap(GameState &state, sp<Vehicle>);
@@ -167,7 +491,10 @@ class TileMap
 	void updateAllBattlescapeInfo();
 	void updateAllCityInfo();
 
-	std::map<Vec3<int>, std::list<Vec3<int>>> agentPathCache;
+	// Routes of agents walking between buildings
+	up<TileRoutingTable> agentRouting;
+	// Forget cached routes a change at this position could have affected
+	void invalidatePathCaches(Vec3<int> position);
 	void clearPathCaches();
 };
 }; // namespace OpenApoc
@@ -10,7 +10,7 @@ namespace OpenApoc
 {
 
 TileObject::TileObject(TileMap &map, Type type, Vec3<float> bounds)
-    : map(map), type(type), owningTile(nullptr), name("UNKNOWN_OBJECT")
+    : map(map), type(type), owningTile(nullptr), drawOnTile(nullptr), name("UNKNOWN_OBJECT")
 {
 	setBounds(bounds);
 }
@@ -35,6 +35,19 @@ void TileObject::drawTinted(Renderer &r, sp<Image> sprite, Vec2<float> position,
 	}
 }
 
+void TileObject::addTinted(RendererSpriteBatch &batch, Image *sprite, Vec2<float> position,
+                           bool visible)
+{
+	if (visible)
+	{
+		batch.add(sprite, position);
+	}
+	else
+	{
+		batch.add(sprite, position, COLOUR_BLACK);
+	}
+}
+
 void TileObject::removeFromMap()
 {
 	auto thisPtr = shared_from_this();
@@ -46,37 +59,66 @@ void TileObject::removeFromMap()
 		{
 			LogError("Nothing erased?");
 		}
-		int layer = map.getLayer(this->type);
-		this->drawOnTile->drawnObjects[layer].erase(
-		    std::remove(this->drawOnTile->drawnObjects[layer].begin(),
-		                this->drawOnTile->drawnObjects[layer].end(), thisPtr),
-		    this->drawOnTile->drawnObjects[layer].end());
+		if (isUnitOrItem())
+		{
+			map.removeUnitOrItem(thisPtr, this->owningTile->position);
+		}
+		removeFromDrawnTiles();
 		this->owningTile = nullptr;
 	}
+	if (this->countedWithVoxelMapLOF && !this->intersectingTiles.empty())
+	{
+		map.notifyCollisionChange();
+	}
 	for (auto *tile : this->intersectingTiles)
 	{
 		tile->intersectingObjects.erase(thisPtr);
+		tile->voxelObjectsLOF -= this->countedWithVoxelMapLOF ? 1 : 0;
+		tile->voxelObjectsLOS -= this->countedWithVoxelMapLOS ? 1 : 0;
 	}
 	this->intersectingTiles.clear();
 }
 
-namespace
+void TileObject::removeFromDrawnTiles()
 {
-class TileObjectZComparer
+	int layer = map.getLayer(this->type);
+	auto &drawnObjects = this->drawOnTile->drawnObjects[layer];
+	// The objects are sorted by drawOrder, so it is among those with the same one
+	auto it = std::lower_bound(
+	    drawnObjects.begin(), drawnObjects.end(), this->drawOrder,
+	    [](const sp<TileObject> &lhs, float rhs) { return lhs->drawOrder < rhs; });
+	while (it != drawnObjects.end() && it->get() != this)
+	{
+		++it;
+	}
+	if (it == drawnObjects.end())
+	{
+		LogError("Object not found among the objects drawn on its tile");
+	}
+	else
+	{
+		drawnObjects.erase(it);
+	}
+	map.notifyDrawnChange(this->drawOnTile->position);
+}
+
+void TileObject::notifyDrawnChange()
 {
-  public:
-	bool operator()(const sp<TileObject> &lhs, const sp<TileObject> &rhs) const
+	if (this->drawOnTile)
 	{
-		float lhsZ = lhs->getCenter().x * lhs->map.velocityScale.x +
-		             lhs->getCenter().y * lhs->map.velocityScale.y +
-		             lhs->getZOrder() * lhs->map.velocityScale.z;
-		float rhsZ = rhs->getCenter().x * rhs->map.velocityScale.x +
-		             rhs->getCenter().y * rhs->map.velocityScale.y +
-		             rhs->getZOrder() * rhs->map.velocityScale.z;
-		return (lhsZ < rhsZ);
+		map.notifyDrawnChange(this->drawOnTile->position);
 	}
-};
-} // anonymous namespace
+}
+
+TileObject::TypeMask TileObject::getTypeMask(const std::set<Type> &types)
+{
+	TypeMask mask = 0;
+	for (auto type : types)
+	{
+		mask |= getTypeMask(type);
+	}
+	return mask;
+}
 
 float TileObject::getDistanceTo(sp<TileObject> target) const
 {
@@ -105,6 +147,28 @@ void TileObject::setPosition(Vec3<float> newPosition)
 		newPosition.z = clamp(newPosition.z, 0.0f, (float)map.size.z + 1);
 		LogWarning("Clamped object to %s", newPosition);
 	}
+	Vec3<int> minBounds = {floorf(newPosition.x + getCenterOffset().x - this->bounds_div_2.x),
+	                       floorf(newPosition.y + getCenterOffset().y - this->bounds_div_2.y),
+	                       floorf(newPosition.z + getCenterOffset().z - this->bounds_div_2.z)};
+	Vec3<int> maxBounds = {ceilf(newPosition.x + getCenterOffset().x + this->bounds_div_2.x),
+	                       ceilf(newPosition.y + getCenterOffset().y + this->bounds_div_2.y),
+	                       ceilf(newPosition.z + getCenterOffset().z + this->bounds_div_2.z)};
+
+	// Still in the same tiles, so all that can change is how it is drawn within them
+	if (this->owningTile && this->owningTile == map.getTile(newPosition) &&
+	    minBounds == intersectingMin && maxBounds == intersectingMax &&
+	    this->countedWithVoxelMapLOF == this->hasVoxelMap(false) &&
+	    this->countedWithVoxelMapLOS == this->hasVoxelMap(true))
+	{
+		if (this->countedWithVoxelMapLOF && !this->intersectingTiles.empty())
+		{
+			map.notifyCollisionChange();
+		}
+		removeFromDrawnTiles();
+		addToDrawnTiles(owningTile);
+		return;
+	}
+
 	this->removeFromMap();
 
 	this->owningTile = map.getTile(newPosition);
@@ -119,14 +183,19 @@ void TileObject::setPosition(Vec3<float> newPosition)
 	{
 		LogError("Object already in owned object list?");
 	}
+	if (isUnitOrItem())
+	{
+		map.addUnitOrItem(thisPtr, this->owningTile->position);
+	}
 
-	Vec3<int> minBounds = {floorf(newPosition.x + getCenterOffset().x - this->bounds_div_2.x),
-	                       floorf(newPosition.y + getCenterOffset().y - this->bounds_div_2.y),
-	                       floorf(newPosition.z + getCenterOffset().z - this->bounds_div_2.z)};
-	Vec3<int> maxBounds = {ceilf(newPosition.x + getCenterOffset().x + this->bounds_div_2.x),
-	                       ceilf(newPosition.y + getCenterOffset().y + this->bounds_div_2.y),
-	                       ceilf(newPosition.z + getCenterOffset().z + this->bounds_div_2.z)};
-
+	intersectingMin = minBounds;
+	intersectingMax = maxBounds;
+	this->countedWithVoxelMapLOF = this->hasVoxelMap(false);
+	this->countedWithVoxelMapLOS = this->hasVoxelMap(true);
+	if (this->countedWithVoxelMapLOF)
+	{
+		map.notifyCollisionChange();
+	}
 	for (int x = minBounds.x; x < maxBounds.x; x++)
 	{
 		for (int y = minBounds.y; y < maxBounds.y; y++)
@@ -147,6 +216,8 @@ void TileObject::setPosition(Vec3<float> newPosition)
 				}
 				this->intersectingTiles.push_back(intersectingTile);
 				intersectingTile->intersectingObjects.insert(thisPtr);
+				intersectingTile->voxelObjectsLOF += this->countedWithVoxelMapLOF ? 1 : 0;
+				intersectingTile->voxelObjectsLOS += this->countedWithVoxelMapLOS ? 1 : 0;
 			}
 		}
 	}
@@ -166,9 +237,16 @@ void TileObject::addToDrawnTiles(Tile *tile)
 {
 	this->drawOnTile = tile;
 	int layer = map.getLayer(this->type);
-	this->drawOnTile->drawnObjects[layer].push_back(shared_from_this());
-	std::sort(this->drawOnTile->drawnObjects[layer].begin(),
-	          this->drawOnTile->drawnObjects[layer].end(), TileObjectZComparer{});
+	auto center = this->getCenter();
+	this->drawOrder = center.x * map.velocityScale.x + center.y * map.velocityScale.y +
+	                  this->getZOrder() * map.velocityScale.z;
+	// Goes after any already there with the same drawOrder, so those keep the order they had
+	auto &drawnObjects = this->drawOnTile->drawnObjects[layer];
+	auto it = std::upper_bound(
+	    drawnObjects.begin(), drawnObjects.end(), this->drawOrder,
+	    [](float lhs, const sp<TileObject> &rhs) { return lhs < rhs->drawOrder; });
+	drawnObjects.insert(it, shared_from_this());
+	map.notifyDrawnChange(this->drawOnTile->position);
 }
 
 } // namespace OpenApoc
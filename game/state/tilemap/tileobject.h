@@ -3,12 +3,15 @@
 #include "library/sp.h"
 #include "library/strings.h"
 #include "library/vec.h"
+#include <cstdint>
+#include <set>
 #include <vector>
 
 namespace OpenApoc
 {
 
 class Renderer;
+class RendererSpriteBatch;
 class TileMap;
 class Tile;
 class VoxelMap;
@@ -39,11 +42,28 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 		Hazard,
 	};
 
+	// Set of types, with one bit per type
+	using TypeMask = uint32_t;
+	static constexpr TypeMask getTypeMask(Type type)
+	{
+		return TypeMask{1} << static_cast<unsigned>(type);
+	}
+	static TypeMask getTypeMask(const std::set<Type> &types);
+
 	/* 'screenPosition' is where the center of the object should be drawn */
 	virtual void draw(Renderer &r, TileTransform &transform, Vec2<float> screenPosition,
 	                  TileViewMode mode, bool visible = true, int currentLevel = 0,
 	                  bool friendly = false, bool hostile = false) = 0;
+	// Adds what draw() would draw to batch and returns true, for objects that only ever draw
+	// sprites, so views can draw many of them at once. Others return false and add nothing
+	virtual bool addSprites(RendererSpriteBatch & /*batch*/, Vec2<float> /*screenPosition*/,
+	                        TileViewMode /*mode*/, bool /*visible*/)
+	{
+		return false;
+	}
 	const Type &getType() const { return this->type; }
+	// Whether the map keeps the object in its index of battle units and items
+	bool isUnitOrItem() const { return type == Type::Unit || type == Type::Item; }
 	virtual Vec3<float> getPosition() const = 0;
 	// Vector from object position to object center
 	virtual Vec3<float> getCenterOffset() const { return {0.0f, 0.0f, 0.0f}; }
@@ -64,6 +84,8 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 	virtual void setPosition(Vec3<float> newPosition);
 	virtual void removeFromMap();
 	virtual void addToDrawnTiles(Tile *tile);
+	// Must be called when the object changes the way it looks without moving
+	void notifyDrawnChange();
 
 	Tile *getOwningTile() const { return this->owningTile; }
 	std::vector<Tile *> getIntersectingTiles() const { return this->intersectingTiles; }
@@ -82,6 +104,8 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 	TileMap &map;
 
 	static void drawTinted(Renderer &r, sp<Image> sprite, Vec2<float> position, bool visible);
+	static void addTinted(RendererSpriteBatch &batch, Image *sprite, Vec2<float> position,
+	                      bool visible);
 
 	// TileObjects are not copy-able
 	TileObject(const TileObject &) = delete;
@@ -95,7 +119,18 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 
 	Tile *owningTile;
 	Tile *drawOnTile;
+	// Where it is drawn among the objects of its layer on drawOnTile, lowest first, as worked out
+	// when it was added there. Kept so the rest of the tile's objects need not be sorted again
+	float drawOrder = 0.0f;
 	std::vector<Tile *> intersectingTiles;
+	// What the intersecting tiles counted this as in voxelObjectsLOF / voxelObjectsLOS, kept as
+	// what is needed to take it back out may no longer be there when it is removed
+	bool countedWithVoxelMapLOF = false;
+	bool countedWithVoxelMapLOS = false;
+	// Range of intersectingTiles, from min inclusive to max exclusive, for setPosition to tell
+	// whether the object stays in the same tiles
+	Vec3<int> intersectingMin = {0, 0, 0};
+	Vec3<int> intersectingMax = {0, 0, 0};
 
 	TileObject(TileMap &map, Type type, Vec3<float> bounds);
 
@@ -110,6 +145,7 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 	UString name;
 
   private:
+	void removeFromDrawnTiles();
 };
 
 } // namespace OpenApoc
@@ -77,4 +77,25 @@ Vec3<float> TileObjectBattleHazard::getPosition() const
 
 float TileObjectBattleHazard::getZOrder() const { return getPosition().z - 7.0f; }
 
+void TileObjectBattleHazard::setPosition(Vec3<float> newPosition)
+{
+	TileObject::setPosition(newPosition);
+
+	if (owningTile)
+	{
+		owningTile->presentHazard =
+		    std::static_pointer_cast<TileObjectBattleHazard>(shared_from_this());
+	}
+}
+
+void TileObjectBattleHazard::removeFromMap()
+{
+	if (owningTile && owningTile->presentHazard.get() == this)
+	{
+		owningTile->presentHazard = nullptr;
+	}
+
+	TileObject::removeFromMap();
+}
+
 } // namespace OpenApoc
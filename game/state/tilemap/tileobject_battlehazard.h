@@ -18,6 +18,8 @@ class TileObjectBattleHazard : public TileObject
 	sp<BattleHazard> getHazard();
 	Vec3<float> getPosition() const override;
 	float getZOrder() const override;
+	void setPosition(Vec3<float> newPosition) override;
+	void removeFromMap() override;
 
   private:
 	friend class TileMap;
@@ -12,9 +12,17 @@ void TileObjectBattleMapPart::draw(Renderer &r, TileTransform &transform,
                                    bool, bool)
 {
 	std::ignore = transform;
+	RendererSpriteBatch batch(r);
+	addSprites(batch, screenPosition, mode, visible);
+}
+
+bool TileObjectBattleMapPart::addSprites(RendererSpriteBatch &batch, Vec2<float> screenPosition,
+                                         TileViewMode mode, bool visible)
+{
 	// Mode isn't used as TileView::tileToScreenCoords already transforms according to the mode
 	auto &type = map_part->type;
-	sp<Image> sprite;
+	// Not a shared pointer, as this is done for every map part on screen every frame
+	Image *sprite = nullptr;
 	Vec2<float> transformedScreenPos = screenPosition;
 	switch (mode)
 	{
@@ -23,19 +31,19 @@ void TileObjectBattleMapPart::draw(Renderer &r, TileTransform &transform,
 			int frame = map_part->getAnimationFrame();
 			if (frame == -1)
 			{
-				sprite = type->sprite;
+				sprite = type->sprite.get();
 			}
 			else
 			{
 				auto &curType =
 				    map_part->alternative_type ? map_part->alternative_type : map_part->type;
-				sprite = curType->animation_frames[frame];
+				sprite = curType->animation_frames[frame].get();
 			}
 			transformedScreenPos -= type->imageOffset;
 			break;
 		}
 		case TileViewMode::Strategy:
-			sprite = type->strategySprite;
+			sprite = type->strategySprite.get();
 			// All strategy sprites so far are 8x8 so offset by 4 to draw from the center
 			// FIXME: Not true for large sprites (2x2 UFOs?)
 			if (sprite)
@@ -48,8 +56,9 @@ void TileObjectBattleMapPart::draw(Renderer &r, TileTransform &transform,
 	}
 	if (sprite)
 	{
-		drawTinted(r, sprite, transformedScreenPos, visible);
+		addTinted(batch, sprite, transformedScreenPos, visible);
 	}
+	return true;
 }
 
 TileObject::Type TileObjectBattleMapPart::convertType(BattleMapPartType::Type type)
@@ -14,6 +14,8 @@ class TileObjectBattleMapPart : public TileObject
   public:
 	void draw(Renderer &r, TileTransform &transform, Vec2<float> screenPosition, TileViewMode mode,
 	          bool visible, int, bool, bool) override;
+	bool addSprites(RendererSpriteBatch &batch, Vec2<float> screenPosition, TileViewMode mode,
+	                bool visible) override;
 	~TileObjectBattleMapPart() override;
 
 	// For faster rendering, sp is better than wp
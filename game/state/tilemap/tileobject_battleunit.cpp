@@ -259,10 +259,6 @@ void TileObjectBattleUnit::setPosition(Vec3<float> newPosition)
 	occupiedTiles.clear();
 
 	TileObject::setPosition(newPosition);
-	for (auto &t : intersectingTiles)
-	{
-		t->updateBattlescapeUnitPresent();
-	}
 
 	auto pos = owningTile->position;
 
@@ -323,6 +319,12 @@ void TileObjectBattleUnit::setPosition(Vec3<float> newPosition)
 			occupiedTiles.insert(pos);
 		}
 	}
+
+	// Once the tiles it occupies are known, as the tiles keep track of who occupies them
+	for (auto &t : intersectingTiles)
+	{
+		t->updateBattlescapeUnitPresent();
+	}
 }
 
 void TileObjectBattleUnit::addToDrawnTiles(Tile *tile)
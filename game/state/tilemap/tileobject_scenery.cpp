@@ -17,27 +17,35 @@ void TileObjectScenery::draw(Renderer &r, TileTransform &transform, Vec2<float>
                              TileViewMode mode, bool visible, int, bool, bool)
 {
 	std::ignore = transform;
+	RendererSpriteBatch batch(r);
+	addSprites(batch, screenPosition, mode, visible);
+}
+
+bool TileObjectScenery::addSprites(RendererSpriteBatch &batch, Vec2<float> screenPosition,
+                                   TileViewMode mode, bool visible)
+{
 	// Mode isn't used as TileView::tileToScreenCoords already transforms according to the mode
 	auto scenery = this->scenery.lock();
 	if (!scenery)
 	{
 		LogError("Called with no owning scenery object");
-		return;
+		return true;
 	}
 	// FIXME: If damaged use damaged tile sprites?
 	auto &type = scenery->type;
-	sp<Image> sprite;
-	sp<Image> overlaySprite;
+	// Not shared pointers, as this is done for every scenery tile on screen every frame
+	Image *sprite = nullptr;
+	Image *overlaySprite = nullptr;
 	Vec2<float> transformedScreenPos = screenPosition;
 	switch (mode)
 	{
 		case TileViewMode::Isometric:
-			sprite = type->sprite;
-			overlaySprite = type->overlaySprite;
+			sprite = type->sprite.get();
+			overlaySprite = type->overlaySprite.get();
 			transformedScreenPos -= type->imageOffset;
 			break;
 		case TileViewMode::Strategy:
-			sprite = type->strategySprite;
+			sprite = type->strategySprite.get();
 			// All strategy sprites so far are 8x8 so offset by 4 to draw from the center
 			// FIXME: Not true for large sprites (2x2 UFOs?)
 			if (sprite)
@@ -52,11 +60,11 @@ void TileObjectScenery::draw(Renderer &r, TileTransform &transform, Vec2<float>
 	{
 		if (visible)
 		{
-			r.draw(sprite, transformedScreenPos);
+			batch.add(sprite, transformedScreenPos);
 		}
 		else
 		{
-			r.drawTinted(sprite, transformedScreenPos, COLOUR_TRANSPARENT_BLACK);
+			batch.add(sprite, transformedScreenPos, COLOUR_TRANSPARENT_BLACK);
 		}
 	}
 	// FIXME: Should be drawn at 'later' Z than scenery (IE on top of any vehicles on tile?)
@@ -64,13 +72,14 @@ void TileObjectScenery::draw(Renderer &r, TileTransform &transform, Vec2<float>
 	{
 		if (visible)
 		{
-			r.draw(overlaySprite, transformedScreenPos);
+			batch.add(overlaySprite, transformedScreenPos);
 		}
 		else
 		{
-			r.drawTinted(overlaySprite, transformedScreenPos, COLOUR_TRANSPARENT_BLACK);
+			batch.add(overlaySprite, transformedScreenPos, COLOUR_TRANSPARENT_BLACK);
 		}
 	}
+	return true;
 }
 
 TileObjectScenery::~TileObjectScenery() = default;
@@ -115,8 +124,13 @@ float TileObjectScenery::getZOrder() const
 
 void TileObjectScenery::setPosition(Vec3<float> newPosition)
 {
+	auto prevOwningTile = owningTile;
 	TileObject::setPosition(newPosition);
-	map.clearPathCaches();
+	if (prevOwningTile)
+	{
+		map.invalidatePathCaches(prevOwningTile->position);
+	}
+	map.invalidatePathCaches(owningTile->position);
 	owningTile->updateCityscapeParameters();
 }
 
@@ -129,6 +143,7 @@ void TileObjectScenery::removeFromMap()
 
 	if (requireRecalc)
 	{
+		map.invalidatePathCaches(prevOwningTile->position);
 		prevOwningTile->updateCityscapeParameters();
 	}
 }
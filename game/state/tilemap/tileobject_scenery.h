@@ -14,6 +14,8 @@ class TileObjectScenery : public TileObject
   public:
 	void draw(Renderer &r, TileTransform &transform, Vec2<float> screenPosition, TileViewMode mode,
 	          bool visible, int, bool, bool) override;
+	bool addSprites(RendererSpriteBatch &batch, Vec2<float> screenPosition, TileViewMode mode,
+	                bool visible) override;
 	~TileObjectScenery() override;
 
 	wp<Scenery> scenery;
@@ -100,15 +100,40 @@ void TileObjectShadow::addToDrawnTiles(Tile *tile)
 
 void TileObjectShadow::setPosition(Vec3<float> newPosition)
 {
-	static const std::set<TileObject::Type> mapPartSet = {
-	    TileObject::Type::Ground, TileObject::Type::LeftWall, TileObject::Type::RightWall,
-	    TileObject::Type::Feature, TileObject::Type::Scenery};
+	this->ownerPosition = newPosition;
+	if (this->moved)
+	{
+		return;
+	}
+	// Taken off the map until placed, so it isn't drawn where the owner has already left
+	TileObject::removeFromMap();
+	this->moved = true;
+	map.queueShadow(std::static_pointer_cast<TileObjectShadow>(shared_from_this()));
+}
+
+void TileObjectShadow::removeFromMap()
+{
+	this->moved = false;
+	TileObject::removeFromMap();
+}
+
+void TileObjectShadow::place()
+{
+	static const TileObject::TypeMask mapPartTypes =
+	    TileObject::getTypeMask(TileObject::Type::Ground) |
+	    TileObject::getTypeMask(TileObject::Type::LeftWall) |
+	    TileObject::getTypeMask(TileObject::Type::RightWall) |
+	    TileObject::getTypeMask(TileObject::Type::Feature) |
+	    TileObject::getTypeMask(TileObject::Type::Scenery);
 
 	// This projects a line downwards and draws places the shadow at the z of the first thing hit
 
+	this->moved = false;
+	auto newPosition = this->ownerPosition;
 	auto shadowPosition = newPosition;
-	auto c =
-	    map.findCollision(newPosition, Vec3<float>{newPosition.x, newPosition.y, -1}, mapPartSet);
+	CollisionOptions options;
+	options.validTypes = mapPartTypes;
+	auto c = map.findCollision(newPosition, Vec3<float>{newPosition.x, newPosition.y, -1}, options);
 	if (c)
 	{
 		shadowPosition.z = c.position.z;
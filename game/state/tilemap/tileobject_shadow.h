@@ -17,7 +17,10 @@ class TileObjectShadow : public TileObject
 	void draw(Renderer &r, TileTransform &transform, Vec2<float> screenPosition, TileViewMode mode,
 	          bool visible, int, bool, bool) override;
 	~TileObjectShadow() override;
+	// Only remembers where the owner went, the shadow is put on the map by place() once a view
+	// gets to draw where it is, see TileMap::placeShadows
 	void setPosition(Vec3<float> newPosition) override;
+	void removeFromMap() override;
 	Vec3<float> getPosition() const override;
 	void addToDrawnTiles(Tile *tile) override;
 
@@ -32,6 +35,12 @@ class TileObjectShadow : public TileObject
 	TileObjectShadow(TileMap &map, sp<BattleItem> item);
 	Vec3<float> shadowPosition;
 	bool fellOffTheBottomOfTheMap;
+	// Where the owner moved to since the shadow was last placed, if moved is set
+	Vec3<float> ownerPosition;
+	bool moved = false;
+
+	// Finds the ground below ownerPosition and puts the shadow there
+	void place();
 };
 
 } // namespace OpenApoc
@@ -0,0 +1,182 @@
+#include "game/state/tilemap/tileroutingtable.h"
+#include "framework/logger.h"
+#include "framework/metrics.h"
+#include "framework/trace.h"
+#include "game/state/tilemap/tilemap.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace OpenApoc
+{
+
+namespace
+{
+MetricCounter tablesBuilt("Tile routing", "tables built");
+MetricCounter routesWalked("Tile routing", "routes");
+} // anonymous namespace
+
+bool TileRoutingTable::getRoute(TileMap &map, const CanEnterTileHelper &canEnterTile,
+                                Vec3<int> origin, Vec3<int> destination,
+                                std::list<Vec3<int>> &route)
+{
+	if (!map.tileIsValid(origin) || !map.tileIsValid(destination))
+	{
+		return false;
+	}
+	auto &table = getTable(map, canEnterTile, destination);
+	auto index = [&map](Vec3<int> position) {
+		return (position.z * map.size.y + position.y) * map.size.x + position.x;
+	};
+	if (table.steps[index(origin)] == NO_STEP)
+	{
+		return false;
+	}
+	routesWalked.add();
+	// Every step gets strictly closer, this only guards against a broken table
+	int stepsLeft = (int)table.steps.size();
+	auto position = origin;
+	while (position != destination)
+	{
+		auto step = table.steps[index(position)];
+		if (step == NO_STEP || step == ARRIVED || stepsLeft-- == 0)
+		{
+			LogError("Broken tile routing table towards %s", destination);
+			return false;
+		}
+		position += Vec3<int>{step % 3 - 1, step / 3 % 3 - 1, step / 9 - 1};
+		route.push_back(position);
+	}
+	return true;
+}
+
+void TileRoutingTable::invalidate(const TileMap &map, Vec3<int> position)
+{
+	for (auto it = tables.begin(); it != tables.end();)
+	{
+		auto &steps = it->second.steps;
+		bool reached = false;
+		for (int y = std::max(0, position.y - 1);
+		     y <= std::min(map.size.y - 1, position.y + 1) && !reached; y++)
+		{
+			for (int x = std::max(0, position.x - 1);
+			     x <= std::min(map.size.x - 1, position.x + 1) && !reached; x++)
+			{
+				for (int z = 0; z < map.size.z; z++)
+				{
+					if (steps[(z * map.size.y + y) * map.size.x + x] != NO_STEP)
+					{
+						reached = true;
+						break;
+					}
+				}
+			}
+		}
+		if (reached)
+		{
+			recentlyUsed.erase(it->second.lastUse);
+			it = tables.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+void TileRoutingTable::clear()
+{
+	tables.clear();
+	recentlyUsed.clear();
+}
+
+TileRoutingTable::Table &TileRoutingTable::getTable(TileMap &map,
+                                                    const CanEnterTileHelper &canEnterTile,
+                                                    Vec3<int> destination)
+{
+	auto it = tables.find(destination);
+	if (it != tables.end())
+	{
+		recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second.lastUse);
+		return it->second;
+	}
+
+	while (tables.size() >= MAX_TABLES)
+	{
+		tables.erase(recentlyUsed.back());
+		recentlyUsed.pop_back();
+	}
+	auto &table = tables[destination];
+	build(map, canEnterTile, destination, table);
+	builds++;
+	tablesBuilt.add();
+	recentlyUsed.push_front(destination);
+	table.lastUse = recentlyUsed.begin();
+	return table;
+}
+
+void TileRoutingTable::build(TileMap &map, const CanEnterTileHelper &canEnterTile,
+                             Vec3<int> destination, Table &table) const
+{
+	TRACE_FN;
+	auto &size = map.size;
+	int count = size.x * size.y * size.z;
+	table.steps.assign(count, NO_STEP);
+	std::vector<float> costs(count, std::numeric_limits<float>::infinity());
+	auto index = [&size](Vec3<int> position) {
+		return (position.z * size.y + position.y) * size.x + position.x;
+	};
+
+	// Search backwards from destination, going to every tile a step into a reached one leaves
+	using Entry = std::pair<float, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> fringe;
+	costs[index(destination)] = 0.0f;
+	table.steps[index(destination)] = ARRIVED;
+	fringe.push({0.0f, index(destination)});
+	while (!fringe.empty())
+	{
+		auto entry = fringe.top();
+		fringe.pop();
+		if (entry.first > costs[entry.second])
+		{
+			continue;
+		}
+		Vec3<int> position = {entry.second % size.x, entry.second / size.x % size.y,
+		                      entry.second / (size.x * size.y)};
+		auto tile = map.getTile(position);
+		for (int step = 0; step < 27; step++)
+		{
+			if (step == ARRIVED)
+			{
+				continue;
+			}
+			Vec3<int> offset = {step % 3 - 1, step / 3 % 3 - 1, step / 9 - 1};
+			auto previous = position - offset;
+			if (!map.tileIsValid(previous))
+			{
+				continue;
+			}
+			int previousIndex = index(previous);
+			float cost = 0.0f;
+			bool jumped = false;
+			bool doorInTheWay = false;
+			if (costs[previousIndex] <= entry.first ||
+			    !canEnterTile.canEnterTile(map.getTile(previous), tile, false, jumped, cost,
+			                               doorInTheWay))
+			{
+				continue;
+			}
+			float newCost = entry.first + cost;
+			if (newCost < costs[previousIndex])
+			{
+				costs[previousIndex] = newCost;
+				table.steps[previousIndex] = static_cast<uint8_t>(step);
+				fringe.push({newCost, previousIndex});
+			}
+		}
+	}
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "library/vec.h"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class CanEnterTileHelper;
+class TileMap;
+
+// Next-step routing over the tiles of a map towards a few destinations movers keep going to, like
+// the crew quarters of the buildings agents walk between.
+//
+// For every destination asked about, one backwards search from it gives the next step from every
+// tile the destination can be reached from, so any later route there is only a walk along the
+// table. A change to a tile drops the tables that reached a tile in any of the columns around it,
+// as whether a tile can be entered may depend on what is above it. The least recently used tables
+// are dropped once there are more than MAX_TABLES of them. Every table must be filled by the same
+// kind of helper, as nothing tells them apart.
+class TileRoutingTable
+{
+  public:
+	static const unsigned int MAX_TABLES = 64;
+
+	// Append the tiles after origin up to and including destination to the route. Returns false
+	// if destination can't be reached from origin
+	bool getRoute(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> origin,
+	              Vec3<int> destination, std::list<Vec3<int>> &route);
+
+	// Must be called whenever whether a tile can be entered at this position could have changed
+	void invalidate(const TileMap &map, Vec3<int> position);
+	void clear();
+
+	unsigned int getBuilds() const { return builds; }
+
+  private:
+	class Table
+	{
+	  public:
+		// The step to take from every tile, packed as (x + 1) + (y + 1) * 3 + (z + 1) * 9, or
+		// NO_STEP where the destination can't be reached from
+		std::vector<uint8_t> steps;
+		// Position in the recently used list
+		std::list<Vec3<int>>::iterator lastUse;
+	};
+	static const uint8_t NO_STEP = 255;
+	// The destination itself, which is reached but has nowhere to go
+	static const uint8_t ARRIVED = 13;
+
+	std::map<Vec3<int>, Table> tables;
+	// Destinations, most recently used first
+	std::list<Vec3<int>> recentlyUsed;
+	unsigned int builds = 0;
+
+	Table &getTable(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> destination);
+	void build(TileMap &map, const CanEnterTileHelper &canEnterTile, Vec3<int> destination,
+	           Table &table) const;
+};
+
+}; // namespace OpenApoc
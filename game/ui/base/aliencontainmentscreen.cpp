@@ -89,7 +89,7 @@ void AlienContainmentScreen::closeScreen()
 		for (auto &b : state->player_bases)
 		{
 			if ((vecChanged[i] || forceLimits) &&
-			    b.second->getUsage(*state, FacilityType::Capacity::Aliens, vecBioDelta[i]) > 100)
+			    getUsage(b.second, FacilityType::Capacity::Aliens, vecBioDelta[i]) > 100)
 			{
 				bad_base = b.second->building->base;
 				break;
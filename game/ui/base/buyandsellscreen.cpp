@@ -154,7 +154,7 @@ void BuyAndSellScreen::closeScreen()
 		for (auto &b : state->player_bases)
 		{
 			if ((vecChanged[i] || forceLimits) &&
-			    b.second->getUsage(*state, FacilityType::Capacity::Stores, vecCargoDelta[i]) > 100)
+			    getUsage(b.second, FacilityType::Capacity::Stores, vecCargoDelta[i]) > 100)
 			{
 				bad_base = b.second->building->base;
 				break;
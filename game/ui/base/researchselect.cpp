@@ -210,7 +210,8 @@ void ResearchSelect::populateResearchList()
 		{
 			continue;
 		}
-		if ((!t->dependencies.satisfied(state->current_base) && t->started == false) || t->hidden)
+		// Started topics are listed whatever their dependencies, so only check those not started
+		if (t->hidden || (t->started == false && !t->dependencies.satisfied(state->current_base)))
 		{
 			continue;
 		}
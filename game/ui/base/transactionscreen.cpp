@@ -45,7 +45,14 @@ TransactionScreen::TransactionScreen(sp<GameState> state, bool forceLimits)
 	formPersonnelStats->setVisible(false);
 
 	// Assign event handlers
-	onScrollChange = [this](FormsEvent *) { this->updateFormValues(); };
+	onScrollChange = [this](FormsEvent *e) {
+		auto tctrl = std::dynamic_pointer_cast<TransactionControl>(e->forms().RaisedBy);
+		if (tctrl)
+		{
+			this->changedControls.insert(tctrl);
+		}
+		this->updateFormValues();
+	};
 	onHover = [this](FormsEvent *e) {
 		auto tctrl = std::dynamic_pointer_cast<TransactionControl>(e->forms().RaisedBy);
 		if (!tctrl)
@@ -496,20 +503,83 @@ void TransactionScreen::populateControlsAlien()
 
 void TransactionScreen::updateFormValues(bool queueHighlightUpdate)
 {
-	int leftIndex = getLeftIndex();
-	int rightIndex = getRightIndex();
+	updateDeltas(getLeftIndex(), getRightIndex());
 
 	// Crew
-	lqDelta = 0;
-	lq2Delta = 0;
+	lqDelta = totalDeltas.lq;
+	lq2Delta = totalDeltas.lq2;
 
 	// Update storage
-	cargoDelta = 0;
-	cargo2Delta = 0;
-	bioDelta = 0;
-	bio2Delta = 0;
-	moneyDelta = 0;
+	cargoDelta = totalDeltas.cargo;
+	cargo2Delta = totalDeltas.cargo2;
+	bioDelta = totalDeltas.bio;
+	bio2Delta = totalDeltas.bio2;
+	moneyDelta = totalDeltas.money;
 
+	if (queueHighlightUpdate)
+	{
+		framesUntilHighlightUpdate = HIGHLIGHT_UPDATE_DELAY;
+	}
+	else
+	{
+		updateBaseHighlight();
+	}
+}
+
+TransactionScreen::ControlDeltas
+TransactionScreen::getControlDeltas(const TransactionControl &control, int leftIndex,
+                                    int rightIndex) const
+{
+	ControlDeltas deltas;
+	deltas.lq = control.getCrewDelta(leftIndex);
+	deltas.lq2 = control.getCrewDelta(rightIndex);
+	deltas.cargo = control.getCargoDelta(leftIndex);
+	deltas.cargo2 = control.getCargoDelta(rightIndex);
+	deltas.bio = control.getBioDelta(leftIndex);
+	deltas.bio2 = control.getBioDelta(rightIndex);
+	deltas.money = control.getPriceDelta();
+	return deltas;
+}
+
+void TransactionScreen::updateDeltas(int leftIndex, int rightIndex)
+{
+	auto add = [this](const ControlDeltas &deltas, int sign) {
+		totalDeltas.lq += sign * deltas.lq;
+		totalDeltas.lq2 += sign * deltas.lq2;
+		totalDeltas.cargo += sign * deltas.cargo;
+		totalDeltas.cargo2 += sign * deltas.cargo2;
+		totalDeltas.bio += sign * deltas.bio;
+		totalDeltas.bio2 += sign * deltas.bio2;
+		totalDeltas.money += sign * deltas.money;
+	};
+
+	auto indices = std::make_pair(leftIndex, rightIndex);
+	if (deltasCounted && deltasIndices == indices && !changedControls.empty())
+	{
+		for (auto &c : changedControls)
+		{
+			// Linked controls share their orders, so only the one of them counted is updated
+			auto counted = controlDeltas.find(c);
+			for (auto it = c->getLinked().begin();
+			     counted == controlDeltas.end() && it != c->getLinked().end(); it++)
+			{
+				counted = controlDeltas.find(*it);
+			}
+			if (counted == controlDeltas.end())
+			{
+				counted = controlDeltas.emplace(c, ControlDeltas()).first;
+			}
+			add(counted->second, -1);
+			counted->second = getControlDeltas(*counted->first, leftIndex, rightIndex);
+			add(counted->second, 1);
+		}
+		changedControls.clear();
+		return;
+	}
+
+	controlDeltas.clear();
+	changedControls.clear();
+	totalDeltas = ControlDeltas();
 	std::set<sp<TransactionControl>> linkedControls;
 	for (auto &l : transactionControls)
 	{
@@ -519,28 +589,17 @@ void TransactionScreen::updateFormValues(bool queueHighlightUpdate)
 			{
 				continue;
 			}
-			lqDelta += c->getCrewDelta(leftIndex);
-			lq2Delta += c->getCrewDelta(rightIndex);
-			cargoDelta += c->getCargoDelta(leftIndex);
-			bioDelta += c->getBioDelta(leftIndex);
-			cargo2Delta += c->getCargoDelta(rightIndex);
-			bio2Delta += c->getBioDelta(rightIndex);
-			moneyDelta += c->getPriceDelta();
+			auto deltas = getControlDeltas(*c, leftIndex, rightIndex);
+			add(deltas, 1);
+			controlDeltas[c] = deltas;
 			for (auto &l : c->getLinked())
 			{
 				linkedControls.insert(l);
 			}
 		}
 	}
-
-	if (queueHighlightUpdate)
-	{
-		framesUntilHighlightUpdate = HIGHLIGHT_UPDATE_DELAY;
-	}
-	else
-	{
-		updateBaseHighlight();
-	}
+	deltasCounted = true;
+	deltasIndices = indices;
 }
 
 void TransactionScreen::updateBaseHighlight()
@@ -567,8 +626,7 @@ void TransactionScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_LIVING_QUARTERS"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_FIRST_BAR")->setVisible(true);
-			int usage =
-			    state->current_base->getUsage(*state, FacilityType::Capacity::Quarters, lqDelta);
+			int usage = getUsage(state->current_base, FacilityType::Capacity::Quarters, lqDelta);
 			fillBaseBar(true, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_FIRST_TEXT");
 			facilityLabel->setVisible(true);
@@ -581,8 +639,7 @@ void TransactionScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_STORES"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_FIRST_BAR")->setVisible(true);
-			int usage =
-			    state->current_base->getUsage(*state, FacilityType::Capacity::Stores, cargoDelta);
+			int usage = getUsage(state->current_base, FacilityType::Capacity::Stores, cargoDelta);
 			fillBaseBar(true, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_FIRST_TEXT");
 			facilityLabel->setVisible(true);
@@ -595,8 +652,7 @@ void TransactionScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_ALIEN_CONTAINMENT"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_FIRST_BAR")->setVisible(true);
-			int usage =
-			    state->current_base->getUsage(*state, FacilityType::Capacity::Aliens, bioDelta);
+			int usage = getUsage(state->current_base, FacilityType::Capacity::Aliens, bioDelta);
 			fillBaseBar(true, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_FIRST_TEXT");
 			facilityLabel->setVisible(true);
@@ -614,6 +670,17 @@ void TransactionScreen::updateBaseHighlight()
 	}
 }
 
+int TransactionScreen::getUsage(sp<Base> base, FacilityType::Capacity type, int delta)
+{
+	auto key = std::make_pair(static_cast<const Base *>(base.get()), type);
+	auto it = capacityUsed.find(key);
+	if (it == capacityUsed.end())
+	{
+		it = capacityUsed.emplace(key, base->getCapacityUsed(*state, type)).first;
+	}
+	return base->getUsageOf(type, it->second + delta);
+}
+
 void TransactionScreen::fillBaseBar(bool left, int percent)
 {
 	auto facilityBar = left ? form->findControlTyped<Graphic>("FACILITY_FIRST_FILL")
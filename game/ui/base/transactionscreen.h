@@ -1,11 +1,14 @@
 #pragma once
 
 #include "game/state/rules/agenttype.h"
+#include "game/state/rules/city/facilitytype.h"
 #include "game/state/stateobject.h"
 #include "game/ui/base/basestage.h"
 #include "library/sp.h"
 #include <functional>
 #include <list>
+#include <map>
+#include <set>
 #include <vector>
 
 namespace OpenApoc
@@ -75,6 +78,31 @@ class TransactionScreen : public BaseStage
 	int cargo2Delta = 0;
 	int bio2Delta = 0;
 	int moneyDelta = 0;
+
+	// What a control adds to the deltas above
+	class ControlDeltas
+	{
+	  public:
+		int lq = 0;
+		int lq2 = 0;
+		int cargo = 0;
+		int cargo2 = 0;
+		int bio = 0;
+		int bio2 = 0;
+		int money = 0;
+	};
+	// Deltas of the controls the totals are made of, one of each group of linked controls, for
+	// the indices in deltasIndices. Moving a slider only counts its control again, instead of
+	// every control on the screen
+	std::map<sp<TransactionControl>, ControlDeltas> controlDeltas;
+	ControlDeltas totalDeltas;
+	bool deltasCounted = false;
+	std::pair<int, int> deltasIndices;
+	// Controls whose sliders moved since the deltas were last updated
+	std::set<sp<TransactionControl>> changedControls;
+	// How much of each capacity each base used when first asked. Nothing is bought, sold or
+	// moved until the screen closes, so this does not change while it is open
+	std::map<std::pair<const Base *, FacilityType::Capacity>, int> capacityUsed;
 	// The text of message box which ask about confirmation to close the screen.
 	UString confirmClosureText;
 
@@ -97,9 +125,16 @@ class TransactionScreen : public BaseStage
 
 	// Update statistics on TransactionControls.
 	virtual void updateFormValues(bool queueHighlightUpdate = true);
+	ControlDeltas getControlDeltas(const TransactionControl &control, int leftIndex,
+	                               int rightIndex) const;
+	// Counts every control again, or only changedControls if the indices are the same as the
+	// last time
+	void updateDeltas(int leftIndex, int rightIndex);
 	// Update highlight of facilities on the mini-view.
 	virtual void updateBaseHighlight();
 	void fillBaseBar(bool left, int percent);
+	// Same as Base::getUsage, with capacityUsed instead of counting the base's use every time
+	int getUsage(sp<Base> base, FacilityType::Capacity type, int delta);
 	virtual void displayItem(sp<TransactionControl> control);
 
 	// Is it possible to close the screen without consequences?
@@ -166,7 +166,7 @@ void TransferScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_LIVING_QUARTERS"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_SECOND_BAR")->setVisible(true);
-			int usage = second_base->getUsage(*state, FacilityType::Capacity::Quarters, lq2Delta);
+			int usage = getUsage(second_base, FacilityType::Capacity::Quarters, lq2Delta);
 			fillBaseBar(false, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_SECOND_TEXT");
 			facilityLabel->setVisible(true);
@@ -179,7 +179,7 @@ void TransferScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_STORES"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_SECOND_BAR")->setVisible(true);
-			int usage = second_base->getUsage(*state, FacilityType::Capacity::Stores, cargo2Delta);
+			int usage = getUsage(second_base, FacilityType::Capacity::Stores, cargo2Delta);
 			fillBaseBar(false, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_SECOND_TEXT");
 			facilityLabel->setVisible(true);
@@ -192,7 +192,7 @@ void TransferScreen::updateBaseHighlight()
 			facilityPic->setVisible(true);
 			facilityPic->setImage(state->facility_types["FACILITYTYPE_ALIEN_CONTAINMENT"]->sprite);
 			form->findControlTyped<Graphic>("FACILITY_SECOND_BAR")->setVisible(true);
-			int usage = second_base->getUsage(*state, FacilityType::Capacity::Aliens, bio2Delta);
+			int usage = getUsage(second_base, FacilityType::Capacity::Aliens, bio2Delta);
 			fillBaseBar(false, usage);
 			auto facilityLabel = form->findControlTyped<Label>("FACILITY_SECOND_TEXT");
 			facilityLabel->setVisible(true);
@@ -292,12 +292,12 @@ void TransferScreen::closeScreen()
 		{
 			if (vecChanged[i] || forceLimits)
 			{
-				crewOverLimit = b.second->getUsage(*state, FacilityType::Capacity::Quarters,
-				                                   vecCrewDelta[i]) > 100;
-				cargoOverLimit = b.second->getUsage(*state, FacilityType::Capacity::Stores,
-				                                    vecCargoDelta[i]) > 100;
-				alienOverLimit = b.second->getUsage(*state, FacilityType::Capacity::Aliens,
-				                                    vecBioDelta[i]) > 100;
+				crewOverLimit =
+				    getUsage(b.second, FacilityType::Capacity::Quarters, vecCrewDelta[i]) > 100;
+				cargoOverLimit =
+				    getUsage(b.second, FacilityType::Capacity::Stores, vecCargoDelta[i]) > 100;
+				alienOverLimit =
+				    getUsage(b.second, FacilityType::Capacity::Aliens, vecBioDelta[i]) > 100;
 				if (crewOverLimit || cargoOverLimit || alienOverLimit)
 				{
 					bad_base = b.second->building->base;
@@ -430,14 +430,14 @@ void VEquipScreen::render()
 				// Not in stock
 				continue;
 			}
-			auto countImage = labelFont->getString(format("%d", count));
+			auto countText = format("%d", count);
 			auto &equipmentImage = equipmentType->equipscreen_sprite;
 			fw().renderer->draw(equipmentImage, inventoryPosition);
 
 			Vec2<int> countLabelPosition = inventoryPosition;
 			countLabelPosition.y += INVENTORY_COUNT_Y_GAP + equipmentImage->size.y;
 			// FIXME: Center in X?
-			fw().renderer->draw(countImage, countLabelPosition);
+			labelFont->drawString(countText, countLabelPosition);
 
 			Vec2<int> inventoryEndPosition = inventoryPosition;
 			inventoryEndPosition.x += equipmentImage->size.x;
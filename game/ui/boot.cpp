@@ -5,19 +5,36 @@
 #include "forms/ui.h"
 #include "framework/configfile.h"
 #include "framework/framework.h"
+#include "framework/jobsystem.h"
+#include "framework/logger.h"
 #include "game/state/gamestate.h"
 #include "game/ui/general/loadingscreen.h"
 #include "game/ui/general/mainmenu.h"
 #include "game/ui/general/videoscreen.h"
 #include "game/ui/tileview/battleview.h"
 #include "game/ui/tileview/cityview.h"
+#include <chrono>
 #include <cmath>
+#include <functional>
 
 namespace OpenApoc
 {
 ConfigOptionBool skipIntroOption("Game", "SkipIntro", "Skip intro video", false);
 ConfigOptionString loadGameOption("Game", "Load", "Path to save game to load at startup", "");
 
+namespace
+{
+// Runs a stage of booting, logging how long it took
+void runBootStage(const char *name, const std::function<void()> &stage)
+{
+	auto start = std::chrono::steady_clock::now();
+	stage();
+	LogInfo("%s took %.0f ms", name,
+	        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+	            .count());
+}
+} // anonymous namespace
+
 void BootUp::begin() {}
 
 void BootUp::pause() {}
@@ -31,33 +48,35 @@ void BootUp::eventOccurred(Event *e) { std::ignore = e; }
 void BootUp::update()
 {
 	bool skipIntro = skipIntroOption.get();
-	// The first forms instance causes it to get loaded
+	// Form files are read while the intro plays, along with the save to load if any
 	sp<GameState> loadedState;
 	std::shared_future<void> loadTask;
 	bool loadGame = false;
 
+	auto preloadForms = []() { runBootStage("Preloading forms", []() { ui().preloadFormsXml(); }); };
 	if (loadGameOption.get().empty())
 	{
-		loadTask = fw().threadPoolEnqueue([]() {
-			auto &ui_instance = ui();
-			std::ignore = ui_instance;
-		});
+		loadTask = fw().threadPoolEnqueue(preloadForms);
 	}
 	else
 	{
 		loadGame = true;
 		auto path = loadGameOption.get();
 		loadedState = mksp<GameState>();
-		loadTask = fw().threadPoolEnqueue([loadedState, path]() {
-			auto &ui_instance = ui();
-			std::ignore = ui_instance;
-			LogWarning("Loading save \"%s\"", path);
-
-			if (!loadedState->loadGame(path))
-			{
-				LogError("Failed to load supplied game \"%s\"", path);
-			}
-			loadedState->initState();
+		loadTask = fw().threadPoolEnqueue([loadedState, path, preloadForms]() {
+			// Nothing in the save needs the forms, so both are loaded at once
+			auto &jobs = fw().getJobSystem();
+			JobCounter forms;
+			jobs.run(preloadForms, &forms);
+			runBootStage("Loading save", [loadedState, path]() {
+				LogWarning("Loading save \"%s\"", path);
+				if (!loadedState->loadGame(path))
+				{
+					LogError("Failed to load supplied game \"%s\"", path);
+				}
+				loadedState->initState();
+			});
+			jobs.wait(forms);
 		});
 	}
 
@@ -12,7 +12,9 @@
 #include "game/state/rules/city/scenerytiletype.h"
 #include "game/state/tilemap/tilemap.h"
 #include "library/strings_format.h"
+#include <cstring>
 #include <unordered_map>
+#include <vector>
 
 namespace OpenApoc
 {
@@ -102,12 +104,12 @@ void BaseGraphics::renderBase(Vec2<int> renderPos, sp<Base> base)
 				fw().renderer->draw(circleL, pos);
 			}
 			// Draw time remaining
-			auto textImage = font->getString(Strings::fromInteger(facility->buildTime));
+			auto text = Strings::fromInteger(facility->buildTime);
 			Vec2<int> textPos = {TILE_SIZE, TILE_SIZE};
 			textPos *= facility->type->size;
-			textPos -= textImage->size;
+			textPos -= Vec2<int>{font->getFontWidth(text), font->getFontHeight()};
 			textPos /= 2;
-			fw().renderer->draw(textImage, pos + textPos);
+			font->drawString(text, pos + textPos);
 		}
 	}
 
@@ -219,36 +221,60 @@ sp<RGBImage> BaseGraphics::drawMiniBase(sp<Base> base, FacilityHighlight highlig
 	return minibase;
 }
 
-sp<RGBImage> BaseGraphics::drawMinimap(sp<GameState> state, sp<Building> selected)
+namespace
 {
-	// FIXME: add city ref to building
-	auto city = state->cities["CITYMAP_HUMAN"];
-	auto minimap = mksp<RGBImage>(Vec2<unsigned int>{100, 100});
-	RGBImageLock l(minimap);
+const Vec2<unsigned int> MINIMAP_SIZE = {100, 100};
+// Offset for 'endless grass' outside of city borders
+const Vec2<int> MINIMAP_OFFSET = {20, 20};
 
-	// Offset for 'endless grass' outside of city borders
-	static Vec2<int> offset(20, 20);
+// The city tiles of the minimap only change with the city, so they are drawn once for it
+wp<City> minimapCity;
+sp<RGBImage> minimapTiles;
 
-	// Draw the city tiles
-	std::map<Vec2<int>, int> minimap_z;
-	for (auto &pair : city->initial_tiles)
+sp<RGBImage> drawMinimapTiles(const City &city)
+{
+	auto image = mksp<RGBImage>(MINIMAP_SIZE);
+	RGBImageLock l(image);
+	// Highest level drawn so far at every pixel
+	std::vector<int> minimapZ(MINIMAP_SIZE.x * MINIMAP_SIZE.y, -1);
+	for (auto &pair : city.initial_tiles)
 	{
 		auto &pos = pair.first;
 		auto &tile = pair.second;
-		if (pos.x < offset.x || pos.x > city->size.x - offset.x || pos.y < offset.y ||
-		    pos.y > city->size.y - offset.y)
+		Vec2<int> pos2d = {pos.x - MINIMAP_OFFSET.x, pos.y - MINIMAP_OFFSET.y};
+		if (pos2d.x < 0 || pos2d.x >= (int)MINIMAP_SIZE.x || pos2d.y < 0 ||
+		    pos2d.y >= (int)MINIMAP_SIZE.y)
 			continue;
 
-		Vec2<int> pos2d = {pos.x - offset.x, pos.y - offset.y};
-		auto it = minimap_z.find(pos2d);
-		if (it == minimap_z.end() || it->second < pos.z)
+		auto &z = minimapZ[pos2d.y * MINIMAP_SIZE.x + pos2d.x];
+		if (z < pos.z)
 		{
 			if (tile->minimap_colour.a == 0)
 				continue;
-			minimap_z[pos2d] = pos.z;
+			z = pos.z;
 			l.set(pos2d, tile->minimap_colour);
 		}
 	}
+	return image;
+}
+} // anonymous namespace
+
+sp<RGBImage> BaseGraphics::drawMinimap(sp<GameState> state, sp<Building> selected)
+{
+	// FIXME: add city ref to building
+	auto city = state->cities["CITYMAP_HUMAN"];
+	if (!minimapTiles || minimapCity.lock() != city)
+	{
+		minimapTiles = drawMinimapTiles(*city);
+		minimapCity = city;
+	}
+	auto minimap = mksp<RGBImage>(MINIMAP_SIZE);
+	RGBImageLock l(minimap);
+	{
+		RGBImageLock tiles(minimapTiles, ImageLockUse::Read);
+		memcpy(l.getData(), tiles.getData(), MINIMAP_SIZE.x * MINIMAP_SIZE.y * sizeof(Colour));
+	}
+	auto &offset = MINIMAP_OFFSET;
 
 	// Draw all bases as yellow blocks
 	for (auto &pair : state->player_bases)
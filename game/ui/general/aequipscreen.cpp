@@ -427,7 +427,7 @@ void AEquipScreen::render()
 		auto rect = std::get<0>(tuple);
 		auto pos = rect.p0;
 		pos.x -= inventoryPage * inventoryControl->Size.x;
-		auto countImage = count > 0 ? labelFont->getString(format("%d", count)) : nullptr;
+		auto countText = count > 0 ? format("%d", count) : "";
 		auto &equipmentImage = item->type->equipscreen_sprite;
 
 		if (pos.x < inventoryControl->Location.x + formMain->Location.x ||
@@ -438,15 +438,16 @@ void AEquipScreen::render()
 
 		fw().renderer->draw(equipmentImage, pos);
 
-		if (countImage)
+		if (!countText.empty())
 		{
 			Vec2<int> countLabelPosition = pos;
-			countLabelPosition.x += equipmentImage->size.x / 2 - countImage->size.x / 2;
+			countLabelPosition.x +=
+			    equipmentImage->size.x / 2 - labelFont->getFontWidth(countText) / 2;
 			countLabelPosition.y += INVENTORY_COUNT_Y_GAP + item->type->equipscreen_size.y * 16;
 			countLabelPosition.y =
-			    std::min(countLabelPosition.y, inventoryBottom - (int)countImage->size.y);
+			    std::min(countLabelPosition.y, inventoryBottom - labelFont->getFontHeight());
 
-			fw().renderer->draw(countImage, countLabelPosition);
+			labelFont->drawString(countText, countLabelPosition);
 		}
 	}
 
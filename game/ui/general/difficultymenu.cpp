@@ -40,6 +40,7 @@ std::shared_future<void> loadGame(const UString &path, sp<GameState> state)
 			LogError("Failed to load '%s'", path);
 			return;
 		}
+		state->baseStates = {"gamestate_common", path};
 		state->startGame();
 		state->initState();
 		state->fillOrgStartingProperty();
@@ -104,6 +104,9 @@ std::list<std::pair<UString, UString>> openApocList = {
     {"OpenApoc.NewFeature.CrashingDimensionGate", "Uncapable vehicles crash when entering gates"},
     {"OpenApoc.NewFeature.SkipTurboMovement", "Skip turbo movement calculations"},
     {"OpenApoc.NewFeature.CrashingOutOfFuel", "Vehicles crash when out of fuel"},
+    {"OpenApoc.NewFeature.ShadowcastVision", "Units reveal exactly the tiles they see"},
+    {"OpenApoc.NewFeature.FixedUpdateRate", "Game speed does not depend on frame rate"},
+    {"OpenApoc.NewFeature.CoarseTurbo", "Turbo moves vehicles far from yours coarsely"},
 
     {"OpenApoc.Mod.StunHostileAction", "(M) Stunning hurts relationships"},
     {"OpenApoc.Mod.RaidHostileAction", "(M) Initiating raid hurts relationships"},
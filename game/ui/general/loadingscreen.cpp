@@ -52,7 +52,11 @@ void LoadingScreen::pause() {}
 
 void LoadingScreen::resume() {}
 
-void LoadingScreen::finish() {}
+void LoadingScreen::finish()
+{
+	// Whatever was loaded and dropped has left gaps in the renderer's spritesheets
+	fw().renderer->compact();
+}
 
 void LoadingScreen::eventOccurred(Event *e)
 {
@@ -20,7 +20,7 @@ MessageLogScreen::MessageLogScreen(sp<GameState> state, CityView &cityView)
     : Stage(), menuform(ui().getForm("messagelog")), state(state)
 {
 	auto listbox = menuform->findControlTyped<ListBox>("LISTBOX_MESSAGES");
-	for (EventMessage message : state->messages)
+	for (auto &message : state->messages)
 	{
 		listbox->addItem(createMessageRow(message, state, cityView));
 	}
@@ -30,7 +30,7 @@ MessageLogScreen::MessageLogScreen(sp<GameState> state, BattleView &battleView)
     : Stage(), menuform(ui().getForm("messagelog")), state(state)
 {
 	auto listbox = menuform->findControlTyped<ListBox>("LISTBOX_MESSAGES");
-	for (EventMessage message : state->messages)
+	for (auto &message : state->messages)
 	{
 		listbox->addItem(createMessageRow(message, state, battleView));
 	}
@@ -410,6 +410,70 @@ void BattleTileView::eventOccurred(Event *e)
 	TileView::eventOccurred(e);
 }
 
+uint64_t BattleTileView::getChunkVisibility(Vec2<int> chunk, int z,
+                                            const BitVector &visibleTiles) const
+{
+	static_assert(TileMap::DRAW_CHUNK_SIZE * TileMap::DRAW_CHUNK_SIZE <= 64,
+	              "Visibility of a chunk must fit in 64 bits");
+	if (revealWholeMap)
+	{
+		return ~uint64_t{0};
+	}
+	uint64_t visibility = 0;
+	int bit = 0;
+	for (auto &tilePosition : chunkCache.getTiles(chunk))
+	{
+		if (visibleTiles.get(z * map.size.x * map.size.y + tilePosition.y * map.size.x +
+		                     tilePosition.x))
+		{
+			visibility |= uint64_t{1} << bit;
+		}
+		bit++;
+	}
+	return visibility;
+}
+
+bool BattleTileView::drawStaticChunk(Renderer &r, Vec2<int> chunk, int z, unsigned int layer,
+                                     int currentLevel, const BitVector &visibleTiles)
+{
+	for (auto &tilePosition : chunkCache.getTiles(chunk))
+	{
+		auto tile = map.getTile(tilePosition.x, tilePosition.y, z);
+		if (tile->pathfindingDebugFlag)
+		{
+			return false;
+		}
+		bool visible = revealWholeMap ||
+		               visibleTiles.get(z * map.size.x * map.size.y +
+		                                tilePosition.y * map.size.x + tilePosition.x);
+		for (auto &obj : tile->drawnObjects[layer])
+		{
+			switch (obj->getType())
+			{
+				case TileObject::Type::Ground:
+				case TileObject::Type::LeftWall:
+				case TileObject::Type::RightWall:
+				case TileObject::Type::Feature:
+				{
+					auto mapPart =
+					    std::static_pointer_cast<TileObjectBattleMapPart>(obj)->getOwner();
+					// Doors and animated map parts change frame without anything telling the map
+					if (mapPart->door || !mapPart->type->animation_frames.empty())
+					{
+						return false;
+					}
+					break;
+				}
+				default:
+					return false;
+			}
+			obj->draw(r, *this, tileToScreenCoords(obj->getCenter()), this->viewMode, visible,
+			          currentLevel);
+		}
+	}
+	return true;
+}
+
 void BattleTileView::render()
 {
 	TRACE_FN;
@@ -458,6 +522,14 @@ void BattleTileView::render()
 	int minY = std::max(0, topRight.y);
 	int maxY = std::min(map.size.y, bottomLeft.y);
 
+	if (this->viewMode == TileViewMode::Isometric)
+	{
+		map.placeShadows({minX, minY}, {maxX, maxY});
+	}
+
+	// Looked up once, not for every tile drawn
+	auto &visibleTiles = battle.visibleTiles.at(battle.currentPlayer);
+
 	int zFrom = 0;
 	int zTo = maxZDraw;
 
@@ -583,6 +655,13 @@ void BattleTileView::render()
 
 			static const Vec2<float> offsetFaceIcon = {-7.0f, -1.0f};
 
+			auto visibleRows = getVisibleRows({minX, minY}, {maxX, maxY});
+			auto chunks = chunkCache.getChunks(minY, visibleRows);
+			auto screenOffset = getScreenOffset();
+			// Objects that only draw sprites, and the icons amongst them, are drawn a batch at a
+			// time
+			RendererSpriteBatch batch(r);
+
 			for (int z = zFrom; z < zTo; z++)
 			{
 				int currentLevel = z - battle.battleViewZLevel + 1;
@@ -640,15 +719,80 @@ void BattleTileView::render()
 					}
 				}
 
+				// Chunks with icons drawn amongst the objects on them are never drawn from the
+				// chunk cache
+				std::set<Vec2<int>> chunksWithIcons;
+				if (selTileOnCurLevel)
+				{
+					chunksWithIcons.insert(
+					    Vec2<int>{selTilePosOnCurLevel.x, selTilePosOnCurLevel.y} /
+					    TileMap::DRAW_CHUNK_SIZE);
+				}
+				for (auto &locations : {&targetIconLocations, &waypointLocations})
+				{
+					for (auto &location : *locations)
+					{
+						if (location.z == z)
+						{
+							chunksWithIcons.insert(Vec2<int>{location.x, location.y} /
+							                       TileMap::DRAW_CHUNK_SIZE);
+						}
+					}
+				}
+
+				// Images of the level's chunks are put together at once before any is drawn
+				std::vector<TileViewChunkCache::Request> chunkRequests;
+				std::vector<uint64_t> chunkVisibility;
+				for (auto &chunk : chunks)
+				{
+					chunkVisibility.push_back(getChunkVisibility(chunk.position, z, visibleTiles));
+				}
+				auto drawChunk = [this, z, currentLevel, &visibleTiles](Vec2<int> chunk,
+				                                                        unsigned int layer) {
+					return [this, chunk, z, layer, currentLevel,
+					        &visibleTiles](Renderer &chunkRenderer) {
+						return drawStaticChunk(chunkRenderer, chunk, z, layer, currentLevel,
+						                       visibleTiles);
+					};
+				};
+				if (chunkCache.isEnabled())
+				{
+					for (unsigned int layer = 0; layer < map.getLayerCount(); layer++)
+					{
+						for (unsigned int i = 0; i < chunks.size(); i++)
+						{
+							auto &chunk = chunks[i];
+							if (chunksWithIcons.find(chunk.position) == chunksWithIcons.end())
+							{
+								chunkRequests.push_back({chunk.position, z, layer,
+								                         chunkVisibility[i],
+								                         drawChunk(chunk.position, layer)});
+							}
+						}
+					}
+					chunkCache.prepare(r, chunkRequests);
+				}
+
 				// Actually draw stuff
 				for (unsigned int layer = 0; layer < map.getLayerCount(); layer++)
 				{
-					for (int y = minY; y < maxY; y++)
+					for (unsigned int i = 0; i < chunks.size(); i++)
 					{
-						for (int x = minX; x < maxX; x++)
+						auto &chunk = chunks[i];
+						if (chunksWithIcons.find(chunk.position) == chunksWithIcons.end() &&
+						    chunkCache.draw(batch.flush(), chunk.position, z, layer,
+						                    chunkVisibility[i], screenOffset,
+						                    drawChunk(chunk.position, layer)))
+						{
+							continue;
+						}
+						for (auto &tilePosition : chunk.tiles)
 						{
+							int x = tilePosition.x;
+							int y = tilePosition.y;
 							auto tile = map.getTile(x, y, z);
-							bool visible = battle.getVisible(battle.currentPlayer, x, y, z);
+							bool visible =
+							    visibleTiles.get(z * map.size.x * map.size.y + y * map.size.x + x);
 							auto object_count = tile->drawnObjects[layer].size();
 							size_t obj_id = 0;
 							do
@@ -656,29 +800,29 @@ void BattleTileView::render()
 								if (tile == selTileOnCurLevel && layer == 0 &&
 								    selTileOnCurLevel->drawBattlescapeSelectionBackAt == obj_id)
 								{
-									r.draw(selectionImageBack,
-									       tileToOffsetScreenCoords(selTilePosOnCurLevel) -
-									           selectedTileImageOffset);
+									batch.add(selectionImageBack,
+									          tileToOffsetScreenCoords(selTilePosOnCurLevel) -
+									              selectedTileImageOffset);
 								}
 								if (tile->drawTargetLocationIconAt == obj_id)
 								{
 									if (targetIconLocations.find({x, y, z}) !=
 									    targetIconLocations.end())
 									{
-										r.draw(targetLocationIcons[iconAnimationTicksAccumulated /
-										                           TARGET_ICONS_ANIMATION_DELAY],
-										       tileToOffsetScreenCoords(Vec3<float>{
-										           x, y, tile->getRestingPosition().z}) -
-										           targetLocationOffset);
+										batch.add(targetLocationIcons[iconAnimationTicksAccumulated /
+										                              TARGET_ICONS_ANIMATION_DELAY],
+										          tileToOffsetScreenCoords(Vec3<float>{
+										              x, y, tile->getRestingPosition().z}) -
+										              targetLocationOffset);
 									}
 									if (waypointLocations.find({x, y, z}) !=
 									    waypointLocations.end())
 									{
-										r.draw(waypointImageSource[iconAnimationTicksAccumulated /
-										                           TARGET_ICONS_ANIMATION_DELAY],
-										       tileToOffsetScreenCoords(Vec3<float>{
-										           x, y, tile->getRestingPosition().z}) -
-										           targetLocationOffset);
+										batch.add(waypointImageSource[iconAnimationTicksAccumulated /
+										                              TARGET_ICONS_ANIMATION_DELAY],
+										          tileToOffsetScreenCoords(Vec3<float>{
+										              x, y, tile->getRestingPosition().z}) -
+										              targetLocationOffset);
 									}
 								}
 								if (obj_id >= object_count)
@@ -815,13 +959,17 @@ void BattleTileView::render()
 										break;
 								}
 								Vec2<float> pos = tileToOffsetScreenCoords(obj->getCenter());
-								obj->draw(r, *this, pos, this->viewMode,
-								          revealWholeMap || objectVisible, currentLevel, friendly,
-								          hostile);
+								if (!obj->addSprites(batch, pos, this->viewMode,
+								                     revealWholeMap || objectVisible))
+								{
+									obj->draw(batch.flush(), *this, pos, this->viewMode,
+									          revealWholeMap || objectVisible, currentLevel,
+									          friendly, hostile);
+								}
 								int faceShift = 0;
 								if (unitPsiAttacker)
 								{
-									r.draw(
+									batch.add(
 									    psiIcons[PsiStatus::NotEngaged][psiIconTicksAccumulated /
 									                                    PSI_ICON_ANIMATION_DELAY],
 									    unitFaceIconPos);
@@ -829,7 +977,7 @@ void BattleTileView::render()
 								}
 								if (unitPsiAttackedStatus != PsiStatus::NotEngaged)
 								{
-									r.draw(
+									batch.add(
 									    psiIcons[unitPsiAttackedStatus][psiIconTicksAccumulated /
 									                                    PSI_ICON_ANIMATION_DELAY],
 									    unitFaceIconPos + Vec2<float>{0, faceShift * 16.0f});
@@ -837,9 +985,9 @@ void BattleTileView::render()
 								}
 								if (unitLowMorale)
 								{
-									r.draw(lowMoraleIcons[lowMoraleIconTicksAccumulated /
-									                      LOWMORALE_ICON_ANIMATION_DELAY],
-									       unitFaceIconPos + Vec2<float>{0, faceShift * 16.0f});
+									batch.add(lowMoraleIcons[lowMoraleIconTicksAccumulated /
+									                         LOWMORALE_ICON_ANIMATION_DELAY],
+									          unitFaceIconPos + Vec2<float>{0, faceShift * 16.0f});
 								}
 								// Loop ends when "break" is reached above
 								obj_id++;
@@ -849,9 +997,9 @@ void BattleTileView::render()
 							{
 								static const Vec2<int> offset = {2, -53};
 
-								r.draw(selectionImageFront,
-								       tileToOffsetScreenCoords(selTilePosOnCurLevel) -
-								           selectedTileImageOffset);
+								batch.add(selectionImageFront,
+								          tileToOffsetScreenCoords(selTilePosOnCurLevel) -
+								              selectedTileImageOffset);
 								if (drawPathPreview)
 								{
 									sp<Image> img;
@@ -869,10 +1017,10 @@ void BattleTileView::render()
 									}
 									if (img)
 									{
-										r.draw(img,
-										       tileToOffsetScreenCoords(selTilePosOnCurLevel) +
-										           offset -
-										           Vec2<int>{img->size.x / 2, img->size.y / 2});
+										batch.add(img,
+										          tileToOffsetScreenCoords(selTilePosOnCurLevel) +
+										              offset -
+										              Vec2<int>{img->size.x / 2, img->size.y / 2});
 									}
 								}
 								if (drawAttackCost)
@@ -895,21 +1043,22 @@ void BattleTileView::render()
 									}
 									if (img)
 									{
-										r.draw(img,
-										       tileToOffsetScreenCoords(selTilePosOnCurLevel) +
-										           offset -
-										           Vec2<int>{img->size.x / 2, img->size.y / 2});
+										batch.add(img,
+										          tileToOffsetScreenCoords(selTilePosOnCurLevel) +
+										              offset -
+										              Vec2<int>{img->size.x / 2, img->size.y / 2});
 									}
 								}
 							}
 							if (tile->pathfindingDebugFlag)
-								r.draw(waypointIcons[0],
-								       tileToOffsetScreenCoords(Vec3<int>{x, y, z}) -
-								           selectedTileImageOffset);
+								batch.add(waypointIcons[0],
+								          tileToOffsetScreenCoords(Vec3<int>{x, y, z}) -
+								              selectedTileImageOffset);
 						}
 					}
 				}
 			}
+			batch.flush();
 
 			// Draw next level, units whose "legs" are below "zTo", projectiles and items moving
 			for (int z = zTo; z < maxZDraw && z < zTo + 1; z++)
@@ -925,10 +1074,12 @@ void BattleTileView::render()
 				{
 					for (int y = minY; y < maxY; y++)
 					{
-						for (int x = minX; x < maxX; x++)
+						auto &row = visibleRows[y - minY];
+						for (int x = row.x; x < row.y; x++)
 						{
 							auto tile = map.getTile(x, y, z);
-							bool visible = battle.getVisible(battle.currentPlayer, x, y, z);
+							bool visible =
+							    visibleTiles.get(z * map.size.x * map.size.y + y * map.size.x + x);
 							auto object_count = tile->drawnObjects[layer].size();
 							size_t obj_id = 0;
 							do
@@ -1317,6 +1468,7 @@ void BattleTileView::render()
 
 			// Draw everything but units and items
 			// Gather units and items on current level
+			RendererSpriteBatch batch(r);
 			for (int z = zFrom; z < zTo; z++)
 			{
 				// currentZLevel is an upper exclusive boundary, that's why we need to sub 1 here
@@ -1329,7 +1481,8 @@ void BattleTileView::render()
 						for (int x = minX; x < maxX; x++)
 						{
 							auto tile = map.getTile(x, y, z);
-							bool visible = battle.getVisible(battle.currentPlayer, x, y, z);
+							bool visible =
+							    visibleTiles.get(z * map.size.x * map.size.y + y * map.size.x + x);
 							auto object_count = tile->drawnObjects[layer].size();
 
 							for (size_t obj_id = 0; obj_id < object_count; obj_id++)
@@ -1423,13 +1576,18 @@ void BattleTileView::render()
 										break;
 								}
 								Vec2<float> pos = tileToOffsetScreenCoords(obj->getCenter());
-								obj->draw(r, *this, pos, this->viewMode,
-								          revealWholeMap || objectVisible, currentLevel);
+								if (!obj->addSprites(batch, pos, this->viewMode,
+								                     revealWholeMap || objectVisible))
+								{
+									obj->draw(batch.flush(), *this, pos, this->viewMode,
+									          revealWholeMap || objectVisible, currentLevel);
+								}
 							}
 						}
 					}
 				}
 			}
+			batch.flush();
 
 			// Gather units above current level
 			for (int z = zTo; z < maxZDraw; z++)
@@ -1548,6 +1706,8 @@ void BattleTileView::render()
 			break;
 	}
 
+	drawHeatMap(r, {minX, minY}, {maxX, maxY});
+
 	if (fireEncountered)
 	{
 		ticksUntilFireSound = 60 * state.battle_common_sample_list->burn->sampleCount /
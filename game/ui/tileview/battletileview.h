@@ -2,8 +2,10 @@
 
 #include "game/state/battle/battleunit.h"
 #include "game/ui/tileview/tileview.h"
+#include "library/bitvector.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <cstdint>
 #include <list>
 #include <vector>
 
@@ -88,6 +90,13 @@ class BattleTileView : public TileView
 	sp<Palette> palette;
 	std::vector<sp<Palette>> modPalette;
 
+	// Bit for each tile of the chunk, row by row, set if the current player sees it
+	uint64_t getChunkVisibility(Vec2<int> chunk, int z, const BitVector &visibleTiles) const;
+	// Draws the map parts on the chunk for the chunk cache, returning false if there is anything
+	// else on it or any of them are animated
+	bool drawStaticChunk(Renderer &r, Vec2<int> chunk, int z, unsigned int layer, int currentLevel,
+	                     const BitVector &visibleTiles);
+
   public:
 	BattleTileView(TileMap &map, Vec3<int> isoTileSize, Vec2<int> stratTileSize,
 	               TileViewMode initialMode, Vec3<float> screenCenterTile, GameState &gameState);
@@ -31,10 +31,12 @@
 #include "game/state/message.h"
 #include "game/state/rules/aequipmenttype.h"
 #include "game/state/rules/battle/battlemapparttype.h"
+#include "game/state/rules/battle/battleunitimagepack.h"
 #include "game/state/rules/battle/damage.h"
 #include "game/state/shared/aequipment.h"
 #include "game/state/shared/projectile.h"
 #include "game/state/tilemap/collision.h"
+#include "game/state/tilemap/pathfinding.h"
 #include "game/state/tilemap/tileobject_battlehazard.h"
 #include "game/state/tilemap/tileobject_battlemappart.h"
 #include "game/state/tilemap/tileobject_battleunit.h"
@@ -73,6 +75,22 @@ static const int TICKS_END_MISSION = TICKS_PER_TURN;
 static const std::set<BodyPart> bodyParts{BodyPart::Body, BodyPart::Helmet, BodyPart::LeftArm,
                                           BodyPart::Legs, BodyPart::RightArm};
 
+// Adds every image a map part of type may be drawn with, including once damaged, to images,
+// skipping types already added
+void addMapPartImages(std::vector<sp<Image>> &images, std::set<const BattleMapPartType *> &added,
+                      const StateRef<BattleMapPartType> &type)
+{
+	if (!type || !added.insert(&*type).second)
+	{
+		return;
+	}
+	images.push_back(type->sprite);
+	images.push_back(type->strategySprite);
+	images.insert(images.end(), type->animation_frames.begin(), type->animation_frames.end());
+	addMapPartImages(images, added, type->damaged_map_part);
+	addMapPartImages(images, added, type->alternative_map_part);
+}
+
 } // anonymous namespace
 
 BattleView::BattleView(sp<GameState> gameState)
@@ -80,7 +98,9 @@ BattleView::BattleView(sp<GameState> gameState)
                      Vec3<int>{TILE_X_BATTLE, TILE_Y_BATTLE, TILE_Z_BATTLE},
                      Vec2<int>{STRAT_TILE_X, STRAT_TILE_Y}, TileViewMode::Isometric,
                      gameState->current_battle->battleViewScreenCenter, *gameState),
-      baseForm(ui().getForm("battle/battle")), state(gameState), battle(*state->current_battle),
+      baseForm(ui().getForm("battle/battle")),
+      updateClock(std::chrono::microseconds(1000000 / UPDATES_PER_SECOND), MAX_UPDATES_PER_FRAME),
+      state(gameState), battle(*state->current_battle),
       followAgent(false), selectionState(BattleSelectionState::Normal)
 {
 	motionScannerDirectionIcons.push_back(
@@ -1212,11 +1232,31 @@ BattleView::BattleView(sp<GameState> gameState)
 	updateLayerButtons();
 }
 
-BattleView::~BattleView() = default;
+BattleView::~BattleView()
+{
+	// The search holds on to the map
+	fw().getJobSystem().wait(pathPreviewJob);
+}
 
 void BattleView::begin()
 {
 	BattleTileView::begin();
+
+	// Get the sprites of the map and of the units ready all at once, rather than stalling the
+	// first frames on each as it is first drawn
+	std::vector<sp<Image>> images;
+	std::set<const BattleMapPartType *> addedTypes;
+	for (auto &mapPart : battle.map_parts)
+	{
+		addMapPartImages(images, addedTypes, mapPart->type);
+		addMapPartImages(images, addedTypes, mapPart->alternative_type);
+	}
+	for (auto &pack : state->battle_unit_image_packs)
+	{
+		images.insert(images.end(), pack.second->images.begin(), pack.second->images.end());
+	}
+	fw().renderer->preload(images);
+
 	uiTabsRT[0]->findControl("BUTTON_LAYER_1")->setVisible(maxZDraw >= 1);
 	uiTabsRT[0]->findControl("BUTTON_LAYER_2")->setVisible(maxZDraw >= 2);
 	uiTabsRT[0]->findControl("BUTTON_LAYER_3")->setVisible(maxZDraw >= 3);
@@ -1254,6 +1294,7 @@ void BattleView::begin()
 void BattleView::resume()
 {
 	state->skipTurboCalculations = config().getBool("OpenApoc.NewFeature.SkipTurboMovement");
+	updateClock.reset();
 	BattleTileView::resume();
 	modifierLAlt = false;
 	modifierLCtrl = false;
@@ -1335,6 +1376,7 @@ void BattleView::setUpdateSpeed(BattleUpdateSpeed updateSpeed)
 
 void BattleView::update()
 {
+	finishPathPreview();
 	bool realTime = battle.mode == Battle::Mode::RealTime;
 
 	// Parent update
@@ -1434,13 +1476,20 @@ void BattleView::update()
 			ticks = 4;
 			break;
 	}
+	// Asked every frame, so that time spent paused is not made up for afterwards
+	auto steps = updateClock.getSteps();
+	unsigned int ticksPerStep = ticks;
+	if (config().getBool("OpenApoc.NewFeature.FixedUpdateRate"))
+	{
+		ticks *= steps;
+	}
 	if (hideDisplay)
 	{
 		ticks = 16;
 	}
 	while (ticks > 0)
 	{
-		int ticksPerUpdate = UPDATE_EVERY_TICK ? 1 : hideDisplay ? 4 : ticks;
+		int ticksPerUpdate = UPDATE_EVERY_TICK ? 1 : hideDisplay ? 4 : ticksPerStep;
 		state->update(ticksPerUpdate);
 		ticks -= ticksPerUpdate;
 		if (hideDisplay)
@@ -1489,7 +1538,7 @@ void BattleView::update()
 	// Update preview calculations in TB mode
 	if (!realTime)
 	{
-		if (previewedPathCost == -1)
+		if (previewedPathCost == -1 && !pathPreviewSearch)
 		{
 			pathPreviewTicksAccumulated++;
 			// Show path preview if hovering for over half a second
@@ -2196,7 +2245,6 @@ void BattleView::updatePathPreview()
 
 	// Cost to move is 1.5x if prone and 0.5x if running, to keep things in integer
 	// we use a value that is then divided by 2
-	float cost = 0.0f;
 	int cost_multiplier_x_2 = 2;
 	if (lastSelectedUnit->agent->canRun() &&
 	    lastSelectedUnit->movement_mode == MovementMode::Running)
@@ -2211,9 +2259,46 @@ void BattleView::updatePathPreview()
 	// Get path
 	float maxCost =
 	    (float)lastSelectedUnit->agent->modified_stats.time_units * 2 / cost_multiplier_x_2;
-	pathPreview = map.findShortestPath(lastSelectedUnit->goalPosition, target, 1000,
-	                                   BattleUnitTileHelper{map, *lastSelectedUnit}, false, false,
-	                                   true, false, &cost, maxCost);
+	pathPreviewSearch = mkup<PathPreviewSearch>();
+	pathPreviewSearch->unit = lastSelectedUnit;
+	pathPreviewSearch->hoveredTile = selectedTilePosition;
+	pathPreviewSearch->target = target;
+	pathPreviewSearch->costMultiplierX2 = cost_multiplier_x_2;
+	if (!pathPreviewArena)
+	{
+		pathPreviewArena = mkup<PathfindingArena>();
+	}
+	auto *search = pathPreviewSearch.get();
+	auto *arena = pathPreviewArena.get();
+	auto origin = lastSelectedUnit->goalPosition;
+	BattleUnitTileHelper helper{map, *lastSelectedUnit};
+	fw().getJobSystem().run(
+	    [&map, search, arena, origin, helper, maxCost]() {
+		    search->path =
+		        map.findShortestPath(origin, search->target, 1000, helper, false, false, true,
+		                             false, &search->cost, maxCost, arena);
+	    },
+	    &pathPreviewJob);
+}
+
+void BattleView::finishPathPreview()
+{
+	if (!pathPreviewSearch)
+	{
+		return;
+	}
+	fw().getJobSystem().wait(pathPreviewJob);
+	auto search = std::move(pathPreviewSearch);
+	// The cursor or the selection moved on while it was searched for
+	if (search->unit != lastSelectedUnit || search->hoveredTile != selectedTilePosition ||
+	    previewedPathCost != -1)
+	{
+		return;
+	}
+	auto target = search->target;
+	float cost = search->cost;
+	int cost_multiplier_x_2 = search->costMultiplierX2;
+	pathPreview = std::move(search->path);
 	if (pathPreview.empty())
 	{
 		LogError("Empty path returned for path preview!?");
@@ -2943,7 +3028,8 @@ bool BattleView::handleKeyDown(Event *e)
 				auto t = getSelectedTilePosition();
 				auto &map = *battle.map;
 				auto tile = map.getTile(t);
-				for (auto &o : tile->ownedObjects)
+				auto objects = tile->ownedObjects;
+				for (auto &o : objects)
 				{
 					if (o->getType() == TileObject::Type::Ground ||
 					    o->getType() == TileObject::Type::Feature ||
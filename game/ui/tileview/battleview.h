@@ -1,9 +1,11 @@
 #pragma once
 
+#include "framework/jobsystem.h"
 #include "game/state/battle/battleunit.h"
 #include "game/ui/general/notificationscreen.h"
 #include "game/ui/tileview/battletileview.h"
 #include "library/colour.h"
+#include "library/fixedstepclock.h"
 #include "library/sp.h"
 
 namespace OpenApoc
@@ -18,6 +20,7 @@ class AEquipmentType;
 class Graphic;
 class BattleTurnBasedConfirmBox;
 class AgentInfo;
+class PathfindingArena;
 
 enum class BattleUpdateSpeed
 {
@@ -115,6 +118,7 @@ class BattleView : public BattleTileView
 	std::vector<sp<Form>> uiTabsTB;
 	BattleUpdateSpeed updateSpeed;
 	BattleUpdateSpeed lastSpeed;
+	FixedStepClock updateClock;
 
 	// Units selected before control was taken away
 	std::list<StateRef<BattleUnit>> lastSelectedUnits;
@@ -197,7 +201,25 @@ class BattleView : public BattleTileView
 
 	void openAgentInventory();
 
+	// The path preview is searched for on a worker while the frame is drawn, and picked up by
+	// finishPathPreview() before the battle next updates, as the search reads the map
+	class PathPreviewSearch
+	{
+	  public:
+		StateRef<BattleUnit> unit;
+		// Tile under the cursor when the search started, the result is dropped if it has changed
+		Vec3<int> hoveredTile;
+		Vec3<int> target;
+		int costMultiplierX2 = 2;
+		float cost = 0.0f;
+		std::list<Vec3<int>> path;
+	};
+	up<PathPreviewSearch> pathPreviewSearch;
+	up<PathfindingArena> pathPreviewArena;
+	JobCounter pathPreviewJob;
+
 	void updatePathPreview();
+	void finishPathPreview();
 	void updateAttackCost();
 
 	void updateSquadIndex(StateRef<BattleUnit> u);
@@ -294,6 +294,27 @@ void CityTileView::eventOccurred(Event *e)
 	TileView::eventOccurred(e);
 }
 
+bool CityTileView::drawStaticChunk(Renderer &r, Vec2<int> chunk, int z, unsigned int layer)
+{
+	for (auto &tilePosition : chunkCache.getTiles(chunk))
+	{
+		auto tile = map.getTile(tilePosition.x, tilePosition.y, z);
+		if (tile->pathfindingDebugFlag)
+		{
+			return false;
+		}
+		for (auto &obj : tile->drawnObjects[layer])
+		{
+			if (obj->getType() != TileObject::Type::Scenery)
+			{
+				return false;
+			}
+			obj->draw(r, *this, tileToScreenCoords(obj->getCenter()), this->viewMode, true);
+		}
+	}
+	return true;
+}
+
 void CityTileView::render()
 {
 	TRACE_FN;
@@ -322,6 +343,11 @@ void CityTileView::render()
 	int minY = std::max(0, topRight.y);
 	int maxY = std::min(map.size.y, bottomLeft.y);
 
+	if (this->viewMode == TileViewMode::Isometric)
+	{
+		map.placeShadows({minX, minY}, {maxX, maxY});
+	}
+
 	switch (this->viewMode)
 	{
 		case TileViewMode::Isometric:
@@ -361,14 +387,54 @@ void CityTileView::render()
 				}
 			}
 
+			// The debug views change which scenery is shown, so scenery is drawn from the chunk
+			// cache only when none of them are on
+			bool cacheChunks = !DEBUG_SHOW_MISC_TYPE && DEBUG_LAYER < 0 && !DEBUG_SHOW_SLOPES &&
+			                   !DEBUG_SHOW_ROADS && !DEBUG_SHOW_TUBE;
+			auto visibleRows = getVisibleRows({minX, minY}, {maxX, maxY});
+			auto chunks = chunkCache.getChunks(minY, visibleRows);
+			auto screenOffset = getScreenOffset();
+			auto drawChunk = [this](Vec2<int> chunk, int z, unsigned int layer) {
+				return [this, chunk, z, layer](Renderer &chunkRenderer) {
+					return drawStaticChunk(chunkRenderer, chunk, z, layer);
+				};
+			};
+			// Images of the chunks are put together at once before any is drawn
+			if (cacheChunks && chunkCache.isEnabled())
+			{
+				std::vector<TileViewChunkCache::Request> chunkRequests;
+				for (int z = 0; z < maxZDraw; z++)
+				{
+					for (unsigned int layer = 0; layer < map.getLayerCount(); layer++)
+					{
+						for (auto &chunk : chunks)
+						{
+							chunkRequests.push_back(
+							    {chunk.position, z, layer, 0, drawChunk(chunk.position, z, layer)});
+						}
+					}
+				}
+				chunkCache.prepare(r, chunkRequests);
+			}
+			// Objects that only draw sprites are drawn a batch at a time
+			RendererSpriteBatch batch(r);
+
 			for (int z = 0; z < maxZDraw; z++)
 			{
 				for (unsigned int layer = 0; layer < map.getLayerCount(); layer++)
 				{
-					for (int y = minY; y < maxY; y++)
+					for (auto &chunk : chunks)
 					{
-						for (int x = minX; x < maxX; x++)
+						if (cacheChunks &&
+						    chunkCache.draw(batch.flush(), chunk.position, z, layer, 0, screenOffset,
+						                    drawChunk(chunk.position, z, layer)))
 						{
+							continue;
+						}
+						for (auto &tilePosition : chunk.tiles)
+						{
+							int x = tilePosition.x;
+							int y = tilePosition.y;
 							auto tile = map.getTile(x, y, z);
 							auto object_count = tile->drawnObjects[layer].size();
 							for (size_t obj_id = 0; obj_id < object_count; obj_id++)
@@ -497,16 +563,20 @@ void CityTileView::render()
 										break;
 								}
 
-								obj->draw(r, *this, pos, this->viewMode, visible);
+								if (!obj->addSprites(batch, pos, this->viewMode, visible))
+								{
+									obj->draw(batch.flush(), *this, pos, this->viewMode, visible);
+								}
 							}
 							if (tile->pathfindingDebugFlag)
-								r.draw(selectedTileImageFront,
-								       tileToOffsetScreenCoords(Vec3<int>{x, y, z}) -
-								           selectedTileImageOffset);
+								batch.add(selectedTileImageFront,
+								          tileToOffsetScreenCoords(Vec3<int>{x, y, z}) -
+								              selectedTileImageOffset);
 						}
 					}
 				}
 			}
+			batch.flush();
 
 			// Draw agents
 			for (auto &a : state.agents)
@@ -553,6 +623,7 @@ void CityTileView::render()
 			std::set<sp<Building>> buildingsSelected;
 			// Lines to draw between unit and destination, bool is wether target x is drawn
 			std::list<std::tuple<Vec3<float>, Vec3<float>, bool, bool>> targetLocationsToDraw;
+			RendererSpriteBatch batch(r);
 
 			for (int z = 0; z < maxZDraw; z++)
 			{
@@ -607,13 +678,17 @@ void CityTileView::render()
 										break;
 								}
 
-								obj->draw(r, *this, pos, this->viewMode, true, 0, friendly,
-								          hostile);
+								if (!obj->addSprites(batch, pos, this->viewMode, true))
+								{
+									obj->draw(batch.flush(), *this, pos, this->viewMode, true, 0,
+									          friendly, hostile);
+								}
 							}
 						}
 					}
 				}
 			}
+			batch.flush();
 
 			// Bases
 			static const Colour PLAYER_BASE_OWNED{188, 212, 88};
@@ -984,6 +1059,8 @@ void CityTileView::render()
 		}
 		break;
 	}
+
+	drawHeatMap(r, {minX, minY}, {maxX, maxY});
 }
 
 void CityTileView::update()
@@ -1029,7 +1106,9 @@ void CityTileView::update()
 
 		// recalc interpolated_palette every 2 minute
 		interpolated_palette_minute[colorCurrent] = minute;
-		mod_interpolated_palette[colorCurrent]->rendererPrivateData = nullptr;
+		// A new palette rather than changing this one, which may still be waiting to be drawn with
+		mod_interpolated_palette[colorCurrent] = mksp<Palette>();
+		this->pal = this->mod_interpolated_palette[colorCurrent];
 
 		sp<Palette> palette1;
 		sp<Palette> palette2;
@@ -72,5 +72,9 @@ class CityTileView : public TileView
 	Vec2<int> selectedTileImageOffset;
 	Colour alienDetectionColour;
 	float alienDetectionThickness;
+
+	// Draws the scenery on the chunk for the chunk cache, returning false if there is anything
+	// else on it
+	bool drawStaticChunk(Renderer &r, Vec2<int> chunk, int z, unsigned int layer);
 };
 }
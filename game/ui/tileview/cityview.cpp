@@ -869,7 +869,9 @@ CityView::CityView(sp<GameState> state)
                    Vec2<int>{STRAT_TILE_X, STRAT_TILE_Y}, TileViewMode::Isometric,
                    state->current_city->cityViewScreenCenter, *state),
       baseForm(ui().getForm("city/city")), overlayTab(ui().getForm("city/overlay")),
-      updateSpeed(CityUpdateSpeed::Speed1), lastSpeed(CityUpdateSpeed::Pause), state(state),
+      updateSpeed(CityUpdateSpeed::Speed1), lastSpeed(CityUpdateSpeed::Pause),
+      updateClock(std::chrono::microseconds(1000000 / UPDATES_PER_SECOND), MAX_UPDATES_PER_FRAME),
+      state(state),
       followVehicle(false), selectionState(CitySelectionState::Normal)
 {
 	weaponType.resize(3);
@@ -1514,6 +1516,40 @@ void CityView::begin()
 {
 	vanillaControls = !config().getBool("OpenApoc.NewFeature.OpenApocCityControls");
 	CityTileView::begin();
+
+	// Get the sprites of the city and of the vehicles in it ready all at once, rather than
+	// stalling the first frames on each as it is first drawn
+	std::vector<sp<Image>> images;
+	for (auto &tileType : state->current_city->tile_types)
+	{
+		images.push_back(tileType.second->sprite);
+		images.push_back(tileType.second->strategySprite);
+		images.push_back(tileType.second->overlaySprite);
+	}
+	std::set<const VehicleType *> addedTypes;
+	for (auto &vehicle : state->vehicles)
+	{
+		auto &type = vehicle.second->type;
+		if (vehicle.second->city != state->current_city || !addedTypes.insert(&*type).second)
+		{
+			continue;
+		}
+		for (auto &banking : type->directional_sprites)
+		{
+			for (auto &sprite : banking.second)
+			{
+				images.push_back(sprite.second);
+			}
+		}
+		for (auto &sprite : type->directional_shadow_sprites)
+		{
+			images.push_back(sprite.second);
+		}
+		images.insert(images.end(), type->animation_sprites.begin(), type->animation_sprites.end());
+		images.push_back(type->crashed_sprite);
+	}
+	fw().renderer->preload(images);
+
 	if (state->newGame)
 	{
 		state->newGame = false;
@@ -1526,6 +1562,7 @@ void CityView::resume()
 {
 	vanillaControls = !config().getBool("OpenApoc.NewFeature.OpenApocCityControls");
 	state->skipTurboCalculations = config().getBool("OpenApoc.NewFeature.SkipTurboMovement");
+	updateClock.reset();
 	CityTileView::resume();
 	modifierLAlt = false;
 	modifierLCtrl = false;
@@ -1737,6 +1774,14 @@ void CityView::update()
 	}
 	baseForm->findControl("BUTTON_SPEED5")->Enabled = this->state->canTurbo();
 
+	// Asked every frame, so that time spent paused or in turbo is not made up for afterwards
+	auto steps = updateClock.getSteps();
+	unsigned int ticksPerStep = ticks;
+	if (config().getBool("OpenApoc.NewFeature.FixedUpdateRate"))
+	{
+		ticks *= steps;
+	}
+
 	if (turbo)
 	{
 		this->state->updateTurbo();
@@ -1749,7 +1794,7 @@ void CityView::update()
 	{
 		while (ticks > 0)
 		{
-			int ticksPerUpdate = UPDATE_EVERY_TICK ? 1 : ticks;
+			int ticksPerUpdate = UPDATE_EVERY_TICK ? 1 : ticksPerStep;
 			state->update(ticksPerUpdate);
 			ticks -= ticksPerUpdate;
 		}
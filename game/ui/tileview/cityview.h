@@ -2,6 +2,7 @@
 
 #include "game/state/stateobject.h"
 #include "game/ui/tileview/citytileview.h"
+#include "library/fixedstepclock.h"
 #include "library/sp.h"
 #include <map>
 #include <vector>
@@ -57,6 +58,7 @@ class CityView : public CityTileView
 	std::vector<sp<GraphicButton>> miniViews;
 	CityUpdateSpeed updateSpeed;
 	CityUpdateSpeed lastSpeed;
+	FixedStepClock updateClock;
 
 	sp<GameState> state;
 
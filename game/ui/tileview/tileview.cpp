@@ -6,17 +6,31 @@
 #include "framework/renderer.h"
 #include "framework/sound.h"
 #include "game/state/battle/battle.h"
+#include <algorithm>
+#include <cmath>
 
 namespace OpenApoc
 {
 
+namespace
+{
+ConfigOptionInt heatMapOption("Game", "HeatMap",
+                              "Tint tiles by the work done on them: 0 off, 1 pathfinding nodes, "
+                              "2 tiles lines went through, 3 vision refreshes",
+                              0);
+const Colour HEAT_MAP_COLOUR = {255, 0, 0, 255};
+const int HEAT_MAP_MAX_ALPHA = 160;
+} // anonymous namespace
+
+constexpr std::chrono::seconds TileView::HEAT_MAP_PERIOD;
+
 TileView::TileView(TileMap &map, Vec3<int> isoTileSize, Vec2<int> stratTileSize,
                    TileViewMode initialMode)
     : Stage(), map(map), isoTileSize(isoTileSize), stratTileSize(stratTileSize),
       viewMode(initialMode), scrollUpKB(false), scrollDownKB(false), scrollLeftKB(false),
       scrollRightKB(false), dpySize(fw().displayGetWidth(), fw().displayGetHeight()),
       strategyViewBoxColour(212, 176, 172, 255), strategyViewBoxThickness(2.0f),
-      selectedTilePosition(0, 0, 0), maxZDraw(map.size.z), centerPos(0, 0, 0),
+      selectedTilePosition(0, 0, 0), chunkCache(map), maxZDraw(map.size.z), centerPos(0, 0, 0),
       isoScrollSpeed(0.5, 0.5), stratScrollSpeed(2.0f, 2.0f)
 {
 	LogInfo("dpySize: %s", dpySize);
@@ -131,7 +145,12 @@ void TileView::eventOccurred(Event *e)
 
 bool TileView::isTransition() { return false; }
 
-void TileView::setViewMode(TileViewMode newMode) { this->viewMode = newMode; }
+void TileView::setViewMode(TileViewMode newMode)
+{
+	this->viewMode = newMode;
+	// Only isometric views are drawn from it
+	chunkCache.clear();
+}
 
 TileViewMode TileView::getViewMode() const { return this->viewMode; }
 
@@ -142,6 +161,40 @@ Vec2<int> TileView::getScreenOffset() const
 	return Vec2<int>{dpySize.x / 2 - screenOffset.x, dpySize.y / 2 - screenOffset.y};
 }
 
+std::vector<Vec2<int>> TileView::getVisibleRows(Vec2<int> min, Vec2<int> max) const
+{
+	std::vector<Vec2<int>> rows;
+	if (min.y >= max.y)
+	{
+		return rows;
+	}
+	rows.assign(max.y - min.y, Vec2<int>{min.x, max.x});
+	if (this->viewMode != TileViewMode::Isometric)
+	{
+		return rows;
+	}
+	// The same screen corners the bounds are worked out from. Going across the screen x - y goes
+	// up, and going down it, or to higher levels, x + y goes up
+	auto topLeft = offsetScreenToTileCoords(
+	    Vec2<float>{Vec2<int>{-isoTileSize.x, -isoTileSize.y}}, 0.0f, TileViewMode::Isometric);
+	auto topRight = offsetScreenToTileCoords(Vec2<float>{Vec2<int>{dpySize.x, -isoTileSize.y}},
+	                                         0.0f, TileViewMode::Isometric);
+	auto bottomRight = offsetScreenToTileCoords(Vec2<float>{dpySize}, (float)map.size.z,
+	                                            TileViewMode::Isometric);
+	float minDifference = topLeft.x - topLeft.y;
+	float maxDifference = topRight.x - topRight.y;
+	float minSum = topLeft.x + topLeft.y;
+	float maxSum = bottomRight.x + bottomRight.y;
+	for (int y = min.y; y < max.y; y++)
+	{
+		auto &row = rows[y - min.y];
+		// A tile more either side makes up for rounding, same as the bounds
+		row.x = std::max(row.x, (int)std::floor(std::max(y + minDifference, minSum - y)) - 1);
+		row.y = std::min(row.y, (int)std::ceil(std::min(y + maxDifference, maxSum - y)) + 2);
+	}
+	return rows;
+}
+
 void TileView::setScreenCenterTile(Vec3<float> center)
 {
 	fw().soundBackend->setListenerPosition({center.x, center.y, map.size.z / 2});
@@ -287,5 +340,63 @@ void TileView::renderStrategyOverlay(Renderer &r)
 	}
 }
 
+void TileView::drawHeatMap(Renderer &r, Vec2<int> min, Vec2<int> max)
+{
+	int kind = heatMapOption.get();
+	if (kind < 1 || kind > TileMap::HEAT_KIND_COUNT)
+	{
+		if (heatMapKind != 0)
+		{
+			map.setHeatRecording(false);
+			heatMapKind = 0;
+			heatMap.clear();
+		}
+		return;
+	}
+	auto now = std::chrono::steady_clock::now();
+	if (kind != heatMapKind)
+	{
+		// Start from nothing, rather than from whatever the last kind left counted
+		map.setHeatRecording(true);
+		map.takeHeat((TileMap::HeatKind)(kind - 1));
+		heatMapKind = kind;
+		heatMap.clear();
+		heatMapTaken = now;
+	}
+	else if (now - heatMapTaken >= HEAT_MAP_PERIOD)
+	{
+		heatMap = map.takeHeat((TileMap::HeatKind)(kind - 1));
+		heatMapMost = heatMap.empty() ? 0 : *std::max_element(heatMap.begin(), heatMap.end());
+		heatMapTaken = now;
+	}
+	if (heatMapMost == 0 || heatMap.size() != (size_t)(map.size.x * map.size.y * map.size.z))
+	{
+		return;
+	}
+
+	Vec2<float> size = viewMode == TileViewMode::Isometric
+	                       ? Vec2<float>{isoTileSize.x / 2, isoTileSize.y / 2}
+	                       : Vec2<float>{stratTileSize.x, stratTileSize.y};
+	int maxZ = viewMode == TileViewMode::Isometric ? std::min(maxZDraw, map.size.z) : map.size.z;
+	for (int z = 0; z < maxZ; z++)
+	{
+		for (int y = min.y; y < max.y; y++)
+		{
+			for (int x = min.x; x < max.x; x++)
+			{
+				auto count = heatMap[(z * map.size.y + y) * map.size.x + x];
+				if (count == 0)
+				{
+					continue;
+				}
+				Colour colour = HEAT_MAP_COLOUR;
+				colour.a = std::max<uint64_t>(1, (uint64_t)count * HEAT_MAP_MAX_ALPHA / heatMapMost);
+				Vec2<float> pos = tileToOffsetScreenCoords(Vec3<float>{x + 0.5f, y + 0.5f, z});
+				r.drawFilledRect(pos - size / 2.0f, size, colour);
+			}
+		}
+	}
+}
+
 void TileView::update() { applyScrolling(); }
 }; // namespace OpenApoc
@@ -3,9 +3,12 @@
 #include "framework/logger.h"
 #include "framework/stage.h"
 #include "game/state/tilemap/tilemap.h"
+#include "game/ui/tileview/tileviewchunkcache.h"
 #include "library/colour.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <chrono>
+#include <vector>
 
 #define STRAT_TILE_X 8
 #define STRAT_TILE_Y 8
@@ -16,6 +19,7 @@ namespace OpenApoc
 class TileMap;
 class Image;
 class Palette;
+class Renderer;
 
 class TileView : public Stage, public TileTransform
 {
@@ -54,6 +58,25 @@ class TileView : public Stage, public TileTransform
 
 	bool debugHotkeyMode = false;
 
+	// Images of the chunks of the map nothing moves on, to draw each of those in one go
+	TileViewChunkCache chunkCache;
+
+	// For each row of tiles from min.y to max.y, the range of x (exclusive at the end) of the
+	// tiles within min to max that may show on screen at any level. In isometric view the screen
+	// only covers a diamond of the rectangle around it, so the rows are cut down to that
+	std::vector<Vec2<int>> getVisibleRows(Vec2<int> min, Vec2<int> max) const;
+
+	// Counts of the heat map option's kind of work over the last HEAT_MAP_PERIOD, and the most
+	// of them on any one tile
+	static constexpr std::chrono::seconds HEAT_MAP_PERIOD{2};
+	int heatMapKind = 0;
+	std::vector<unsigned int> heatMap;
+	unsigned int heatMapMost = 0;
+	std::chrono::steady_clock::time_point heatMapTaken;
+	// Tints every tile within min to max by how much work was done on it, if the heat map option
+	// is set
+	void drawHeatMap(Renderer &r, Vec2<int> min, Vec2<int> max);
+
   public:
 	int maxZDraw;
 	Vec3<float> centerPos;
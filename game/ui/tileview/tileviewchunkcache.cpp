@@ -0,0 +1,416 @@
+#include "game/ui/tileview/tileviewchunkcache.h"
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/image.h"
+#include "framework/palette.h"
+#include "framework/renderer.h"
+#include "game/state/tilemap/tilemap.h"
+#include "library/colour.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace OpenApoc
+{
+
+ConfigOptionInt tileViewCacheSize(
+    "Game", "TileViewCacheSize",
+    "MiB of images of map chunks to keep for drawing them in one go (0 to draw every object)", 64);
+
+namespace
+{
+
+static const Colour COLOUR_UNTINTED = {255, 255, 255, 255};
+
+// Renderer that only takes note of the images drawn, for them to be put together into one
+class ChunkRenderer : public Renderer
+{
+  public:
+	class Draw
+	{
+	  public:
+		sp<PaletteImage> image;
+		Vec2<int> position;
+		bool black;
+	};
+
+	std::vector<Draw> draws;
+	// Set once anything is drawn that the images cannot hold
+	bool failed = false;
+
+	ChunkRenderer(sp<Palette> palette) : palette(palette) {}
+	~ChunkRenderer() override = default;
+
+	void clear(Colour) override { failed = true; }
+	void setPalette(sp<Palette> p) override { failed = failed || p != palette; }
+	sp<Palette> getPalette() override { return palette; }
+	void draw(sp<Image> i, Vec2<float> position) override { add(i, position, false); }
+	void drawRotated(sp<Image>, Vec2<float>, Vec2<float>, float) override { failed = true; }
+	void drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size, Scaler) override
+	{
+		if (size != Vec2<float>{i->size})
+		{
+			failed = true;
+			return;
+		}
+		add(i, position, false);
+	}
+	void drawTinted(sp<Image> i, Vec2<float> position, Colour tint) override
+	{
+		if (tint == COLOUR_UNTINTED)
+		{
+			add(i, position, false);
+		}
+		else if (tint == COLOUR_BLACK)
+		{
+			add(i, position, true);
+		}
+		else
+		{
+			failed = true;
+		}
+	}
+	void drawFilledRect(Vec2<float>, Vec2<float>, Colour) override { failed = true; }
+	void drawRect(Vec2<float>, Vec2<float>, Colour, float) override { failed = true; }
+	void drawLine(Vec2<float>, Vec2<float>, Colour, float) override { failed = true; }
+	void flush() override {}
+	UString getName() override { return "Tile view chunk"; }
+	sp<Surface> getDefaultSurface() override { return nullptr; }
+
+  private:
+	sp<Palette> palette;
+
+	void setSurface(sp<Surface>) override { failed = true; }
+	sp<Surface> getSurface() override { return nullptr; }
+
+	void add(sp<Image> i, Vec2<float> position, bool black)
+	{
+		if (auto lazyImage = std::dynamic_pointer_cast<LazyImage>(i))
+		{
+			i = lazyImage->getRealImage();
+		}
+		auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(i);
+		if (!paletteImage)
+		{
+			failed = true;
+			return;
+		}
+		draws.push_back({paletteImage,
+		                 Vec2<int>{std::floor(position.x + 0.5f), std::floor(position.y + 0.5f)},
+		                 black});
+	}
+};
+
+// Adds the tiles of chunk within the range of x of each row from firstRow, row by row
+void addTiles(std::vector<Vec2<int>> &tiles, Vec2<int> chunk, int firstRow,
+              const std::vector<Vec2<int>> &rows)
+{
+	static const int SIZE = TileMap::DRAW_CHUNK_SIZE;
+	int lastRow = firstRow + static_cast<int>(rows.size());
+	for (int y = std::max(firstRow, chunk.y * SIZE); y < std::min(lastRow, (chunk.y + 1) * SIZE);
+	     y++)
+	{
+		auto &row = rows[y - firstRow];
+		for (int x = std::max(row.x, chunk.x * SIZE); x < std::min(row.y, (chunk.x + 1) * SIZE);
+		     x++)
+		{
+			tiles.push_back({x, y});
+		}
+	}
+}
+
+int findBlackIndex(const Palette &palette)
+{
+	// Index 0 is always see through
+	for (unsigned int i = 1; i < palette.colours.size(); i++)
+	{
+		if (palette.colours[i] == COLOUR_BLACK)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Takes note of what drawChunk draws, setting cached to whether it can all go into an image, and
+// blackIndex to the index things tinted black are to be put in the image with, if any are
+void recordChunk(Renderer &r, const TileViewChunkCache::DrawChunk &drawChunk, bool &cached,
+                 int &blackIndex, std::vector<ChunkRenderer::Draw> &draws)
+{
+	cached = false;
+	blackIndex = -1;
+	auto palette = r.getPalette();
+	ChunkRenderer chunkRenderer(palette);
+	if (!drawChunk(chunkRenderer) || chunkRenderer.failed)
+	{
+		return;
+	}
+	for (auto &d : chunkRenderer.draws)
+	{
+		if (d.black)
+		{
+			blackIndex = palette ? findBlackIndex(*palette) : -1;
+			if (blackIndex == -1)
+			{
+				return;
+			}
+			break;
+		}
+	}
+	cached = true;
+	draws = std::move(chunkRenderer.draws);
+}
+
+// Puts together draws into one image, which only reads the images drawn so can be done on any
+// thread. Leaves image empty if nothing was drawn
+void composeChunk(const std::vector<ChunkRenderer::Draw> &draws, int blackIndex,
+                  sp<PaletteImage> &image, Vec2<int> &origin)
+{
+	if (draws.empty())
+	{
+		return;
+	}
+
+	Vec2<int> min = draws.front().position;
+	Vec2<int> max = min;
+	for (auto &d : draws)
+	{
+		min.x = std::min(min.x, d.position.x);
+		min.y = std::min(min.y, d.position.y);
+		max.x = std::max(max.x, d.position.x + static_cast<int>(d.image->size.x));
+		max.y = std::max(max.y, d.position.y + static_cast<int>(d.image->size.y));
+	}
+	origin = min;
+	image = mksp<PaletteImage>(Vec2<unsigned int>{max - min});
+	auto width = image->size.x;
+	PaletteImageLock writer(image, ImageLockUse::Write);
+	auto *pixels = static_cast<uint8_t *>(writer.getData());
+	for (auto &d : draws)
+	{
+		PaletteImageLock reader(d.image, ImageLockUse::Read);
+		auto *source = static_cast<const uint8_t *>(reader.getData());
+		auto sourceSize = d.image->size;
+		auto *destination = pixels + (d.position.y - min.y) * width + (d.position.x - min.x);
+		for (unsigned int y = 0; y < sourceSize.y; y++)
+		{
+			for (unsigned int x = 0; x < sourceSize.x; x++)
+			{
+				auto index = source[y * sourceSize.x + x];
+				// Index 0 is see through, so leaves whatever was drawn under it
+				if (index)
+				{
+					destination[y * width + x] = d.black ? blackIndex : index;
+				}
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
+TileViewChunkCache::TileViewChunkCache(TileMap &map)
+    : map(map), budget(static_cast<size_t>(std::max(0, tileViewCacheSize.get())) * 1024 * 1024)
+{
+}
+
+TileViewChunkCache::~TileViewChunkCache() = default;
+
+std::vector<TileViewChunk> TileViewChunkCache::getChunks(int firstRow,
+                                                         const std::vector<Vec2<int>> &rows) const
+{
+	std::vector<TileViewChunk> chunks;
+	int minX = std::numeric_limits<int>::max();
+	int maxX = std::numeric_limits<int>::min();
+	for (auto &row : rows)
+	{
+		if (row.x < row.y)
+		{
+			minX = std::min(minX, row.x);
+			maxX = std::max(maxX, row.y);
+		}
+	}
+	if (minX >= maxX)
+	{
+		return chunks;
+	}
+	static const int SIZE = TileMap::DRAW_CHUNK_SIZE;
+	int lastRow = firstRow + static_cast<int>(rows.size());
+	for (int chunkY = firstRow / SIZE; chunkY * SIZE < lastRow; chunkY++)
+	{
+		for (int chunkX = minX / SIZE; chunkX * SIZE < maxX; chunkX++)
+		{
+			TileViewChunk chunk;
+			chunk.position = {chunkX, chunkY};
+			addTiles(chunk.tiles, chunk.position, firstRow, rows);
+			if (!chunk.tiles.empty())
+			{
+				chunks.push_back(std::move(chunk));
+			}
+		}
+	}
+	return chunks;
+}
+
+std::vector<Vec2<int>> TileViewChunkCache::getTiles(Vec2<int> chunk) const
+{
+	std::vector<Vec2<int>> tiles;
+	std::vector<Vec2<int>> rows(map.size.y, Vec2<int>{0, map.size.x});
+	addTiles(tiles, chunk, 0, rows);
+	return tiles;
+}
+
+bool TileViewChunkCache::draw(Renderer &r, Vec2<int> chunk, int z, unsigned int layer,
+                              uint64_t signature, Vec2<int> offset, const DrawChunk &drawChunk)
+{
+	if (!isEnabled())
+	{
+		return false;
+	}
+	Key key{chunk.x, chunk.y, z, layer};
+	auto &entry = entries[key];
+	if (needsUpdate(r, key, entry, signature))
+	{
+		update(r, key, entry, signature, drawChunk);
+	}
+	if (!entry.cached)
+	{
+		return false;
+	}
+	if (entry.image)
+	{
+		r.draw(entry.image, Vec2<float>{entry.origin + offset});
+		recentlyDrawn.splice(recentlyDrawn.begin(), recentlyDrawn, entry.drawn);
+	}
+	return true;
+}
+
+void TileViewChunkCache::prepare(Renderer &r, const std::vector<Request> &requests)
+{
+	if (!isEnabled())
+	{
+		return;
+	}
+	class Pending
+	{
+	  public:
+		Key key;
+		Entry *entry;
+		std::vector<ChunkRenderer::Draw> draws;
+	};
+	std::vector<Pending> pending;
+	for (auto &request : requests)
+	{
+		Key key{request.chunk.x, request.chunk.y, request.z, request.layer};
+		auto &entry = entries[key];
+		if (!needsUpdate(r, key, entry, request.signature))
+		{
+			continue;
+		}
+		// Drawing into the ChunkRenderer goes through the objects, so stays on this thread
+		dropImage(entry);
+		markUpdated(key, entry, request.signature);
+		std::vector<ChunkRenderer::Draw> draws;
+		recordChunk(r, request.drawChunk, entry.cached, entry.blackIndex, draws);
+		if (!draws.empty())
+		{
+			pending.push_back({key, &entry, std::move(draws)});
+		}
+	}
+
+	// Every image only reads what it is made of and writes its own entry
+	auto compose = [&pending](unsigned int index, unsigned int) {
+		auto &p = pending[index];
+		composeChunk(p.draws, p.entry->blackIndex, p.entry->image, p.entry->origin);
+	};
+	auto framework = Framework::tryGetInstance();
+	if (framework && pending.size() > 1)
+	{
+		framework->threadPoolParallelFor(pending.size(), compose);
+	}
+	else
+	{
+		for (unsigned int index = 0; index < pending.size(); index++)
+		{
+			compose(index, 0);
+		}
+	}
+
+	for (auto &p : pending)
+	{
+		addImage(p.key, *p.entry);
+	}
+	// Entries may only be dropped once all are added, as pending points at them
+	trimToBudget();
+}
+
+void TileViewChunkCache::clear()
+{
+	entries.clear();
+	recentlyDrawn.clear();
+	imageBytes = 0;
+}
+
+bool TileViewChunkCache::needsUpdate(Renderer &r, const Key &key, const Entry &entry,
+                                     uint64_t signature) const
+{
+	auto revision = map.getDrawRevision({std::get<0>(key), std::get<1>(key), std::get<2>(key)});
+	// Palettes that fade between day and night may not keep black where it was
+	bool blackMoved = entry.blackIndex != -1 && r.getPalette() &&
+	                  r.getPalette()->getColour(entry.blackIndex) != COLOUR_BLACK;
+	return !entry.valid || entry.revision != revision || entry.signature != signature ||
+	       blackMoved;
+}
+
+void TileViewChunkCache::markUpdated(const Key &key, Entry &entry, uint64_t signature) const
+{
+	entry.valid = true;
+	entry.revision = map.getDrawRevision({std::get<0>(key), std::get<1>(key), std::get<2>(key)});
+	entry.signature = signature;
+}
+
+void TileViewChunkCache::update(Renderer &r, const Key &key, Entry &entry, uint64_t signature,
+                                const DrawChunk &drawChunk)
+{
+	dropImage(entry);
+	markUpdated(key, entry, signature);
+	std::vector<ChunkRenderer::Draw> draws;
+	recordChunk(r, drawChunk, entry.cached, entry.blackIndex, draws);
+	if (draws.empty())
+	{
+		return;
+	}
+	composeChunk(draws, entry.blackIndex, entry.image, entry.origin);
+	addImage(key, entry);
+	trimToBudget();
+}
+
+void TileViewChunkCache::addImage(const Key &key, Entry &entry)
+{
+	recentlyDrawn.push_front(key);
+	entry.drawn = recentlyDrawn.begin();
+	imageBytes += entry.image->size.x * entry.image->size.y;
+}
+
+void TileViewChunkCache::trimToBudget()
+{
+	// The image made last stays even past the budget, it is about to be drawn
+	while (imageBytes > budget && recentlyDrawn.size() > 1)
+	{
+		auto oldest = entries.find(recentlyDrawn.back());
+		dropImage(oldest->second);
+		entries.erase(oldest);
+	}
+}
+
+void TileViewChunkCache::dropImage(Entry &entry)
+{
+	if (!entry.image)
+	{
+		return;
+	}
+	imageBytes -= entry.image->size.x * entry.image->size.y;
+	recentlyDrawn.erase(entry.drawn);
+	entry.image = nullptr;
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "library/sp.h"
+#include "library/vec.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class PaletteImage;
+class Renderer;
+class TileMap;
+
+// Tiles of one chunk that are on screen, in the order they are drawn
+class TileViewChunk
+{
+  public:
+	// Measured in chunks, see TileMap::DRAW_CHUNK_SIZE
+	Vec2<int> position;
+	std::vector<Vec2<int>> tiles;
+};
+
+// Images of what is drawn on chunks of a tile map, one level and layer at a time, so that a chunk
+// nothing moves on is drawn with one image instead of every object on it every frame. The image
+// is drawn again only once the map's draw revision for the chunk, or the signature the view gives
+// for it, changes. Images are made of palette indices, so palettes that pulsate or fade look the
+// same on them as on the objects. Only plain draws of palette images and draws of them tinted
+// black can go into an image
+class TileViewChunkCache
+{
+  public:
+	// Draws what is on the chunk the way the view would with no screen offset, returning false if
+	// anything on it moves or otherwise has to be drawn every frame
+	using DrawChunk = std::function<bool(Renderer &r)>;
+
+	// A chunk to be drawn by draw(), with the same arguments
+	class Request
+	{
+	  public:
+		Vec2<int> chunk;
+		int z;
+		unsigned int layer;
+		uint64_t signature;
+		DrawChunk drawChunk;
+	};
+
+	TileViewChunkCache(TileMap &map);
+	~TileViewChunkCache();
+
+	// Chunks the tiles on screen fall in, in the order they are drawn, leaving out chunks with
+	// none. rows holds the range of x (exclusive at the end) on screen for each row of tiles
+	// from firstRow, see TileView::getVisibleRows(). Tiles must be drawn chunk by chunk for
+	// cached and uncached chunks to overlap properly, which draws each tile after every tile in
+	// front of which it is, same as going row by row
+	std::vector<TileViewChunk> getChunks(int firstRow, const std::vector<Vec2<int>> &rows) const;
+	// Every tile of the chunk on the map, in the order they are drawn
+	std::vector<Vec2<int>> getTiles(Vec2<int> chunk) const;
+
+	// Draws the image of chunk on level z at offset and returns true, drawing the image again
+	// with drawChunk first if needed, otherwise returns false for the caller to draw the chunk.
+	// drawChunk is only used when anything changed since it last was
+	bool draw(Renderer &r, Vec2<int> chunk, int z, unsigned int layer, uint64_t signature,
+	          Vec2<int> offset, const DrawChunk &drawChunk);
+
+	// Draws again the images of any of the chunks requests that draw() would draw again, putting
+	// them together on the thread pool instead of one at a time as they are drawn. Only an
+	// optimisation, so any chunk may be left out, as can any that end up not drawn
+	void prepare(Renderer &r, const std::vector<Request> &requests);
+
+	// Forgets every image, such as for when the view mode changes
+	void clear();
+
+	// False if the budget for images is 0, in which case nothing is ever drawn from the cache
+	bool isEnabled() const { return budget > 0; }
+
+  private:
+	using Key = std::tuple<int, int, int, unsigned int>;
+
+	class Entry
+	{
+	  public:
+		bool valid = false;
+		unsigned int revision = 0;
+		uint64_t signature = 0;
+		bool cached = false;
+		sp<PaletteImage> image;
+		Vec2<int> origin;
+		// Index things tinted black were drawn with, or -1 if none were
+		int blackIndex = -1;
+		// Where the entry is in recentlyDrawn, if it has an image
+		std::list<Key>::iterator drawn;
+	};
+
+	TileMap &map;
+	// In bytes
+	size_t budget;
+	size_t imageBytes = 0;
+	std::map<Key, Entry> entries;
+	// Entries with an image, most recently drawn first
+	std::list<Key> recentlyDrawn;
+
+	bool needsUpdate(Renderer &r, const Key &key, const Entry &entry, uint64_t signature) const;
+	void markUpdated(const Key &key, Entry &entry, uint64_t signature) const;
+	void update(Renderer &r, const Key &key, Entry &entry, uint64_t signature,
+	            const DrawChunk &drawChunk);
+	void addImage(const Key &key, Entry &entry);
+	// Drops the least recently drawn images until they fit in the budget
+	void trimToBudget();
+	void dropImage(Entry &entry);
+};
+
+}; // namespace OpenApoc
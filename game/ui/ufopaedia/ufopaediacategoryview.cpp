@@ -5,6 +5,7 @@
 #include "forms/listbox.h"
 #include "forms/textbutton.h"
 #include "forms/ui.h"
+#include "framework/data.h"
 #include "framework/event.h"
 #include "framework/font.h"
 #include "framework/framework.h"
@@ -151,6 +152,19 @@ void UfopaediaCategoryView::eventOccurred(Event *e)
 		}
 	}
 
+	if (e->type() == EVENT_FORM_INTERACTION && e->forms().EventFlag == FormEventType::MouseEnter &&
+	    e->forms().RaisedBy->Name == "ENTRY_SHORTCUT")
+	{
+		// Likely to be clicked next, so its background starts loading ahead of the others
+		auto entry = e->forms().RaisedBy->getData<UfopaediaEntry>();
+		if (entry && entry->background)
+		{
+			this->shortcutPrefetch =
+			    fw().data->prefetch({entry->background->path}, PrefetchPriority::High);
+		}
+		return;
+	}
+
 	if (e->type() == EVENT_FORM_INTERACTION && e->forms().EventFlag == FormEventType::ButtonClick)
 	{
 		if (e->forms().RaisedBy->Name == "BUTTON_QUIT")
@@ -237,6 +251,8 @@ void UfopaediaCategoryView::setFormData()
 	// Every time you we change the entry reset the info panel
 	menuform->findControl("INFORMATION_PANEL")->setVisible(false);
 
+	prefetchNeighbours();
+
 	setFormStats();
 }
 
@@ -529,42 +545,71 @@ void UfopaediaCategoryView::setFormStats()
 	}
 }
 
-void UfopaediaCategoryView::setNextTopic()
+std::map<UString, sp<UfopaediaEntry>>::iterator
+UfopaediaCategoryView::stepTopic(std::map<UString, sp<UfopaediaEntry>>::iterator it, bool forward)
 {
 	do
 	{
-		if (this->position_iterator == this->category->entries.end())
+		if (forward)
 		{
-			this->position_iterator = this->category->entries.begin();
+			if (it == this->category->entries.end())
+			{
+				it = this->category->entries.begin();
+			}
+			else
+			{
+				it++;
+			}
 		}
 		else
 		{
-			this->position_iterator++;
+			if (it == this->category->entries.begin())
+			{
+				it = this->category->entries.end();
+			}
+			else
+			{
+				it--;
+			}
 		}
 		// Loop until we find the end (which shows the category intro screen)
 		// or a visible entry
-	} while (this->position_iterator != this->category->entries.end() &&
-	         !this->position_iterator->second->isVisible());
-	this->setFormData();
-	return;
+	} while (it != this->category->entries.end() && !it->second->isVisible());
+	return it;
 }
 
-void UfopaediaCategoryView::setPreviousTopic()
+void UfopaediaCategoryView::prefetchNeighbours()
 {
-	do
+	std::vector<UString> paths;
+	for (auto forward : {true, false})
 	{
-		if (this->position_iterator == this->category->entries.begin())
+		auto it = this->stepTopic(this->position_iterator, forward);
+		if (it == this->position_iterator)
+		{
+			continue;
+		}
+		if (it == this->category->entries.end())
 		{
-			this->position_iterator = this->category->entries.end();
+			paths.push_back(this->category->background->path);
 		}
 		else
 		{
-			this->position_iterator--;
+			paths.push_back(it->second->background->path);
 		}
-		// Loop until we find the end (which shows the category intro screen)
-		// or a visible entry
-	} while (this->position_iterator != this->category->entries.end() &&
-	         !this->position_iterator->second->isVisible());
+	}
+	this->neighbourPrefetch = fw().data->prefetch(paths);
+}
+
+void UfopaediaCategoryView::setNextTopic()
+{
+	this->position_iterator = this->stepTopic(this->position_iterator, true);
+	this->setFormData();
+	return;
+}
+
+void UfopaediaCategoryView::setPreviousTopic()
+{
+	this->position_iterator = this->stepTopic(this->position_iterator, false);
 	this->setFormData();
 	return;
 }
@@ -8,6 +8,7 @@
 namespace OpenApoc
 {
 
+class DataPrefetch;
 class Form;
 class GameState;
 class Label;
@@ -27,10 +28,19 @@ class UfopaediaCategoryView : public Stage
 	// The iterator showing the current position of the entry within the category.
 	// When equal to category->entries.end() it will show the category description.
 	std::map<UString, sp<UfopaediaEntry>>::iterator position_iterator;
+	// Keeps the backgrounds of the topics either side of the current one loading
+	sp<DataPrefetch> neighbourPrefetch;
+	// Keeps the background of the topic whose shortcut the mouse is over loading
+	sp<DataPrefetch> shortcutPrefetch;
 
 	void setFormData();
 	void setFormStats();
 
+	// Returns the next or previous visible topic after it, which may be the category intro
+	std::map<UString, sp<UfopaediaEntry>>::iterator
+	stepTopic(std::map<UString, sp<UfopaediaEntry>>::iterator it, bool forward);
+	void prefetchNeighbours();
+
 	// Steps forward and backward.
 	void setNextTopic();
 	void setPreviousTopic();
@@ -1,10 +1,13 @@
 #include "game/ui/ufopaedia/ufopaediaview.h"
 #include "forms/form.h"
 #include "forms/ui.h"
+#include "framework/data.h"
 #include "framework/event.h"
 #include "framework/framework.h"
+#include "framework/image.h"
 #include "framework/keycodes.h"
 #include "game/state/gamestate.h"
+#include "game/state/rules/city/ufopaedia.h"
 #include "game/ui/ufopaedia/ufopaediacategoryview.h"
 #include "library/sp.h"
 
@@ -18,7 +21,18 @@ UfopaediaView::UfopaediaView(sp<GameState> state)
 
 UfopaediaView::~UfopaediaView() = default;
 
-void UfopaediaView::begin() {}
+void UfopaediaView::begin()
+{
+	std::vector<UString> paths;
+	for (auto &cat : state->ufopaedia)
+	{
+		if (cat.second->background)
+		{
+			paths.push_back(cat.second->background->path);
+		}
+	}
+	categoryPrefetch = fw().data->prefetch(paths, PrefetchPriority::Low);
+}
 
 void UfopaediaView::pause() {}
 
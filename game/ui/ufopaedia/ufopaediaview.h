@@ -8,12 +8,15 @@ namespace OpenApoc
 
 class GameState;
 class Form;
+class DataPrefetch;
 
 class UfopaediaView : public Stage
 {
   private:
 	sp<Form> menuform;
 	sp<GameState> state;
+	// Keeps the intro backgrounds of every category loading while the title is up
+	sp<DataPrefetch> categoryPrefetch;
 
   public:
 	UfopaediaView(sp<GameState> state);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "library/vec.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Positions kept as one array for each coordinate rather than as an array of vectors, so that the
+// kernels below go through contiguous values. The kernels keep their loops plain and without
+// branches that depend on the position, for the compiler to vectorise them
+template <typename T> class PositionBatch
+{
+  public:
+	std::vector<T> x;
+	std::vector<T> y;
+	std::vector<T> z;
+
+	size_t size() const { return x.size(); }
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+	}
+	void reserve(size_t count)
+	{
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+	}
+	void push_back(Vec3<T> position)
+	{
+		x.push_back(position.x);
+		y.push_back(position.y);
+		z.push_back(position.z);
+	}
+};
+
+// Sets out[i] to the squared length of (positions[i] - centre) * scale
+template <typename T>
+void distancesSquared(const PositionBatch<T> &positions, Vec3<T> centre, Vec3<T> scale, T *out)
+{
+	const T *x = positions.x.data();
+	const T *y = positions.y.data();
+	const T *z = positions.z.data();
+	// Read once, as out may alias anything the compiler knows of
+	size_t count = positions.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		T dx = (x[i] - centre.x) * scale.x;
+		T dy = (y[i] - centre.y) * scale.y;
+		T dz = (z[i] - centre.z) * scale.z;
+		out[i] = dx * dx + dy * dy + dz * dz;
+	}
+}
+
+// Clears keep[i] for every position which, on the XY plane, is further than the angle whose
+// cosine is cosHalfAngle from direction as seen from origin. Direction has to be of length 1.
+// Positions right at the origin are kept
+inline void keepWithinArcXY(const PositionBatch<float> &positions, Vec3<float> origin,
+                            Vec2<float> direction, float cosHalfAngle, uint8_t *keep)
+{
+	const float *x = positions.x.data();
+	const float *y = positions.y.data();
+	// Within the angle means dot >= cos * length, squared here so no square root is needed, the
+	// sign of the dot product telling the two sides of the right angle apart
+	float cosSquared = cosHalfAngle * cosHalfAngle;
+	size_t count = positions.size();
+	if (cosHalfAngle >= 0.0f)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float dx = x[i] - origin.x;
+			float dy = y[i] - origin.y;
+			float dot = dx * direction.x + dy * direction.y;
+			float bound = cosSquared * (dx * dx + dy * dy);
+			keep[i] &= ((dot >= 0.0f) & (dot * dot >= bound)) ? 1 : 0;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float dx = x[i] - origin.x;
+			float dy = y[i] - origin.y;
+			float dot = dx * direction.x + dy * direction.y;
+			float bound = cosSquared * (dx * dx + dy * dy);
+			keep[i] &= ((dot >= 0.0f) | (dot * dot <= bound)) ? 1 : 0;
+		}
+	}
+}
+
+// Clears keep[i] for every position seen from origin at more than the angle whose cosine is
+// cosMaxAngle above or below the XY plane. Positions right at the origin are kept
+inline void keepWithinElevation(const PositionBatch<float> &positions, Vec3<float> origin,
+                                float cosMaxAngle, uint8_t *keep)
+{
+	// Nothing is more than a right angle away from the plane
+	if (cosMaxAngle <= 0.0f)
+	{
+		return;
+	}
+	const float *x = positions.x.data();
+	const float *y = positions.y.data();
+	const float *z = positions.z.data();
+	float cosSquared = cosMaxAngle * cosMaxAngle;
+	size_t count = positions.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		float dx = x[i] - origin.x;
+		float dy = y[i] - origin.y;
+		float dz = z[i] - origin.z;
+		float lengthXY = dx * dx + dy * dy;
+		keep[i] &= lengthXY >= cosSquared * (lengthXY + dz * dz) ? 1 : 0;
+	}
+}
+
+}; // namespace OpenApoc
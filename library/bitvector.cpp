@@ -0,0 +1,100 @@
+#include "library/bitvector.h"
+
+namespace OpenApoc
+{
+
+const int BitVector::BITS_PER_WORD;
+
+BitVector::BitVector(size_t size, bool value)
+    : bitCount(size), words((size + BITS_PER_WORD - 1) / BITS_PER_WORD)
+{
+	if (value)
+	{
+		setAll();
+	}
+}
+
+void BitVector::set(size_t index, bool value)
+{
+	auto &word = this->words[index / BITS_PER_WORD];
+	auto mask = uint64_t{1} << (index % BITS_PER_WORD);
+	if (value)
+	{
+		word |= mask;
+	}
+	else
+	{
+		word &= ~mask;
+	}
+}
+
+void BitVector::setRange(size_t begin, size_t end, bool value)
+{
+	if (end > this->bitCount)
+	{
+		end = this->bitCount;
+	}
+	if (begin >= end)
+	{
+		return;
+	}
+	size_t firstWord = begin / BITS_PER_WORD;
+	size_t lastWord = (end - 1) / BITS_PER_WORD;
+	auto firstMask = ~uint64_t{0} << (begin % BITS_PER_WORD);
+	auto lastMask = ~uint64_t{0} >> (BITS_PER_WORD - 1 - (end - 1) % BITS_PER_WORD);
+	auto apply = [this, value](size_t i, uint64_t mask) {
+		if (value)
+		{
+			this->words[i] |= mask;
+		}
+		else
+		{
+			this->words[i] &= ~mask;
+		}
+	};
+	if (firstWord == lastWord)
+	{
+		apply(firstWord, firstMask & lastMask);
+		return;
+	}
+	apply(firstWord, firstMask);
+	for (size_t i = firstWord + 1; i < lastWord; i++)
+	{
+		this->words[i] = value ? ~uint64_t{0} : 0;
+	}
+	apply(lastWord, lastMask);
+}
+
+void BitVector::setAll(bool value) { setRange(0, this->bitCount, value); }
+
+std::vector<bool> BitVector::toBoolVector() const
+{
+	std::vector<bool> bools(this->bitCount);
+	for (size_t i = 0; i < this->bitCount; i++)
+	{
+		bools[i] = get(i);
+	}
+	return bools;
+}
+
+BitVector BitVector::fromBoolVector(const std::vector<bool> &bools)
+{
+	BitVector bits(bools.size());
+	for (size_t i = 0; i < bools.size(); i++)
+	{
+		if (bools[i])
+		{
+			bits.set(i, true);
+		}
+	}
+	return bits;
+}
+
+bool BitVector::operator==(const BitVector &other) const
+{
+	return this->bitCount == other.bitCount && this->words == other.words;
+}
+
+bool BitVector::operator!=(const BitVector &other) const { return !(*this == other); }
+
+}; // namespace OpenApoc
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// A vector of bools packed into 64 bit words, bit i % 64 of word i / 64 being bit i, so that runs
+// of bits can be set a word at a time. Bits past the end are always 0
+class BitVector
+{
+  public:
+	static const int BITS_PER_WORD = 64;
+
+	BitVector() = default;
+	BitVector(size_t size, bool value = false);
+
+	size_t size() const { return this->bitCount; }
+	bool get(size_t index) const
+	{
+		return (this->words[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+	}
+	void set(size_t index, bool value);
+	// Sets every bit from begin up to (but not including) end
+	void setRange(size_t begin, size_t end, bool value = true);
+	void setAll(bool value = true);
+
+	// Same bits as a plain std::vector<bool>, which is how they are saved
+	std::vector<bool> toBoolVector() const;
+	static BitVector fromBoolVector(const std::vector<bool> &bools);
+
+	bool operator==(const BitVector &other) const;
+	bool operator!=(const BitVector &other) const;
+
+  private:
+	size_t bitCount = 0;
+	std::vector<uint64_t> words;
+};
+
+}; // namespace OpenApoc
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+
+namespace OpenApoc
+{
+
+// Counts how many steps of a fixed length have passed since it was last asked, so that something
+// stepped from the render loop keeps the same pace whatever the frame rate. Time left over from a
+// step is kept for the next call, and no more than maxSteps are given at once, so that one slow
+// frame is not followed by a slower one trying to catch up
+class FixedStepClock
+{
+  public:
+	FixedStepClock(std::chrono::steady_clock::duration step, unsigned int maxSteps)
+	    : step(step), maxSteps(maxSteps), last(std::chrono::steady_clock::now())
+	{
+	}
+
+	unsigned int getSteps()
+	{
+		auto now = std::chrono::steady_clock::now();
+		owed += now - last;
+		last = now;
+		auto steps = static_cast<unsigned int>(owed / step);
+		if (steps >= maxSteps)
+		{
+			owed = {};
+			return maxSteps;
+		}
+		owed -= steps * step;
+		return steps;
+	}
+	// Forget the time passed so far, for after whatever is stepped has not been for a while
+	void reset()
+	{
+		owed = {};
+		last = std::chrono::steady_clock::now();
+	}
+
+  private:
+	std::chrono::steady_clock::duration step;
+	unsigned int maxSteps;
+	std::chrono::steady_clock::time_point last;
+	std::chrono::steady_clock::duration owed = {};
+};
+
+}; // namespace OpenApoc
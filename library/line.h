@@ -140,4 +140,116 @@ LineSegmentIterator<T, conservative> LineSegment<T, conservative>::end()
 	return LineSegmentIterator<T, conservative>(this->endPoint + this->inc, *this);
 }
 
+// What the visitor of walkLine() wants done after a voxel
+enum class LineVisit
+{
+	Continue,
+	// Leave out the rest of the voxels in the same tile, as the line never comes back to one
+	SkipTile,
+	Stop,
+};
+
+// Calls visit(point, tile) for every voxel of the line from start to end, the same voxels in the
+// same order as LineSegment<int, conservative> has, tile being point / tileSize. Unlike going
+// through LineSegment it keeps track of the tile as it steps rather than dividing for every
+// voxel, and once the visitor returns SkipTile steps through the rest of the tile without
+// calling it at all. Returns false if the visitor stopped it
+template <bool conservative, typename F>
+bool walkLine(Vec3<int> start, Vec3<int> end, Vec3<int> tileSize, F visit)
+{
+	// Set up the same as LineSegmentIterator, though kept as arrays so each axis can be stepped
+	// through in turn
+	int point[3] = {start.x, start.y, start.z};
+	int d[3] = {end.x - start.x, end.y - start.y, end.z - start.z};
+	int size[3] = {tileSize.x, tileSize.y, tileSize.z};
+	int inc[3], d2[3], err[3] = {0, 0, 0};
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inc[axis] = d[axis] < 0 ? -1 : 1;
+		d2[axis] = d[axis] < 0 ? -d[axis] * 2 : d[axis] * 2;
+	}
+	int major = 2;
+	if (d2[0] >= d2[1] && d2[0] >= d2[2])
+	{
+		major = 0;
+	}
+	else if (d2[1] >= d2[0] && d2[1] >= d2[2])
+	{
+		major = 1;
+	}
+	int dstep2 = d2[major];
+	d2[major] = 0;
+	int last = point[major] + d[major] + inc[major];
+
+	// Division rounds towards zero, so below zero the tile can't be kept track of the same way.
+	// Lines only ever go one way along each axis, so start and end tell if any of it is
+	bool divide = start.x < 0 || start.y < 0 || start.z < 0 || end.x < 0 || end.y < 0 || end.z < 0;
+	int tile[3], within[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		tile[axis] = point[axis] / size[axis];
+		within[axis] = point[axis] - tile[axis] * size[axis];
+	}
+	auto move = [&](int axis) {
+		point[axis] += inc[axis];
+		if (divide)
+		{
+			tile[axis] = point[axis] / size[axis];
+			return;
+		}
+		within[axis] += inc[axis];
+		if (within[axis] == size[axis])
+		{
+			within[axis] = 0;
+			tile[axis]++;
+		}
+		else if (within[axis] < 0)
+		{
+			within[axis] = size[axis] - 1;
+			tile[axis]--;
+		}
+	};
+	auto next = [&]() {
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (err[axis] > 0)
+			{
+				move(axis);
+				err[axis] -= dstep2;
+				if (conservative)
+				{
+					return;
+				}
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			err[axis] += d2[axis];
+		}
+		move(major);
+	};
+
+	while (point[major] != last)
+	{
+		auto action =
+		    visit(Vec3<int>{point[0], point[1], point[2]}, Vec3<int>{tile[0], tile[1], tile[2]});
+		if (action == LineVisit::Stop)
+		{
+			return false;
+		}
+		if (action == LineVisit::SkipTile)
+		{
+			int skipped[3] = {tile[0], tile[1], tile[2]};
+			do
+			{
+				next();
+			} while (point[major] != last && tile[0] == skipped[0] && tile[1] == skipped[1] &&
+			         tile[2] == skipped[2]);
+			continue;
+		}
+		next();
+	}
+	return true;
+}
+
 } // nammespace OpenApoc
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "library/sp.h"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Allocator that keeps the blocks it frees on a list, one list for every type it is rebound to,
+// and hands them out again instead of going to the heap. Meant for objects that are made and
+// thrown away all the time, like projectiles and doodads
+template <typename T> class PoolAllocator
+{
+  public:
+	using value_type = T;
+
+	// Most free blocks kept for one type, any more go back to the heap
+	static const size_t MAX_FREE_BLOCKS = 4096;
+
+	PoolAllocator() = default;
+	template <typename U> PoolAllocator(const PoolAllocator<U> &) {}
+
+	T *allocate(size_t n)
+	{
+		if (n == 1)
+		{
+			auto &pool = getPool();
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			if (!pool.blocks.empty())
+			{
+				auto block = pool.blocks.back();
+				pool.blocks.pop_back();
+				return static_cast<T *>(block);
+			}
+		}
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T *p, size_t n)
+	{
+		if (n == 1)
+		{
+			auto &pool = getPool();
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			if (pool.blocks.size() < MAX_FREE_BLOCKS)
+			{
+				pool.blocks.push_back(p);
+				return;
+			}
+		}
+		::operator delete(p);
+	}
+
+	template <typename U> bool operator==(const PoolAllocator<U> &) const { return true; }
+	template <typename U> bool operator!=(const PoolAllocator<U> &) const { return false; }
+
+  private:
+	class Pool
+	{
+	  public:
+		std::mutex mutex;
+		std::vector<void *> blocks;
+	};
+	// Never destroyed, so that objects freed while statics are torn down still have a pool
+	static Pool &getPool()
+	{
+		static Pool *pool = new Pool();
+		return *pool;
+	}
+};
+
+// Same as mksp, with the object and its reference count in one block from a PoolAllocator
+template <typename T, typename... Args> sp<T> mkpooled(Args &&... args)
+{
+	return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}; // namespace OpenApoc
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "library/sp.h"
+#include "library/strings.h"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Keeps alive the resources last used from all the caches that share it, so they stay cached when
+// nothing else holds on to them, as long as together they take no more than the budget in bytes.
+// Past that the ones used longest ago are let go
+class ResourceCacheBudget
+{
+  public:
+	ResourceCacheBudget(size_t budget) : budget(budget) {}
+
+	// Marks resource as just used, keeping it alive if it was not already. getBytes() is only
+	// called then, and what it returns is added to account for as long as resource is kept
+	template <typename GetBytes>
+	void use(sp<void> resource, std::atomic<size_t> &account, GetBytes getBytes)
+	{
+		std::vector<sp<void>> dropped;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto kept = keptByResource.find(resource.get());
+			if (kept != keptByResource.end())
+			{
+				entries.splice(entries.begin(), entries, kept->second);
+				return;
+			}
+			size_t bytes = getBytes();
+			entries.push_front({resource, bytes, &account});
+			keptByResource[resource.get()] = entries.begin();
+			account += bytes;
+			keptBytes += bytes;
+			while (keptBytes > budget && !entries.empty())
+			{
+				auto &oldest = entries.back();
+				*oldest.account -= oldest.bytes;
+				keptBytes -= oldest.bytes;
+				keptByResource.erase(oldest.resource.get());
+				// Freed once the lock is let go, in case a destructor goes back to a cache
+				dropped.push_back(std::move(oldest.resource));
+				entries.pop_back();
+			}
+		}
+	}
+
+	size_t getBudget() const { return budget; }
+
+  private:
+	class Entry
+	{
+	  public:
+		sp<void> resource;
+		size_t bytes;
+		std::atomic<size_t> *account;
+	};
+
+	size_t budget;
+	size_t keptBytes = 0;
+	std::mutex mutex;
+	// Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<const void *, std::list<Entry>::iterator> keptByResource;
+};
+
+// Cache of resources by name that may be used from any thread. Names are spread over shards that
+// each have their own lock, so looking one up never waits on another shard, and no lock is held
+// while a resource is loaded. Asking for a name that another thread is already loading waits for
+// that load instead of starting a second one. With a budget every resource used is kept alive
+// through it, getBytes telling what each one costs
+template <typename T> class ResourceCache
+{
+  public:
+	static const size_t SHARD_COUNT = 16;
+
+	ResourceCache(ResourceCacheBudget *budget = nullptr,
+	              std::function<size_t(const T &)> getBytes = nullptr)
+	    : budget(budget), getBytes(getBytes)
+	{
+	}
+
+	// Returns the resource cached for key, else whatever load() returns, which is cached unless
+	// null. load may use this cache for any other key, but not for key itself
+	template <typename Load> sp<T> get(const UString &key, Load load)
+	{
+		auto &shard = getShard(key);
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		auto cached = shard.resources.find(key);
+		if (cached != shard.resources.end())
+		{
+			if (auto resource = cached->second.lock())
+			{
+				lock.unlock();
+				hits++;
+				keep(resource);
+				return resource;
+			}
+		}
+		auto loading = shard.loading.find(key);
+		if (loading != shard.loading.end())
+		{
+			auto result = loading->second;
+			lock.unlock();
+			hits++;
+			return result.get();
+		}
+		misses++;
+
+		std::promise<sp<T>> promise;
+		shard.loading[key] = promise.get_future().share();
+		lock.unlock();
+
+		sp<T> resource;
+		try
+		{
+			resource = load();
+		}
+		catch (...)
+		{
+			lock.lock();
+			shard.loading.erase(key);
+			lock.unlock();
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+
+		lock.lock();
+		if (resource)
+		{
+			shard.resources[key] = resource;
+		}
+		shard.loading.erase(key);
+		lock.unlock();
+
+		if (resource)
+		{
+			keep(resource);
+		}
+		promise.set_value(resource);
+		return resource;
+	}
+
+	// Times a resource was found cached or already being loaded, and times it had to be loaded
+	unsigned long long getHits() const { return hits; }
+	unsigned long long getMisses() const { return misses; }
+	// Bytes of resources from this cache the budget keeps alive
+	size_t getKeptBytes() const { return keptBytes; }
+
+  private:
+	class Shard
+	{
+	  public:
+		std::mutex mutex;
+		std::map<UString, std::weak_ptr<T>> resources;
+		std::map<UString, std::shared_future<sp<T>>> loading;
+	};
+
+	Shard shards[SHARD_COUNT];
+	ResourceCacheBudget *budget;
+	std::function<size_t(const T &)> getBytes;
+	std::atomic<unsigned long long> hits{0};
+	std::atomic<unsigned long long> misses{0};
+	std::atomic<size_t> keptBytes{0};
+
+	void keep(const sp<T> &resource)
+	{
+		if (budget)
+		{
+			budget->use(resource, keptBytes, [this, &resource] { return getBytes(*resource); });
+		}
+	}
+
+	Shard &getShard(const UString &key)
+	{
+		return shards[std::hash<std::string>()(key.str()) % SHARD_COUNT];
+	}
+};
+
+}; // namespace OpenApoc
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "library/vec.h"
+#include <algorithm>
+
+namespace OpenApoc
+{
+
+// Recursive shadowcasting over a square grid, sweeping each of the eight octants around origin
+// row by row and only going on past an obstacle with the slopes it leaves uncovered.
+//
+// blockage(cell) tells what a cell does to sight going through it: less than 0 stops it, 0 lets
+// it through and anything above 0 is taken off the range left for whatever is behind the cell,
+// as smoke does. visit(cell, range) is called for every cell seen within radius, with the range
+// left along the lines it was seen by, possibly more than once for the same cell.
+template <typename Blockage, typename Visit> class Shadowcaster
+{
+  public:
+	Shadowcaster(Vec2<int> origin, Blockage blockage, Visit visit)
+	    : origin(origin), blockage(blockage), visit(visit)
+	{
+	}
+
+	void cast(int radius)
+	{
+		static const int multipliers[4][8] = {{1, 0, 0, -1, -1, 0, 0, 1},
+		                                      {0, 1, -1, 0, 0, -1, 1, 0},
+		                                      {0, 1, 1, 0, 0, -1, -1, 0},
+		                                      {1, 0, 0, 1, -1, 0, 0, -1}};
+		visit(origin, radius);
+		for (int octant = 0; octant < 8; octant++)
+		{
+			castOctant(1, 1.0f, 0.0f, radius, multipliers[0][octant], multipliers[1][octant],
+			           multipliers[2][octant], multipliers[3][octant]);
+		}
+	}
+
+  private:
+	Vec2<int> origin;
+	Blockage blockage;
+	Visit visit;
+
+	void castOctant(int row, float start, float end, int radius, int xx, int xy, int yx, int yy)
+	{
+		if (start < end)
+		{
+			return;
+		}
+		float newStart = 0.0f;
+		for (int j = row; j <= radius; j++)
+		{
+			int dy = -j;
+			bool blocked = false;
+			for (int dx = -j; dx <= 0; dx++)
+			{
+				float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+				float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+				if (start < rightSlope)
+				{
+					continue;
+				}
+				if (end > leftSlope)
+				{
+					break;
+				}
+				Vec2<int> cell = {origin.x + dx * xx + dy * xy, origin.y + dx * yx + dy * yy};
+				if (dx * dx + dy * dy <= radius * radius)
+				{
+					visit(cell, radius);
+				}
+				int cellBlockage = blockage(cell);
+				// What is behind is still seen, but from not as far
+				if (cellBlockage > 0 && radius - cellBlockage > j)
+				{
+					castOctant(j + 1, std::min(start, leftSlope), std::max(end, rightSlope),
+					           radius - cellBlockage, xx, xy, yx, yy);
+				}
+				if (blocked)
+				{
+					if (cellBlockage != 0)
+					{
+						newStart = rightSlope;
+						continue;
+					}
+					blocked = false;
+					start = newStart;
+				}
+				else if (cellBlockage != 0 && j < radius)
+				{
+					blocked = true;
+					castOctant(j + 1, start, leftSlope, radius, xx, xy, yx, yy);
+					newStart = rightSlope;
+				}
+			}
+			if (blocked)
+			{
+				break;
+			}
+		}
+	}
+};
+
+template <typename Blockage, typename Visit>
+void shadowcast(Vec2<int> origin, int radius, Blockage blockage, Visit visit)
+{
+	Shadowcaster<Blockage, Visit>(origin, blockage, visit).cast(radius);
+}
+
+}; // namespace OpenApoc
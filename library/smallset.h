@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// A set kept as a sorted array, stored within the set itself for up to inlineCount elements and
+// on the heap past that, for the many sets that rarely hold more than a few elements and would
+// otherwise allocate a tree node for every one, like those of the objects in each tile. Goes
+// through its elements in the same order std::set does. Unlike with std::set, inserting or
+// erasing invalidates every iterator, so anything that could change a set while going through it
+// has to go through a copy
+template <typename T, size_t inlineCount, typename Compare = std::less<T>> class SmallSet
+{
+  public:
+	using value_type = T;
+	using iterator = const T *;
+	using const_iterator = const T *;
+
+	SmallSet() = default;
+	SmallSet(const SmallSet &other) { *this = other; }
+	SmallSet(SmallSet &&other) { *this = std::move(other); }
+	~SmallSet() { clear(); }
+
+	SmallSet &operator=(const SmallSet &other)
+	{
+		if (this == &other)
+		{
+			return *this;
+		}
+		clear();
+		if (other.onHeap)
+		{
+			heap = other.heap;
+			onHeap = true;
+			return *this;
+		}
+		for (size_t i = 0; i < other.inlineSize; i++)
+		{
+			new (inlineAt(i)) T(other.inlineAt(i)[0]);
+		}
+		inlineSize = other.inlineSize;
+		return *this;
+	}
+	SmallSet &operator=(SmallSet &&other)
+	{
+		if (this == &other)
+		{
+			return *this;
+		}
+		clear();
+		if (other.onHeap)
+		{
+			heap = std::move(other.heap);
+			onHeap = true;
+		}
+		else
+		{
+			for (size_t i = 0; i < other.inlineSize; i++)
+			{
+				new (inlineAt(i)) T(std::move(other.inlineAt(i)[0]));
+			}
+			inlineSize = other.inlineSize;
+		}
+		other.clear();
+		return *this;
+	}
+
+	const T *begin() const { return data(); }
+	const T *end() const { return data() + size(); }
+	size_t size() const { return onHeap ? heap.size() : inlineSize; }
+	bool empty() const { return size() == 0; }
+
+	const T *find(const T &value) const
+	{
+		auto it = lowerBound(value);
+		return (it != end() && !Compare()(value, *it)) ? it : end();
+	}
+	size_t count(const T &value) const { return find(value) != end() ? 1 : 0; }
+
+	std::pair<const T *, bool> insert(const T &value)
+	{
+		auto it = lowerBound(value);
+		if (it != end() && !Compare()(value, *it))
+		{
+			return {it, false};
+		}
+		size_t index = it - begin();
+		if (!onHeap && inlineSize == inlineCount)
+		{
+			moveToHeap();
+		}
+		if (onHeap)
+		{
+			heap.insert(heap.begin() + index, value);
+			return {heap.data() + index, true};
+		}
+		// Shift everything from index up by one, then put the value in the gap
+		if (index == inlineSize)
+		{
+			new (inlineAt(inlineSize)) T(value);
+		}
+		else
+		{
+			new (inlineAt(inlineSize)) T(std::move(inlineAt(inlineSize - 1)[0]));
+			for (size_t i = inlineSize - 1; i > index; i--)
+			{
+				inlineAt(i)[0] = std::move(inlineAt(i - 1)[0]);
+			}
+			inlineAt(index)[0] = value;
+		}
+		inlineSize++;
+		return {inlineAt(index), true};
+	}
+
+	size_t erase(const T &value)
+	{
+		auto it = find(value);
+		if (it == end())
+		{
+			return 0;
+		}
+		size_t index = it - begin();
+		if (onHeap)
+		{
+			heap.erase(heap.begin() + index);
+			return 1;
+		}
+		for (size_t i = index; i + 1 < inlineSize; i++)
+		{
+			inlineAt(i)[0] = std::move(inlineAt(i + 1)[0]);
+		}
+		inlineAt(inlineSize - 1)->~T();
+		inlineSize--;
+		return 1;
+	}
+
+	void clear()
+	{
+		for (size_t i = 0; i < inlineSize; i++)
+		{
+			inlineAt(i)->~T();
+		}
+		inlineSize = 0;
+		heap.clear();
+		onHeap = false;
+	}
+
+  private:
+	typename std::aligned_storage<sizeof(T), alignof(T)>::type inlineStorage[inlineCount];
+	size_t inlineSize = 0;
+	// Once past inlineCount elements they all stay here until the set is cleared
+	std::vector<T> heap;
+	bool onHeap = false;
+
+	T *inlineAt(size_t index) { return reinterpret_cast<T *>(&inlineStorage[index]); }
+	const T *inlineAt(size_t index) const
+	{
+		return reinterpret_cast<const T *>(&inlineStorage[index]);
+	}
+	const T *data() const { return onHeap ? heap.data() : inlineAt(0); }
+	const T *lowerBound(const T &value) const
+	{
+		return std::lower_bound(begin(), end(), value, Compare());
+	}
+	void moveToHeap()
+	{
+		heap.reserve(inlineCount * 2);
+		for (size_t i = 0; i < inlineSize; i++)
+		{
+			heap.push_back(std::move(inlineAt(i)[0]));
+			inlineAt(i)->~T();
+		}
+		inlineSize = 0;
+		onHeap = true;
+	}
+};
+
+}; // namespace OpenApoc
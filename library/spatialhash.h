@@ -0,0 +1,104 @@
+#pragma once
+
+#include "library/vec.h"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Buckets values by position into square columns of cellSize, so that what is near a point can be
+// found without looking at everything else. Height is ignored, as maps are much flatter than they
+// are wide. Values are not moved with whatever they stand for, so the hash has to be rebuilt (or
+// the value inserted again) whenever that moves
+template <typename T> class SpatialHash
+{
+  public:
+	SpatialHash(float cellSize) : cellSize(cellSize) {}
+
+	void clear() { cells.clear(); }
+	void insert(Vec3<float> position, const T &value)
+	{
+		cells[getKey(getCell(position.x), getCell(position.y))].push_back(value);
+	}
+	// Takes out one of the values equal to value inserted at position, for a hash kept up to date
+	// as values move rather than rebuilt. Returns false if there was none there
+	bool erase(Vec3<float> position, const T &value)
+	{
+		auto cell = cells.find(getKey(getCell(position.x), getCell(position.y)));
+		if (cell == cells.end())
+		{
+			return false;
+		}
+		auto &values = cell->second;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			if (values[i] == value)
+			{
+				values[i] = std::move(values.back());
+				values.pop_back();
+				if (values.empty())
+				{
+					cells.erase(cell);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+	// Calls visit(value) for every value inserted within radius of centre on the XY plane, along
+	// with some further away, which the caller has to check for itself
+	template <typename F> void forEachNear(Vec3<float> centre, float radius, F visit) const
+	{
+		forEachIn({centre.x - radius, centre.y - radius}, {centre.x + radius, centre.y + radius},
+		          visit);
+	}
+	// Calls visit(value) for every value inserted within the box from min to max (inclusive) on
+	// the XY plane, along with some outside it, which the caller has to check for itself
+	template <typename F> void forEachIn(Vec2<float> min, Vec2<float> max, F visit) const
+	{
+		int xMin = getCell(min.x);
+		int xMax = getCell(max.x);
+		int yMin = getCell(min.y);
+		int yMax = getCell(max.y);
+		// Cheaper to go through everything there is than ask for many empty cells
+		if ((int64_t)(xMax - xMin + 1) * (yMax - yMin + 1) > (int64_t)cells.size())
+		{
+			for (auto &cell : cells)
+			{
+				for (auto &value : cell.second)
+				{
+					visit(value);
+				}
+			}
+			return;
+		}
+		for (int x = xMin; x <= xMax; x++)
+		{
+			for (int y = yMin; y <= yMax; y++)
+			{
+				auto cell = cells.find(getKey(x, y));
+				if (cell == cells.end())
+				{
+					continue;
+				}
+				for (auto &value : cell->second)
+				{
+					visit(value);
+				}
+			}
+		}
+	}
+
+  private:
+	float cellSize;
+	std::unordered_map<uint64_t, std::vector<T>> cells;
+
+	int getCell(float coordinate) const { return (int)std::floor(coordinate / cellSize); }
+	static uint64_t getKey(int x, int y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+};
+
+}; // namespace OpenApoc
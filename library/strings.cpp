@@ -242,6 +242,20 @@ UString &UString::operator+=(const UString &other)
 
 size_t UString::length() const
 {
+	// Most strings are all ASCII, where every byte is a code point
+	bool ascii = true;
+	for (auto c : this->u8Str)
+	{
+		if (c & 0b10000000)
+		{
+			ascii = false;
+			break;
+		}
+	}
+	if (ascii)
+	{
+		return this->u8Str.length();
+	}
 	size_t len = 0;
 	for (const auto &c : *this)
 		len++;
@@ -331,6 +345,11 @@ bool UString::endsWith(const UString &suffix) const
 	return boost::ends_with(str(), suffix.str());
 }
 
+bool UString::startsWith(const UString &prefix) const
+{
+	return boost::starts_with(str(), prefix.str());
+}
+
 UString::ConstIterator UString::begin() const { return UString::ConstIterator(*this, 0); }
 
 UString::ConstIterator UString::end() const
@@ -351,7 +370,9 @@ UString::ConstIterator UString::ConstIterator::operator++()
 
 bool UString::ConstIterator::operator!=(const UString::ConstIterator &other) const
 {
-	return (this->offset != other.offset || this->s != other.s);
+	// Iterators only ever meet ones over the same string, so that is not compared character by
+	// character
+	return (this->offset != other.offset || &this->s != &other.s);
 }
 
 UniChar UString::ConstIterator::operator*() const
@@ -60,6 +60,7 @@ class UString
 	int compare(const UString &str) const;
 
 	bool endsWith(const UString &suffix) const;
+	bool startsWith(const UString &prefix) const;
 
 	bool operator==(const UString &other) const;
 	bool operator!=(const UString &other) const;
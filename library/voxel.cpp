@@ -1,18 +1,16 @@
 #include "library/voxel.h"
+#include <algorithm>
+#include <functional>
 
 namespace OpenApoc
 {
 
-VoxelSlice::VoxelSlice(Vec2<int> size) : size(size), bits(size.x * size.y) {}
+const int VoxelSlice::BITS_PER_WORD;
 
-bool VoxelSlice::getBit(Vec2<int> pos) const
+VoxelSlice::VoxelSlice(Vec2<int> size)
+    : size(size), wordsPerRow((size.x + BITS_PER_WORD - 1) / BITS_PER_WORD),
+      words(wordsPerRow * size.y)
 {
-	if (pos.x < 0 || pos.x >= this->size.x || pos.y < 0 || pos.y >= this->size.y)
-	{
-		return false;
-	}
-
-	return this->bits[pos.y * this->size.x + pos.x];
 }
 
 void VoxelSlice::setBit(Vec2<int> pos, bool b)
@@ -21,25 +19,65 @@ void VoxelSlice::setBit(Vec2<int> pos, bool b)
 	{
 		return;
 	}
-	this->bits[pos.y * this->size.x + pos.x] = b;
+	auto &word = this->words[pos.y * this->wordsPerRow + pos.x / BITS_PER_WORD];
+	auto mask = uint64_t{1} << (pos.x % BITS_PER_WORD);
+	if (b)
+	{
+		word |= mask;
+	}
+	else
+	{
+		word &= ~mask;
+	}
 }
 
-VoxelMap::VoxelMap(Vec3<int> size) : size(size) { slices.resize(size.z); }
-
-bool VoxelMap::getBit(Vec3<int> pos) const
+bool VoxelSlice::anyBitInRow(int y, int xStart, int xEnd) const
 {
-	if (pos.x < 0 || pos.x >= this->size.x || pos.y < 0 || pos.y >= this->size.y || pos.z < 0 ||
-	    pos.z >= this->size.z)
+	if (y < 0 || y >= this->size.y)
 	{
 		return false;
 	}
-
-	if (slices.size() <= static_cast<unsigned>(pos.z))
-		return false;
-	if (!slices[pos.z])
+	xStart = std::max(xStart, 0);
+	xEnd = std::min(xEnd, this->size.x);
+	if (xStart >= xEnd)
+	{
 		return false;
+	}
+	auto *row = &this->words[y * this->wordsPerRow];
+	int firstWord = xStart / BITS_PER_WORD;
+	int lastWord = (xEnd - 1) / BITS_PER_WORD;
+	auto firstMask = ~uint64_t{0} << (xStart % BITS_PER_WORD);
+	auto lastMask = ~uint64_t{0} >> (BITS_PER_WORD - 1 - (xEnd - 1) % BITS_PER_WORD);
+	if (firstWord == lastWord)
+	{
+		return (row[firstWord] & firstMask & lastMask) != 0;
+	}
+	if (row[firstWord] & firstMask)
+	{
+		return true;
+	}
+	for (int i = firstWord + 1; i < lastWord; i++)
+	{
+		if (row[i])
+		{
+			return true;
+		}
+	}
+	return (row[lastWord] & lastMask) != 0;
+}
 
-	return slices[pos.z]->getBit({pos.x, pos.y});
+VoxelMap::VoxelMap(Vec3<int> size) : size(size) { slices.resize(size.z); }
+
+bool VoxelMap::anyBitInRow(int y, int z, int xStart, int xEnd) const
+{
+	if (z < 0 || z >= this->size.z || this->slices.size() <= static_cast<unsigned>(z) ||
+	    !this->slices[z])
+	{
+		return false;
+	}
+	// Bits past the map's own size don't count
+	return this->slices[z]->anyBitInRow(y < this->size.y ? y : -1, xStart,
+	                                    std::min(xEnd, this->size.x));
 }
 
 void VoxelMap::setSlice(int z, sp<VoxelSlice> slice)
@@ -107,9 +145,23 @@ void VoxelMap::calculateCentre()
 	}
 }
 
+size_t VoxelMap::getHash() const
+{
+	size_t hash = std::hash<int>()(this->size.x);
+	for (int value : {this->size.y, this->size.z})
+	{
+		hash = hash * 31 + std::hash<int>()(value);
+	}
+	for (auto &slice : this->slices)
+	{
+		hash = hash * 31 + (slice ? slice->getHash() : 0);
+	}
+	return hash;
+}
+
 bool VoxelMap::operator==(const VoxelMap &other) const
 {
-	if (this->size != other.size)
+	if (this->size != other.size || this->slices.size() != other.slices.size())
 	{
 		return false;
 	}
@@ -148,7 +200,8 @@ bool VoxelSlice::operator==(const VoxelSlice &other) const
 	{
 		return false;
 	}
-	if (this->bits != other.bits)
+	// Bits past the end of each row are always 0, so whole words can be compared
+	if (this->words != other.words)
 	{
 		return false;
 	}
@@ -159,12 +212,103 @@ bool VoxelSlice::operator!=(const VoxelSlice &other) const { return !(*this == o
 
 bool VoxelSlice::isEmpty() const
 {
-	for (const auto &bit : this->bits)
+	for (auto word : this->words)
 	{
-		if (bit)
+		if (word)
 			return false;
 	}
 	return true;
 }
 
+bool VoxelSlice::isFull() const
+{
+	if (this->size.x <= 0 || this->size.y <= 0)
+	{
+		return false;
+	}
+	// Bits past the end of a row are always 0
+	auto lastMask = ~uint64_t{0} >> (BITS_PER_WORD - 1 - (this->size.x - 1) % BITS_PER_WORD);
+	for (int y = 0; y < this->size.y; y++)
+	{
+		auto *row = &this->words[y * this->wordsPerRow];
+		for (int i = 0; i < this->wordsPerRow - 1; i++)
+		{
+			if (row[i] != ~uint64_t{0})
+			{
+				return false;
+			}
+		}
+		if (row[this->wordsPerRow - 1] != lastMask)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t VoxelSlice::getHash() const
+{
+	size_t hash = std::hash<int>()(this->size.x) * 31 + std::hash<int>()(this->size.y);
+	for (auto word : this->words)
+	{
+		hash = hash * 31 + std::hash<uint64_t>()(word);
+	}
+	return hash;
+}
+
+template <typename T>
+sp<T> VoxelPool::find(std::unordered_map<size_t, std::vector<std::weak_ptr<T>>> &pool,
+                      sp<T> object)
+{
+	auto &bucket = pool[object->getHash()];
+	for (auto it = bucket.begin(); it != bucket.end();)
+	{
+		auto stored = it->lock();
+		if (!stored)
+		{
+			it = bucket.erase(it);
+			continue;
+		}
+		if (*stored == *object)
+		{
+			return stored;
+		}
+		it++;
+	}
+	bucket.push_back(object);
+	return object;
+}
+
+sp<VoxelSlice> VoxelPool::intern(sp<VoxelSlice> slice)
+{
+	if (!slice)
+	{
+		return nullptr;
+	}
+	return find(this->slices, slice);
+}
+
+sp<VoxelMap> VoxelPool::intern(sp<VoxelMap> map)
+{
+	if (!map)
+	{
+		return nullptr;
+	}
+	for (auto &slice : map->slices)
+	{
+		if (slice && slice->isEmpty())
+		{
+			slice = nullptr;
+		}
+		slice = intern(slice);
+	}
+	return find(this->maps, map);
+}
+
+void VoxelPool::clear()
+{
+	this->slices.clear();
+	this->maps.clear();
+}
+
 } // namesapce OpenApoc
@@ -2,22 +2,45 @@
 #include "library/resource.h"
 #include "library/sp.h"
 #include "library/vec.h"
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 namespace OpenApoc
 {
 
+// Each row is packed into whole 64 bit words, bit x % 64 of word x / 64 being voxel x, so that a
+// run of voxels in a row can be tested with a single mask. Bits past the end of a row are always 0
 class VoxelSlice : public ResObject
 {
   public:
+	static const int BITS_PER_WORD = 64;
+
 	Vec2<int> size;
-	std::vector<bool> bits;
+	int wordsPerRow = 0;
+	std::vector<uint64_t> words;
 
-	bool getBit(Vec2<int> pos) const;
+	bool getBit(Vec2<int> pos) const
+	{
+		if (pos.x < 0 || pos.x >= this->size.x || pos.y < 0 || pos.y >= this->size.y)
+		{
+			return false;
+		}
+		return (this->words[pos.y * this->wordsPerRow + pos.x / BITS_PER_WORD] >>
+		        (pos.x % BITS_PER_WORD)) &
+		       1;
+	}
 	void setBit(Vec2<int> pos, bool b);
+	// Returns true if any voxel in row y from xStart up to (but not including) xEnd is set.
+	// The span is clipped to the slice
+	bool anyBitInRow(int y, int xStart, int xEnd) const;
 	const Vec2<int> &getSize() const { return this->size; }
 
 	bool isEmpty() const;
+	// True if every voxel is set, so nothing can pass through the slice
+	bool isFull() const;
+	// Hash of the contents, equal slices have equal hashes
+	size_t getHash() const;
 
 	bool operator==(const VoxelSlice &other) const;
 	bool operator!=(const VoxelSlice &other) const;
@@ -38,16 +61,54 @@ class VoxelMap
 
 	const Vec3<int> &getCentre();
 
-	bool getBit(Vec3<int> pos) const;
+	bool getBit(Vec3<int> pos) const
+	{
+		if (pos.x < 0 || pos.x >= this->size.x || pos.y < 0 || pos.y >= this->size.y ||
+		    pos.z < 0 || pos.z >= this->size.z ||
+		    this->slices.size() <= static_cast<unsigned>(pos.z))
+		{
+			return false;
+		}
+		auto &slice = this->slices[pos.z];
+		return slice && slice->getBit({pos.x, pos.y});
+	}
+	// Same as VoxelSlice::anyBitInRow for row y of slice z
+	bool anyBitInRow(int y, int z, int xStart, int xEnd) const;
 	void setSlice(int z, sp<VoxelSlice> slice);
 	void calculateCentre();
 
 	const Vec3<int> &getSize() const { return this->size; }
 
+	// Hash of the contents, equal maps have equal hashes
+	size_t getHash() const;
+
 	bool operator==(const VoxelMap &other) const;
 	bool operator!=(const VoxelMap &other) const;
 
 	VoxelMap(Vec3<int> size);
 	VoxelMap() = default;
 };
+
+// Keeps one copy of every distinct slice and map it is given, so that the same voxels are only
+// stored once no matter how many objects use them. Only holds weak references, so anything no
+// longer used is freed as usual.
+// Interned slices and maps are shared, and must not be changed afterwards
+class VoxelPool
+{
+  public:
+	// Returns the stored slice with the same contents, storing this one if there is none
+	sp<VoxelSlice> intern(sp<VoxelSlice> slice);
+	// Returns the stored map with the same contents, storing this one if there is none.
+	// Slices of the map are interned first, and empty ones dropped as a missing slice reads the
+	// same
+	sp<VoxelMap> intern(sp<VoxelMap> map);
+	void clear();
+
+  private:
+	template <typename T>
+	sp<T> find(std::unordered_map<size_t, std::vector<std::weak_ptr<T>>> &pool, sp<T> object);
+
+	std::unordered_map<size_t, std::vector<std::weak_ptr<VoxelSlice>>> slices;
+	std::unordered_map<size_t, std::vector<std::weak_ptr<VoxelMap>>> maps;
+};
 } // namespace OpenApoc
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <limits>
@@ -56,6 +57,42 @@ template <class T, uint64_t A = 23, uint64_t B = 18, uint64_t C = 5> class Xorsh
 		return static_cast<result_type>(s[1] + s0);
 	}
 
+	// Fills out with the next count values, the same as calling this count times but with the
+	// state kept in registers throughout, for loops that need many at once
+	void fill(result_type *out, size_t count)
+	{
+		uint64_t s0 = s[0];
+		uint64_t s1 = s[1];
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t x = s0;
+			s0 = s1;
+			x ^= x << A;
+			s1 = x ^ s1 ^ (x >> B) ^ (s1 >> C);
+			out[i] = static_cast<result_type>(s1 + s0);
+		}
+		s[0] = s0;
+		s[1] = s1;
+	}
+
+	// A generator of its own for stream, such as an entity's id or a task's index, made from the
+	// state this one is in without advancing it. The same state and stream always make the same
+	// generator, so tasks that each draw from their own give the same results however many threads
+	// run them, in whatever order. Draw from this one first whenever the streams are to differ from
+	// the last time they were split, such as once every tick
+	Xorshift128Plus<T, A, B, C> split(uint64_t stream) const
+	{
+		uint64_t state[2];
+		state[0] = splitmix64(s[0] ^ splitmix64(stream));
+		state[1] = splitmix64(s[1] ^ state[0]);
+		// An all zero state would only ever give zeros
+		if (state[0] == 0 && state[1] == 0)
+		{
+			state[0] = 1;
+		}
+		return Xorshift128Plus<T, A, B, C>(state);
+	}
+
 	bool operator==(const Xorshift128Plus<T, A, B, C> &other) const
 	{
 		return (this->s[0] == other.s[0] && this->s[1] == other.s[1]);
@@ -0,0 +1,235 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "game/state/battle/battle.h"
+#include "game/state/city/vehicle.h"
+#include "game/state/gamestate.h"
+#include "game/state/rules/city/vehicletype.h"
+#include "game/state/shared/agent.h"
+#include "game/state/shared/organisation.h"
+#include "game/state/tilemap/collision.h"
+#include "game/state/tilemap/tilemap.h"
+#include "library/line.h"
+#include "library/xorshift.h"
+#include <chrono>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <list>
+#include <utility>
+#include <vector>
+
+// Fires a fixed set of random rays through findCollision on a few battle maps, with and without
+// LOS and range checks, and reports how fast that went and how much of the map the rays covered.
+// Takes the same arguments as test_serialize. The rays only depend on the map and Bench.Seed, so
+// the output of two builds can be compared directly.
+
+using namespace OpenApoc;
+
+namespace
+{
+
+ConfigOptionInt iterationsOption("Bench", "Iterations", "Number of rays per suite", 1000000);
+ConfigOptionInt mapsOption("Bench", "Maps", "Number of battle maps to fire rays on", 3);
+ConfigOptionInt seedOption("Bench", "Seed", "Seed used to choose rays", 1);
+
+using Rays = std::vector<std::pair<Vec3<float>, Vec3<float>>>;
+
+Rays makeRays(const TileMap &map)
+{
+	Rays rays;
+	Xorshift128Plus<uint32_t> rng(seedOption.get());
+	auto randomPoint = [&rng, &map]() {
+		return Vec3<float>{randBoundsExclusive(rng, 0, map.size.x * 100) / 100.0f,
+		                   randBoundsExclusive(rng, 0, map.size.y * 100) / 100.0f,
+		                   randBoundsExclusive(rng, 0, map.size.z * 100) / 100.0f};
+	};
+	for (int i = 0; i < iterationsOption.get(); i++)
+	{
+		auto start = randomPoint();
+		auto end = randomPoint();
+		rays.emplace_back(start, end);
+	}
+	return rays;
+}
+
+// Walks the ray the way findCollision does, up to where it stopped, so that the work done can be
+// counted without slowing findCollision down
+void countRay(const TileMap &map, const std::pair<Vec3<float>, Vec3<float>> &ray,
+              const Collision &c, unsigned long long &voxels, unsigned long long &tiles)
+{
+	Vec3<float> tileSizef = map.voxelMapSize;
+	bool stopped = c || c.outOfRange;
+	Vec3<float> stopVoxel = c.position * tileSizef;
+	Vec3<int> startVoxel = ray.first * tileSizef;
+	Vec3<int> endVoxel = ray.second * tileSizef;
+	Vec3<int> lastTile = {-1, -1, -1};
+	auto visit = [&](const Vec3<int> &point, const Vec3<int> &tile) -> LineVisit {
+		if (!map.tileIsValid(tile))
+		{
+			return LineVisit::Stop;
+		}
+		voxels++;
+		if (tile != lastTile)
+		{
+			lastTile = tile;
+			tiles++;
+		}
+		if (stopped && glm::length(Vec3<float>{point} - stopVoxel) < 0.5f)
+		{
+			return LineVisit::Stop;
+		}
+		return LineVisit::Continue;
+	};
+	walkLine<true>(startVoxel, endVoxel, map.voxelMapSize, visit);
+}
+
+void runSuite(const UString &name, const TileMap &map, const Rays &rays,
+              const CollisionOptions &options)
+{
+	std::vector<Collision> collisions;
+	collisions.reserve(rays.size());
+	auto start = std::chrono::high_resolution_clock::now();
+	for (auto &ray : rays)
+	{
+		collisions.push_back(map.findCollision(ray.first, ray.second, options));
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	auto seconds = std::chrono::duration<double>(end - start).count();
+
+	unsigned long long voxels = 0;
+	unsigned long long tiles = 0;
+	unsigned int hits = 0;
+	unsigned int outOfRange = 0;
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		countRay(map, rays[i], collisions[i], voxels, tiles);
+		hits += collisions[i] ? 1 : 0;
+		outOfRange += collisions[i].outOfRange ? 1 : 0;
+	}
+
+	auto count = static_cast<double>(rays.size());
+	std::cout << format("%-16s rays %8u hits %8u out of range %8u | rays/s %12.0f | voxels/ray "
+	                    "%8.1f tiles/ray %6.1f\n",
+	                    name, static_cast<unsigned int>(rays.size()), hits, outOfRange,
+	                    seconds > 0.0 ? count / seconds : 0.0, voxels / count, tiles / count);
+}
+
+void benchBattle(Battle &battle)
+{
+	// Long enough for most rays to get out of range on the way
+	static const unsigned RANGE = 20;
+	auto &map = *battle.map;
+	auto rays = makeRays(map);
+	for (bool los : {false, true})
+	{
+		for (unsigned range : {0u, RANGE})
+		{
+			CollisionOptions options;
+			options.useLOS = los;
+			options.maxRange = range;
+			runSuite(format("%s%s", los ? "los" : "lof", range ? "_range" : ""), map, rays,
+			         options);
+		}
+	}
+}
+
+bool enterBattle(GameState &state, sp<VehicleType> vType)
+{
+	StateRef<Organisation> org = {&state, UString("ORG_ALIEN")};
+	LogInfo("Using vehicle map for \"%s\"", vType->name);
+	auto v = mksp<Vehicle>();
+	auto vID = Vehicle::generateObjectID(state);
+	v->type = {&state, vType};
+	v->name = format("%s %d", v->type->name, ++v->type->numCreated);
+	state.vehicles[vID] = v;
+
+	StateRef<Vehicle> enemyVehicle = {&state, vID};
+	StateRef<Vehicle> playerVehicle = {};
+	std::list<StateRef<Agent>> agents;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			agents.emplace_back(&state, a.second);
+		}
+	}
+
+	Battle::beginBattle(state, false, org, agents, nullptr, playerVehicle, enemyVehicle);
+	if (!state.current_battle)
+	{
+		LogError("Failed to begin battle");
+		return false;
+	}
+	Battle::enterBattle(state);
+	return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (gamestateName.empty() || commonName.empty())
+	{
+		std::cerr << "Must provide common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+
+	auto state = mksp<GameState>();
+	if (!state->loadGame(commonName))
+	{
+		LogError("Failed to load gamestate_common");
+		return EXIT_FAILURE;
+	}
+	if (!state->loadGame(gamestateName))
+	{
+		LogError("Failed to load supplied gamestate");
+		return EXIT_FAILURE;
+	}
+	state->startGame();
+	state->initState();
+	state->fillOrgStartingProperty();
+	state->fillPlayerStartingProperty();
+
+	std::vector<sp<VehicleType>> vehicleTypes;
+	for (auto &vTypePair : state->vehicle_types)
+	{
+		if (vTypePair.second->battle_map && (int)vehicleTypes.size() < mapsOption.get())
+		{
+			vehicleTypes.push_back(vTypePair.second);
+		}
+	}
+	if (vehicleTypes.empty())
+	{
+		LogError("No vehicle with BattleMap found");
+		return EXIT_FAILURE;
+	}
+
+	for (auto &vType : vehicleTypes)
+	{
+		if (!enterBattle(*state, vType))
+		{
+			return EXIT_FAILURE;
+		}
+		std::cout << format("Battle map %s:\n", vType->battle_map.id);
+		benchBattle(*state->current_battle);
+		Battle::finishBattle(*state);
+		Battle::exitBattle(*state);
+	}
+
+	return EXIT_SUCCESS;
+}
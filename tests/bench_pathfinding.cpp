@@ -0,0 +1,323 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "game/state/battle/battle.h"
+#include "game/state/battle/battleunit.h"
+#include "game/state/battle/battleunitmission.h"
+#include "game/state/city/airspacegraph.h"
+#include "game/state/city/city.h"
+#include "game/state/city/vehicle.h"
+#include "game/state/city/vehiclemission.h"
+#include "game/state/gamestate.h"
+#include "game/state/rules/city/vehicletype.h"
+#include "game/state/shared/agent.h"
+#include "game/state/shared/organisation.h"
+#include "game/state/tilemap/pathfinding.h"
+#include "game/state/tilemap/tilemap.h"
+#include "library/xorshift.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Replays a fixed corpus of origin/destination pairs through the pathfinders, on the city map and
+// on a battle map, and reports the work every search took. Takes the same arguments as
+// test_serialize. The corpus only depends on the map and Bench.Seed, so the output of two builds
+// can be compared directly. Searches log every route at info level, so logging to file should be
+// turned down (--Logger.FileLevel=2) unless that is to be measured as well.
+
+using namespace OpenApoc;
+
+namespace
+{
+std::atomic<unsigned long long> allocationCount{0};
+}
+
+void *operator new(size_t size)
+{
+	allocationCount++;
+	if (auto ptr = std::malloc(size ? size : 1))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+namespace
+{
+
+ConfigOptionInt pairsOption("Bench", "Pairs", "Number of origin/destination pairs per suite", 200);
+ConfigOptionInt seedOption("Bench", "Seed", "Seed used to choose origin/destination pairs", 1);
+
+using Corpus = std::vector<std::pair<Vec3<int>, Vec3<int>>>;
+
+Corpus makeCorpus(const std::vector<Vec3<int>> &positions)
+{
+	Corpus corpus;
+	if (positions.size() < 2)
+	{
+		return corpus;
+	}
+	Xorshift128Plus<uint32_t> rng(seedOption.get());
+	for (int i = 0; i < pairsOption.get(); i++)
+	{
+		auto origin = positions[randBoundsExclusive<size_t>(rng, 0, positions.size())];
+		auto destination = positions[randBoundsExclusive<size_t>(rng, 0, positions.size())];
+		corpus.emplace_back(origin, destination);
+	}
+	return corpus;
+}
+
+double getPercentile(const std::vector<double> &sorted, double percentile)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+	auto index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// Search is called with origin, destination and an arena it may use
+template <typename Search>
+void runSuite(const UString &name, TileMap &map, const Corpus &corpus, Search search)
+{
+	if (corpus.empty())
+	{
+		LogWarning("Suite %s has nothing to search, skipping", name);
+		return;
+	}
+	PathfindingArena arena;
+	std::vector<double> latencies;
+	unsigned long long allocations = 0;
+	unsigned long long pathLength = 0;
+	unsigned int found = 0;
+	auto expansionsBefore = map.getPathfindingExpansionCount();
+	for (auto &pair : corpus)
+	{
+		auto allocationsBefore = allocationCount.load();
+		auto start = std::chrono::high_resolution_clock::now();
+		auto path = search(pair.first, pair.second, arena);
+		auto end = std::chrono::high_resolution_clock::now();
+		allocations += allocationCount.load() - allocationsBefore;
+		latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+		if (!path.empty() && path.back() == pair.second)
+		{
+			found++;
+		}
+		pathLength += path.size();
+	}
+	auto expansions =
+	    map.getPathfindingExpansionCount() - expansionsBefore + arena.getExpansionCount();
+	std::sort(latencies.begin(), latencies.end());
+
+	auto count = static_cast<double>(corpus.size());
+	std::cout << format("%-24s searches %5u found %5u total length %8llu | expansions/search "
+	                    "%10.1f allocations/search %9.1f | latency us p50 %9.1f p90 %9.1f p99 "
+	                    "%9.1f max %9.1f\n",
+	                    name, static_cast<unsigned int>(corpus.size()), found, pathLength,
+	                    expansions / count, allocations / count, getPercentile(latencies, 50),
+	                    getPercentile(latencies, 90), getPercentile(latencies, 99),
+	                    latencies.back());
+}
+
+void benchCity(City &city)
+{
+	auto &map = *city.map;
+
+	// Ground vehicles start and end on roads
+	std::vector<Vec3<int>> roadPositions;
+	for (auto &segment : city.roadSegments)
+	{
+		for (auto &position : segment.tilePosition)
+		{
+			roadPositions.push_back(position);
+		}
+	}
+	auto roadCorpus = makeCorpus(roadPositions);
+	GroundVehicleTileHelper roadHelper{map, VehicleType::Type::Road, false};
+	runSuite("city_ground", map, roadCorpus,
+	         [&city, &roadHelper](Vec3<int> origin, Vec3<int> destination, PathfindingArena &) {
+		         return city.findShortestPath(origin, destination, roadHelper);
+		     });
+
+	// Flyers move anywhere in the air
+	std::vector<Vec3<int>> airPositions;
+	for (int z = 0; z < map.size.z; z++)
+	{
+		for (int y = 0; y < map.size.y; y++)
+		{
+			for (int x = 0; x < map.size.x; x++)
+			{
+				if (AirspaceGraph::getPassable(*map.getTile(x, y, z)))
+				{
+					airPositions.emplace_back(x, y, z);
+				}
+			}
+		}
+	}
+	auto airCorpus = makeCorpus(airPositions);
+	static const int FLYER_ITERATION_LIMIT = 20000;
+	FlyingVehicleTileHelper flyerHelper{map, VehicleType::Type::Flying, false, {1, 1}, 0};
+	runSuite("city_flyer", map, airCorpus,
+	         [&city, &flyerHelper](Vec3<int> origin, Vec3<int> destination,
+	                               PathfindingArena &arena) {
+		         return city.findShortestPath(origin, destination, FLYER_ITERATION_LIMIT,
+		                                      flyerHelper, &arena);
+		     });
+	runSuite("tilemap_city_flyer", map, airCorpus,
+	         [&map, &flyerHelper](Vec3<int> origin, Vec3<int> destination,
+	                              PathfindingArena &arena) {
+		         return map.findShortestPath(origin, destination, FLYER_ITERATION_LIMIT,
+		                                     flyerHelper, false, false, true, false, nullptr, 0.0f,
+		                                     &arena);
+		     });
+}
+
+void benchBattle(Battle &battle)
+{
+	auto &map = *battle.map;
+
+	std::vector<Vec3<int>> standPositions;
+	for (int z = 0; z < map.size.z; z++)
+	{
+		for (int y = 0; y < map.size.y; y++)
+		{
+			for (int x = 0; x < map.size.x; x++)
+			{
+				auto tile = map.getTile(x, y, z);
+				if (tile->getPassable(false, 32) && tile->getCanStand(false))
+				{
+					standPositions.emplace_back(x, y, z);
+				}
+			}
+		}
+	}
+	auto corpus = makeCorpus(standPositions);
+	static const int WALKER_ITERATION_LIMIT = 5000;
+	for (auto type : {BattleUnitType::SmallWalker, BattleUnitType::SmallFlyer})
+	{
+		BattleUnitTileHelper helper{map, type, true};
+		auto suffix = type == BattleUnitType::SmallWalker ? "walker" : "flyer";
+		runSuite(format("battle_%s", suffix), map, corpus,
+		         [&battle, &helper](Vec3<int> origin, Vec3<int> destination, PathfindingArena &) {
+			         return battle.findShortestPath(origin, destination, helper);
+			     });
+		runSuite(format("tilemap_battle_%s", suffix), map, corpus,
+		         [&map, &helper](Vec3<int> origin, Vec3<int> destination,
+		                         PathfindingArena &arena) {
+			         return map.findShortestPath(origin, destination, WALKER_ITERATION_LIMIT,
+			                                     helper, false, false, true, false, nullptr,
+			                                     0.0f, &arena);
+			     });
+	}
+}
+
+bool enterAnyBattle(GameState &state)
+{
+	StateRef<Organisation> org = {&state, UString("ORG_ALIEN")};
+	sp<VehicleType> vType;
+	for (auto &vTypePair : state.vehicle_types)
+	{
+		if (vTypePair.second->battle_map)
+		{
+			vType = vTypePair.second;
+			break;
+		}
+	}
+	if (!vType)
+	{
+		LogError("No vehicle with BattleMap found");
+		return false;
+	}
+	LogInfo("Using vehicle map for \"%s\"", vType->name);
+	auto v = mksp<Vehicle>();
+	auto vID = Vehicle::generateObjectID(state);
+	v->type = {&state, vType};
+	v->name = format("%s %d", v->type->name, ++v->type->numCreated);
+	state.vehicles[vID] = v;
+
+	StateRef<Vehicle> enemyVehicle = {&state, vID};
+	StateRef<Vehicle> playerVehicle = {};
+	std::list<StateRef<Agent>> agents;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			agents.emplace_back(&state, a.second);
+		}
+	}
+
+	Battle::beginBattle(state, false, org, agents, nullptr, playerVehicle, enemyVehicle);
+	if (!state.current_battle)
+	{
+		LogError("Failed to begin battle");
+		return false;
+	}
+	Battle::enterBattle(state);
+	return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (gamestateName.empty() || commonName.empty())
+	{
+		std::cerr << "Must provide common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+
+	auto state = mksp<GameState>();
+	if (!state->loadGame(commonName))
+	{
+		LogError("Failed to load gamestate_common");
+		return EXIT_FAILURE;
+	}
+	if (!state->loadGame(gamestateName))
+	{
+		LogError("Failed to load supplied gamestate");
+		return EXIT_FAILURE;
+	}
+	state->startGame();
+	state->initState();
+	state->fillOrgStartingProperty();
+	state->fillPlayerStartingProperty();
+
+	for (auto &city : state->cities)
+	{
+		std::cout << format("City %s:\n", city.first);
+		benchCity(*city.second);
+	}
+
+	if (!enterAnyBattle(*state))
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << format("Battle:\n");
+	benchBattle(*state->current_battle);
+	Battle::finishBattle(*state);
+	Battle::exitBattle(*state);
+
+	return EXIT_SUCCESS;
+}
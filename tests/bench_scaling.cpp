@@ -0,0 +1,470 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "game/state/battle/battle.h"
+#include "game/state/battle/battleunit.h"
+#include "game/state/city/building.h"
+#include "game/state/city/city.h"
+#include "game/state/city/vehicle.h"
+#include "game/state/city/vehiclemission.h"
+#include "game/state/gamestate.h"
+#include "game/state/rules/aequipmenttype.h"
+#include "game/state/rules/agenttype.h"
+#include "game/state/rules/battle/damage.h"
+#include "game/state/rules/city/vehicletype.h"
+#include "game/state/shared/aequipment.h"
+#include "game/state/shared/agent.h"
+#include "game/state/shared/organisation.h"
+#include "game/state/shared/projectile.h"
+#include "game/state/tilemap/tile.h"
+#include "game/state/tilemap/tilemap.h"
+#include "library/pool.h"
+#include "library/strings_format.h"
+#include "library/xorshift.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Fills a battle with more and more units, items, fires and projectiles, and a city with more and
+// more vehicles going between buildings, and reports how long each group of update phases took a
+// tick at every scale. The last column is the exponent of how a phase grows with the scale, from
+// the first scale to the last: 1 for a phase that grows linearly, 2 for one that grows with the
+// square of the count. With --Bench.MaxExponent, any phase taking a noticeable part of the tick at
+// the last scale that grows faster than that fails the run, to catch a change that makes a
+// subsystem scale badly. Takes the same arguments as test_serialize.
+
+using namespace OpenApoc;
+
+namespace
+{
+
+ConfigOptionString scalesOption("Bench", "Scales",
+                                "Comma separated unit and vehicle counts to run at", "50,200,1000");
+ConfigOptionInt ticksOption("Bench", "Ticks", "Ticks to run at every scale", 120);
+ConfigOptionInt projectilesOption("Bench", "ProjectilesPerUnit",
+                                  "Projectiles in flight for every unit in the battle", 10);
+ConfigOptionString maxExponentOption("Bench", "MaxExponent",
+                                     "Fail if a phase grows faster than this, like 1.5");
+
+// A phase has to take at least this part of a tick at the last scale for MaxExponent to apply,
+// as phases that take next to no time grow by whatever the noise is
+const double MIN_SHARE_CHECKED = 0.05;
+
+using PhaseTimes = std::map<UString, std::chrono::steady_clock::duration>;
+
+// Time a tick took in every phase at one scale, and the count it was run at
+class ScaleResult
+{
+  public:
+	unsigned int count = 0;
+	std::map<UString, double> microsecondsPerTick;
+};
+
+std::vector<int> parseScales(const UString &scales)
+{
+	std::vector<int> counts;
+	std::istringstream in(scales.str());
+	std::string entry;
+	while (std::getline(in, entry, ','))
+	{
+		int count = std::atoi(entry.c_str());
+		if (count > 0)
+		{
+			counts.push_back(count);
+		}
+	}
+	return counts;
+}
+
+ScaleResult getResult(unsigned int count, const PhaseTimes &before, const PhaseTimes &after,
+                      unsigned int ticks)
+{
+	ScaleResult result;
+	result.count = count;
+	for (auto &phase : after)
+	{
+		auto it = before.find(phase.first);
+		auto taken = phase.second - (it != before.end() ? it->second : PhaseTimes::mapped_type{});
+		double microseconds = std::chrono::duration<double, std::micro>(taken).count() / ticks;
+		result.microsecondsPerTick[phase.first] = microseconds;
+	}
+	return result;
+}
+
+// Prints every phase at every scale, returns false if one grew faster than MaxExponent
+bool report(const UString &name, const std::vector<ScaleResult> &results)
+{
+	std::ostringstream out;
+	out << format("%s, us/tick:\n  %-50s", name, "phase");
+	for (auto &result : results)
+	{
+		out << format(" %10u", result.count);
+	}
+	out << format(" %8s\n", "exponent");
+
+	auto &last = results.back();
+	double lastTotal = 0.0;
+	for (auto &phase : last.microsecondsPerTick)
+	{
+		lastTotal += phase.second;
+	}
+
+	auto maxExponent = std::atof(maxExponentOption.get().cStr());
+	bool scaled = true;
+	for (auto &phase : last.microsecondsPerTick)
+	{
+		out << format("  %-50s", phase.first);
+		for (auto &result : results)
+		{
+			auto it = result.microsecondsPerTick.find(phase.first);
+			out << format(" %10.1f",
+			              it != result.microsecondsPerTick.end() ? it->second : 0.0);
+		}
+		auto &first = results.front();
+		auto firstIt = first.microsecondsPerTick.find(phase.first);
+		if (results.size() < 2 || firstIt == first.microsecondsPerTick.end() ||
+		    firstIt->second <= 0.0 || phase.second <= 0.0 || last.count <= first.count)
+		{
+			out << format(" %8s\n", "-");
+			continue;
+		}
+		double exponent = std::log(phase.second / firstIt->second) /
+		                  std::log((double)last.count / first.count);
+		bool checked = maxExponent > 0.0 && lastTotal > 0.0 &&
+		               phase.second >= lastTotal * MIN_SHARE_CHECKED;
+		bool tooFast = checked && exponent > maxExponent;
+		out << format(" %8.2f%s\n", exponent, tooFast ? " !" : "");
+		if (tooFast)
+		{
+			LogError("%s phase %s grows with exponent %.2f, more than %.2f", name, phase.first,
+			         exponent, maxExponent);
+			scaled = false;
+		}
+	}
+	std::cout << out.str() << std::flush;
+	return scaled;
+}
+
+bool enterBattle(GameState &state, sp<VehicleType> vType)
+{
+	StateRef<Organisation> org = {&state, UString("ORG_ALIEN")};
+	auto v = mksp<Vehicle>();
+	auto vID = Vehicle::generateObjectID(state);
+	v->type = {&state, vType};
+	v->name = format("%s %d", v->type->name, ++v->type->numCreated);
+	state.vehicles[vID] = v;
+
+	StateRef<Vehicle> enemyVehicle = {&state, vID};
+	StateRef<Vehicle> playerVehicle = {};
+	std::list<StateRef<Agent>> agents;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			agents.emplace_back(&state, a.second);
+		}
+	}
+
+	Battle::beginBattle(state, false, org, agents, nullptr, playerVehicle, enemyVehicle);
+	if (!state.current_battle)
+	{
+		LogError("Failed to begin battle");
+		return false;
+	}
+	Battle::enterBattle(state);
+	return true;
+}
+
+// Tiles a unit could stand on with nobody there yet
+std::vector<Vec3<int>> getFreeTiles(Battle &battle)
+{
+	std::vector<Vec3<int>> tiles;
+	auto &map = *battle.map;
+	for (int z = 0; z < map.size.z; z++)
+	{
+		for (int y = 0; y < map.size.y; y++)
+		{
+			for (int x = 0; x < map.size.x; x++)
+			{
+				auto tile = map.getTile(x, y, z);
+				if (tile->getCanStand() && !tile->getUnitIfPresent())
+				{
+					tiles.push_back({x, y, z});
+				}
+			}
+		}
+	}
+	return tiles;
+}
+
+// Takes a random tile out of tiles
+Vec3<int> takeTile(GameState &state, std::vector<Vec3<int>> &tiles)
+{
+	auto index = randBoundsExclusive(state.rng, (size_t)0, tiles.size());
+	auto tile = tiles[index];
+	tiles[index] = tiles.back();
+	tiles.pop_back();
+	return tile;
+}
+
+// Ammo to fire the projectiles with, one that doesn't explode so that they only fly and hit
+StateRef<AEquipmentType> getAmmoType(GameState &state)
+{
+	for (auto &type : state.agent_equipment)
+	{
+		if (type.second->type == AEquipmentType::Type::Ammo && type.second->damage_type &&
+		    !type.second->damage_type->explosive && type.second->speed > 0)
+		{
+			return {&state, type.first};
+		}
+	}
+	return nullptr;
+}
+
+// Adds count units, half of them aliens and half the player's, an item for every unit, a fire
+// for every other one and the projectiles. Returns the number of units there was room for
+unsigned int populateBattle(GameState &state, unsigned int count)
+{
+	auto &battle = *state.current_battle;
+	auto tiles = getFreeTiles(battle);
+	StateRef<Organisation> aliens = {&state, UString("ORG_ALIEN")};
+	StateRef<AgentType> alienType = {&state, UString("AGENTTYPE_ANTHROPOD")};
+	StateRef<AgentType> soldierType;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			soldierType = a.second->type;
+			break;
+		}
+	}
+	if (!soldierType)
+	{
+		soldierType = alienType;
+	}
+
+	std::vector<sp<BattleUnit>> units;
+	for (unsigned int i = 0; i < count && !tiles.empty(); i++)
+	{
+		auto tile = takeTile(state, tiles);
+		bool alien = i % 2 == 0;
+		auto type = alien ? alienType : soldierType;
+		auto unit = battle.spawnUnit(state, alien ? aliens : state.getPlayer(), type,
+		                             {tile.x + 0.5f, tile.y + 0.5f, tile.z + 0.1f}, {0, 0},
+		                             type->bodyType->getFirstAllowedState());
+		units.push_back(unit);
+	}
+	if (units.empty())
+	{
+		return 0;
+	}
+
+	auto ammoType = getAmmoType(state);
+	StateRef<DamageType> fire = {&state, "DAMAGETYPE_INCENDIARY"};
+	auto groundTiles = getFreeTiles(battle);
+	for (size_t i = 0; i < units.size() && !groundTiles.empty(); i++)
+	{
+		auto tile = takeTile(state, groundTiles);
+		if (ammoType)
+		{
+			auto item = mksp<AEquipment>();
+			item->type = ammoType;
+			item->ammo = ammoType->max_ammo;
+			battle.placeItem(state, item, {tile.x + 0.5f, tile.y + 0.5f, tile.z + 0.1f});
+		}
+		if (i % 2 == 0)
+		{
+			battle.placeHazard(state, aliens, nullptr, fire, tile,
+			                   fire->hazardType->getLifetime(state) * 2, 0, 1, false);
+		}
+	}
+
+	if (!ammoType)
+	{
+		LogWarning("No ammo to fire projectiles with");
+		return (unsigned int)units.size();
+	}
+	auto projectiles = units.size() * (size_t)std::max(0, projectilesOption.get());
+	for (size_t i = 0; i < projectiles; i++)
+	{
+		auto &firer = units[i % units.size()];
+		auto direction = (float)randBoundsInclusive(state.rng, 0, 628) / 100.0f;
+		Vec3<float> velocity = {std::cos(direction), std::sin(direction), 0.0f};
+		velocity *= ammoType->speed * PROJECTILE_VELOCITY_MULTIPLIER;
+		auto position = firer->position + Vec3<float>{0.0f, 0.0f, 0.5f};
+		auto p = mkpooled<Projectile>(
+		    Projectile::Type::Beam, StateRef<BattleUnit>(&state, firer), nullptr,
+		    position + velocity, position, velocity, 0, ammoType->ttl, ammoType->damage, 0,
+		    ammoType->explosion_depletion_rate, ammoType->tail_size, ammoType->projectile_sprites,
+		    ammoType->impact_sfx, ammoType->explosion_graphic, ammoType->damage_type);
+		battle.map->addObjectToMap(p);
+		battle.projectiles.insert(p);
+	}
+	return (unsigned int)units.size();
+}
+
+bool benchBattles(GameState &state, const std::vector<int> &scales)
+{
+	sp<VehicleType> vType;
+	for (auto &vTypePair : state.vehicle_types)
+	{
+		if (vTypePair.second->battle_map)
+		{
+			vType = vTypePair.second;
+			break;
+		}
+	}
+	if (!vType)
+	{
+		LogError("No vehicle with BattleMap found");
+		return false;
+	}
+
+	auto ticks = (unsigned int)std::max(1, ticksOption.get());
+	std::vector<ScaleResult> results;
+	for (auto count : scales)
+	{
+		if (!enterBattle(state, vType))
+		{
+			return false;
+		}
+		auto &battle = *state.current_battle;
+		auto placed = populateBattle(state, count);
+		if (placed < (unsigned int)count)
+		{
+			LogWarning("Only room for %u units of %d on %s", placed, count, vType->battle_map.id);
+		}
+		battle.timePhases = true;
+		auto before = battle.phaseTimes;
+		for (unsigned int i = 0; i < ticks; i++)
+		{
+			state.update(1);
+		}
+		results.push_back(getResult(placed, before, battle.phaseTimes, ticks));
+		std::cout << format("Battle with %u units: %u projectiles, %u hazards left\n", placed,
+		                    (unsigned)battle.projectiles.size(), (unsigned)battle.hazards.size());
+		Battle::finishBattle(state);
+		Battle::exitBattle(state);
+	}
+	return report(format("Battle on %s", vType->battle_map.id), results);
+}
+
+// Adds vehicles going between random buildings of the city until there are count of them
+void populateCity(GameState &state, std::vector<sp<Vehicle>> &vehicles, unsigned int count)
+{
+	auto &city = *state.current_city;
+	std::vector<StateRef<VehicleType>> types;
+	for (auto &type : state.vehicle_types)
+	{
+		if (type.second->type == VehicleType::Type::Flying)
+		{
+			types.emplace_back(&state, type.first);
+		}
+	}
+	std::vector<StateRef<Building>> buildings;
+	for (auto &building : city.buildings)
+	{
+		buildings.emplace_back(&state, building.first);
+	}
+	if (types.empty() || buildings.size() < 2)
+	{
+		LogError("No flying vehicles or buildings to send them between");
+		return;
+	}
+	while (vehicles.size() < count)
+	{
+		auto type = types[randBoundsExclusive(state.rng, (size_t)0, types.size())];
+		auto from = buildings[randBoundsExclusive(state.rng, (size_t)0, buildings.size())];
+		auto to = buildings[randBoundsExclusive(state.rng, (size_t)0, buildings.size())];
+		auto v = city.placeVehicle(state, type, from->owner, from);
+		if (!v)
+		{
+			return;
+		}
+		v->setMission(state, VehicleMission::gotoBuilding(state, *v, to));
+		vehicles.push_back(v);
+	}
+}
+
+bool benchCity(GameState &state, const std::vector<int> &scales)
+{
+	if (!state.current_city)
+	{
+		LogError("No city to fill");
+		return false;
+	}
+	auto ticks = (unsigned int)std::max(1, ticksOption.get());
+	std::vector<ScaleResult> results;
+	std::vector<sp<Vehicle>> vehicles;
+	state.timeUpdates = true;
+	for (auto count : scales)
+	{
+		populateCity(state, vehicles, count);
+		auto before = state.updateTimes;
+		for (unsigned int i = 0; i < ticks; i++)
+		{
+			state.update(1);
+		}
+		results.push_back(getResult((unsigned int)vehicles.size(), before, state.updateTimes,
+		                            ticks));
+	}
+	state.timeUpdates = false;
+	return report(format("City %s", state.current_city.id), results);
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (gamestateName.empty() || commonName.empty())
+	{
+		std::cerr << "Must provide common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+	auto scales = parseScales(scalesOption.get());
+	if (scales.empty())
+	{
+		std::cerr << "Must provide at least one scale\n";
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+
+	auto state = mksp<GameState>();
+	if (!state->loadGame(commonName))
+	{
+		LogError("Failed to load gamestate_common");
+		return EXIT_FAILURE;
+	}
+	if (!state->loadGame(gamestateName))
+	{
+		LogError("Failed to load supplied gamestate");
+		return EXIT_FAILURE;
+	}
+	state->startGame();
+	state->initState();
+	state->fillOrgStartingProperty();
+	state->fillPlayerStartingProperty();
+
+	bool scaled = benchBattles(*state, scales);
+	scaled = benchCity(*state, scales) && scaled;
+	return scaled ? EXIT_SUCCESS : EXIT_FAILURE;
+}
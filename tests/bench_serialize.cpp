@@ -0,0 +1,258 @@
+#include "framework/configfile.h"
+#include "framework/filesystem.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "framework/serialization/serialize.h"
+#include "game/state/gamestate.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+// Saves, writes out and loads back the new game made from the supplied gamestates, and any saves
+// given with --Bench.Saves, in every archive format, packed and unpacked, with and without
+// checksums. Reports how long each step took on average, the size written and the most heap each
+// step had in use on top of what was there before it. Checksums and packing are told apart by
+// the difference between the runs with and without them. Takes the same arguments as
+// test_serialize.
+
+using namespace OpenApoc;
+
+namespace
+{
+// Every allocation is made with its size in front of it, so the heap in use can be followed
+const size_t ALLOCATION_HEADER = alignof(std::max_align_t);
+std::atomic<long long> heapInUse{0};
+std::atomic<long long> heapPeak{0};
+} // anonymous namespace
+
+void *operator new(size_t size)
+{
+	if (auto block = static_cast<char *>(std::malloc(size + ALLOCATION_HEADER)))
+	{
+		*reinterpret_cast<size_t *>(block) = size;
+		long long inUse = heapInUse += size;
+		long long peak = heapPeak.load();
+		while (inUse > peak && !heapPeak.compare_exchange_weak(peak, inUse))
+		{
+		}
+		return block + ALLOCATION_HEADER;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch (std::bad_alloc &)
+	{
+		return nullptr;
+	}
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (!ptr)
+	{
+		return;
+	}
+	auto block = static_cast<char *>(ptr) - ALLOCATION_HEADER;
+	heapInUse -= *reinterpret_cast<size_t *>(block);
+	std::free(block);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { operator delete(ptr); }
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { operator delete(ptr); }
+
+namespace
+{
+
+ConfigOptionInt iterationsOption("Bench", "Iterations",
+                                 "Number of times every combination is saved and loaded", 3);
+ConfigOptionString savesOption("Bench", "Saves",
+                               "Comma separated saved games to measure as well as the new game");
+
+class Measurement
+{
+  public:
+	double milliseconds = 0.0;
+	long long peakBytes = 0;
+
+	void add(const Measurement &other)
+	{
+		milliseconds += other.milliseconds;
+		peakBytes = std::max(peakBytes, other.peakBytes);
+	}
+};
+
+template <typename Work> Measurement measure(Work work)
+{
+	long long before = heapInUse.load();
+	heapPeak = before;
+	auto start = std::chrono::steady_clock::now();
+	work();
+	auto end = std::chrono::steady_clock::now();
+	Measurement measurement;
+	measurement.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	measurement.peakBytes = heapPeak.load() - before;
+	return measurement;
+}
+
+uintmax_t getSizeOnDisk(const fs::path &path)
+{
+	if (!fs::is_directory(path))
+	{
+		return fs::file_size(path);
+	}
+	uintmax_t size = 0;
+	for (fs::recursive_directory_iterator it(path), end; it != end; ++it)
+	{
+		if (fs::is_regular_file(it->path()))
+		{
+			size += fs::file_size(it->path());
+		}
+	}
+	return size;
+}
+
+bool benchState(const UString &name, const GameState &state, const UString &path)
+{
+	std::cout << format("%s:\n", name);
+	auto iterations = std::max(1, iterationsOption.get());
+	for (auto serializationFormat : {SerializationFormat::XML, SerializationFormat::Binary})
+	{
+		for (auto pack : {true, false})
+		{
+			for (auto checksum : {true, false})
+			{
+				config().set("Framework.Serialization.XXH64", checksum);
+				config().set("Framework.Serialization.CRC", false);
+				config().set("Framework.Serialization.SHA1", false);
+
+				Measurement serialize, write, load;
+				uintmax_t size = 0;
+				for (int i = 0; i < iterations; i++)
+				{
+					bool ok = true;
+					auto archive = SerializationArchive::createArchive(serializationFormat);
+					serialize.add(measure([&] { ok = ok && state.serialize(archive.get()); }));
+					write.add(measure([&] { ok = ok && archive->write(path, pack, false); }));
+					archive.reset();
+
+					auto loadedState = mksp<GameState>();
+					load.add(measure([&] { ok = ok && loadedState->loadGame(path); }));
+					loadedState.reset();
+
+					if (!ok)
+					{
+						LogError("Failed to save and load \"%s\" through \"%s\"", name, path);
+						return false;
+					}
+					size = getSizeOnDisk(path.str());
+					fs::remove_all(path.str());
+				}
+
+				static const double MIB = 1024.0 * 1024.0;
+				std::cout << format(
+				    "%-6s %-8s %-11s | serialize ms %9.1f write ms %9.1f load ms %9.1f | size MiB "
+				    "%8.2f | peak heap MiB serialize %8.1f write %8.1f load %8.1f\n",
+				    serializationFormat == SerializationFormat::XML ? "xml" : "binary",
+				    pack ? "packed" : "unpacked", checksum ? "checksum" : "no checksum",
+				    serialize.milliseconds / iterations, write.milliseconds / iterations,
+				    load.milliseconds / iterations, size / MIB, serialize.peakBytes / MIB,
+				    write.peakBytes / MIB, load.peakBytes / MIB);
+			}
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (gamestateName.empty() || commonName.empty())
+	{
+		std::cerr << "Must provide common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+
+	std::stringstream ss;
+	ss << "openapoc_bench_serialize-" << std::this_thread::get_id();
+	UString tempPath = (fs::temp_directory_path() / ss.str()).string();
+
+	auto state = mksp<GameState>();
+	if (!state->loadGame(commonName))
+	{
+		LogError("Failed to load gamestate_common");
+		return EXIT_FAILURE;
+	}
+	if (!state->loadGame(gamestateName))
+	{
+		LogError("Failed to load supplied gamestate");
+		return EXIT_FAILURE;
+	}
+	state->startGame();
+	state->initState();
+	state->fillOrgStartingProperty();
+	state->fillPlayerStartingProperty();
+	if (!benchState("New game", *state, tempPath))
+	{
+		return EXIT_FAILURE;
+	}
+	state.reset();
+
+	for (auto &saveName : savesOption.get().split(","))
+	{
+		if (saveName.empty())
+		{
+			continue;
+		}
+		auto save = mksp<GameState>();
+		if (!save->loadGame(saveName))
+		{
+			LogError("Failed to load save \"%s\"", saveName);
+			return EXIT_FAILURE;
+		}
+		save->initState();
+		if (!benchState(saveName, *save, tempPath))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
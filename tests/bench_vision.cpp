@@ -0,0 +1,348 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "game/state/battle/battle.h"
+#include "game/state/battle/battleunit.h"
+#include "game/state/city/vehicle.h"
+#include "game/state/gamestate.h"
+#include "game/state/rules/city/vehicletype.h"
+#include "game/state/shared/agent.h"
+#include "game/state/shared/organisation.h"
+#include "game/state/tilemap/tilemap.h"
+#include "library/bitvector.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Makes every conscious unit in a battle refresh its vision again and again from nothing seen,
+// once revealing terrain by los blocks and once by shadowcasting, and reports how long a refresh
+// took, how many rays it cast and how much it revealed. Every round has to end with the same
+// tiles visible to every organisation, and with --Bench.Baseline the same as what another build
+// saw, bit for bit. The battle is either a saved one (--Bench.Save) or made on a few vehicle maps,
+// in which case this takes the same arguments as test_serialize.
+
+using namespace OpenApoc;
+
+namespace
+{
+
+ConfigOptionInt iterationsOption("Bench", "Iterations",
+                                 "Number of times every unit refreshes its vision", 100);
+ConfigOptionInt mapsOption("Bench", "Maps", "Number of battle maps to look around on", 3);
+ConfigOptionString saveOption("Bench", "Save",
+                              "Saved game in battle to use instead of the battle maps");
+ConfigOptionString baselineOption(
+    "Bench", "Baseline", "File with the tiles every suite should reveal, written if missing");
+
+using Visibility = std::map<UString, BitVector>;
+
+// Bits as hex digits, four to a digit
+std::string toHex(const BitVector &bits)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex;
+	for (size_t i = 0; i < bits.size(); i += 4)
+	{
+		int digit = 0;
+		for (size_t j = 0; j < 4 && i + j < bits.size(); j++)
+		{
+			digit |= bits.get(i + j) ? 1 << j : 0;
+		}
+		hex += digits[digit];
+	}
+	return hex;
+}
+
+// Lines of a key, which has no spaces in it, and the bits of one organisation seen after a suite
+class Baseline
+{
+  public:
+	bool load(const UString &path)
+	{
+		std::ifstream file(path.cStr());
+		if (!file)
+		{
+			return false;
+		}
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream words(line);
+			std::string key, hex;
+			if (words >> key >> hex)
+			{
+				entries[key] = hex;
+			}
+		}
+		loaded = true;
+		return true;
+	}
+	bool save(const UString &path) const
+	{
+		std::ofstream file(path.cStr());
+		for (auto &entry : entries)
+		{
+			file << entry.first << " " << entry.second << "\n";
+		}
+		return !file.fail();
+	}
+	// Returns false if the bits differ from what was loaded for key, without anything loaded
+	// they are stored to be saved instead
+	bool check(const UString &key, const BitVector &bits)
+	{
+		auto hex = toHex(bits);
+		auto it = entries.find(key.str());
+		if (it == entries.end())
+		{
+			entries[key.str()] = hex;
+			return !loaded;
+		}
+		return it->second == hex;
+	}
+
+  private:
+	bool loaded = false;
+	std::map<std::string, std::string> entries;
+};
+
+Visibility getVisibility(Battle &battle)
+{
+	Visibility visibility;
+	for (auto &entry : battle.visibleTiles)
+	{
+		visibility[entry.first.id] = entry.second;
+	}
+	return visibility;
+}
+
+// Forget everything seen and have every unit look again, a unit always sees its own tile
+void resetVision(Battle &battle)
+{
+	for (auto &entry : battle.visibleTiles)
+	{
+		entry.second = BitVector(entry.second.size());
+	}
+	for (auto &entry : battle.visibleBlocks)
+	{
+		entry.second.assign(entry.second.size(), false);
+	}
+	for (auto &entry : battle.units)
+	{
+		battle.queueVisionRefresh(entry.second->position);
+	}
+}
+
+// Returns false if the rounds or the baseline did not agree on what is seen
+bool runSuite(const UString &battleName, const UString &name, GameState &state, bool shadowcast,
+              Baseline &baseline)
+{
+	auto &battle = *state.current_battle;
+	config().set("OpenApoc.NewFeature.ShadowcastVision", shadowcast);
+	unsigned int conscious = 0;
+	for (auto &entry : battle.units)
+	{
+		conscious += entry.second->isConscious() ? 1 : 0;
+	}
+
+	double seconds = 0.0;
+	unsigned int differentRounds = 0;
+	Visibility first;
+	auto collisionsBefore = battle.map->getCollisionCount();
+	for (int i = 0; i < iterationsOption.get(); i++)
+	{
+		resetVision(battle);
+		auto start = std::chrono::high_resolution_clock::now();
+		battle.updateVision(state);
+		auto end = std::chrono::high_resolution_clock::now();
+		seconds += std::chrono::duration<double>(end - start).count();
+		auto visibility = getVisibility(battle);
+		if (i == 0)
+		{
+			first = visibility;
+		}
+		else if (visibility != first)
+		{
+			differentRounds++;
+		}
+	}
+	auto collisions = battle.map->getCollisionCount() - collisionsBefore;
+
+	unsigned long long revealed = 0;
+	unsigned int differentOrgs = 0;
+	for (auto &entry : first)
+	{
+		for (size_t i = 0; i < entry.second.size(); i++)
+		{
+			revealed += entry.second.get(i) ? 1 : 0;
+		}
+		if (!baseline.check(format("%s/%s/%s", battleName, name, entry.first), entry.second))
+		{
+			differentOrgs++;
+		}
+	}
+
+	auto refreshes = static_cast<double>(iterationsOption.get()) * conscious;
+	std::cout << format("%-16s units %4u rounds %6d | us/refresh %10.2f rays/refresh %8.1f | "
+	                    "tiles revealed %8llu | different rounds %4u organisations %4u\n",
+	                    name, conscious, iterationsOption.get(),
+	                    refreshes > 0.0 ? seconds * 1000000.0 / refreshes : 0.0,
+	                    refreshes > 0.0 ? collisions / refreshes : 0.0, revealed, differentRounds,
+	                    differentOrgs);
+	if (differentRounds > 0)
+	{
+		LogError("Suite %s did not reveal the same tiles every round", name);
+	}
+	if (differentOrgs > 0)
+	{
+		LogError("Suite %s did not reveal the same tiles as the baseline", name);
+	}
+	return differentRounds == 0 && differentOrgs == 0;
+}
+
+bool benchBattle(const UString &battleName, GameState &state, Baseline &baseline)
+{
+	auto shadowcast = config().getBool("OpenApoc.NewFeature.ShadowcastVision");
+	bool same = runSuite(battleName, "los_blocks", state, false, baseline);
+	same = runSuite(battleName, "shadowcast", state, true, baseline) && same;
+	config().set("OpenApoc.NewFeature.ShadowcastVision", shadowcast);
+	return same;
+}
+
+bool enterBattle(GameState &state, sp<VehicleType> vType)
+{
+	StateRef<Organisation> org = {&state, UString("ORG_ALIEN")};
+	LogInfo("Using vehicle map for \"%s\"", vType->name);
+	auto v = mksp<Vehicle>();
+	auto vID = Vehicle::generateObjectID(state);
+	v->type = {&state, vType};
+	v->name = format("%s %d", v->type->name, ++v->type->numCreated);
+	state.vehicles[vID] = v;
+
+	StateRef<Vehicle> enemyVehicle = {&state, vID};
+	StateRef<Vehicle> playerVehicle = {};
+	std::list<StateRef<Agent>> agents;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			agents.emplace_back(&state, a.second);
+		}
+	}
+
+	Battle::beginBattle(state, false, org, agents, nullptr, playerVehicle, enemyVehicle);
+	if (!state.current_battle)
+	{
+		LogError("Failed to begin battle");
+		return false;
+	}
+	Battle::enterBattle(state);
+	return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto saveName = saveOption.get();
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (saveName.empty() && (gamestateName.empty() || commonName.empty()))
+	{
+		std::cerr << "Must provide a save, or common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+
+	Baseline baseline;
+	auto baselineName = baselineOption.get();
+	bool baselineFound = !baselineName.empty() && baseline.load(baselineName);
+	bool same = true;
+
+	auto state = mksp<GameState>();
+	if (!saveName.empty())
+	{
+		if (!state->loadGame(saveName))
+		{
+			LogError("Failed to load save \"%s\"", saveName);
+			return EXIT_FAILURE;
+		}
+		state->initState();
+		if (!state->current_battle)
+		{
+			LogError("Save \"%s\" is not in battle", saveName);
+			return EXIT_FAILURE;
+		}
+		std::cout << format("Saved battle %s:\n", saveName);
+		same = benchBattle("save", *state, baseline);
+	}
+	else
+	{
+		if (!state->loadGame(commonName))
+		{
+			LogError("Failed to load gamestate_common");
+			return EXIT_FAILURE;
+		}
+		if (!state->loadGame(gamestateName))
+		{
+			LogError("Failed to load supplied gamestate");
+			return EXIT_FAILURE;
+		}
+		state->startGame();
+		state->initState();
+		state->fillOrgStartingProperty();
+		state->fillPlayerStartingProperty();
+
+		std::vector<sp<VehicleType>> vehicleTypes;
+		for (auto &vTypePair : state->vehicle_types)
+		{
+			if (vTypePair.second->battle_map && (int)vehicleTypes.size() < mapsOption.get())
+			{
+				vehicleTypes.push_back(vTypePair.second);
+			}
+		}
+		if (vehicleTypes.empty())
+		{
+			LogError("No vehicle with BattleMap found");
+			return EXIT_FAILURE;
+		}
+
+		for (auto &vType : vehicleTypes)
+		{
+			if (!enterBattle(*state, vType))
+			{
+				return EXIT_FAILURE;
+			}
+			std::cout << format("Battle map %s:\n", vType->battle_map.id);
+			same = benchBattle(vType->battle_map.id, *state, baseline) && same;
+			Battle::finishBattle(*state);
+			Battle::exitBattle(*state);
+		}
+	}
+
+	if (!baselineName.empty() && !baselineFound)
+	{
+		if (!baseline.save(baselineName))
+		{
+			LogError("Failed to write baseline \"%s\"", baselineName);
+			return EXIT_FAILURE;
+		}
+		LogInfo("Wrote baseline \"%s\"", baselineName);
+	}
+	return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -46,6 +46,61 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	// Filling in bulk has to give the same values as drawing them one at a time
+	Xorshift128Plus<uint64_t> fillRng{};
+	Xorshift128Plus<uint64_t> drawRng{};
+	uint64_t filled[64];
+	fillRng.fill(filled, 64);
+	for (int i = 0; i < 64; i++)
+	{
+		uint64_t drawn = drawRng();
+		if (filled[i] != drawn)
+		{
+			LogError("fill value %d 0x%016x, expected 0x%016x", i, filled[i], drawn);
+			return EXIT_FAILURE;
+		}
+	}
+	if (fillRng != drawRng)
+	{
+		LogError("fill left a different state than drawing");
+		return EXIT_FAILURE;
+	}
+
+	// Splitting must not change the state, and splitting the same stream again, in any order,
+	// must give the same generator
+	Xorshift128Plus<uint64_t> master{1234};
+	Xorshift128Plus<uint64_t> masterCopy{1234};
+	auto stream1 = master.split(1);
+	auto stream2 = master.split(2);
+	if (master != masterCopy)
+	{
+		LogError("split changed the state of the generator split");
+		return EXIT_FAILURE;
+	}
+	if (stream1 == stream2)
+	{
+		LogError("different streams split into the same generator");
+		return EXIT_FAILURE;
+	}
+	auto stream2Again = masterCopy.split(2);
+	auto stream1Again = masterCopy.split(1);
+	if (stream1 != stream1Again || stream2 != stream2Again)
+	{
+		LogError("splitting the same stream twice gave different generators");
+		return EXIT_FAILURE;
+	}
+	if (stream1() == stream2())
+	{
+		LogError("different streams gave the same first value");
+		return EXIT_FAILURE;
+	}
+	master();
+	if (master.split(1) == stream1Again)
+	{
+		LogError("splitting after drawing gave the same generator as before");
+		return EXIT_FAILURE;
+	}
+
 	constexpr int num_test_buckets = 4;
 	constexpr int num_test_iterations = 500000;
 
@@ -123,5 +123,21 @@ int main(int argc, char **argv)
 		test_collision(map, collision.first[0], collision.first[1], collision.second);
 	}
 
+	// Reading a tile nothing was put in leaves it unmade, while asking for it to change makes it
+	auto tileCount = map.getTileCount();
+	const TileMap &constMap = map;
+	if (!constMap.getTile(50, 50, 5)->ownedObjects.empty() || map.getTileCount() != tileCount)
+	{
+		LogError("Reading tile {50,50,5} made its chunk");
+		exit(EXIT_FAILURE);
+	}
+	if (map.getTile(50, 50, 5)->position != Vec3<int>{50, 50, 5} ||
+	    map.getTileCount() != tileCount + TileStore::CHUNK_SIZE * TileStore::CHUNK_SIZE)
+	{
+		LogError("Tile {50,50,5} not made as expected, %u tiles made",
+		         (unsigned)map.getTileCount());
+		exit(EXIT_FAILURE);
+	}
+
 	return EXIT_SUCCESS;
 }
@@ -97,6 +97,24 @@ static void test_voxel(Vec3<int> voxel_size)
 				check_slice({x, y}, *slice, false);
 		}
 	}
+	// Every span of the row should see it if it covers it
+	for (int y = -1; y < voxel_size.y + 1; y++)
+	{
+		for (int xStart = -1; xStart < voxel_size.x + 1; xStart++)
+		{
+			for (int xEnd = xStart; xEnd < voxel_size.x + 2; xEnd++)
+			{
+				bool expected = y == bit_position.y && xStart <= bit_position.x &&
+				                xEnd > bit_position.x;
+				if (slice->anyBitInRow(y, xStart, xEnd) != expected)
+				{
+					LogError("Unexpected row %d span %d-%d - expected %d", y, xStart, xEnd,
+					         expected ? 1 : 0);
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
 
 	// Put that in the map and check that....
 	Vec3<int> bit_voxel_position = {bit_position.x, bit_position.y, 14};
@@ -215,6 +233,39 @@ static void test_voxel(Vec3<int> voxel_size)
 	return;
 }
 
+static void test_pool()
+{
+	VoxelPool pool;
+	auto makeMap = [](bool filled) {
+		auto map = mksp<VoxelMap>(Vec3<int>{32, 32, 2});
+		map->setSlice(0, mksp<VoxelSlice>(Vec2<int>{32, 32}));
+		auto slice = mksp<VoxelSlice>(Vec2<int>{32, 32});
+		slice->setBit({3, 4}, filled);
+		map->setSlice(1, slice);
+		return map;
+	};
+	auto first = pool.intern(makeMap(true));
+	auto second = pool.intern(makeMap(true));
+	auto other = pool.intern(makeMap(false));
+	if (first != second)
+	{
+		LogError("Equal voxel maps were not shared");
+		exit(EXIT_FAILURE);
+	}
+	if (first == other)
+	{
+		LogError("Different voxel maps were shared");
+		exit(EXIT_FAILURE);
+	}
+	if (first->slices[0] || other->slices[1])
+	{
+		LogError("Empty slices were kept");
+		exit(EXIT_FAILURE);
+	}
+	check_voxel({3, 4, 1}, *first, true);
+	check_voxel({3, 4, 0}, *first, false);
+}
+
 int main(int argc, char **argv)
 {
 	if (config().parseOptions(argc, argv))
@@ -229,4 +280,5 @@ int main(int argc, char **argv)
 		LogInfo("Testing voxel size %s", size);
 		test_voxel(size);
 	}
+	test_pool();
 }
@@ -0,0 +1,406 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "framework/sound_interface.h"
+#include "game/state/battle/ai/tacticalaivanilla.h"
+#include "game/state/battle/battle.h"
+#include "game/state/battle/battledoor.h"
+#include "game/state/battle/battleexplosion.h"
+#include "game/state/battle/battlehazard.h"
+#include "game/state/battle/battleitem.h"
+#include "game/state/battle/battlemappart.h"
+#include "game/state/battle/battlescanner.h"
+#include "game/state/battle/battleunit.h"
+#include "game/state/city/vehicle.h"
+#include "game/state/gamestate.h"
+#include "game/state/rules/city/vehicletype.h"
+#include "game/state/shared/agent.h"
+#include "game/state/shared/doodad.h"
+#include "game/state/shared/organisation.h"
+#include "game/state/shared/projectile.h"
+#include "game/state/tilemap/tile.h"
+#include "game/state/tilemap/tilemap.h"
+#include "game/state/tilemap/tileobject_battleitem.h"
+#include "game/state/tilemap/tileobject_battlemappart.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Fights battles with nobody at the controls: the player's soldiers against the crew of a UFO on
+// its battle map, every side run by the AI, with no window or sound, as fast as it goes. Prints
+// who won, how many ticks it took, how long each group of update phases took and how many objects
+// the battle was left with, once for every seed given. Takes the same arguments as test_serialize.
+//
+// With the same seed, map and gamestate a battle plays out the same every time, which is why AI
+// thinking is not held to a time budget here. With --Sim.Jobs above 1 the seeds are spread over
+// that many processes at once (not on Windows, where they run one after another).
+//
+// With --Sim.Save a saved battle is carried on from where it was saved instead, with the random
+// numbers it was saved with, so that what happened after a save can be played again and timed
+// (with --Trace.enable for a trace of it) as often as needed.
+
+using namespace OpenApoc;
+
+namespace
+{
+
+ConfigOptionString mapOption("Sim", "Map",
+                             "Vehicle type whose battle map to fight on (default the first found)");
+ConfigOptionInt seedOption("Sim", "Seed", "Random seed of the first battle", 0);
+ConfigOptionInt runsOption("Sim", "Runs", "Number of battles, each with the next seed", 1);
+ConfigOptionInt jobsOption("Sim", "Jobs", "Number of battles fought at once in processes", 1);
+ConfigOptionInt maxTicksOption("Sim", "MaxTicks", "Ticks after which a battle is called a draw",
+                               TICKS_PER_HOUR);
+ConfigOptionBool turnBasedOption("Sim", "TurnBased", "Fight in turn based mode", false);
+ConfigOptionString saveOption("Sim", "Save", "Saved game in battle to carry on instead of a map");
+ConfigOptionBool reseedOption("Sim", "Reseed", "Use the seed given on a saved battle too", false);
+ConfigOptionBool keepPlayerOption("Sim", "KeepPlayer",
+                                  "Leave the player's units idle instead of handing them to the AI",
+                                  false);
+
+// Whoever watches the battle when nobody plays, so that every unit of every side is left to the AI
+const UString OBSERVER_ID = "ORG_BATTLE_SIM_OBSERVER";
+
+// Hands the player's side to the AI as well
+void handOverPlayer(GameState &state)
+{
+	auto &battle = *state.current_battle;
+	auto observer = mksp<Organisation>();
+	observer->name = "Observer";
+	state.organisations[OBSERVER_ID] = observer;
+	battle.currentPlayer = {&state, OBSERVER_ID};
+	auto player = state.getPlayer();
+	if (battle.aiBlock.aiList.find(player) == battle.aiBlock.aiList.end())
+	{
+		battle.aiBlock.aiList.emplace(player, mksp<TacticalAIVanilla>());
+		battle.aiBlock.aiList[player]->reset(state, player);
+		battle.aiBlock.beginTurnRoutine(state, player);
+	}
+}
+
+bool enterBattle(GameState &state, sp<VehicleType> vType)
+{
+	StateRef<Organisation> org = {&state, UString("ORG_ALIEN")};
+	auto v = mksp<Vehicle>();
+	auto vID = Vehicle::generateObjectID(state);
+	v->type = {&state, vType};
+	v->name = format("%s %d", v->type->name, ++v->type->numCreated);
+	state.vehicles[vID] = v;
+
+	StateRef<Vehicle> enemyVehicle = {&state, vID};
+	StateRef<Vehicle> playerVehicle = {};
+	std::list<StateRef<Agent>> agents;
+	for (auto &a : state.agents)
+	{
+		if (a.second->type->role == AgentType::Role::Soldier &&
+		    a.second->owner == state.getPlayer())
+		{
+			agents.emplace_back(&state, a.second);
+		}
+	}
+
+	Battle::beginBattle(state, false, org, agents, nullptr, playerVehicle, enemyVehicle);
+	if (!state.current_battle)
+	{
+		LogError("Failed to begin battle");
+		return false;
+	}
+	auto &battle = *state.current_battle;
+	battle.setMode(turnBasedOption.get() ? Battle::Mode::TurnBased : Battle::Mode::RealTime);
+	Battle::enterBattle(state);
+	return true;
+}
+
+// Returns the state carried on from a save, or nullptr if it has no battle to carry on
+sp<GameState> loadSavedBattle(const UString &saveName, int seed)
+{
+	auto state = mksp<GameState>();
+	if (!state->loadGame(saveName))
+	{
+		LogError("Failed to load save \"%s\"", saveName);
+		return nullptr;
+	}
+	state->initState();
+	if (!state->current_battle)
+	{
+		LogError("Save \"%s\" is not in battle", saveName);
+		return nullptr;
+	}
+	if (reseedOption.get())
+	{
+		state->rng = Xorshift128Plus<uint32_t>(seed);
+	}
+	return state;
+}
+
+// Returns the state with a new battle to fight and its map in battleName, or nullptr if it could
+// not be started
+sp<GameState> startBattle(const UString &commonName, const UString &gamestateName, int seed,
+                          UString &battleName)
+{
+	auto state = mksp<GameState>();
+	if (!state->loadGame(commonName))
+	{
+		LogError("Failed to load gamestate_common");
+		return nullptr;
+	}
+	if (!state->loadGame(gamestateName))
+	{
+		LogError("Failed to load supplied gamestate");
+		return nullptr;
+	}
+	state->rng = Xorshift128Plus<uint32_t>(seed);
+	state->startGame();
+	state->initState();
+	state->fillOrgStartingProperty();
+	state->fillPlayerStartingProperty();
+
+	sp<VehicleType> vType;
+	auto mapName = mapOption.get();
+	if (!mapName.empty())
+	{
+		auto it = state->vehicle_types.find(mapName);
+		if (it == state->vehicle_types.end() || !it->second->battle_map)
+		{
+			LogError("No vehicle \"%s\" with a BattleMap", mapName);
+			return nullptr;
+		}
+		vType = it->second;
+	}
+	else
+	{
+		for (auto &vTypePair : state->vehicle_types)
+		{
+			if (vTypePair.second->battle_map)
+			{
+				vType = vTypePair.second;
+				break;
+			}
+		}
+	}
+	if (!vType)
+	{
+		LogError("No vehicle with BattleMap found");
+		return nullptr;
+	}
+	if (!enterBattle(*state, vType))
+	{
+		return nullptr;
+	}
+	battleName = vType->battle_map.id;
+	return state;
+}
+
+// Adds how many of each kind of battle object there are and the bytes taken by the objects
+// themselves, not counting anything they point to, as all of them will be freed on leaving
+void reportObjects(std::ostringstream &out, const Battle &battle)
+{
+	size_t totalBytes = 0;
+	auto line = [&out, &totalBytes](const char *name, size_t count, size_t size) {
+		totalBytes += count * size;
+		out << format("  %-40s %8u x %5u B %10.1f KiB\n", name, (unsigned)count, (unsigned)size,
+		              count * size / 1024.0);
+	};
+	size_t mapPartTiles = 0;
+	for (auto &mp : battle.map_parts)
+	{
+		mapPartTiles += mp->tileObject ? 1 : 0;
+	}
+	size_t itemTiles = 0;
+	for (auto &i : battle.items)
+	{
+		itemTiles += i->tileObject ? 1 : 0;
+	}
+	line("Tile", battle.map ? battle.map->getTileCount() : 0, sizeof(Tile));
+	line("BattleMapPart", battle.map_parts.size(), sizeof(BattleMapPart));
+	line("TileObjectBattleMapPart", mapPartTiles, sizeof(TileObjectBattleMapPart));
+	line("BattleItem", battle.items.size(), sizeof(BattleItem));
+	line("TileObjectBattleItem", itemTiles, sizeof(TileObjectBattleItem));
+	line("BattleUnit", battle.units.size(), sizeof(BattleUnit));
+	line("BattleScanner", battle.scanners.size(), sizeof(BattleScanner));
+	line("BattleDoor", battle.doors.size(), sizeof(BattleDoor));
+	line("Doodad", battle.doodads.size(), sizeof(Doodad));
+	line("Projectile", battle.projectiles.size(), sizeof(Projectile));
+	line("BattleExplosion", battle.explosions.size(), sizeof(BattleExplosion));
+	line("BattleHazard", battle.hazards.size(), sizeof(BattleHazard));
+	out << format("  %-40s %30.1f KiB\n", "Total", totalBytes / 1024.0);
+}
+
+// Returns false if the battle could not be set up
+bool fightBattle(const UString &commonName, const UString &gamestateName, int seed)
+{
+	auto saveName = saveOption.get();
+	UString battleName = saveName;
+	auto state = saveName.empty() ? startBattle(commonName, gamestateName, seed, battleName)
+	                              : loadSavedBattle(saveName, seed);
+	if (!state)
+	{
+		return false;
+	}
+	if (!keepPlayerOption.get())
+	{
+		handOverPlayer(*state);
+	}
+
+	auto &battle = *state->current_battle;
+	battle.timePhases = true;
+	unsigned int ticks = 0;
+	auto maxTicks = static_cast<unsigned int>(std::max(0, maxTicksOption.get()));
+	auto start = std::chrono::steady_clock::now();
+	while (battle.missionEndTimer == 0 && ticks < maxTicks)
+	{
+		state->update(1);
+		ticks++;
+	}
+	double seconds =
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	UString outcome = battle.missionEndTimer == 0
+	                      ? "draw"
+	                      : battle.playerWon ? "player won" : "player lost";
+	std::map<UString, int> alive;
+	for (auto &p : battle.participants)
+	{
+		alive[p.id] = 0;
+	}
+	for (auto &u : battle.units)
+	{
+		if (u.second->isConscious())
+		{
+			alive[u.second->owner.id]++;
+		}
+	}
+
+	// All at once, so that lines of battles fought at the same time do not get mixed up
+	std::ostringstream out;
+	out << format("seed %d battle %s: %s after %u ticks in %.2f s (%.2f ms/tick)\n", seed,
+	              battleName, outcome, ticks, seconds,
+	              ticks > 0 ? seconds * 1000.0 / ticks : 0.0);
+	for (auto &entry : alive)
+	{
+		out << format("  %-40s units left %4d\n", entry.first, entry.second);
+	}
+	std::vector<std::pair<UString, std::chrono::steady_clock::duration>> phases(
+	    battle.phaseTimes.begin(), battle.phaseTimes.end());
+	std::sort(phases.begin(), phases.end(),
+	          [](const std::pair<UString, std::chrono::steady_clock::duration> &a,
+	             const std::pair<UString, std::chrono::steady_clock::duration> &b) {
+		          return a.second > b.second;
+	          });
+	for (auto &phase : phases)
+	{
+		double phaseSeconds = std::chrono::duration<double>(phase.second).count();
+		out << format("  %-60s %10.2f ms %8.2f us/tick\n", phase.first, phaseSeconds * 1000.0,
+		              ticks > 0 ? phaseSeconds * 1000000.0 / ticks : 0.0);
+	}
+	reportObjects(out, battle);
+	std::cout << out.str() << std::flush;
+	return true;
+}
+
+// Returns false if any battle could not be set up
+bool fightBattles(const UString &commonName, const UString &gamestateName,
+                  const std::vector<int> &seeds)
+{
+	Framework fw("OpenApoc", false);
+	// There is no window, so no sound either unless given one that plays nothing
+	up<SoundBackendFactory> nullSound(getNullSoundBackend());
+	fw.soundBackend.reset(nullSound->create());
+	// A budget would make what the AI does depend on how fast the machine is
+	config().set("Game.AI.ThinkBudget", 0);
+
+	bool fought = true;
+	for (auto seed : seeds)
+	{
+		fought = fightBattle(commonName, gamestateName, seed) && fought;
+	}
+	return fought;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	config().addPositionalArgument("common", "Common gamestate to load");
+	config().addPositionalArgument("gamestate", "Gamestate to load");
+
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	auto gamestateName = config().getString("gamestate");
+	auto commonName = config().getString("common");
+	if (saveOption.get().empty() && (gamestateName.empty() || commonName.empty()))
+	{
+		std::cerr << "Must provide a save, or common gamestate and gamestate\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	std::vector<int> seeds;
+	for (int i = 0; i < runsOption.get(); i++)
+	{
+		seeds.push_back(seedOption.get() + i);
+	}
+	int jobs = std::max(1, jobsOption.get());
+	if (jobs == 1 || seeds.size() < 2)
+	{
+		return fightBattles(commonName, gamestateName, seeds) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+#ifdef _WIN32
+	LogWarning("Processes not supported on Windows, fighting battles one after another");
+	return fightBattles(commonName, gamestateName, seeds) ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+	// Each battle gets a process of its own, forked before there is a Framework or any thread
+	bool fought = true;
+	int running = 0;
+	auto waitForOne = [&fought, &running]() {
+		int status = 0;
+		if (wait(&status) < 0)
+		{
+			LogError("Lost track of the battles still being fought");
+			fought = false;
+			running = 0;
+			return;
+		}
+		fought = fought && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+		running--;
+	};
+	for (auto seed : seeds)
+	{
+		if (running >= jobs)
+		{
+			waitForOne();
+		}
+		auto pid = fork();
+		if (pid == 0)
+		{
+			_exit(fightBattles(commonName, gamestateName, {seed}) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (pid < 0)
+		{
+			LogError("Failed to fork for seed %d", seed);
+			fought = false;
+			continue;
+		}
+		running++;
+	}
+	while (running > 0)
+	{
+		waitForOne();
+	}
+	return fought ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,127 @@
+#include "framework/configfile.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "framework/sound_interface.h"
+#include "game/state/gamestate.h"
+#include "game/state/gametime.h"
+#include "game/state/savemanager.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+// Runs the city of a saved game with nobody at the controls, with no window or sound, as fast as
+// it goes for a number of days of game time. Prints how many ticks that took and how fast they
+// went, then how long every scope of GameState::update took, as the benchmark to run before and
+// after a change to what happens in the city.
+//
+// Goes at the top speed the city view allows, five minutes at a time whenever the city can and a
+// tick at a time when it can't (with --Sim.Turbo=false always a tick at a time). Nobody answers
+// the events raised on the way, so the player never goes into a battle. A save is always run the
+// same way, so the same save gives comparable numbers on two builds (and --Trace.enable gives a
+// trace of it).
+
+using namespace OpenApoc;
+
+namespace
+{
+
+ConfigOptionString saveOption("Sim", "Save", "Saved game to run the city of");
+ConfigOptionInt daysOption("Sim", "Days", "Days of game time to run for", 7);
+ConfigOptionBool turboOption("Sim", "Turbo",
+                             "Go five minutes at a time whenever the city allows it", true);
+
+// Returns the state of the save, or nullptr if it has no city to run
+sp<GameState> loadSave(const UString &saveName)
+{
+	auto state = mksp<GameState>();
+	SaveManager saveManager;
+	saveManager.loadGame(saveName, state).wait();
+	if (!state->current_city)
+	{
+		LogError("Failed to load save \"%s\"", saveName);
+		return nullptr;
+	}
+	if (state->current_battle)
+	{
+		LogError("Save \"%s\" is in battle, only a city can be run", saveName);
+		return nullptr;
+	}
+	return state;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+	auto saveName = saveOption.get();
+	if (saveName.empty())
+	{
+		std::cerr << "Must provide a save\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+	// There is no window, so no sound either unless given one that plays nothing
+	up<SoundBackendFactory> nullSound(getNullSoundBackend());
+	fw.soundBackend.reset(nullSound->create());
+
+	auto state = loadSave(saveName);
+	if (!state)
+	{
+		return EXIT_FAILURE;
+	}
+
+	state->timeUpdates = true;
+	auto startTicks = state->gameTime.getTicks();
+	auto endTicks = startTicks + (uint64_t)std::max(0, daysOption.get()) * TICKS_PER_DAY;
+	unsigned int updates = 0;
+	unsigned int turboUpdates = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (state->gameTime.getTicks() < endTicks)
+	{
+		if (turboOption.get() && state->canTurbo())
+		{
+			state->updateTurbo();
+			turboUpdates++;
+		}
+		else
+		{
+			state->update(1);
+		}
+		updates++;
+	}
+	double seconds =
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	auto ticks = state->gameTime.getTicks() - startTicks;
+
+	std::ostringstream out;
+	out << format("%s: %llu ticks (%.2f days) in %u updates (%u of them turbo) in %.2f s "
+	              "(%.0f ticks/s)\n",
+	              saveName, (unsigned long long)ticks, (double)ticks / TICKS_PER_DAY, updates,
+	              turboUpdates, seconds, seconds > 0 ? ticks / seconds : 0.0);
+	std::vector<std::pair<UString, std::chrono::steady_clock::duration>> scopes(
+	    state->updateTimes.begin(), state->updateTimes.end());
+	std::sort(scopes.begin(), scopes.end(),
+	          [](const std::pair<UString, std::chrono::steady_clock::duration> &a,
+	             const std::pair<UString, std::chrono::steady_clock::duration> &b) {
+		          return a.second > b.second;
+	          });
+	for (auto &scope : scopes)
+	{
+		double scopeSeconds = std::chrono::duration<double>(scope.second).count();
+		out << format("  %-60s %10.2f ms %8.2f us/tick\n", scope.first, scopeSeconds * 1000.0,
+		              ticks > 0 ? scopeSeconds * 1000000.0 / ticks : 0.0);
+	}
+	std::cout << out.str() << std::flush;
+	return EXIT_SUCCESS;
+}
@@ -1,8 +1,25 @@
+#include "framework/configfile.h"
+#include "framework/data.h"
 #include "framework/filesystem.h"
 #include "framework/framework.h"
+#include "framework/image.h"
 #include "framework/logger.h"
+#include <functional>
+#include <vector>
+
+// Writes every image of the original data out as PNGs under dumped_data. Every file read is a job
+// of its own, and the images of a set are encoded in parallel, so only about one set per worker
+// is decoded at any time. With --DumpEverything.Incremental, PNGs written after the files they
+// come from last changed are left alone, rather than dumping everything again from scratch
 
 using namespace OpenApoc;
+
+namespace
+{
+ConfigOptionBool incrementalOption("DumpEverything", "Incremental",
+                                   "Only write images whose files changed since they were dumped",
+                                   false);
+} // anonymous namespace
 class PCKFile
 {
   public:
@@ -1047,6 +1064,75 @@ std::list<UString> loftempFiles = {
 
 namespace fs = fs;
 
+using FileTime = decltype(fs::last_write_time(fs::path()));
+
+// The files in the data some outputs are made from, to tell if those outputs are current
+class Sources
+{
+  public:
+	Sources(const std::vector<UString> &paths)
+	{
+		if (!incrementalOption.get())
+		{
+			return;
+		}
+		try
+		{
+			for (auto &path : paths)
+			{
+				auto file = fw().data->fs.open(path);
+				if (!file)
+				{
+					return;
+				}
+				// A file within an archive goes by when the archive changed
+				fs::path systemPath = file.systemPath().str();
+				while (!systemPath.empty() && !fs::exists(systemPath))
+				{
+					systemPath = systemPath.parent_path();
+				}
+				if (systemPath.empty())
+				{
+					return;
+				}
+				auto changed = fs::last_write_time(systemPath);
+				if (newest < changed)
+				{
+					newest = changed;
+				}
+			}
+		}
+		catch (fs::filesystem_error &e)
+		{
+			LogWarning("Failed to check when sources changed: \"%s\"", e.what());
+			return;
+		}
+		known = true;
+	}
+
+	// Whether outPath was written since every source last changed
+	bool isCurrent(const fs::path &outPath) const
+	{
+		if (!known)
+		{
+			return false;
+		}
+		try
+		{
+			return fs::exists(outPath) && !(fs::last_write_time(outPath) < newest);
+		}
+		catch (fs::filesystem_error &e)
+		{
+			LogWarning("Failed to check \"%s\": \"%s\"", outPath.string(), e.what());
+			return false;
+		}
+	}
+
+  private:
+	bool known = false;
+	FileTime newest = {};
+};
+
 static void dumpLofTemps(fs::path basePath, const UString &prefix)
 {
 	auto tabFileName = prefix + ".tab";
@@ -1067,20 +1153,24 @@ static void dumpLofTemps(fs::path basePath, const UString &prefix)
 
 	auto outPath = basePath / prefix.str();
 	fs::create_directories(outPath);
+	Sources sources({datFileName, tabFileName});
 
-	for (size_t i = 0; i < count; i++)
-	{
-		auto imgPath = format("LOFTEMPS:%s:%s:%u", datFileName, tabFileName, (unsigned)i);
+	fw().threadPoolParallelFor(static_cast<unsigned int>(count), [&](unsigned int i, unsigned int) {
+		auto outName = format("%u.png", i);
+		auto filePath = outPath / outName.str();
+		if (sources.isCurrent(filePath))
+		{
+			return;
+		}
+		auto imgPath = format("LOFTEMPS:%s:%s:%u", datFileName, tabFileName, i);
 		auto img = fw().data->loadImage(imgPath);
 		if (!img)
 		{
 			LogError("Failed to load \"%s\"", imgPath);
 			return;
 		}
-		auto outName = format("%u.png", (unsigned)i);
-		auto filePath = outPath / outName.str();
 		fw().data->writeImage(filePath.native(), img);
-	}
+	});
 }
 
 static void dumpRaw(fs::path outDir, const RawImage &i)
@@ -1089,6 +1179,10 @@ static void dumpRaw(fs::path outDir, const RawImage &i)
 	auto fileName = i.prefix + ".png";
 	auto outPath = outDir / fileName.str();
 	auto imageString = format("RAW:%s:%u:%u:%s", inName, i.size.x, i.size.y, i.palette);
+	if (Sources({inName, i.palette}).isCurrent(outPath))
+	{
+		return;
+	}
 	LogWarning("Reading \"%s\"", imageString);
 
 	auto img = fw().data->loadImage(imageString);
@@ -1098,7 +1192,7 @@ static void dumpRaw(fs::path outDir, const RawImage &i)
 		return;
 	}
 
-	fs::create_directories(outPath.parent_path());
+	// writeImage makes any directories missing, which other jobs may be making at the same time
 	fw().data->writeImage(outPath.native(), img);
 }
 
@@ -1108,6 +1202,7 @@ static void dumpPck(fs::path outDir, const UString &prefix, const UString &palet
 	auto basePath = outDir / prefix.str();
 	fs::create_directories(basePath);
 	auto imageString = type + ":" + prefix + ".pck:" + prefix + ".tab";
+	Sources sources({prefix + ".pck", prefix + ".tab", paletteString});
 	LogWarning("Reading \"%s\"", imageString);
 	auto imgSet = fw().data->loadImageSet(imageString);
 	if (!imgSet)
@@ -1122,16 +1217,15 @@ static void dumpPck(fs::path outDir, const UString &prefix, const UString &palet
 		return;
 	}
 
-	int count = 0;
-	for (auto &img : imgSet->images)
-	{
-		auto fullPath = basePath;
-		auto imgName = format("%d.png", count);
-		fullPath /= imgName.str();
-		if (img)
-			fw().data->writeImage(fullPath.native(), img, palette);
-		count++;
-	}
+	auto &images = imgSet->images;
+	fw().threadPoolParallelFor(static_cast<unsigned int>(images.size()),
+	                           [&](unsigned int i, unsigned int) {
+		                           auto fullPath = basePath;
+		                           auto imgName = format("%u.png", i);
+		                           fullPath /= imgName.str();
+		                           if (images[i] && !sources.isCurrent(fullPath))
+			                           fw().data->writeImage(fullPath.native(), images[i], palette);
+	                           });
 }
 
 static void dumpPcx(fs::path outDir, const UString &prefix)
@@ -1139,7 +1233,10 @@ static void dumpPcx(fs::path outDir, const UString &prefix)
 	auto outName = prefix + ".png";
 	auto pcxName = prefix + ".pcx";
 	auto path = outDir / outName.str();
-	fs::create_directories(path.parent_path());
+	if (Sources({pcxName}).isCurrent(path))
+	{
+		return;
+	}
 	LogWarning("Reading \"%s\"", pcxName);
 	auto img = fw().data->loadImage(pcxName);
 	if (!img)
@@ -1150,21 +1247,32 @@ static void dumpPcx(fs::path outDir, const UString &prefix)
 	fw().data->writeImage(path.native(), img);
 }
 
-int main(int, char **)
+int main(int argc, char **argv)
 {
-	Framework fw("OpenApoc", {}, false);
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
 
 	fs::path dump_path = "dumped_data";
-	fs::remove_all(dump_path);
+	if (!incrementalOption.get())
+	{
+		fs::remove_all(dump_path);
+	}
 
+	std::vector<std::function<void()>> dumps;
 	for (auto &pck : pckFiles)
-		dumpPck(dump_path, pck.prefix, pck.palette, pck.type);
+		dumps.push_back([&] { dumpPck(dump_path, pck.prefix, pck.palette, pck.type); });
 	for (auto &pcx : pcxFiles)
-		dumpPcx(dump_path, pcx);
+		dumps.push_back([&] { dumpPcx(dump_path, pcx); });
 	for (auto &raw : rawFiles)
-		dumpRaw(dump_path, raw);
+		dumps.push_back([&] { dumpRaw(dump_path, raw); });
 	for (auto &lof : loftempFiles)
-		dumpLofTemps(dump_path, lof);
+		dumps.push_back([&] { dumpLofTemps(dump_path, lof); });
+	fw.threadPoolParallelFor(static_cast<unsigned int>(dumps.size()),
+	                         [&](unsigned int i, unsigned int) { dumps[i](); });
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,157 @@
+#include "tools/extractors/extractor_manifest.h"
+#include "dependencies/pugixml/src/pugixml.hpp"
+#include "framework/data.h"
+#include "framework/filesystem.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "library/strings_format.h"
+
+// Disable automatic #pragma linking for boost - only enabled in msvc and that should provide boost
+// symbols as part of the module that uses it
+#define BOOST_ALL_NO_LIB
+#include <boost/crc.hpp>
+
+namespace OpenApoc
+{
+
+bool ExtractorManifest::load(const UString &path)
+{
+	entries.clear();
+	pugi::xml_document doc;
+	auto parseResult = doc.load_file(path.cStr());
+	if (!parseResult)
+	{
+		LogInfo("No extractor manifest read from \"%s\": %s", path, parseResult.description());
+		return false;
+	}
+	auto rootNode = doc.child("extractor_manifest");
+	if (!rootNode)
+	{
+		LogWarning("Extractor manifest \"%s\" has invalid root node", path);
+		return false;
+	}
+	if (rootNode.attribute("version").as_int() != VERSION)
+	{
+		LogInfo("Extractor manifest \"%s\" is from a different version", path);
+		return false;
+	}
+	for (auto extractorNode = rootNode.child("extractor"); extractorNode;
+	     extractorNode = extractorNode.next_sibling("extractor"))
+	{
+		auto &entry = entries[extractorNode.attribute("name").as_string()];
+		entry.version = extractorNode.attribute("version").as_int();
+		for (auto inputNode = extractorNode.child("input"); inputNode;
+		     inputNode = inputNode.next_sibling("input"))
+		{
+			entry.inputs[inputNode.attribute("path").as_string()] = inputNode.text().get();
+		}
+		for (auto outputNode = extractorNode.child("output"); outputNode;
+		     outputNode = outputNode.next_sibling("output"))
+		{
+			entry.outputs.push_back(outputNode.text().get());
+		}
+	}
+	return true;
+}
+
+bool ExtractorManifest::save(const UString &path) const
+{
+	pugi::xml_document doc;
+	auto decl = doc.prepend_child(pugi::node_declaration);
+	decl.append_attribute("version") = "1.0";
+	decl.append_attribute("encoding") = "UTF-8";
+	auto rootNode = doc.append_child("extractor_manifest");
+	rootNode.append_attribute("version") = VERSION;
+	for (auto &entryPair : entries)
+	{
+		auto extractorNode = rootNode.append_child("extractor");
+		extractorNode.append_attribute("name") = entryPair.first.cStr();
+		extractorNode.append_attribute("version") = entryPair.second.version;
+		for (auto &input : entryPair.second.inputs)
+		{
+			auto inputNode = extractorNode.append_child("input");
+			inputNode.append_attribute("path") = input.first.cStr();
+			inputNode.text().set(input.second.cStr());
+		}
+		for (auto &output : entryPair.second.outputs)
+		{
+			extractorNode.append_child("output").text().set(output.cStr());
+		}
+	}
+	if (!doc.save_file(path.cStr(), "  "))
+	{
+		LogError("Failed to write extractor manifest \"%s\"", path);
+		return false;
+	}
+	return true;
+}
+
+bool ExtractorManifest::isUpToDate(const UString &extractor, int version,
+                                   const InputHashes &inputs,
+                                   const std::vector<UString> &outputs) const
+{
+	auto entry = entries.find(extractor);
+	if (entry == entries.end() || entry->second.version != version ||
+	    entry->second.inputs != inputs || entry->second.outputs != outputs)
+	{
+		return false;
+	}
+	for (auto &output : outputs)
+	{
+		if (!fs::exists(fs::path(output.str())))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void ExtractorManifest::update(const UString &extractor, int version, const InputHashes &inputs,
+                               const std::vector<UString> &outputs)
+{
+	auto &entry = entries[extractor];
+	entry.version = version;
+	entry.inputs = inputs;
+	entry.outputs = outputs;
+}
+
+void ExtractorManifest::remove(const UString &extractor) { entries.erase(extractor); }
+
+UString ExtractorManifest::hashInput(const UString &path)
+{
+	auto files = fw().data->fs.enumerateDirectoryRecursive(path, "");
+	if (files.empty())
+	{
+		files.push_back(path);
+	}
+	files.sort();
+
+	boost::crc_32_type crc;
+	unsigned long long totalSize = 0;
+	bool found = false;
+	std::vector<char> buffer(64 * 1024);
+	for (auto &fileName : files)
+	{
+		auto file = fw().data->fs.open(fileName);
+		if (!file)
+		{
+			continue;
+		}
+		found = true;
+		// The name is hashed as well, so renaming or moving a file counts as a change
+		crc.process_bytes(fileName.cStr(), fileName.str().size() + 1);
+		while (file)
+		{
+			file.read(buffer.data(), buffer.size());
+			crc.process_bytes(buffer.data(), file.gcount());
+			totalSize += file.gcount();
+		}
+	}
+	if (!found)
+	{
+		return "missing";
+	}
+	return format("%08x-%llu", crc.checksum(), totalSize);
+}
+
+} // namespace OpenApoc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "library/strings.h"
+#include <map>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Record of what every extractor was last run on, so later runs can skip any whose inputs and
+// version have not changed since and whose outputs are all still there
+class ExtractorManifest
+{
+  public:
+	// Bump to run every extractor again, such as when the format the game data is saved in changes
+	static const int VERSION = 1;
+
+	// Hashes of the contents of inputs, by input
+	using InputHashes = std::map<UString, UString>;
+
+	// Returns false if there is no manifest at path or it could not be read, leaving it empty
+	bool load(const UString &path);
+	bool save(const UString &path) const;
+
+	bool isUpToDate(const UString &extractor, int version, const InputHashes &inputs,
+	                const std::vector<UString> &outputs) const;
+	void update(const UString &extractor, int version, const InputHashes &inputs,
+	            const std::vector<UString> &outputs);
+	void remove(const UString &extractor);
+
+	// Hash of the names and contents of every file in path, which may be a file or a directory in
+	// the data search path, so the CD as well. A path that is not there has a hash of "missing"
+	static UString hashInput(const UString &path);
+
+  private:
+	class Entry
+	{
+	  public:
+		int version = 0;
+		InputHashes inputs;
+		std::vector<UString> outputs;
+	};
+	std::map<UString, Entry> entries;
+};
+
+} // namespace OpenApoc
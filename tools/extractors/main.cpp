@@ -7,9 +7,16 @@
 #include "game/state/rules/battle/battlemaptileset.h"
 #include "game/state/rules/battle/battleunitimagepack.h"
 #include "library/strings_format.h"
+#include "tools/extractors/extractor_manifest.h"
 #include "tools/extractors/extractors.h"
 #include <SDL_main.h>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <list>
+#include <mutex>
+#include <set>
+#include <vector>
 
 using namespace OpenApoc;
 
@@ -27,6 +34,23 @@ static void extractDifficulty(const InitialGameStateExtractor &e, UString output
 	s.saveGame(outputPath, true);
 }
 
+using PathPair = std::pair<const UString, UString>;
+using ExtractorList =
+    std::list<std::pair<UString, std::function<void(const InitialGameStateExtractor &e)>>>;
+
+// Calls extract(item) for every item, spread over the thread pool
+template <typename Container, typename Extract>
+static void extractEach(const Container &items, Extract extract)
+{
+	std::vector<const typename Container::value_type *> itemList;
+	for (auto &item : items)
+	{
+		itemList.push_back(&item);
+	}
+	fw().threadPoolParallelFor(itemList.size(),
+	                           [&](unsigned int index, unsigned int) { extract(*itemList[index]); });
+}
+
 std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thingsToExtract = {
     {"difficulty1",
      [](const InitialGameStateExtractor &e) {
@@ -88,8 +112,7 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 	 }},
     {"unit_image_packs",
      [](const InitialGameStateExtractor &e) {
-	     for (auto &imagePackStrings : e.unitImagePackPaths)
-	     {
+	     extractEach(e.unitImagePackPaths, [&e](const PathPair &imagePackStrings) {
 		     GameState s;
 		     LogInfo("Extracting image pack \"%s\"", imagePackStrings.first);
 
@@ -107,14 +130,13 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save image pack \"%s\"", imagePackStrings.first);
 			     }
 		     }
-	     }
+	     });
 	 }},
     {"item_image_packs",
      [](const InitialGameStateExtractor &e) {
 
 	     int itemImagePacksCount = e.getItemImagePacksCount();
-	     for (int i = 0; i < itemImagePacksCount; i++)
-	     {
+	     fw().threadPoolParallelFor(itemImagePacksCount, [&e](unsigned int i, unsigned int) {
 		     GameState s;
 		     LogInfo("Extracting item image pack \"%d\"", i);
 
@@ -132,12 +154,11 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save  item image pack \"%d\"", i);
 			     }
 		     }
-	     }
+	     });
 	 }},
     {"unit_shadow_packs",
      [](const InitialGameStateExtractor &e) {
-	     for (auto &imagePackStrings : e.unitShadowPackPaths)
-	     {
+	     extractEach(e.unitShadowPackPaths, [&e](const PathPair &imagePackStrings) {
 		     GameState s;
 		     LogInfo("Extracting image pack \"%s\"", imagePackStrings.first);
 
@@ -155,12 +176,11 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save image pack \"%s\"", imagePackStrings.first);
 			     }
 		     }
-	     }
+	     });
 	 }},
     {"unit_animation_packs",
      [](const InitialGameStateExtractor &e) {
-	     for (auto &animationPackStrings : e.unitAnimationPackPaths)
-	     {
+	     extractEach(e.unitAnimationPackPaths, [&e](const PathPair &animationPackStrings) {
 		     GameState s;
 		     LogInfo("Extracting animation pack \"%s\"", animationPackStrings.first);
 
@@ -180,16 +200,15 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save animation pack \"%s\"", animationPackStrings.first);
 			     }
 		     }
-	     }
+	     });
 	 }},
 
     {"battle_map_tilesets",
      [](const InitialGameStateExtractor &e) {
-	     for (auto &tileSetName : e.battleMapPaths)
-	     {
+	     extractEach(e.battleMapPaths, [&e](const UString &tileSetName) {
 		     // Some indices are empty?
 		     if (tileSetName.empty())
-			     continue;
+			     return;
 		     GameState s;
 		     LogInfo("Extracting tileset \"%s\"", tileSetName);
 
@@ -206,15 +225,14 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save tileset \"%s\"", tileSetName);
 			     }
 		     }
-	     }
+	     });
 	 }},
     {"battle_map_sectors",
      [](const InitialGameStateExtractor &e) {
-	     for (auto &mapName : e.battleMapPaths)
-	     {
+	     extractEach(e.battleMapPaths, [&e](const UString &mapName) {
 		     // Some indices are empty?
 		     if (mapName.empty())
-			     continue;
+			     return;
 		     GameState s;
 		     LogInfo("Extracting map sectors from \"%s\"", mapName);
 
@@ -234,16 +252,308 @@ std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> thing
 				     LogError("Failed to save map sector \"%s\"", sectorName);
 			     }
 		     }
-	     }
+	     });
 	 }},
 };
 
+// Extractors that must not start before others have finished, such as one loading what another
+// saves. Only the ones asked for are waited on, so anything else has to be there already
+std::map<UString, std::set<UString>> extractorDependencies = {};
+
+// What each extractor reads from the data search path, which includes the CD, and the paths it
+// writes to. Bump the version of an extractor whenever a change to it changes what it writes
+class ExtractorInfo
+{
+  public:
+	int version;
+	std::vector<UString> inputs;
+	std::vector<UString> outputs;
+};
+
+// Read by InitialGameStateExtractor itself, so by every extractor
+const std::vector<UString> commonExtractorInputs = {"xcom3/ufoexe/ufo2p.exe",
+                                                    "xcom3/tacexe/tacp.exe"};
+
+std::map<UString, ExtractorInfo> extractorInfo = {
+    {"difficulty1",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "difficulty1_patch"},
+      {"data/difficulty1_patched"}}},
+    {"difficulty2",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "difficulty2_patch"},
+      {"data/difficulty2_patched"}}},
+    {"difficulty3",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "difficulty3_patch"},
+      {"data/difficulty3_patched"}}},
+    {"difficulty4",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "difficulty4_patch"},
+      {"data/difficulty4_patched"}}},
+    {"difficulty5",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "difficulty5_patch"},
+      {"data/difficulty5_patched"}}},
+    {"common_gamestate",
+     {1,
+      {"xcom3/ufodata", "xcom3/tacdata", "xcom3/maps", "common_patch"},
+      {"data/gamestate_common"}}},
+    {"city_bullet_sprites", {1, {"xcom3/ufodata"}, {"data/bulletsprites/city"}}},
+    {"battle_bullet_sprites", {1, {"xcom3/tacdata"}, {"data/bulletsprites/battle"}}},
+    {"unit_image_packs", {1, {"xcom3/tacdata"}, {"data/imagepacks"}}},
+    {"item_image_packs", {1, {"xcom3/tacdata"}, {"data/imagepacks"}}},
+    {"unit_shadow_packs", {1, {"xcom3/tacdata"}, {"data/imagepacks"}}},
+    {"unit_animation_packs", {1, {"xcom3/tacdata"}, {"data/animationpacks"}}},
+    {"battle_map_tilesets", {1, {"xcom3/maps", "xcom3/tacdata"}, {"data/tilesets"}}},
+    {"battle_map_sectors", {1, {"xcom3/maps"}, {"data/maps"}}},
+};
+
+// Runs every extractor on the thread pool as soon as all it depends on have finished, and waits
+// for them all. An extractor is skipped if one it depends on failed. Returns the ones that failed
+// or were skipped
+static std::set<UString> runExtractors(const ExtractorList &extractorsToRun,
+                                       const InitialGameStateExtractor &e)
+{
+	std::map<UString, std::function<void(const InitialGameStateExtractor &e)>> extractors;
+	for (auto &ePair : extractorsToRun)
+	{
+		extractors.insert(ePair);
+	}
+	std::map<UString, std::set<UString>> dependencies;
+	for (auto &ePair : extractors)
+	{
+		for (auto &dependency : extractorDependencies[ePair.first])
+		{
+			if (extractors.find(dependency) != extractors.end())
+			{
+				dependencies[ePair.first].insert(dependency);
+			}
+		}
+	}
+	auto waitingFor = dependencies;
+
+	std::mutex mutex;
+	std::condition_variable doneCondition;
+	std::set<UString> failed;
+	// Extractors are counted as started once nothing keeps them from running any more
+	size_t started = 0;
+	size_t finished = 0;
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::function<void(const UString &)> start;
+	auto finish = [&](const UString &name, bool ok) {
+		std::list<UString> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished++;
+			if (!ok)
+			{
+				failed.insert(name);
+			}
+			auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+			                                             startTime)
+			                   .count();
+			LogWarning("[%u/%u] %s %s after %.1fs", (unsigned)finished, (unsigned)extractors.size(),
+			           ok ? "Finished" : "Failed", name, seconds);
+			for (auto it = waitingFor.begin(); it != waitingFor.end();)
+			{
+				if (it->second.erase(name) && it->second.empty())
+				{
+					started++;
+					ready.push_back(it->first);
+					it = waitingFor.erase(it);
+				}
+				else
+				{
+					it++;
+				}
+			}
+			// Notified with the lock held, as once the last one finishes none of this is kept
+			doneCondition.notify_all();
+		}
+		for (auto &readyName : ready)
+		{
+			start(readyName);
+		}
+	};
+	start = [&](const UString &name) {
+		auto waitedFor = dependencies.find(name);
+		if (waitedFor != dependencies.end())
+		{
+			for (auto &dependency : waitedFor->second)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (failed.find(dependency) != failed.end())
+				{
+					lock.unlock();
+					LogError("Skipping %s as %s failed", name, dependency);
+					finish(name, false);
+					return;
+				}
+			}
+		}
+		fw().threadPoolTaskEnqueue([&, name]() {
+			LogWarning("Running %s", name);
+			bool ok = true;
+			try
+			{
+				TraceObj exTrace(name);
+				extractors.at(name)(e);
+			}
+			catch (std::exception &ex)
+			{
+				LogError("Extractor %s failed: %s", name, ex.what());
+				ok = false;
+			}
+			finish(name, ok);
+		});
+	};
+
+	std::list<UString> ready;
+	for (auto &ePair : extractors)
+	{
+		if (waitingFor.find(ePair.first) == waitingFor.end())
+		{
+			ready.push_back(ePair.first);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		started = ready.size();
+	}
+	for (auto &readyName : ready)
+	{
+		start(readyName);
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [&] { return finished == started; });
+	if (!waitingFor.empty())
+	{
+		LogError("Extractors depend on each other in a loop, %u were never run",
+		         (unsigned)waitingFor.size());
+		for (auto &waiting : waitingFor)
+		{
+			failed.insert(waiting.first);
+		}
+	}
+	return failed;
+}
+
+// Hashes every input of the extractors, each just once however many of them read it
+static std::map<UString, ExtractorManifest::InputHashes>
+hashExtractorInputs(const ExtractorList &extractorsToRun)
+{
+	std::set<UString> inputSet;
+	for (auto &ePair : extractorsToRun)
+	{
+		auto info = extractorInfo.find(ePair.first);
+		if (info != extractorInfo.end())
+		{
+			inputSet.insert(info->second.inputs.begin(), info->second.inputs.end());
+			inputSet.insert(commonExtractorInputs.begin(), commonExtractorInputs.end());
+		}
+	}
+	std::vector<UString> inputs(inputSet.begin(), inputSet.end());
+	std::vector<UString> hashes(inputs.size());
+	fw().threadPoolParallelFor(inputs.size(), [&](unsigned int index, unsigned int) {
+		hashes[index] = ExtractorManifest::hashInput(inputs[index]);
+	});
+	std::map<UString, UString> hashByInput;
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		hashByInput[inputs[i]] = hashes[i];
+	}
+
+	std::map<UString, ExtractorManifest::InputHashes> inputHashes;
+	for (auto &ePair : extractorsToRun)
+	{
+		auto info = extractorInfo.find(ePair.first);
+		if (info == extractorInfo.end())
+		{
+			continue;
+		}
+		auto &extractorHashes = inputHashes[ePair.first];
+		for (auto &input : commonExtractorInputs)
+		{
+			extractorHashes[input] = hashByInput[input];
+		}
+		for (auto &input : info->second.inputs)
+		{
+			extractorHashes[input] = hashByInput[input];
+		}
+	}
+	return inputHashes;
+}
+
+// Drops the extractors that do not need to run again, as neither their inputs nor their version
+// changed since they last ran and their outputs are all there, unless one they depend on has to
+// run again. Extractors with no ExtractorInfo always run
+static void skipUpToDateExtractors(ExtractorList &extractorsToRun,
+                                   const ExtractorManifest &manifest,
+                                   std::map<UString, ExtractorManifest::InputHashes> &inputHashes,
+                                   bool force)
+{
+	std::set<UString> stale;
+	for (auto &ePair : extractorsToRun)
+	{
+		auto info = extractorInfo.find(ePair.first);
+		if (force || info == extractorInfo.end() ||
+		    !manifest.isUpToDate(ePair.first, info->second.version, inputHashes[ePair.first],
+		                         info->second.outputs))
+		{
+			stale.insert(ePair.first);
+		}
+	}
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (auto &ePair : extractorsToRun)
+		{
+			if (stale.find(ePair.first) != stale.end())
+			{
+				continue;
+			}
+			for (auto &dependency : extractorDependencies[ePair.first])
+			{
+				if (stale.find(dependency) != stale.end())
+				{
+					stale.insert(ePair.first);
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+	for (auto it = extractorsToRun.begin(); it != extractorsToRun.end();)
+	{
+		if (stale.find(it->first) == stale.end())
+		{
+			LogWarning("Skipping %s as it is up to date", it->first);
+			it = extractorsToRun.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	ConfigOptionString extractList(
 	    "Extractor", "extract",
 	    "Comma-separated list of things to extract  - \"all\" is special meaning everything",
 	    "all");
+	ConfigOptionString manifestOption(
+	    "Extractor", "Manifest",
+	    "File recording what each extractor was last run on, so the ones with nothing changed "
+	    "since are skipped - empty to always run them",
+	    "data/extractor_manifest.xml");
+	ConfigOptionBool forceOption("Extractor", "Force",
+	                             "Run the extractors even if nothing changed since they last ran",
+	                             false);
 
 	if (config().parseOptions(argc, argv))
 	{
@@ -251,8 +561,7 @@ int main(int argc, char *argv[])
 	}
 	auto extractListString = extractList.get();
 
-	std::list<std::pair<UString, std::function<void(const InitialGameStateExtractor &e)>>>
-	    extractorsToRun;
+	ExtractorList extractorsToRun;
 
 	if (extractListString == "all")
 	{
@@ -281,12 +590,45 @@ int main(int argc, char *argv[])
 	}
 	TraceObj mainTrace("main");
 	Framework fw(UString(argv[0]), false);
+
+	ExtractorManifest manifest;
+	auto manifestPath = manifestOption.get();
+	std::map<UString, ExtractorManifest::InputHashes> inputHashes;
+	if (!manifestPath.empty())
+	{
+		manifest.load(manifestPath);
+		inputHashes = hashExtractorInputs(extractorsToRun);
+		skipUpToDateExtractors(extractorsToRun, manifest, inputHashes, forceOption.get());
+		if (extractorsToRun.empty())
+		{
+			LogWarning("Nothing to extract, everything is up to date");
+			return 0;
+		}
+	}
+
 	InitialGameStateExtractor initialGameStateExtractor;
-	for (auto &ePair : extractorsToRun)
+	auto failed = runExtractors(extractorsToRun, initialGameStateExtractor);
+
+	if (!manifestPath.empty())
+	{
+		for (auto &ePair : extractorsToRun)
+		{
+			auto info = extractorInfo.find(ePair.first);
+			if (failed.find(ePair.first) != failed.end() || info == extractorInfo.end())
+			{
+				manifest.remove(ePair.first);
+			}
+			else
+			{
+				manifest.update(ePair.first, info->second.version, inputHashes[ePair.first],
+				                info->second.outputs);
+			}
+		}
+		manifest.save(manifestPath);
+	}
+	if (!failed.empty())
 	{
-		LogWarning("Running %s", ePair.first);
-		TraceObj exTrace(ePair.first);
-		ePair.second(initialGameStateExtractor);
+		return EXIT_FAILURE;
 	}
 
 	return 0;
@@ -248,6 +248,20 @@ void writeHeader(std::ofstream &out, const StateDefinition &state)
 	out << "\n} // namespace OpenApoc\n";
 }
 
+// The names are made once rather than turned into a UString on every call, and are listed in
+// the order the members are read and written, which is the order lookups are quickest in
+void writeMemberNames(std::ofstream &out, const SerializeObject &object)
+{
+	if (object.members.empty())
+		return;
+	out << "\tstatic const UString names[] = {";
+	for (auto &member : object.members)
+	{
+		out << "\"" << member.first << "\", ";
+	}
+	out << "};\n";
+}
+
 void writeSource(std::ofstream &out, const StateDefinition &state)
 {
 	out << "// GENERATED SOURCE - generated by GamestateSerializeGen - do not modify directly\n\n";
@@ -288,7 +302,9 @@ void writeSource(std::ofstream &out, const StateDefinition &state)
 		    << " &obj)\n{\n";
 
 		out << "\tif (!node) return;\n";
+		writeMemberNames(out, object);
 
+		unsigned int memberIndex = 0;
 		for (auto &member : object.members)
 		{
 			std::string serializeFn;
@@ -308,8 +324,8 @@ void writeSource(std::ofstream &out, const StateDefinition &state)
 					newNodeFn = "getSection";
 					break;
 			}
-			out << "\t" << serializeFn << "(state, node->" << newNodeFn << "(\"" << member.first
-			    << "\"), obj." << member.first << ");\n";
+			out << "\t" << serializeFn << "(state, node->" << newNodeFn << "(names["
+			    << memberIndex++ << "]), obj." << member.first << ");\n";
 		}
 
 		out << "}\n";
@@ -318,7 +334,9 @@ void writeSource(std::ofstream &out, const StateDefinition &state)
 			out << "inline\n";
 		out << "void serializeOut(SerializationNode* node, const " << object.name << " &obj, const "
 		    << object.name << " &ref)\n{\n";
+		writeMemberNames(out, object);
 
+		memberIndex = 0;
 		for (auto &member : object.members)
 		{
 			std::string serializeFn;
@@ -340,15 +358,16 @@ void writeSource(std::ofstream &out, const StateDefinition &state)
 			}
 			if (object.full)
 			{
-				out << "\t" << serializeFn << "(node->" << newNodeFn << "(\"" << member.first
-				    << "\"), obj." << member.first << ", ref." << member.first << ");\n";
+				out << "\t" << serializeFn << "(node->" << newNodeFn << "(names[" << memberIndex
+				    << "]), obj." << member.first << ", ref." << member.first << ");\n";
 			}
 			else
 			{
 				out << "\tif (obj." << member.first << " != ref." << member.first << ")"
-				    << serializeFn << "(node->" << newNodeFn << "(\"" << member.first << "\"), obj."
-				    << member.first << ", ref." << member.first << ");\n";
+				    << serializeFn << "(node->" << newNodeFn << "(names[" << memberIndex
+				    << "]), obj." << member.first << ", ref." << member.first << ");\n";
 			}
+			memberIndex++;
 		}
 
 		out << "}\n";
@@ -2,10 +2,15 @@
 #include "framework/filesystem.h"
 #include "framework/framework.h"
 #include "framework/logger.h"
+#include "framework/serialization/serialize.h"
 #include "game/state/gamestate.h"
 #include "game/state/gamestate_serialize.h"
+#include "library/strings_format.h"
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 // We can't just use 'using namespace OpenApoc;' as:
 // On windows VS it says
@@ -23,8 +28,230 @@ static OpenApoc::ConfigOptionBool packOutput("", "pack",
                                              "Pack output into a zip instead of a directory", true);
 static OpenApoc::ConfigOptionBool
     prettyOutput("", "pretty", "Output more human-readable files (e.g. indent)", true);
+static OpenApoc::ConfigOptionBool
+    binaryOutput("", "binary", "Write the output in the binary format instead of XML", false);
 static OpenApoc::ConfigOptionString
     deltaGamestate("", "delta", "Only output the differences from specified parent gamestate");
+static OpenApoc::ConfigOptionBool
+    diffInputs("", "diff", "Print every path where input1 and input2 differ and write nothing",
+               false);
+static OpenApoc::ConfigOptionBool convertInput(
+    "", "convert",
+    "Copy input1 to the output node by node, without loading it as a gamestate", false);
+static OpenApoc::ConfigOptionString rootNames("", "roots",
+                                              "Comma separated roots to diff or convert",
+                                              "gamestate");
+
+// --diff and --convert go through the archives themselves, so they work on any archive and need
+// none of the game's data. Entries of maps are told apart by their key and everything else by its
+// name and place among those of the same name. Values are compared and copied as text
+namespace
+{
+
+bool isSectionEntry(OpenApoc::SerializationNode *node)
+{
+	return node->getName() == "entry" && node->getNodeOpt("key") && !node->getNodeOpt("value") &&
+	       !node->getNodeOpt("erase");
+}
+
+// The children of node with how each is told apart, leaving out how XML archives point to
+// sections, which are gone through on their own
+std::vector<std::pair<OpenApoc::UString, OpenApoc::SerializationNode *>>
+getChildren(OpenApoc::SerializationNode *node)
+{
+	std::vector<std::pair<OpenApoc::UString, OpenApoc::SerializationNode *>> children;
+	std::map<OpenApoc::UString, unsigned int> counts;
+	for (auto child = node->getFirstChildOpt(); child; child = child->getNextSiblingOpt())
+	{
+		auto name = child->getName();
+		if (name == "xi:include")
+		{
+			continue;
+		}
+		auto key = child->getNodeOpt("key");
+		children.emplace_back(key ? OpenApoc::format("%s[%s]", name, key->getValue())
+		                          : OpenApoc::format("%s#%u", name, counts[name]++),
+		                      child);
+	}
+	return children;
+}
+
+// A section both inputs have, compared once the root it was found under is done
+class PendingSection
+{
+  public:
+	OpenApoc::UString path;
+	OpenApoc::UString prefix;
+	OpenApoc::UString name;
+};
+
+// Compares two inputs, going through the sections found under their roots on every worker with
+// archives of its own, as reading an archive can't be shared between threads
+class ArchiveDiff
+{
+  public:
+	ArchiveDiff(const OpenApoc::UString &path1, const OpenApoc::UString &path2,
+	            unsigned int slots)
+	    : path1(path1), path2(path2), archives(slots)
+	{
+	}
+
+	// Prints every difference under the roots, returning how many there were or -1 if an input
+	// couldn't be read
+	int run(const std::vector<OpenApoc::UString> &roots)
+	{
+		// The roots are gone through here first, leaving the sections under them for the workers
+		std::vector<PendingSection> sections;
+		std::ostringstream out;
+		unsigned int differences = 0;
+		for (auto &root : roots)
+		{
+			if (!diffSection(0, {root, "", root}, out, differences, &sections))
+			{
+				return -1;
+			}
+		}
+		std::vector<std::ostringstream> outs(sections.size());
+		std::vector<unsigned int> counts(sections.size(), 0);
+		std::vector<char> failed(sections.size(), 0);
+		OpenApoc::fw().threadPoolParallelFor(
+		    static_cast<unsigned int>(sections.size()), [&](unsigned int index, unsigned int slot) {
+			    failed[index] = !diffSection(slot, sections[index], outs[index], counts[index],
+			                                 nullptr);
+		    });
+		std::cout << out.str();
+		for (size_t i = 0; i < sections.size(); i++)
+		{
+			if (failed[i])
+			{
+				return -1;
+			}
+			std::cout << outs[i].str();
+			differences += counts[i];
+		}
+		std::cout << std::flush;
+		return static_cast<int>(differences);
+	}
+
+  private:
+	OpenApoc::UString path1, path2;
+	// Both inputs opened for each slot of the thread pool, when first used from it
+	std::vector<std::pair<OpenApoc::up<OpenApoc::SerializationArchive>,
+	                      OpenApoc::up<OpenApoc::SerializationArchive>>>
+	    archives;
+
+	// Compares the section in both inputs, leaving sections under it in pending if given one
+	bool diffSection(unsigned int slot, const PendingSection &section, std::ostream &out,
+	                 unsigned int &differences, std::vector<PendingSection> *pending)
+	{
+		auto &inputs = archives[slot];
+		if (!inputs.first)
+		{
+			inputs.first = OpenApoc::SerializationArchive::readArchive(path1);
+			inputs.second = OpenApoc::SerializationArchive::readArchive(path2);
+			if (!inputs.first || !inputs.second)
+			{
+				LogError("Failed to open \"%s\" and \"%s\"", path1, path2);
+				return false;
+			}
+		}
+		auto root1 = inputs.first->getRoot(section.prefix, section.name);
+		auto root2 = inputs.second->getRoot(section.prefix, section.name);
+		if (!root1 && !root2)
+		{
+			return true;
+		}
+		if (!root1 || !root2)
+		{
+			out << (root1 ? "- " : "+ ") << section.path << "\n";
+			differences++;
+			return true;
+		}
+		diffNodes(slot, root1, root2, section.path, out, differences, pending);
+		return true;
+	}
+
+	void diffNodes(unsigned int slot, OpenApoc::SerializationNode *node1,
+	               OpenApoc::SerializationNode *node2, const OpenApoc::UString &path,
+	               std::ostream &out, unsigned int &differences,
+	               std::vector<PendingSection> *pending)
+	{
+		auto value1 = node1->getValue();
+		auto value2 = node2->getValue();
+		if (value1 != value2)
+		{
+			out << OpenApoc::format("~ %s: \"%s\" != \"%s\"\n", path, value1, value2);
+			differences++;
+		}
+		auto children1 = getChildren(node1);
+		auto children2 = getChildren(node2);
+		std::map<OpenApoc::UString, OpenApoc::SerializationNode *> unmatched(children2.begin(),
+		                                                                    children2.end());
+		for (auto &child : children1)
+		{
+			auto childPath = path + "/" + child.first;
+			auto it = unmatched.find(child.first);
+			if (it == unmatched.end())
+			{
+				out << "- " << childPath << "\n";
+				differences++;
+				continue;
+			}
+			diffNodes(slot, child.second, it->second, childPath, out, differences, pending);
+			unmatched.erase(it);
+		}
+		for (auto &child : children2)
+		{
+			if (unmatched.find(child.first) != unmatched.end())
+			{
+				out << "+ " << path << "/" << child.first << "\n";
+				differences++;
+			}
+		}
+		if (isSectionEntry(node1) && isSectionEntry(node2))
+		{
+			PendingSection section{path + "/section", node1->getPrefix(),
+			                       node1->getNodeOpt("key")->getValue()};
+			if (pending)
+			{
+				pending->push_back(section);
+			}
+			else
+			{
+				diffSection(slot, section, out, differences, nullptr);
+			}
+		}
+	}
+};
+
+void copyNodes(OpenApoc::SerializationNode *from, OpenApoc::SerializationNode *to)
+{
+	auto value = from->getValue();
+	if (!value.empty())
+	{
+		to->setValue(value);
+	}
+	for (auto child = from->getFirstChildOpt(); child; child = child->getNextSiblingOpt())
+	{
+		auto name = child->getName();
+		// Written again by addSection below where the output is XML too
+		if (name != "xi:include")
+		{
+			copyNodes(child, to->addNode(name));
+		}
+	}
+	if (isSectionEntry(from))
+	{
+		auto name = from->getNodeOpt("key")->getValue();
+		auto section = from->getSectionOpt(name);
+		if (section)
+		{
+			copyNodes(section, to->addSection(name));
+		}
+	}
+}
+
+} // anonymous namespace
 
 int main(int argc, char **argv)
 {
@@ -38,7 +265,7 @@ int main(int argc, char **argv)
 	}
 
 	auto outputPath = OpenApoc::config().getString("output");
-	if (outputPath.empty())
+	if (outputPath.empty() && !diffInputs.get())
 	{
 		std::cerr << "Must provide output path\n";
 	}
@@ -65,6 +292,52 @@ int main(int argc, char **argv)
 
 	OpenApoc::Framework fw("OpenApoc", false);
 
+	auto roots = rootNames.get().split(",");
+	if (diffInputs.get())
+	{
+		if (input2.empty())
+		{
+			std::cerr << "Must provide two inputs to diff\n";
+			return EXIT_FAILURE;
+		}
+		ArchiveDiff diff(input1, input2, fw.threadPoolGetSize() + 1);
+		auto differences = diff.run(roots);
+		if (differences < 0)
+		{
+			return EXIT_FAILURE;
+		}
+		std::cout << differences << " differences\n";
+		return differences == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (convertInput.get())
+	{
+		auto input = OpenApoc::SerializationArchive::readArchive(input1);
+		if (!input)
+		{
+			LogError("Failed to open input file \"%s\"", input1);
+			return EXIT_FAILURE;
+		}
+		auto output = OpenApoc::SerializationArchive::createArchive(
+		    binaryOutput.get() ? OpenApoc::SerializationFormat::Binary
+		                       : OpenApoc::SerializationFormat::XML);
+		for (auto &root : roots)
+		{
+			auto node = input->getRoot("", root);
+			if (!node)
+			{
+				LogError("No root \"%s\" in \"%s\"", root, input1);
+				return EXIT_FAILURE;
+			}
+			copyNodes(node, output->newRoot("", root));
+		}
+		if (!output->write(outputPath, pack, pretty))
+		{
+			LogError("Failed to write output to \"%s\"", outputPath);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	auto state = OpenApoc::mksp<OpenApoc::GameState>();
 	if (!state->loadGame(input1))
 	{
@@ -90,7 +363,11 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (!state->saveGame(outputPath, pack, pretty))
+	// Either format is read, so going through here converts between them
+	auto archive = OpenApoc::SerializationArchive::createArchive(
+	    binaryOutput.get() ? OpenApoc::SerializationFormat::Binary
+	                       : OpenApoc::SerializationFormat::XML);
+	if (!state->serialize(archive.get()) || !archive->write(outputPath, pack, pretty))
 	{
 		LogError("Failed to write output gamestate to \"%s\"", outputPath);
 		return EXIT_FAILURE;
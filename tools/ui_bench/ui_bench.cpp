@@ -0,0 +1,415 @@
+#include "framework/configfile.h"
+#include "framework/data.h"
+#include "framework/event.h"
+#include "framework/framework.h"
+#include "framework/image.h"
+#include "framework/logger.h"
+#include "framework/metrics.h"
+#include "framework/renderer.h"
+#include "framework/sound_interface.h"
+#include "framework/stage.h"
+#include "game/state/gamestate.h"
+#include "game/state/savemanager.h"
+#include "game/ui/base/buyandsellscreen.h"
+#include "game/ui/base/recruitscreen.h"
+#include "game/ui/base/researchscreen.h"
+#include "game/ui/general/aequipscreen.h"
+#include "game/ui/ufopaedia/ufopaediacategoryview.h"
+#include "library/strings_format.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+// Opens the heaviest screens of the base and the ufopaedia over a saved game, with no window or
+// sound, and plays the same mouse script at each of them: a sweep across the whole screen, the
+// wheel down and back up over every list, clicks down every list and drags between the parts of
+// the screen that take them. Every event is a frame of its own, handled, updated and rendered like
+// Framework::run() does, only drawn with a renderer that draws nothing but counts what it is
+// given. Prints, for each screen, how long the frames took and what they did on average: draws,
+// controls rendered into their own surface again rather than kept, and memory allocated.
+//
+// A save always gets the same script, so the same save gives comparable numbers on two builds
+// (and --Trace.enable gives a trace of it). Clicks are handled like any other, but whatever stage
+// they open or close is not gone to, so every screen gets the whole script.
+
+using namespace OpenApoc;
+
+namespace
+{
+
+std::atomic<unsigned long long> allocations{0};
+
+} // anonymous namespace
+
+// Every allocation is counted, on any thread, as there is no other way to see what a frame costs
+// the allocator
+void *operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = std::malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+
+ConfigOptionString saveOption("Bench", "Save", "Saved game to open the screens over");
+ConfigOptionInt roundsOption("Bench", "Rounds", "Times to play the script at each screen", 5);
+ConfigOptionString screensOption("Bench", "Screens", "Screens to open, separated by commas",
+                                 "aequip,transaction,recruit,research,ufopaedia");
+
+// The screens are laid out for this, so where they are is where their forms say
+const Vec2<int> DISPLAY_SIZE = {640, 480};
+
+// Draws nothing, counting every call as a draw call like a renderer that batches nothing would
+class CountingRenderer : public Renderer
+{
+  public:
+	CountingRenderer() : defaultSurface(mksp<Surface>(Vec2<unsigned int>(DISPLAY_SIZE)))
+	{
+		surface = defaultSurface;
+	}
+	~CountingRenderer() override = default;
+
+	void clear(Colour) override {}
+	void setPalette(sp<Palette> p) override { palette = p; }
+	sp<Palette> getPalette() override { return palette; }
+	void draw(sp<Image>, Vec2<float>) override { drawn(1); }
+	void drawRotated(sp<Image>, Vec2<float>, Vec2<float>, float) override { drawn(1); }
+	void drawScaled(sp<Image>, Vec2<float>, Vec2<float>, Scaler) override { drawn(1); }
+	void drawTinted(sp<Image>, Vec2<float>, Colour) override { drawn(1); }
+	void drawFilledRect(Vec2<float>, Vec2<float>, Colour) override { drawn(0); }
+	void drawRect(Vec2<float>, Vec2<float>, Colour, float) override { drawn(0); }
+	void drawLine(Vec2<float>, Vec2<float>, Colour, float) override { drawn(0); }
+	void drawSprites(const std::vector<RendererSprite> &sprites) override
+	{
+		frameStats.drawCalls++;
+		frameStats.sprites += sprites.size();
+	}
+	void flush() override {}
+	UString getName() override { return "Counting"; }
+	sp<Surface> getDefaultSurface() override { return defaultSurface; }
+
+  private:
+	sp<Surface> defaultSurface;
+	sp<Surface> surface;
+	sp<Palette> palette;
+
+	void setSurface(sp<Surface> s) override { surface = s; }
+	sp<Surface> getSurface() override { return surface; }
+
+	void drawn(unsigned int images)
+	{
+		frameStats.drawCalls++;
+		frameStats.sprites += images;
+	}
+};
+
+// What the screens are opened over, as they all render the stage under them first
+class Backdrop : public Stage
+{
+  public:
+	void begin() override {}
+	void pause() override {}
+	void resume() override {}
+	void finish() override {}
+	void eventOccurred(Event *) override {}
+	void update() override {}
+	void render() override {}
+	bool isTransition() override { return false; }
+};
+
+class Screen
+{
+  public:
+	UString name;
+	std::function<sp<Stage>(sp<GameState>)> open;
+	// Parts of the screen scrolled and clicked down
+	std::vector<Rect<int>> lists;
+	// From and to, dragged with the left button held
+	std::vector<std::pair<Vec2<int>, Vec2<int>>> drags;
+};
+
+std::vector<Screen> getScreens()
+{
+	std::vector<Screen> screens;
+	screens.push_back({"aequip",
+	                   [](sp<GameState> state) { return mksp<AEquipScreen>(state); },
+	                   {{463, 70, 561, 330}, {16, 364, 538, 448}},
+	                   {{{30, 380}, {320, 193}}, {{320, 193}, {60, 400}}}});
+	screens.push_back({"transaction",
+	                   [](sp<GameState> state) { return mksp<BuyAndSellScreen>(state); },
+	                   {{211, 181, 568, 465}},
+	                   {}});
+	screens.push_back({"recruit",
+	                   [](sp<GameState> state) { return mksp<RecruitScreen>(state); },
+	                   {{259, 76, 380, 465}, {460, 76, 565, 465}},
+	                   {{{300, 90}, {500, 90}}, {{500, 90}, {300, 90}}}});
+	screens.push_back({"research",
+	                   [](sp<GameState> state) { return mksp<ResearchScreen>(state); },
+	                   {{20, 183, 148, 439}, {278, 58, 540, 93}},
+	                   {{{80, 190}, {400, 75}}}});
+	screens.push_back({"ufopaedia",
+	                   [](sp<GameState> state) -> sp<Stage> {
+		                   if (state->ufopaedia.empty())
+		                   {
+			                   return nullptr;
+		                   }
+		                   return mksp<UfopaediaCategoryView>(state,
+		                                                      state->ufopaedia.begin()->second);
+	                   },
+	                   {{2, 2, 264, 356}},
+	                   {}});
+	return screens;
+}
+
+// Returns the state of the save, or nullptr if it has no base to open the screens at
+sp<GameState> loadSave(const UString &saveName)
+{
+	auto state = mksp<GameState>();
+	SaveManager saveManager;
+	saveManager.loadGame(saveName, state).wait();
+	if (!state->current_city || !state->current_base)
+	{
+		LogError("Failed to load save \"%s\"", saveName);
+		return nullptr;
+	}
+	if (state->current_battle)
+	{
+		LogError("Save \"%s\" is in battle, the screens are opened from a base", saveName);
+		return nullptr;
+	}
+	return state;
+}
+
+// The mouse events of the script, all of them with Button set to what is held
+std::vector<up<Event>> makeScript(const Screen &screen)
+{
+	// The mask SDL makes of the left button
+	const int leftButton = 1 << (static_cast<int>(Event::MouseButton::Left) - 1);
+	std::vector<up<Event>> script;
+	Vec2<int> last = {0, 0};
+	auto add = [&script, &last](EventTypes type, Vec2<int> position, int button, int wheel) {
+		auto e = mkup<MouseEvent>(type);
+		e->mouse().X = position.x;
+		e->mouse().Y = position.y;
+		e->mouse().DeltaX = type == EVENT_MOUSE_MOVE ? position.x - last.x : 0;
+		e->mouse().DeltaY = type == EVENT_MOUSE_MOVE ? position.y - last.y : 0;
+		e->mouse().WheelVertical = wheel;
+		e->mouse().WheelHorizontal = 0;
+		e->mouse().Button = button;
+		script.push_back(std::move(e));
+		last = position;
+	};
+
+	for (int y = 0; y < DISPLAY_SIZE.y; y += 48)
+	{
+		for (int x = 0; x < DISPLAY_SIZE.x; x += 64)
+		{
+			add(EVENT_MOUSE_MOVE, {x + (y / 48 % 2) * 32, y}, 0, 0);
+		}
+	}
+	for (auto &list : screen.lists)
+	{
+		Vec2<int> centre = {(list.p0.x + list.p1.x) / 2, (list.p0.y + list.p1.y) / 2};
+		add(EVENT_MOUSE_MOVE, centre, 0, 0);
+		for (int i = 0; i < 10; i++)
+		{
+			add(EVENT_MOUSE_MOVE, centre, 0, -1);
+		}
+		for (int i = 0; i < 10; i++)
+		{
+			add(EVENT_MOUSE_MOVE, centre, 0, 1);
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			Vec2<int> row = {centre.x, list.p0.y + 8 + (list.p1.y - list.p0.y - 16) * i / 5};
+			add(EVENT_MOUSE_MOVE, row, 0, 0);
+			add(EVENT_MOUSE_DOWN, row, leftButton, 0);
+			add(EVENT_MOUSE_UP, row, leftButton, 0);
+		}
+	}
+	for (auto &drag : screen.drags)
+	{
+		add(EVENT_MOUSE_MOVE, drag.first, 0, 0);
+		add(EVENT_MOUSE_DOWN, drag.first, leftButton, 0);
+		for (int i = 1; i <= 8; i++)
+		{
+			add(EVENT_MOUSE_MOVE, drag.first + (drag.second - drag.first) * i / 8, leftButton,
+			    0);
+		}
+		add(EVENT_MOUSE_UP, drag.second, leftButton, 0);
+	}
+	return script;
+}
+
+// Events are pushed again for every round, so copies of the script are made as they go
+up<Event> copyEvent(const Event &e)
+{
+	up<Event> copy = mkup<MouseEvent>(e.type());
+	copy->mouse() = e.mouse();
+	return copy;
+}
+
+long long getFormsTotal(const UString &name)
+{
+	for (auto metric : Metrics::getAll())
+	{
+		if (metric->group == "Forms" && metric->name == name &&
+		    metric->kind == Metric::Kind::Counter)
+		{
+			return static_cast<MetricCounter *>(metric)->getTotal();
+		}
+	}
+	return 0;
+}
+
+class Result
+{
+  public:
+	std::vector<double> frameMilliseconds;
+	unsigned long long drawCalls = 0;
+	unsigned long long sprites = 0;
+	unsigned long long fontStrings = 0;
+	long long controlsRendered = 0;
+	long long controlsDrawnDirectly = 0;
+	unsigned long long allocations = 0;
+};
+
+Result runScreen(Framework &fw, const Screen &screen, sp<Stage> stage)
+{
+	auto script = makeScript(screen);
+	Result result;
+	auto frame = [&fw, &result, &stage]() {
+		auto rendered = getFormsTotal("controls rendered");
+		auto drawnDirectly = getFormsTotal("controls drawn directly");
+		auto allocated = allocations.load(std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+		fw.dispatchEvents();
+		stage->update();
+		fw.renderer->clear();
+		stage->render();
+		fw.renderer->flush();
+		fw.renderer->newFrame();
+		result.frameMilliseconds.push_back(
+		    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+		        .count());
+		result.allocations += allocations.load(std::memory_order_relaxed) - allocated;
+		result.controlsRendered += getFormsTotal("controls rendered") - rendered;
+		result.controlsDrawnDirectly += getFormsTotal("controls drawn directly") - drawnDirectly;
+		fw.renderer->endFrameStats();
+		auto &stats = fw.renderer->lastFrameStats;
+		result.drawCalls += stats.drawCalls;
+		result.sprites += stats.sprites;
+		result.fontStrings += stats.fontStrings;
+	};
+
+	fw.stagePush(stage);
+	// The first frame lays the controls out where the events are aimed
+	frame();
+	result = Result{};
+	for (int round = 0; round < std::max(1, roundsOption.get()); round++)
+	{
+		for (auto &e : script)
+		{
+			fw.pushEvent(copyEvent(*e));
+			frame();
+		}
+	}
+	fw.stagePop();
+	return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	if (config().parseOptions(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+	auto saveName = saveOption.get();
+	if (saveName.empty())
+	{
+		std::cerr << "Must provide a save\n";
+		config().showHelp();
+		return EXIT_FAILURE;
+	}
+
+	Framework fw("OpenApoc", false);
+	// There is no window, so no sound either unless given one that plays nothing
+	up<SoundBackendFactory> nullSound(getNullSoundBackend());
+	fw.soundBackend.reset(nullSound->create());
+	fw.displayInitialiseHeadless(DISPLAY_SIZE);
+	fw.renderer.reset(new CountingRenderer());
+	fw.renderer->setPalette(fw.data->loadPalette("xcom3/ufodata/pal_06.dat"));
+	// The forms count what they render again only while metrics are kept
+	Metrics::enabled = true;
+
+	auto state = loadSave(saveName);
+	if (!state)
+	{
+		return EXIT_FAILURE;
+	}
+	fw.stagePush(mksp<Backdrop>());
+
+	auto wanted = screensOption.get().split(",");
+	std::ostringstream out;
+	for (auto &screen : getScreens())
+	{
+		if (std::find(wanted.begin(), wanted.end(), screen.name) == wanted.end())
+		{
+			continue;
+		}
+		auto stage = screen.open(state);
+		if (!stage)
+		{
+			LogError("Save \"%s\" has nothing to open the %s screen at", saveName, screen.name);
+			continue;
+		}
+		auto result = runScreen(fw, screen, stage);
+
+		auto frames = result.frameMilliseconds.size();
+		auto sorted = result.frameMilliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0;
+		for (auto milliseconds : sorted)
+		{
+			total += milliseconds;
+		}
+		auto percentile = [&sorted](double fraction) {
+			return sorted.empty() ? 0.0 : sorted[(size_t)((sorted.size() - 1) * fraction)];
+		};
+		double perFrame = frames ? 1.0 / frames : 0.0;
+		out << format("%s: %u frames in %.2f ms (mean %.3f ms, p50 %.3f ms, p95 %.3f ms, "
+		              "max %.3f ms)\n",
+		              screen.name, (unsigned int)frames, total, total * perFrame, percentile(0.5),
+		              percentile(0.95), sorted.empty() ? 0.0 : sorted.back());
+		out << format("  %-40s %10.1f\n", "draw calls/frame", result.drawCalls * perFrame);
+		out << format("  %-40s %10.1f\n", "images drawn/frame", result.sprites * perFrame);
+		out << format("  %-40s %10.1f\n", "font strings/frame", result.fontStrings * perFrame);
+		out << format("  %-40s %10.1f\n", "controls rendered/frame",
+		              result.controlsRendered * perFrame);
+		out << format("  %-40s %10.1f\n", "controls drawn directly/frame",
+		              result.controlsDrawnDirectly * perFrame);
+		out << format("  %-40s %10.1f\n", "allocations/frame", result.allocations * perFrame);
+	}
+	fw.stagePop();
+	std::cout << out.str() << std::flush;
+	return EXIT_SUCCESS;
+}